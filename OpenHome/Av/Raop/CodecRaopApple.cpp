@@ -58,6 +58,14 @@ TBool CodecRaopApple::Recognise(const EncodedStreamInfo& aStreamInfo)
     return false;
 }
 
+CodecBase::Signature CodecRaopApple::CheckSignature(const Brx& aHead) const
+{
+    if (aHead.Bytes() >= 4 && Brn(aHead.Ptr(), 4) == Brn("Raop")) {
+        return Signature::eMatch;
+    }
+    return Signature::eNoMatch;
+}
+
 void CodecRaopApple::StreamInitialise()
 {
     LOG(kCodec, "CodecRaopApple::StreamInitialise\n");
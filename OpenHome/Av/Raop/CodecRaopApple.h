@@ -14,6 +14,7 @@ public:
     ~CodecRaopApple();
 private: // from CodecBase
     TBool Recognise(const Media::Codec::EncodedStreamInfo& aStreamInfo) override;
+    Signature CheckSignature(const Brx& aHead) const override;
     void StreamInitialise() override;
     void Process() override;
     TBool TrySeek(TUint aStreamId, TUint64 aSample) override;
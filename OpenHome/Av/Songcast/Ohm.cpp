@@ -1,5 +1,7 @@
 #include "Ohm.h"
 
+#include <algorithm>
+
 using namespace OpenHome;
 using namespace OpenHome::Av;
 
@@ -32,7 +34,7 @@ void OhmHeader::Internalise(IReader& aReader)
         THROW(OhmError);
     }
     iMsgType  = reader.ReadUintBe(1);
-    if(iMsgType > kMsgTypeResend && iMsgType != kMsgTypeAudioBlob) {
+    if(iMsgType > kMsgTypeAudioParity && iMsgType != kMsgTypeAudioBlob) {
         THROW(OhmError);
     }
     iBytes = reader.ReadUintBe(2);
@@ -326,6 +328,107 @@ void OhmHeaderResend::Externalise(IWriter& aWriter) const
 
     writer.WriteUint32Be(iFramesCount);
 }
+
+// OhmHeaderAudioParity
+
+OhmHeaderAudioParity::OhmHeaderAudioParity()
+    : iFirstFrame(0)
+    , iFrameCount(0)
+    , iMsgBytesXor(0)
+    , iParityBytes(0)
+{
+}
+
+OhmHeaderAudioParity::OhmHeaderAudioParity(TUint aFirstFrame, TUint aFrameCount, TUint aMsgBytesXor, TUint aParityBytes)
+    : iFirstFrame(aFirstFrame)
+    , iFrameCount(aFrameCount)
+    , iMsgBytesXor(aMsgBytesXor)
+    , iParityBytes(aParityBytes)
+{
+}
+
+void OhmHeaderAudioParity::Internalise(IReader& aReader, const OhmHeader& aHeader)
+{
+    ASSERT (aHeader.MsgType() == OhmHeader::kMsgTypeAudioParity);
+
+    if (aHeader.MsgBytes() < kHeaderBytes) {
+        THROW(OhmError);
+    }
+    ReaderBinary readerBinary(aReader);
+
+    iFirstFrame = readerBinary.ReadUintBe(4);
+    iFrameCount = readerBinary.ReadUintBe(1);
+    const TUint reserved = readerBinary.ReadUintBe(1);
+    if (reserved != 0) {
+        THROW(OhmError);
+    }
+    iMsgBytesXor = readerBinary.ReadUintBe(2);
+    iParityBytes = aHeader.MsgBytes() - kHeaderBytes;
+}
+
+void OhmHeaderAudioParity::Externalise(IWriter& aWriter) const
+{
+    WriterBinary writer(aWriter);
+
+    writer.WriteUint32Be(iFirstFrame);
+    writer.WriteUint8(iFrameCount);
+    writer.WriteUint8(0);
+    writer.WriteUint16Be(iMsgBytesXor);
+}
+
+// OhmHeaderListen
+
+OhmHeaderListen::OhmHeaderListen()
+{
+}
+
+void OhmHeaderListen::AddFeature(const Brx& aName)
+{
+    if (iFeatures.Bytes() == 0) {
+        iFeatures.Append((TByte)0);
+    }
+    ASSERT(iFeatures.Bytes() + 1 + aName.Bytes() <= iFeatures.MaxBytes());
+    iFeatures[0]++;
+    iFeatures.Append((TByte)aName.Bytes());
+    iFeatures.Append(aName);
+}
+
+TBool OhmHeaderListen::SupportsFeature(const Brx& aName) const
+{
+    if (iFeatures.Bytes() == 0) {
+        return false;
+    }
+    // Internalise() may have truncated the list so check every name fits in iFeatures
+    TUint offset = 1;
+    for (TUint i=0; i<iFeatures[0] && offset < iFeatures.Bytes(); i++) {
+        const TUint bytes = iFeatures[offset++];
+        if (offset + bytes > iFeatures.Bytes()) {
+            break;
+        }
+        if (iFeatures.Split(offset, bytes) == aName) {
+            return true;
+        }
+        offset += bytes;
+    }
+    return false;
+}
+
+void OhmHeaderListen::Internalise(IReader& aReader, const OhmHeader& aHeader)
+{
+    ASSERT (aHeader.MsgType() == OhmHeader::kMsgTypeJoin || aHeader.MsgType() == OhmHeader::kMsgTypeListen);
+
+    iFeatures.Replace(Brx::Empty());
+    const TUint bytes = std::min(aHeader.MsgBytes(), iFeatures.MaxBytes());
+    if (bytes > 0) {
+        ReaderBinary readerBinary(aReader);
+        readerBinary.ReadReplace(bytes, iFeatures);
+    }
+}
+
+void OhmHeaderListen::Externalise(IWriter& aWriter) const
+{
+    aWriter.Write(iFeatures);
+}
     
     
 
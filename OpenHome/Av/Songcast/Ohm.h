@@ -38,6 +38,7 @@ public:
     static const TUint kMsgTypeMetatext = 5;
     static const TUint kMsgTypeSlave = 6;
     static const TUint kMsgTypeResend = 7;
+    static const TUint kMsgTypeAudioParity = 8;
     static const TUint kMsgTypeAudioBlob = 255; // locally generated, is never sent over the network
 
 public:
@@ -260,6 +261,66 @@ private:
     TUint iFramesCount;
 };
 
+class OhmHeaderAudioParity
+{
+public:
+    static const TUint kHeaderBytes = 8;
+
+public:
+    OhmHeaderAudioParity();
+    OhmHeaderAudioParity(TUint aFirstFrame, TUint aFrameCount, TUint aMsgBytesXor, TUint aParityBytes);
+
+    void Internalise(IReader& aReader, const OhmHeader& aHeader);
+    void Externalise(IWriter& aWriter) const;
+
+    TUint FirstFrame() const {return iFirstFrame;}
+    TUint FrameCount() const {return iFrameCount;}
+    TUint MsgBytesXor() const {return iMsgBytesXor;}
+    TUint ParityBytes() const {return iParityBytes;}
+    TUint MsgBytes() const {return (kHeaderBytes + iParityBytes);}
+
+private:
+    //Offset    Bytes                   Desc
+    //0         4                       First frame
+    //4         1                       Frame count (n)
+    //5         1                       Reserved (must be zero)
+    //6         2                       Total bytes of each of the n audio msgs, xor'd together
+    //8         m                       The n audio msgs (including their OhmHeader, with the resent flag clear),
+    //                                  each zero padded to m bytes and xor'd together
+
+    TUint iFirstFrame;
+    TUint iFrameCount;
+    TUint iMsgBytesXor;
+    TUint iParityBytes;
+};
+
+class OhmHeaderListen
+{
+    // Optional payload of join and listen msgs, listing the optional protocol features (audio
+    // codecs, parity msgs) a receiver supports.  Older receivers send no payload.
+public:
+    static const TUint kMaxBytes = 128;
+
+public:
+    OhmHeaderListen();
+
+    void AddFeature(const Brx& aName);
+    TBool SupportsFeature(const Brx& aName) const;
+
+    void Internalise(IReader& aReader, const OhmHeader& aHeader);
+    void Externalise(IWriter& aWriter) const;
+
+    TUint MsgBytes() const {return iFeatures.Bytes();}
+
+private:
+    //Offset    Bytes                   Desc
+    //0         1                       Feature count (n)
+    //1         1                       Feature name bytes (m)  (repeated n times)
+    //2         m                       Feature name
+
+    Bws<kMaxBytes> iFeatures;
+};
+
 class OhzHeader
 {
 public:
@@ -0,0 +1,406 @@
+#include <OpenHome/Av/Songcast/OhmCodec.h>
+#include <OpenHome/Types.h>
+#include <OpenHome/Buffer.h>
+
+#include <algorithm>
+
+namespace OpenHome {
+namespace Av {
+
+class OhmBitWriter
+{
+public:
+    OhmBitWriter(TByte* aPtr, TUint aMaxBytes);
+    void Write(TUint aValue, TUint aBits); // aBits <= 32
+    void WriteZeros(TUint aBits);
+    TBool Flush(); // returns false if aMaxBytes was exceeded
+    TBool Overflowed() const;
+    TUint Bytes() const;
+private:
+    void WriteByte(TByte aByte);
+private:
+    TByte* iPtr;
+    TUint iMaxBytes;
+    TUint iBytes;
+    TUint64 iAcc;
+    TUint iAccBits;
+    TBool iOverflowed;
+};
+
+class OhmBitReader
+{
+public:
+    OhmBitReader(const Brx& aBuf);
+    TUint Read(TUint aBits); // aBits <= 32
+    TBool Error() const;
+    TUint BytesConsumed() const;
+private:
+    const TByte* iPtr;
+    TUint iBytes;
+    TUint iPos;
+    TUint64 iAcc;
+    TUint iAccBits;
+    TBool iError;
+};
+
+} // namespace Av
+} // namespace OpenHome
+
+using namespace OpenHome;
+using namespace OpenHome::Av;
+
+/*
+Each channel is coded in turn, starting with a 1 byte header:
+    bits 7-5    predictor order (0-4), or kOrderVerbatim if the samples are stored unmodified
+    bits 4-0    Rice parameter (k)
+Predicted channels then hold <order> warm-up samples, followed by the zigzag coded residual
+for each remaining sample.  A residual, u, is written as (u >> k) zero bits, a one bit and the
+low k bits of u.  Residuals requiring kRiceEscape or more zero bits are instead written as
+kRiceEscape zero bits followed by all 32 bits of u.
+Samples are written using the stream's bit depth.  The final byte is zero padded.
+*/
+
+static const TUint kMaxOrder = 4;
+static const TUint kOrderVerbatim = 7;
+static const TUint kMaxRiceParam = 30;
+static const TUint kRiceEscape = 32;
+
+static inline TInt ReadSample(const TByte* aPtr, TUint aBytesPerSample)
+{
+    TInt sample = (TInt8)aPtr[0];
+    for (TUint i=1; i<aBytesPerSample; i++) {
+        sample = (sample * 256) | aPtr[i];
+    }
+    return sample;
+}
+
+static inline void WriteSample(TByte* aPtr, TUint aBytesPerSample, TInt aSample)
+{
+    for (TUint i=aBytesPerSample; i>0; i--) {
+        aPtr[i-1] = (TByte)aSample;
+        aSample >>= 8;
+    }
+}
+
+static inline TInt SignExtend(TUint aValue, TUint aBits)
+{
+    const TUint shift = 32 - aBits;
+    return (TInt)(aValue << shift) >> shift;
+}
+
+static inline TUint Zigzag(TInt aValue)
+{
+    return ((TUint)aValue << 1) ^ (TUint)(aValue >> 31);
+}
+
+static inline TInt Unzigzag(TUint aValue)
+{
+    return (TInt)((aValue >> 1) ^ (0 - (aValue & 1)));
+}
+
+static inline TInt Predict(TUint aOrder, TInt aS1, TInt aS2, TInt aS3, TInt aS4)
+{
+    switch (aOrder)
+    {
+    case 0:
+        return 0;
+    case 1:
+        return aS1;
+    case 2:
+        return 2*aS1 - aS2;
+    case 3:
+        return 3*aS1 - 3*aS2 + aS3;
+    default:
+        return 4*aS1 - 6*aS2 + 4*aS3 - aS4;
+    }
+}
+
+static void ChooseCoding(const TByte* aSrc, TUint aStride, TUint aBytesPerSample, TUint aSamples, TUint aBitDepth,
+                         TUint& aOrder, TUint& aRiceParam)
+{
+    aOrder = kOrderVerbatim;
+    aRiceParam = 0;
+    if (aSamples <= kMaxOrder) {
+        return;
+    }
+    // Sum the residuals each predictor would produce.  Rice coding with parameter k then needs
+    // roughly (k+1) bits per sample plus (sum >> k) bits for the unary coded quotients.
+    TUint64 sums[kMaxOrder+1] = { 0 };
+    TInt s1 = 0, s2 = 0, s3 = 0, s4 = 0;
+    for (TUint i=0; i<aSamples; i++) {
+        const TInt s = ReadSample(aSrc + i*aStride, aBytesPerSample);
+        if (i >= kMaxOrder) {
+            for (TUint order=0; order<=kMaxOrder; order++) {
+                sums[order] += Zigzag(s - Predict(order, s1, s2, s3, s4));
+            }
+        }
+        s4 = s3;
+        s3 = s2;
+        s2 = s1;
+        s1 = s;
+    }
+    TUint64 bestBits = (TUint64)aSamples * aBitDepth;
+    for (TUint order=0; order<=kMaxOrder; order++) {
+        for (TUint k=0; k<=kMaxRiceParam; k++) {
+            const TUint64 bits = (order * aBitDepth) + ((TUint64)(aSamples - order) * (k+1)) + (sums[order] >> k);
+            if (bits < bestBits) {
+                bestBits = bits;
+                aOrder = order;
+                aRiceParam = k;
+            }
+        }
+    }
+}
+
+static inline TBool IsSupportedFormat(TUint aChannels, TUint aBitDepth)
+{
+    return (aChannels > 0 && aChannels <= OhmCodecLossless::kMaxChannels &&
+            (aBitDepth == 8 || aBitDepth == 16 || aBitDepth == 24));
+}
+
+
+// OhmCodecLossless
+
+const Brn OhmCodecLossless::kCodecName("OhmLossless1");
+
+void OhmCodecLossless::GetCodecName(const Brx& aCodecName, Bwx& aName)
+{ // static
+    aName.Replace(kCodecName);
+    aName.Append(':');
+    const TUint bytes = std::min(aCodecName.Bytes(), aName.MaxBytes() - aName.Bytes());
+    aName.Append(aCodecName.Ptr(), bytes);
+}
+
+TBool OhmCodecLossless::IsEncoded(const Brx& aName, Brn& aCodecName)
+{ // static
+    const TUint prefixBytes = kCodecName.Bytes();
+    if (aName.Bytes() <= prefixBytes || aName.Split(0, prefixBytes) != kCodecName || aName[prefixBytes] != ':') {
+        return false;
+    }
+    aCodecName.Set(aName.Ptr() + prefixBytes + 1, aName.Bytes() - prefixBytes - 1);
+    return true;
+}
+
+TBool OhmCodecLossless::TryEncode(const Brx& aPcm, TUint aChannels, TUint aBitDepth, Bwx& aEncoded)
+{ // static
+    if (!IsSupportedFormat(aChannels, aBitDepth)) {
+        return false;
+    }
+    const TUint bytesPerSample = aBitDepth / 8;
+    const TUint stride = bytesPerSample * aChannels;
+    if (aPcm.Bytes() == 0 || aPcm.Bytes() % stride != 0) {
+        return false;
+    }
+    const TUint samples = aPcm.Bytes() / stride;
+    // no point sending encoded audio unless it is smaller than the original
+    OhmBitWriter writer(const_cast<TByte*>(aEncoded.Ptr()), std::min(aEncoded.MaxBytes(), aPcm.Bytes() - 1));
+    for (TUint ch=0; ch<aChannels; ch++) {
+        const TByte* src = aPcm.Ptr() + (ch * bytesPerSample);
+        TUint order, k;
+        ChooseCoding(src, stride, bytesPerSample, samples, aBitDepth, order, k);
+        writer.Write((order << 5) | k, 8);
+        if (order == kOrderVerbatim) {
+            for (TUint i=0; i<samples; i++) {
+                writer.Write((TUint)ReadSample(src + i*stride, bytesPerSample), aBitDepth);
+            }
+        }
+        else {
+            const TUint mask = (1u << k) - 1;
+            TInt s1 = 0, s2 = 0, s3 = 0, s4 = 0;
+            for (TUint i=0; i<samples && !writer.Overflowed(); i++) {
+                const TInt s = ReadSample(src + i*stride, bytesPerSample);
+                if (i < order) {
+                    writer.Write((TUint)s, aBitDepth);
+                }
+                else {
+                    const TUint u = Zigzag(s - Predict(order, s1, s2, s3, s4));
+                    const TUint q = u >> k;
+                    if (q < kRiceEscape) {
+                        writer.WriteZeros(q);
+                        writer.Write((1u << k) | (u & mask), k+1);
+                    }
+                    else {
+                        writer.WriteZeros(kRiceEscape);
+                        writer.Write(u, 32);
+                    }
+                }
+                s4 = s3;
+                s3 = s2;
+                s2 = s1;
+                s1 = s;
+            }
+        }
+        if (writer.Overflowed()) {
+            return false;
+        }
+    }
+    if (!writer.Flush()) {
+        return false;
+    }
+    aEncoded.SetBytes(writer.Bytes());
+    return true;
+}
+
+TBool OhmCodecLossless::TryDecode(const Brx& aEncoded, TUint aSamples, TUint aChannels, TUint aBitDepth, Bwx& aPcm)
+{ // static
+    if (!IsSupportedFormat(aChannels, aBitDepth)) {
+        return false;
+    }
+    const TUint bytesPerSample = aBitDepth / 8;
+    const TUint stride = bytesPerSample * aChannels;
+    if (aSamples > aPcm.MaxBytes() / stride) {
+        return false;
+    }
+    TByte* pcm = const_cast<TByte*>(aPcm.Ptr());
+    OhmBitReader reader(aEncoded);
+    for (TUint ch=0; ch<aChannels; ch++) {
+        TByte* dst = pcm + (ch * bytesPerSample);
+        const TUint header = reader.Read(8);
+        const TUint order = header >> 5;
+        const TUint k = header & 0x1f;
+        if (order == kOrderVerbatim) {
+            for (TUint i=0; i<aSamples; i++) {
+                WriteSample(dst + i*stride, bytesPerSample, SignExtend(reader.Read(aBitDepth), aBitDepth));
+            }
+        }
+        else {
+            if (order > kMaxOrder || order > aSamples || k > kMaxRiceParam) {
+                return false;
+            }
+            TInt s1 = 0, s2 = 0, s3 = 0, s4 = 0;
+            for (TUint i=0; i<aSamples && !reader.Error(); i++) {
+                TInt s;
+                if (i < order) {
+                    s = SignExtend(reader.Read(aBitDepth), aBitDepth);
+                }
+                else {
+                    TUint q = 0;
+                    while (q < kRiceEscape && reader.Read(1) == 0 && !reader.Error()) {
+                        q++;
+                    }
+                    const TUint u = (q < kRiceEscape? ((q << k) | reader.Read(k)) : reader.Read(32));
+                    // corrupt data may give any value; truncating keeps s within aBitDepth bits
+                    const TInt64 value = (TInt64)Predict(order, s1, s2, s3, s4) + Unzigzag(u);
+                    s = SignExtend((TUint)value, aBitDepth);
+                }
+                WriteSample(dst + i*stride, bytesPerSample, s);
+                s4 = s3;
+                s3 = s2;
+                s2 = s1;
+                s1 = s;
+            }
+        }
+        if (reader.Error()) {
+            return false;
+        }
+    }
+    // all of aEncoded should have been used, apart from any padding in its final byte
+    if (reader.BytesConsumed() != aEncoded.Bytes()) {
+        return false;
+    }
+    aPcm.SetBytes(aSamples * stride);
+    return true;
+}
+
+
+// OhmBitWriter
+
+OhmBitWriter::OhmBitWriter(TByte* aPtr, TUint aMaxBytes)
+    : iPtr(aPtr)
+    , iMaxBytes(aMaxBytes)
+    , iBytes(0)
+    , iAcc(0)
+    , iAccBits(0)
+    , iOverflowed(false)
+{
+}
+
+void OhmBitWriter::Write(TUint aValue, TUint aBits)
+{
+    if (aBits == 0) {
+        return;
+    }
+    iAcc = (iAcc << aBits) | (aValue & (TUint)((1ull << aBits) - 1));
+    iAccBits += aBits;
+    while (iAccBits >= 8) {
+        iAccBits -= 8;
+        WriteByte((TByte)(iAcc >> iAccBits));
+    }
+}
+
+void OhmBitWriter::WriteZeros(TUint aBits)
+{
+    while (aBits > 0) {
+        const TUint bits = std::min(aBits, 32u);
+        Write(0, bits);
+        aBits -= bits;
+    }
+}
+
+TBool OhmBitWriter::Flush()
+{
+    if (iAccBits > 0) {
+        Write(0, 8 - iAccBits);
+    }
+    return !iOverflowed;
+}
+
+TBool OhmBitWriter::Overflowed() const
+{
+    return iOverflowed;
+}
+
+TUint OhmBitWriter::Bytes() const
+{
+    return iBytes;
+}
+
+void OhmBitWriter::WriteByte(TByte aByte)
+{
+    if (iBytes == iMaxBytes) {
+        iOverflowed = true;
+    }
+    else {
+        iPtr[iBytes++] = aByte;
+    }
+}
+
+
+// OhmBitReader
+
+OhmBitReader::OhmBitReader(const Brx& aBuf)
+    : iPtr(aBuf.Ptr())
+    , iBytes(aBuf.Bytes())
+    , iPos(0)
+    , iAcc(0)
+    , iAccBits(0)
+    , iError(false)
+{
+}
+
+TUint OhmBitReader::Read(TUint aBits)
+{
+    if (aBits == 0) {
+        return 0;
+    }
+    while (iAccBits < aBits) {
+        if (iPos == iBytes) {
+            iError = true;
+            return 0;
+        }
+        iAcc = (iAcc << 8) | iPtr[iPos++];
+        iAccBits += 8;
+    }
+    iAccBits -= aBits;
+    return (TUint)((iAcc >> iAccBits) & ((1ull << aBits) - 1));
+}
+
+TBool OhmBitReader::Error() const
+{
+    return iError;
+}
+
+TUint OhmBitReader::BytesConsumed() const
+{
+    return iPos;
+}
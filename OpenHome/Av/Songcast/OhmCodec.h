@@ -0,0 +1,54 @@
+#pragma once
+
+#include <OpenHome/Types.h>
+#include <OpenHome/Buffer.h>
+
+namespace OpenHome {
+namespace Av {
+
+/*
+Fast lossless coder for the audio carried by a single OhmMsgAudio.
+
+Each channel is predicted using the best of FLAC's fixed polynomial predictors (orders 0-4)
+and the residuals Rice coded.  Frames are coded independently so a lost frame never affects
+its neighbours and resent frames can be decoded in any order.
+
+Audio msgs using this coder have kCodecName prefixed to their codec name.  Receivers
+advertise support for it in the payload of their join/listen msgs (see OhmHeaderListen);
+senders only use it when all of their receivers can decode it.
+*/
+
+class OhmCodecLossless
+{
+public:
+    static const Brn kCodecName;
+    static const TUint kMaxChannels = 8;
+public:
+    /**
+     * Set aName to the codec name for an encoded stream whose audio was originally aCodecName.
+     *
+     * aName is truncated if it is too short to hold the full name.
+     */
+    static void GetCodecName(const Brx& aCodecName, Bwx& aName);
+    /**
+     * @return     true if aName was generated by GetCodecName(); aCodecName is then set to the
+     *             name of the original codec.
+     */
+    static TBool IsEncoded(const Brx& aName, Brn& aCodecName);
+    /**
+     * Encode big endian, interleaved PCM.
+     *
+     * @return     false if the encoded audio would be no smaller than aPcm or the format isn't
+     *             supported.  aPcm should be sent unencoded in this case.
+     */
+    static TBool TryEncode(const Brx& aPcm, TUint aChannels, TUint aBitDepth, Bwx& aEncoded);
+    /**
+     * Decode audio that was encoded by TryEncode().
+     *
+     * @return     false if aEncoded is corrupt or aPcm is too small to hold aSamples samples.
+     */
+    static TBool TryDecode(const Brx& aEncoded, TUint aSamples, TUint aChannels, TUint aBitDepth, Bwx& aPcm);
+};
+
+} // namespace Av
+} // namespace OpenHome
@@ -84,6 +84,7 @@ OhmMsgAudio::OhmMsgAudio(OhmMsgFactory& aFactory)
 void OhmMsgAudio::Create()
 {
     OhmMsgTimestamped::Create();
+    iAudio.Set(iUnifiedBuffer.Ptr() + kStreamHeaderBytes, 0, kMaxSampleBytes);
 }
 
 void OhmMsgAudio::Create(IReader& aReader, const OhmHeader& aHeader)
@@ -113,7 +114,47 @@ void OhmMsgAudio::Create(IReader& aReader, const OhmHeader& aHeader)
         iCodec.Replace(Brx::Empty());
     }
 
-    ReaderBuffer rb(audioHeaderBuf);
+    InternaliseHeader(audioHeaderBuf);
+    
+    const TUint audioBytes = aHeader.MsgBytes() - kHeaderBytes - codecBytes;
+    iAudio.Set(iUnifiedBuffer.Ptr() + kStreamHeaderBytes, audioBytes);
+    reader.ReadReplace(audioBytes, iAudio);
+    iUnifiedBuffer.SetBytes(iUnifiedBuffer.Bytes() + iAudio.Bytes());
+    iHeaderSerialised = true;
+}
+
+void OhmMsgAudio::Create(const OhmHeader& aHeader)
+{
+    // iUnifiedBuffer already holds the whole datagram, starting with aHeader (see OhmMsgReader)
+    static const TUint kCodecOffset = OhmHeader::kHeaderBytes + kHeaderBytes;
+    if ((aHeader.MsgType() != OhmHeader::kMsgTypeAudio && aHeader.MsgType() != OhmHeader::kMsgTypeAudioBlob) ||
+        aHeader.MsgBytes() < kHeaderBytes || OhmHeader::kHeaderBytes + aHeader.MsgBytes() > iUnifiedBuffer.Bytes()) {
+        THROW(OhmError);
+    }
+    const TUint codecBytes = iUnifiedBuffer[kCodecOffset - 1];
+    if (iUnifiedBuffer[OhmHeader::kHeaderBytes] != kHeaderBytes || iUnifiedBuffer[kCodecOffset - 2] != kReserved ||
+        codecBytes > kMaxCodecBytes || kHeaderBytes + codecBytes > aHeader.MsgBytes()) {
+        THROW(OhmError);
+    }
+
+    OhmMsgTimestamped::Create();
+    InternaliseHeader(iUnifiedBuffer.Split(OhmHeader::kHeaderBytes, kHeaderBytes));
+    iCodec.Replace(iUnifiedBuffer.Split(kCodecOffset, codecBytes));
+    const TUint audioBytes = aHeader.MsgBytes() - kHeaderBytes - codecBytes;
+    iAudio.Set(iUnifiedBuffer.Ptr() + kCodecOffset + codecBytes, audioBytes, audioBytes);
+    iStreamHeaderOffset = 0;
+    iUnifiedBuffer.SetBytes(AudioEnd());
+    iHeaderSerialised = true;
+}
+
+Bwx& OhmMsgAudio::ReceiveBuffer()
+{
+    return iUnifiedBuffer;
+}
+
+void OhmMsgAudio::InternaliseHeader(const Brx& aHeader)
+{
+    ReaderBuffer rb(aHeader);
     ReaderBinary reader2(rb);
     const TUint headerBytes = reader2.ReadUintBe(1);
     ASSERT(headerBytes == kHeaderBytes);
@@ -154,12 +195,11 @@ void OhmMsgAudio::Create(IReader& aReader, const OhmHeader& aHeader)
     iChannels = reader2.ReadUintBe(1);
     const TUint reserved = reader2.ReadUintBe(1);
     ASSERT (reserved == kReserved);
-    
-    const TUint audioBytes = aHeader.MsgBytes() - kHeaderBytes - codecBytes;
-    iAudio.Set(iUnifiedBuffer.Ptr() + kStreamHeaderBytes, audioBytes);
-    reader.ReadReplace(audioBytes, iAudio);
-    iUnifiedBuffer.SetBytes(iUnifiedBuffer.Bytes() + iAudio.Bytes());
-    iHeaderSerialised = true;
+}
+
+TUint OhmMsgAudio::AudioEnd() const
+{
+    return (TUint)(iAudio.Ptr() - iUnifiedBuffer.Ptr()) + iAudio.Bytes();
 }
 
 void OhmMsgAudio::Create(TBool aHalt, TBool aLossless, TBool aTimestamped, TBool aResent, TUint aSamples,
@@ -184,7 +224,7 @@ void OhmMsgAudio::Create(TBool aHalt, TBool aLossless, TBool aTimestamped, TBool
     iUnifiedBuffer.SetBytes(iStreamHeaderOffset);
     iUnifiedBuffer.Append(aStreamHeader);
     iUnifiedBuffer.Append(aAudio);
-    iAudio.SetBytes(aAudio.Bytes());
+    iAudio.Set(iUnifiedBuffer.Ptr() + kStreamHeaderBytes, aAudio.Bytes(), kMaxSampleBytes);
     iHeaderSerialised = false;
 }
 
@@ -344,7 +384,7 @@ void OhmMsgAudio::Process(IOhmMsgProcessor& aProcessor)
 void OhmMsgAudio::Externalise(IWriter& aWriter)
 {
     Serialise(); // prepends the ohm header, now ready to send!
-    iUnifiedBuffer.SetBytes(kStreamHeaderBytes+iAudio.Bytes());
+    iUnifiedBuffer.SetBytes(AudioEnd());
     aWriter.Write(iUnifiedBuffer.Split(iStreamHeaderOffset));
 }
 
@@ -407,7 +447,7 @@ void OhmMsgAudio::Serialise()
 
 Brn OhmMsgAudio::SendableBuffer()
 {
-    iUnifiedBuffer.SetBytes(kStreamHeaderBytes + iAudio.Bytes());
+    iUnifiedBuffer.SetBytes(AudioEnd());
     return iUnifiedBuffer.Split(iStreamHeaderOffset);
 }
 
@@ -538,6 +578,78 @@ void OhmMsgMetatext::Externalise(IWriter& aWriter)
 }
 
 
+// OhmMsgReader
+
+OhmMsgReader::OhmMsgReader(IOhmMsgFactory& aFactory, IReaderSource& aSource)
+    : iFactory(aFactory)
+    , iSource(aSource)
+    , iMsg(nullptr)
+    , iOffset(0)
+{
+}
+
+OhmMsgReader::~OhmMsgReader()
+{
+    if (iMsg != nullptr) {
+        iMsg->RemoveRef();
+    }
+}
+
+OhmMsgAudio* OhmMsgReader::CreateAudio(const OhmHeader& aHeader)
+{
+    if (iMsg == nullptr || iOffset != OhmHeader::kHeaderBytes) {
+        THROW(OhmError);
+    }
+    try {
+        iMsg->Create(aHeader);
+    }
+    catch (OhmError&) {
+        iOffset = iMsg->ReceiveBuffer().Bytes(); // discard the rest of the datagram
+        throw;
+    }
+    OhmMsgAudio* msg = iMsg;
+    iMsg = nullptr;
+    return msg;
+}
+
+Brn OhmMsgReader::Read(TUint aBytes)
+{
+    if (iMsg == nullptr) {
+        iMsg = iFactory.CreateAudio();
+        iMsg->ReceiveBuffer().SetBytes(0);
+        iOffset = 0;
+    }
+    Bwx& buf = iMsg->ReceiveBuffer();
+    if (iOffset == buf.Bytes()) {
+        // previous datagram has been consumed or flushed
+        buf.SetBytes(0);
+        iOffset = 0;
+        iSource.Read(buf);
+    }
+    if (buf.Bytes() - iOffset < aBytes) {
+        // msgs never span datagrams
+        iOffset = buf.Bytes();
+        THROW(OhmError);
+    }
+    Brn data(buf.Ptr() + iOffset, aBytes);
+    iOffset += aBytes;
+    return data;
+}
+
+void OhmMsgReader::ReadFlush()
+{
+    if (iMsg != nullptr) {
+        iOffset = iMsg->ReceiveBuffer().Bytes();
+    }
+    iSource.ReadFlush();
+}
+
+void OhmMsgReader::ReadInterrupt()
+{
+    iSource.ReadInterrupt();
+}
+
+
 // OhmMsgFactory
 
 OhmMsgFactory::OhmMsgFactory(TUint aAudioCount, TUint aTrackCount, TUint aMetatextCount)
@@ -4,6 +4,7 @@
 #include <OpenHome/Buffer.h>
 #include <OpenHome/Private/Thread.h>
 #include <OpenHome/Private/Fifo.h>
+#include <OpenHome/Private/Stream.h>
 #include <OpenHome/Media/Pipeline/Msg.h> // for kTrackMetaDataMaxBytes
 #include <OpenHome/Av/Songcast/Ohm.h>
 
@@ -62,6 +63,7 @@ private:
 class OhmMsgAudio : public OhmMsgTimestamped
 {
     friend class OhmMsgFactory;
+    friend class OhmMsgReader;
 public:
     static const TUint kMaxSampleBytes    = 5760; // 5ms of 192/24 stereo
     static const TUint kMaxCodecBytes     = 30-1;
@@ -71,6 +73,7 @@ public:
     static const TUint kFlagResent        = 1 << 3;
     static const TUint kFlagTimestamped2  = 1 << 4;
     static const TUint kStreamHeaderBytes = 88; // 8 bytes Ohm header, 50 bytes audio header, 30 bytes codec name
+    static const TUint kMaxDatagramBytes  = 6 * 1024; // any msg type may be received into an audio msg (see OhmMsgReader)
 private:
     static const TUint kHeaderBytes = 50; // not including codec name
     static const TUint kReserved    = 0;
@@ -115,6 +118,10 @@ private:
     void Create(TBool aHalt, TBool aLossless, TBool aTimestamped, TBool aResent, TUint aSamples, TUint aFrame,
                 TUint aNetworkTimestamp, TUint aMediaLatency, TUint64 aSampleStart, const Brx& aStreamHeader,
                 const Brx& aAudio);
+    void Create(const OhmHeader& aHeader);
+    Bwx& ReceiveBuffer();
+    void InternaliseHeader(const Brx& aHeader);
+    TUint AudioEnd() const;
 private:
     TBool iHalt;
     TBool iLossless;
@@ -134,7 +141,7 @@ private:
     TUint iBitDepth;
     TUint iChannels;
     Bws<kMaxCodecBytes> iCodec;
-    Bws<kStreamHeaderBytes+kMaxSampleBytes> iUnifiedBuffer;
+    Bws<kMaxDatagramBytes> iUnifiedBuffer;
     Bwn iAudio;
     TUint iStreamHeaderOffset;
     TBool iHeaderSerialised;
@@ -201,6 +208,34 @@ public:
     virtual OhmMsgMetatext* CreateMetatext(TUint aSequence, const Brx& aMetatext) = 0;
 };
 
+/*
+Reads Songcast datagrams from aSource directly into the buffer of an OhmMsgAudio.
+Audio msgs can then be created from the current datagram without copying their
+payload.  Other msg types are read from the same buffer in the usual way.
+*/
+class OhmMsgReader : public IReader, private INonCopyable
+{
+public:
+    OhmMsgReader(IOhmMsgFactory& aFactory, IReaderSource& aSource);
+    ~OhmMsgReader();
+    /**
+     * Create an audio msg from the current datagram.
+     *
+     * Must be called immediately after aHeader has been read.  The returned msg takes
+     * ownership of the datagram; the next call to Read() will receive a new one.
+     */
+    OhmMsgAudio* CreateAudio(const OhmHeader& aHeader);
+public: // from IReader
+    Brn Read(TUint aBytes) override;
+    void ReadFlush() override;
+    void ReadInterrupt() override;
+private:
+    IOhmMsgFactory& iFactory;
+    IReaderSource& iSource;
+    OhmMsgAudio* iMsg;
+    TUint iOffset;
+};
+
 class OhmMsgFactory : public IOhmMsgFactory, public IOhmMsgProcessor
 {
     friend class OhmMsg;
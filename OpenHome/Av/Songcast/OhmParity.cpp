@@ -0,0 +1,258 @@
+#include <OpenHome/Av/Songcast/OhmParity.h>
+#include <OpenHome/Types.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Private/Stream.h>
+#include <OpenHome/Av/Songcast/Ohm.h>
+
+#include <algorithm>
+
+using namespace OpenHome;
+using namespace OpenHome::Av;
+
+// OhmParity
+
+const Brn OhmParity::kFeatureName("OhmParity1");
+
+void OhmParity::XorMsg(Bwx& aParity, const Brx& aMsg)
+{ // static
+    static const TUint kFlagsOffset = OhmHeader::kHeaderBytes + 1;
+    ASSERT(aMsg.Bytes() <= aParity.MaxBytes());
+
+    const TUint common = std::min(aParity.Bytes(), aMsg.Bytes());
+    TByte* parity = const_cast<TByte*>(aParity.Ptr());
+    const TByte* msg = aMsg.Ptr();
+    for (TUint i=0; i<common; i++) {
+        parity[i] ^= msg[i];
+    }
+    if (aMsg.Bytes() > common) {
+        aParity.Append(aMsg.Split(common));
+    }
+    // resends of a msg are identical other than their resent flag; exclude it so they're interchangeable
+    if (aMsg.Bytes() > kFlagsOffset) {
+        parity[kFlagsOffset] ^= (msg[kFlagsOffset] & OhmHeaderAudio::kFlagResent);
+    }
+}
+
+
+// OhmParityEncoder
+
+OhmParityEncoder::OhmParityEncoder(TUint aFrames)
+    : iFrames(aFrames)
+    , iParity(OhmParity::kMaxMsgBytes)
+    , iParityMsg(OhmHeader::kHeaderBytes + OhmHeaderAudioParity::kHeaderBytes + OhmParity::kMaxMsgBytes)
+{
+    ASSERT(aFrames > 1 && aFrames <= OhmParity::kMaxFrames);
+    Reset();
+}
+
+void OhmParityEncoder::Reset()
+{
+    iParity.SetBytes(0);
+    iFirstFrame = 0;
+    iCount = 0;
+    iMsgBytesXor = 0;
+}
+
+TBool OhmParityEncoder::Add(TUint aFrame, const Brx& aMsg)
+{
+    if (iCount > 0 && aFrame != iFirstFrame + iCount) {
+        // frame numbers have restarted; abandon the current group
+        Reset();
+    }
+    if (iCount == 0) {
+        iFirstFrame = aFrame;
+    }
+    OhmParity::XorMsg(iParity, aMsg);
+    iMsgBytesXor ^= aMsg.Bytes();
+    if (++iCount < iFrames) {
+        return false;
+    }
+
+    OhmHeaderAudioParity headerParity(iFirstFrame, iCount, iMsgBytesXor, iParity.Bytes());
+    OhmHeader header(OhmHeader::kMsgTypeAudioParity, headerParity.MsgBytes());
+    iParityMsg.SetBytes(0);
+    WriterBuffer writer(iParityMsg);
+    header.Externalise(writer);
+    headerParity.Externalise(writer);
+    writer.Write(iParity);
+    Reset();
+    return true;
+}
+
+const Brx& OhmParityEncoder::ParityMsg() const
+{
+    return iParityMsg;
+}
+
+
+// OhmParityDecoder
+
+OhmParityDecoder::OhmParityDecoder()
+{
+    for (TUint i=0; i<kMaxGroups; i++) {
+        iGroups[i].iParity = new Bwh(OhmParity::kMaxMsgBytes);
+    }
+    Reset();
+}
+
+OhmParityDecoder::~OhmParityDecoder()
+{
+    for (TUint i=0; i<kMaxGroups; i++) {
+        delete iGroups[i].iParity;
+    }
+}
+
+void OhmParityDecoder::Reset()
+{
+    for (TUint i=0; i<kMaxGroups; i++) {
+        iGroups[i].iInUse = false;
+    }
+    iGroupFrames = 0;
+    iNextFirstFrame = 0;
+}
+
+TUint OhmParityDecoder::GroupFrames() const
+{
+    return iGroupFrames;
+}
+
+void OhmParityDecoder::Add(TUint aFrame, const Brx& aMsg)
+{
+    if (iGroupFrames == 0) {
+        return;
+    }
+    const TUint offset = aFrame - iNextFirstFrame;
+    if ((TInt)offset < 0) {
+        // parity msg for this frame's group has already been processed (or lost)
+        return;
+    }
+    if (offset >= kMaxGroups * iGroupFrames) {
+        // sender has stopped sending parity msgs or restarted its frame numbering
+        iGroupFrames = 0;
+        return;
+    }
+    if (aMsg.Bytes() > OhmParity::kMaxMsgBytes) {
+        return;
+    }
+    const TUint firstFrame = aFrame - (offset % iGroupFrames);
+    Group* group = FindGroup(firstFrame);
+    const TUint64 bit = (TUint64)1 << (aFrame - firstFrame);
+    if ((group->iReceived & bit) != 0) {
+        return;
+    }
+    group->iReceived |= bit;
+    group->iMsgBytesXor ^= aMsg.Bytes();
+    OhmParity::XorMsg(*group->iParity, aMsg);
+}
+
+TBool OhmParityDecoder::TryRecover(const OhmHeaderAudioParity& aHeader, const Brx& aParity, Bwx& aMsg, TUint& aFrame)
+{
+    const TUint frames = aHeader.FrameCount();
+    const TUint firstFrame = aHeader.FirstFrame();
+    if (frames < 2 || frames > OhmParity::kMaxFrames || aParity.Bytes() > OhmParity::kMaxMsgBytes) {
+        return false;
+    }
+    if (frames != iGroupFrames) {
+        // first parity msg or the sender has changed its group size
+        for (TUint i=0; i<kMaxGroups; i++) {
+            iGroups[i].iInUse = false;
+        }
+        iGroupFrames = frames;
+    }
+    else if ((TInt)(firstFrame - iNextFirstFrame) < 0) {
+        return false; // stale parity msg
+    }
+
+    Group* group = nullptr;
+    for (TUint i=0; i<kMaxGroups; i++) {
+        if (iGroups[i].iInUse && iGroups[i].iFirstFrame == firstFrame) {
+            group = &iGroups[i];
+            break;
+        }
+    }
+    iNextFirstFrame = firstFrame + frames;
+    if (group == nullptr) {
+        ReleaseGroups();
+        return false;
+    }
+    group->iInUse = false;
+    ReleaseGroups();
+
+    const TUint64 all = (frames == 64? ~(TUint64)0 : ((TUint64)1 << frames) - 1);
+    const TUint64 missing = all & ~group->iReceived;
+    if (missing == 0 || (missing & (missing - 1)) != 0) {
+        return false; // nothing to recover or more than one msg lost
+    }
+    const Bwx& partial = *group->iParity;
+    const TUint msgBytes = aHeader.MsgBytesXor() ^ group->iMsgBytesXor;
+    if (msgBytes < OhmHeader::kHeaderBytes || msgBytes > aParity.Bytes() ||
+        partial.Bytes() > aParity.Bytes() || msgBytes > aMsg.MaxBytes()) {
+        return false;
+    }
+    const TByte* parity = aParity.Ptr();
+    // every byte beyond the end of the missing msg should cancel out
+    for (TUint i=std::max(msgBytes, partial.Bytes()); i<aParity.Bytes(); i++) {
+        if (parity[i] != 0) {
+            return false;
+        }
+    }
+    for (TUint i=msgBytes; i<partial.Bytes(); i++) {
+        if (parity[i] != partial[i]) {
+            return false;
+        }
+    }
+    aMsg.Replace(aParity.Split(0, msgBytes));
+    TByte* msg = const_cast<TByte*>(aMsg.Ptr());
+    const TByte* other = partial.Ptr();
+    const TUint common = std::min(msgBytes, partial.Bytes());
+    for (TUint i=0; i<common; i++) {
+        msg[i] ^= other[i];
+    }
+
+    TUint index = 0;
+    for (TUint64 bit=missing; bit>1; bit>>=1) {
+        index++;
+    }
+    aFrame = firstFrame + index;
+    return true;
+}
+
+OhmParityDecoder::Group* OhmParityDecoder::FindGroup(TUint aFirstFrame)
+{
+    Group* unused = nullptr;
+    for (TUint i=0; i<kMaxGroups; i++) {
+        Group& group = iGroups[i];
+        if (!group.iInUse) {
+            unused = &group;
+        }
+        else if (group.iFirstFrame == aFirstFrame) {
+            return &group;
+        }
+    }
+    // Add() only accepts frames from the kMaxGroups groups following iNextFirstFrame
+    // and ReleaseGroups() frees any others (including any not aligned with iNextFirstFrame)
+    // so there is always a slot available
+    ASSERT(unused != nullptr);
+    unused->iInUse = true;
+    unused->iFirstFrame = aFirstFrame;
+    unused->iReceived = 0;
+    unused->iMsgBytesXor = 0;
+    unused->iParity->SetBytes(0);
+    return unused;
+}
+
+void OhmParityDecoder::ReleaseGroups()
+{
+    for (TUint i=0; i<kMaxGroups; i++) {
+        Group& group = iGroups[i];
+        if (!group.iInUse) {
+            continue;
+        }
+        // a parity msg that is out of step with earlier groups (the sender restarted its
+        // encoder or skipped frames) leaves them unrecoverable
+        const TUint offset = group.iFirstFrame - iNextFirstFrame;
+        if (offset >= kMaxGroups * iGroupFrames || offset % iGroupFrames != 0) {
+            group.iInUse = false;
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <OpenHome/Types.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Private/Standard.h>
+
+namespace OpenHome {
+namespace Av {
+
+class OhmHeaderAudioParity;
+
+/*
+Forward error correction for Songcast audio.
+
+A sender may follow each group of consecutive audio msgs with a parity msg holding the XOR
+of the group's msgs.  A receiver that has all but one msg from a group can then rebuild the
+missing msg itself rather than requesting a resend.  Parity covers each audio msg as it was
+first sent, i.e. with its resent flag clear, so resent msgs still contribute to a group.
+
+Receivers advertise support for parity msgs in the payload of their join/listen msgs (see
+OhmHeaderListen); senders only send them while all of their receivers support them.
+*/
+
+class OhmParity
+{
+public:
+    static const Brn kFeatureName;
+    static const TUint kMaxFrames = 64;
+    static const TUint kMaxMsgBytes = 6 * 1024;
+public:
+    static void XorMsg(Bwx& aParity, const Brx& aMsg);
+};
+
+class OhmParityEncoder : private INonCopyable
+{
+public:
+    OhmParityEncoder(TUint aFrames);
+    void Reset();
+    /**
+     * Add the next audio msg to be sent.
+     *
+     * @return     true if aMsg completed a group.  ParityMsg() should then be sent.
+     */
+    TBool Add(TUint aFrame, const Brx& aMsg);
+    const Brx& ParityMsg() const;
+private:
+    const TUint iFrames;
+    Bwh iParity;
+    Bwh iParityMsg;
+    TUint iFirstFrame;
+    TUint iCount;
+    TUint iMsgBytesXor;
+};
+
+class OhmParityDecoder : private INonCopyable
+{
+    static const TUint kMaxGroups = 3;
+public:
+    OhmParityDecoder();
+    ~OhmParityDecoder();
+    void Reset();
+    /**
+     * @return     number of frames in each group, or 0 if parity msgs aren't being received.
+     */
+    TUint GroupFrames() const;
+    /**
+     * Note an audio msg that has been received.  Duplicates are ignored.
+     */
+    void Add(TUint aFrame, const Brx& aMsg);
+    /**
+     * Attempt to rebuild a msg following receipt of a parity msg.
+     *
+     * @return     true if the only msg missing from aHeader's group was written to aMsg.
+     */
+    TBool TryRecover(const OhmHeaderAudioParity& aHeader, const Brx& aParity, Bwx& aMsg, TUint& aFrame);
+private:
+    struct Group
+    {
+        TBool iInUse;
+        TUint iFirstFrame;
+        TUint64 iReceived; // bitmask, lsb is iFirstFrame
+        TUint iMsgBytesXor;
+        Bwh* iParity;
+    };
+    Group* FindGroup(TUint aFirstFrame);
+    void ReleaseGroups();
+private:
+    Group iGroups[kMaxGroups];
+    TUint iGroupFrames;
+    TUint iNextFirstFrame; // first frame of the group following the last parity msg
+};
+
+} // namespace Av
+} // namespace OpenHome
@@ -9,6 +9,7 @@
 #include <OpenHome/Av/Debug.h>
 #include <OpenHome/Av/Songcast/ZoneHandler.h>
 #include <OpenHome/Av/Songcast/OhmTimestamp.h>
+#include <OpenHome/Av/Songcast/OhmCodec.h>
 #include <OpenHome/Private/NetworkAdapterList.h>
 #include <OpenHome/Net/Core/OhNet.h>
 #include <OpenHome/Media/Pipeline/Msg.h>
@@ -304,11 +305,16 @@ OhmSenderDriver::OhmSenderDriver(Environment& aEnv, Optional<IOhmTimestamper> aT
     , iSampleRate(0)
     , iTimestampMultiplier(0)
     , iBytesPerSample(0)
+    , iChannels(0)
+    , iBitDepth(0)
+    , iCompress(false)
     , iLossless(false)
     , iSamplesTotal(0)
     , iSampleStart(0)
     , iLatencyMs(0)
     , iLatencyOhm(0)
+    , iParity(false)
+    , iParityEncoder(kParityFrames)
     , iSocket(aEnv)
     , iFactory(110, 10, 10) // FIXME - rationale for msg counts??
     , iTimestamper(aTimestamper.Ptr())
@@ -329,11 +335,17 @@ void OhmSenderDriver::SetAudioFormat(TUint aSampleRate, TUint aBitRate, TUint aC
     iTimestampMultiplier = Media::Jiffies::SongcastTicksPerSecond(aSampleRate);
     UpdateLatencyOhm();
     iBytesPerSample = aChannels * aBitDepth / 8;
+    iChannels = aChannels;
+    iBitDepth = aBitDepth;
     iLossless = aLossless;
     iSampleStart = aSampleStart;
 
     iStreamHeader.Replace(Brx::Empty());
     OhmMsgAudio::GetStreamHeader(iStreamHeader, iSamplesTotal, aSampleRate, aBitRate, 0/*VolumeOffset*/, aBitDepth, aChannels, aCodecName);
+    Bws<OhmMsgAudio::kMaxCodecBytes> codecCompressed;
+    OhmCodecLossless::GetCodecName(aCodecName, codecCompressed);
+    iStreamHeaderCompressed.Replace(Brx::Empty());
+    OhmMsgAudio::GetStreamHeader(iStreamHeaderCompressed, iSamplesTotal, aSampleRate, aBitRate, 0/*VolumeOffset*/, aBitDepth, aChannels, codecCompressed);
 
     if (iTimestamper != nullptr) {
         // ignore return value below - false just implies iTimestamper->Timestamp will throw
@@ -387,6 +399,11 @@ void OhmSenderDriver::SendAudio(const TByte* aData, TUint aBytes, TBool aHalt)
         catch (OhmTimestampNotFound&) {}
     }
 
+    Brn audio(aData, aBytes);
+    const TBool compressed = TryCompress(audio, samples);
+    if (compressed) {
+        audio.Set(iCompressed);
+    }
     OhmMsgAudio* msg = iFactory.CreateAudio(
         aHalt,
         iLossless,
@@ -397,8 +414,8 @@ void OhmSenderDriver::SendAudio(const TByte* aData, TUint aBytes, TBool aHalt)
         timeStamp, // network timestamp
         iLatencyOhm,
         iSampleStart,
-        iStreamHeader,
-        Brn(aData, aBytes)
+        compressed? iStreamHeaderCompressed : iStreamHeader,
+        audio
     );
 
     msg->Serialise();
@@ -408,6 +425,7 @@ void OhmSenderDriver::SendAudio(const TByte* aData, TUint aBytes, TBool aHalt)
     }
     catch (NetworkError&) {
     }
+    SendParity(msg->SendableBuffer());
 
     msg->SetResent(true);
     iSampleStart += samples;
@@ -452,6 +470,10 @@ void OhmSenderDriver::SendAudio(OhmMsgAudio* aMsg, TBool aHalt)
         catch (OhmTimestampNotFound&) {}
     }
 
+    const TBool compressed = TryCompress(aMsg->Audio(), samples);
+    if (compressed) {
+        aMsg->Audio().Replace(iCompressed);
+    }
     aMsg->ReinitialiseFields(
         aHalt,
         iLossless,
@@ -462,7 +484,7 @@ void OhmSenderDriver::SendAudio(OhmMsgAudio* aMsg, TBool aHalt)
         timeStamp, // network timestamp
         iLatencyOhm,
         iSampleStart,
-        iStreamHeader
+        compressed? iStreamHeaderCompressed : iStreamHeader
     );
 
     aMsg->Serialise();
@@ -472,6 +494,7 @@ void OhmSenderDriver::SendAudio(OhmMsgAudio* aMsg, TBool aHalt)
     }
     catch (NetworkError&) {
     }
+    SendParity(aMsg->SendableBuffer());
 
     aMsg->SetResent(true);
     iSampleStart += samples;
@@ -546,6 +569,42 @@ void OhmSenderDriver::SetTrackPosition(TUint64 aSamplesTotal, TUint64 aSampleSta
     iSampleStart = aSampleStart;
 }
 
+void OhmSenderDriver::SetLosslessCompression(TBool aValue)
+{
+    AutoMutex mutex(iMutex);
+    iCompress = aValue;
+}
+
+void OhmSenderDriver::SetParity(TBool aValue)
+{
+    AutoMutex mutex(iMutex);
+    if (aValue != iParity) {
+        iParity = aValue;
+        iParityEncoder.Reset();
+    }
+}
+
+void OhmSenderDriver::SendParity(const Brx& aMsg)
+{
+    if (!iParity || !iParityEncoder.Add(iFrame, aMsg)) {
+        return;
+    }
+    try {
+        iSocket.Send(iParityEncoder.ParityMsg(), iEndpoint);
+    }
+    catch (NetworkError&) {
+    }
+}
+
+TBool OhmSenderDriver::TryCompress(const Brx& aAudio, TUint aSamples)
+{
+    if (!iCompress || aSamples == 0) {
+        return false;
+    }
+    // falls back to PCM if compression wouldn't reduce the size of this frame
+    return OhmCodecLossless::TryEncode(aAudio, iChannels, iBitDepth, iCompressed);
+}
+
 void OhmSenderDriver::Resend(OhmMsgAudio& aMsg)
 {
     try {
@@ -616,6 +675,7 @@ void OhmSenderDriver::ResetLocked()
     iSend = false;
     iFrame = 0;
     iFirstFrame = true;
+    iParityEncoder.Reset();
     if (iTimestamper != nullptr) {
         iTimestamper->Stop();
     }
@@ -642,6 +702,7 @@ OhmSender::OhmSender(Environment& aEnv, Net::DvDeviceStandard& aDevice, IOhmSend
     , iMulticast(aMulticast)
     , iEnabled(false)
     , iUnicastOverride(false)
+    , iUnicastChaining(false)
     , iSocketOhm(aEnv)
     , iRxBuffer(iSocketOhm)
     , iMutexStartStop("OHMS")
@@ -652,6 +713,8 @@ OhmSender::OhmSender(Environment& aEnv, Net::DvDeviceStandard& aDevice, IOhmSend
     , iActive(false)
     , iAliveJoined(false)
     , iAliveBlocked(false)
+    , iListenerNoCompression(false)
+    , iListenerNoParity(false)
     , iSequenceTrack(0)
     , iSequenceMetatext(0)
     , iClientControllingTrackMetadata(false)
@@ -938,6 +1001,23 @@ void OhmSender::EnableUnicastOverride(TBool aEnable)
     }
 }
 
+void OhmSender::SetUnicastChaining(TBool aValue)
+{
+    AutoMutex mutex(iMutexStartStop);
+
+    if (iUnicastChaining != aValue) {
+        if (iStarted) {
+            // restart so that receivers rejoin and no stale slave lists remain in use
+            Stop();
+            iUnicastChaining = aValue;
+            Start();
+        }
+        else {
+            iUnicastChaining = aValue;
+        }
+    }
+}
+
 //  This runs a little state machine where the current state is reflected by:
 //
 //  iAliveJoined: Indicates that someone is listening to us (we received a join recently)
@@ -966,6 +1046,7 @@ void OhmSender::RunMulticast()
                         LOG(kSongcast, "OhmSender::RunMulticast join/listen received\n");
                         
                         AutoMutex mutex(iMutexActive);
+                        UpdateListenerFeatures(header, !iAliveJoined, true);
                         
                         if (header.MsgType() == OhmHeader::kMsgTypeJoin) {
                             SendTrack();
@@ -1067,6 +1148,7 @@ void OhmSender::RunUnicast()
                         
                         if (header.MsgType() <= OhmHeader::kMsgTypeListen) {
                             LOG(kSongcast, "OhmSender::RunUnicast ready/join or listen (%u)\n", header.MsgType());
+                            UpdateListenerFeatures(header, true, false);
                             break;                        
                         }
                     }
@@ -1100,6 +1182,7 @@ void OhmSender::RunUnicast()
                         
                         if (header.MsgType() == OhmHeader::kMsgTypeJoin) {
                             LOG(kSongcast, "OhmSender::RunUnicast sending/join\n");
+                            UpdateListenerFeatures(header, false, false);
                             Endpoint sender(iSocketOhm.Sender());
                             if (sender.Equals(iTargetEndpoint)) {
                                 iTimerExpiry->FireIn(kTimerExpiryTimeoutMs);
@@ -1107,7 +1190,7 @@ void OhmSender::RunUnicast()
                             else {
                                 TUint slave = FindSlave(sender);
                                 if (slave >= iSlaveCount) {
-                                    if (slave < kMaxSlaveCount) {
+                                    if (slave < MaxSlaveCount()) {
                                         iSlaveList[slave].Replace(sender);
                                         iSlaveExpiry[slave] = Time::Now(iEnv) + kTimerExpiryTimeoutMs;
                                         iSlaveCount++;
@@ -1131,6 +1214,7 @@ void OhmSender::RunUnicast()
                             SendMetatext();
                         }
                         else if (header.MsgType() == OhmHeader::kMsgTypeListen) {
+                            UpdateListenerFeatures(header, false, false);
                             Endpoint sender(iSocketOhm.Sender());
 
                             Endpoint::EndpointBuf endptBuf;
@@ -1151,7 +1235,7 @@ void OhmSender::RunUnicast()
                                 }
                                 else {
                                     // unknown slave, probably temporarily physically disconnected receiver
-                                    if (slave < kMaxSlaveCount) {
+                                    if (slave < MaxSlaveCount()) {
                                         iSlaveList[slave].Replace(sender);
                                         iSlaveExpiry[slave] = Time::Now(iEnv) + kTimerExpiryTimeoutMs;
                                         iSlaveCount++;
@@ -1249,6 +1333,29 @@ void OhmSender::RunUnicast()
     }
 }
 
+void OhmSender::UpdateListenerFeatures(const OhmHeader& aHeader, TBool aFirstListener, TBool aMulticast)
+{
+    // Optional features are only used while every receiver supports them.  Older receivers are
+    // remembered until all listeners have gone as, on a multicast channel, they stop sending
+    // listen msgs while they can hear another receiver doing so.
+    // Parity msgs are only worth sending on a multicast channel, where a single msg can
+    // save repair requests from many receivers.
+    OhmHeaderListen headerListen;
+    headerListen.Internalise(iRxBuffer, aHeader);
+    if (aFirstListener) {
+        iListenerNoCompression = false;
+        iListenerNoParity = false;
+    }
+    if (!headerListen.SupportsFeature(OhmCodecLossless::kCodecName)) {
+        iListenerNoCompression = true;
+    }
+    if (!headerListen.SupportsFeature(OhmParity::kFeatureName)) {
+        iListenerNoParity = true;
+    }
+    iDriver.SetLosslessCompression(!iListenerNoCompression);
+    iDriver.SetParity(aMulticast && !iListenerNoParity);
+}
+
 void OhmSender::TimerAliveJoinExpired()
 {
     LOG(kSongcast, "AliveJoin timer expired\n");
@@ -1399,18 +1506,47 @@ void OhmSender::SendMetatext()
 void OhmSender::SendSlaveList()
 {
     // called with alive mutex locked;
-    OhmHeaderSlave headerSlave(iSlaveCount);
+    // The target receiver forwards all audio to the slaves listed here.  With chaining enabled,
+    // slaves also forward to slaves of their own, forming a tree rooted at the target: node 0 is
+    // the target, node n is iSlaveList[n-1] and node n's slaves are nodes (n*kMaxSlavesPerReceiver)+1
+    // onwards.  Lists are sent deepest first so that a slave moved by RemoveSlave() is dropped by
+    // its old parent before being added by its new one - receivers treat a duplicate frame as the
+    // sender restarting.
+    if (iUnicastChaining) {
+        for (TUint i = iSlaveCount; i > 0; i--) {
+            SendSlaveList(iSlaveList[i - 1], i);
+        }
+    }
+    SendSlaveList(iTargetEndpoint, 0);
+}
+
+void OhmSender::SendSlaveList(const Endpoint& aEndpoint, TUint aNode)
+{
+    // called with alive mutex locked;
+    TUint first = aNode * kMaxSlavesPerReceiver;
+    TUint count = 0;
+    if (first < iSlaveCount) {
+        count = iSlaveCount - first;
+        if (count > kMaxSlavesPerReceiver) {
+            count = kMaxSlavesPerReceiver;
+        }
+    }
+    OhmHeaderSlave headerSlave(count);
     OhmHeader header(OhmHeader::kMsgTypeSlave, headerSlave.MsgBytes());
     WriterBuffer writer(iTxBuffer);
     writer.Flush();
     header.Externalise(writer);
     headerSlave.Externalise(writer);
     WriterBinary binary(writer);
-    for (TUint i = 0; i < iSlaveCount; i++) {
+    for (TUint i = first; i < first + count; i++) {
         binary.WriteUint32Be(iSlaveList[i].Address());
         binary.WriteUint16Be(iSlaveList[i].Port());
     }
-    Send();
+    try {
+        iSocketOhm.Send(iTxBuffer, aEndpoint);
+    }
+    catch (NetworkError&) {
+    }
 }
 
 void OhmSender::SendListen(const Endpoint& aEndpoint)
@@ -1464,11 +1600,21 @@ TBool OhmSender::CheckSlaveExpiry()
 
 void OhmSender::RemoveSlave(TUint aIndex)
 {
+    // fill the gap with the last slave so that, when chaining, no other slave changes position
     iSlaveCount--;
-    for (TUint i = aIndex; i < iSlaveCount; i++) {
-        iSlaveList[i].Replace(iSlaveList[i + 1]);
-        iSlaveExpiry[i] = iSlaveExpiry[i + 1];
+    if (aIndex < iSlaveCount) {
+        iSlaveList[aIndex].Replace(iSlaveList[iSlaveCount]);
+        iSlaveExpiry[aIndex] = iSlaveExpiry[iSlaveCount];
+    }
+}
+
+TUint OhmSender::MaxSlaveCount() const
+{
+    // without chaining, only the target forwards audio
+    if (iUnicastChaining) {
+        return kMaxSlaveCount;
     }
+    return kMaxSlavesPerReceiver;
 }
 
 // Returns index of supplied endpoint, or index of empty slot if not found
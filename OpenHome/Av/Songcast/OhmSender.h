@@ -15,6 +15,7 @@
 #include "OhmMsg.h"
 #include "OhmSocket.h"
 #include "OhmSenderDriver.h"
+#include "OhmParity.h"
 
 namespace OpenHome {
 class Environment;
@@ -27,6 +28,7 @@ class OhmSenderDriver : public IOhmSenderDriver
 {
     static const TUint kMaxAudioFrameBytes = 6 * 1024;
     static const TUint kMaxHistoryFrames = 100;
+    static const TUint kParityFrames = 8;
 public:
     OhmSenderDriver(Environment& aEnv, Optional<IOhmTimestamper> aTimestamper);
     void SetAudioFormat(TUint aSampleRate, TUint aBitRate, TUint aChannels, TUint aBitDepth, TBool aLossless, const Brx& aCodecName, TUint64 aSampleStart);
@@ -41,10 +43,14 @@ private: // from IOhmSenderDriver
     void SetLatency(TUint aValue) override;
     void SetTrackPosition(TUint64 aSampleStart, TUint64 aSamplesTotal) override;
     void Resend(const Brx& aFrames) override;
+    void SetLosslessCompression(TBool aValue) override;
+    void SetParity(TBool aValue) override;
 private:
     inline void UpdateLatencyOhm();
+    TBool TryCompress(const Brx& aAudio, TUint aSamples);
     void ResetLocked();
     void Resend(OhmMsgAudio& aMsg);
+    void SendParity(const Brx& aMsg);
 private:
     Mutex iMutex;
     TBool iEnabled;
@@ -53,15 +59,22 @@ private:
     Endpoint iEndpoint;
     TIpAddress iAdapter;
     Bws<OhmMsgAudio::kStreamHeaderBytes> iStreamHeader;
+    Bws<OhmMsgAudio::kStreamHeaderBytes> iStreamHeaderCompressed;
+    Bws<OhmMsgAudio::kMaxSampleBytes> iCompressed;
     TUint iFrame;
     TUint iSampleRate;
     TUint iTimestampMultiplier;
     TUint iBytesPerSample;
+    TUint iChannels;
+    TUint iBitDepth;
+    TBool iCompress;
     TBool iLossless;
     TUint64 iSamplesTotal;
     TUint64 iSampleStart;
     TUint iLatencyMs;
     TUint iLatencyOhm;
+    TBool iParity;
+    OhmParityEncoder iParityEncoder;
     SocketUdp iSocket;
     OhmMsgFactory iFactory;
     FifoLite<OhmMsgAudio*, kMaxHistoryFrames> iFifoHistory;
@@ -77,7 +90,8 @@ class OhmSender
     static const TUint kTimerAliveJoinTimeoutMs = 10000;
     static const TUint kTimerAliveAudioTimeoutMs = 3000;
     static const TUint kTimerExpiryTimeoutMs = 10000;
-    static const TUint kMaxSlaveCount = 4;
+    static const TUint kMaxSlaveCount = 64;
+    static const TUint kMaxSlavesPerReceiver = 4; // receivers can't forward to more than this
     static const TUint kTtl = 1;
 public:
     static const TUint kMaxNameBytes = 64;
@@ -103,6 +117,7 @@ public:
     void NotifyAudioPlaying(TBool aPlaying);
     void NotifyBroadcastAllowed(TBool aAllowed);
     void EnableUnicastOverride(TBool aEnable);
+    void SetUnicastChaining(TBool aValue);
 private:
     void RunMulticast();
     void RunUnicast();
@@ -114,6 +129,7 @@ private:
     void Stop();
     void EnabledChanged();
     void ChannelChanged();
+    void UpdateListenerFeatures(const OhmHeader& aHeader, TBool aFirstListener, TBool aMulticast);
     void TimerAliveJoinExpired();
     void TimerAliveAudioExpired();
     void TimerExpiryExpired();
@@ -122,8 +138,10 @@ private:
     void SendTrack();
     void SendMetatext();
     void SendSlaveList();
+    void SendSlaveList(const Endpoint& aEndpoint, TUint aNode);
     void SendListen(const Endpoint& aEndpoint);
     void SendLeave(const Endpoint& aEndpoint);
+    TUint MaxSlaveCount() const;
     TUint FindSlave(const Endpoint& aEndpoint);
     void RemoveSlave(TUint aIndex);
     TBool CheckSlaveExpiry();
@@ -139,6 +157,7 @@ private:
     TBool iMulticast;
     TBool iEnabled;
     TBool iUnicastOverride;
+    TBool iUnicastChaining;
     Bws<Product::kMaxUriBytes> iImageUri;
     OhmSocket iSocketOhm;
     Srs<kMaxAudioFrameBytes> iRxBuffer;
@@ -152,6 +171,8 @@ private:
     TBool iActive;
     TBool iAliveJoined;
     TBool iAliveBlocked;
+    TBool iListenerNoCompression; // only accessed from RunMulticast/RunUnicast
+    TBool iListenerNoParity;      // only accessed from RunMulticast/RunUnicast
     Endpoint iMulticastEndpoint;
     Endpoint iTargetEndpoint;
     TIpAddress iTargetInterface;
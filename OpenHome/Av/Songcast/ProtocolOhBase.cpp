@@ -4,6 +4,7 @@
 #include <OpenHome/Buffer.h>
 #include <OpenHome/Av/Songcast/OhmMsg.h>
 #include <OpenHome/Av/Songcast/Ohm.h>
+#include <OpenHome/Av/Songcast/OhmCodec.h>
 #include <OpenHome/Media/Pipeline/Msg.h>
 #include <OpenHome/Av/Debug.h>
 #include <OpenHome/Private/Timer.h>
@@ -15,6 +16,8 @@
 #include <OpenHome/OsWrapper.h>
 #include <OpenHome/Private/NetworkAdapterList.h>
 
+#include <algorithm>
+
 using namespace OpenHome;
 using namespace OpenHome::Av;
 using namespace OpenHome::Media;
@@ -27,12 +30,13 @@ ProtocolOhBase::ProtocolOhBase(Environment& aEnv, IOhmMsgFactory& aFactory, Medi
     , iMsgFactory(aFactory)
     , iSupply(nullptr)
     , iSocket(aEnv)
-    , iReadBuffer(iSocket)
+    , iReadBuffer(aFactory, iSocket)
     , iMode(aMode)
     , iStreamId(IPipelineIdProvider::kStreamIdInvalid)
     , iMutexTransport("POHB")
     , iTimestamper(aTimestamper.Ptr())
     , iStarving(false)
+    , iParitySupported(false)
     , iTrackFactory(aTrackFactory)
     , iSupportedScheme(aSupportedScheme)
     , iRunning(false)
@@ -48,6 +52,8 @@ ProtocolOhBase::ProtocolOhBase(Environment& aEnv, IOhmMsgFactory& aFactory, Medi
     , iNumChannels(0)
     , iLatency(0)
     , iRepairFirst(nullptr)
+    , iFramesRecovered(0)
+    , iFramesRepaired(0)
     , iPipelineEmpty("OHBS", 0)
     , iOhmMsgProcessor(aOhmMsgProcessor)
 {
@@ -108,6 +114,46 @@ void ProtocolOhBase::RequestResend(const Brx& aFrames)
     }
 }
 
+void ProtocolOhBase::ProcessParity(const OhmHeader& aHeader)
+{
+    OhmHeaderAudioParity headerParity;
+    headerParity.Internalise(iReadBuffer, aHeader);
+    if (headerParity.ParityBytes() > iParity.MaxBytes()) {
+        return; // caller will discard the remainder of this msg
+    }
+    ReaderBinary reader(iReadBuffer);
+    reader.ReadReplace(headerParity.ParityBytes(), iParity);
+
+    TUint frame;
+    if (!iParityDecoder.TryRecover(headerParity, iParity, iRecovered, frame)) {
+        return;
+    }
+    {
+        AutoMutex _(iMutexTransport);
+        if (!iRunning || (TInt)(frame - iFrame) < 1) {
+            // missing frame has already been repaired or skipped
+            return;
+        }
+    }
+    ReaderBuffer readerRecovered(iRecovered);
+    OhmHeader header;
+    header.Internalise(readerRecovered);
+    if (header.MsgType() != OhmHeader::kMsgTypeAudio ||
+        header.MsgBytes() != iRecovered.Bytes() - OhmHeader::kHeaderBytes) {
+        LOG_ERROR(kSongcast, "ProtocolOhBase: invalid msg recovered for frame %u\n", frame);
+        return;
+    }
+    OhmMsgAudio* msg = iMsgFactory.CreateAudio(readerRecovered, header);
+    if (msg->Frame() != frame) {
+        LOG_ERROR(kSongcast, "ProtocolOhBase: recovered frame %u, expected %u\n", msg->Frame(), frame);
+        msg->RemoveRef();
+        return;
+    }
+    iFramesRecovered++;
+    LOG(kSongcast, "RECOVERED %u\n", frame);
+    Add(msg);
+}
+
 void ProtocolOhBase::SendJoin()
 {
     LOG(kSongcast, "SendJoin\n");
@@ -123,10 +169,18 @@ void ProtocolOhBase::SendListen()
 
 void ProtocolOhBase::Send(TUint aType)
 {
-    Bws<OhmHeader::kHeaderBytes> buffer;
+    Bws<OhmHeader::kHeaderBytes + OhmHeaderListen::kMaxBytes> buffer;
     WriterBuffer writer(buffer);
-    OhmHeader msg(aType, 0);
+    OhmHeaderListen headerListen;
+    if (aType == OhmHeader::kMsgTypeJoin || aType == OhmHeader::kMsgTypeListen) {
+        headerListen.AddFeature(OhmCodecLossless::kCodecName);
+        if (iParitySupported) {
+            headerListen.AddFeature(OhmParity::kFeatureName);
+        }
+    }
+    OhmHeader msg(aType, headerListen.MsgBytes());
     msg.Externalise(writer);
+    headerListen.Externalise(writer);
     try {
         iSocket.Send(buffer, iEndpoint);
     }
@@ -206,6 +260,9 @@ ProtocolStreamResult ProtocolOhBase::Stream(const Brx& aUri)
     iLatency = 0;
     iStreamId = IPipelineIdProvider::kStreamIdInvalid;
     iMutexTransport.Signal();
+    iParityDecoder.Reset();
+    LOG(kSongcast, "ProtocolOhBase: %u frames recovered from parity msgs, %u repaired by resends\n", iFramesRecovered, iFramesRepaired);
+    iFramesRecovered = iFramesRepaired = 0;
 
     return res;
 }
@@ -245,7 +302,16 @@ TBool ProtocolOhBase::RepairBegin(OhmMsgAudio& aMsg)
 {
     LOG(kSongcast, "BEGIN ON %d\n", aMsg.Frame());
     iRepairFirst = &aMsg;
-    iTimerRepair->FireIn(iEnv.Random(kInitialRepairTimeoutMs)); 
+    TUint delayMs = 0;
+    const TUint parityFrames = iParityDecoder.GroupFrames();
+    if (parityFrames > 0 && aMsg.SampleRate() > 0) {
+        // give the parity msg for the current group a chance to arrive before requesting resends
+        delayMs = parityFrames * aMsg.Samples() * 1000 / aMsg.SampleRate();
+        if (delayMs > kMaxParityDelayMs) {
+            delayMs = kMaxParityDelayMs;
+        }
+    }
+    iTimerRepair->FireIn(delayMs + iEnv.Random(kInitialRepairTimeoutMs));
     return true;
 }
 
@@ -464,12 +530,17 @@ void ProtocolOhBase::OutputAudio(OhmMsgAudio& aMsg)
         iTrackMsgDue = false;
     }
     iLastSampleStart = aMsg.SampleStart();
+    if (aMsg.Resent()) {
+        iFramesRepaired++;
+    }
     if (iStreamMsgDue) {
         const TUint64 totalBytes = static_cast<TUint64>(aMsg.SamplesTotal()) * aMsg.Channels() * aMsg.BitDepth()/8;
         iStreamId = iIdProvider->NextStreamId();
         PcmStreamInfo pcmStream;
         pcmStream.Set(aMsg.BitDepth(), aMsg.SampleRate(), aMsg.Channels(), AudioDataEndian::Big, SpeakerProfile((aMsg.Channels() == 1) ? 1 : 2), aMsg.SampleStart());
-        pcmStream.SetCodec(aMsg.Codec(), true);
+        Brn codec(aMsg.Codec());
+        (void)OhmCodecLossless::IsEncoded(aMsg.Codec(), codec);
+        pcmStream.SetCodec(codec, true);
         iSupply->OutputPcmStream(iTrackUri, totalBytes, false/*seekable*/, true/*live*/, Multiroom::Forbidden, *this, iStreamId, pcmStream);
         iStreamMsgDue = false;
         iBitDepth = aMsg.BitDepth();
@@ -490,7 +561,20 @@ void ProtocolOhBase::OutputAudio(OhmMsgAudio& aMsg)
         iPendingMetatext.Replace(Brx::Empty());
         iMetatextMsgDue = false;
     }
-    iSupply->OutputData(aMsg.Audio());
+    Brn codec;
+    if (!OhmCodecLossless::IsEncoded(aMsg.Codec(), codec)) {
+        iSupply->OutputData(aMsg.Audio());
+    }
+    else {
+        if (!OhmCodecLossless::TryDecode(aMsg.Audio(), aMsg.Samples(), aMsg.Channels(), aMsg.BitDepth(), iDecodedAudio)) {
+            // output silence rather than skipping the frame so that later audio stays in sync
+            LOG_ERROR(kSongcast, "ProtocolOhBase: failed to decode frame %u\n", aMsg.Frame());
+            const TUint bytes = std::min(aMsg.Samples() * aMsg.Channels() * (aMsg.BitDepth() / 8), iDecodedAudio.MaxBytes());
+            iDecodedAudio.SetBytes(bytes);
+            iDecodedAudio.Fill(0);
+        }
+        iSupply->OutputData(iDecodedAudio);
+    }
     const TBool halt = aMsg.Halt();
     if (halt) {
         iSupply->OutputWait();
@@ -505,6 +589,7 @@ void ProtocolOhBase::OutputAudio(OhmMsgAudio& aMsg)
 void ProtocolOhBase::Process(OhmMsgAudio& aMsg)
 {
     AddRxTimestamp(aMsg);
+    iParityDecoder.Add(aMsg.Frame(), aMsg.SendableBuffer());
 
     TBool outputAudio = false;
     {
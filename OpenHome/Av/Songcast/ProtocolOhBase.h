@@ -10,6 +10,7 @@
 #include <OpenHome/Av/Songcast/OhmMsg.h>
 #include <OpenHome/Av/Songcast/OhmSocket.h>
 #include <OpenHome/Av/Songcast/OhmTimestamp.h>
+#include <OpenHome/Av/Songcast/OhmParity.h>
 #include <OpenHome/Private/Stream.h>
 #include <OpenHome/Media/Supply.h>
 
@@ -28,6 +29,7 @@ class ProtocolOhBase : public Media::Protocol, private IOhmMsgProcessor
     static const TUint kMaxRepairMissedFrames = 20;
     static const TUint kInitialRepairTimeoutMs = 10;
     static const TUint kSubsequentRepairTimeoutMs = 30;
+    static const TUint kMaxParityDelayMs = 100;
     static const TUint kTimerJoinTimeoutMs = 300;
     static const TUint kTtl = 2;
 protected:
@@ -38,6 +40,7 @@ protected:
     void Add(OhmMsg* aMsg);
     void ResendSeen();
     void RequestResend(const Brx& aFrames);
+    void ProcessParity(const OhmHeader& aHeader);
     void SendJoin();
     void SendListen();
     void Send(TUint aType);
@@ -75,7 +78,7 @@ protected:
     Media::Supply* iSupply;
     OhmSocket iSocket;
     TIpAddress iAddr;
-    Srs<kMaxFrameBytes> iReadBuffer;
+    OhmMsgReader iReadBuffer;
     Endpoint iEndpoint;
     Timer* iTimerJoin;
     Timer* iTimerListen;
@@ -84,6 +87,7 @@ protected:
     Mutex iMutexTransport;
     IOhmTimestamper* iTimestamper;
     TBool iStarving;
+    TBool iParitySupported;
 private:
     Media::TrackFactory& iTrackFactory;
     Brn iSupportedScheme;
@@ -109,6 +113,12 @@ private:
     Timer* iTimerRepair;
     Media::BwsTrackUri iTrackUri;
     Media::BwsTrackMetaData iTrackMetadata;
+    Bws<OhmMsgAudio::kMaxSampleBytes> iDecodedAudio;
+    OhmParityDecoder iParityDecoder;
+    Bws<OhmParity::kMaxMsgBytes> iParity;
+    Bws<OhmParity::kMaxMsgBytes> iRecovered;
+    TUint iFramesRecovered;
+    TUint iFramesRepaired;
     Semaphore iPipelineEmpty;
     Optional<Av::IOhmMsgProcessor> iOhmMsgProcessor;
 };
@@ -57,6 +57,7 @@ ProtocolOhm::ProtocolOhm(Environment& aEnv, IOhmMsgFactory& aMsgFactory, TrackFa
     , iSenderUnicastOverrideEnabled(false)
 {
     ASSERT(iSenderUnicastOverrideEnabled.is_lock_free());
+    iParitySupported = true;
 }
 
 void ProtocolOhm::UnicastOverrideEnabled()
@@ -139,7 +140,7 @@ ProtocolStreamResult ProtocolOhm::Play(TIpAddress aInterface, TUint aTtl, const
                            for the pipeline to empty if we're re-starting a stream following a drop-out
                            We do however need to check for timestamps, to avoid the timestamper
                            filling up with out of date values */
-                        auto msg = iMsgFactory.CreateAudio(iReadBuffer, header);
+                        auto msg = iReadBuffer.CreateAudio(header);
                         AddRxTimestamp(*msg);
                         msg->RemoveRef();
                     }
@@ -190,7 +191,7 @@ ProtocolStreamResult ProtocolOhm::Play(TIpAddress aInterface, TUint aTtl, const
                         iTimerListen->FireIn((kTimerListenTimeoutMs >> 1) - iEnv.Random(kTimerListenTimeoutMs >> 3)); // listen secondary timeout
                         break;
                     case OhmHeader::kMsgTypeAudio:
-                        Add(iMsgFactory.CreateAudio(iReadBuffer, header));
+                        Add(iReadBuffer.CreateAudio(header));
                         break;
                     case OhmHeader::kMsgTypeTrack:
                         Add(iMsgFactory.CreateTrack(iReadBuffer, header));
@@ -201,6 +202,9 @@ ProtocolStreamResult ProtocolOhm::Play(TIpAddress aInterface, TUint aTtl, const
                     case OhmHeader::kMsgTypeResend:
                         ResendSeen();
                         break;
+                    case OhmHeader::kMsgTypeAudioParity:
+                        ProcessParity(header);
+                        break;
                     }
 
                     iReadBuffer.ReadFlush();
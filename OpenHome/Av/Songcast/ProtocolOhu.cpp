@@ -35,7 +35,7 @@ ProtocolOhu::~ProtocolOhu()
 
 void ProtocolOhu::HandleAudio(const OhmHeader& aHeader)
 {
-    Broadcast(iMsgFactory.CreateAudio(iReadBuffer, aHeader));
+    Broadcast(iReadBuffer.CreateAudio(aHeader));
 
     AutoMutex a(iLeaveLock);
     if (iLeaving) {
@@ -60,6 +60,10 @@ void ProtocolOhu::HandleSlave(const OhmHeader& aHeader)
     OhmHeaderSlave headerSlave;
     headerSlave.Internalise(iReadBuffer, aHeader);
     iSlaveCount = headerSlave.SlaveCount();
+    if (iSlaveCount > kMaxSlaveCount) {
+        // senders never list more; ignore any extras rather than overrun iSlaveList
+        iSlaveCount = kMaxSlaveCount;
+    }
 
     ReaderBinary reader(iReadBuffer);
     for (TUint i = 0; i < iSlaveCount; i++) {
@@ -76,21 +80,36 @@ void ProtocolOhu::Broadcast(OhmMsg* aMsg)
         WriterBuffer writer(iMessageBuffer);
         writer.Flush();
         aMsg->Externalise(writer);
-        for (TUint i = 0; i < iSlaveCount; i++) {
-            try {
-                iSocket.Send(iMessageBuffer, iSlaveList[i]);
-            }
-            catch (NetworkError&) {
-                Endpoint::EndpointBuf buf;
-                iSlaveList[i].AppendEndpoint(buf);
-                LOG_ERROR(kApplication6, "NetworkError in ProtocolOhu::Broadcast for slave %s\n", buf.Ptr());
-            }
-        }
+        SendToSlaves(iMessageBuffer);
     }
 
     Add(aMsg);
 }
 
+void ProtocolOhu::Broadcast(OhmMsgAudio* aMsg)
+{
+    if (iSlaveCount > 0) {
+        // a received audio msg already holds its serialised form; forward that rather than copying it
+        SendToSlaves(aMsg->SendableBuffer());
+    }
+
+    Add(aMsg);
+}
+
+void ProtocolOhu::SendToSlaves(const Brx& aMsg)
+{
+    for (TUint i = 0; i < iSlaveCount; i++) {
+        try {
+            iSocket.Send(aMsg, iSlaveList[i]);
+        }
+        catch (NetworkError&) {
+            Endpoint::EndpointBuf buf;
+            iSlaveList[i].AppendEndpoint(buf);
+            LOG_ERROR(kApplication6, "NetworkError in ProtocolOhu::Broadcast for slave %s\n", buf.Ptr());
+        }
+    }
+}
+
 ProtocolStreamResult ProtocolOhu::Play(TIpAddress /*aInterface*/, TUint aTtl, const Endpoint& aEndpoint)
 {
     LOG(kSongcast, "OHU: Play(%08x, %u, %08x:%u\n", iAddr, aTtl, aEndpoint.Address(), aEndpoint.Port());
@@ -167,7 +186,7 @@ ProtocolStreamResult ProtocolOhu::Play(TIpAddress /*aInterface*/, TUint aTtl, co
                            for the pipeline to empty if we're re-starting a stream following a drop-out
                            We do however need to check for timestamps, to avoid the timestamper
                            filling up with out of date values */
-                        auto lmsg = iMsgFactory.CreateAudio(iReadBuffer, header);
+                        auto lmsg = iReadBuffer.CreateAudio(header);
                         AddRxTimestamp(*lmsg);
                         lmsg->RemoveRef();
                     }
@@ -190,6 +209,8 @@ ProtocolStreamResult ProtocolOhu::Play(TIpAddress /*aInterface*/, TUint aTtl, co
                     case OhmHeader::kMsgTypeResend:
                         ResendSeen();
                         break;
+                    case OhmHeader::kMsgTypeAudioParity:
+                        break; // only sent to multicast receivers
                     default:
                         ASSERTS();
                     }
@@ -240,6 +261,8 @@ ProtocolStreamResult ProtocolOhu::Play(TIpAddress /*aInterface*/, TUint aTtl, co
                     case OhmHeader::kMsgTypeResend:
                         ResendSeen();
                         break;
+                    case OhmHeader::kMsgTypeAudioParity:
+                        break; // only sent to multicast receivers
                     default:
                         ASSERTS();
                     }
@@ -36,6 +36,8 @@ private:
     void HandleMetatext(const OhmHeader& aHeader);
     void HandleSlave(const OhmHeader& aHeader);
     void Broadcast(OhmMsg* aMsg);
+    void Broadcast(OhmMsgAudio* aMsg);
+    void SendToSlaves(const Brx& aMsg);
     void SendLeave();
     void TimerLeaveExpired();
 private:
@@ -32,6 +32,7 @@ const Brn Sender::kConfigIdEnabled("Sender.Enabled");
 const Brn Sender::kConfigIdChannel("Sender.Channel");
 const Brn Sender::kConfigIdMode("Sender.Mode");
 const Brn Sender::kConfigIdPreset("Sender.Preset");
+const Brn Sender::kConfigIdUnicastChaining("Sender.UnicastChaining");
 
 Sender::Sender(Environment& aEnv,
                Net::DvDeviceStandard& aDevice,
@@ -77,6 +78,9 @@ Sender::Sender(Environment& aEnv,
     iConfigEnabled = new ConfigChoice(aConfigInit, kConfigIdEnabled, choices, eStringIdYes);
     iListenerIdConfigEnabled = iConfigEnabled->Subscribe(MakeFunctorConfigChoice(*this, &Sender::ConfigEnabledChanged));
 
+    iConfigUnicastChaining = new ConfigChoice(aConfigInit, kConfigIdUnicastChaining, choices, eStringIdNo);
+    iListenerIdConfigUnicastChaining = iConfigUnicastChaining->Subscribe(MakeFunctorConfigChoice(*this, &Sender::ConfigUnicastChainingChanged));
+
     iPendingAudio.reserve(100); // arbitrarily chosen value.  Doesn't need to prevent any reallocation, just avoid regular churn early on
 }
 
@@ -92,6 +96,8 @@ Sender::~Sender()
     delete iConfigMode;
     iConfigPreset->Unsubscribe(iListenerIdConfigPreset);
     delete iConfigPreset;
+    iConfigUnicastChaining->Unsubscribe(iListenerIdConfigUnicastChaining);
+    delete iConfigUnicastChaining;
 }
 
 void Sender::SetName(const Brx& aName)
@@ -343,6 +349,11 @@ void Sender::ConfigPresetChanged(KeyValuePair<TInt>& aKvp)
     iOhmSender->SetPreset(aKvp.Value());
 }
 
+void Sender::ConfigUnicastChainingChanged(KeyValuePair<TUint>& aStringId)
+{
+    iOhmSender->SetUnicastChaining(aStringId.Value() == eStringIdYes);
+}
+
 // FIXME: review how this mapping is generated
 TUint Sender::FirstChannelToSend(TUint aNumChannels)
 {
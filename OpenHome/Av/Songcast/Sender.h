@@ -27,6 +27,7 @@ class Sender : public Media::IPipelineElementDownstream, private Media::IMsgProc
     static const Brn kConfigIdChannel;
     static const Brn kConfigIdMode;
     static const Brn kConfigIdPreset;
+    static const Brn kConfigIdUnicastChaining;
     static const TInt kChannelMin = 0;
     static const TInt kChannelMax = 65535;
     static const TInt kPresetMin = 0;
@@ -78,6 +79,7 @@ private:
     void ConfigChannelChanged(Configuration::KeyValuePair<TInt>& aValue);
     void ConfigModeChanged(Configuration::KeyValuePair<TUint>& aStringId);
     void ConfigPresetChanged(Configuration::KeyValuePair<TInt>& aValue);
+    void ConfigUnicastChainingChanged(Configuration::KeyValuePair<TUint>& aStringId);
 private:
     static TUint FirstChannelToSend(TUint aNumChannels);
     void ProcessFragment(const Brx& aData, TUint aNumChannels, TUint aBytesPerSample);
@@ -128,6 +130,8 @@ private:
     TUint iListenerIdConfigMode;
     Configuration::ConfigNum* iConfigPreset;
     TUint iListenerIdConfigPreset;
+    Configuration::ConfigChoice* iConfigUnicastChaining;
+    TUint iListenerIdConfigUnicastChaining;
     std::vector<Media::MsgAudio*> iPendingAudio;
     Bwx* iAudioBuf;
     TUint iSampleRate;
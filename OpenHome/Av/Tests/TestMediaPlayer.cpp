@@ -143,6 +143,7 @@ TestMediaPlayer::TestMediaPlayer(Net::DvStack& aDvStack, Net::CpStack& aCpStack,
     , iUserAgent(aUserAgent)
     , iTxTimestamper(nullptr)
     , iRxTimestamper(nullptr)
+    , iStreamCache(nullptr)
     , iStoreFileWriter(nullptr)
     , iOdpPort(aOdpPort)
     , iMinWebUiResourceThreads(aMinWebUiResourceThreads)
@@ -282,6 +283,11 @@ void TestMediaPlayer::SetSongcastTimestampers(IOhmTimestamper& aTxTimestamper, I
     iRxTimestamper = &aRxTimestamper;
 }
 
+void TestMediaPlayer::SetStreamCache(Media::StreamCache& aStreamCache)
+{
+    iStreamCache = &aStreamCache;
+}
+
 void TestMediaPlayer::StopPipeline()
 {
     TUint waitCount = 0;
@@ -406,9 +412,18 @@ void TestMediaPlayer::RegisterPlugins(Environment& aEnv)
     iMediaPlayer->Add(Codec::CodecFactory::NewMp3(iMediaPlayer->MimeTypes()));
 
     // Add protocol modules (Radio source can require several stacked Http instances)
+    // A stream cache must be consulted ahead of the protocols that fill it
+    if (iStreamCache != nullptr) {
+        iMediaPlayer->Add(ProtocolFactory::NewCache(aEnv, *iStreamCache));
+    }
     static const TUint kNumHttpProtocols = 5;
     for (TUint i=0; i<kNumHttpProtocols; i++) {
-        iMediaPlayer->Add(ProtocolFactory::NewHttp(aEnv, iUserAgent));
+        if (iStreamCache != nullptr) {
+            iMediaPlayer->Add(ProtocolFactory::NewHttp(aEnv, iUserAgent, *iStreamCache));
+        }
+        else {
+            iMediaPlayer->Add(ProtocolFactory::NewHttp(aEnv, iUserAgent));
+        }
     }
     iMediaPlayer->Add(ProtocolFactory::NewHls(aEnv, iUserAgent));
 
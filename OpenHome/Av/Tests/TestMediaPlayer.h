@@ -118,6 +118,7 @@ public:
     virtual ~TestMediaPlayer();
     void SetPullableClock(Media::IPullableClock& aPullableClock);
     void SetSongcastTimestampers(IOhmTimestamper& aTxTimestamper, IOhmTimestamper& aRxTimestamper);
+    void SetStreamCache(Media::StreamCache& aStreamCache); // optional; must be called before Run()
     void StopPipeline();
     void AddAttribute(const TChar* aAttribute); // FIXME - only required by Songcasting driver
     virtual void Run();
@@ -167,6 +168,7 @@ private:
     const Brh iUserAgent;
     IOhmTimestamper* iTxTimestamper;
     IOhmTimestamper* iRxTimestamper;
+    Media::StreamCache* iStreamCache;
     VolumeSinkLogger iVolumeLogger;
     Bws<Uri::kMaxUriBytes+1> iPresentationUrl;
     Media::LoggingPipelineObserver* iPipelineObserver;
@@ -204,6 +206,8 @@ public:
     const TestFramework::OptionString& StoreFile() const;
     const TestFramework::OptionUint& OptionOdp() const;
     const TestFramework::OptionUint& OptionWebUi() const;
+    const TestFramework::OptionString& StreamCacheDir() const;
+    const TestFramework::OptionUint& StreamCacheMb() const;
 private:
     TestFramework::OptionParser iParser;
     TestFramework::OptionString iOptionRoom;
@@ -220,6 +224,8 @@ private:
     TestFramework::OptionString iOptionStoreFile;
     TestFramework::OptionUint iOptionOdp;
     TestFramework::OptionUint iOptionWebUi;
+    TestFramework::OptionString iOptionStreamCacheDir;
+    TestFramework::OptionUint iOptionStreamCacheMb;
 };
 
 // Not very nice, but only to allow reusable test functions.
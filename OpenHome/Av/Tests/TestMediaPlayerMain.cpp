@@ -5,6 +5,7 @@
 #include <OpenHome/Net/Private/DviStack.h>
 #include <OpenHome/Media/Utils/AnimatorBasic.h>
 #include <OpenHome/Media/PipelineManager.h>
+#include <OpenHome/Media/Protocol/StreamCache.h>
 #include <OpenHome/Private/Thread.h>
 #include <OpenHome/Functor.h>
 
@@ -17,6 +18,7 @@ using namespace OpenHome::Net;
 
 class TestMediaPlayerThread
 {
+    static const TUint kStreamCacheMaxEntries = 64;
 public:
     TestMediaPlayerThread(const TestMediaPlayerOptions& aOptions);
     ~TestMediaPlayerThread();
@@ -77,10 +79,17 @@ void TestMediaPlayerThread::RunInThread()
         iOptions.UserAgent().Value(), iOptions.StoreFile().CString(), iOptions.OptionOdp().Value(), iOptions.OptionWebUi().Value());
     Media::AnimatorBasic* animator = new Media::AnimatorBasic(dvStack->Env(), tmp->Pipeline(), iOptions.ClockPull().Value());
     tmp->SetPullableClock(*animator);
+    Media::StreamCache* streamCache = nullptr;
+    if (iOptions.StreamCacheDir().Value().Bytes() > 0) {
+        const TUint64 maxBytes = (TUint64)iOptions.StreamCacheMb().Value() * 1024 * 1024;
+        streamCache = new Media::StreamCache(iOptions.StreamCacheDir().Value(), maxBytes, kStreamCacheMaxEntries);
+        tmp->SetStreamCache(*streamCache);
+    }
     tmp->Run();
     tmp->StopPipeline();
     delete animator;
     delete tmp;
+    delete streamCache;
 }
 
 int CDECL main(int aArgc, char* aArgv[])
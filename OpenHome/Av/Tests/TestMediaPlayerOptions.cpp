@@ -22,6 +22,8 @@ TestMediaPlayerOptions::TestMediaPlayerOptions()
     , iOptionStoreFile("", "--storefile", Brn(""), "File for reading/writing persistent store")
     , iOptionOdp("", "--odp", 0, "Port for ODP server")
     , iOptionWebUi("", "--webui", 0, "Port for Web UI server")
+    , iOptionStreamCacheDir("", "--streamcache", Brn(""), "Directory for an on-disk cache of http streams")
+    , iOptionStreamCacheMb("", "--streamcachemb", 512, "Size limit (in MB) of --streamcache")
 {
     iParser.AddOption(&iOptionRoom);
     iParser.AddOption(&iOptionName);
@@ -37,6 +39,8 @@ TestMediaPlayerOptions::TestMediaPlayerOptions()
     iParser.AddOption(&iOptionStoreFile);
     iParser.AddOption(&iOptionOdp);
     iParser.AddOption(&iOptionWebUi);
+    iParser.AddOption(&iOptionStreamCacheDir);
+    iParser.AddOption(&iOptionStreamCacheMb);
 }
 
 void TestMediaPlayerOptions::AddOption(Option* aOption)
@@ -118,3 +122,13 @@ const OptionUint& TestMediaPlayerOptions::OptionWebUi() const
 {
     return iOptionWebUi;
 }
+
+const OptionString& TestMediaPlayerOptions::StreamCacheDir() const
+{
+    return iOptionStreamCacheDir;
+}
+
+const OptionUint& TestMediaPlayerOptions::StreamCacheMb() const
+{
+    return iOptionStreamCacheMb;
+}
@@ -0,0 +1,239 @@
+#include <OpenHome/Private/SuiteUnitTest.h>
+#include <OpenHome/Av/Songcast/OhmCodec.h>
+#include <OpenHome/Av/Songcast/Ohm.h>
+#include <OpenHome/Av/Songcast/OhmMsg.h>
+#include <OpenHome/Private/Stream.h>
+
+#include <math.h>
+
+using namespace OpenHome;
+using namespace OpenHome::TestFramework;
+using namespace OpenHome::Av;
+
+namespace OpenHome {
+namespace Av {
+
+class SuiteOhmCodec : public SuiteUnitTest
+{
+    static const TUint kSamples = 240; // 5ms at 48kHz
+public:
+    SuiteOhmCodec();
+private: // from SuiteUnitTest
+    void Setup() override;
+    void TearDown() override;
+private:
+    enum ESignal
+    {
+        eSine
+       ,eSilence
+       ,eNoise
+    };
+    void Generate(ESignal aSignal, TUint aSamples, TUint aChannels, TUint aBitDepth);
+    void CheckRoundTrip(TUint aSamples, TUint aChannels, TUint aBitDepth);
+    void TestRoundTrip16();
+    void TestRoundTrip24();
+    void TestRoundTrip8Mono();
+    void TestRoundTripMaxFrame();
+    void TestSilence();
+    void TestNoiseNotCompressed();
+    void TestUnsupportedFormat();
+    void TestCorruptRejected();
+    void TestCodecName();
+    void TestListenHeader();
+private:
+    Bws<OhmMsgAudio::kMaxSampleBytes> iPcm;
+    Bws<OhmMsgAudio::kMaxSampleBytes> iEncoded;
+    Bws<OhmMsgAudio::kMaxSampleBytes> iDecoded;
+    TUint32 iLcg;
+};
+
+} // namespace Av
+} // namespace OpenHome
+
+
+// SuiteOhmCodec
+
+SuiteOhmCodec::SuiteOhmCodec()
+    : SuiteUnitTest("OhmCodecLossless")
+{
+    AddTest(MakeFunctor(*this, &SuiteOhmCodec::TestRoundTrip16), "TestRoundTrip16");
+    AddTest(MakeFunctor(*this, &SuiteOhmCodec::TestRoundTrip24), "TestRoundTrip24");
+    AddTest(MakeFunctor(*this, &SuiteOhmCodec::TestRoundTrip8Mono), "TestRoundTrip8Mono");
+    AddTest(MakeFunctor(*this, &SuiteOhmCodec::TestRoundTripMaxFrame), "TestRoundTripMaxFrame");
+    AddTest(MakeFunctor(*this, &SuiteOhmCodec::TestSilence), "TestSilence");
+    AddTest(MakeFunctor(*this, &SuiteOhmCodec::TestNoiseNotCompressed), "TestNoiseNotCompressed");
+    AddTest(MakeFunctor(*this, &SuiteOhmCodec::TestUnsupportedFormat), "TestUnsupportedFormat");
+    AddTest(MakeFunctor(*this, &SuiteOhmCodec::TestCorruptRejected), "TestCorruptRejected");
+    AddTest(MakeFunctor(*this, &SuiteOhmCodec::TestCodecName), "TestCodecName");
+    AddTest(MakeFunctor(*this, &SuiteOhmCodec::TestListenHeader), "TestListenHeader");
+}
+
+void SuiteOhmCodec::Setup()
+{
+    iPcm.SetBytes(0);
+    iEncoded.SetBytes(0);
+    iDecoded.SetBytes(0);
+    iLcg = 1;
+}
+
+void SuiteOhmCodec::TearDown()
+{
+}
+
+void SuiteOhmCodec::Generate(ESignal aSignal, TUint aSamples, TUint aChannels, TUint aBitDepth)
+{
+    const TUint bytesPerSample = aBitDepth / 8;
+    const TInt max = (1 << (aBitDepth - 1)) - 1;
+    iPcm.SetBytes(0);
+    for (TUint i=0; i<aSamples; i++) {
+        for (TUint ch=0; ch<aChannels; ch++) {
+            TInt sample = 0;
+            iLcg = iLcg * 1664525 + 1013904223;
+            if (aSignal == eSine) {
+                // a little noise in the low bits, as there would be in real audio
+                sample = (TInt)(max * 0.6 * sin((i * 0.05) + ch)) + (TInt)((iLcg >> 28) & 0x7) - 4;
+            }
+            else if (aSignal == eNoise) {
+                sample = (TInt)(iLcg >> (32 - aBitDepth)) - max;
+            }
+            for (TUint b=bytesPerSample; b>0; b--) {
+                iPcm.Append((TByte)(sample >> (8 * (b-1))));
+            }
+        }
+    }
+}
+
+void SuiteOhmCodec::CheckRoundTrip(TUint aSamples, TUint aChannels, TUint aBitDepth)
+{
+    TEST(OhmCodecLossless::TryEncode(iPcm, aChannels, aBitDepth, iEncoded));
+    TEST(iEncoded.Bytes() < iPcm.Bytes());
+    TEST(OhmCodecLossless::TryDecode(iEncoded, aSamples, aChannels, aBitDepth, iDecoded));
+    TEST(iDecoded == iPcm);
+}
+
+void SuiteOhmCodec::TestRoundTrip16()
+{
+    Generate(eSine, kSamples, 2, 16);
+    CheckRoundTrip(kSamples, 2, 16);
+}
+
+void SuiteOhmCodec::TestRoundTrip24()
+{
+    Generate(eSine, kSamples, 2, 24);
+    CheckRoundTrip(kSamples, 2, 24);
+}
+
+void SuiteOhmCodec::TestRoundTrip8Mono()
+{
+    Generate(eSine, kSamples, 1, 8);
+    CheckRoundTrip(kSamples, 1, 8);
+}
+
+void SuiteOhmCodec::TestRoundTripMaxFrame()
+{
+    const TUint samples = OhmMsgAudio::kMaxSampleBytes / 6; // 5ms of 192kHz, 24-bit stereo
+    Generate(eSine, samples, 2, 24);
+    CheckRoundTrip(samples, 2, 24);
+}
+
+void SuiteOhmCodec::TestSilence()
+{
+    Generate(eSilence, kSamples, 2, 24);
+    CheckRoundTrip(kSamples, 2, 24);
+    // one bit per sample, plus a header byte per channel
+    TEST(iEncoded.Bytes() <= 2 + (2 * kSamples / 8));
+}
+
+void SuiteOhmCodec::TestNoiseNotCompressed()
+{
+    Generate(eNoise, kSamples, 2, 16);
+    TEST(!OhmCodecLossless::TryEncode(iPcm, 2, 16, iEncoded));
+}
+
+void SuiteOhmCodec::TestUnsupportedFormat()
+{
+    Generate(eSine, kSamples, 2, 16);
+    TEST(!OhmCodecLossless::TryEncode(iPcm, 2, 12, iEncoded));
+    TEST(!OhmCodecLossless::TryEncode(iPcm, 0, 16, iEncoded));
+    TEST(!OhmCodecLossless::TryEncode(iPcm, OhmCodecLossless::kMaxChannels + 1, 16, iEncoded));
+    TEST(!OhmCodecLossless::TryEncode(Brn(iPcm.Ptr(), iPcm.Bytes() - 1), 2, 16, iEncoded)); // partial sample
+    TEST(!OhmCodecLossless::TryEncode(Brx::Empty(), 2, 16, iEncoded));
+}
+
+void SuiteOhmCodec::TestCorruptRejected()
+{
+    Generate(eSine, kSamples, 2, 16);
+    TEST(OhmCodecLossless::TryEncode(iPcm, 2, 16, iEncoded));
+    TEST(!OhmCodecLossless::TryDecode(Brn(iEncoded.Ptr(), iEncoded.Bytes() - 1), kSamples, 2, 16, iDecoded));
+    TEST(!OhmCodecLossless::TryDecode(iEncoded, kSamples + 10, 2, 16, iDecoded));
+    Bws<OhmMsgAudio::kMaxSampleBytes> extended(iEncoded);
+    extended.Append((TByte)0);
+    TEST(!OhmCodecLossless::TryDecode(extended, kSamples, 2, 16, iDecoded));
+    Bws<64> small;
+    TEST(!OhmCodecLossless::TryDecode(iEncoded, kSamples, 2, 16, small));
+    // corrupt data must never overrun the output, whether or not it is detected
+    for (TUint i=0; i<iEncoded.Bytes(); i+=7) {
+        Bws<OhmMsgAudio::kMaxSampleBytes> corrupt(iEncoded);
+        corrupt[i] ^= 0x5a;
+        (void)OhmCodecLossless::TryDecode(corrupt, kSamples, 2, 16, iDecoded);
+        TEST(iDecoded.Bytes() <= kSamples * 4);
+    }
+}
+
+void SuiteOhmCodec::TestCodecName()
+{
+    Bws<OhmMsgAudio::kMaxCodecBytes> name;
+    OhmCodecLossless::GetCodecName(Brn("FLAC"), name);
+    Brn codec;
+    TEST(OhmCodecLossless::IsEncoded(name, codec));
+    TEST(codec == Brn("FLAC"));
+    TEST(!OhmCodecLossless::IsEncoded(Brn("FLAC"), codec));
+    TEST(!OhmCodecLossless::IsEncoded(OhmCodecLossless::kCodecName, codec));
+
+    OhmCodecLossless::GetCodecName(Brn("A codec name that is far too long to fit"), name);
+    TEST(name.Bytes() == name.MaxBytes());
+    TEST(OhmCodecLossless::IsEncoded(name, codec));
+}
+
+void SuiteOhmCodec::TestListenHeader()
+{
+    OhmHeaderListen headerListen;
+    TEST(headerListen.MsgBytes() == 0);
+    TEST(!headerListen.SupportsFeature(OhmCodecLossless::kCodecName));
+    headerListen.AddFeature(Brn("Other"));
+    headerListen.AddFeature(OhmCodecLossless::kCodecName);
+
+    Bws<OhmHeader::kHeaderBytes + OhmHeaderListen::kMaxBytes> buf;
+    WriterBuffer writer(buf);
+    OhmHeader header(OhmHeader::kMsgTypeListen, headerListen.MsgBytes());
+    header.Externalise(writer);
+    headerListen.Externalise(writer);
+
+    ReaderBuffer reader(buf);
+    OhmHeader header2;
+    header2.Internalise(reader);
+    TEST(header2.MsgType() == OhmHeader::kMsgTypeListen);
+    OhmHeaderListen headerListen2;
+    headerListen2.Internalise(reader, header2);
+    TEST(headerListen2.SupportsFeature(OhmCodecLossless::kCodecName));
+    TEST(headerListen2.SupportsFeature(Brn("Other")));
+    TEST(!headerListen2.SupportsFeature(Brn("Othe")));
+
+    // a msg from an older receiver has no payload
+    Bws<OhmHeader::kHeaderBytes> legacy;
+    WriterBuffer writerLegacy(legacy);
+    OhmHeader(OhmHeader::kMsgTypeJoin, 0).Externalise(writerLegacy);
+    ReaderBuffer readerLegacy(legacy);
+    header2.Internalise(readerLegacy);
+    headerListen2.Internalise(readerLegacy, header2);
+    TEST(!headerListen2.SupportsFeature(OhmCodecLossless::kCodecName));
+}
+
+
+
+void TestOhmCodec()
+{
+    Runner runner("OhmCodecLossless tests\n");
+    runner.Add(new SuiteOhmCodec());
+    runner.Run();
+}
@@ -0,0 +1,296 @@
+#include <OpenHome/Private/SuiteUnitTest.h>
+#include <OpenHome/Av/Songcast/OhmMsg.h>
+#include <OpenHome/Av/Songcast/Ohm.h>
+#include <OpenHome/Private/Stream.h>
+
+#include <vector>
+
+using namespace OpenHome;
+using namespace OpenHome::TestFramework;
+using namespace OpenHome::Av;
+
+namespace OpenHome {
+namespace Av {
+
+class DatagramSource : public IReaderSource
+{
+public:
+    DatagramSource();
+    ~DatagramSource();
+    void Add(const Brx& aDatagram);
+    TUint Pending() const;
+public: // from IReaderSource
+    void Read(Bwx& aBuffer) override;
+    void ReadFlush() override;
+    void ReadInterrupt() override;
+private:
+    std::vector<Bwh*> iDatagrams;
+};
+
+class SuiteOhmMsgReader : public SuiteUnitTest
+{
+    static const TUint kAudioCount = 4;
+    static const TUint kSamples = 240;
+    static const TUint kChannels = 2;
+    static const TUint kBitDepth = 24;
+public:
+    SuiteOhmMsgReader();
+private: // from SuiteUnitTest
+    void Setup() override;
+    void TearDown() override;
+private:
+    void AddAudio(TUint aFrame, TUint aSamples);
+    void AddTrack(TUint aSequence);
+    OhmMsgAudio* ReadAudio();
+    void TestAudioFields();
+    void TestMsgOwnsDatagram();
+    void TestOtherMsgTypes();
+    void TestTruncatedAudio();
+    void TestReadPastDatagram();
+    void TestMsgsReturnedToFactory();
+private:
+    OhmMsgFactory* iFactory;
+    DatagramSource* iSource;
+    OhmMsgReader* iReader;
+    Bwh iDatagram;
+    Bws<OhmMsgAudio::kMaxSampleBytes> iAudio;
+};
+
+} // namespace Av
+} // namespace OpenHome
+
+
+// DatagramSource
+
+DatagramSource::DatagramSource()
+{
+}
+
+DatagramSource::~DatagramSource()
+{
+    for (auto datagram : iDatagrams) {
+        delete datagram;
+    }
+}
+
+void DatagramSource::Add(const Brx& aDatagram)
+{
+    Bwh* datagram = new Bwh(aDatagram.Bytes());
+    datagram->Replace(aDatagram);
+    iDatagrams.push_back(datagram);
+}
+
+TUint DatagramSource::Pending() const
+{
+    return (TUint)iDatagrams.size();
+}
+
+void DatagramSource::Read(Bwx& aBuffer)
+{
+    if (iDatagrams.size() == 0) {
+        THROW(ReaderError);
+    }
+    Bwh* datagram = iDatagrams[0];
+    iDatagrams.erase(iDatagrams.begin());
+    aBuffer.Replace(*datagram);
+    delete datagram;
+}
+
+void DatagramSource::ReadFlush()
+{
+}
+
+void DatagramSource::ReadInterrupt()
+{
+}
+
+
+// SuiteOhmMsgReader
+
+SuiteOhmMsgReader::SuiteOhmMsgReader()
+    : SuiteUnitTest("OhmMsgReader")
+    , iDatagram(OhmMsgAudio::kMaxDatagramBytes)
+{
+    AddTest(MakeFunctor(*this, &SuiteOhmMsgReader::TestAudioFields), "TestAudioFields");
+    AddTest(MakeFunctor(*this, &SuiteOhmMsgReader::TestMsgOwnsDatagram), "TestMsgOwnsDatagram");
+    AddTest(MakeFunctor(*this, &SuiteOhmMsgReader::TestOtherMsgTypes), "TestOtherMsgTypes");
+    AddTest(MakeFunctor(*this, &SuiteOhmMsgReader::TestTruncatedAudio), "TestTruncatedAudio");
+    AddTest(MakeFunctor(*this, &SuiteOhmMsgReader::TestReadPastDatagram), "TestReadPastDatagram");
+    AddTest(MakeFunctor(*this, &SuiteOhmMsgReader::TestMsgsReturnedToFactory), "TestMsgsReturnedToFactory");
+}
+
+void SuiteOhmMsgReader::Setup()
+{
+    iFactory = new OhmMsgFactory(kAudioCount, 2, 2);
+    iSource = new DatagramSource();
+    iReader = new OhmMsgReader(*iFactory, *iSource);
+}
+
+void SuiteOhmMsgReader::TearDown()
+{
+    delete iReader;
+    delete iSource;
+    delete iFactory;
+}
+
+void SuiteOhmMsgReader::AddAudio(TUint aFrame, TUint aSamples)
+{
+    iAudio.SetBytes(aSamples * kChannels * (kBitDepth / 8));
+    TByte* ptr = const_cast<TByte*>(iAudio.Ptr());
+    for (TUint i=0; i<iAudio.Bytes(); i++) {
+        ptr[i] = (TByte)(aFrame + i);
+    }
+    Bws<OhmMsgAudio::kStreamHeaderBytes> streamHeader;
+    OhmMsgAudio::GetStreamHeader(streamHeader, 1000000, 48000, 48000 * kChannels * kBitDepth,
+                                 0, kBitDepth, kChannels, Brn("PCM"));
+    OhmMsgAudio* msg = iFactory->CreateAudio(false, true, false, false, aSamples, aFrame,
+                                             0, 100, 4800 + aFrame, streamHeader, iAudio);
+    iDatagram.SetBytes(0);
+    WriterBuffer writer(iDatagram);
+    msg->Externalise(writer);
+    msg->RemoveRef();
+    iSource->Add(iDatagram);
+}
+
+void SuiteOhmMsgReader::AddTrack(TUint aSequence)
+{
+    OhmMsgTrack* msg = iFactory->CreateTrack(aSequence, Brn("http://host/track"), Brn("<DIDL-Lite/>"));
+    iDatagram.SetBytes(0);
+    WriterBuffer writer(iDatagram);
+    msg->Externalise(writer);
+    msg->RemoveRef();
+    iSource->Add(iDatagram);
+}
+
+OhmMsgAudio* SuiteOhmMsgReader::ReadAudio()
+{
+    OhmHeader header;
+    header.Internalise(*iReader);
+    TEST(header.MsgType() == OhmHeader::kMsgTypeAudio);
+    OhmMsgAudio* msg = iReader->CreateAudio(header);
+    iReader->ReadFlush();
+    return msg;
+}
+
+void SuiteOhmMsgReader::TestAudioFields()
+{
+    AddAudio(17, kSamples);
+    Bwh datagram(iDatagram.Bytes());
+    datagram.Replace(iDatagram);
+    OhmMsgAudio* msg = ReadAudio();
+    TEST(!msg->Halt());
+    TEST(msg->Lossless());
+    TEST(!msg->Resent());
+    TEST(msg->Samples() == kSamples);
+    TEST(msg->Frame() == 17);
+    TEST(msg->MediaLatency() == 100);
+    TEST(msg->SampleStart() == 4800 + 17);
+    TEST(msg->SamplesTotal() == 1000000);
+    TEST(msg->SampleRate() == 48000);
+    TEST(msg->BitDepth() == kBitDepth);
+    TEST(msg->Channels() == kChannels);
+    TEST(msg->Codec() == Brn("PCM"));
+    TEST(msg->Audio() == iAudio);
+    // the received datagram can be forwarded as is
+    TEST(msg->SendableBuffer() == datagram);
+    msg->RemoveRef();
+}
+
+void SuiteOhmMsgReader::TestMsgOwnsDatagram()
+{
+    AddAudio(1, kSamples);
+    AddAudio(2, kSamples / 2);
+    OhmMsgAudio* msg1 = ReadAudio();
+    Bws<OhmMsgAudio::kMaxSampleBytes> audio1(msg1->Audio());
+    OhmMsgAudio* msg2 = ReadAudio();
+    TEST(msg1 != msg2);
+    TEST(msg1->Frame() == 1);
+    TEST(msg1->Audio() == audio1);
+    TEST(msg2->Frame() == 2);
+    TEST(msg2->Audio() == iAudio);
+    msg1->RemoveRef();
+    msg2->RemoveRef();
+}
+
+void SuiteOhmMsgReader::TestOtherMsgTypes()
+{
+    AddTrack(5);
+    AddAudio(3, kSamples);
+    AddTrack(6);
+
+    OhmHeader header;
+    header.Internalise(*iReader);
+    TEST(header.MsgType() == OhmHeader::kMsgTypeTrack);
+    OhmMsgTrack* track = iFactory->CreateTrack(*iReader, header);
+    iReader->ReadFlush();
+    TEST(track->Sequence() == 5);
+    TEST(track->Uri() == Brn("http://host/track"));
+    track->RemoveRef();
+
+    OhmMsgAudio* msg = ReadAudio();
+    TEST(msg->Frame() == 3);
+
+    header.Internalise(*iReader);
+    TEST(header.MsgType() == OhmHeader::kMsgTypeTrack);
+    track = iFactory->CreateTrack(*iReader, header);
+    iReader->ReadFlush();
+    TEST(track->Sequence() == 6);
+    track->RemoveRef();
+
+    TEST(msg->Audio() == iAudio);
+    msg->RemoveRef();
+}
+
+void SuiteOhmMsgReader::TestTruncatedAudio()
+{
+    AddAudio(1, kSamples);
+    iDatagram.SetBytes(iDatagram.Bytes() - 1);
+    iSource->Add(iDatagram);
+    AddAudio(2, kSamples);
+
+    OhmMsgAudio* msg = ReadAudio();
+    TEST(msg->Frame() == 1);
+    msg->RemoveRef();
+
+    OhmHeader header;
+    header.Internalise(*iReader);
+    TEST_THROWS(iReader->CreateAudio(header), OhmError);
+
+    // the rest of the truncated datagram is discarded
+    msg = ReadAudio();
+    TEST(msg->Frame() == 2);
+    msg->RemoveRef();
+}
+
+void SuiteOhmMsgReader::TestReadPastDatagram()
+{
+    AddAudio(1, kSamples);
+    AddAudio(2, kSamples);
+    OhmHeader header;
+    header.Internalise(*iReader);
+    TEST_THROWS(iReader->Read(iDatagram.Bytes()), OhmError);
+    OhmMsgAudio* msg = ReadAudio();
+    TEST(msg->Frame() == 2);
+    msg->RemoveRef();
+}
+
+void SuiteOhmMsgReader::TestMsgsReturnedToFactory()
+{
+    // one msg is always held by iReader; the rest must be recycled as each is released
+    for (TUint i=0; i<10 * kAudioCount; i++) {
+        AddAudio(i, kSamples);
+        OhmMsgAudio* msg = ReadAudio();
+        TEST(msg->Frame() == i);
+        msg->RemoveRef();
+    }
+    TEST(iSource->Pending() == 0);
+}
+
+
+
+void TestOhmMsg()
+{
+    Runner runner("OhmMsg tests\n");
+    runner.Add(new SuiteOhmMsgReader());
+    runner.Run();
+}
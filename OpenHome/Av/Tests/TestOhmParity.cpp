@@ -0,0 +1,401 @@
+#include <OpenHome/Private/SuiteUnitTest.h>
+#include <OpenHome/Av/Songcast/OhmParity.h>
+#include <OpenHome/Av/Songcast/Ohm.h>
+#include <OpenHome/Private/Stream.h>
+
+#include <algorithm>
+#include <limits.h>
+#include <vector>
+
+using namespace OpenHome;
+using namespace OpenHome::TestFramework;
+using namespace OpenHome::Av;
+
+namespace OpenHome {
+namespace Av {
+
+class SuiteOhmParity : public SuiteUnitTest
+{
+    static const TUint kGroupFrames = 8;
+    static const TUint kFlagsOffset = OhmHeader::kHeaderBytes + 1;
+public:
+    SuiteOhmParity();
+private: // from SuiteUnitTest
+    void Setup() override;
+    void TearDown() override;
+private:
+    void CreateMsgs(TUint aFirstFrame, TUint aCount);
+    const Brx& Msg(TUint aFrame) const;
+    void EncodeGroup(TUint aFirstFrame);
+    void AddGroup(TUint aFirstFrame, TUint aSkip1, TUint aSkip2);
+    TBool TryRecover(TUint& aFrame);
+    void TestRecoverEachPosition();
+    void TestResentIgnored();
+    void TestDuplicatesIgnored();
+    void TestTwoLostNotRecovered();
+    void TestNothingLost();
+    void TestLostParityMsg();
+    void TestStopsWithoutParity();
+    void TestEncoderRestart();
+    void TestMisalignedGroup();
+    void TestGroupResized();
+    void TestParityHeader();
+private:
+    OhmParityEncoder* iEncoder;
+    OhmParityDecoder* iDecoder;
+    std::vector<Bwh*> iMsgs;
+    TUint iFirstFrame;
+    Bwh iParityMsg;
+    Bws<OhmParity::kMaxMsgBytes> iRecovered;
+    TUint32 iLcg;
+};
+
+} // namespace Av
+} // namespace OpenHome
+
+
+// SuiteOhmParity
+
+SuiteOhmParity::SuiteOhmParity()
+    : SuiteUnitTest("OhmParity")
+    , iParityMsg(OhmHeader::kHeaderBytes + OhmHeaderAudioParity::kHeaderBytes + OhmParity::kMaxMsgBytes)
+{
+    AddTest(MakeFunctor(*this, &SuiteOhmParity::TestRecoverEachPosition), "TestRecoverEachPosition");
+    AddTest(MakeFunctor(*this, &SuiteOhmParity::TestResentIgnored), "TestResentIgnored");
+    AddTest(MakeFunctor(*this, &SuiteOhmParity::TestDuplicatesIgnored), "TestDuplicatesIgnored");
+    AddTest(MakeFunctor(*this, &SuiteOhmParity::TestTwoLostNotRecovered), "TestTwoLostNotRecovered");
+    AddTest(MakeFunctor(*this, &SuiteOhmParity::TestNothingLost), "TestNothingLost");
+    AddTest(MakeFunctor(*this, &SuiteOhmParity::TestLostParityMsg), "TestLostParityMsg");
+    AddTest(MakeFunctor(*this, &SuiteOhmParity::TestStopsWithoutParity), "TestStopsWithoutParity");
+    AddTest(MakeFunctor(*this, &SuiteOhmParity::TestEncoderRestart), "TestEncoderRestart");
+    AddTest(MakeFunctor(*this, &SuiteOhmParity::TestMisalignedGroup), "TestMisalignedGroup");
+    AddTest(MakeFunctor(*this, &SuiteOhmParity::TestGroupResized), "TestGroupResized");
+    AddTest(MakeFunctor(*this, &SuiteOhmParity::TestParityHeader), "TestParityHeader");
+}
+
+void SuiteOhmParity::Setup()
+{
+    iEncoder = new OhmParityEncoder(kGroupFrames);
+    iDecoder = new OhmParityDecoder();
+    iLcg = 1;
+    iFirstFrame = 1000;
+    CreateMsgs(iFirstFrame, 6 * kGroupFrames);
+}
+
+void SuiteOhmParity::TearDown()
+{
+    for (TUint i=0; i<iMsgs.size(); i++) {
+        delete iMsgs[i];
+    }
+    iMsgs.clear();
+    delete iDecoder;
+    delete iEncoder;
+}
+
+void SuiteOhmParity::CreateMsgs(TUint aFirstFrame, TUint aCount)
+{
+    // only the position of the flags byte matters to parity so the remainder of each msg can be random
+    for (TUint i=0; i<aCount; i++) {
+        const TUint bytes = 100 + (((aFirstFrame + i) * 397) % 1800);
+        Bwh* msg = new Bwh(bytes);
+        for (TUint j=0; j<bytes; j++) {
+            iLcg = iLcg * 1664525 + 1013904223;
+            msg->Append((TByte)(iLcg >> 24));
+        }
+        (*msg)[kFlagsOffset] &= (TByte)~OhmHeaderAudio::kFlagResent;
+        iMsgs.push_back(msg);
+    }
+}
+
+const Brx& SuiteOhmParity::Msg(TUint aFrame) const
+{
+    return *iMsgs[aFrame - iFirstFrame];
+}
+
+void SuiteOhmParity::EncodeGroup(TUint aFirstFrame)
+{
+    for (TUint i=0; i<kGroupFrames; i++) {
+        const TBool complete = iEncoder->Add(aFirstFrame + i, Msg(aFirstFrame + i));
+        TEST(complete == (i == kGroupFrames - 1));
+    }
+    iParityMsg.Replace(iEncoder->ParityMsg());
+}
+
+void SuiteOhmParity::AddGroup(TUint aFirstFrame, TUint aSkip1, TUint aSkip2)
+{
+    EncodeGroup(aFirstFrame);
+    for (TUint i=0; i<kGroupFrames; i++) {
+        if (i != aSkip1 && i != aSkip2) {
+            iDecoder->Add(aFirstFrame + i, Msg(aFirstFrame + i));
+        }
+    }
+}
+
+TBool SuiteOhmParity::TryRecover(TUint& aFrame)
+{
+    ReaderBuffer reader(iParityMsg);
+    OhmHeader header;
+    header.Internalise(reader);
+    TEST(header.MsgType() == OhmHeader::kMsgTypeAudioParity);
+    OhmHeaderAudioParity headerParity;
+    headerParity.Internalise(reader, header);
+    Brn parity = reader.Read(headerParity.ParityBytes());
+    TEST(parity.Bytes() == headerParity.ParityBytes());
+    return iDecoder->TryRecover(headerParity, parity, iRecovered, aFrame);
+}
+
+void SuiteOhmParity::TestRecoverEachPosition()
+{
+    TUint frame = 0;
+    // decoder can't recover anything until it has seen a parity msg
+    AddGroup(iFirstFrame, 3, UINT_MAX);
+    TEST(iDecoder->GroupFrames() == 0);
+    TEST(!TryRecover(frame));
+    TEST(iDecoder->GroupFrames() == kGroupFrames);
+
+    for (TUint i=0; i<5; i++) {
+        const TUint first = iFirstFrame + (i+1) * kGroupFrames;
+        const TUint lost = (i * 3) % kGroupFrames;
+        AddGroup(first, lost, UINT_MAX);
+        TEST(TryRecover(frame));
+        TEST(frame == first + lost);
+        TEST(iRecovered == Msg(first + lost));
+    }
+}
+
+void SuiteOhmParity::TestResentIgnored()
+{
+    TUint frame = 0;
+    AddGroup(iFirstFrame, UINT_MAX, UINT_MAX);
+    (void)TryRecover(frame);
+
+    const TUint first = iFirstFrame + kGroupFrames;
+    EncodeGroup(first);
+    for (TUint i=0; i<kGroupFrames; i++) {
+        if (i == 2) {
+            continue;
+        }
+        Bwh resent(Msg(first + i).Bytes());
+        resent.Replace(Msg(first + i));
+        if (i == 5) {
+            resent[kFlagsOffset] |= OhmHeaderAudio::kFlagResent;
+        }
+        iDecoder->Add(first + i, resent);
+    }
+    TEST(TryRecover(frame));
+    TEST(frame == first + 2);
+    TEST(iRecovered == Msg(first + 2));
+}
+
+void SuiteOhmParity::TestDuplicatesIgnored()
+{
+    TUint frame = 0;
+    AddGroup(iFirstFrame, UINT_MAX, UINT_MAX);
+    (void)TryRecover(frame);
+
+    const TUint first = iFirstFrame + kGroupFrames;
+    AddGroup(first, 7, UINT_MAX);
+    iDecoder->Add(first + 1, Msg(first + 1));
+    iDecoder->Add(first + 4, Msg(first + 4));
+    TEST(TryRecover(frame));
+    TEST(frame == first + 7);
+    TEST(iRecovered == Msg(first + 7));
+    // late parity msg is ignored
+    TEST(!TryRecover(frame));
+}
+
+void SuiteOhmParity::TestTwoLostNotRecovered()
+{
+    TUint frame = 0;
+    AddGroup(iFirstFrame, UINT_MAX, UINT_MAX);
+    (void)TryRecover(frame);
+
+    AddGroup(iFirstFrame + kGroupFrames, 1, 6);
+    TEST(!TryRecover(frame));
+    // next group is unaffected
+    const TUint first = iFirstFrame + 2 * kGroupFrames;
+    AddGroup(first, 0, UINT_MAX);
+    TEST(TryRecover(frame));
+    TEST(frame == first);
+    TEST(iRecovered == Msg(first));
+}
+
+void SuiteOhmParity::TestNothingLost()
+{
+    TUint frame = 0;
+    AddGroup(iFirstFrame, UINT_MAX, UINT_MAX);
+    (void)TryRecover(frame);
+    AddGroup(iFirstFrame + kGroupFrames, UINT_MAX, UINT_MAX);
+    TEST(!TryRecover(frame));
+}
+
+void SuiteOhmParity::TestLostParityMsg()
+{
+    TUint frame = 0;
+    AddGroup(iFirstFrame, UINT_MAX, UINT_MAX);
+    (void)TryRecover(frame);
+
+    // parity msg for the group with a lost frame is itself lost; following group still recovers
+    AddGroup(iFirstFrame + kGroupFrames, 4, UINT_MAX);
+    const TUint first = iFirstFrame + 2 * kGroupFrames;
+    AddGroup(first, 5, UINT_MAX);
+    TEST(TryRecover(frame));
+    TEST(frame == first + 5);
+    TEST(iRecovered == Msg(first + 5));
+    TEST(iDecoder->GroupFrames() == kGroupFrames);
+}
+
+void SuiteOhmParity::TestStopsWithoutParity()
+{
+    TUint frame = 0;
+    AddGroup(iFirstFrame, UINT_MAX, UINT_MAX);
+    (void)TryRecover(frame);
+    TEST(iDecoder->GroupFrames() == kGroupFrames);
+
+    for (TUint i=1; i<5; i++) {
+        AddGroup(iFirstFrame + i * kGroupFrames, UINT_MAX, UINT_MAX);
+    }
+    TEST(iDecoder->GroupFrames() == 0);
+
+    // decoder resumes once parity msgs return
+    (void)TryRecover(frame);
+    TEST(iDecoder->GroupFrames() == kGroupFrames);
+    const TUint first = iFirstFrame + 5 * kGroupFrames;
+    AddGroup(first, 6, UINT_MAX);
+    TEST(TryRecover(frame));
+    TEST(frame == first + 6);
+    TEST(iRecovered == Msg(first + 6));
+}
+
+void SuiteOhmParity::TestEncoderRestart()
+{
+    for (TUint i=0; i<3; i++) {
+        TEST(!iEncoder->Add(iFirstFrame + 20 + i, Msg(iFirstFrame + 20 + i)));
+    }
+    // sender frame count restarting abandons the partial group
+    EncodeGroup(iFirstFrame);
+    iEncoder->Reset();
+    for (TUint i=0; i<3; i++) {
+        TEST(!iEncoder->Add(iFirstFrame + i, Msg(iFirstFrame + i)));
+    }
+    iEncoder->Reset();
+    EncodeGroup(iFirstFrame + kGroupFrames);
+
+    ReaderBuffer reader(iParityMsg);
+    OhmHeader header;
+    header.Internalise(reader);
+    OhmHeaderAudioParity headerParity;
+    headerParity.Internalise(reader, header);
+    TEST(headerParity.FirstFrame() == iFirstFrame + kGroupFrames);
+    TEST(headerParity.FrameCount() == kGroupFrames);
+}
+
+void SuiteOhmParity::TestMisalignedGroup()
+{
+    TUint frame = 0;
+    AddGroup(iFirstFrame, UINT_MAX, UINT_MAX);
+    (void)TryRecover(frame);
+
+    // receive all frames for the next three groups, then a parity msg from a restarted
+    // encoder whose group doesn't line up with them
+    for (TUint i=kGroupFrames; i<4*kGroupFrames; i++) {
+        iDecoder->Add(iFirstFrame + i, Msg(iFirstFrame + i));
+    }
+    iEncoder->Reset();
+    EncodeGroup(iFirstFrame + kGroupFrames + 3);
+    TEST(!TryRecover(frame));
+
+    // following groups are aligned with the new parity msg
+    const TUint first = iFirstFrame + 2 * kGroupFrames + 3;
+    AddGroup(first, 4, UINT_MAX);
+    for (TUint i=kGroupFrames; i<3*kGroupFrames; i++) {
+        iDecoder->Add(first + i, Msg(first + i));
+    }
+    TEST(TryRecover(frame));
+    TEST(frame == first + 4);
+    TEST(iRecovered == Msg(first + 4));
+}
+
+void SuiteOhmParity::TestGroupResized()
+{
+    static const TUint kGroupFramesSmall = 4;
+    TUint frame = 0;
+    AddGroup(iFirstFrame, UINT_MAX, UINT_MAX);
+    (void)TryRecover(frame);
+    for (TUint i=kGroupFrames; i<4*kGroupFrames; i++) {
+        iDecoder->Add(iFirstFrame + i, Msg(iFirstFrame + i));
+    }
+
+    // sender switches to smaller groups, starting part way through one of the larger ones
+    OhmParityEncoder encoder(kGroupFramesSmall);
+    const TUint first = iFirstFrame + kGroupFrames + kGroupFramesSmall;
+    for (TUint i=0; i<kGroupFramesSmall; i++) {
+        (void)encoder.Add(first + i, Msg(first + i));
+    }
+    iParityMsg.Replace(encoder.ParityMsg());
+    TEST(!TryRecover(frame));
+    TEST(iDecoder->GroupFrames() == kGroupFramesSmall);
+
+    const TUint next = first + kGroupFramesSmall;
+    for (TUint i=0; i<3*kGroupFramesSmall; i++) {
+        if (i != 1) {
+            iDecoder->Add(next + i, Msg(next + i));
+        }
+    }
+    for (TUint i=0; i<kGroupFramesSmall; i++) {
+        (void)encoder.Add(next + i, Msg(next + i));
+    }
+    iParityMsg.Replace(encoder.ParityMsg());
+    TEST(TryRecover(frame));
+    TEST(frame == next + 1);
+    TEST(iRecovered == Msg(next + 1));
+
+    // ...then back to larger groups, not aligned with the smaller ones
+    iEncoder->Reset();
+    const TUint last = next + kGroupFramesSmall + 2;
+    AddGroup(last, UINT_MAX, UINT_MAX);
+    TEST(!TryRecover(frame));
+    TEST(iDecoder->GroupFrames() == kGroupFrames);
+    AddGroup(last + kGroupFrames, 0, UINT_MAX);
+    TEST(TryRecover(frame));
+    TEST(frame == last + kGroupFrames);
+}
+
+void SuiteOhmParity::TestParityHeader()
+{
+    EncodeGroup(iFirstFrame);
+    ReaderBuffer reader(iParityMsg);
+    OhmHeader header;
+    header.Internalise(reader);
+    TEST(header.MsgType() == OhmHeader::kMsgTypeAudioParity);
+    TEST(header.MsgBytes() + OhmHeader::kHeaderBytes == iParityMsg.Bytes());
+    OhmHeaderAudioParity headerParity;
+    headerParity.Internalise(reader, header);
+    TEST(headerParity.FirstFrame() == iFirstFrame);
+    TEST(headerParity.FrameCount() == kGroupFrames);
+    TUint longest = 0;
+    TUint bytesXor = 0;
+    for (TUint i=0; i<kGroupFrames; i++) {
+        longest = std::max(longest, Msg(iFirstFrame + i).Bytes());
+        bytesXor ^= Msg(iFirstFrame + i).Bytes();
+    }
+    TEST(headerParity.ParityBytes() == longest);
+    TEST(headerParity.MsgBytesXor() == bytesXor);
+
+    // non-zero reserved byte is rejected
+    Bwh corrupt(iParityMsg.Bytes());
+    corrupt.Replace(iParityMsg);
+    corrupt[OhmHeader::kHeaderBytes + 5] = 1;
+    ReaderBuffer readerCorrupt(corrupt);
+    header.Internalise(readerCorrupt);
+    TEST_THROWS(headerParity.Internalise(readerCorrupt, header), OhmError);
+}
+
+
+
+void TestOhmParity()
+{
+    Runner runner("OhmParity tests\n");
+    runner.Add(new SuiteOhmParity());
+    runner.Run();
+}
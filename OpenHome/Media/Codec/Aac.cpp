@@ -17,6 +17,7 @@ public:
     ~CodecAac();
 private: // from CodecBase
     TBool Recognise(const EncodedStreamInfo& aStreamInfo);
+    Signature CheckSignature(const Brx& aHead) const;
     void StreamInitialise();
     void Process();
     TBool TrySeek(TUint aStreamId, TUint64 aSample);
@@ -80,6 +81,15 @@ TBool CodecAac::Recognise(const EncodedStreamInfo& aStreamInfo)
     return false;
 }
 
+CodecBase::Signature CodecAac::CheckSignature(const Brx& aHead) const
+{
+    // Mpeg4 container passes on the sample entry type ahead of the audio
+    if (aHead.Bytes() >= 4 && Brn(aHead.Ptr(), 4) == Brn("mp4a")) {
+        return Signature::eMatch;
+    }
+    return Signature::eNoMatch;
+}
+
 TUint CodecAac::SkipEsdsTag(IReader& aReader, TByte& aDescLen)
 {
     TUint skip = 0;
@@ -238,14 +248,8 @@ void CodecAac::StreamInitialise()
         }
 
         // Read sample size table.
-        ReaderBinary readerBin(codecBufReader);
         iSampleSizeTable.Clear();
-        const TUint sampleCount = readerBin.ReadUintBe(4);
-        iSampleSizeTable.Init(sampleCount);
-        for (TUint i=0; i<sampleCount; i++) {
-            const TUint sampleSize = readerBin.ReadUintBe(4);
-            iSampleSizeTable.AddSampleSize(sampleSize);
-        }
+        iSampleSizeTable.Read(codecBufReader);
 
         // Read seek table.
         iSeekTable.Deinitialise();
@@ -35,6 +35,14 @@ TBool CodecAiffBase::Recognise(const EncodedStreamInfo& aStreamInfo)
     return false;
 }
 
+CodecBase::Signature CodecAiffBase::CheckSignature(const Brx& aHead) const
+{
+    if (aHead.Bytes() >= 12 && Brn(aHead.Ptr(), 4) == Brn("FORM") && Brn(aHead.Ptr()+8, 4) == iName) {
+        return Signature::eMatch;
+    }
+    return Signature::eNoMatch;
+}
+
 void CodecAiffBase::StreamInitialise()
 {
     iNumChannels = 0;
@@ -15,6 +15,7 @@ protected:
     ~CodecAiffBase();
 private: // from CodecBase
     TBool Recognise(const EncodedStreamInfo& aStreamInfo);
+    Signature CheckSignature(const Brx& aHead) const;
     void StreamInitialise();
     void Process();
     TBool TrySeek(TUint aStreamId, TUint64 aSample);
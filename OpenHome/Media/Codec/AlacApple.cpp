@@ -26,6 +26,7 @@ public:
     ~CodecAlacApple();
 private: // from CodecBase
     TBool Recognise(const EncodedStreamInfo& aStreamInfo);
+    Signature CheckSignature(const Brx& aHead) const;
     void StreamInitialise();
     void Process();
     TBool TrySeek(TUint aStreamId, TUint64 aSample);
@@ -86,6 +87,14 @@ TBool CodecAlacApple::Recognise(const EncodedStreamInfo& aStreamInfo)
     return false;
 }
 
+CodecBase::Signature CodecAlacApple::CheckSignature(const Brx& aHead) const
+{
+    if (aHead.Bytes() >= 4 && Brn(aHead.Ptr(), 4) == Brn("alac")) {
+        return Signature::eMatch;
+    }
+    return Signature::eNoMatch;
+}
+
 void CodecAlacApple::StreamInitialise()
 {
     LOG(kCodec, "CodecAlac::StreamInitialise\n");
@@ -119,14 +128,8 @@ void CodecAlacApple::StreamInitialise()
         }
 
         // Read sample size table.
-        ReaderBinary readerBin(codecBufReader);
         iSampleSizeTable.Clear();
-        const TUint sampleCount = readerBin.ReadUintBe(4);
-        iSampleSizeTable.Init(sampleCount);
-        for (TUint i=0; i<sampleCount; i++) {
-            const TUint sampleSize = readerBin.ReadUintBe(4);
-            iSampleSizeTable.AddSampleSize(sampleSize);
-        }
+        iSampleSizeTable.Read(codecBufReader);
 
         // Read seek table.
         iSeekTable.Deinitialise();
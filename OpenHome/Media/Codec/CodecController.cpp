@@ -2,12 +2,15 @@
 #include <OpenHome/Media/Codec/Container.h>
 #include <OpenHome/Types.h>
 #include <OpenHome/Buffer.h>
+#include <OpenHome/OsWrapper.h>
+#include <OpenHome/Net/Private/Globals.h>
 #include <OpenHome/Private/Printer.h>
 #include <OpenHome/Private/Debug.h>
 #include <OpenHome/Media/Pipeline/Msg.h>
 #include <OpenHome/Media/Codec/Id3v2.h>
 #include <OpenHome/Media/Pipeline/Rewinder.h>
 #include <OpenHome/Media/Pipeline/Logger.h>
+#include <OpenHome/Media/Pipeline/PipelineMetrics.h>
 #include <OpenHome/Media/Debug.h>
 
 #include <algorithm>
@@ -128,6 +131,11 @@ CodecBase::~CodecBase()
 {
 }
 
+CodecBase::Signature CodecBase::CheckSignature(const Brx& /*aHead*/) const
+{
+    return Signature::eUnknown;
+}
+
 void CodecBase::StreamInitialise()
 {
 }
@@ -145,6 +153,8 @@ CodecBase::CodecBase(const TChar* aId, RecognitionComplexity aRecognitionCost)
     : iController(nullptr)
     , iId(aId)
     , iRecognitionCost(aRecognitionCost)
+    , iMetricsDecode(nullptr)
+    , iMetricsSeekRequests(nullptr)
 {
 }
 
@@ -191,6 +201,14 @@ CodecController::CodecController(MsgFactory& aMsgFactory, IPipelineElementUpstre
     , iTrackId(UINT_MAX)
     , iMaxOutputBytes(0)
     , iMaxOutputJiffies(aMaxOutputJiffies)
+    , iOsCtx(gEnv->OsCtx())
+    , iStreamStartUs(0)
+    , iFirstAudioPending(false)
+    , iMetrics(nullptr)
+    , iMetricsRecognition(nullptr)
+    , iMetricsFirstAudio(nullptr)
+    , iMetricsBlockedUs(0)
+    , iSeekRequests(0)
 {
     iDecoderThread = new ThreadFunctor("CodecController", MakeFunctor(*this, &CodecController::CodecThread), aThreadPriority);
     if (aLogger) {
@@ -230,6 +248,10 @@ void CodecController::AddCodec(CodecBase* aCodec)
         }
     }
     iCodecs.insert(it, aCodec);
+    iCandidates.reserve(iCodecs.size());
+    if (iMetrics != nullptr) {
+        RegisterMetrics(*aCodec);
+    }
 #if 0
     Log::Print("Sorted codecs are: ");
     it = iCodecs.begin();
@@ -245,6 +267,36 @@ void CodecController::Start()
     iDecoderThread->Start();
 }
 
+void CodecController::SetMetrics(PipelineMetrics& aMetrics)
+{
+    ASSERT(iMetrics == nullptr);
+    iMetrics = &aMetrics;
+    iMetricsRecognition = &iMetrics->RegisterHistogram("CodecController", "recognition", "us");
+    iMetricsFirstAudio = &iMetrics->RegisterHistogram("CodecController", "firstAudio", "us");
+    if (iLoggerRewinder != nullptr) {
+        iLoggerRewinder->SetMetrics(aMetrics);
+    }
+    for (auto codec : iCodecs) {
+        RegisterMetrics(*codec);
+    }
+}
+
+void CodecController::RegisterMetrics(CodecBase& aCodec)
+{
+    aCodec.iMetricsDecode = &iMetrics->RegisterHistogram(aCodec.iId, "decode", "us");
+    aCodec.iMetricsSeekRequests = &iMetrics->RegisterHistogram(aCodec.iId, "seekRequests", "requests");
+}
+
+void CodecController::ProcessWithMetrics()
+{
+    const TUint64 start = iMetrics->NowUs();
+    iMetricsBlockedUs = 0;
+    iActiveCodec->Process();
+    const TUint64 elapsed = iMetrics->NowUs() - start;
+    const TUint64 cost = (elapsed > iMetricsBlockedUs? elapsed - iMetricsBlockedUs : 0);
+    iActiveCodec->iMetricsDecode->Add((TUint)cost);
+}
+
 void CodecController::StartSeek(TUint aStreamId, TUint aSecondsAbsolute, ISeekObserver& aObserver, TUint& aHandle)
 {
     AutoMutex a(iLock);
@@ -324,10 +376,15 @@ void CodecController::CodecThread()
             }
 
             LOG(kMedia, "CodecThread: start recognition.  iTrackId=%u, iStreamId=%u\n", iTrackId, iStreamId);
+            iStreamStartUs = OsTimeInUs(iOsCtx);
+            iFirstAudioPending = true;
             TBool streamEnded = false;
+            SelectCandidates(streamInfo, streamEnded);
 
-            for (size_t i=0; i<iCodecs.size() && !iQuit && !iStreamStopped; i++) {
-                CodecBase* codec = iCodecs[i];
+            TUint attempts = 0;
+            for (size_t i=0; i<iCandidates.size() && !iQuit && !iStreamStopped; i++) {
+                CodecBase* codec = iCandidates[i];
+                attempts++;
                 TBool recognised = false;
                 try {
                     recognised = codec->Recognise(streamInfo);
@@ -360,7 +417,12 @@ void CodecController::CodecThread()
             if (iQuit) {
                 break;
             }
-            LOG(kMedia, "CodecThread: recognition complete\n");
+            const TUint64 recognitionUs = OsTimeInUs(iOsCtx) - iStreamStartUs;
+            LOG(kMedia, "CodecThread: recognition complete (%s after %u attempt(s), %lluus)\n",
+                        (iActiveCodec == nullptr? "none" : iActiveCodec->Id()), attempts, recognitionUs);
+            if (iMetrics != nullptr && iMetrics->Enabled()) {
+                iMetricsRecognition->Add((TUint)recognitionUs);
+            }
             if (iActiveCodec == nullptr) {
                 if (iStreamId != 0  && // FIXME - hard-coded assumption about Filler's NullTrack
                     !iStreamStopped && // we wouldn't necessarily expect to recognise a track if we're told to stop
@@ -390,12 +452,18 @@ void CodecController::CodecThread()
                     const TUint seekHandle = iSeekHandle;
                     iLock.Signal();
                     if (!seek) {
-                        iActiveCodec->Process();
+                        if (iMetrics != nullptr && iMetrics->Enabled()) {
+                            ProcessWithMetrics();
+                        }
+                        else {
+                            iActiveCodec->Process();
+                        }
                     }
                     else {
                         iExpectedSeekFlushId = MsgFlush::kIdInvalid;
                         TUint64 sampleNum = iSeekSeconds * static_cast<TUint64>(iSampleRate);
                         iSeekInProgress = true;
+                        iSeekRequests = 0;
                         try {
                             (void)iActiveCodec->TrySeek(iStreamId, sampleNum);
                         }
@@ -405,6 +473,9 @@ void CodecController::CodecThread()
                             throw;
                         }
                         iSeekInProgress = false;
+                        if (iMetrics != nullptr && iMetrics->Enabled()) {
+                            iActiveCodec->iMetricsSeekRequests->Add(iSeekRequests);
+                        }
                         iLock.Wait();
                         const TBool notify = (iSeek && iSeekHandle == seekHandle);
                         if (notify) {
@@ -464,6 +535,59 @@ void CodecController::CodecThread()
     }
 }
 
+void CodecController::SelectCandidates(const EncodedStreamInfo& aStreamInfo, TBool& aStreamEnded)
+{
+    iCandidates.clear();
+    if (aStreamInfo.StreamFormat() != EncodedStreamInfo::Format::Encoded || iCodecs.size() < 2) {
+        // Pcm/Dsd streams are described by their MsgEncodedStream.  Recognition doesn't read any data.
+        // There's also nothing to reorder if we only have a single codec.
+        iCandidates.insert(iCandidates.end(), iCodecs.begin(), iCodecs.end());
+        return;
+    }
+
+    iSignatureBuf.SetBytes(0);
+    try {
+        Read(iSignatureBuf, iSignatureBuf.MaxBytes());
+    }
+    catch (CodecStreamStart&) {}
+    catch (CodecStreamEnded&) {}
+    catch (CodecStreamStopped&) {}
+    catch (CodecStreamFlush&) {
+        return; // no candidates; stream will be treated as unrecognised
+    }
+    catch (CodecRecognitionOutOfData&) {}
+    iLock.Wait();
+    if (iStreamStarted || iStreamEnded) {
+        aStreamEnded = true;
+    }
+    iStreamStarted = iStreamEnded = false;
+    Rewind();
+    iLock.Signal();
+
+    // codecs claiming the stream go first, preserving their relative order; codecs that can't tell follow
+    TUint matches = 0;
+    for (auto codec : iCodecs) {
+        switch (codec->CheckSignature(iSignatureBuf))
+        {
+        case CodecBase::Signature::eMatch:
+            iCandidates.insert(iCandidates.begin() + matches, codec);
+            matches++;
+            break;
+        case CodecBase::Signature::eUnknown:
+            iCandidates.push_back(codec);
+            break;
+        case CodecBase::Signature::eNoMatch:
+            break;
+        }
+    }
+    if (matches == 1) {
+        LOG(kMedia, "CodecThread: signature matches %s\n", iCandidates[0]->Id());
+    }
+    else {
+        LOG(kMedia, "CodecThread: signature ambiguous (%u matches, %u candidates)\n", matches, (TUint)iCandidates.size());
+    }
+}
+
 void CodecController::Rewind()
 {
     iRewinder.Rewind();
@@ -485,7 +609,15 @@ Msg* CodecController::PullMsg()
             THROW(CodecStreamFlush);
         }
     }
-    Msg* msg = iUpstream->Pull();
+    Msg* msg;
+    if (iMetrics != nullptr && iMetrics->Enabled()) {
+        const TUint64 start = iMetrics->NowUs();
+        msg = iUpstream->Pull();
+        iMetricsBlockedUs += iMetrics->NowUs() - start;
+    }
+    else {
+        msg = iUpstream->Pull();
+    }
     if (msg == nullptr) {
         ASSERT(iRecognising);
         THROW(CodecRecognitionOutOfData);
@@ -498,7 +630,14 @@ Msg* CodecController::PullMsg()
 
 void CodecController::Queue(Msg* aMsg)
 {
-    iDownstreamElement.Push(aMsg);
+    if (iMetrics != nullptr && iMetrics->Enabled()) {
+        const TUint64 start = iMetrics->NowUs();
+        iDownstreamElement.Push(aMsg);
+        iMetricsBlockedUs += iMetrics->NowUs() - start;
+    }
+    else {
+        iDownstreamElement.Push(aMsg);
+    }
     if (iQuit) {
         iShutdownSem.Signal();
     }
@@ -611,6 +750,7 @@ MsgAudioEncoded* CodecController::ReadNextMsg()
 TBool CodecController::Read(IWriter& aWriter, TUint64 aOffset, TUint aBytes)
 {
     if (!iStreamEnded && !iQuit) {
+        iSeekRequests++;
         return iUrlBlockWriter.TryGet(aWriter, iTrackUri, aOffset, aBytes);
     }
     return false;
@@ -639,6 +779,7 @@ TBool CodecController::TrySeekTo(TUint aStreamId, TUint64 aBytePos)
         }
         return false;
     }
+    iSeekRequests++;
     TUint flushId = streamHandler->TrySeek(aStreamId, aBytePos);
     LOG(kPipeline, "CodecController::TrySeekTo(%u, %llu) returning %u\n", aStreamId, aBytePos, flushId);
     if (flushId != MsgFlush::kIdInvalid) {
@@ -662,6 +803,11 @@ TUint64 CodecController::StreamPos() const
     return iStreamPos;
 }
 
+const Brx& CodecController::StreamUri() const
+{
+    return iTrackUri;
+}
+
 void CodecController::OutputDecodedStream(TUint aBitRate, TUint aBitDepth, TUint aSampleRate,
                                           TUint aNumChannels, const Brx& aCodecName,
                                           TUint64 aTrackLength, TUint64 aSampleStart,
@@ -802,6 +948,14 @@ TUint64 CodecController::DoOutputAudio(MsgAudio* aAudioMsg)
         Queue(iPostSeekStreamInfo);
         iPostSeekStreamInfo = nullptr;
     }
+    if (iFirstAudioPending) {
+        iFirstAudioPending = false;
+        const TUint64 firstAudioUs = OsTimeInUs(iOsCtx) - iStreamStartUs;
+        LOG(kMedia, "CodecController: time to first audio %lluus (iStreamId=%u)\n", firstAudioUs, iStreamId);
+        if (iMetrics != nullptr && iMetrics->Enabled()) {
+            iMetricsFirstAudio->Add((TUint)firstAudioUs);
+        }
+    }
     const TUint jiffies= aAudioMsg->Jiffies();
     Queue(aAudioMsg);
     return jiffies;
@@ -21,6 +21,8 @@ namespace OpenHome {
 namespace Media {
     class Logger;
     class MsgAudioEncoded;
+    class PipelineMetrics;
+    class MetricsHistogram;
 namespace Codec {
 
 /**
@@ -102,6 +104,14 @@ public:
      * @return     Number of bytes the codec has consumed from the stream.
      */
     virtual TUint64 StreamPos() const = 0;
+    /**
+     * Query the uri of the current stream.
+     *
+     * Allows codecs to cache per-stream information (e.g. seek tables) across plays.
+     *
+     * @return     Uri of the track the current stream belongs to.
+     */
+    virtual const Brx& StreamUri() const = 0;
     /**
      * Notify the pipeline of a new stream or a discontinuity in the current stream.
      *
@@ -307,6 +317,13 @@ public:
        ,kCostMedium
        ,kCostHigh
     };
+    enum class Signature
+    {
+        eMatch,
+        eNoMatch,
+        eUnknown
+    };
+    static const TUint kSignatureBytes = 64;
 public:
     virtual ~CodecBase();
 public:
@@ -322,6 +339,20 @@ public:
      * @return     true if this codec can decode the audio stream; false otherwise.
      */
     virtual TBool Recognise(const EncodedStreamInfo& aStreamInfo) = 0;
+    /**
+     * Cheaply check whether an encoded stream looks like one handled by this codec.
+     *
+     * Called, for encoded streams only, before Recognise() is tried for any codec.
+     * Must not read from iController.  Codecs that claim eMatch are tried first; codecs
+     * that report eNoMatch are not asked to Recognise() the stream at all so should only
+     * do so when Recognise() would certainly fail.
+     *
+     * @param[in] aHead          Up to kSignatureBytes from the start of the stream.
+     *                           Will be shorter for very short streams.
+     *
+     * @return     eUnknown (the default) if aHead isn't enough to decide.
+     */
+    virtual Signature CheckSignature(const Brx& aHead) const;
     /**
      * Notify a codec that decoding of a stream is about to begin.
      *
@@ -375,6 +406,8 @@ protected:
 private:
     const TChar* iId;
     RecognitionComplexity iRecognitionCost;
+    MetricsHistogram* iMetricsDecode;
+    MetricsHistogram* iMetricsSeekRequests;
 };
 
 class CodecController : public ISeeker, private ICodecController, private IMsgProcessor, private IStreamHandler, private INonCopyable
@@ -385,8 +418,18 @@ public:
     virtual ~CodecController();
     void AddCodec(CodecBase* aCodec);
     void Start();
+    /**
+     * Record the cost of each call to CodecBase::Process(), per codec.
+     *
+     * Time spent blocked pulling encoded audio or pushing decoded audio is excluded.
+     * Also records how long each stream took to be recognised and to output its first audio.
+     */
+    void SetMetrics(PipelineMetrics& aMetrics);
 private:
     void CodecThread();
+    void SelectCandidates(const EncodedStreamInfo& aStreamInfo, TBool& aStreamEnded);
+    void RegisterMetrics(CodecBase& aCodec);
+    void ProcessWithMetrics();
     void Rewind();
     Msg* PullMsg();
     void Queue(Msg* aMsg);
@@ -405,6 +448,7 @@ private: // ICodecController
     TBool TrySeekTo(TUint aStreamId, TUint64 aBytePos) override;
     TUint64 StreamLength() const override;
     TUint64 StreamPos() const override;
+    const Brx& StreamUri() const override;
     void OutputDecodedStream(TUint aBitRate, TUint aBitDepth, TUint aSampleRate, TUint aNumChannels, const Brx& aCodecName, TUint64 aTrackLength, TUint64 aSampleStart, TBool aLossless, SpeakerProfile aProfile, TBool aAnalogBypass) override;
     void OutputDecodedStreamDsd(TUint aSampleRate, TUint aNumChannels, const Brx& aCodecName, TUint64 aLength, TUint64 aSampleStart, SpeakerProfile aProfile) override;
     void OutputDelay(TUint aJiffies) override;
@@ -452,6 +496,8 @@ private:
     Mutex iLock;
     Semaphore iShutdownSem;
     std::vector<CodecBase*> iCodecs;
+    std::vector<CodecBase*> iCandidates; // iCodecs, in the order they'll be tried for the current stream
+    Bws<CodecBase::kSignatureBytes> iSignatureBuf;
     ThreadFunctor* iDecoderThread;
     CodecBase* iActiveCodec;
     Msg* iPendingMsg;
@@ -490,6 +536,14 @@ private:
     TUint iTrackId;
     TUint iMaxOutputBytes;
     const TUint iMaxOutputJiffies;
+    OsContext* iOsCtx;
+    TUint64 iStreamStartUs;
+    TBool iFirstAudioPending;
+    PipelineMetrics* iMetrics;
+    MetricsHistogram* iMetricsRecognition;
+    MetricsHistogram* iMetricsFirstAudio;
+    TUint64 iMetricsBlockedUs; // only accessed from iDecoderThread
+    TUint iSeekRequests; // range requests (seeks or out-of-band reads) made by the current TrySeek; only accessed from iDecoderThread
 };
 
 class CodecBufferedReader : public IReader, private INonCopyable
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <OpenHome/Types.h>
+
 namespace OpenHome {
+    class IThreadPool;
 namespace Av {
     class OhmMsgFactory;
 }
@@ -19,6 +22,8 @@ public:
     static CodecBase* NewAlacApple(IMimeTypeList& aMimeTypeList);
     static CodecBase* NewAdts(IMimeTypeList& aMimeTypeList);
     static CodecBase* NewFlac(IMimeTypeList& aMimeTypeList);
+    // Decodes up to aMaxFramesInFlight frames of suitable native FLAC streams concurrently on aThreadPool
+    static CodecBase* NewFlac(IMimeTypeList& aMimeTypeList, IThreadPool& aThreadPool, TUint aMaxFramesInFlight);
     static CodecBase* NewMp3(IMimeTypeList& aMimeTypeList);
     static CodecBase* NewDsdDsf(IMimeTypeList& aMimeTypeList);
     static CodecBase* NewDsdDff(IMimeTypeList& aMimeTypeList);
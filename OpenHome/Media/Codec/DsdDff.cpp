@@ -32,6 +32,7 @@ public:
     CodecDsdDff(IMimeTypeList& aMimeTypeList);
 private: // from CodecBase
     TBool Recognise(const EncodedStreamInfo& aStreamInfo) override;
+    Signature CheckSignature(const Brx& aHead) const override;
     void StreamInitialise() override;
     void Process() override;
     TBool TrySeek(TUint aStreamId, TUint64 aSample) override;
@@ -104,6 +105,14 @@ TBool CodecDsdDff::Recognise(const EncodedStreamInfo& aStreamInfo)
     return true;
 }
 
+CodecBase::Signature CodecDsdDff::CheckSignature(const Brx& aHead) const
+{
+    if (aHead.Bytes() >= 4 && Brn(aHead.Ptr(), 4) == Brn("FRM8")) {
+        return Signature::eMatch;
+    }
+    return Signature::eNoMatch;
+}
+
 
 void CodecDsdDff::ProcessFormChunk()
 {
@@ -36,6 +36,7 @@ public:
     CodecDsdDsf(IMimeTypeList& aMimeTypeList);
 private: // from CodecBase
     TBool Recognise(const EncodedStreamInfo& aStreamInfo) override;
+    Signature CheckSignature(const Brx& aHead) const override;
     void StreamInitialise() override;
     void Process() override;
     TBool TrySeek(TUint aStreamId, TUint64 aSample) override;
@@ -294,6 +295,14 @@ TBool CodecDsdDsf::Recognise(const EncodedStreamInfo& aStreamInfo)
     return ReadChunkId(Brn("DSD "));
 }
 
+CodecBase::Signature CodecDsdDsf::CheckSignature(const Brx& aHead) const
+{
+    if (aHead.Bytes() >= 4 && Brn(aHead.Ptr(), 4) == Brn("DSD ")) {
+        return Signature::eMatch;
+    }
+    return Signature::eNoMatch;
+}
+
 void CodecDsdDsf::ProcessHeader()
 {
     LOG(kMedia, "CodecDsdDsf::ProcessHeader()\n");
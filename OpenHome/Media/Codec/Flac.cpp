@@ -1,28 +1,73 @@
 #include <OpenHome/Media/Codec/CodecController.h>
 #include <OpenHome/Media/Codec/CodecFactory.h>
 #include <OpenHome/Media/Codec/Container.h>
+#include <OpenHome/Media/Codec/FlacSeekIndex.h>
+#include <OpenHome/Media/Codec/FlacFrameSplitter.h>
+#include <OpenHome/Media/Pipeline/PcmKernels.h>
 #include <FLAC/format.h>
 #include <FLAC/stream_decoder.h>
 #include <OpenHome/Types.h>
 #include <OpenHome/Buffer.h>
 #include <OpenHome/Private/Printer.h>
 #include <OpenHome/Private/Debug.h>
+#include <OpenHome/Media/Debug.h>
 #include <OpenHome/Media/MimeTypeList.h>
+#include <OpenHome/Private/Thread.h>
+#include <OpenHome/ThreadPool.h>
 
 #include <algorithm>
 #include <string.h>
+#include <vector>
 
 namespace OpenHome {
 namespace Media {
 namespace Codec {
 
+/*
+Decodes a single frame, already delimited by FlacFrameSplitter, on a thread pool thread.
+CodecFlac owns several of these so that consecutive frames can be decoded concurrently.
+*/
+
+class FlacFrameDecoder : private INonCopyable
+{
+public:
+    FlacFrameDecoder(IThreadPool& aThreadPool);
+    ~FlacFrameDecoder();
+    void Initialise(const FLAC__StreamMetadata_StreamInfo& aStreamInfo, TUint aMaxFrameBytes);
+    void Decode(const FlacFrameSplitter::Frame& aFrame);
+    void Wait();
+    TBool Succeeded() const;
+    TUint64 Sample() const;
+    TUint SampleRate() const;
+    const Brx& Pcm() const; // big endian, interleaved
+public:
+    FLAC__StreamDecoderReadStatus CallbackRead(TUint8 aBuffer[], TUint* aBytes);
+    FLAC__StreamDecoderWriteStatus CallbackWrite(const FLAC__Frame* aFrame, const TInt32* const aBuffer[]);
+    void CallbackError();
+private:
+    void DecodeCallback();
+private:
+    FLAC__StreamDecoder* iDecoder;
+    IThreadPoolHandle* iHandle;
+    Semaphore iSem;
+    Bwh iEncoded;
+    TUint iEncodedPos;
+    Bwh iPcm;
+    TUint64 iSample;
+    TUint iSampleRate;
+    TUint iBitDepth;
+    TBool iError;
+};
+
 class CodecFlac : public CodecBase
 {
 public:
     CodecFlac(IMimeTypeList& aMimeTypeList);
+    CodecFlac(IMimeTypeList& aMimeTypeList, IThreadPool& aThreadPool, TUint aMaxFramesInFlight);
     ~CodecFlac();
 private: // from CodecBase
     TBool Recognise(const EncodedStreamInfo& aStreamInfo);
+    Signature CheckSignature(const Brx& aHead) const;
     void StreamInitialise();
     void Process();
     TBool TrySeek(TUint aStreamId, TUint64 aSample);
@@ -45,6 +90,26 @@ public:
 
     void CallbackError(const FLAC__StreamDecoder* aDecoder,
                        FLAC__StreamDecoderErrorStatus aStatus);
+private:
+    static const TUint kMaxPrerollSeconds = 2;
+    static const TUint kMaxFrameBytesParallel = 256 * 1024;
+    static const TUint kMaxRecordedBytes = 16 * 1024;
+    static const TUint kMaxEstimatedSeeks = 3;
+private:
+    void Construct(IMimeTypeList& aMimeTypeList);
+    TBool TrySeekIndexed(TUint64 aSample);
+    TBool TrySeekBisect(TUint64 aSample);
+    void IndexFrame(const FLAC__StreamDecoder* aDecoder, TUint64 aFrameSample);
+    void CheckStreamFormat(TUint aSampleRate, TUint aChannels, TUint aBitDepth);
+    void Record(const Brx& aData);
+    void TryStartParallel();
+    void ProcessParallel();
+    TBool TrySeekParallel(TUint64 aSample);
+    void ReadParallel();
+    TBool TryReadFrame(FlacFrameSplitter::Frame& aFrame);
+    void Dispatch(const FlacFrameSplitter::Frame& aFrame);
+    void OutputFrame();
+    void DrainFrameDecoders();
 private:
     TByte iBuf[DecodedAudio::kMaxBytes];
     FLAC__StreamDecoder* iDecoder;
@@ -58,6 +123,28 @@ private:
     TBool iStreamMsgDue;
     TBool iOgg;
     TUint iStreamId;
+    FlacSeekIndex iSeekIndex;
+    TUint64 iTotalSamples;
+    TUint64 iFirstFrameOffset;
+    TBool iAwaitingFirstFrame;
+    TBool iFirstFrameOffsetKnown;
+    TUint64 iFrameEnd;
+    TBool iFrameEndKnown;
+    TUint64 iSeekSample;
+    TBool iSeekPending;
+    TBool iSeekMissed;
+    TUint64 iSeekMaxPreroll;    // further than this before iSeekSample means an estimated seek fell short
+    FLAC__StreamMetadata_StreamInfo iStreamInfo;
+    std::vector<FlacFrameDecoder*> iFrameDecoders;
+    FlacFrameSplitter* iSplitter;
+    TUint iMaxFrameBytes;   // upper bound for the current stream when decoding in parallel
+    Bwh iRecorded;          // most recent data passed to libFLAC, before the first frame
+    TBool iRecording;
+    TBool iParallel;
+    TBool iInputEnded;
+    TBool iNextStream;      // input ended because another stream started
+    TUint iOldestFrame;     // index into iFrameDecoders
+    TUint iFramesInFlight;
 };
 
 } // namespace Codec
@@ -73,6 +160,11 @@ CodecBase* CodecFactory::NewFlac(IMimeTypeList& aMimeTypeList)
     return new CodecFlac(aMimeTypeList);
 }
 
+CodecBase* CodecFactory::NewFlac(IMimeTypeList& aMimeTypeList, IThreadPool& aThreadPool, TUint aMaxFramesInFlight)
+{ // static
+    return new CodecFlac(aMimeTypeList, aThreadPool, aMaxFramesInFlight);
+}
+
 
 
 static inline CodecFlac* CodecFromClientData(void* aClientData)
@@ -130,6 +222,187 @@ void CallbackError(const FLAC__StreamDecoder *aDecoder,
     return CodecFromClientData(aClientData)->CallbackError(aDecoder, aStatus);
 }
 
+static inline FlacFrameDecoder* FrameDecoderFromClientData(void* aClientData)
+{
+    return reinterpret_cast<FlacFrameDecoder*>(aClientData);
+}
+
+static FLAC__StreamDecoderReadStatus FrameDecoderCallbackRead(const FLAC__StreamDecoder* /*aDecoder*/, TUint8 aBuffer[],
+                                                              size_t* aBytes, void* aClientData)
+{
+    return FrameDecoderFromClientData(aClientData)->CallbackRead(aBuffer, (TUint*)aBytes);
+}
+
+static FLAC__StreamDecoderWriteStatus FrameDecoderCallbackWrite(const FLAC__StreamDecoder* /*aDecoder*/,
+                                                                const FLAC__Frame* aFrame,
+                                                                const FLAC__int32* const aBuffer[],
+                                                                void* aClientData)
+{
+    return FrameDecoderFromClientData(aClientData)->CallbackWrite(aFrame, aBuffer);
+}
+
+static void FrameDecoderCallbackError(const FLAC__StreamDecoder* /*aDecoder*/,
+                                      FLAC__StreamDecoderErrorStatus /*aStatus*/, void* aClientData)
+{
+    FrameDecoderFromClientData(aClientData)->CallbackError();
+}
+
+
+// FlacFrameDecoder
+
+FlacFrameDecoder::FlacFrameDecoder(IThreadPool& aThreadPool)
+    : iSem("FLFD", 0)
+    , iEncoded(FLAC__STREAM_SYNC_LENGTH + FLAC__STREAM_METADATA_HEADER_LENGTH + FLAC__STREAM_METADATA_STREAMINFO_LENGTH)
+    , iEncodedPos(0)
+    , iSample(0)
+    , iSampleRate(0)
+    , iBitDepth(0)
+    , iError(false)
+{
+    iDecoder = FLAC__stream_decoder_new();
+    ASSERT(iDecoder != nullptr);
+    iHandle = aThreadPool.CreateHandle(MakeFunctor(*this, &FlacFrameDecoder::DecodeCallback),
+                                       "FlacFrameDecoder", ThreadPoolPriority::High);
+}
+
+FlacFrameDecoder::~FlacFrameDecoder()
+{
+    iHandle->Destroy();
+    FLAC__stream_decoder_delete(iDecoder);
+}
+
+void FlacFrameDecoder::Initialise(const FLAC__StreamMetadata_StreamInfo& aStreamInfo, TUint aMaxFrameBytes)
+{
+    if (FLAC__stream_decoder_get_state(iDecoder) != FLAC__STREAM_DECODER_UNINITIALIZED) {
+        (void)FLAC__stream_decoder_finish(iDecoder);
+    }
+    iBitDepth = aStreamInfo.bits_per_sample;
+    const TUint pcmBytes = aStreamInfo.max_blocksize * aStreamInfo.channels * (iBitDepth / 8);
+    if (iEncoded.MaxBytes() < aMaxFrameBytes) {
+        iEncoded.Grow(aMaxFrameBytes);
+    }
+    if (iPcm.MaxBytes() < pcmBytes) {
+        iPcm.Grow(pcmBytes);
+    }
+
+    /* Frames are decoded in isolation so prime libFLAC with a minimal stream header that
+       describes this stream.  total_samples is left unknown so that libFLAC doesn't try to
+       detect the end of the stream from the position of the frames it is given. */
+    iEncoded.Replace(Brn("fLaC"));
+    iEncoded.Append((TByte)0x80); // last metadata block, type STREAMINFO
+    iEncoded.Append((TByte)0);
+    iEncoded.Append((TByte)0);
+    iEncoded.Append((TByte)FLAC__STREAM_METADATA_STREAMINFO_LENGTH);
+    iEncoded.Append((TByte)(aStreamInfo.min_blocksize >> 8));
+    iEncoded.Append((TByte)aStreamInfo.min_blocksize);
+    iEncoded.Append((TByte)(aStreamInfo.max_blocksize >> 8));
+    iEncoded.Append((TByte)aStreamInfo.max_blocksize);
+    for (TUint i=0; i<6; i++) {
+        iEncoded.Append((TByte)0); // min/max frame size unknown
+    }
+    const TUint64 packed = ((TUint64)aStreamInfo.sample_rate << 44) |
+                           ((TUint64)(aStreamInfo.channels - 1) << 41) |
+                           ((TUint64)(aStreamInfo.bits_per_sample - 1) << 36);
+    for (TInt i=56; i>=0; i-=8) {
+        iEncoded.Append((TByte)(packed >> i));
+    }
+    for (TUint i=0; i<16; i++) {
+        iEncoded.Append((TByte)0); // MD5 unknown
+    }
+    iEncodedPos = 0;
+
+    const FLAC__StreamDecoderInitStatus initState = FLAC__stream_decoder_init_stream(
+        iDecoder,
+        FrameDecoderCallbackRead,
+        nullptr, nullptr, nullptr, nullptr,
+        FrameDecoderCallbackWrite,
+        nullptr,
+        FrameDecoderCallbackError,
+        this);
+    ASSERT(initState == FLAC__STREAM_DECODER_INIT_STATUS_OK);
+    ASSERT(FLAC__stream_decoder_process_until_end_of_metadata(iDecoder));
+}
+
+void FlacFrameDecoder::Decode(const FlacFrameSplitter::Frame& aFrame)
+{
+    iEncoded.Replace(aFrame.iPtr, aFrame.iBytes);
+    iSample = aFrame.iSample;
+    ASSERT(iHandle->TrySchedule());
+}
+
+void FlacFrameDecoder::Wait()
+{
+    iSem.Wait();
+}
+
+TBool FlacFrameDecoder::Succeeded() const
+{
+    return !iError;
+}
+
+TUint64 FlacFrameDecoder::Sample() const
+{
+    return iSample;
+}
+
+TUint FlacFrameDecoder::SampleRate() const
+{
+    return iSampleRate;
+}
+
+const Brx& FlacFrameDecoder::Pcm() const
+{
+    return iPcm;
+}
+
+void FlacFrameDecoder::DecodeCallback()
+{
+    iEncodedPos = 0;
+    iPcm.SetBytes(0);
+    iError = false;
+    (void)FLAC__stream_decoder_flush(iDecoder);
+    // libFLAC reports a frame that fails to decode via CallbackError then continues searching
+    // for the next frame, so treat a frame that didn't produce any audio as a failure too
+    if (!FLAC__stream_decoder_process_single(iDecoder) || iPcm.Bytes() == 0) {
+        iError = true;
+    }
+    iSem.Signal();
+}
+
+FLAC__StreamDecoderReadStatus FlacFrameDecoder::CallbackRead(TUint8 aBuffer[], TUint* aBytes)
+{
+    const TUint bytes = std::min(*aBytes, iEncoded.Bytes() - iEncodedPos);
+    if (bytes == 0) {
+        *aBytes = 0;
+        return FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM;
+    }
+    (void)memcpy(aBuffer, iEncoded.Ptr() + iEncodedPos, bytes);
+    iEncodedPos += bytes;
+    *aBytes = bytes;
+    return FLAC__STREAM_DECODER_READ_STATUS_CONTINUE;
+}
+
+FLAC__StreamDecoderWriteStatus FlacFrameDecoder::CallbackWrite(const FLAC__Frame* aFrame, const TInt32* const aBuffer[])
+{
+    const TUint channels = aFrame->header.channels;
+    const TUint samples = aFrame->header.blocksize;
+    const TUint bytes = samples * channels * (iBitDepth / 8);
+    // CallbackWrite runs on a thread pool thread so must not throw
+    if (aFrame->header.bits_per_sample != iBitDepth || bytes > iPcm.MaxBytes()) {
+        iError = true;
+        return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+    }
+    iSampleRate = aFrame->header.sample_rate;
+    PcmKernels::InterleaveToBigEndian(aBuffer, channels, samples, iBitDepth, const_cast<TByte*>(iPcm.Ptr()), iBitDepth);
+    iPcm.SetBytes(bytes);
+    return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+}
+
+void FlacFrameDecoder::CallbackError()
+{
+    iError = true;
+}
+
 
 // CodecFlac
 
@@ -137,16 +410,47 @@ CodecFlac::CodecFlac(IMimeTypeList& aMimeTypeList)
     : CodecBase("FLAC")
     , iName("FLAC")
     , iStreamMsgDue(true)
+    , iSplitter(nullptr)
+    , iMaxFrameBytes(0)
+{
+    Construct(aMimeTypeList);
+}
+
+CodecFlac::CodecFlac(IMimeTypeList& aMimeTypeList, IThreadPool& aThreadPool, TUint aMaxFramesInFlight)
+    : CodecBase("FLAC")
+    , iName("FLAC")
+    , iStreamMsgDue(true)
+    , iSplitter(nullptr)
+    , iMaxFrameBytes(0)
+    , iRecorded(kMaxRecordedBytes)
+{
+    ASSERT(aMaxFramesInFlight > 0);
+    Construct(aMimeTypeList);
+    for (TUint i=0; i<aMaxFramesInFlight; i++) {
+        iFrameDecoders.push_back(new FlacFrameDecoder(aThreadPool));
+    }
+    // room for a partial frame of the largest size we'll decode in parallel plus a full read
+    iSplitter = new FlacFrameSplitter(2 * kMaxFrameBytesParallel + sizeof(iBuf));
+}
+
+void CodecFlac::Construct(IMimeTypeList& aMimeTypeList)
 {
     iDecoder = FLAC__stream_decoder_new();
     ASSERT(iDecoder != nullptr);
-    // By default, only the STREAMINFO metadata block is returned, but let's just explicitly tell the decoder that's all we want.
+    // By default, only the STREAMINFO metadata block is returned.  We also want any SEEKTABLE so that seeks can be
+    // satisfied with a single request, rather than relying on libFLAC's bisection search.
     ASSERT(FLAC__stream_decoder_set_metadata_respond(iDecoder, FLAC__METADATA_TYPE_STREAMINFO));
+    ASSERT(FLAC__stream_decoder_set_metadata_respond(iDecoder, FLAC__METADATA_TYPE_SEEKTABLE));
     aMimeTypeList.Add("audio/x-flac");
 }
 
 CodecFlac::~CodecFlac()
 {
+    DrainFrameDecoders();
+    for (auto decoder : iFrameDecoders) {
+        delete decoder;
+    }
+    delete iSplitter;
     FLAC__stream_decoder_delete(iDecoder);
 }
 
@@ -175,6 +479,20 @@ TBool CodecFlac::Recognise(const EncodedStreamInfo& aStreamInfo)
     return false;
 }
 
+CodecBase::Signature CodecFlac::CheckSignature(const Brx& aHead) const
+{
+    // mirrors Recognise(), which only considers the first 42 bytes
+    if (aHead.Bytes() >= 4) {
+        if (Brn(aHead.Ptr(), 4) == Brn("fLaC")) {
+            return Signature::eMatch;
+        }
+        if (aHead.Bytes() >= 42 && Brn(aHead.Ptr(), 4) == Brn("OggS") && Brn(aHead.Ptr()+37, 4) == Brn("fLaC")) {
+            return Signature::eMatch;
+        }
+    }
+    return Signature::eNoMatch;
+}
+
 void CodecFlac::StreamInitialise()
 {
     iStreamMsgDue = true;
@@ -184,6 +502,24 @@ void CodecFlac::StreamInitialise()
     iNumChannels = 0;
     iBitDepth = 0;
     iTrackLengthJiffies = 0;
+    iSeekIndex.Reset();
+    iTotalSamples = 0;
+    iFirstFrameOffset = 0;
+    iAwaitingFirstFrame = false;
+    iFirstFrameOffsetKnown = false;
+    iFrameEnd = 0;
+    iFrameEndKnown = false;
+    iSeekSample = 0;
+    iSeekPending = false;
+    iSeekMissed = false;
+    iSeekMaxPreroll = 0;
+    iRecorded.SetBytes(0);
+    iRecording = (iSplitter != nullptr && !iOgg);
+    iParallel = false;
+    iInputEnded = false;
+    iNextStream = false;
+    iOldestFrame = 0;
+    iFramesInFlight = 0;
 
     FLAC__StreamDecoderState state;
     state = FLAC__stream_decoder_get_state(iDecoder);
@@ -233,8 +569,24 @@ void CodecFlac::StreamInitialise()
 
 void CodecFlac::Process()
 {
+    if (iParallel) {
+        ProcessParallel();
+        return;
+    }
     FLAC__stream_decoder_process_single(iDecoder);
     FLAC__StreamDecoderState state = FLAC__stream_decoder_get_state(iDecoder);
+    if (iAwaitingFirstFrame && state == FLAC__STREAM_DECODER_SEARCH_FOR_FRAME_SYNC) {
+        // libFLAC returns from process_single after each metadata block so we're now
+        // immediately after the final block, at the start of the first frame
+        iAwaitingFirstFrame = false;
+        iFirstFrameOffsetKnown = (FLAC__stream_decoder_get_decode_position(iDecoder, &iFirstFrameOffset) != 0);
+        iFrameEnd = iFirstFrameOffset;
+        iFrameEndKnown = iFirstFrameOffsetKnown;
+        if (iRecording) {
+            iRecording = false;
+            TryStartParallel();
+        }
+    }
     switch(state) {
         case FLAC__STREAM_DECODER_SEARCH_FOR_METADATA:
         case FLAC__STREAM_DECODER_READ_METADATA:
@@ -275,6 +627,62 @@ TBool CodecFlac::TrySeek(TUint aStreamId, TUint64 aSample)
 {
     iStreamId = aStreamId;
     iSampleStart = aSample;
+    iSeekPending = iSeekMissed = false;
+    if (iParallel) {
+        return TrySeekParallel(aSample);
+    }
+    if (!iFirstFrameOffsetKnown || iSampleRate == 0 || (iTotalSamples > 0 && aSample >= iTotalSamples)) {
+        return TrySeekBisect(aSample);
+    }
+    return TrySeekIndexed(aSample);
+}
+
+TBool CodecFlac::TrySeekIndexed(TUint64 aSample)
+{
+    const TUint64 streamLength = iController->StreamLength();
+    const TUint64 endOffset = (streamLength > iFirstFrameOffset? streamLength - iFirstFrameOffset : 0);
+    const TUint64 maxPreroll = (TUint64)kMaxPrerollSeconds * iSampleRate;
+    TUint64 offset = 0;
+    const TBool exact = iSeekIndex.SeekOffset(aSample, iTotalSamples, endOffset, maxPreroll, offset);
+    if (!iController->TrySeekTo(iStreamId, iFirstFrameOffset + offset)) {
+        return false;
+    }
+    (void)FLAC__stream_decoder_flush(iDecoder);
+    iTrackOffset = aSample * Jiffies::PerSample(iSampleRate);
+    iStreamMsgDue = true;
+    iSeekSample = aSample;
+    iSeekPending = true;
+    iSeekMaxPreroll = (exact? aSample : 2 * maxPreroll);
+    iFrameEnd = iFirstFrameOffset + offset;
+    iFrameEndKnown = exact;
+    if (exact) {
+        // CallbackWrite will discard any preroll as the stream is decoded
+        return true;
+    }
+
+    /* An estimated position may overshoot aSample or, if nothing is known beyond the last
+       indexed frame, fall far short of it.  Decode until we find out where we landed, falling
+       back to a bisection search rather than decode (or decode through) a long stretch of audio. */
+    while (iSeekPending) {
+        if (!FLAC__stream_decoder_process_single(iDecoder)) {
+            break;
+        }
+        const FLAC__StreamDecoderState state = FLAC__stream_decoder_get_state(iDecoder);
+        if (state != FLAC__STREAM_DECODER_SEARCH_FOR_FRAME_SYNC && state != FLAC__STREAM_DECODER_READ_FRAME) {
+            break;
+        }
+    }
+    if (iSeekPending || iSeekMissed) {
+        LOG(kCodec, "CodecFlac: estimated seek to sample %llu missed, falling back to bisection\n", aSample);
+        iSeekPending = iSeekMissed = false;
+        return TrySeekBisect(aSample);
+    }
+    return true;
+}
+
+TBool CodecFlac::TrySeekBisect(TUint64 aSample)
+{
+    iFrameEndKnown = false;
     FLAC__bool ret = FLAC__stream_decoder_seek_absolute(iDecoder, aSample);
     if (ret == 0) {
         // Seeking failed.
@@ -286,6 +694,8 @@ TBool CodecFlac::TrySeek(TUint aStreamId, TUint64 aSample)
 
 void CodecFlac::StreamCompleted()
 {
+    DrainFrameDecoders();
+    iParallel = false;
     FLAC__stream_decoder_finish(iDecoder);
     (void)FLAC__stream_decoder_get_state(iDecoder);
 }
@@ -297,6 +707,9 @@ FLAC__StreamDecoderReadStatus CodecFlac::CallbackRead(const FLAC__StreamDecoder*
     try {
         iController->Read(buf, *aBytes);
         *aBytes = buf.Bytes();
+        if (iRecording) {
+            Record(buf);
+        }
         return FLAC__STREAM_DECODER_READ_STATUS_CONTINUE;
     }
     catch (CodecStreamEnded&) {
@@ -346,18 +759,78 @@ TBool CodecFlac::CallbackEof(const FLAC__StreamDecoder* /*aDecoder*/)
     return false;
 }
 
-FLAC__StreamDecoderWriteStatus CodecFlac::CallbackWrite(const FLAC__StreamDecoder* /*aDecoder*/,
+FLAC__StreamDecoderWriteStatus CodecFlac::CallbackWrite(const FLAC__StreamDecoder* aDecoder,
                                                         const FLAC__Frame* aFrame, 
                                                         const TInt32* const aBuffer[])
 {
     const TUint channels = aFrame->header.channels;
     TUint samplesToWrite = aFrame->header.blocksize;
+    TUint startI = 0;
+    if (aFrame->header.number_type == FLAC__FRAME_NUMBER_TYPE_SAMPLE_NUMBER) {
+        const TUint64 frameSample = aFrame->header.number.sample_number;
+        IndexFrame(aDecoder, frameSample);
+        if (iSeekPending) {
+            if (frameSample > iSeekSample || iSeekSample - frameSample > iSeekMaxPreroll) {
+                iSeekMissed = true;
+                iSeekPending = false;
+                return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+            }
+            if (frameSample + samplesToWrite <= iSeekSample) {
+                return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE; // preroll
+            }
+            startI = (TUint)(iSeekSample - frameSample);
+            samplesToWrite -= startI;
+            iSeekPending = false;
+        }
+    }
     const TUint bitDepth = aFrame->header.bits_per_sample;
     const TUint sampleRate = aFrame->header.sample_rate;
-    if (iSampleRate != sampleRate || iNumChannels != channels || iBitDepth != bitDepth) {
-        iSampleRate = sampleRate;
-        iNumChannels = channels;
-        iBitDepth = bitDepth;
+    CheckStreamFormat(sampleRate, channels, bitDepth);
+    const TUint bytesPerSample = (bitDepth/8) * channels;
+    const TUint maxSamples = sizeof(iBuf) / bytesPerSample;
+    const TInt32* src[PcmKernels::kMaxChannels];
+    while (samplesToWrite > 0) {
+        const TUint samples = (samplesToWrite > maxSamples? maxSamples : samplesToWrite);
+        for (TUint j=0; j<channels; j++) {
+            src[j] = aBuffer[j] + startI;
+        }
+        // pipeline audio data is big endian so we might as well convert to that here
+        PcmKernels::InterleaveToBigEndian(src, channels, samples, bitDepth, iBuf, bitDepth);
+        const TUint bytes = samples * bytesPerSample;
+        Brn encodedAudio(iBuf, bytes);
+        iTrackOffset += iController->OutputAudioPcm(encodedAudio, channels, sampleRate,
+                                                    bitDepth, AudioDataEndian::Big, iTrackOffset);
+        samplesToWrite -= samples;
+        startI += samples;
+    }
+
+    return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+}
+
+void CodecFlac::IndexFrame(const FLAC__StreamDecoder* aDecoder, TUint64 aFrameSample)
+{
+    if (!iFirstFrameOffsetKnown) {
+        return;
+    }
+    // decode position is the end of the frame just decoded
+    TUint64 pos;
+    if (!FLAC__stream_decoder_get_decode_position(aDecoder, &pos)) {
+        iFrameEndKnown = false;
+        return;
+    }
+    if (iFrameEndKnown) {
+        (void)iSeekIndex.Add(aFrameSample, iFrameEnd - iFirstFrameOffset);
+    }
+    iFrameEnd = pos;
+    iFrameEndKnown = true;
+}
+
+void CodecFlac::CheckStreamFormat(TUint aSampleRate, TUint aChannels, TUint aBitDepth)
+{
+    if (iSampleRate != aSampleRate || iNumChannels != aChannels || iBitDepth != aBitDepth) {
+        iSampleRate = aSampleRate;
+        iNumChannels = aChannels;
+        iBitDepth = aBitDepth;
         iStreamMsgDue = false; // OutputDecodedStream below
     }
 
@@ -365,51 +838,233 @@ FLAC__StreamDecoderWriteStatus CodecFlac::CallbackWrite(const FLAC__StreamDecode
         /* If we get a Audio Frame prior to a metadata frame (and therefore
            iStreamMsgDue is still true) we must have picked up a file mid-stream.
            Therefore, put out a MsgDecodedStream on the basis of what we know mid-stream. */
-        const TUint bitRate = sampleRate * bitDepth * channels;
-        iController->OutputDecodedStream(bitRate, bitDepth, sampleRate, channels, iName, iTrackLengthJiffies, iSampleStart, true, DeriveProfile(channels));
+        const TUint bitRate = aSampleRate * aBitDepth * aChannels;
+        iController->OutputDecodedStream(bitRate, aBitDepth, aSampleRate, aChannels, iName, iTrackLengthJiffies, iSampleStart, true, DeriveProfile(aChannels));
         iStreamMsgDue = false;
     }
-    
-    const TUint bytesPerSample = (bitDepth/8) * channels;
-    const TUint maxSamples = sizeof(iBuf) / bytesPerSample;
-    TUint startI=0, endI;
-    while (samplesToWrite > 0) {
-        const TUint samples = (samplesToWrite > maxSamples? maxSamples : samplesToWrite);
-        TByte* p = iBuf;
-        endI = startI + samples;
-        for (TUint i=startI; i<endI; i++) {
-            for (TUint j=0; j<channels; j++) {
-                TUint subsample = aBuffer[j][i];
-                // pipeline audio data is big endian so we might as well convert to that here
-                switch (bitDepth)
-                {
-                case 8:
-                    *p++ = (TByte)subsample;
-                    break;
-                case 16:
-                    *p++ = (TByte)(subsample >> 8);
-                    *p++ = (TByte)subsample;
-                    break;
-                case 24:
-                    *p++ = (TByte)(subsample >> 16);
-                    *p++ = (TByte)(subsample >> 8);
-                    *p++ = (TByte)subsample;
-                    break;
-                default:
-                    Log::Print("Unsupported bit depth in CodecFlac::CallbackWrite - %u\n", bitDepth);
-                    THROW(CodecStreamFeatureUnsupported);
+
+    if (aBitDepth != 8 && aBitDepth != 16 && aBitDepth != 24) {
+        Log::Print("Unsupported bit depth in CodecFlac::CallbackWrite - %u\n", aBitDepth);
+        THROW(CodecStreamFeatureUnsupported);
+    }
+}
+
+void CodecFlac::Record(const Brx& aData)
+{
+    // only the tail of the data is of interest - it may contain the start of the first frame
+    const TUint bytes = std::min(aData.Bytes(), iRecorded.MaxBytes());
+    const TUint space = iRecorded.MaxBytes() - iRecorded.Bytes();
+    if (bytes > space) {
+        const TUint discard = bytes - space;
+        TByte* ptr = const_cast<TByte*>(iRecorded.Ptr());
+        (void)memmove(ptr, ptr + discard, iRecorded.Bytes() - discard);
+        iRecorded.SetBytes(iRecorded.Bytes() - discard);
+    }
+    iRecorded.Append(aData.Ptr() + aData.Bytes() - bytes, bytes);
+}
+
+void CodecFlac::TryStartParallel()
+{
+    /* Frames can only be found without decoding them if we know where the first starts and
+       every frame has the same (STREAMINFO) block size and a bounded length. */
+    if (!iFirstFrameOffsetKnown || iSampleRate == 0) {
+        return;
+    }
+    const FLAC__StreamMetadata_StreamInfo& info = iStreamInfo;
+    if (info.min_blocksize != info.max_blocksize ||
+        (info.bits_per_sample != 8 && info.bits_per_sample != 16 && info.bits_per_sample != 24)) {
+        return;
+    }
+    // worst case is a verbatim encoding with an extra bit per sample for side channels
+    const TUint maxFrameBytes = (info.max_blocksize * info.channels * (info.bits_per_sample + 1) + 7) / 8
+                              + info.channels + FlacFrameSplitter::kMaxHeaderBytes + 2;
+    if (maxFrameBytes > kMaxFrameBytesParallel) {
+        return;
+    }
+    // libFLAC has already read the start of the first frame; take it from the recorded data
+    const TUint64 pos = iController->StreamPos();
+    if (pos < iFirstFrameOffset || pos - iFirstFrameOffset > iRecorded.Bytes()) {
+        return;
+    }
+    const TUint buffered = (TUint)(pos - iFirstFrameOffset);
+    iMaxFrameBytes = maxFrameBytes;
+
+    for (auto decoder : iFrameDecoders) {
+        decoder->Initialise(info, maxFrameBytes);
+    }
+    iSplitter->Reset(info.max_blocksize, info.channels, info.bits_per_sample, maxFrameBytes,
+                     iTotalSamples, iFirstFrameOffset);
+    iSplitter->Append(Brn(iRecorded.Ptr() + iRecorded.Bytes() - buffered, buffered));
+    iParallel = true;
+    iInputEnded = false;
+    iNextStream = false;
+    iOldestFrame = 0;
+    iFramesInFlight = 0;
+    LOG(kCodec, "CodecFlac: decoding up to %u frames in parallel\n", (TUint)iFrameDecoders.size());
+}
+
+void CodecFlac::ProcessParallel()
+{
+    FlacFrameSplitter::Frame frame;
+    while (iFramesInFlight < iFrameDecoders.size() && iSplitter->TryGetFrame(frame)) {
+        Dispatch(frame);
+    }
+    if (iSplitter->Finished()) {
+        iInputEnded = true; // anything following the final frame isn't audio
+    }
+    // output is held back by at most one frame per decoder
+    if (iFramesInFlight == iFrameDecoders.size() || (iInputEnded && iFramesInFlight > 0)) {
+        OutputFrame();
+        return;
+    }
+    if (iNextStream) {
+        THROW(CodecStreamStart);
+    }
+    if (iInputEnded) {
+        THROW(CodecStreamEnded);
+    }
+    ReadParallel();
+}
+
+TBool CodecFlac::TrySeekParallel(TUint64 aSample)
+{
+    DrainFrameDecoders();
+    if (iTotalSamples > 0 && aSample >= iTotalSamples) {
+        return false;
+    }
+    const TUint64 streamLength = iController->StreamLength();
+    const TUint64 endOffset = (streamLength > iFirstFrameOffset? streamLength - iFirstFrameOffset : 0);
+    for (TUint i=0; ; i++) {
+        // Estimated positions are refined by any frame found beyond aSample.  If that doesn't
+        // converge, a large preroll forces the nearest known frame at or before aSample.
+        const TUint64 maxPreroll = (i < kMaxEstimatedSeeks? (TUint64)kMaxPrerollSeconds * iSampleRate : aSample);
+        TUint64 offset = 0;
+        const TBool exact = iSeekIndex.SeekOffset(aSample, iTotalSamples, endOffset, maxPreroll, offset);
+        if (!iController->TrySeekTo(iStreamId, iFirstFrameOffset + offset)) {
+            return false;
+        }
+        iSplitter->Reset(iStreamInfo.max_blocksize, iStreamInfo.channels, iStreamInfo.bits_per_sample,
+                         iMaxFrameBytes, iTotalSamples, iFirstFrameOffset + offset);
+        iInputEnded = false;
+        iNextStream = false;
+        iTrackOffset = aSample * Jiffies::PerSample(iSampleRate);
+        iStreamMsgDue = true;
+        iSeekSample = aSample;
+        iSeekPending = true;
+        if (exact) {
+            // Dispatch() and OutputFrame() will discard any preroll
+            return true;
+        }
+        FlacFrameSplitter::Frame frame;
+        if (TryReadFrame(frame)) {
+            if (frame.iSample <= aSample) {
+                if (aSample - frame.iSample <= 2 * maxPreroll) {
+                    Dispatch(frame);
+                    return true;
                 }
+                /* Fell far short, most likely because nothing is indexed beyond this frame.
+                   Retrying can't do better so leave libFLAC to bisect the remainder of the stream. */
+                LOG(kCodec, "CodecFlac: estimated seek to sample %llu fell short, falling back to bisection\n", aSample);
+                DrainFrameDecoders();
+                iParallel = false;
+                iSeekPending = false;
+                return TrySeekBisect(aSample);
             }
+            (void)iSeekIndex.Add(frame.iSample, frame.iOffset - iFirstFrameOffset);
         }
-        const TUint bytes = samples * bytesPerSample;
-        Brn encodedAudio(iBuf, bytes);
-        iTrackOffset += iController->OutputAudioPcm(encodedAudio, channels, sampleRate,
+        LOG(kCodec, "CodecFlac: estimated seek to sample %llu missed, retrying\n", aSample);
+    }
+}
+
+void CodecFlac::ReadParallel()
+{
+    Bwn buf(iBuf, std::min((TUint)sizeof(iBuf), iSplitter->Space()));
+    try {
+        iController->Read(buf, buf.MaxBytes());
+    }
+    catch (CodecStreamEnded&) {
+        iInputEnded = true;
+    }
+    catch (CodecStreamStopped&) {
+        iInputEnded = true;
+    }
+    catch (CodecStreamStart&) {
+        // output the frames already read before the new stream is handed to a codec
+        iInputEnded = true;
+        iNextStream = true;
+    }
+    catch (Exception&) {
+        // flushes etc. discard any frames in flight; wait for their decoders before passing on
+        DrainFrameDecoders();
+        throw;
+    }
+    iSplitter->Append(buf);
+    if (iInputEnded) {
+        iSplitter->SetEndOfStream();
+    }
+}
+
+TBool CodecFlac::TryReadFrame(FlacFrameSplitter::Frame& aFrame)
+{
+    while (!iSplitter->TryGetFrame(aFrame)) {
+        if (iInputEnded || iSplitter->Finished()) {
+            return false;
+        }
+        ReadParallel();
+    }
+    return true;
+}
+
+void CodecFlac::Dispatch(const FlacFrameSplitter::Frame& aFrame)
+{
+    (void)iSeekIndex.Add(aFrame.iSample, aFrame.iOffset - iFirstFrameOffset);
+    if (iSeekPending && aFrame.iSample + aFrame.iBlockSize <= iSeekSample) {
+        return; // preroll following a seek; no need to decode it
+    }
+    const TUint index = (iOldestFrame + iFramesInFlight) % iFrameDecoders.size();
+    iFrameDecoders[index]->Decode(aFrame);
+    iFramesInFlight++;
+}
+
+void CodecFlac::OutputFrame()
+{
+    FlacFrameDecoder& decoder = *iFrameDecoders[iOldestFrame];
+    iOldestFrame = (iOldestFrame + 1) % iFrameDecoders.size();
+    iFramesInFlight--;
+    decoder.Wait();
+    if (!decoder.Succeeded()) {
+        THROW(CodecStreamCorrupt);
+    }
+    const TUint channels = iStreamInfo.channels;
+    const TUint bitDepth = iStreamInfo.bits_per_sample;
+    const TUint sampleRate = decoder.SampleRate();
+    CheckStreamFormat(sampleRate, channels, bitDepth);
+    const TUint bytesPerSample = (bitDepth/8) * channels;
+    Brn pcm(decoder.Pcm());
+    if (iSeekPending) {
+        iSeekPending = false;
+        if (decoder.Sample() < iSeekSample) {
+            const TUint skip = std::min((TUint)(iSeekSample - decoder.Sample()) * bytesPerSample, pcm.Bytes());
+            pcm.Set(pcm.Ptr() + skip, pcm.Bytes() - skip);
+        }
+    }
+    const TUint maxBytes = (sizeof(iBuf) / bytesPerSample) * bytesPerSample;
+    while (pcm.Bytes() > 0) {
+        const TUint bytes = std::min(pcm.Bytes(), maxBytes);
+        Brn audio(pcm.Ptr(), bytes);
+        iTrackOffset += iController->OutputAudioPcm(audio, channels, sampleRate,
                                                     bitDepth, AudioDataEndian::Big, iTrackOffset);
-        samplesToWrite -= samples;
-        startI = endI;
+        pcm.Set(pcm.Ptr() + bytes, pcm.Bytes() - bytes);
     }
+}
 
-    return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+void CodecFlac::DrainFrameDecoders()
+{
+    while (iFramesInFlight > 0) {
+        iFrameDecoders[iOldestFrame]->Wait();
+        iOldestFrame = (iOldestFrame + 1) % iFrameDecoders.size();
+        iFramesInFlight--;
+    }
 }
 
 void CodecFlac::CallbackError(const FLAC__StreamDecoder * /*aDecoder*/,
@@ -421,6 +1076,16 @@ void CodecFlac::CallbackError(const FLAC__StreamDecoder * /*aDecoder*/,
 void CodecFlac::CallbackMetadata(const FLAC__StreamDecoder * /*aDecoder*/,
                                  const FLAC__StreamMetadata* aMetadata)
 {
+    if (aMetadata->type == FLAC__METADATA_TYPE_SEEKTABLE) {
+        const FLAC__StreamMetadata_SeekTable& seekTable = aMetadata->data.seek_table;
+        for (TUint i=0; i<seekTable.num_points; i++) {
+            const FLAC__StreamMetadata_SeekPoint& point = seekTable.points[i];
+            if (point.sample_number != FLAC__STREAM_METADATA_SEEKPOINT_PLACEHOLDER) {
+                (void)iSeekIndex.Add(point.sample_number, point.stream_offset);
+            }
+        }
+        return;
+    }
     ASSERT(aMetadata->type == FLAC__METADATA_TYPE_STREAMINFO);
     const FLAC__StreamMetadata_StreamInfo* streamInfo = &aMetadata->data.stream_info;
 
@@ -429,6 +1094,9 @@ void CodecFlac::CallbackMetadata(const FLAC__StreamDecoder * /*aDecoder*/,
     iTrackLengthJiffies = (streamInfo->total_samples * Jiffies::kPerSecond) / iSampleRate;
     iNumChannels = (TUint)streamInfo->channels;
     iBitDepth = streamInfo->bits_per_sample;
+    iTotalSamples = streamInfo->total_samples;
+    iStreamInfo = *streamInfo;
+    iAwaitingFirstFrame = !iOgg; // libFLAC can't report byte positions within ogg streams
 
     iController->OutputDecodedStream(bitRate, iBitDepth, iSampleRate, iNumChannels,
                                      iName, iTrackLengthJiffies, iSampleStart, true /*lossless*/,
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <OpenHome/Types.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Private/Standard.h>
+
+namespace OpenHome {
+namespace Media {
+namespace Codec {
+
+/*
+Finds the boundaries of native FLAC frames without decoding them.
+
+A frame starts with a sync code and a header protected by a CRC-8; it ends immediately
+before the next frame's header and is protected by a trailing CRC-16.  Sync codes can
+occur by chance within encoded audio so a frame is only reported once both checks pass
+and its header is consistent with the stream's STREAMINFO.
+
+Frames are independent once found so can be passed to separate decoders.
+
+No header follows the final frame and a stream may end with data that isn't audio (an ID3v1
+tag, say), so if STREAMINFO gives the total number of samples the frame containing the last
+of them is reported without checking its CRC-16.  It may then include trailing bytes that a
+decoder is expected to ignore.
+*/
+
+class FlacFrameSplitter : private INonCopyable
+{
+public:
+    static const TUint kMaxHeaderBytes = 16;
+    struct Frame
+    {
+        const TByte* iPtr;  // valid until the next call to Append() or Reset()
+        TUint iBytes;       // may include trailing non-audio data for the final frame
+        TUint64 iOffset;    // stream offset of the frame's first byte
+        TUint64 iSample;
+        TUint iBlockSize;   // samples in this frame
+    };
+public:
+    FlacFrameSplitter(TUint aMaxBufferBytes);
+    /**
+     * Prepare for a new stream, or for data following a seek.
+     *
+     * aBlockSize is the stream's (fixed) block size from STREAMINFO.  aTotalSamples is also
+     * from STREAMINFO, with 0 meaning unknown.  aOffset is the stream offset of the next byte
+     * to be appended, which need not be the start of a frame.
+     */
+    void Reset(TUint aBlockSize, TUint aChannels, TUint aBitDepth, TUint aMaxFrameBytes,
+               TUint64 aTotalSamples, TUint64 aOffset);
+    TUint Space() const;
+    void Append(const Brx& aData);
+    void SetEndOfStream();
+    /**
+     * @return     true once the frame ending at aTotalSamples has been returned.  Any further
+     *             data is discarded so there's no need to continue reading the stream.
+     */
+    TBool Finished() const;
+    /**
+     * @return     true if aFrame was set to the next complete frame; false if more data is needed
+     *             (or, following SetEndOfStream(), there are no more frames).
+     */
+    TBool TryGetFrame(Frame& aFrame);
+    /**
+     * Parse a frame header.
+     *
+     * @return     false if aPtr doesn't point to a valid header for a stream with the given properties.
+     */
+    static TBool TryParseHeader(const TByte* aPtr, TUint aBytes, TUint aBlockSize, TUint aChannels, TUint aBitDepth,
+                                TUint& aHeaderBytes, TUint64& aSample, TUint& aFrameBlockSize);
+    static TByte Crc8(const TByte* aPtr, TUint aBytes);
+    static TUint16 Crc16(const TByte* aPtr, TUint aBytes, TUint16 aCrc = 0);
+private:
+    TBool TryFindStart();
+    TBool PastEnd(TUint64 aSample) const;
+    static TBool TryReadUtf8(const TByte* aPtr, TUint aBytes, TUint& aIndex, TUint64& aValue);
+private:
+    Bwh iBuf;
+    TUint64 iBufOffset;     // stream offset of iBuf[0]
+    TUint iStart;           // bytes before this have been returned as frames or discarded
+    TUint iBlockSize;
+    TUint iChannels;
+    TUint iBitDepth;
+    TUint iMaxFrameBytes;
+    TUint64 iTotalSamples;
+    TBool iEndOfStream;
+    TBool iFinished;
+    TBool iSynced;          // iBuf[iStart] is the start of a valid frame header
+    TUint64 iSample;        // properties of the frame starting at iBuf[iStart]
+    TUint iFrameBlockSize;
+    TUint iScanPos;         // next candidate position for the following frame's header
+    TUint iCrcPos;          // iCrc covers iBuf[iStart..iCrcPos)
+    TUint16 iCrc;
+};
+
+} // namespace Codec
+} // namespace Media
+} // namespace OpenHome
@@ -0,0 +1,72 @@
+#include <OpenHome/Media/Codec/FlacSeekIndex.h>
+#include <OpenHome/Types.h>
+#include <OpenHome/Private/Standard.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace OpenHome;
+using namespace OpenHome::Media;
+using namespace OpenHome::Media::Codec;
+
+// FlacSeekIndex
+
+FlacSeekIndex::FlacSeekIndex()
+{
+    Reset();
+}
+
+void FlacSeekIndex::Reset()
+{
+    iPoints.clear();
+    iPoints.push_back({ 0, 0 }); // the first frame always starts at sample 0
+}
+
+TBool FlacSeekIndex::Add(TUint64 aSample, TUint64 aOffset)
+{
+    if (iPoints.size() >= kMaxPoints) {
+        return false;
+    }
+    auto it = std::upper_bound(iPoints.begin(), iPoints.end(), aSample,
+                               [](TUint64 aValue, const Point& aPoint) { return aValue < aPoint.iSample; });
+    const Point& prev = *(it - 1); // first point is sample 0 so always precedes aSample
+    if (aSample - prev.iSample < kMinSpacingSamples || aOffset <= prev.iOffset) {
+        return false;
+    }
+    if (it != iPoints.end() && (it->iSample - aSample < kMinSpacingSamples || it->iOffset <= aOffset)) {
+        return false;
+    }
+    (void)iPoints.insert(it, { aSample, aOffset });
+    return true;
+}
+
+TBool FlacSeekIndex::SeekOffset(TUint64 aSample, TUint64 aEndSample, TUint64 aEndOffset, TUint64 aMaxPreroll, TUint64& aOffset) const
+{
+    auto it = std::upper_bound(iPoints.begin(), iPoints.end(), aSample,
+                               [](TUint64 aValue, const Point& aPoint) { return aValue < aPoint.iSample; });
+    const Point& before = *(it - 1);
+    aOffset = before.iOffset;
+    if (aSample - before.iSample <= aMaxPreroll) {
+        return true;
+    }
+    Point after;
+    if (it != iPoints.end()) {
+        after = *it;
+    }
+    else if (aEndSample > aSample && aEndOffset > before.iOffset) {
+        after = { aEndSample, aEndOffset };
+    }
+    else {
+        return false; // no upper bound to interpolate towards; the caller must search beyond the last known frame
+    }
+    // (aSample - aMaxPreroll) lies strictly between the two points so neither the product
+    // below nor the resulting offset can overflow for any plausible stream
+    const TUint64 delta = aSample - aMaxPreroll - before.iSample;
+    aOffset = before.iOffset + (delta * (after.iOffset - before.iOffset)) / (after.iSample - before.iSample);
+    return false;
+}
+
+TUint FlacSeekIndex::Count() const
+{
+    return (TUint)iPoints.size();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <OpenHome/Types.h>
+#include <OpenHome/Private/Standard.h>
+
+#include <vector>
+
+namespace OpenHome {
+namespace Media {
+namespace Codec {
+
+/*
+Sparse map of sample position -> byte offset for the frames of one FLAC stream.
+
+Offsets are relative to the start of the first frame, matching SEEKTABLE seekpoints.
+FLAC frame headers carry their own sample number so, unlike Mp3FrameIndex, points
+don't need to be contiguous; they can be added from a SEEKTABLE, from frames decoded
+during normal playback or from frames found following a seek, in any order.
+*/
+
+class FlacSeekIndex : private INonCopyable
+{
+public:
+    static const TUint kMinSpacingSamples = 44100; // points closer than this to a neighbour are ignored
+    static const TUint kMaxPoints = 32768;
+public:
+    FlacSeekIndex();
+    void Reset();
+    /**
+     * Add a point known to be the start of a frame.
+     *
+     * @return     true if the point was added; false if it was redundant or the index is full.
+     */
+    TBool Add(TUint64 aSample, TUint64 aOffset);
+    /**
+     * Choose the offset to seek to in order to decode aSample.
+     *
+     * Uses the closest point at or before aSample if that is no more than aMaxPreroll samples
+     * earlier.  Otherwise interpolates between the surrounding points (or the end of the stream,
+     * if known), aiming aMaxPreroll samples early to allow for variation in compression.
+     * If there is nothing to interpolate towards, aOffset is the closest point before aSample.
+     *
+     * @param[in]  aSample       Target sample.
+     * @param[in]  aEndSample    Total samples in the stream or 0 if unknown.
+     * @param[in]  aEndOffset    Offset of the end of the stream (relative to the first frame) or 0 if unknown.
+     * @param[in]  aMaxPreroll   Maximum number of samples that may be decoded and discarded.
+     * @param[out] aOffset       Offset to seek to, relative to the first frame.
+     *
+     * @return     true if aOffset is the start of a frame no more than aMaxPreroll samples before
+     *             aSample; false if it is an estimate, which may be mid-frame, may have overshot
+     *             aSample or may be far short of it.
+     */
+    TBool SeekOffset(TUint64 aSample, TUint64 aEndSample, TUint64 aEndOffset, TUint64 aMaxPreroll, TUint64& aOffset) const;
+    TUint Count() const;
+private:
+    struct Point
+    {
+        TUint64 iSample;
+        TUint64 iOffset;
+    };
+private:
+    std::vector<Point> iPoints; // sorted by sample
+};
+
+} // namespace Codec
+} // namespace Media
+} // namespace OpenHome
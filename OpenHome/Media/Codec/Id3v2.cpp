@@ -124,33 +124,41 @@ TBool Id3v2::TrySeek(TUint aStreamId, TUint64 aOffset)
 
 TBool Id3v2::RecogniseTag()
 {
-    if (iBuf.Bytes() < kRecogniseBytes) {
+    if (!TryGetTagBytes(iBuf, iSize)) {
+        return false;
+    }
+    LOG(kMedia, "Id3v2 header found: %d bytes\n", iSize);
+    return true;
+}
+
+TBool Id3v2::TryGetTagBytes(const Brx& aHeader, TUint& aTagBytes)
+{ // static
+    if (aHeader.Bytes() < kRecogniseBytes) {
         return false; // not enough data to recognise
     }
 
     static const Brn kContainerStart("ID3");
-    if (Brn(iBuf.Ptr(), kContainerStart.Bytes()) != kContainerStart) {
+    if (Brn(aHeader.Ptr(), kContainerStart.Bytes()) != kContainerStart) {
         return false;
     }
-    if (iBuf[3] > 4) { // We only support upto Id3v2.4
+    if (aHeader[3] > 4) { // We only support upto Id3v2.4
         return false;
     }
     // NOTE: docs suggest this is an experimental field rather than footer indicator.
-    const TBool hasFooter = ((iBuf[5] & 0x10) != 0);
+    const TBool hasFooter = ((aHeader[5] & 0x10) != 0);
     // remaining 4 bytes give the size of container data
     // bit 7 of each byte must be zero (to avoid being mistaken for the sync frame of mp3)
     // ...so each byte only holds 7 bits of sizing data
     for (TUint i=6; i<10; i++) {
-        if ((iBuf[i] & 0x80) != 0) {
+        if ((aHeader[i] & 0x80) != 0) {
             return false;
         }
     }
 
-    iSize = ((iBuf[6] << 21) | (iBuf[7] << 14) | (iBuf[8] << 7) | iBuf[9]);
-    iSize += 10; // for header
+    aTagBytes = ((aHeader[6] << 21) | (aHeader[7] << 14) | (aHeader[8] << 7) | aHeader[9]);
+    aTagBytes += 10; // for header
     if (hasFooter) {
-        iSize += 10; // for footer if present
+        aTagBytes += 10; // for footer if present
     }
-    LOG(kMedia, "Id3v2 header found: %d bytes\n", iSize);
     return true;
 }
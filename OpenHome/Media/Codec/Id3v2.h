@@ -9,10 +9,16 @@ namespace Codec {
 
 class Id3v2 : public ContainerBase
 {
-private:
+public:
     static const TUint kRecogniseBytes = 10;
 public:
     Id3v2();
+    /**
+     * Check whether aHeader (at least kRecogniseBytes long) starts an ID3v2 tag.
+     *
+     * @param[out] aTagBytes   Total size of the tag, including header and any footer.
+     */
+    static TBool TryGetTagBytes(const Brx& aHeader, TUint& aTagBytes);
 public: // from ContainerBase
     Msg* Recognise() override;
     TBool Recognised() const override;
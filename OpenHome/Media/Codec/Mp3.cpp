@@ -3,14 +3,20 @@
 #include <OpenHome/Media/Codec/CodecController.h>
 #include <OpenHome/Media/Codec/CodecFactory.h>
 #include <OpenHome/Media/Codec/Container.h>
+#include <OpenHome/Media/Codec/Id3v2.h>
+#include <OpenHome/Media/Codec/Mp3FrameIndex.h>
+#include <OpenHome/Media/Pipeline/PcmKernels.h>
 #include <OpenHome/Private/Converter.h>
 #include <OpenHome/Private/Printer.h>
 #include <OpenHome/Av/Debug.h>
+#include <OpenHome/Media/Debug.h>
 #include <OpenHome/Exception.h>
 #include <OpenHome/Private/Standard.h>
+#include <OpenHome/Private/Stream.h>
 #include <OpenHome/Media/MimeTypeList.h>
 #include <mad.h>
 
+#include <algorithm>
 #include <stdlib.h>
 #include <string.h>
 
@@ -89,6 +95,8 @@ private:
     static const TUint32 kBitRateMask     = 0x0000F000;
     static const TUint32 kSampleRateMask  = 0x00000C00;
     static const TUint32 kChannelMask     = 0x000000C0;
+    static const TUint32 kPaddingMask     = 0x00000200;
+    static const TUint32 kFixedHeaderMask = kFrameSyncMask | kVersionMask | kLayerMask | kSampleRateMask; // constant for all frames in a stream
 
     static const TUint32 kSampleRates[4][3];
     static const TUint32 kBitRates[2][3][15];
@@ -122,6 +130,11 @@ public:
     TUint SamplesPerFrame() const;
     static TBool Exists(const Brx& aData, TUint& aSyncFrameOffsetBytes);
     static TUint ValidSync(const Brx& aSync, TUint& layer, TUint& mode);
+    /*
+     * Calculate the size of the frame starting with aHeader, without decoding it.
+     * Returns false if aHeader isn't a valid header from the same stream as aReference.
+     */
+    static TBool TryParseFrame(TUint32 aHeader, TUint32 aReference, TUint& aFrameBytes, TUint& aFrameSamples);
 private:
     IMp3HeaderExtended* iExtended;  // No ownership; points to active extended header.
     Mp3HeaderExtendedBare iExtendedBare;
@@ -133,6 +146,31 @@ private:
     TBool iMpegLsf;
 };
 
+/*
+Walks the frame headers of a run of MP3 data, adding each frame to an index.
+Data is parsed as it is written so an arbitrarily long run can be scanned
+without buffering it.  Scanning stops (any further data is ignored) at the
+first frame that is invalid or doesn't follow on from the end of the index.
+*/
+
+class Mp3FrameScanner : public IWriter, private INonCopyable
+{
+public:
+    Mp3FrameScanner(Mp3FrameIndex& aIndex, TUint32 aReferenceHeader);
+private: // from IWriter
+    void Write(TByte aValue) override;
+    void Write(const Brx& aBuffer) override;
+    void WriteFlush() override;
+private:
+    Mp3FrameIndex& iIndex;
+    const TUint32 iReferenceHeader;
+    TUint64 iOffset;        // stream offset of the next byte written
+    TUint64 iSkipBytes;     // remainder of the current frame, following its header
+    TUint32 iHeader;
+    TUint iHeaderBytes;
+    TBool iStopped;
+};
+
 class CodecMp3 : public CodecBase
 {
 public:
@@ -144,9 +182,17 @@ private: // from CodecBase
     void Process();
     TBool TrySeek(TUint aStreamId, TUint64 aSample);
     void StreamCompleted();
+private:
+    void IndexFrame();
+    TBool TryFindFrame(TUint64 aSample, TUint64& aFrameSample, TUint64& aOffset);
+    TBool TryExtendIndex(TUint64 aSample);
+    TBool TryFindContainerBytes(TUint64& aBytes);
 private:
     static const TUint kReadReqBytes = 4096;
     static const TUint kInBufBytes = kReadReqBytes+MAD_BUFFER_GUARD;
+    static const TUint kSeekPrerollFrames = 2;       // allow for the layer 3 bit reservoir referencing earlier frames
+    static const TUint kProbeMarginBytes = 64 * 1024;    // allowance for error in Xing TOC or bit rate estimates
+    static const TUint kMaxProbeBytes = 512 * 1024;
     mad_stream  iMadStream;
     mad_frame   iMadFrame;
     mad_synth   iMadSynth;
@@ -159,6 +205,14 @@ private:
     Bws<DecodedAudio::kMaxBytes> iOutput;
     TBool       iStreamEnded;
     Bws<6*1024> iRecogBuf;
+    Mp3FrameIndexCache iIndexCache;
+    Mp3FrameIndex* iIndex;      // nullptr for non-seekable streams
+    TUint32     iFirstFrameHeader;
+    TUint64     iInputOffset;   // stream offset of start of iInput
+    TUint64     iFrameSample;   // sample at start of next frame to be decoded
+    TUint64     iSeekSample;    // decoded samples before this are discarded following a seek
+    TUint64     iContainerBytes;
+    TBool       iContainerBytesKnown;
 };
 
 } // namespace Codec
@@ -639,38 +693,101 @@ TUint Mp3Header::ValidSync(const Brx& aSync, TUint& layer, TUint& mode)
     THROW(CodecSyncInvalid);
 }
 
+TBool Mp3Header::TryParseFrame(TUint32 aHeader, TUint32 aReference, TUint& aFrameBytes, TUint& aFrameSamples)
+{ // static
+    if ((aHeader & kFrameSyncMask) != kFrameSyncMask || (aHeader & kFixedHeaderMask) != (aReference & kFixedHeaderMask)) {
+        return false;
+    }
+    const TUint version = (aHeader & kVersionMask) >> 19;
+    const TUint layer = 3 - ((aHeader & kLayerMask) >> 17);
+    const TUint bitRateIndex = (aHeader & kBitRateMask) >> 12;
+    const TUint sampleRateIndex = (aHeader & kSampleRateMask) >> 10;
+    if (version == eMpegReserved || layer == eLayerReserved || sampleRateIndex == 0x3) {
+        return false;
+    }
+    if (bitRateIndex == 0 || bitRateIndex == 0xF) { // free format or reserved
+        return false;
+    }
+    const TUint lsf = (version == eMpeg1? 0 : 1);
+    const TUint bitRate = kBitRates[lsf][layer][bitRateIndex] * 1000;
+    const TUint sampleRate = kSampleRates[version][sampleRateIndex];
+    const TUint padding = ((aHeader & kPaddingMask) != 0? 1 : 0);
+    aFrameSamples = kFrameSamples[lsf][layer];
+    if (layer == eLayer1) {
+        aFrameBytes = ((12 * bitRate / sampleRate) + padding) * 4;
+    }
+    else {
+        aFrameBytes = ((aFrameSamples / 8) * bitRate / sampleRate) + padding;
+    }
+    return true;
+}
+
+
+// Mp3FrameScanner
 
+Mp3FrameScanner::Mp3FrameScanner(Mp3FrameIndex& aIndex, TUint32 aReferenceHeader)
+    : iIndex(aIndex)
+    , iReferenceHeader(aReferenceHeader)
+    , iOffset(aIndex.EndOffset())
+    , iSkipBytes(0)
+    , iHeader(0)
+    , iHeaderBytes(0)
+    , iStopped(false)
+{
+}
 
-// Synthesized samples need to be converted from libmad's fixed
-// point representation to standard pcm.
-// libmad stores in 32 bits the following:
-//   SWWWFFFF FFFFFFFF FFFFFFFF FFFFFFF
-//      where 
-//        S: sign 
-//        W: whole number
-//        F: fraction of W
-//
-// MAD_F_FRACBITS is the number of F's and is architecture dependent (28 on all
-// platforms we currently care about).
-//
-// After checking for clipping (first two if's) we then convert to 24-bit with the bottom 8 bits unused.
-static TUint32 fixedToPcm(mad_fixed_t aFixed)
+void Mp3FrameScanner::Write(TByte aValue)
 {
-    const TUint32 kPlusOne  = 0x7FFFFF00l;
-    const TUint32 kMinusOne = 0x80000000l;
-    if (aFixed >= MAD_F_ONE) {
-        //LOG(kCodec, "fixedToPcm upper CLIPPED: %08x ret: %08x\n", aFixed, kPlusOne);
-        return kPlusOne;
+    if (iStopped) {
+        return;
+    }
+    iOffset++;
+    if (iSkipBytes > 0) {
+        iSkipBytes--;
+        return;
+    }
+    iHeader = (iHeader << 8) | aValue;
+    if (++iHeaderBytes < 4) {
+        return;
+    }
+    const TUint64 frameOffset = iOffset - 4;
+    TUint frameBytes = 0;
+    TUint frameSamples = 0;
+    if (!Mp3Header::TryParseFrame(iHeader, iReferenceHeader, frameBytes, frameSamples) || frameBytes < 4) {
+        LOG(kCodec, "Mp3FrameScanner invalid frame header (%08x) at offset %llu\n", iHeader, frameOffset);
+        iStopped = true;
+        return;
     }
-    if (aFixed <= -MAD_F_ONE) {
-        //LOG(kCodec, "fixedToPcm lower CLIPPED: %08x ret: %08x\n", aFixed, kMinusOne);
-        return kMinusOne; 
+    if (!iIndex.Add(iIndex.EndSample(), frameOffset, frameBytes, frameSamples)) {
+        iStopped = true;
+        return;
     }
-    // if no clipping, then the 24 bit number is composed of the lsb W and 23 of
-    // the most significant F's.  Linn stores the 24 bits in the higher order
-    // bits with the bottom eight bits zeroed.
-    TInt32 value = (aFixed << 3) & 0xFFFFFF00l;
-    return (TUint32)value;
+    iSkipBytes = frameBytes - 4;
+    iHeader = 0;
+    iHeaderBytes = 0;
+}
+
+void Mp3FrameScanner::Write(const Brx& aBuffer)
+{
+    const TByte* ptr = aBuffer.Ptr();
+    TUint remaining = aBuffer.Bytes();
+    while (remaining > 0 && !iStopped) {
+        if (iSkipBytes > 0) {
+            const TUint bytes = (TUint)std::min<TUint64>(iSkipBytes, remaining);
+            iSkipBytes -= bytes;
+            iOffset += bytes;
+            ptr += bytes;
+            remaining -= bytes;
+        }
+        else {
+            Write(*ptr++);
+            remaining--;
+        }
+    }
+}
+
+void Mp3FrameScanner::WriteFlush()
+{
 }
 
 
@@ -679,6 +796,13 @@ static TUint32 fixedToPcm(mad_fixed_t aFixed)
 CodecMp3::CodecMp3(IMimeTypeList& aMimeTypeList)
     : CodecBase("MP3")
     , iHeaderBytes(0)
+    , iIndex(nullptr)
+    , iFirstFrameHeader(0)
+    , iInputOffset(0)
+    , iFrameSample(0)
+    , iSeekSample(0)
+    , iContainerBytes(0)
+    , iContainerBytesKnown(false)
 {
     (void)memset(&iMadStream, 0, sizeof(iMadStream));
     (void)memset(&iMadFrame, 0, sizeof(iMadFrame));
@@ -739,6 +863,15 @@ void CodecMp3::StreamInitialise()
         THROW(CodecStreamEnded);
     }
     iHeader.Replace(iInput, iHeaderBytes, iController->StreamLength());
+    iFirstFrameHeader = Converter::BeUint32At(iInput, 0);
+    iInputOffset = iController->StreamPos() - iInput.Bytes();
+    iFrameSample = 0;
+    iSeekSample = 0;
+    iContainerBytesKnown = false;
+    iIndex = nullptr;
+    if (iController->StreamLength() > 0) {
+        iIndex = &iIndexCache.Index(iController->StreamUri(), iController->StreamLength(), iHeaderBytes);
+    }
 
     iTrackLengthJiffies = (iHeader.SamplesTotal() * Jiffies::kPerSecond) / iHeader.SampleRate();
     iController->OutputDecodedStream(iHeader.BitRate(), kBitDepth, iHeader.SampleRate(), iHeader.Channels(), iHeader.Name(), iTrackLengthJiffies, 0, false, DeriveProfile(iHeader.Channels()));
@@ -751,6 +884,7 @@ void CodecMp3::StreamCompleted()
     iInput.SetBytes(0);
     iOutput.SetBytes(0);
     iHeaderBytes = 0;
+    iIndex = nullptr;
 
     mad_synth_finish(&iMadSynth);
     mad_frame_finish(&iMadFrame);
@@ -760,11 +894,16 @@ void CodecMp3::StreamCompleted()
 TBool CodecMp3::TrySeek(TUint aStreamId, TUint64 aSample)
 {
     TUint64 bytes = 0;
-    try {
-        bytes = iHeader.SampleToByte(aSample);
-    }
-    catch (Mp3SampleInvalid&) {
-        return false;
+    TUint64 frameSample = aSample;
+    if (!TryFindFrame(aSample, frameSample, bytes)) {
+        // Not indexed; fall back to an estimate from the Xing TOC or average bit rate.
+        frameSample = aSample;
+        try {
+            bytes = iHeader.SampleToByte(aSample);
+        }
+        catch (Mp3SampleInvalid&) {
+            return false;
+        }
     }
     //LOG(kCodec, "CodecMp3::Seek(%lld), byte: %lld\n", aSamples, bytes);
     // FIXME - need to know how much data has been consumed by the container
@@ -774,8 +913,15 @@ TBool CodecMp3::TrySeek(TUint aStreamId, TUint64 aSample)
     }
     TBool canSeek = iController->TrySeekTo(aStreamId, bytes);
     if (canSeek) {
+        // discard any partial frame left over from before the seek
+        mad_stream_finish(&iMadStream);
+        mad_stream_init(&iMadStream);
+        mad_frame_mute(&iMadFrame);
+        mad_synth_mute(&iMadSynth);
         iInput.SetBytes(0);
         iOutput.SetBytes(0);
+        iFrameSample = frameSample;
+        iSeekSample = aSample;
         iSamplesWrittenTotal = aSample;
         iTrackOffset = (aSample * Jiffies::kPerSecond) / iHeader.SampleRate();
         iController->OutputDecodedStream(iHeader.BitRate(), kBitDepth, iHeader.SampleRate(), iHeader.Channels(), iHeader.Name(), iTrackLengthJiffies, aSample, false, DeriveProfile(iHeader.Channels()));
@@ -783,6 +929,88 @@ TBool CodecMp3::TrySeek(TUint aStreamId, TUint64 aSample)
     return canSeek;
 }
 
+void CodecMp3::IndexFrame()
+{
+    const TUint frameSamples = 32 * MAD_NSBSAMPLES(&iMadFrame.header);
+    if (iIndex != nullptr) {
+        const TUint64 offset = iInputOffset + (iMadStream.this_frame - iInput.Ptr());
+        const TUint frameBytes = (TUint)(iMadStream.next_frame - iMadStream.this_frame);
+        (void)iIndex->Add(iFrameSample, offset, frameBytes, frameSamples);
+    }
+    iFrameSample += frameSamples;
+}
+
+TBool CodecMp3::TryFindFrame(TUint64 aSample, TUint64& aFrameSample, TUint64& aOffset)
+{
+    if (iIndex == nullptr) {
+        return false;
+    }
+    const TUint64 preroll = kSeekPrerollFrames * iHeader.SamplesPerFrame();
+    const TUint64 sample = (aSample > preroll? aSample - preroll : 0);
+    if (iIndex->TryFind(sample, aFrameSample, aOffset)) {
+        return true;
+    }
+    return TryExtendIndex(aSample) && iIndex->TryFind(sample, aFrameSample, aOffset);
+}
+
+TBool CodecMp3::TryExtendIndex(TUint64 aSample)
+{
+    /* Frames don't carry timestamps so there's no way to tell which sample an arbitrary byte
+       offset corresponds to; the index can only be extended by walking frame headers forwards
+       from its end.  Use the Xing TOC or average bit rate to estimate how far away aSample is
+       and only walk that far - in a single out-of-band read - if it is within kMaxProbeBytes.
+       More distant seeks use the estimate directly. */
+    TUint64 estimate = 0;
+    try {
+        estimate = iHeader.SampleToByte(aSample);
+    }
+    catch (Mp3SampleInvalid&) {
+        return false;
+    }
+    const TUint64 start = iIndex->EndOffset();
+    const TUint64 streamBytes = iController->StreamLength();
+    if (start >= streamBytes) {
+        return false;
+    }
+    const TUint64 end = std::min(std::max(estimate, start) + kProbeMarginBytes, streamBytes);
+    if (end - start > kMaxProbeBytes) {
+        return false;
+    }
+    TUint64 containerBytes = 0;
+    if (!TryFindContainerBytes(containerBytes)) {
+        return false;
+    }
+    Mp3FrameScanner scanner(*iIndex, iFirstFrameHeader);
+    // any frames indexed before a read fails are still valid
+    (void)iController->Read(scanner, containerBytes + start, (TUint)(end - start));
+    return iIndex->EndSample() > aSample;
+}
+
+TBool CodecMp3::TryFindContainerBytes(TUint64& aBytes)
+{
+    /* Out-of-band reads address the raw stream whereas our offsets exclude any
+       ID3v2 tags that were stripped by the container. */
+    if (!iContainerBytesKnown) {
+        TUint64 offset = 0;
+        for (;;) {
+            Bws<Id3v2::kRecogniseBytes> buf;
+            WriterBuffer writer(buf);
+            if (!iController->Read(writer, offset, buf.MaxBytes())) {
+                return false;
+            }
+            TUint tagBytes = 0;
+            if (!Id3v2::TryGetTagBytes(buf, tagBytes)) {
+                break;
+            }
+            offset += tagBytes;
+        }
+        iContainerBytes = offset;
+        iContainerBytesKnown = true;
+    }
+    aBytes = iContainerBytes;
+    return true;
+}
+
 void CodecMp3::Process()
 {
     //LOG(kCodec, "CodecMp3::Process\n");
@@ -830,6 +1058,7 @@ void CodecMp3::Process()
             iStreamEnded = true;
             //LOG(kCodec, "CodecMp3::Process caught CodecStreamEnded\n");
         }
+        iInputOffset = iController->StreamPos() - iInput.Bytes();
         if (newStreamStarted || iStreamEnded) {
             ASSERT_DEBUG(iInput.Bytes() + MAD_BUFFER_GUARD < iInput.MaxBytes()); // FIXME - volkano just assumes this holds true.  Why is that safe?
             TUint8* ptr = (TUint8*)iInput.Ptr() + iInput.Bytes();
@@ -843,6 +1072,11 @@ void CodecMp3::Process()
 
     // Decode the next mpeg frame.  mad_frame_decode returns a non zero value on error
     TInt ret = mad_frame_decode(&iMadFrame, &iMadStream);
+    const TUint64 frameSample = iFrameSample;
+    if (ret == 0 || (iMadStream.error & 0xff00) == 0x0200) {
+        // 0x02xx errors are in the frame's data; its header (and so its size and position) is still valid
+        IndexFrame();
+    }
     if (ret) {
         if (newStreamStarted) {
             THROW(CodecStreamStart);
@@ -874,6 +1108,13 @@ void CodecMp3::Process()
     TUint samplesToWrite = iMadSynth.pcm.length;
     //LOG(kCodec, "CodecMp3::Process samplesToWrite: %d, written: %lld\n", samplesToWrite, iSamplesWrittenTotal);
 
+    // discard any samples preceding a seek point
+    TUint pcmIndex = 0;
+    if (frameSample < iSeekSample) {
+        pcmIndex = (TUint)std::min<TUint64>(iSeekSample - frameSample, samplesToWrite);
+        samplesToWrite -= pcmIndex;
+    }
+
     // limit output of samples to total defined in header, unless its a live stream
     if (iHeader.SamplesTotal()) {
 //        const TUint64 remaining = (iHeader.SamplesTotal() - iSamplesWrittenTotal);
@@ -882,7 +1123,6 @@ void CodecMp3::Process()
         }
     }
 
-    TUint pcmIndex = 0;
     do {
         TUint bytes = samplesToWrite * (kBitDepth/8) * channels;
         TUint samples = samplesToWrite;
@@ -892,15 +1132,13 @@ void CodecMp3::Process()
             bytes = samples * (kBitDepth/8) * channels;
         }
         TByte* dst = const_cast<TByte*>(iOutput.Ptr()) + iOutput.Bytes();
-        for (TUint i=pcmIndex; i<pcmIndex+samples; i++) {
-            for (TUint j=0; j<channels; j++) {
-                TUint subsample = fixedToPcm(iMadSynth.pcm.samples[j][i]);
-                // output is always 24-bit
-                *dst++ = (TByte)(subsample >> 24);
-                *dst++ = (TByte)(subsample >> 16);
-                *dst++ = (TByte)(subsample >> 8);
-            }
+        // libmad's fixed point samples have MAD_F_FRACBITS fractional bits plus a sign bit
+        // in the range we're interested in; anything outside [-1..1) is clipped
+        const TInt32* src[2];
+        for (TUint j=0; j<channels; j++) {
+            src[j] = reinterpret_cast<const TInt32*>(&iMadSynth.pcm.samples[j][pcmIndex]);
         }
+        PcmKernels::InterleaveToBigEndian(src, channels, samples, MAD_F_FRACBITS + 1, dst, kBitDepth);
         pcmIndex += samples;
         iOutput.SetBytes(iOutput.Bytes() + bytes);
         // only output audio when we have data for a full-sized msg.
@@ -0,0 +1,123 @@
+#include <OpenHome/Media/Codec/Mp3FrameIndex.h>
+#include <OpenHome/Types.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Private/Standard.h>
+#include <OpenHome/Media/Pipeline/Msg.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace OpenHome;
+using namespace OpenHome::Media;
+using namespace OpenHome::Media::Codec;
+
+// Mp3FrameIndex
+
+Mp3FrameIndex::Mp3FrameIndex()
+    : iUri(kTrackUriMaxBytes)
+    , iStreamBytes(0)
+    , iFirstFrameOffset(0)
+    , iFrames(0)
+    , iEndSample(0)
+    , iEndOffset(0)
+{
+}
+
+void Mp3FrameIndex::Reset(const Brx& aUri, TUint64 aStreamBytes, TUint64 aFirstFrameOffset)
+{
+    if (aUri.Bytes() > iUri.MaxBytes()) {
+        iUri.Replace(Brx::Empty()); // too long to cache; will never match
+    }
+    else {
+        iUri.Replace(aUri);
+    }
+    iStreamBytes = aStreamBytes;
+    iFirstFrameOffset = aFirstFrameOffset;
+    iEntries.clear();
+    iFrames = 0;
+    iEndSample = 0;
+    iEndOffset = aFirstFrameOffset;
+}
+
+TBool Mp3FrameIndex::Matches(const Brx& aUri, TUint64 aStreamBytes, TUint64 aFirstFrameOffset) const
+{
+    return iUri.Bytes() > 0 && iUri == aUri && iStreamBytes == aStreamBytes && iFirstFrameOffset == aFirstFrameOffset;
+}
+
+TBool Mp3FrameIndex::Add(TUint64 aSample, TUint64 aOffset, TUint aFrameBytes, TUint aFrameSamples)
+{
+    if (aSample != iEndSample || aOffset != iEndOffset || aFrameBytes == 0) {
+        return false;
+    }
+    if (iFrames % kFrameInterval == 0) {
+        iEntries.push_back({ aSample, aOffset });
+    }
+    iFrames++;
+    iEndSample += aFrameSamples;
+    iEndOffset += aFrameBytes;
+    return true;
+}
+
+TBool Mp3FrameIndex::TryFind(TUint64 aSample, TUint64& aFrameSample, TUint64& aOffset) const
+{
+    if (aSample >= iEndSample) {
+        return false;
+    }
+    auto it = std::upper_bound(iEntries.begin(), iEntries.end(), aSample,
+                               [](TUint64 aValue, const Entry& aEntry) { return aValue < aEntry.iSample; });
+    ASSERT(it != iEntries.begin()); // first entry is always sample 0
+    --it;
+    aFrameSample = it->iSample;
+    aOffset = it->iOffset;
+    return true;
+}
+
+TUint64 Mp3FrameIndex::EndSample() const
+{
+    return iEndSample;
+}
+
+TUint64 Mp3FrameIndex::EndOffset() const
+{
+    return iEndOffset;
+}
+
+TUint Mp3FrameIndex::Count() const
+{
+    return (TUint)iEntries.size();
+}
+
+
+// Mp3FrameIndexCache
+
+Mp3FrameIndexCache::Mp3FrameIndexCache()
+{
+    for (TUint i=0; i<kMaxIndexes; i++) {
+        iIndexes.push_back(new Mp3FrameIndex());
+    }
+}
+
+Mp3FrameIndexCache::~Mp3FrameIndexCache()
+{
+    for (auto index : iIndexes) {
+        delete index;
+    }
+}
+
+Mp3FrameIndex& Mp3FrameIndexCache::Index(const Brx& aUri, TUint64 aStreamBytes, TUint64 aFirstFrameOffset)
+{
+    auto it = std::find_if(iIndexes.begin(), iIndexes.end(),
+                           [&](Mp3FrameIndex* aIndex) { return aIndex->Matches(aUri, aStreamBytes, aFirstFrameOffset); });
+    Mp3FrameIndex* index;
+    if (it == iIndexes.end()) {
+        index = iIndexes.back();
+        index->Reset(aUri, aStreamBytes, aFirstFrameOffset);
+        it = iIndexes.end() - 1;
+    }
+    else {
+        index = *it;
+    }
+    (void)iIndexes.erase(it);
+    (void)iIndexes.insert(iIndexes.begin(), index);
+    return *index;
+}
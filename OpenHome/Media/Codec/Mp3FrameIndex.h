@@ -0,0 +1,87 @@
+#pragma once
+
+#include <OpenHome/Types.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Private/Standard.h>
+
+#include <vector>
+
+namespace OpenHome {
+namespace Media {
+namespace Codec {
+
+/*
+Sparse map of sample position -> byte offset for the frames of one MP3 stream.
+
+Frames must be added in stream order, starting from the first frame.  Only frames which
+follow on exactly from the last frame added are accepted, so the index always describes a
+contiguous run of frames from the start of the stream and can be fed both by the decoder
+and by an out-of-band scan of frame headers without risk of recording an estimated position.
+*/
+
+class Mp3FrameIndex : private INonCopyable
+{
+public:
+    static const TUint kFrameInterval = 32; // one entry per kFrameInterval frames
+public:
+    Mp3FrameIndex();
+    void Reset(const Brx& aUri, TUint64 aStreamBytes, TUint64 aFirstFrameOffset);
+    TBool Matches(const Brx& aUri, TUint64 aStreamBytes, TUint64 aFirstFrameOffset) const;
+    /**
+     * Add details of a frame.
+     *
+     * @return     true if the frame extended the index; false if it was ignored (either
+     *             because it is already covered or because it doesn't follow the last frame added).
+     */
+    TBool Add(TUint64 aSample, TUint64 aOffset, TUint aFrameBytes, TUint aFrameSamples);
+    /**
+     * Find the last indexed frame that starts at or before aSample.
+     *
+     * @return     false if aSample is beyond the range covered by the index.
+     */
+    TBool TryFind(TUint64 aSample, TUint64& aFrameSample, TUint64& aOffset) const;
+    TUint64 EndSample() const;  // sample following the last frame added
+    TUint64 EndOffset() const;  // byte offset following the last frame added
+    TUint Count() const;
+private:
+    struct Entry
+    {
+        TUint64 iSample;
+        TUint64 iOffset;
+    };
+private:
+    Bwh iUri;
+    TUint64 iStreamBytes;
+    TUint64 iFirstFrameOffset;
+    std::vector<Entry> iEntries;
+    TUint iFrames;
+    TUint64 iEndSample;
+    TUint64 iEndOffset;
+};
+
+/*
+Small LRU cache of frame indexes, keyed on stream uri.
+Allows seeks to return quickly to positions in a recently played stream.
+*/
+
+class Mp3FrameIndexCache : private INonCopyable
+{
+public:
+    static const TUint kMaxIndexes = 4;
+public:
+    Mp3FrameIndexCache();
+    ~Mp3FrameIndexCache();
+    /**
+     * Return the index for a stream, reusing the least recently used index if
+     * the stream isn't already cached.
+     *
+     * The returned reference remains valid until the next call to Index().
+     */
+    Mp3FrameIndex& Index(const Brx& aUri, TUint64 aStreamBytes, TUint64 aFirstFrameOffset);
+private:
+    std::vector<Mp3FrameIndex*> iIndexes; // most recently used first
+};
+
+} // namespace Codec
+} // namespace Media
+} // namespace OpenHome
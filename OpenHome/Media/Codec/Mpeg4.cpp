@@ -10,6 +10,7 @@
 #include <OpenHome/Media/Debug.h>
 #include <OpenHome/Media/MimeTypeList.h>
 
+#include <algorithm>
 #include <limits>
 #include <vector>
 
@@ -1012,20 +1013,15 @@ Msg* Mpeg4BoxStsz::Process()
                     THROW(MediaMpeg4FileInvalid);
                 }
 
-                iSampleSizeTable.Init(entries);
-
                 // If iSampleSize == 0, there follows an array of sample size entries.
                 // If iSampleSize > 0, there are <entries> entries each of size <iSampleSize> (and no array follows).
                 if (iSampleSize > 0) {
-                    // Sample size table currently doesn't support a cheap way of having
-                    // a fixed iSampleSize, so just perform a pseudo-population of it here.
-                    for (TUint i=0; i<entries; i++) {
-                        iSampleSizeTable.AddSampleSize(iSampleSize);
-                    }
+                    iSampleSizeTable.InitConstant(entries, iSampleSize);
                     iState = eComplete;
                 }
                 else {
                     // Array of sample size entries follows; prepare to read it.
+                    iSampleSizeTable.Init(entries);
                     iCache->Inspect(iBuf, iBuf.MaxBytes());
                     iState = eEntry;
                 }
@@ -1969,18 +1965,8 @@ TUint Mpeg4BoxMdat::ChunkBytes() const
     }
     const TUint chunkSamples = iSeekTable.SamplesPerChunk(iChunk);
     const TUint startSample = iSeekTable.StartSample(iChunk); // NOTE: this assumes first sample == 0 (which is valid with how our tables are setup), but in MPEG4 spec, first sample == 1.
-    TUint chunkBytes = 0;
     // Samples start from 1. However, tables here are indexed from 0.
-    for (TUint i = startSample; i < startSample + chunkSamples; i++) {
-        const TUint sampleBytes = iSampleSizeTable.SampleSize(i);
-
-        if ((std::numeric_limits<TUint>::max() - chunkBytes) < sampleBytes) {
-            // Wrapping will occur.
-            THROW(MediaMpeg4FileInvalid);
-        }
-        chunkBytes += sampleBytes;
-    }
-    return chunkBytes;
+    return iSampleSizeTable.Bytes(startSample, chunkSamples);
 }
 
 TUint Mpeg4BoxMdat::BytesToRead() const
@@ -1999,6 +1985,7 @@ TUint Mpeg4BoxMdat::BytesToRead() const
 
 SampleSizeTable::SampleSizeTable()
 {
+    Clear();
     WriteInit();
 }
 
@@ -2009,65 +1996,210 @@ SampleSizeTable::~SampleSizeTable()
 
 void SampleSizeTable::Init(TUint aMaxEntries)
 {
-    ASSERT(iTable.size() == 0);
-    iTable.reserve(aMaxEntries);
+    ASSERT(iCount == 0);
+    ASSERT(iConstantSize == 0);
+    iMaxEntries = aMaxEntries;
+    iPacked.reserve(aMaxEntries);   // assume most deltas fit in a single byte
+    iCheckpoints.reserve((aMaxEntries + kCheckpointInterval - 1) / kCheckpointInterval);
+}
+
+void SampleSizeTable::InitConstant(TUint aCount, TUint aSampleSize)
+{
+    ASSERT(iCount == 0);
+    ASSERT(iConstantSize == 0);
+    ASSERT(aSampleSize > 0);
+    iConstantSize = aSampleSize;
+    iCount = iMaxEntries = aCount;
 }
 
 void SampleSizeTable::Clear()
 {
-    iTable.clear();
+    iCount = 0;
+    iMaxEntries = 0;
+    iConstantSize = 0;
+    iPrevSize = 0;
+    iPacked.clear();
+    iCheckpoints.clear();
+    iCursorIndex = 0;
+    iCursorOffset = 0;
+    iCursorSize = 0;
 }
 
 void SampleSizeTable::AddSampleSize(TUint aSize)
 {
-    if (iTable.size() == iTable.capacity()) {
+    if (iCount == iMaxEntries) {
         // File contains more sample sizes than it reported (and than we reserved capacity for).
         THROW(MediaMpeg4FileInvalid);
     }
-    iTable.push_back(aSize);
+    if ((iCount & (kCheckpointInterval - 1)) == 0) {
+        iCheckpoints.push_back((TUint)iPacked.size());
+        iPrevSize = 0;
+    }
+    const TInt64 delta = (TInt64)aSize - (TInt64)iPrevSize;
+    TUint64 zigzag = (delta < 0? ((TUint64)(-delta) << 1) - 1 : (TUint64)delta << 1);
+    while (zigzag >= 0x80) {
+        iPacked.push_back((TByte)(zigzag | 0x80));
+        zigzag >>= 7;
+    }
+    iPacked.push_back((TByte)zigzag);
+    iPrevSize = aSize;
+    iCount++;
 }
 
 TUint32 SampleSizeTable::SampleSize(TUint aIndex) const
 {
-    if (aIndex > iTable.size() - 1) {
+    if (aIndex >= iCount) {
         THROW(MediaMpeg4FileInvalid);
     }
-    return iTable[aIndex];
+    if (iConstantSize != 0) {
+        return iConstantSize;
+    }
+    if (aIndex < iCursorIndex || (aIndex / kCheckpointInterval) != (iCursorIndex / kCheckpointInterval)) {
+        iCursorIndex = aIndex & ~(kCheckpointInterval - 1);
+        iCursorOffset = iCheckpoints[aIndex / kCheckpointInterval];
+        iCursorSize = 0;
+    }
+    TUint size = iCursorSize;
+    while (iCursorIndex <= aIndex) {
+        size = DecodeNext();
+    }
+    return size;
+}
+
+TUint SampleSizeTable::Bytes(TUint aFirstIndex, TUint aCount) const
+{
+    if (aFirstIndex > iCount || aCount > iCount - aFirstIndex) {
+        THROW(MediaMpeg4FileInvalid);
+    }
+    if (iConstantSize != 0) {
+        const TUint64 bytes = (TUint64)iConstantSize * aCount;
+        if (bytes > std::numeric_limits<TUint>::max()) {
+            THROW(MediaMpeg4FileInvalid);
+        }
+        return static_cast<TUint>(bytes);
+    }
+    TUint bytes = 0;
+    for (TUint i = aFirstIndex; i < aFirstIndex + aCount; i++) {
+        const TUint sampleBytes = SampleSize(i);
+        if ((std::numeric_limits<TUint>::max() - bytes) < sampleBytes) {
+            // Wrapping will occur.
+            THROW(MediaMpeg4FileInvalid);
+        }
+        bytes += sampleBytes;
+    }
+    return bytes;
 }
 
 TUint32 SampleSizeTable::Count() const
 {
-    return iTable.size();
+    return iCount;
+}
+
+TUint SampleSizeTable::DecodeNext() const
+{
+    const TUint base = ((iCursorIndex & (kCheckpointInterval - 1)) == 0? 0 : iCursorSize);
+    TUint64 zigzag = 0;
+    TUint shift = 0;
+    for (;;) {
+        ASSERT(iCursorOffset < iPacked.size());
+        const TByte b = iPacked[iCursorOffset++];
+        zigzag |= (TUint64)(b & 0x7f) << shift;
+        if ((b & 0x80) == 0) {
+            break;
+        }
+        shift += 7;
+    }
+    const TInt64 delta = ((zigzag & 1) == 0? (TInt64)(zigzag >> 1) : -(TInt64)(zigzag >> 1) - 1);
+    iCursorSize = (TUint)((TInt64)base + delta);
+    iCursorIndex++;
+    return iCursorSize;
+}
+
+void SampleSizeTable::Read(IReader& aReader)
+{
+    ASSERT(iCount == 0);
+    ReaderBinary readerBin(aReader);
+    const TUint count = readerBin.ReadUintBe(4);
+    const TUint constantSize = readerBin.ReadUintBe(4);
+    if (constantSize != 0) {
+        InitConstant(count, constantSize);
+        return;
+    }
+    TUint packedBytes = readerBin.ReadUintBe(4);
+    Init(count);
+
+    TUint64 zigzag = 0;
+    TUint shift = 0;
+    while (packedBytes > 0) {
+        Brn buf = aReader.Read(packedBytes);
+        if (buf.Bytes() == 0) {
+            THROW(ReaderError);
+        }
+        packedBytes -= buf.Bytes();
+        for (TUint i = 0; i < buf.Bytes(); i++) {
+            const TByte b = buf[i];
+            zigzag |= (TUint64)(b & 0x7f) << shift;
+            if ((b & 0x80) != 0) {
+                shift += 7;
+                if (shift >= 7 * kMaxVarintBytes) {
+                    THROW(MediaMpeg4FileInvalid);
+                }
+                continue;
+            }
+            const TInt64 delta = ((zigzag & 1) == 0? (TInt64)(zigzag >> 1) : -(TInt64)(zigzag >> 1) - 1);
+            const TUint base = ((iCount & (kCheckpointInterval - 1)) == 0? 0 : iPrevSize);
+            const TInt64 size = (TInt64)base + delta;
+            if (size < 0 || size > (TInt64)std::numeric_limits<TUint>::max()) {
+                THROW(MediaMpeg4FileInvalid);
+            }
+            AddSampleSize((TUint)size);
+            zigzag = 0;
+            shift = 0;
+        }
+    }
+    if (shift != 0 || iCount != count) {
+        THROW(MediaMpeg4FileInvalid);
+    }
 }
 
 void SampleSizeTable::WriteInit()
 {
-    iWriteIndex = 0;
+    iWriteHeader = true;
+    iWriteOffset = 0;
 }
 
 void SampleSizeTable::Write(IWriter& aWriter, TUint aMaxBytes)
 {
+    static const TUint kHeaderBytes = 3 * sizeof(TUint32);
     TUint bytesLeftToWrite = aMaxBytes;
-    WriterBinary writerBin(aWriter);
 
-    if (iWriteIndex == 0) {
-        if (bytesLeftToWrite < sizeof(TUint32)) {
-           return;
-       }
-       writerBin.WriteUint32Be(Count());
-       bytesLeftToWrite -= sizeof(TUint32);
+    if (iWriteHeader) {
+        if (bytesLeftToWrite < kHeaderBytes) {
+            return;
+        }
+        WriterBinary writerBin(aWriter);
+        writerBin.WriteUint32Be(Count());
+        writerBin.WriteUint32Be(iConstantSize);
+        writerBin.WriteUint32Be(iConstantSize == 0? (TUint)iPacked.size() : 0);
+        bytesLeftToWrite -= kHeaderBytes;
+        iWriteHeader = false;
     }
 
-    while ((iWriteIndex < Count()) && (bytesLeftToWrite >= sizeof(TUint32))) {
-       writerBin.WriteUint32Be(SampleSize(iWriteIndex));
-       bytesLeftToWrite -= sizeof(TUint32);
-       iWriteIndex++;
+    if (iConstantSize == 0) {
+        TUint bytes = (TUint)iPacked.size() - iWriteOffset;
+        if (bytes > bytesLeftToWrite) {
+            bytes = bytesLeftToWrite;
+        }
+        if (bytes > 0) {
+            aWriter.Write(Brn(&iPacked[iWriteOffset], bytes));
+            iWriteOffset += bytes;
+        }
     }
 }
 
 TBool SampleSizeTable::WriteComplete() const
 {
-    return (iWriteIndex == Count());
+    return !iWriteHeader && (iConstantSize != 0 || iWriteOffset == iPacked.size());
 }
 
 // SeekTable
@@ -2115,15 +2247,28 @@ void SeekTable::Deinitialise()
 void SeekTable::SetSamplesPerChunk(TUint aFirstChunk, TUint aSamplesPerChunk,
         TUint aSampleDescriptionIndex)
 {
+    TUint64 firstSample = 0;
+    if (iSamplesPerChunk.size() > 0) {
+        const TSamplesPerChunkEntry& prev = iSamplesPerChunk.back();
+        const TUint chunks = (aFirstChunk > prev.iFirstChunk? aFirstChunk - prev.iFirstChunk : 0);
+        firstSample = prev.iFirstSample + (TUint64)chunks * prev.iSamples;
+    }
     TSamplesPerChunkEntry entry = { aFirstChunk, aSamplesPerChunk,
-            aSampleDescriptionIndex };
+            aSampleDescriptionIndex, firstSample };
     iSamplesPerChunk.push_back(entry);
 }
 
 void SeekTable::SetAudioSamplesPerSample(TUint32 aSampleCount,
         TUint32 aAudioSamples)
 {
-    TAudioSamplesPerSampleEntry entry = { aSampleCount, aAudioSamples };
+    TUint64 firstCodecSample = 0;
+    TUint64 firstAudioSample = 0;
+    if (iAudioSamplesPerSample.size() > 0) {
+        const TAudioSamplesPerSampleEntry& prev = iAudioSamplesPerSample.back();
+        firstCodecSample = prev.iFirstCodecSample + prev.iSampleCount;
+        firstAudioSample = prev.iFirstAudioSample + (TUint64)prev.iSampleCount * prev.iAudioSamples;
+    }
+    TAudioSamplesPerSampleEntry entry = { aSampleCount, aAudioSamples, firstCodecSample, firstAudioSample };
     iAudioSamplesPerSample.push_back(entry);
 }
 
@@ -2144,54 +2289,28 @@ TUint SeekTable::AudioSamplesPerSample() const
 
 TUint SeekTable::SamplesPerChunk(TUint aChunkIndex) const
 {
-    //ASSERT(aChunkIndex < iSamplesPerChunk.size());
-    //return iSamplesPerChunk[aChunkIndex];
-
-    // FIXME - don't move through loop backwards.
-    TUint current = iSamplesPerChunk.size() - 1;
-    for (;;) {
-        // Note: aChunkIndex = 0 => iFirstChunk = 1
-        if (iSamplesPerChunk[current].iFirstChunk <= aChunkIndex + 1) {
-            return iSamplesPerChunk[current].iSamples;
-        }
-        ASSERT(current != 0);
-        current--;
+    // Note: aChunkIndex = 0 => iFirstChunk = 1
+    const TUint run = SamplesPerChunkRun(aChunkIndex + 1);
+    if (run == iSamplesPerChunk.size()) {
+        THROW(MediaMpeg4FileInvalid);
     }
+    return iSamplesPerChunk[run].iSamples;
 }
 
 TUint SeekTable::StartSample(TUint aChunkIndex) const
 {
     // NOTE: chunk indexes passed in start from 0, but chunks referenced within seek table start from 1.
-    TUint startSample = 0;
     const TUint desiredChunk = aChunkIndex + 1;
-    TUint prevFirstChunk = 1;
-    TUint prevSamples = 0;
-    for (TUint i = 0; i < iSamplesPerChunk.size(); i++) {
-        const TUint nextFirstChunk = iSamplesPerChunk[i].iFirstChunk;
-        const TUint nextSamples = iSamplesPerChunk[i].iSamples;
-
-        // Desired chunk was within last chunk range.
-        if (nextFirstChunk >= desiredChunk) {
-            const TUint chunkDiff = desiredChunk - prevFirstChunk;
-            startSample += chunkDiff * prevSamples;
-            prevFirstChunk = nextFirstChunk;
-            prevSamples = nextSamples;
-            break;
-        }
-
-        const TUint chunkDiff = nextFirstChunk - prevFirstChunk;
-        startSample += chunkDiff * prevSamples;
-        prevFirstChunk = nextFirstChunk;
-        prevSamples = nextSamples;
+    const TUint run = SamplesPerChunkRun(desiredChunk);
+    if (run == iSamplesPerChunk.size()) {
+        return 0;
     }
-
-    // See if exhausted samples per chunk table without encountering desired chunk.
-    if (prevFirstChunk < desiredChunk) {
-        const TUint chunkDiff = desiredChunk - prevFirstChunk;
-        startSample += chunkDiff * prevSamples;
+    const TSamplesPerChunkEntry& entry = iSamplesPerChunk[run];
+    const TUint64 startSample = entry.iFirstSample + (TUint64)(desiredChunk - entry.iFirstChunk) * entry.iSamples;
+    if (startSample > std::numeric_limits<TUint>::max()) {
+        THROW(MediaMpeg4FileInvalid);
     }
-
-    return startSample;
+    return static_cast<TUint>(startSample);
 }
 
 TUint64 SeekTable::Offset(TUint64& aAudioSample, TUint64& aSample)
@@ -2309,174 +2428,112 @@ TUint64 SeekTable::CodecSample(TUint64 aAudioSample) const
 {
     // Use entries from stts box to find codec sample that contains the desired
     // audio sample.
-    TUint64 totalCodecSamples = 0;
-    TUint64 totalAudioSamples = 0;
-    for (TUint entry = 0; entry < iAudioSamplesPerSample.size(); entry++) {
-        const TUint sampleCount = iAudioSamplesPerSample[entry].iSampleCount;
-        const TUint audioSamples = iAudioSamplesPerSample[entry].iAudioSamples;
-        const TUint audioSamplesInrange = sampleCount * audioSamples;
-        if (aAudioSample <= totalCodecSamples + audioSamplesInrange) {
-            // Audio samples are within this range.
-
-            // Find codec sample in this range that contains given audio sample.
-            ASSERT(aAudioSample >= totalAudioSamples);
-            const TUint64 audioSampleOffset = aAudioSample - totalAudioSamples;
-            const TUint64 codecSampleOffset = audioSampleOffset / audioSamples;
-            ASSERT(codecSampleOffset <= sampleCount);
-
-            totalCodecSamples += codecSampleOffset;
-            return totalCodecSamples;
-        }
-        totalCodecSamples += sampleCount;
-        totalAudioSamples += audioSamplesInrange;
-    }
-
-    if (aAudioSample > totalAudioSamples) {
+    // Find the first range that ends at or beyond aAudioSample.
+    auto it = std::lower_bound(iAudioSamplesPerSample.begin(), iAudioSamplesPerSample.end(), aAudioSample,
+        [](const TAudioSamplesPerSampleEntry& aEntry, TUint64 aSample) {
+            return aEntry.iFirstAudioSample + (TUint64)aEntry.iSampleCount * aEntry.iAudioSamples < aSample;
+        });
+    if (it == iAudioSamplesPerSample.end()) {
         THROW(MediaMpeg4OutOfRange);
     }
-
-    // Something went wrong. Could be corrupt table or programmer error!
-    LOG(kCodec, "SeekTable::CodecSample could not find aAudioSample: %u\n", aAudioSample);
-    THROW(MediaMpeg4FileInvalid);
-}
-
-TUint SeekTable::SamplesPerChunkTotal(TUint aIndex) const
-{
-    // Calculates chunks*samples_per_chunk at given index in samples-per-chunk
-    // table.
-    ASSERT(aIndex < iSamplesPerChunk.size());
-    const TUint startChunk = iSamplesPerChunk[aIndex].iFirstChunk;
-    const TUint spc = iSamplesPerChunk[aIndex].iSamples;
-    TUint endChunk = 0;
-
-    // Find last chunk in current run.
-    if (aIndex + 1 < iSamplesPerChunk.size()) {
-        endChunk = iSamplesPerChunk[aIndex + 1].iFirstChunk;
-    }
-    else {
-        // No next entry, so end chunk must be last chunk in file.
-        // Since chunk numbers start at one, must be chunk_count+1.
-        endChunk = iOffsets.size()+1;
+    if (it->iAudioSamples == 0) {
+        // Something went wrong. Could be corrupt table or programmer error!
+        LOG(kCodec, "SeekTable::CodecSample could not find aAudioSample: %llu\n", aAudioSample);
+        THROW(MediaMpeg4FileInvalid);
     }
 
-    const TUint chunkDiff = endChunk - startChunk;
-    const TUint samplesInRange = chunkDiff * spc;
-
-    return samplesInRange;
+    // Find codec sample in this range that contains given audio sample.
+    const TUint64 audioSampleOffset = aAudioSample - it->iFirstAudioSample;
+    const TUint64 codecSampleOffset = audioSampleOffset / it->iAudioSamples;
+    ASSERT(codecSampleOffset <= it->iSampleCount);
+    return it->iFirstCodecSample + codecSampleOffset;
 }
 
-TUint SeekTable::ChunkWithinSamplesPerChunk(TUint aIndex, TUint aSampleOffset) const
+TUint SeekTable::SamplesPerChunkRun(TUint aChunk) const
 {
-    ASSERT(aIndex < iSamplesPerChunk.size());
-    const TUint chunk = iSamplesPerChunk[aIndex].iFirstChunk;
-    const TUint spc = iSamplesPerChunk[aIndex].iSamples;
-    const TUint chunkOffset = static_cast<TUint>(aSampleOffset / spc);
-    return chunk + chunkOffset;
+    // Returns iSamplesPerChunk.size() if aChunk precedes the first run.
+    auto it = std::upper_bound(iSamplesPerChunk.begin(), iSamplesPerChunk.end(), aChunk,
+        [](TUint aChunkNum, const TSamplesPerChunkEntry& aEntry) {
+            return aChunkNum < aEntry.iFirstChunk;
+        });
+    if (it == iSamplesPerChunk.begin()) {
+        return static_cast<TUint>(iSamplesPerChunk.size());
+    }
+    return static_cast<TUint>(it - iSamplesPerChunk.begin()) - 1;
 }
 
 TUint SeekTable::Chunk(TUint64 aCodecSample) const
 {
     // Use data from stsc box to find chunk containing the desired codec sample.
-    TUint64 totalSamples = 0;
-    for (TUint entry = 0; entry < iSamplesPerChunk.size(); entry++) {
-        const TUint samplesInRange = SamplesPerChunkTotal(entry);
-        if (aCodecSample < totalSamples + samplesInRange) {
-            // Desired sample is in this range.
-
-            // Find chunk in this range that contains the desired sample.
-            ASSERT(aCodecSample >= totalSamples);
-            const TUint64 sampleOffset64 = aCodecSample - totalSamples;
-            ASSERT(sampleOffset64 <= std::numeric_limits<TUint>::max());  // Ensure no issues with casting to smaller type.
-            const TUint sampleOffset = static_cast<TUint>(sampleOffset64);
-            const TUint chunk = ChunkWithinSamplesPerChunk(entry, sampleOffset);
-
-            return chunk;
-        }
-
-        totalSamples += samplesInRange;
+    if (iSamplesPerChunk.size() == 0) {
+        THROW(MediaMpeg4FileInvalid);
+    }
+    // Final run extends to the last chunk in the file.
+    // Since chunk numbers start at one, this is chunk_count+1.
+    const TSamplesPerChunkEntry& last = iSamplesPerChunk.back();
+    const TUint endChunk = static_cast<TUint>(iOffsets.size()) + 1;
+    const TUint lastChunks = (endChunk > last.iFirstChunk? endChunk - last.iFirstChunk : 0);
+    const TUint64 totalSamples = last.iFirstSample + (TUint64)lastChunks * last.iSamples;
+    if (aCodecSample >= totalSamples) {
+        if (aCodecSample > totalSamples) {
+            THROW(MediaMpeg4OutOfRange);
+        }
+        LOG(kCodec, "SeekTable::Chunk could not find aCodecSample: %llu\n", aCodecSample);
+        THROW(MediaMpeg4FileInvalid);
     }
 
-    if (aCodecSample > totalSamples) {
-        THROW(MediaMpeg4OutOfRange);
+    // Last run starting at or before aCodecSample.  Runs that contain no samples share
+    // iFirstSample with their successor so are skipped over.
+    auto it = std::upper_bound(iSamplesPerChunk.begin(), iSamplesPerChunk.end(), aCodecSample,
+        [](TUint64 aSample, const TSamplesPerChunkEntry& aEntry) {
+            return aSample < aEntry.iFirstSample;
+        });
+    ASSERT(it != iSamplesPerChunk.begin());
+    --it;
+    if (it->iSamples == 0) {
+        THROW(MediaMpeg4FileInvalid);
     }
 
-    LOG(kCodec, "SeekTable::Chunk could not find aCodecSample: %u\n", aCodecSample);
-    THROW(MediaMpeg4FileInvalid);
+    // Find chunk in this range that contains the desired sample.
+    const TUint64 chunkOffset = (aCodecSample - it->iFirstSample) / it->iSamples;
+    ASSERT(chunkOffset <= std::numeric_limits<TUint>::max());  // Ensure no issues with casting to smaller type.
+    return it->iFirstChunk + static_cast<TUint>(chunkOffset);
 }
 
 TUint SeekTable::CodecSampleFromChunk(TUint aChunk) const
 {
-    // Use data from stsc box to find chunk containing the desired codec sample.
-    TUint totalSamples = 0;
-    TUint chunk = 1;
-    for (TUint entry = 0; entry < iSamplesPerChunk.size(); entry++) {
-        const TUint startChunk = iSamplesPerChunk[entry].iFirstChunk;
-        const TUint spc = iSamplesPerChunk[entry].iSamples;
-        TUint endChunk = 0;
-
-        // Find last chunk in current run.
-        if (entry + 1 < iSamplesPerChunk.size()) {
-            endChunk = iSamplesPerChunk[entry + 1].iFirstChunk;
-        }
-        else {
-            // No next entry, so end chunk must be last chunk in file.
-            endChunk = iOffsets.size();
-        }
-
-        const TUint chunkDiff = endChunk - startChunk;
-        const TUint samplesInRange = chunkDiff * spc;
-
-        if (aChunk <= endChunk) {
-            // Desired chunk is in this range.
-
-            const TUint chunkOffset = aChunk - startChunk;
-            const TUint sampleOffset = chunkOffset * spc;
-            totalSamples += sampleOffset;
-            return totalSamples;
-        }
-
-        totalSamples += samplesInRange;
-        chunk = startChunk;
-    }
-
-    if (aChunk > chunk) {
+    // Use data from stsc box to find the first codec sample in the desired chunk.
+    if (aChunk > iOffsets.size()) {
         THROW(MediaMpeg4OutOfRange);
     }
-
-    LOG(kCodec, "SeekTable::CodecSampleFromChunk could not find aCodecSample: %u\n", aChunk);
-    THROW(MediaMpeg4FileInvalid);
+    if (aChunk == 0) {
+        LOG(kCodec, "SeekTable::CodecSampleFromChunk could not find aCodecSample: %u\n", aChunk);
+        THROW(MediaMpeg4FileInvalid);
+    }
+    return StartSample(aChunk - 1);
 }
 
 TUint SeekTable::AudioSampleFromCodecSample(TUint aCodecSample) const
 {
     // Use entries from stts box to find audio sample that start at given codec sample;
-    TUint totalCodecSamples = 0;
-    TUint totalAudioSamples = 0;
-    for (TUint entry = 0; entry < iAudioSamplesPerSample.size(); entry++) {
-        const TUint sampleCount = iAudioSamplesPerSample[entry].iSampleCount;
-        const TUint audioSamples = iAudioSamplesPerSample[entry].iAudioSamples;
-        if (aCodecSample <= totalCodecSamples + sampleCount) {
-            // Codec sample is within this range.
-
-            // Find the number of audio samples at the start of the given codec sample.
-            ASSERT(totalCodecSamples <= aCodecSample);
-            const TUint codecSampleOffset = aCodecSample - totalCodecSamples;
-            const TUint audioSampleOffset = codecSampleOffset * audioSamples;
-
-            totalAudioSamples += audioSampleOffset;
-            return audioSampleOffset;
-        }
-        totalCodecSamples += sampleCount;
-        totalAudioSamples += sampleCount * audioSamples;
-    }
-
-    if (aCodecSample > totalCodecSamples) {
+    // Find the first range that ends at or beyond aCodecSample.
+    auto it = std::lower_bound(iAudioSamplesPerSample.begin(), iAudioSamplesPerSample.end(), aCodecSample,
+        [](const TAudioSamplesPerSampleEntry& aEntry, TUint aSample) {
+            return aEntry.iFirstCodecSample + aEntry.iSampleCount < aSample;
+        });
+    if (it == iAudioSamplesPerSample.end()) {
         THROW(MediaMpeg4OutOfRange);
     }
 
-    // Something went wrong. Could be corrupt table or programmer error!
-    LOG(kCodec, "SeekTable::AudioSampleFromCodecSample could not find aCodecSample: %u\n", aCodecSample);
-    THROW(MediaMpeg4FileInvalid);
+    // Find the number of audio samples at the start of the given codec sample.
+    const TUint64 codecSampleOffset = aCodecSample - it->iFirstCodecSample;
+    const TUint64 audioSample = it->iFirstAudioSample + codecSampleOffset * it->iAudioSamples;
+    if (audioSample > std::numeric_limits<TUint>::max()) {
+        // Something went wrong. Could be corrupt table or programmer error!
+        LOG(kCodec, "SeekTable::AudioSampleFromCodecSample could not find aCodecSample: %u\n", aCodecSample);
+        THROW(MediaMpeg4FileInvalid);
+    }
+    return static_cast<TUint>(audioSample);
 }
 
 
@@ -752,22 +752,50 @@ private:
     Mutex iLock;
 };
 
+/*
+Sizes of all codec samples in a stream.
+
+Tables with a constant sample size (signalled by stsz) are stored as a single value.
+Otherwise, each size is stored as a zigzag-encoded varint of its difference from the
+previous size, typically 1-2 bytes per sample rather than 4.  Sequential lookups are
+O(1); random lookups decode forward from the nearest of a sparse set of checkpoints.
+
+The same compact encoding is used when serialising the table for a codec.
+*/
 class SampleSizeTable
 {
+private:
+    static const TUint kCheckpointInterval = 64;    // must be a power of 2
+    static const TUint kMaxVarintBytes = 5;
 public:
     SampleSizeTable();
     ~SampleSizeTable();
     void Init(TUint aMaxEntries);
+    void InitConstant(TUint aCount, TUint aSampleSize);
     void Clear();
     void AddSampleSize(TUint aSampleSize);
     TUint SampleSize(TUint aIndex) const;
+    TUint Bytes(TUint aFirstIndex, TUint aCount) const;   // total size of a run of samples
     TUint Count() const;
+    void Read(IReader& aReader);    // Deserialise; table must have been Clear()ed.
     void WriteInit();
-    void Write(IWriter& aWriter, TUint aMaxBytes);
+    void Write(IWriter& aWriter, TUint aMaxBytes);  // Serialise.
     TBool WriteComplete() const;
 private:
-    std::vector<TUint> iTable;
-    TUint iWriteIndex;
+    TUint DecodeNext() const;
+private:
+    TUint iCount;
+    TUint iMaxEntries;
+    TUint iConstantSize;        // 0 => sizes are in iPacked
+    TUint iPrevSize;
+    std::vector<TByte> iPacked;
+    std::vector<TUint> iCheckpoints;    // offset into iPacked of every kCheckpointInterval'th entry
+    // position of most recent lookup, to make sequential access cheap
+    mutable TUint iCursorIndex;
+    mutable TUint iCursorOffset;
+    mutable TUint iCursorSize;
+    TBool iWriteHeader;
+    TUint iWriteOffset;
 };
 
 // FIXME - should probably also include stss here.
@@ -800,21 +828,25 @@ public:
 private:
     // Find the codec sample that contains the given audio sample.
     TUint64 CodecSample(TUint64 aAudioSample) const;
-    TUint SamplesPerChunkTotal(TUint aIndex) const;
-    TUint ChunkWithinSamplesPerChunk(TUint aIndex, TUint aSampleOffset) const;
+    // Find the samples-per-chunk run that the given (1-based) chunk is in.
+    TUint SamplesPerChunkRun(TUint aChunk) const;
     // Find the chunk that contains the desired codec sample.
     TUint Chunk(TUint64 aCodecSample) const;
     TUint CodecSampleFromChunk(TUint aChunk) const;
     TUint AudioSampleFromCodecSample(TUint aCodecSample) const;
 private:
+    // iFirstSample/iFirstCodecSample/iFirstAudioSample are running totals, allowing lookups by binary search.
     typedef struct {
         TUint   iFirstChunk;
         TUint   iSamples;
         TUint   iSampleDescriptionIndex;
+        TUint64 iFirstSample;
     } TSamplesPerChunkEntry;
     typedef struct {
         TUint   iSampleCount;
         TUint   iAudioSamples;
+        TUint64 iFirstCodecSample;
+        TUint64 iFirstAudioSample;
     } TAudioSamplesPerSampleEntry;
 private:
     std::vector<TSamplesPerChunkEntry> iSamplesPerChunk;
@@ -1,7 +1,6 @@
 #include <OpenHome/Media/Codec/CodecController.h>
 #include <OpenHome/Media/Codec/Container.h>
 #include <OpenHome/Media/Codec/CodecFactory.h>
-#include <OpenHome/Private/Arch.h>
 #include <OpenHome/Private/Ascii.h>
 #include <OpenHome/Private/Converter.h>
 #include <OpenHome/Private/Debug.h>
@@ -16,6 +15,7 @@ extern "C" {
 }
 
 #include <limits>
+#include <string.h>
 
 namespace OpenHome {
 namespace Media {
@@ -29,6 +29,7 @@ private:
     static const TInt kInvalidBitstream;
     static const TUint kIcyMetadataBytes = 255 * 16;
     static const TUint kBitDepth = 16;  // Bit depth always 16 for Vorbis.
+    static const AudioDataEndian kEndian;  // Tremor outputs native endian samples
 public:
     static const Brn kCodecVorbis;
 public:
@@ -36,6 +37,7 @@ public:
     ~CodecVorbis();
 private: // from CodecBase
     TBool Recognise(const EncodedStreamInfo& aStreamInfo);
+    Signature CheckSignature(const Brx& aHead) const;
     void StreamInitialise();
     void Process();
     TBool TrySeek(TUint aStreamId, TUint64 aSample);
@@ -52,7 +54,6 @@ public:
 private:
     TBool FindSync();
     TUint64 GetTotalSamples();
-    void BigEndian(TInt16* aDst, TInt16* aSrc, TUint aSamples);
     void FlushOutput();
     TBool StreamInfoChanged(TUint aChannels, TUint aSampleRate) const;
     void OutputMetaData();
@@ -62,7 +63,6 @@ private:
     void *iDataSource; // dummy stream identifier
     OggVorbis_File iVf;
 
-    Bws<DecodedAudio::kMaxBytes> iInBuf;
     Bws<DecodedAudio::kMaxBytes> iOutBuf;
     Bws<2*kSearchChunkSize> iSeekBuf;   // can store 2 read chunks, to check for sync word across read boundaries
  
@@ -99,6 +99,11 @@ CodecBase* CodecFactory::NewVorbis(IMimeTypeList& aMimeTypeList)
 
 
 const TInt CodecVorbis::kInvalidBitstream = std::numeric_limits<TInt>::max();
+#ifdef DEFINE_BIG_ENDIAN
+const AudioDataEndian CodecVorbis::kEndian = AudioDataEndian::Big;
+#else
+const AudioDataEndian CodecVorbis::kEndian = AudioDataEndian::Little;
+#endif
 const Brn CodecVorbis::kCodecVorbis("VORBIS");
 
 size_t ReadCallback(void *ptr, size_t size, size_t nmemb, void *datasource);
@@ -227,6 +232,19 @@ TBool CodecVorbis::Recognise(const EncodedStreamInfo& aStreamInfo)
     return isVorbis;
 }
 
+CodecBase::Signature CodecVorbis::CheckSignature(const Brx& aHead) const
+{
+    // Vorbis identification header is the only packet on the first Ogg page (27 byte page
+    // header plus a single byte segment table).  libvorbisfile will skip leading garbage
+    // looking for a page so we can't rule out anything that doesn't match.
+    static const TUint kIdHeaderOffset = 28;
+    if (aHead.Bytes() >= kIdHeaderOffset + 7 && Brn(aHead.Ptr(), 4) == Brn("OggS")
+        && aHead[kIdHeaderOffset] == 0x01 && Brn(aHead.Ptr() + kIdHeaderOffset + 1, 6) == Brn("vorbis")) {
+        return Signature::eMatch;
+    }
+    return Signature::eUnknown;
+}
+
 void CodecVorbis::StreamInitialise()
 {
     LOG(kCodec, "CodecVorbis::StreamInitialise\n");
@@ -245,7 +263,6 @@ void CodecVorbis::StreamInitialise()
     iSampleRate = info->rate;
 
     iTotalSamplesOutput = 0;
-    iInBuf.SetBytes(0);
     iOutBuf.SetBytes(0);
 
     iBytesPerSample = iChannels*kBitDepth/8;
@@ -319,7 +336,6 @@ TBool CodecVorbis::TrySeek(TUint aStreamId, TUint64 aSample)
     if (canSeek) {
         iTotalSamplesOutput = aSample;
         iTrackOffset = (aSample * Jiffies::kPerSecond) / iSampleRate;
-        iInBuf.SetBytes(0);
         iOutBuf.SetBytes(0);
         iController->OutputDecodedStream(0, kBitDepth, iSampleRate, iChannels, kCodecVorbis, iTrackLengthJiffies, aSample, false, DeriveProfile(iChannels));
     }
@@ -417,15 +433,6 @@ TUint64 CodecVorbis::GetTotalSamples()
     THROW(CodecStreamCorrupt);
 }
 
-// copy audio data to output buffer, converting to big endian if required.
-void CodecVorbis::BigEndian(TInt16* aDst, TInt16* aSrc, TUint aSamples)
-{
-    aSamples *= iChannels;
-    while(aSamples--) {
-        *aDst++ = Arch::BigEndian2(*aSrc++);
-    }
-}
-
 void CodecVorbis::Process()
 {
     LOG(kCodec, "\n CodecVorbis::Process\n");
@@ -436,9 +443,10 @@ void CodecVorbis::Process()
     if(!iStreamEnded || !iNewStreamStarted) {
         LOG(kCodec, "CodecVorbis::Process bitstream %d\n", bitstream);
         try {
-            char *pcm = (char *)iInBuf.Ptr();
+            // Decode directly into iOutBuf.  Conversion to big endian is left to the
+            // pipeline, which does it as part of copying into a MsgAudioPcm.
+            char *pcm = (char *)iOutBuf.Ptr() + iOutBuf.Bytes();
             TInt request = (iOutBuf.MaxBytes() - iOutBuf.Bytes());
-            ASSERT((TInt)iInBuf.MaxBytes() >= request);
 
             TInt bytes = 0;
             bytes = ov_read(&iVf, pcm, request, (int*)&bitstream);
@@ -465,7 +473,9 @@ void CodecVorbis::Process()
                 // buffered PCM from previous stream.
                 if (iOutBuf.Bytes() > 0) {
                     iTrackOffset += iController->OutputAudioPcm(iOutBuf, iChannels, iSampleRate,
-                        kBitDepth, AudioDataEndian::Big, iTrackOffset);
+                        kBitDepth, kEndian, iTrackOffset);
+                    // move pcm for the new bitstream to the start of iOutBuf
+                    (void)memmove(const_cast<TByte*>(iOutBuf.Ptr()), pcm, bytes);
                     iOutBuf.SetBytes(0);
                     LOG(kCodec, "CodecVorbis::Process output (new bitstream detected) - total samples = %llu\n", iTotalSamplesOutput);
                 }
@@ -500,16 +510,13 @@ void CodecVorbis::Process()
             }
 
             TUint samples = bytes/iBytesPerSample;
-            TByte* dstByte = const_cast<TByte*>(iOutBuf.Ptr()) + iOutBuf.Bytes();
-            TInt16* dst = reinterpret_cast<TInt16*>(dstByte);
-            BigEndian(dst, (TInt16 *)pcm, samples);
             iOutBuf.SetBytes(iOutBuf.Bytes()+bytes);
             iTotalSamplesOutput += samples;
 
             LOG(kCodec, "CodecVorbis::Process read - bytes %d, iPrevBytes %d\n", bytes, iPrevBytes);
             if (iOutBuf.MaxBytes() - iOutBuf.Bytes() < (TUint)((kBitDepth/8) * iChannels)) {
                 iTrackOffset += iController->OutputAudioPcm(iOutBuf, iChannels, iSampleRate,
-                    kBitDepth, AudioDataEndian::Big, iTrackOffset);
+                    kBitDepth, kEndian, iTrackOffset);
                 iOutBuf.SetBytes(0);
                 LOG(kCodec, "CodecVorbis::Process output - total samples = %llu\n", iTotalSamplesOutput);
             }
@@ -533,7 +540,7 @@ void CodecVorbis::FlushOutput()
     if (iStreamEnded || iNewStreamStarted) {
         if (iOutBuf.Bytes() > 0) {
             iTrackOffset += iController->OutputAudioPcm(iOutBuf, iChannels, iSampleRate,
-                kBitDepth, AudioDataEndian::Big, iTrackOffset);
+                kBitDepth, kEndian, iTrackOffset);
             iOutBuf.SetBytes(0);
         }
         if (iNewStreamStarted) {
@@ -23,6 +23,7 @@ public:
     ~CodecWav();
 private: // from CodecBase
     TBool Recognise(const EncodedStreamInfo& aStreamInfo);
+    Signature CheckSignature(const Brx& aHead) const;
     void StreamInitialise();
     void Process();
     TBool TrySeek(TUint aStreamId, TUint64 aSample);
@@ -96,6 +97,14 @@ TBool CodecWav::Recognise(const EncodedStreamInfo& aStreamInfo)
     return false;
 }
 
+CodecBase::Signature CodecWav::CheckSignature(const Brx& aHead) const
+{
+    if (aHead.Bytes() >= 12 && Brn(aHead.Ptr(), 4) == Brn("RIFF") && Brn(aHead.Ptr()+8, 4) == Brn("WAVE")) {
+        return Signature::eMatch;
+    }
+    return Signature::eNoMatch;
+}
+
 void CodecWav::StreamInitialise()
 {
     iNumChannels = 0;
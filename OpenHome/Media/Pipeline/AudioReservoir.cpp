@@ -4,6 +4,7 @@
 #include <OpenHome/Private/Thread.h>
 #include <OpenHome/Private/Printer.h>
 #include <OpenHome/Media/Pipeline/Msg.h>
+#include <OpenHome/Media/Pipeline/PipelineMetrics.h>
 
 using namespace OpenHome;
 using namespace OpenHome::Media;
@@ -13,6 +14,8 @@ using namespace OpenHome::Media;
 AudioReservoir::AudioReservoir()
     : iLock("ARES")
     , iSem("ARES", 0)
+    , iMetrics(nullptr)
+    , iMetricsOccupancy(nullptr)
 {
 }
 
@@ -20,6 +23,13 @@ AudioReservoir::~AudioReservoir()
 {
 }
 
+void AudioReservoir::SetMetrics(PipelineMetrics& aMetrics, const TChar* aId, const TChar* aUnits)
+{
+    ASSERT(iMetrics == nullptr);
+    iMetrics = &aMetrics;
+    iMetricsOccupancy = &aMetrics.RegisterHistogram(aId, "occupancy", aUnits);
+}
+
 Msg* AudioReservoir::Pull()
 {
     Msg* msg;
@@ -27,6 +37,9 @@ Msg* AudioReservoir::Pull()
         msg = DoDequeue();
         UnblockIfNotFull();
     } while (msg == nullptr);
+    if (iMetricsOccupancy != nullptr && iMetrics->Enabled()) {
+        iMetricsOccupancy->Add(Occupancy());
+    }
     return msg;
 }
 
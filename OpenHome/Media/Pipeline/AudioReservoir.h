@@ -8,12 +8,16 @@
 namespace OpenHome {
 namespace Media {
 
+class PipelineMetrics;
+class MetricsHistogram;
+
 /*
 Abstract element which buffers [0..MaxSize] units of audio.
 Msgs can be pulled whenever available.
 Blocks further data being enqueued when size is greater that MaxSize.
 Discards all data when a Flush msg is queued.
 FIXME - no handling of Halt
+Occupancy (in units chosen by the derived class) is optionally sampled on each Pull().
 */
     
 class AudioReservoir : protected MsgReservoir, public IPipelineElementUpstream, public IPipelineElementDownstream
@@ -21,6 +25,7 @@ class AudioReservoir : protected MsgReservoir, public IPipelineElementUpstream,
     friend class SuiteAudioReservoir;
 public:
     ~AudioReservoir();
+    void SetMetrics(PipelineMetrics& aMetrics, const TChar* aId, const TChar* aUnits);
 public: // from IPipelineElementUpstream
     Msg* Pull() override;
 public: // from IPipelineElementDownstream
@@ -32,9 +37,12 @@ protected:
 private:
     virtual TBool IsFull() const = 0;
     virtual void HandleBlocked();
+    virtual TUint Occupancy() const = 0;
 private:
     Mutex iLock;
     Semaphore iSem;
+    PipelineMetrics* iMetrics;
+    MetricsHistogram* iMetricsOccupancy;
 };
 
 } // namespace Media
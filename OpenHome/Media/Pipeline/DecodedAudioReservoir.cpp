@@ -12,12 +12,16 @@ using namespace OpenHome::Media;
 // DecodedAudioReservoir
 
 DecodedAudioReservoir::DecodedAudioReservoir(MsgFactory& aMsgFactory, IFlushIdProvider& aFlushIdProvider,
-                                             TUint aMaxSize, TUint aMaxStreamCount, TUint aGorgeSize)
+                                             TUint aMaxSize, TUint aMaxStreamCount, TUint aGorgeSize, TUint aDecodeAheadSize)
     : iMsgFactory(aMsgFactory)
     , iFlushIdProvider(aFlushIdProvider)
     , iLock("DCR1")
     , iMaxJiffies(aMaxSize)
     , iMaxStreamCount(aMaxStreamCount)
+    , iDecodeAheadJiffies(aDecodeAheadSize)
+    , iDecodingAhead(false)
+    , iDecodeAheadStreamId(0)
+    , iStreamIdIn(UINT_MAX)
     , iClockPuller(nullptr)
     , iStreamHandler(nullptr)
     , iDecodedStream(nullptr)
@@ -99,7 +103,8 @@ void DecodedAudioReservoir::Push(Msg* aMsg)
 
 TBool DecodedAudioReservoir::IsFull() const
 {
-    return (Jiffies() > iMaxJiffies         ||
+    const TUint maxJiffies = iDecodingAhead.load()? iMaxJiffies + iDecodeAheadJiffies : iMaxJiffies;
+    return (Jiffies() > maxJiffies          ||
             TrackCount() >= iMaxStreamCount ||
             DecodedStreamCount() >= iMaxStreamCount);
 }
@@ -112,6 +117,11 @@ void DecodedAudioReservoir::HandleBlocked()
     }
 }
 
+TUint DecodedAudioReservoir::Occupancy() const
+{
+    return Jiffies() / Jiffies::kPerMs;
+}
+
 void DecodedAudioReservoir::SetGorging(TBool aGorging, const TChar* aId)
 {
     const TBool unblockRight = (iGorging && !aGorging);
@@ -136,6 +146,7 @@ void DecodedAudioReservoir::ProcessMsgIn(MsgMode* aMsg)
         iShouldGorge = false;
         iPriorityMsgCount++;
     }
+    iDecodingAhead.store(false); // don't carry the allowance over into a new mode
     iGorgeLock.Wait();
     SetGorging(false, "ModeIn");
     iGorgeLock.Signal();
@@ -170,8 +181,15 @@ void DecodedAudioReservoir::ProcessMsgIn(MsgHalt* /*aMsg*/)
     iPriorityMsgCount++;
 }
 
-void DecodedAudioReservoir::ProcessMsgIn(MsgDecodedStream* /*aMsg*/)
+void DecodedAudioReservoir::ProcessMsgIn(MsgDecodedStream* aMsg)
 {
+    const TUint streamId = aMsg->StreamInfo().StreamId();
+    if (iDecodeAheadJiffies > 0 && streamId != iStreamIdIn && !iDecodingAhead.load() && Jiffies() > 0) {
+        // audio from an earlier stream is still to be played; let the codec make a start on this one
+        iDecodeAheadStreamId.store(streamId);
+        iDecodingAhead.store(true);
+    }
+    iStreamIdIn = streamId;
     BlockIfFull();
     iPriorityMsgCount++;
 }
@@ -253,6 +271,12 @@ Msg* DecodedAudioReservoir::ProcessMsgOut(MsgDecodedStream* aMsg)
     }
     iDecodedStream = aMsg;
 
+    if (iDecodingAhead.load() && aMsg->StreamInfo().StreamId() == iDecodeAheadStreamId.load()) {
+        LOG(kPipeline, "DecodedAudioReservoir: stream %u starting with %ums decoded ahead\n",
+                       iDecodeAheadStreamId.load(), Jiffies() / Jiffies::kPerMs);
+        iDecodingAhead.store(false);
+    }
+
     iGorgeLock.Wait();
     iPriorityMsgCount--;
     iStartOfMode = false;
@@ -11,17 +11,28 @@
 namespace OpenHome {
 namespace Media {
 
+/*
+Buffers up to aMaxSize jiffies of decoded audio.
+
+If aDecodeAheadSize is non-zero, the codec can decode up to that much more audio for the
+next stream while earlier streams are still playing out.  This gives slow codecs a
+head start on the next track, at the cost of a temporarily larger reservoir.  The
+extra allowance is removed once the next stream starts playing.
+*/
+
 class DecodedAudioReservoir : public AudioReservoir, private IStreamHandler
 {
     friend class SuiteGorger;
+    friend class SuiteDecodeAhead;
 public:
     DecodedAudioReservoir(MsgFactory& aMsgFactory, IFlushIdProvider& aFlushIdProvider,
-                          TUint aMaxSize, TUint aMaxStreamCount, TUint aGorgeSize);
+                          TUint aMaxSize, TUint aMaxStreamCount, TUint aGorgeSize, TUint aDecodeAheadSize);
     ~DecodedAudioReservoir();
     TUint SizeInJiffies() const;
 private: // from AudioReservoir
     TBool IsFull() const override;
     void HandleBlocked() override;
+    TUint Occupancy() const override;
 public: // from IPipelineElementUpstream
     Msg* Pull() override;
 public: // from IPipelineElementDownstream
@@ -62,6 +73,10 @@ private:
     Mutex iLock;
     const TUint iMaxJiffies;
     const TUint iMaxStreamCount;
+    const TUint iDecodeAheadJiffies;
+    std::atomic<TBool> iDecodingAhead;
+    std::atomic<TUint> iDecodeAheadStreamId;
+    TUint iStreamIdIn;
     IClockPuller* iClockPuller;
     std::atomic<IStreamHandler*> iStreamHandler;
     MsgDecodedStream *iDecodedStream;
@@ -0,0 +1,484 @@
+#include <OpenHome/Media/Pipeline/DsdToPcm.h>
+#include <OpenHome/Types.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Media/Pipeline/Msg.h>
+#include <OpenHome/Private/Printer.h>
+#include <OpenHome/Private/Debug.h>
+#include <OpenHome/Media/Debug.h>
+
+#include <algorithm>
+#include <math.h>
+
+using namespace OpenHome;
+using namespace OpenHome::Media;
+
+static const double kPi = 3.14159265358979323846;
+static const double kKaiserBeta = 8.0; // ~80dB stopband attenuation
+static const TByte kDsdSilence = 0x69;
+
+// DsdFilterBank
+
+DsdFilterBank::DsdFilterBank()
+{
+    // Cut off at half the first stage's output rate.  For any DSD rate, the filter is then
+    // well into its stopband before anything could alias into the final (at most fs/32) band.
+    std::vector<double> taps;
+    DesignLowPass(taps, kLookupTaps, 1.0 / 16, kKaiserBeta);
+    for (TUint i=0; i<kLookupBytes; i++) {
+        for (TUint pattern=0; pattern<256; pattern++) {
+            double sum = 0;
+            for (TUint bit=0; bit<8; bit++) {
+                const double tap = taps[i*8 + bit];
+                sum += ((pattern >> (7-bit)) & 1)? tap : -tap;
+            }
+            iLookup[i][pattern] = (float)sum;
+        }
+    }
+    HalfBandEvenTaps(iHalfBandIntermediate, kHalfBandTapsIntermediate, kKaiserBeta);
+    HalfBandEvenTaps(iHalfBandFinal, kHalfBandTapsFinal, kKaiserBeta);
+}
+
+void DsdFilterBank::DesignLowPass(std::vector<double>& aTaps, TUint aCount, double aCutoff, double aBeta)
+{ // static
+    // Kaiser windowed sinc, normalised for unity gain at DC.  aCutoff is a fraction of the sample rate.
+    aTaps.resize(aCount);
+    const double centre = (aCount - 1) / 2.0;
+    const double window0 = BesselI0(aBeta);
+    double sum = 0;
+    for (TUint i=0; i<aCount; i++) {
+        const double t = i - centre;
+        const double sinc = (fabs(t) < 1e-9? 2 * aCutoff : sin(2 * kPi * aCutoff * t) / (kPi * t));
+        const double r = t / centre;
+        const double window = BesselI0(aBeta * sqrt(std::max(0.0, 1 - r*r))) / window0;
+        aTaps[i] = sinc * window;
+        sum += aTaps[i];
+    }
+    for (TUint i=0; i<aCount; i++) {
+        aTaps[i] /= sum;
+    }
+}
+
+void DsdFilterBank::HalfBandEvenTaps(std::vector<float>& aEvenTaps, TUint aCount, double aBeta)
+{ // static
+    // odd length, centre tap at an odd index, so every other odd indexed tap is (nominally) zero
+    ASSERT(aCount % 4 == 3);
+    std::vector<double> taps;
+    DesignLowPass(taps, aCount, 0.25, aBeta);
+    double sum = 0;
+    for (TUint i=0; i<aCount; i+=2) {
+        sum += taps[i];
+    }
+    // scale so that the even taps and the 0.5 centre tap sum to exactly 1
+    aEvenTaps.clear();
+    for (TUint i=0; i<aCount; i+=2) {
+        aEvenTaps.push_back((float)(taps[i] * 0.5 / sum));
+    }
+    ASSERT(aEvenTaps.size() % 4 == 0);
+}
+
+double DsdFilterBank::BesselI0(double aX)
+{ // static
+    double sum = 1;
+    double term = 1;
+    const double x2 = aX * aX / 4;
+    for (TUint k=1; k<50 && term > sum * 1e-12; k++) {
+        term *= x2 / ((double)k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+
+// DsdDecimator::HalfBand
+
+DsdDecimator::HalfBand::HalfBand(const std::vector<float>& aEvenTaps)
+    : iEvenTaps(aEvenTaps)
+    , iCentre((TUint)aEvenTaps.size() / 2 - 1)
+    , iOddNext(false)
+{
+}
+
+void DsdDecimator::HalfBand::Reset()
+{
+    // Equal history for both phases.  The odd sample at iCentre then lines up with the
+    // centre of the even taps and each input pair produces exactly one output.
+    iEven.assign(iEvenTaps.size() - 1, 0.0f);
+    iOdd.assign(iEvenTaps.size() - 1, 0.0f);
+    iOddNext = false;
+}
+
+TUint DsdDecimator::HalfBand::Process(const float* aIn, TUint aCount, float* aOut)
+{
+    // Input is split into even and odd phases.  All even indexed taps are non-zero and
+    // are applied as a contiguous dot product; the only non-zero odd tap is the centre.
+    for (TUint i=0; i<aCount; i++) {
+        if (iOddNext) {
+            iOdd.push_back(aIn[i]);
+        }
+        else {
+            iEven.push_back(aIn[i]);
+        }
+        iOddNext = !iOddNext;
+    }
+    const TUint numTaps = (TUint)iEvenTaps.size();
+    const TUint count = (TUint)std::min(iEven.size() - (numTaps - 1), iOdd.size() - iCentre);
+    const float* taps = iEvenTaps.data();
+    const float* even = iEven.data();
+    const float* odd = iOdd.data() + iCentre;
+    for (TUint i=0; i<count; i++) {
+        // independent partial sums allow the compiler to vectorise without reassociating
+        const float* x = even + i;
+        float acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+        for (TUint j=0; j<numTaps; j+=4) {
+            acc0 += taps[j]   * x[j];
+            acc1 += taps[j+1] * x[j+1];
+            acc2 += taps[j+2] * x[j+2];
+            acc3 += taps[j+3] * x[j+3];
+        }
+        aOut[i] = (acc0 + acc1) + (acc2 + acc3) + 0.5f * odd[i];
+    }
+    iEven.erase(iEven.begin(), iEven.begin() + count);
+    iOdd.erase(iOdd.begin(), iOdd.begin() + count);
+    return count;
+}
+
+
+// DsdDecimator
+
+DsdDecimator::DsdDecimator(const DsdFilterBank& aFilters)
+    : iFilters(aFilters)
+{
+    Configure(1);
+}
+
+void DsdDecimator::Configure(TUint aHalfBandStages)
+{
+    ASSERT(aHalfBandStages > 0);
+    iStages.clear();
+    for (TUint i=0; i<aHalfBandStages; i++) {
+        const TBool last = (i == aHalfBandStages - 1);
+        iStages.emplace_back(last? iFilters.iHalfBandFinal : iFilters.iHalfBandIntermediate);
+    }
+    Reset();
+}
+
+void DsdDecimator::Reset()
+{
+    iDsd.assign(DsdFilterBank::kLookupBytes - 1, kDsdSilence);
+    for (auto& stage : iStages) {
+        stage.Reset();
+    }
+}
+
+TUint DsdDecimator::Decimation() const
+{
+    return 8 << iStages.size();
+}
+
+TUint DsdDecimator::Process(const TByte* aDsd, TUint aBytes, std::vector<float>& aPcm)
+{
+    iDsd.insert(iDsd.end(), aDsd, aDsd + aBytes);
+    iScratch[0].resize(aBytes);
+    float* out = iScratch[0].data();
+    const TByte* dsd = iDsd.data();
+    for (TUint i=0; i<aBytes; i++) {
+        const TByte* bytes = dsd + i;
+        float acc0 = 0, acc1 = 0;
+        for (TUint j=0; j<DsdFilterBank::kLookupBytes; j+=2) {
+            acc0 += iFilters.iLookup[j][bytes[j]];
+            acc1 += iFilters.iLookup[j+1][bytes[j+1]];
+        }
+        out[i] = acc0 + acc1;
+    }
+    iDsd.erase(iDsd.begin(), iDsd.begin() + aBytes);
+
+    TUint count = aBytes;
+    const float* in = iScratch[0].data();
+    for (size_t i=0; i<iStages.size(); i++) {
+        std::vector<float>& stageOut = (i == iStages.size() - 1? aPcm : iScratch[(i + 1) & 1]);
+        stageOut.resize(count / 2 + 1);
+        count = iStages[i].Process(in, count, stageOut.data());
+        in = stageOut.data();
+    }
+    aPcm.resize(count);
+    return count;
+}
+
+
+// DsdToPcm
+
+const TUint DsdToPcm::kSupportedMsgTypes =   eMode
+                                           | eTrack
+                                           | eDrain
+                                           | eDelay
+                                           | eEncodedStream
+                                           | eMetatext
+                                           | eStreamInterrupted
+                                           | eHalt
+                                           | eFlush
+                                           | eWait
+                                           | eDecodedStream
+                                           | eBitRate
+                                           | eAudioPcm
+                                           | eAudioDsd
+                                           | eSilence
+                                           | eQuit;
+
+DsdToPcm::DsdToPcm(MsgFactory& aMsgFactory, IPipelineElementDownstream& aDownstreamElement, TBool aDsdSupported)
+    : PipelineElement(kSupportedMsgTypes)
+    , iMsgFactory(aMsgFactory)
+    , iDownstream(aDownstreamElement)
+    , iAnimator(nullptr)
+    , iDsdSupported(aDsdSupported)
+    , iMultiroom(Multiroom::Forbidden)
+    , iConverting(false)
+    , iNumChannels(0)
+    , iSampleRate(0)
+    , iBlockPos(0)
+    , iTrackOffset(0)
+{
+    for (TUint i=0; i<kMaxChannels; i++) {
+        iDecimators[i] = new DsdDecimator(iFilters);
+        iDsd[i].reserve(AudioData::kMaxBytes);
+        iPcm[i].reserve(AudioData::kMaxBytes);
+        iPartial[i] = 0;
+        iPartialBits[i] = 0;
+    }
+}
+
+DsdToPcm::~DsdToPcm()
+{
+    for (TUint i=0; i<kMaxChannels; i++) {
+        delete iDecimators[i];
+    }
+}
+
+void DsdToPcm::SetAnimator(IPipelineAnimator& aPipelineAnimator)
+{
+    iAnimator = &aPipelineAnimator;
+}
+
+void DsdToPcm::Push(Msg* aMsg)
+{
+    Msg* msg = aMsg->Process(*this);
+    if (msg != nullptr) {
+        iDownstream.Push(msg);
+    }
+}
+
+Msg* DsdToPcm::ProcessMsg(MsgEncodedStream* aMsg)
+{
+    // CodecController forbids multiroom for all DSD streams.  Restore the original setting for converted streams
+    iMultiroom = aMsg->Multiroom();
+    return aMsg;
+}
+
+Msg* DsdToPcm::ProcessMsg(MsgDecodedStream* aMsg)
+{
+    const DecodedStreamInfo& info = aMsg->StreamInfo();
+    iConverting = false;
+    if (info.Format() != AudioFormat::Dsd || DsdPlayable(info)) {
+        return aMsg;
+    }
+    const TUint numChannels = info.NumChannels();
+    const TUint stages = (numChannels <= kMaxChannels? SelectHalfBandStages(info.SampleRate(), numChannels) : 0);
+    if (stages == 0) {
+        // leave StreamValidator to reject the stream
+        LOG_ERROR(kPipeline, "DsdToPcm: unable to convert %u channel DSD at %u\n", numChannels, info.SampleRate());
+        return aMsg;
+    }
+
+    iConverting = true;
+    iNumChannels = numChannels;
+    for (TUint i=0; i<iNumChannels; i++) {
+        iDecimators[i]->Configure(stages);
+        iDsd[i].clear();
+        iPartial[i] = 0;
+        iPartialBits[i] = 0;
+    }
+    const TUint decimation = iDecimators[0]->Decimation();
+    iSampleRate = info.SampleRate() / decimation;
+    iBlockPos = 0;
+    iOutput.SetBytes(0);
+    iTrackOffset = MsgAudioDecoded::kTrackOffsetInvalid;
+    LOG(kPipeline, "DsdToPcm: converting %u channel DSD at %u to %u\n", iNumChannels, info.SampleRate(), iSampleRate);
+
+    auto msg = iMsgFactory.CreateMsgDecodedStream(info.StreamId(), info.BitRate(), kBitDepth, iSampleRate, iNumChannels,
+                                                  info.CodecName(), info.TrackLength(), info.SampleStart() / decimation,
+                                                  info.Lossless(), info.Seekable(), info.Live(), info.AnalogBypass(),
+                                                  AudioFormat::Pcm, iMultiroom, info.Profile(), info.StreamHandler());
+    aMsg->RemoveRef();
+    return msg;
+}
+
+Msg* DsdToPcm::ProcessMsg(MsgAudioDsd* aMsg)
+{
+    if (!iConverting) {
+        return aMsg;
+    }
+    if (iTrackOffset == MsgAudioDecoded::kTrackOffsetInvalid) {
+        iTrackOffset = aMsg->TrackOffset();
+    }
+    MsgPlayable* playable = aMsg->CreatePlayable();
+    playable->Read(*this);
+    playable->RemoveRef();
+    return nullptr;
+}
+
+void DsdToPcm::BeginBlock()
+{
+}
+
+void DsdToPcm::ProcessFragment(const Brx& aData, TUint aNumChannels, TUint aSampleBlockBits)
+{
+    ASSERT(aNumChannels == iNumChannels);
+    Deinterleave(aData, aNumChannels, aSampleBlockBits);
+    // a fragment may end part way through a sample block so only decimate data present for all channels
+    size_t bytes = iDsd[0].size();
+    for (TUint i=1; i<iNumChannels; i++) {
+        bytes = std::min(bytes, iDsd[i].size());
+    }
+    TUint samples = 0;
+    for (TUint i=0; i<iNumChannels; i++) {
+        samples = iDecimators[i]->Process(iDsd[i].data(), (TUint)bytes, iPcm[i]);
+        iDsd[i].erase(iDsd[i].begin(), iDsd[i].begin() + bytes);
+    }
+    OutputPcm(samples);
+}
+
+void DsdToPcm::EndBlock()
+{
+    // don't hold audio back from one MsgAudioDsd to the next
+    OutputMsg();
+}
+
+void DsdToPcm::Flush()
+{
+    OutputMsg();
+}
+
+TBool DsdToPcm::DsdPlayable(const DecodedStreamInfo& aInfo) const
+{
+    if (!iDsdSupported) {
+        return false;
+    }
+    ASSERT(iAnimator != nullptr);
+    try {
+        (void)iAnimator->PipelineAnimatorDelayJiffies(AudioFormat::Dsd, aInfo.SampleRate(),
+                                                      aInfo.BitDepth(), aInfo.NumChannels());
+        return true;
+    }
+    catch (FormatUnsupported&) {}
+    catch (SampleRateUnsupported&) {}
+    catch (BitDepthUnsupported&) {}
+    return false;
+}
+
+TBool DsdToPcm::PcmPlayable(TUint aSampleRate, TUint aNumChannels) const
+{
+    ASSERT(iAnimator != nullptr);
+    try {
+        (void)iAnimator->PipelineAnimatorDelayJiffies(AudioFormat::Pcm, aSampleRate, kBitDepth, aNumChannels);
+        return true;
+    }
+    catch (FormatUnsupported&) {}
+    catch (SampleRateUnsupported&) {}
+    catch (BitDepthUnsupported&) {}
+    return false;
+}
+
+TUint DsdToPcm::SelectHalfBandStages(TUint aDsdSampleRate, TUint aNumChannels) const
+{
+    // Prefer the highest supported rate.  If the animator supports none, choose the highest
+    // valid rate and let StreamValidator report the stream as unplayable.
+    TUint fallback = 0;
+    for (TUint stages=1; stages<=kMaxHalfBandStages; stages++) {
+        const TUint decimation = 8 << stages;
+        if (aDsdSampleRate % decimation != 0) {
+            break;
+        }
+        const TUint sampleRate = aDsdSampleRate / decimation;
+        if (sampleRate > kMaxSampleRate || !Jiffies::IsValidSampleRate(sampleRate)) {
+            continue;
+        }
+        if (PcmPlayable(sampleRate, aNumChannels)) {
+            return stages;
+        }
+        if (fallback == 0) {
+            fallback = stages;
+        }
+    }
+    return fallback;
+}
+
+void DsdToPcm::Deinterleave(const Brx& aData, TUint aNumChannels, TUint aSampleBlockBits)
+{
+    const TUint channelBits = aSampleBlockBits / aNumChannels;
+    ASSERT(channelBits > 0 && channelBits * aNumChannels == aSampleBlockBits);
+    const TByte* ptr = aData.Ptr();
+    const TUint bytes = aData.Bytes();
+    if (channelBits % 8 == 0) {
+        const TUint channelBytes = channelBits / 8;
+        const TUint blockBytes = aSampleBlockBits / 8;
+        TUint pos = iBlockPos / 8;
+        for (TUint i=0; i<bytes; i++) {
+            iDsd[pos / channelBytes].push_back(ptr[i]);
+            if (++pos == blockBytes) {
+                pos = 0;
+            }
+        }
+        iBlockPos = pos * 8;
+    }
+    else {
+        TUint pos = iBlockPos;
+        for (TUint i=0; i<bytes; i++) {
+            for (TInt bit=7; bit>=0; bit--) {
+                const TUint channel = pos / channelBits;
+                iPartial[channel] = (TByte)((iPartial[channel] << 1) | ((ptr[i] >> bit) & 1));
+                if (++iPartialBits[channel] == 8) {
+                    iDsd[channel].push_back(iPartial[channel]);
+                    iPartialBits[channel] = 0;
+                }
+                if (++pos == aSampleBlockBits) {
+                    pos = 0;
+                }
+            }
+        }
+        iBlockPos = pos;
+    }
+}
+
+void DsdToPcm::OutputPcm(TUint aSamples)
+{
+    static const float kScale = 8388608.0f; // 1<<23
+    static const float kMax = 8388607.0f;
+    static const float kMin = -8388608.0f;
+    const TUint sampleBytes = iNumChannels * kBitDepth/8;
+    for (TUint i=0; i<aSamples; i++) {
+        TByte* dest = const_cast<TByte*>(iOutput.Ptr()) + iOutput.Bytes();
+        for (TUint j=0; j<iNumChannels; j++) {
+            float subsample = floorf(iPcm[j][i] * kScale + 0.5f);
+            subsample = std::min(std::max(subsample, kMin), kMax);
+            const TInt32 pcm = (TInt32)subsample;
+            *dest++ = (TByte)(pcm >> 16);
+            *dest++ = (TByte)(pcm >> 8);
+            *dest++ = (TByte)pcm;
+        }
+        iOutput.SetBytes(iOutput.Bytes() + sampleBytes);
+        if (iOutput.BytesRemaining() < sampleBytes) {
+            OutputMsg();
+        }
+    }
+}
+
+void DsdToPcm::OutputMsg()
+{
+    if (iOutput.Bytes() == 0) {
+        return;
+    }
+    MsgAudioPcm* msg = iMsgFactory.CreateMsgAudioPcm(iOutput, iNumChannels, iSampleRate, kBitDepth,
+                                                     AudioDataEndian::Big, iTrackOffset);
+    iTrackOffset += msg->Jiffies();
+    iOutput.SetBytes(0);
+    iDownstream.Push(msg);
+}
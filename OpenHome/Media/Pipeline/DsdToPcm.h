@@ -0,0 +1,138 @@
+#pragma once
+
+#include <OpenHome/Types.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Private/Standard.h>
+#include <OpenHome/Media/Pipeline/Msg.h>
+
+#include <vector>
+
+namespace OpenHome {
+namespace Media {
+
+/*
+ * Filter coefficients shared by all DsdDecimator instances.
+ *
+ * The first stage is a 128 tap FIR, decimating by 8, which is evaluated a byte of DSD at a
+ * time using a table of partial sums for each of the 256 possible bit patterns.  Subsequent
+ * stages are half-band FIRs, each decimating by 2.  The final stage is longer than the
+ * others as it alone sets the passband edge and must stop anything aliasing into it.
+ */
+class DsdFilterBank : private INonCopyable
+{
+    friend class DsdDecimator;
+public:
+    static const TUint kLookupBytes = 16;
+    static const TUint kLookupTaps = kLookupBytes * 8;
+    static const TUint kHalfBandTapsIntermediate = 23;
+    static const TUint kHalfBandTapsFinal = 63;
+public:
+    DsdFilterBank();
+private:
+    static void DesignLowPass(std::vector<double>& aTaps, TUint aCount, double aCutoff, double aBeta);
+    static void HalfBandEvenTaps(std::vector<float>& aEvenTaps, TUint aCount, double aBeta);
+    static double BesselI0(double aX);
+private:
+    float iLookup[kLookupBytes][256];
+    std::vector<float> iHalfBandIntermediate; // even indexed taps only; odd taps other than the centre are zero
+    std::vector<float> iHalfBandFinal;
+};
+
+/*
+ * Decimates a single channel of DSD (8 subsamples per byte, earliest subsample in the msb)
+ * to PCM at 1/(8 * 2^aHalfBandStages) of the DSD rate.
+ *
+ * Filter history is primed with DSD silence so that each call produces exactly one output
+ * sample per (8 * 2^aHalfBandStages) input subsamples.
+ */
+class DsdDecimator : private INonCopyable
+{
+public:
+    DsdDecimator(const DsdFilterBank& aFilters);
+    void Configure(TUint aHalfBandStages);
+    void Reset();
+    TUint Decimation() const;
+    TUint Process(const TByte* aDsd, TUint aBytes, std::vector<float>& aPcm); // returns number of samples written to aPcm
+private:
+    class HalfBand
+    {
+    public:
+        HalfBand(const std::vector<float>& aEvenTaps);
+        void Reset();
+        TUint Process(const float* aIn, TUint aCount, float* aOut);
+    private:
+        const std::vector<float>& iEvenTaps;
+        const TUint iCentre; // offset into iOdd of the sample aligned with the centre of the even taps
+        std::vector<float> iEven;
+        std::vector<float> iOdd;
+        TBool iOddNext;
+    };
+private:
+    const DsdFilterBank& iFilters;
+    std::vector<HalfBand> iStages;
+    std::vector<TByte> iDsd;
+    std::vector<float> iScratch[2];
+};
+
+/*
+ * Converts DSD streams to 24-bit PCM for animators which can't play DSD.
+ *
+ * Decimates to the highest rate no greater than 192kHz that the animator supports (176.4kHz
+ * or 88.2kHz for the common DSD rates).  DSD streams are passed through unaltered if the
+ * pipeline was configured to support DSD and the animator accepts the stream.
+ */
+class DsdToPcm : public PipelineElement, public IPipelineElementDownstream, private IDsdProcessor, private INonCopyable
+{
+    friend class SuiteDsdToPcm;
+
+    static const TUint kSupportedMsgTypes;
+    static const TUint kBitDepth = 24;
+    static const TUint kMaxChannels = 2;
+    static const TUint kMaxSampleRate = 192000;
+    static const TUint kMaxHalfBandStages = 6;
+    static const TUint kMaxSamplesPerMsg = 1024; // fits in a single DecodedAudio
+public:
+    DsdToPcm(MsgFactory& aMsgFactory, IPipelineElementDownstream& aDownstreamElement, TBool aDsdSupported);
+    ~DsdToPcm();
+    void SetAnimator(IPipelineAnimator& aPipelineAnimator);
+public: // from IPipelineElementDownstream
+    void Push(Msg* aMsg) override;
+private: // from IMsgProcessor
+    Msg* ProcessMsg(MsgEncodedStream* aMsg) override;
+    Msg* ProcessMsg(MsgDecodedStream* aMsg) override;
+    Msg* ProcessMsg(MsgAudioDsd* aMsg) override;
+private: // from IDsdProcessor
+    void BeginBlock() override;
+    void ProcessFragment(const Brx& aData, TUint aNumChannels, TUint aSampleBlockBits) override;
+    void EndBlock() override;
+    void Flush() override;
+private:
+    TBool DsdPlayable(const DecodedStreamInfo& aInfo) const;
+    TBool PcmPlayable(TUint aSampleRate, TUint aNumChannels) const;
+    TUint SelectHalfBandStages(TUint aDsdSampleRate, TUint aNumChannels) const;
+    void Deinterleave(const Brx& aData, TUint aNumChannels, TUint aSampleBlockBits);
+    void OutputPcm(TUint aSamples);
+    void OutputMsg();
+private:
+    MsgFactory& iMsgFactory;
+    IPipelineElementDownstream& iDownstream;
+    IPipelineAnimator* iAnimator;
+    const TBool iDsdSupported;
+    DsdFilterBank iFilters;
+    DsdDecimator* iDecimators[kMaxChannels];
+    std::vector<TByte> iDsd[kMaxChannels];
+    std::vector<float> iPcm[kMaxChannels];
+    Bws<kMaxSamplesPerMsg * kMaxChannels * kBitDepth/8> iOutput;
+    Media::Multiroom iMultiroom;
+    TBool iConverting;
+    TUint iNumChannels;
+    TUint iSampleRate;
+    TUint iBlockPos; // bit offset into the current DSD sample block
+    TByte iPartial[kMaxChannels]; // iPartial and iPartialBits are only used for blocks of less than one byte per channel
+    TUint iPartialBits[kMaxChannels];
+    TUint64 iTrackOffset;
+};
+
+} // namespace Media
+} // namespace OpenHome
+
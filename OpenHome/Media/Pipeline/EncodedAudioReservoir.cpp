@@ -50,6 +50,11 @@ TBool EncodedAudioReservoir::IsFull() const
             EncodedStreamCount() >= iMaxStreamCount);
 }
 
+TUint EncodedAudioReservoir::Occupancy() const
+{
+    return EncodedBytes();
+}
+
 void EncodedAudioReservoir::ProcessMsgIn(MsgTrack* /*aMsg*/)
 {
     BlockIfFull();
@@ -24,6 +24,7 @@ private:
     Msg* EndSeek(Msg* aMsg);
 private: // from AudioReservoir
     TBool IsFull() const override;
+    TUint Occupancy() const override;
 private: // from MsgReservoir
     void ProcessMsgIn(MsgTrack* aMsg) override;
     void ProcessMsgIn(MsgEncodedStream* aMsg) override;
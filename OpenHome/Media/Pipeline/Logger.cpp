@@ -2,6 +2,7 @@
 #include <OpenHome/Types.h>
 #include <OpenHome/Private/Printer.h>
 #include <OpenHome/Media/Pipeline/Msg.h>
+#include <OpenHome/Media/Pipeline/PipelineMetrics.h>
 
 using namespace OpenHome;
 using namespace OpenHome::Media;
@@ -18,6 +19,8 @@ Logger::Logger(IPipelineElementUpstream& aUpstreamElement, const TChar* aId)
     , iId(aId)
     , iEnabled(false)
     , iFilter(EMsgNone)
+    , iMetrics(nullptr)
+    , iMetricsLatency(nullptr)
     , iShutdownSem("PDSD", 0)
 {
 }
@@ -28,6 +31,8 @@ Logger::Logger(const TChar* aId, IPipelineElementDownstream& aDownstreamElement)
     , iId(aId)
     , iEnabled(false)
     , iFilter(EMsgNone)
+    , iMetrics(nullptr)
+    , iMetricsLatency(nullptr)
     , iShutdownSem("PDSD", 0)
 {
 }
@@ -49,9 +54,20 @@ void Logger::SetFilter(TUint aMsgTypes)
     iFilter = aMsgTypes;
 }
 
+void Logger::SetMetrics(PipelineMetrics& aMetrics)
+{
+    ASSERT(iMetrics == nullptr);
+    iMetrics = &aMetrics;
+    iMetricsLatency = &aMetrics.RegisterHistogram(iId, (iUpstreamElement != nullptr? "pull" : "push"), "us");
+}
+
 Msg* Logger::Pull()
 {
-    Msg* msg = iUpstreamElement->Pull();
+    Msg* msg;
+    {
+        AutoMetricsTimer _(iMetrics, iMetricsLatency);
+        msg = iUpstreamElement->Pull();
+    }
     if (iEnabled) {
         (void)msg->Process(*this);
     }
@@ -63,6 +79,7 @@ void Logger::Push(Msg* aMsg)
     if (iEnabled) {
         (void)aMsg->Process(*this);
     }
+    AutoMetricsTimer _(iMetrics, iMetricsLatency);
     iDownstreamElement->Push(aMsg);
 }
 
@@ -7,9 +7,13 @@
 namespace OpenHome {
 namespace Media {
 
+class PipelineMetrics;
+class MetricsHistogram;
+
 /*
 Element which logs msgs as they pass through.
 Can be inserted [0..n] times through the pipeline, depending on your debugging needs.
+Optionally records the time taken by each Pull()/Push() that passes through it.
 */
 
 class Logger : public IPipelineElementUpstream, public IPipelineElementDownstream, private IMsgProcessor, private INonCopyable
@@ -46,6 +50,7 @@ public:
     virtual ~Logger();
     void SetEnabled(TBool aEnabled);
     void SetFilter(TUint aMsgTypes);
+    void SetMetrics(PipelineMetrics& aMetrics);
 public: // from IPipelineElementUpstream
     Msg* Pull() override;
 public: // from IPipelineElementDownstream
@@ -79,6 +84,8 @@ private:
     const TChar* iId;
     TBool iEnabled;
     TInt iFilter;
+    PipelineMetrics* iMetrics;
+    MetricsHistogram* iMetricsLatency;
     Semaphore iShutdownSem;
     Bws<kMaxLogBytes> iBuf;
 };
@@ -1,5 +1,6 @@
 #include <OpenHome/Media/Pipeline/Msg.h>
 #include <OpenHome/Media/Pipeline/RampArray.h>
+#include <OpenHome/Media/Pipeline/PcmKernels.h>
 #include <OpenHome/Types.h>
 #include <OpenHome/Buffer.h>
 #include <OpenHome/Optional.h>
@@ -17,6 +18,7 @@
 #include <string.h>
 #include <climits>
 #include <algorithm>
+#include <vector>
 #include <cstdint>
 
 using namespace OpenHome;
@@ -31,29 +33,72 @@ const Brn AllocatorBase::kQueryMemory = Brn("memory");
 
 AllocatorBase::~AllocatorBase()
 {
-    LOG(kPipeline, "> ~AllocatorBase for %s. (Peak %u/%u)\n", iName, iCellsUsedMax, iFree.Slots());
-    const TUint slots = iFree.Slots();
-    for (TUint i=0; i<slots; i++) {
+    LOG(kPipeline, "> ~AllocatorBase for %s. (Peak %u/%u)\n", iName, iCellsUsedMax.load(), iCellsTotal);
+    const TUint cellsAdded = iCellsAdded.load();
+    for (TUint i=0; i<cellsAdded; i++) {
         //Log::Print("  %u", i);
-        try {
-            Allocated* ptr = Read();
-            //Log::Print("(%p)", ptr);
-            delete ptr;
-        }
-        catch (AssertionFailed&) {
-            Log::Print("...leak at %u of %u\n", i+1, slots);
+        Allocated* ptr = TryRead();
+        if (ptr == nullptr) {
+            Log::Print("...leak at %u of %u\n", i+1, cellsAdded);
             ASSERTS();
         }
+        //Log::Print("(%p)", ptr);
+        delete ptr;
     }
+    delete[] iNextFree;
+    delete[] iCells;
     LOG(kPipeline, "< ~AllocatorBase for %s\n", iName);
 }
 
 void AllocatorBase::Free(Allocated* aPtr)
 {
-    iLock.Wait();
-    iCellsUsed--;
-    iFree.Write(aPtr);
-    iLock.Signal();
+    iCellsUsed.fetch_sub(1, std::memory_order_relaxed);
+    Push(aPtr->iCellIndex);
+}
+
+void AllocatorBase::Trim()
+{
+    AutoMutex _(iLockGrow);
+    const TUint peak = iCellsUsedRecent.exchange(iCellsUsed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    const TUint target = std::max(iCellsReserved, peak);
+    TUint cellsAdded = iCellsAdded.load(std::memory_order_relaxed);
+    if (cellsAdded <= iCellsReserved || SlabStart(cellsAdded) < target) {
+        return;
+    }
+
+    // Take every free cell off the stack so we know which slabs are entirely unused.
+    // Any allocation that finds the stack empty meanwhile waits on iLockGrow.
+    std::vector<Allocated*> freeCells;
+    freeCells.reserve(cellsAdded);
+    for (Allocated* cell = TryRead(); cell != nullptr; cell = TryRead()) {
+        freeCells.push_back(cell);
+    }
+    std::vector<TBool> isFree(cellsAdded, false);
+    for (auto cell : freeCells) {
+        isFree[cell->iCellIndex] = true;
+    }
+    while (cellsAdded > iCellsReserved) {
+        const TUint slabStart = SlabStart(cellsAdded);
+        if (slabStart < target ||
+            std::find(isFree.begin() + slabStart, isFree.begin() + cellsAdded, false) != isFree.begin() + cellsAdded) {
+            break;
+        }
+        cellsAdded = slabStart;
+    }
+    const TUint cellsRemoved = iCellsAdded.load(std::memory_order_relaxed) - cellsAdded;
+    for (auto cell : freeCells) {
+        if (cell->iCellIndex < cellsAdded) {
+            Push(cell->iCellIndex);
+        }
+        else {
+            iCells[cell->iCellIndex] = nullptr;
+            delete cell;
+        }
+    }
+    iCellsAdded.store(cellsAdded, std::memory_order_relaxed);
+    if (cellsRemoved > 0) {
+        LOG(kPipeline, "Allocator %s trimmed %u cells, %u remain\n", iName, cellsRemoved, cellsAdded);
+    }
 }
 
 TUint AllocatorBase::CellsTotal() const
@@ -68,75 +113,163 @@ TUint AllocatorBase::CellBytes() const
 
 TUint AllocatorBase::CellsUsed() const
 {
-    iLock.Wait();
-    TUint cellsUsed = iCellsUsed;
-    iLock.Signal();
-    return cellsUsed;
+    return iCellsUsed.load(std::memory_order_relaxed);
 }
 
 TUint AllocatorBase::CellsUsedMax() const
 {
-    iLock.Wait();
-    TUint cellsUsedMax = iCellsUsedMax;
-    iLock.Signal();
-    return cellsUsedMax;
+    return iCellsUsedMax.load(std::memory_order_relaxed);
+}
+
+TUint AllocatorBase::CellsAllocated() const
+{
+    return iCellsAdded.load(std::memory_order_relaxed);
+}
+
+TUint AllocatorBase::CellsAllocatedMax() const
+{
+    return iCellsAddedMax.load(std::memory_order_relaxed);
 }
 
 void AllocatorBase::GetStats(TUint& aCellsTotal, TUint& aCellBytes, TUint& aCellsUsed, TUint& aCellsUsedMax) const
 {
     aCellsTotal = iCellsTotal;
     aCellBytes = iCellBytes;
-    iLock.Wait();
-    aCellsUsed = iCellsUsed;
-    aCellsUsedMax = iCellsUsedMax;
-    iLock.Signal();
+    aCellsUsed = iCellsUsed.load(std::memory_order_relaxed);
+    aCellsUsedMax = iCellsUsedMax.load(std::memory_order_relaxed);
 }
 
 AllocatorBase::AllocatorBase(const TChar* aName, TUint aNumCells, TUint aCellBytes, IInfoAggregator& aInfoAggregator)
-    : iFree(aNumCells)
-    , iLock("PAL1")
-    , iName(aName)
-    , iCellsTotal(aNumCells)
+    : AllocatorBase(aName, aNumCells, aNumCells, aNumCells, aCellBytes, aInfoAggregator)
+{
+}
+
+AllocatorBase::AllocatorBase(const TChar* aName, TUint aCellsReserved, TUint aCellsMax, TUint aSlabCells, TUint aCellBytes, IInfoAggregator& aInfoAggregator)
+    : iName(aName)
+    , iCellsTotal(aCellsMax)
+    , iCellsReserved(aCellsReserved)
+    , iSlabCells(aSlabCells)
     , iCellBytes(aCellBytes)
+    , iLockGrow("PAL1")
+    , iCells(new Allocated*[aCellsMax])
+    , iNextFree(new std::atomic<TUint>[aCellsMax])
+    , iFreeHead(kIndexNone)
+    , iCellsAdded(0)
+    , iCellsAddedMax(0)
     , iCellsUsed(0)
     , iCellsUsedMax(0)
+    , iCellsUsedRecent(0)
 {
+    ASSERT(aCellsReserved <= aCellsMax);
+    ASSERT(aSlabCells > 0 || aCellsReserved == aCellsMax);
     std::vector<Brn> infoQueries;
     infoQueries.push_back(kQueryMemory);
     aInfoAggregator.Register(*this, infoQueries);
 }
 
+void AllocatorBase::Reserve()
+{
+    AutoMutex _(iLockGrow);
+    Grow(iCellsReserved);
+}
+
 Allocated* AllocatorBase::DoAllocate()
 {
-    iLock.Wait();
     Allocated* cell = Read();
     ASSERT_VA(cell->iRefCount == 0, "%s has count %u\n", iName, cell->iRefCount.load());
     cell->iRefCount = 1;
-    iCellsUsed++;
-    if (iCellsUsed > iCellsUsedMax) {
-        iCellsUsedMax = iCellsUsed;
-    }
-    iLock.Signal();
+    const TUint cellsUsed = iCellsUsed.fetch_add(1, std::memory_order_relaxed) + 1;
+    UpdateMax(iCellsUsedMax, cellsUsed);
+    UpdateMax(iCellsUsedRecent, cellsUsed);
     return cell;
 }
 
 Allocated* AllocatorBase::Read()
 {
-    Allocated* p = nullptr;
-    try {
-        p = iFree.Read();
+    for (;;) {
+        Allocated* cell = TryRead();
+        if (cell != nullptr) {
+            return cell;
+        }
+        AutoMutex _(iLockGrow);
+        cell = TryRead(); // another thread may have grown (or finished trimming) while we waited
+        if (cell != nullptr) {
+            return cell;
+        }
+        const TUint cellsAdded = iCellsAdded.load(std::memory_order_relaxed);
+        if (cellsAdded == iCellsTotal) {
+            Log::Print("Warning: Allocator error for %s\n", iName);
+            ASSERTS();
+        }
+        Grow(std::min(iSlabCells, iCellsTotal - cellsAdded));
     }
-    catch (FifoReadError&) {
-        Log::Print("Warning: Allocator error for %s\n", iName);
-        ASSERTS();
+}
+
+Allocated* AllocatorBase::TryRead()
+{
+    TUint64 head = iFreeHead.load(std::memory_order_acquire);
+    for (;;) {
+        const TUint index = (TUint)(head & 0xffffffff);
+        if (index == kIndexNone) {
+            return nullptr;
+        }
+        // iNextFree may be stale if another thread pops this cell first; the count in iFreeHead makes the exchange fail in that case
+        const TUint next = iNextFree[index - 1].load(std::memory_order_relaxed);
+        const TUint64 newHead = (((head >> 32) + 1) << 32) | next;
+        if (iFreeHead.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire)) {
+            return iCells[index - 1];
+        }
+    }
+}
+
+void AllocatorBase::Push(TUint aIndex)
+{
+    const TUint64 index = aIndex + 1;
+    TUint64 head = iFreeHead.load(std::memory_order_relaxed);
+    TUint64 newHead;
+    do {
+        iNextFree[aIndex].store((TUint)(head & 0xffffffff), std::memory_order_relaxed);
+        newHead = (((head >> 32) + 1) << 32) | index;
+    } while (!iFreeHead.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void AllocatorBase::Grow(TUint aCells)
+{ // called with iLockGrow held
+    const TUint first = iCellsAdded.load(std::memory_order_relaxed);
+    ASSERT(first + aCells <= iCellsTotal);
+    for (TUint i=first; i<first+aCells; i++) {
+        Allocated* cell = NewCell();
+        cell->iCellIndex = i;
+        iCells[i] = cell;
+    }
+    iCellsAdded.store(first + aCells, std::memory_order_relaxed);
+    UpdateMax(iCellsAddedMax, first + aCells);
+    for (TUint i=first; i<first+aCells; i++) {
+        Push(i);
+    }
+    if (first >= iCellsReserved && aCells > 0) {
+        LOG(kPipeline, "Allocator %s grew to %u cells\n", iName, first + aCells);
+    }
+}
+
+TUint AllocatorBase::SlabStart(TUint aCellsAdded) const
+{
+    if (aCellsAdded <= iCellsReserved) {
+        return iCellsReserved;
+    }
+    return iCellsReserved + (((aCellsAdded - iCellsReserved - 1) / iSlabCells) * iSlabCells);
+}
+
+void AllocatorBase::UpdateMax(std::atomic<TUint>& aMax, TUint aVal)
+{ // static
+    TUint max = aMax.load(std::memory_order_relaxed);
+    while (aVal > max && !aMax.compare_exchange_weak(max, aVal, std::memory_order_relaxed)) {
     }
-    return p;
 }
 
 void AllocatorBase::QueryInfo(const Brx& aQuery, IWriter& aWriter)
 {
-    // Note that value of iCellsUsed may be slightly out of date as Allocator doesn't hold any lock while updating its fifo and iCellsUsed
-    AutoMutex a(iLock);
+    // Note that counts are read independently so may be very slightly inconsistent
     if (aQuery == kQueryMemory) {
         WriterAscii writer(aWriter);
         writer.Write(Brn("Allocator: "));
@@ -146,9 +279,17 @@ void AllocatorBase::QueryInfo(const Brx& aQuery, IWriter& aWriter)
         writer.Write(Brn(" cells x "));
         writer.WriteUint(iCellBytes);
         writer.Write(Brn(" bytes, in use:"));
-        writer.WriteUint(iCellsUsed);
+        writer.WriteUint(iCellsUsed.load(std::memory_order_relaxed));
         writer.Write(Brn(" cells, peak:"));
-        writer.WriteUint(iCellsUsedMax);
+        writer.WriteUint(iCellsUsedMax.load(std::memory_order_relaxed));
+        if (iCellsReserved != iCellsTotal) {
+            writer.Write(Brn(" cells, reserved:"));
+            writer.WriteUint(iCellsReserved);
+            writer.Write(Brn(" cells, allocated:"));
+            writer.WriteUint(iCellsAdded.load(std::memory_order_relaxed));
+            writer.Write(Brn(" cells, allocated peak:"));
+            writer.WriteUint(iCellsAddedMax.load(std::memory_order_relaxed));
+        }
         aWriter.Write(Brn(" cells\n"));
     }
 }
@@ -178,6 +319,7 @@ void Allocated::Clear()
 Allocated::Allocated(AllocatorBase& aAllocator)
     : iAllocator(aAllocator)
     , iRefCount(0)
+    , iCellIndex(0)
 {
     ASSERT(iRefCount.is_lock_free());
 }
@@ -191,8 +333,9 @@ Allocated::~Allocated()
 
 const TUint AudioData::kMaxBytes;
 
-AudioData::AudioData(AllocatorBase& aAllocator)
+AudioData::AudioData(AllocatorBase& aAllocator, Bwx& aData)
     : Allocated(aAllocator)
+    , iData(aData)
 {
 #ifdef TIMESTAMP_LOGGING_ENABLE
     iOsCtx = gEnv->OsCtx();
@@ -212,6 +355,11 @@ TUint AudioData::Bytes() const
     return iData.Bytes();
 }
 
+TUint AudioData::MaxBytes() const
+{
+    return iData.MaxBytes();
+}
+
 #ifdef TIMESTAMP_LOGGING_ENABLE
 void AudioData::SetTimestamp(const TChar* aId)
 {
@@ -280,11 +428,6 @@ TBool AudioData::Timestamp::TryLog()
 
 // EncodedAudio
 
-EncodedAudio::EncodedAudio(AllocatorBase& aAllocator)
-    : AudioData(aAllocator)
-{
-}
-
 TUint EncodedAudio::Append(const Brx& aData)
 {
     return DoAppend(aData, iData.MaxBytes());
@@ -319,11 +462,6 @@ TUint EncodedAudio::DoAppend(const Brx& aData, TUint aMaxBytes)
 
 // DecodedAudio
 
-DecodedAudio::DecodedAudio(AllocatorBase& aAllocator)
-    : AudioData(aAllocator)
-{
-}
-
 void DecodedAudio::Aggregate(DecodedAudio& aDecodedAudio)
 {
     iData.Append(aDecodedAudio.iData);
@@ -333,6 +471,7 @@ void DecodedAudio::ConstructPcm(const Brx& aData, TUint aBitDepth, AudioDataEndi
 {
     ASSERT((aBitDepth & 7) == 0);
     ASSERT(aData.Bytes() % (aBitDepth/8) == 0);
+    ASSERT(aData.Bytes() <= iData.MaxBytes());
     TByte* ptr = const_cast<TByte*>(iData.Ptr());
     if (aEndian == AudioDataEndian::Big || aBitDepth == 8) {
         (void)memcpy(ptr, aData.Ptr(), aData.Bytes());
@@ -359,32 +498,80 @@ void DecodedAudio::ConstructDsd(const Brx& aData)
 
 void DecodedAudio::CopyToBigEndian16(const Brx& aData, TByte* aDest)
 { // static
-    const TByte* src = aData.Ptr();
-    for (TUint i=0; i<aData.Bytes(); i+=2) {
-        *aDest++ = src[i+1];
-        *aDest++ = src[i];
-    }
+    PcmKernels::CopyToBigEndian16(aData.Ptr(), aDest, aData.Bytes());
 }
 
 void DecodedAudio::CopyToBigEndian24(const Brx& aData, TByte* aDest)
 { // static
-    const TByte* src = aData.Ptr();
-    for (TUint i=0; i<aData.Bytes(); i+=3) {
-        *aDest++ = src[i+2];
-        *aDest++ = src[i+1];
-        *aDest++ = src[i];
-    }
+    PcmKernels::CopyToBigEndian24(aData.Ptr(), aDest, aData.Bytes());
 }
 
 void DecodedAudio::CopyToBigEndian32(const Brx& aData, TByte* aDest)
 { // static
-    const TByte* src = aData.Ptr();
-    for (TUint i=0; i<aData.Bytes(); i+=4) {
-        *aDest++ = src[i+3];
-        *aDest++ = src[i+2];
-        *aDest++ = src[i+1];
-        *aDest++ = src[i];
+    PcmKernels::CopyToBigEndian32(aData.Ptr(), aDest, aData.Bytes());
+}
+
+
+// AudioDataAllocator
+
+AudioDataAllocator::AudioDataAllocator(IInfoAggregator& aInfoAggregator, TUint aCount, TUint aReservedBytes, TUint aSlabBytes)
+    : iAllocator1k("AudioData1k", ReservedCount(aSlabBytes == 0? 0 : aCount, aReservedBytes, aSlabBytes, kBytes1k),
+                   aSlabBytes == 0? 0 : aCount, SlabCount(aSlabBytes, kBytes1k), aInfoAggregator)
+    , iAllocator2k("AudioData2k", ReservedCount(aSlabBytes == 0? 0 : aCount, aReservedBytes, aSlabBytes, kBytes2k),
+                   aSlabBytes == 0? 0 : aCount, SlabCount(aSlabBytes, kBytes2k), aInfoAggregator)
+    , iAllocator4k("AudioData4k", ReservedCount(aSlabBytes == 0? 0 : aCount, aReservedBytes, aSlabBytes, kBytes4k),
+                   aSlabBytes == 0? 0 : aCount, SlabCount(aSlabBytes, kBytes4k), aInfoAggregator)
+    , iAllocatorMax("AudioData", ReservedCount(aCount, aReservedBytes, aSlabBytes, AudioData::kMaxBytes),
+                    aCount, SlabCount(aSlabBytes, AudioData::kMaxBytes), aInfoAggregator)
+{
+}
+
+AudioData* AudioDataAllocator::Allocate(TUint aBytes)
+{
+    ASSERT(aBytes <= AudioData::kMaxBytes);
+    if (aBytes <= kBytes1k && iAllocator1k.CellsTotal() > 0) {
+        return iAllocator1k.Allocate();
+    }
+    if (aBytes <= kBytes2k && iAllocator2k.CellsTotal() > 0) {
+        return iAllocator2k.Allocate();
+    }
+    if (aBytes <= kBytes4k && iAllocator4k.CellsTotal() > 0) {
+        return iAllocator4k.Allocate();
+    }
+    return iAllocatorMax.Allocate();
+}
+
+AudioData* AudioDataAllocator::Upsize(AudioData& aAudioData, TUint aBytes)
+{
+    ASSERT(aBytes > aAudioData.MaxBytes());
+    AudioData* audioData = Allocate(aBytes);
+    audioData->iData.Replace(aAudioData.iData);
+    return audioData;
+}
+
+void AudioDataAllocator::Trim()
+{
+    iAllocator1k.Trim();
+    iAllocator2k.Trim();
+    iAllocator4k.Trim();
+    iAllocatorMax.Trim();
+}
+
+TUint AudioDataAllocator::ReservedCount(TUint aCount, TUint aReservedBytes, TUint aSlabBytes, TUint aCellBytes)
+{ // static
+    if (aSlabBytes == 0) {
+        return aCount;
+    }
+    // share the reservation equally (by bytes) between classes
+    return std::min(aCount, (aReservedBytes / kNumClasses + aCellBytes - 1) / aCellBytes);
+}
+
+TUint AudioDataAllocator::SlabCount(TUint aSlabBytes, TUint aCellBytes)
+{ // static
+    if (aSlabBytes == 0) {
+        return 0;
     }
+    return std::max(1u, aSlabBytes / aCellBytes);
 }
 
 
@@ -766,6 +953,7 @@ Ramp Ramp::Split(TUint aNewSize, TUint aCurrentSize)
 // RampApplicator
 
 const TUint RampApplicator::kFullRampSpan = Ramp::kMax - Ramp::kMin;
+const TUint RampApplicator::kMaxBlockSamples;
 
 RampApplicator::RampApplicator(const Media::Ramp& aRamp)
     : iRamp(aRamp)
@@ -779,74 +967,58 @@ TUint RampApplicator::Start(const Brx& aData, TUint aBitDepth, TUint aNumChannel
     iBitDepth = aBitDepth;
     iNumChannels = aNumChannels;
     ASSERT_DEBUG(aData.Bytes() % ((iBitDepth/8) * iNumChannels) == 0);
-    iNumSamples = (TInt)(aData.Bytes() / ((iBitDepth/8) * iNumChannels));
-    iTotalRamp = (iRamp.Start() - iRamp.End());
+    iNumSamples = aData.Bytes() / ((iBitDepth/8) * iNumChannels);
     iLoopCount = 0;
+    // ramp value for sample i is Start() -/+ (i * |Start()-End()|) / (iNumSamples-1)
+    // ...calculate this incrementally to avoid a division per sample
+    iRampDown = (iRamp.Start() >= iRamp.End());
+    const TUint totalRamp = (iRampDown? iRamp.Start() - iRamp.End() : iRamp.End() - iRamp.Start());
+    iRampDivisor = (iNumSamples > 1? iNumSamples - 1 : 1);
+    iRampStep = (iNumSamples > 1? totalRamp / iRampDivisor : 0);
+    iRampStepRemainder = (iNumSamples > 1? totalRamp % iRampDivisor : 0);
+    iRampDelta = 0;
+    iRampDeltaRemainder = 0;
     return iNumSamples;
 }
 
-void RampApplicator::GetNextSample(TByte* aDest)
+inline TUint16 RampApplicator::NextGain()
 {
-    ASSERT_DEBUG(iPtr != nullptr);
-    const TUint16 ramp = (iNumSamples==1? (TUint16)iRamp.Start() : (TUint16)(iRamp.Start() - ((iLoopCount * iTotalRamp)/(iNumSamples-1))));
-    //Log::Print(" %04x ", ramp);
+    const TUint ramp = (iRampDown? iRamp.Start() - iRampDelta : iRamp.Start() + iRampDelta);
+    iRampDelta += iRampStep;
+    iRampDeltaRemainder += iRampStepRemainder;
+    if (iRampDeltaRemainder >= iRampDivisor) {
+        iRampDelta++;
+        iRampDeltaRemainder -= iRampDivisor;
+    }
+    iLoopCount++;
     const TUint rampIndex = std::min(kRampArrayCount-1, (kFullRampSpan - ramp + (1<<4)) >> 5); // assumes fullRampSpan==2^14 and kRampArray has 512 (2^9) items. (1<<4 allows rounding up)
-    for (TUint i=0; i<iNumChannels; i++) {
-        TInt16 subsample16 = 0;
-        switch (iBitDepth)
-        {
-        case 8:
-            subsample16 = *iPtr++ << 8;
-            break;
-        case 16:
-            subsample16 = *iPtr++ << 8;
-            subsample16 += *iPtr++;
-            break;
-        case 24:
-            subsample16 = *iPtr++ << 8;
-            subsample16 += *iPtr++;
-            iPtr++;
-            break;
-        case 32:
-            subsample16 = *iPtr++ << 8;
-            subsample16 += *iPtr++;
-            iPtr++;
-            iPtr++;
-            break;
-        default:
-            ASSERTS();
-        }
-        //Log::Print(" %03u ", rampIndex);
-        const TUint16 rampMult = static_cast<TUint16>(kRampArray[rampIndex]);
-        TInt rampedSubsample = (rampIndex==512? 0 : (subsample16 * rampMult) >> 15);
-        //Log::Print("Original=%04x (%d), ramped=%04x (%d), rampIndex=%u\n", subsample, subsample, rampedSubsample, rampedSubsample, rampIndex);
+    return static_cast<TUint16>(kRampArray[rampIndex]);
+}
 
-        switch (iBitDepth)
-        {
-        case 8:
-            *aDest++ = (TByte)(rampedSubsample >> 8);
-            break;
-        case 16:
-            *aDest++ = (TByte)(rampedSubsample >> 8);
-            *aDest++ = (TByte)rampedSubsample;
-            break;
-        case 24:
-            *aDest++ = (TByte)(rampedSubsample >> 8);
-            *aDest++ = (TByte)rampedSubsample;
-            *aDest++ = (TByte)0;
-            break;
-        case 32:
-            *aDest++ = (TByte)(rampedSubsample >> 8);
-            *aDest++ = (TByte)rampedSubsample;
-            *aDest++ = (TByte)0;
-            *aDest++ = (TByte)0;
-            break;
-        default:
-            ASSERTS();
+void RampApplicator::GetNextSample(TByte* aDest)
+{
+    (void)GetNextSamples(aDest, 1);
+}
+
+TUint RampApplicator::GetNextSamples(TByte* aDest, TUint aMaxSamples)
+{
+    ASSERT_DEBUG(iPtr != nullptr);
+    const TUint numSamples = std::min(aMaxSamples, iNumSamples - iLoopCount);
+    const TUint bytesPerSample = (iBitDepth/8) * iNumChannels;
+    TUint16 gains[kMaxBlockSamples];
+    TUint remaining = numSamples;
+    while (remaining > 0) {
+        const TUint blockSamples = std::min(remaining, kMaxBlockSamples);
+        for (TUint i=0; i<blockSamples; i++) {
+            gains[i] = NextGain();
         }
+        PcmKernels::ApplyRamp(iPtr, aDest, gains, blockSamples, iBitDepth, iNumChannels);
+        const TUint bytes = blockSamples * bytesPerSample;
+        iPtr += bytes;
+        aDest += bytes;
+        remaining -= blockSamples;
     }
-
-    iLoopCount++;
+    return numSamples;
 }
 
 TUint RampApplicator::MedianMultiplier(const Media::Ramp& aRamp)
@@ -1520,6 +1692,7 @@ MsgAudioEncoded* MsgAudioEncoded::Split(TUint aBytes)
     remaining->iSize = iSize - aBytes;
     remaining->iAudioData = iAudioData;
     remaining->iAudioData->AddRef();
+    remaining->iAudioDataAllocator = iAudioDataAllocator;
     iSize = aBytes;
     iNextAudio = nullptr;
     return remaining;
@@ -1538,16 +1711,15 @@ void MsgAudioEncoded::Add(MsgAudioEncoded* aMsg)
 
 TUint MsgAudioEncoded::Append(const Brx& aData)
 {
-    ASSERT(iNextAudio == nullptr);
-    const TUint consumed = iAudioData->Append(aData);
-    iSize += consumed;
-    return consumed;
+    return Append(aData, EncodedAudio::kMaxBytes);
 }
 
 TUint MsgAudioEncoded::Append(const Brx& aData, TUint aMaxBytes)
 {
     ASSERT(iNextAudio == nullptr);
-    const TUint consumed = iAudioData->Append(aData, aMaxBytes);
+    ASSERT(aMaxBytes <= EncodedAudio::kMaxBytes);
+    ReserveCapacity(std::min(iAudioData->Bytes() + aData.Bytes(), aMaxBytes));
+    const TUint consumed = iAudioData->Append(aData, std::min(aMaxBytes, iAudioData->MaxBytes()));
     iSize += consumed;
     return consumed;
 }
@@ -1582,18 +1754,29 @@ MsgAudioEncoded* MsgAudioEncoded::Clone()
     clone->iSize = iSize;
     clone->iOffset = iOffset;
     clone->iAudioData = iAudioData;
+    clone->iAudioDataAllocator = iAudioDataAllocator;
     iAudioData->AddRef();
     return clone;
 }
 
-void MsgAudioEncoded::Initialise(EncodedAudio* aEncodedAudio)
+void MsgAudioEncoded::Initialise(EncodedAudio* aEncodedAudio, AudioDataAllocator& aAudioDataAllocator)
 {
     iAudioData = aEncodedAudio;
+    iAudioDataAllocator = &aAudioDataAllocator;
     iSize = iAudioData->Bytes();
     iOffset = 0;
     iNextAudio = nullptr;
 }
 
+void MsgAudioEncoded::ReserveCapacity(TUint aBytes)
+{
+    if (aBytes > iAudioData->MaxBytes()) {
+        auto audioData = static_cast<EncodedAudio*>(iAudioDataAllocator->Upsize(*iAudioData, aBytes));
+        iAudioData->RemoveRef();
+        iAudioData = audioData;
+    }
+}
+
 void MsgAudioEncoded::Clear()
 {
     if (iNextAudio != nullptr) {
@@ -2022,6 +2205,12 @@ void MsgAudioDecoded::Aggregate(MsgAudioDecoded* aMsg)
     ASSERT(aMsg->iTrackOffset == iTrackOffset + Jiffies()); // aMsg must logically follow this one
     ASSERT(!iRamp.IsEnabled() && !aMsg->iRamp.IsEnabled()); // no ramps allowed
 
+    const TUint bytes = iAudioData->Bytes() + aMsg->iAudioData->Bytes();
+    if (bytes > iAudioData->MaxBytes()) {
+        auto audioData = static_cast<DecodedAudio*>(iAudioDataAllocator->Upsize(*iAudioData, bytes));
+        iAudioData->RemoveRef();
+        iAudioData = audioData;
+    }
     iAudioData->Aggregate(*(aMsg->iAudioData));
     iSize += aMsg->Jiffies();
     aMsg->RemoveRef();
@@ -2041,6 +2230,7 @@ MsgAudio* MsgAudioDecoded::Clone()
 {
     MsgAudioDecoded* clone = static_cast<MsgAudioDecoded*>(MsgAudio::Clone());
     clone->iAudioData = iAudioData;
+    clone->iAudioDataAllocator = iAudioDataAllocator;
     clone->iAllocatorPlayableSilence = iAllocatorPlayableSilence;
     clone->iTrackOffset = iTrackOffset;
     iAudioData->AddRef();
@@ -2049,11 +2239,13 @@ MsgAudio* MsgAudioDecoded::Clone()
 
 void MsgAudioDecoded::Initialise(DecodedAudio* aDecodedAudio, TUint aSampleRate, TUint aBitDepth,
                                  TUint aChannels, TUint64 aTrackOffset, TUint aNumSubsamples,
+                                 AudioDataAllocator& aAudioDataAllocator,
                                  Allocator<MsgPlayableSilence>& aAllocatorPlayableSilence)
 {
     MsgAudio::Initialise(aSampleRate, aBitDepth, aChannels);
     iAllocatorPlayableSilence = &aAllocatorPlayableSilence;
     iAudioData = aDecodedAudio;
+    iAudioDataAllocator = &aAudioDataAllocator;
     iTrackOffset = aTrackOffset;
     ASSERT(aNumSubsamples % iNumChannels == 0);
     iSize = (aNumSubsamples / iNumChannels) * Jiffies::PerSample(iSampleRate);
@@ -2066,6 +2258,7 @@ void MsgAudioDecoded::SplitCompleted(MsgAudio& aRemaining)
     iAudioData->AddRef();
     MsgAudioDecoded& remaining = static_cast<MsgAudioDecoded&>(aRemaining);
     remaining.iAudioData = iAudioData;
+    remaining.iAudioDataAllocator = iAudioDataAllocator;
     remaining.iTrackOffset = iTrackOffset + iSize;
     remaining.iAllocatorPlayableSilence = iAllocatorPlayableSilence;
 }
@@ -2126,6 +2319,7 @@ MsgPlayable* MsgAudioPcm::CreatePlayable()
 }
 
 void MsgAudioPcm::Initialise(DecodedAudio* aDecodedAudio, TUint aSampleRate, TUint aBitDepth, TUint aChannels, TUint64 aTrackOffset,
+                             AudioDataAllocator& aAudioDataAllocator,
                              Allocator<MsgPlayablePcm>& aAllocatorPlayablePcm,
                              Allocator<MsgPlayableSilence>& aAllocatorPlayableSilence)
 {
@@ -2134,7 +2328,7 @@ void MsgAudioPcm::Initialise(DecodedAudio* aDecodedAudio, TUint aSampleRate, TUi
     ASSERT(bytes % byteDepth == 0);
     const TUint numSubsamples = bytes / byteDepth;
     MsgAudioDecoded::Initialise(aDecodedAudio, aSampleRate, aBitDepth, aChannels,
-                                aTrackOffset, numSubsamples, aAllocatorPlayableSilence);
+                                aTrackOffset, numSubsamples, aAudioDataAllocator, aAllocatorPlayableSilence);
     iAllocatorPlayablePcm = &aAllocatorPlayablePcm;
     iAttenuation = MsgAudioPcm::kUnityAttenuation;
 }
@@ -2218,13 +2412,13 @@ MsgPlayable* MsgAudioDsd::CreatePlayable()
 }
 
 void MsgAudioDsd::Initialise(DecodedAudio* aDecodedAudio, TUint aSampleRate, TUint aChannels,
-                             TUint aSampleBlockBits, TUint64 aTrackOffset,
+                             TUint aSampleBlockBits, TUint64 aTrackOffset, AudioDataAllocator& aAudioDataAllocator,
                              Allocator<MsgPlayableDsd>& aAllocatorPlayableDsd,
                              Allocator<MsgPlayableSilence>& aAllocatorPlayableSilence)
 {
     const TUint numSubsamples = 8 * aDecodedAudio->Bytes();
     MsgAudioDecoded::Initialise(aDecodedAudio, aSampleRate, kBitDepth, aChannels,
-                                aTrackOffset, numSubsamples, aAllocatorPlayableSilence);
+                                aTrackOffset, numSubsamples, aAudioDataAllocator, aAllocatorPlayableSilence);
     iAllocatorPlayableDsd = &aAllocatorPlayableDsd;
     iSampleBlockBits = aSampleBlockBits;
 }
@@ -2521,87 +2715,66 @@ void MsgPlayablePcm::Initialise(DecodedAudio* aDecodedAudio, TUint aSizeBytes, T
     iAttenuation = aAttenuation;
 }
 
-void MsgPlayablePcm::ApplyAttenuation(Bwx& aData)
-{
-    if (iAttenuation == MsgAudioPcm::kUnityAttenuation) {
-        return;
-    }
-    ASSERT(iBitDepth == 16);
-    TByte* ptr = (TByte*)aData.Ptr();
-    const TUint samples = aData.Bytes() / 2;
-    for (TUint sampleIndex = 0; sampleIndex < samples; sampleIndex++) {
-        TInt16 sample = *ptr << 8;
-        sample += *(ptr + 1);
-        TInt16 attenuatedSample = (TInt16)(((TInt)sample) * iAttenuation / MsgAudioPcm::kUnityAttenuation);
-        *ptr++ = (TByte)(attenuatedSample >> 8);
-        *ptr++ = (TByte)attenuatedSample;
+void MsgPlayablePcm::ProcessFragment(IPcmProcessor& aProcessor, const Brx& aData, TUint aBitDepth, TUint aNumChannels)
+{ // static
+    switch (aBitDepth)
+    {
+    case 8:
+        aProcessor.ProcessFragment8(aData, aNumChannels);
+        break;
+    case 16:
+        aProcessor.ProcessFragment16(aData, aNumChannels);
+        break;
+    case 24:
+        aProcessor.ProcessFragment24(aData, aNumChannels);
+        break;
+    case 32:
+        aProcessor.ProcessFragment32(aData, aNumChannels);
+        break;
+    default:
+        ASSERTS();
     }
 }
 
 void MsgPlayablePcm::ReadBlock(IPcmProcessor& aProcessor)
 {
-    Bwn audioBuf(iAudioData->Ptr(iOffset), iSize, iSize);
-    ApplyAttenuation(audioBuf);
-
+    const Brn audioBuf(iAudioData->Ptr(iOffset), iSize);
     const TUint numChannels = iNumChannels;
     const TUint bitDepth = iBitDepth;
-    if (iRamp.IsEnabled()) {
-        Bws<256> rampedBuf;
-        RampApplicator ra(iRamp);
-        const TUint numSamples = ra.Start(audioBuf, bitDepth, numChannels);
-        const TUint bytesPerSample = (bitDepth/8) * numChannels;
-        const TUint samplesPerFragment = rampedBuf.MaxBytes() / bytesPerSample;
-        TByte* ptr = (TByte*)rampedBuf.Ptr();
-        TUint fragmentSamples = 0;
-        for (TUint i=0; i<numSamples; i++) {
-            ra.GetNextSample(ptr);
-
-            fragmentSamples++;
-            ptr += bytesPerSample;
-            if (fragmentSamples == samplesPerFragment || i == numSamples-1) {
-                rampedBuf.SetBytes(fragmentSamples * bytesPerSample);
-                switch (bitDepth)
-                {
-                case 8:
-                    aProcessor.ProcessFragment8(rampedBuf, numChannels);
-                    break;
-                case 16:
-                    aProcessor.ProcessFragment16(rampedBuf, numChannels);
-                    break;
-                case 24:
-                    aProcessor.ProcessFragment24(rampedBuf, numChannels);
-                    break;
-                case 32:
-                    aProcessor.ProcessFragment32(rampedBuf, numChannels);
-                    break;
-                default:
-                    ASSERTS();
-                }
-                ptr = (TByte*)rampedBuf.Ptr();
-                fragmentSamples = 0;
-            }
-        }
+    const TBool rampEnabled = iRamp.IsEnabled();
+    if (!rampEnabled && iAttenuation == MsgAudioPcm::kUnityAttenuation) {
+        ProcessFragment(aProcessor, audioBuf, bitDepth, numChannels);
+        return;
     }
-    else {
-        switch (bitDepth)
-        {
-        case 8:
-            aProcessor.ProcessFragment8(audioBuf, numChannels);
-            break;
-        case 16:
-            aProcessor.ProcessFragment16(audioBuf, numChannels);
-            break;
-        case 24:
-            aProcessor.ProcessFragment24(audioBuf, numChannels);
-            break;
-        case 32:
-            aProcessor.ProcessFragment32(audioBuf, numChannels);
-            break;
-        default:
-            ASSERTS();
+
+    /* iAudioData may be shared with other msgs (and with other readers of this one) so
+       ramps and attenuation are applied to a local copy of each fragment */
+    ASSERT(iAttenuation <= MsgAudioPcm::kUnityAttenuation);
+    const TUint gain = (iAttenuation << PcmKernels::kGainShift) / MsgAudioPcm::kUnityAttenuation;
+    Bws<kRampFragmentBytes> fragment;
+    TByte* fragmentPtr = const_cast<TByte*>(fragment.Ptr());
+    const TUint bytesPerSample = (bitDepth/8) * numChannels;
+    const TUint samplesPerFragment = fragment.MaxBytes() / bytesPerSample;
+    RampApplicator ra(iRamp);
+    TUint remainingSamples = (rampEnabled? ra.Start(audioBuf, bitDepth, numChannels) : iSize / bytesPerSample);
+    const TByte* src = audioBuf.Ptr();
+    while (remainingSamples > 0) {
+        TUint fragmentSamples;
+        if (rampEnabled) {
+            fragmentSamples = ra.GetNextSamples(fragmentPtr, samplesPerFragment);
         }
+        else {
+            fragmentSamples = std::min(remainingSamples, samplesPerFragment);
+            (void)memcpy(fragmentPtr, src, fragmentSamples * bytesPerSample);
+            src += fragmentSamples * bytesPerSample;
+        }
+        if (gain != PcmKernels::kGainUnity) {
+            PcmKernels::ApplyGain(fragmentPtr, fragmentPtr, gain, fragmentSamples * numChannels, bitDepth);
+        }
+        fragment.SetBytes(fragmentSamples * bytesPerSample);
+        ProcessFragment(aProcessor, fragment, bitDepth, numChannels);
+        remainingSamples -= fragmentSamples;
     }
-
 }
 
 TBool MsgPlayablePcm::TryLogTimestamps()
@@ -3533,7 +3706,8 @@ MsgFactory::MsgFactory(IInfoAggregator& aInfoAggregator, const MsgFactoryInitPar
     , iDrainId(0)
     , iAllocatorMsgDelay("MsgDelay", aInitParams.iMsgDelayCount, aInfoAggregator)
     , iAllocatorMsgEncodedStream("MsgEncodedStream", aInitParams.iMsgEncodedStreamCount, aInfoAggregator)
-    , iAllocatorAudioData("AudioData", aInitParams.iEncodedAudioCount + aInitParams.iDecodedAudioCount, aInfoAggregator)
+    , iAudioDataAllocator(aInfoAggregator, aInitParams.iEncodedAudioCount + aInitParams.iDecodedAudioCount,
+                          aInitParams.iAudioDataReservedBytes, aInitParams.iAudioDataSlabBytes)
     , iAllocatorMsgAudioEncoded("MsgAudioEncoded", aInitParams.iMsgAudioEncodedCount, aInfoAggregator)
     , iAllocatorMsgMetaText("MsgMetaText", aInitParams.iMsgMetaTextCount, aInfoAggregator)
     , iAllocatorMsgStreamInterrupted("MsgStreamInterrupted", aInitParams.iMsgStreamInterruptedCount, aInfoAggregator)
@@ -3552,6 +3726,11 @@ MsgFactory::MsgFactory(IInfoAggregator& aInfoAggregator, const MsgFactoryInitPar
 {
 }
 
+void MsgFactory::TrimAllocators()
+{
+    iAudioDataAllocator.Trim();
+}
+
 MsgMode* MsgFactory::CreateMsgMode(const Brx& aMode, const ModeInfo& aInfo,
                                    ModeClockPullers aClockPullers,
                                    const ModeTransportControls& aTransportControls)
@@ -3631,7 +3810,7 @@ MsgAudioEncoded* MsgFactory::CreateMsgAudioEncoded(const Brx& aData)
 {
     EncodedAudio* encodedAudio = CreateEncodedAudio(aData);
     MsgAudioEncoded* msg = iAllocatorMsgAudioEncoded.Allocate();
-    msg->Initialise(encodedAudio);
+    msg->Initialise(encodedAudio, iAudioDataAllocator);
     return msg;
 }
 
@@ -3720,7 +3899,7 @@ MsgAudioPcm* MsgFactory::CreateMsgAudioPcm(MsgAudioEncoded* aAudio, TUint aChann
 
 MsgAudioDsd* MsgFactory::CreateMsgAudioDsd(const Brx& aData, TUint aChannels, TUint aSampleRate, TUint aSampleBlockBits, TUint64 aTrackOffset)
 {
-    auto decodedAudio = static_cast<DecodedAudio*>(iAllocatorAudioData.Allocate());
+    auto decodedAudio = static_cast<DecodedAudio*>(iAudioDataAllocator.Allocate(aData.Bytes()));
     decodedAudio->ConstructDsd(aData);
     return CreateMsgAudioDsd(decodedAudio, aChannels, aSampleRate, aSampleBlockBits, aTrackOffset);
 }
@@ -3753,15 +3932,21 @@ MsgQuit* MsgFactory::CreateMsgQuit()
 
 EncodedAudio* MsgFactory::CreateEncodedAudio(const Brx& aData)
 {
-    EncodedAudio* encodedAudio = static_cast<EncodedAudio*>(iAllocatorAudioData.Allocate());
+    EncodedAudio* encodedAudio = static_cast<EncodedAudio*>(iAudioDataAllocator.Allocate(aData.Bytes()));
     encodedAudio->Construct(aData);
     return encodedAudio;
 }
 
 DecodedAudio* MsgFactory::CreateDecodedAudio(const Brx& aData, TUint aBitDepth, AudioDataEndian aEndian)
 {
-    DecodedAudio* decodedAudio = static_cast<DecodedAudio*>(iAllocatorAudioData.Allocate());
-    decodedAudio->ConstructPcm(aData, aBitDepth, aEndian);
+    DecodedAudio* decodedAudio = static_cast<DecodedAudio*>(iAudioDataAllocator.Allocate(std::min(aData.Bytes(), AudioData::kMaxBytes)));
+    try {
+        decodedAudio->ConstructPcm(aData, aBitDepth, aEndian);
+    }
+    catch (AssertionFailed&) { // test code helper
+        decodedAudio->RemoveRef();
+        throw;
+    }
     return decodedAudio;
 }
 
@@ -3770,7 +3955,7 @@ MsgAudioPcm* MsgFactory::CreateMsgAudioPcm(DecodedAudio* aAudioData, TUint aChan
     MsgAudioPcm* msg = iAllocatorMsgAudioPcm.Allocate();
     try {
         msg->Initialise(aAudioData, aSampleRate, aBitDepth, aChannels, aTrackOffset,
-                        iAllocatorMsgPlayablePcm, iAllocatorMsgPlayableSilence);
+                        iAudioDataAllocator, iAllocatorMsgPlayablePcm, iAllocatorMsgPlayableSilence);
     }
     catch (AssertionFailed&) { // test code helper
         msg->RemoveRef();
@@ -3784,7 +3969,7 @@ MsgAudioDsd* MsgFactory::CreateMsgAudioDsd(DecodedAudio* aAudioData, TUint aChan
     auto audioDsd = iAllocatorMsgAudioDsd.Allocate();
     try {
         audioDsd->Initialise(aAudioData, aSampleRate, aChannels, aSampleBlockBits, aTrackOffset,
-                             iAllocatorMsgPlayableDsd, iAllocatorMsgPlayableSilence);
+                             iAudioDataAllocator, iAllocatorMsgPlayableDsd, iAllocatorMsgPlayableSilence);
     }
     catch (AssertionFailed&) { // test code helper
         audioDsd->RemoveRef();
@@ -26,50 +26,96 @@ namespace Media {
 
 class Allocated;
 
-class AllocatorBase : private IInfoProvider
+/**
+ * Pool of Allocated cells.
+ *
+ * Free cells are held on a lock-free (Treiber) stack so that Allocate() and Free() can
+ * be called concurrently from any number of threads without blocking.  The stack links
+ * cells by index and pairs the head index with a modification count to avoid ABA.
+ *
+ * By default all cells are created up front.  Elastic allocators instead create a
+ * reserved minimum, then grow in slabs (under a lock, on the rare occasions the free
+ * list is found empty) up to a hard maximum.  Trim() returns slabs to the heap.
+ *
+ * Registers itself with an IInfoAggregator.  Aggregators may downcast the IInfoProvider
+ * they're passed to read the stats below directly.
+ */
+class AllocatorBase : public IInfoProvider
 {
+    static const TUint kIndexNone = 0; // stack links store (cell index + 1)
 public:
     ~AllocatorBase();
     void Free(Allocated* aPtr);
+    /**
+     * Delete slabs of cells that have not been needed since the previous call.
+     *
+     * The interval between calls therefore sets the quiet period required before memory
+     * is released.  Cells in the reserved minimum are never deleted.  Allocations made
+     * while this runs may briefly block.  Has no effect on fixed size allocators.
+     */
+    void Trim();
     TUint CellsTotal() const;
     TUint CellBytes() const;
     TUint CellsUsed() const;
     TUint CellsUsedMax() const;
+    TUint CellsAllocated() const; // cells currently resident; equal to CellsTotal() for fixed size allocators
+    TUint CellsAllocatedMax() const;
     void GetStats(TUint& aCellsTotal, TUint& aCellBytes, TUint& aCellsUsed, TUint& aCellsUsedMax) const;
     inline const TChar* Name() const;
     static const Brn kQueryMemory;
 protected:
     AllocatorBase(const TChar* aName, TUint aNumCells, TUint aCellBytes, IInfoAggregator& aInfoAggregator);
+    AllocatorBase(const TChar* aName, TUint aCellsReserved, TUint aCellsMax, TUint aSlabCells, TUint aCellBytes, IInfoAggregator& aInfoAggregator);
+    void Reserve(); // must be called by the constructor of the most derived class
     Allocated* DoAllocate();
 private:
+    virtual Allocated* NewCell() = 0;
     Allocated* Read();
+    Allocated* TryRead();
+    void Push(TUint aIndex);
+    void Grow(TUint aCells);
+    TUint SlabStart(TUint aCellsAdded) const;
+    static void UpdateMax(std::atomic<TUint>& aMax, TUint aVal);
 private: // from IInfoProvider
     void QueryInfo(const Brx& aQuery, IWriter& aWriter);
-protected:
-    FifoLiteDynamic<Allocated*> iFree;
 private:
-    mutable Mutex iLock;
     const TChar* iName;
     const TUint iCellsTotal;
+    const TUint iCellsReserved;
+    const TUint iSlabCells;
     const TUint iCellBytes;
-    TUint iCellsUsed;
-    TUint iCellsUsedMax;
+    Mutex iLockGrow;
+    Allocated** iCells;
+    std::atomic<TUint>* iNextFree;
+    std::atomic<TUint64> iFreeHead; // (modification count << 32) | (index + 1) of first free cell
+    std::atomic<TUint> iCellsAdded;
+    std::atomic<TUint> iCellsAddedMax;
+    std::atomic<TUint> iCellsUsed;
+    std::atomic<TUint> iCellsUsedMax;
+    std::atomic<TUint> iCellsUsedRecent; // peak since last Trim()
 };
 
 template <class T> class Allocator : public AllocatorBase
 {
 public:
     Allocator(const TChar* aName, TUint aNumCells, IInfoAggregator& aInfoAggregator);
+    Allocator(const TChar* aName, TUint aCellsReserved, TUint aCellsMax, TUint aSlabCells, IInfoAggregator& aInfoAggregator);
     virtual ~Allocator();
     T* Allocate();
+private: // from AllocatorBase
+    Allocated* NewCell() override;
 };
 
 template <class T> Allocator<T>::Allocator(const TChar* aName, TUint aNumCells, IInfoAggregator& aInfoAggregator)
     : AllocatorBase(aName, aNumCells, sizeof(T), aInfoAggregator)
 {
-    for (TUint i=0; i<aNumCells; i++) {
-        iFree.Write(new T(*this));
-    }
+    Reserve();
+}
+
+template <class T> Allocator<T>::Allocator(const TChar* aName, TUint aCellsReserved, TUint aCellsMax, TUint aSlabCells, IInfoAggregator& aInfoAggregator)
+    : AllocatorBase(aName, aCellsReserved, aCellsMax, aSlabCells, sizeof(T), aInfoAggregator)
+{
+    Reserve();
 }
 
 template <class T> Allocator<T>::~Allocator()
@@ -81,6 +127,11 @@ template <class T> T* Allocator<T>::Allocate()
     return static_cast<T*>(DoAllocate());
 }
 
+template <class T> Allocated* Allocator<T>::NewCell()
+{
+    return new T(*this);
+}
+
 class Logger;
 
 class Allocated
@@ -101,6 +152,7 @@ protected:
     AllocatorBase& iAllocator;
 private:
     std::atomic<TUint> iRefCount;
+    TUint iCellIndex;
 };
 
 enum class AudioDataEndian
@@ -112,15 +164,18 @@ enum class AudioDataEndian
 
 class AudioData : public Allocated
 {
+    friend class AudioDataAllocator;
 public: 
     static const TUint kMaxBytes = 8208; // max of 8k (DSD), 2ms/10ch/96/32 and 5ms/2ch/192/24
                                          // (latter for Songcast, supporting earliest receiver)
                                          // ...rounded up to allow full utilisation for 16, 24
                                          // and 32-bit audio
 public:
-    AudioData(AllocatorBase& aAllocator);
     const TByte* Ptr(TUint aOffsetBytes) const;
     TUint Bytes() const;
+    TUint MaxBytes() const; // capacity of this cell; <= kMaxBytes
+protected:
+    AudioData(AllocatorBase& aAllocator, Bwx& aData);
 #ifdef TIMESTAMP_LOGGING_ENABLE
     void SetTimestamp(const TChar* aId);
     TBool TryLogTimestamps();
@@ -128,7 +183,7 @@ public:
 private: // from Allocated
     void Clear() override;
 protected:
-    Bws<kMaxBytes> iData;
+    Bwx& iData;
 #ifdef TIMESTAMP_LOGGING_ENABLE
 private:
     class Timestamp
@@ -149,6 +204,7 @@ private:
 #endif // TIMESTAMP_LOGGING_ENABLE
 };
 
+// EncodedAudio and DecodedAudio add no state.  AudioDataAllocator cells are cast to whichever is required.
 class EncodedAudio : public AudioData
 {
     friend class MsgFactory;
@@ -156,7 +212,6 @@ public:
     TUint Append(const Brx& aData); // returns number of bytes appended
     TUint Append(const Brx& aData, TUint aMaxBytes); // returns number of bytes appended
 private:
-    EncodedAudio(AllocatorBase& aAllocator);
     void Construct(const Brx& aData);
     TUint DoAppend(const Brx& aData, TUint aMaxBytes);
 };
@@ -169,7 +224,6 @@ public:
 public:
     void Aggregate(DecodedAudio& aDecodedAudio);
 private:
-    DecodedAudio(AllocatorBase& aAllocator);
     void ConstructPcm(const Brx& aData, TUint aBitDepth, AudioDataEndian aEndian);
     void ConstructDsd(const Brx& aData);
     static void CopyToBigEndian16(const Brx& aData, TByte* aDest);
@@ -177,6 +231,51 @@ private:
     static void CopyToBigEndian32(const Brx& aData, TByte* aDest);
 };
 
+template <TUint kBytes> class AudioDataSized : public AudioData
+{
+public:
+    AudioDataSized(AllocatorBase& aAllocator);
+private:
+    Bws<kBytes> iStorage;
+};
+
+template <TUint kBytes> AudioDataSized<kBytes>::AudioDataSized(AllocatorBase& aAllocator)
+    : AudioData(aAllocator, iStorage)
+{
+}
+
+/**
+ * Size classed pools of AudioData.
+ *
+ * Each EncodedAudio or DecodedAudio comes from the smallest class that can hold its
+ * initial content, so short msgs don't each pin kMaxBytes.  Msgs that later grow
+ * (MsgAudioEncoded::Append(), MsgAudioDecoded::Aggregate()) move up a class.
+ *
+ * Classes smaller than kMaxBytes are only populated for elastic pools.  Fixed size
+ * pools must be able to hold aCount full cells anyway so gain nothing from them.
+ */
+class AudioDataAllocator : private INonCopyable
+{
+    static const TUint kBytes1k = 1024;
+    static const TUint kBytes2k = 2048;
+    static const TUint kBytes4k = 4096;
+public:
+    static const TUint kNumClasses = 4;
+public:
+    AudioDataAllocator(IInfoAggregator& aInfoAggregator, TUint aCount, TUint aReservedBytes, TUint aSlabBytes);
+    AudioData* Allocate(TUint aBytes); // returns a cell with capacity for at least aBytes
+    AudioData* Upsize(AudioData& aAudioData, TUint aBytes); // returns a copy of aAudioData with capacity for aBytes.  Caller removes ref on aAudioData
+    void Trim();
+private:
+    static TUint ReservedCount(TUint aCount, TUint aReservedBytes, TUint aSlabBytes, TUint aCellBytes);
+    static TUint SlabCount(TUint aSlabBytes, TUint aCellBytes);
+private:
+    Allocator<AudioDataSized<kBytes1k>> iAllocator1k;
+    Allocator<AudioDataSized<kBytes2k>> iAllocator2k;
+    Allocator<AudioDataSized<kBytes4k>> iAllocator4k;
+    Allocator<AudioDataSized<AudioData::kMaxBytes>> iAllocatorMax;
+};
+
 /**
  * Provides the pipeline's unit of timing.
  *
@@ -279,19 +378,28 @@ private:
 class RampApplicator : private INonCopyable
 {
     static const TUint kFullRampSpan;
+    static const TUint kMaxBlockSamples = 128;
 public:
     RampApplicator(const Media::Ramp& aRamp);
     TUint Start(const Brx& aData, TUint aBitDepth, TUint aNumChannels); // returns number of samples
     void GetNextSample(TByte* aDest);
+    TUint GetNextSamples(TByte* aDest, TUint aMaxSamples); // returns number of samples written to aDest
     static TUint MedianMultiplier(const Media::Ramp& aRamp);
+private:
+    inline TUint16 NextGain();
 private:
     const Media::Ramp& iRamp;
     const TByte* iPtr;
     TUint iBitDepth;
     TUint iNumChannels;
-    TInt iNumSamples;
-    TInt iTotalRamp;
-    TInt iLoopCount;
+    TUint iNumSamples;
+    TUint iLoopCount;
+    TBool iRampDown;
+    TUint iRampStep;          // ramp value changes by iRampStep + (iRampStepRemainder / iRampDivisor) per sample
+    TUint iRampStepRemainder;
+    TUint iRampDivisor;
+    TUint iRampDelta;         // total change in ramp value at iLoopCount
+    TUint iRampDeltaRemainder;
 };
 
 class MsgFactory;
@@ -638,7 +746,8 @@ public:
     MsgAudioEncoded* Clone();
     inline void AddLogPoint(const TChar* aId);
 private:
-    void Initialise(EncodedAudio* aEncodedAudio);
+    void Initialise(EncodedAudio* aEncodedAudio, AudioDataAllocator& aAudioDataAllocator);
+    void ReserveCapacity(TUint aBytes);
 private: // from Msg
     void Clear() override;
     Msg* Process(IMsgProcessor& aProcessor) override;
@@ -647,6 +756,7 @@ private:
     TUint iSize; // Bytes
     TUint iOffset; // Bytes
     EncodedAudio* iAudioData;
+    AudioDataAllocator* iAudioDataAllocator;
 };
 
 class MsgStreamInterrupted : public Msg
@@ -856,6 +966,7 @@ protected: // from MsgAudio
 protected:
     void Initialise(DecodedAudio* aDecodedAudio, TUint aSampleRate, TUint aBitDepth, TUint aChannels,
                     TUint64 aTrackOffset, TUint aNumSubsamples,
+                    AudioDataAllocator& aAudioDataAllocator,
                     Allocator<MsgPlayableSilence>& aAllocatorPlayableSilence);
 protected: // from MsgAudio
     void SplitCompleted(MsgAudio& aRemaining) override;
@@ -863,6 +974,7 @@ protected: // from Msg
     void Clear() override;
 protected:
     DecodedAudio* iAudioData;
+    AudioDataAllocator* iAudioDataAllocator;
     Allocator<MsgPlayableSilence>* iAllocatorPlayableSilence;
     TUint64 iTrackOffset;
 };
@@ -881,6 +993,7 @@ public: // from MsgAudio
     MsgPlayable* CreatePlayable() override; // removes ref, transfer ownership of DecodedAudio
 private:
     void Initialise(DecodedAudio* aDecodedAudio, TUint aSampleRate, TUint aBitDepth, TUint aChannels, TUint64 aTrackOffset,
+                    AudioDataAllocator& aAudioDataAllocator,
                     Allocator<MsgPlayablePcm>& aAllocatorPlayablePcm,
                     Allocator<MsgPlayableSilence>& aAllocatorPlayableSilence);
 private: // from MsgAudio
@@ -905,7 +1018,7 @@ public: // from MsgAudio
     MsgPlayable* CreatePlayable() override; // removes ref, transfer ownership of DecodedAudio
 private:
     void Initialise(DecodedAudio* aDecodedAudio, TUint aSampleRate, TUint aChannels,
-                    TUint aSampleBlockBits, TUint64 aTrackOffset,
+                    TUint aSampleBlockBits, TUint64 aTrackOffset, AudioDataAllocator& aAudioDataAllocator,
                     Allocator<MsgPlayableDsd>& aAllocatorPlayableDsd,
                     Allocator<MsgPlayableSilence>& aAllocatorPlayableSilence);
 private: // from MsgAudio
@@ -998,6 +1111,7 @@ protected:
 class MsgPlayablePcm : public MsgPlayable
 {
     friend class MsgAudioPcm;
+    static const TUint kRampFragmentBytes = 4096;
 public:
     MsgPlayablePcm(AllocatorBase& aAllocator);
 private:
@@ -1012,7 +1126,7 @@ private: // from MsgPlayable
 private: // from Msg
     void Clear() override;
 private:
-    void ApplyAttenuation(Bwx& aData);
+    static void ProcessFragment(IPcmProcessor& aProcessor, const Brx& aData, TUint aBitDepth, TUint aNumChannels);
 private:
     DecodedAudio* iAudioData;
     TUint iAttenuation;
@@ -1815,6 +1929,7 @@ public:
     inline void SetMsgSilenceCount(TUint aCount);
     inline void SetMsgPlayableCount(TUint aPcmCount, TUint aDsdCount, TUint aSilenceCount);
     inline void SetMsgQuitCount(TUint aCount);
+    inline void SetAudioDataElastic(TUint aReservedBytes, TUint aSlabBytes); // create only aReservedBytes of AudioData up front, growing aSlabBytes at a time as required
 private:
     TUint iMsgModeCount;
     TUint iMsgTrackCount;
@@ -1838,12 +1953,15 @@ private:
     TUint iMsgPlayableDsdCount;
     TUint iMsgPlayableSilenceCount;
     TUint iMsgQuitCount;
+    TUint iAudioDataReservedBytes;
+    TUint iAudioDataSlabBytes;
 };
 
 class MsgFactory
 {
 public:
     MsgFactory(IInfoAggregator& aInfoAggregator, const MsgFactoryInitParams& aInitParams);
+    void TrimAllocators(); // release elastic allocator memory unused since the last call
 
     MsgMode* CreateMsgMode(const Brx& aMode, const ModeInfo& aInfo, ModeClockPullers aClockPullers, const ModeTransportControls& aTransportControls);
     MsgMode* CreateMsgMode(const Brx& aMode);
@@ -1883,7 +2001,7 @@ private:
     TUint iDrainId;
     Allocator<MsgDelay> iAllocatorMsgDelay;
     Allocator<MsgEncodedStream> iAllocatorMsgEncodedStream;
-    Allocator<AudioData> iAllocatorAudioData;
+    AudioDataAllocator iAudioDataAllocator;
     Allocator<MsgAudioEncoded> iAllocatorMsgAudioEncoded;
     Allocator<MsgMetaText> iAllocatorMsgMetaText;
     Allocator<MsgStreamInterrupted> iAllocatorMsgStreamInterrupted;
@@ -300,6 +300,8 @@ inline MsgFactoryInitParams::MsgFactoryInitParams()
     , iMsgPlayableDsdCount(1)
     , iMsgPlayableSilenceCount(1)
     , iMsgQuitCount(1)
+    , iAudioDataReservedBytes(0)
+    , iAudioDataSlabBytes(0)
 {
 }
 inline void MsgFactoryInitParams::SetMsgModeCount(TUint aCount)
@@ -378,3 +380,9 @@ inline void MsgFactoryInitParams::SetMsgQuitCount(TUint aCount)
 {
     iMsgQuitCount = aCount;
 }
+
+inline void MsgFactoryInitParams::SetAudioDataElastic(TUint aReservedBytes, TUint aSlabBytes)
+{
+    iAudioDataReservedBytes = aReservedBytes;
+    iAudioDataSlabBytes = aSlabBytes;
+}
@@ -0,0 +1,767 @@
+#include <OpenHome/Media/Pipeline/PcmKernels.h>
+#include <OpenHome/Types.h>
+#include <OpenHome/Private/Standard.h>
+
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+# define PCM_KERNELS_X86
+# include <immintrin.h>
+# if defined(_MSC_VER)
+#  include <intrin.h>
+# endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+# define PCM_KERNELS_NEON
+# include <arm_neon.h>
+#endif
+
+#if defined(PCM_KERNELS_X86) && !defined(_MSC_VER)
+# define PCM_KERNELS_TARGET(isa) __attribute__((target(isa)))
+#else
+# define PCM_KERNELS_TARGET(isa)
+#endif
+
+using namespace OpenHome;
+using namespace OpenHome::Media;
+
+/*
+All gain stages use the same decomposition of a left-justified subsample s
+    s = hi * 2^16 + lo, where hi = s >> 16 (signed) and lo = s & 0xffff (unsigned)
+so that, for a Q15 gain g <= 2^15,
+    (s * g) >> 15 == ((hi * g) << 1) + ((lo * g) >> 15)
+Both products fit in 32 bits, letting SIMD paths use 32-bit lane multiplies while
+remaining bit-exact with PcmKernels::ApplyGainReference.
+*/
+
+namespace OpenHome {
+namespace Media {
+
+static const TUint kMaxChannels = PcmKernels::kMaxChannels;
+static const TUint kChunkSubsamples = 256;
+
+typedef void (*GainFunc)(TInt32* aSubsamples, const TInt32* aGains, TUint aCount);
+typedef void (*CopyFunc)(const TByte* aSrc, TByte* aDest, TUint aBytes);
+typedef void (*PackFunc)(const TInt32* aSrc, TByte* aDest, TUint aNumSubsamples);
+typedef void (*InterleaveFunc)(const TInt32* const* aSrc, TUint aNumChannels, TUint aNumSamples,
+                               TInt32 aMin, TInt32 aMax, TUint aShift, TInt32* aDest);
+
+struct KernelTable
+{
+    const TChar* iName;
+    GainFunc iApplyGain;
+    CopyFunc iCopyToBigEndian16;
+    CopyFunc iCopyToBigEndian24;
+    CopyFunc iCopyToBigEndian32;
+    PackFunc iPackBigEndian16;
+    PackFunc iPackBigEndian24;
+    InterleaveFunc iInterleave;
+};
+
+// Scalar
+
+static void ApplyGainScalar(TInt32* aSubsamples, const TInt32* aGains, TUint aCount)
+{
+    for (TUint i=0; i<aCount; i++) {
+        aSubsamples[i] = PcmKernels::ApplyGainReference(aSubsamples[i], (TUint)aGains[i]);
+    }
+}
+
+static void CopyToBigEndian16Scalar(const TByte* aSrc, TByte* aDest, TUint aBytes)
+{
+    for (TUint i=0; i<aBytes; i+=2) {
+        *aDest++ = aSrc[i+1];
+        *aDest++ = aSrc[i];
+    }
+}
+
+static void CopyToBigEndian24Scalar(const TByte* aSrc, TByte* aDest, TUint aBytes)
+{
+    for (TUint i=0; i<aBytes; i+=3) {
+        *aDest++ = aSrc[i+2];
+        *aDest++ = aSrc[i+1];
+        *aDest++ = aSrc[i];
+    }
+}
+
+static void CopyToBigEndian32Scalar(const TByte* aSrc, TByte* aDest, TUint aBytes)
+{
+    for (TUint i=0; i<aBytes; i+=4) {
+        *aDest++ = aSrc[i+3];
+        *aDest++ = aSrc[i+2];
+        *aDest++ = aSrc[i+1];
+        *aDest++ = aSrc[i];
+    }
+}
+
+// Pack left-justified native subsamples as big endian, truncating low order bits
+static void PackBigEndian16Scalar(const TInt32* aSrc, TByte* aDest, TUint aNumSubsamples)
+{
+    for (TUint i=0; i<aNumSubsamples; i++) {
+        const TUint32 val = (TUint32)aSrc[i];
+        *aDest++ = (TByte)(val >> 24);
+        *aDest++ = (TByte)(val >> 16);
+    }
+}
+
+static void PackBigEndian24Scalar(const TInt32* aSrc, TByte* aDest, TUint aNumSubsamples)
+{
+    for (TUint i=0; i<aNumSubsamples; i++) {
+        const TUint32 val = (TUint32)aSrc[i];
+        *aDest++ = (TByte)(val >> 24);
+        *aDest++ = (TByte)(val >> 16);
+        *aDest++ = (TByte)(val >> 8);
+    }
+}
+
+// Clip right-justified planar subsamples to [aMin..aMax] then interleave them, left-justified
+static void InterleaveScalar(const TInt32* const* aSrc, TUint aNumChannels, TUint aNumSamples,
+                             TInt32 aMin, TInt32 aMax, TUint aShift, TInt32* aDest)
+{
+    for (TUint i=0; i<aNumSamples; i++) {
+        for (TUint j=0; j<aNumChannels; j++) {
+            const TInt32 subsample = std::min(std::max(aSrc[j][i], aMin), aMax);
+            *aDest++ = (TInt32)((TUint32)subsample << aShift);
+        }
+    }
+}
+
+static void InterleaveTail(const TInt32* const* aSrc, TUint aNumChannels, TUint aNumSamples, TUint aStart,
+                           TInt32 aMin, TInt32 aMax, TUint aShift, TInt32* aDest)
+{
+    const TInt32* src[2] = { aSrc[0] + aStart, (aNumChannels == 2? aSrc[1] + aStart : nullptr) };
+    InterleaveScalar(src, aNumChannels, aNumSamples - aStart, aMin, aMax, aShift, aDest + (aStart * aNumChannels));
+}
+
+static const KernelTable kKernelsScalar = {
+    "scalar",
+    ApplyGainScalar,
+    CopyToBigEndian16Scalar,
+    CopyToBigEndian24Scalar,
+    CopyToBigEndian32Scalar,
+    PackBigEndian16Scalar,
+    PackBigEndian24Scalar,
+    InterleaveScalar
+};
+
+#if defined(PCM_KERNELS_X86)
+
+// SSE2 has no 32-bit lane multiply; build one from the even/odd 32x32->64 multiplies
+PCM_KERNELS_TARGET("sse2") static inline __m128i MulLo32Sse2(__m128i aA, __m128i aB)
+{
+    const __m128i even = _mm_mul_epu32(aA, aB);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(aA, 32), _mm_srli_epi64(aB, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+PCM_KERNELS_TARGET("sse2") static void ApplyGainSse2(TInt32* aSubsamples, const TInt32* aGains, TUint aCount)
+{
+    const __m128i maskLo = _mm_set1_epi32(0xffff);
+    TUint i = 0;
+    for (; i+4 <= aCount; i+=4) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSubsamples + i));
+        const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aGains + i));
+        const __m128i hi = MulLo32Sse2(_mm_srai_epi32(s, 16), g);
+        const __m128i lo = MulLo32Sse2(_mm_and_si128(s, maskLo), g);
+        const __m128i res = _mm_add_epi32(_mm_slli_epi32(hi, 1), _mm_srli_epi32(lo, PcmKernels::kGainShift));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aSubsamples + i), res);
+    }
+    ApplyGainScalar(aSubsamples + i, aGains + i, aCount - i);
+}
+
+PCM_KERNELS_TARGET("sse2") static void CopyToBigEndian16Sse2(const TByte* aSrc, TByte* aDest, TUint aBytes)
+{
+    TUint i = 0;
+    for (; i+16 <= aBytes; i+=16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + i));
+        const __m128i swapped = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + i), swapped);
+    }
+    CopyToBigEndian16Scalar(aSrc + i, aDest + i, aBytes - i);
+}
+
+PCM_KERNELS_TARGET("sse2") static void CopyToBigEndian32Sse2(const TByte* aSrc, TByte* aDest, TUint aBytes)
+{
+    TUint i = 0;
+    for (; i+16 <= aBytes; i+=16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + i));
+        __m128i swapped = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        swapped = _mm_shufflelo_epi16(swapped, _MM_SHUFFLE(2, 3, 0, 1));
+        swapped = _mm_shufflehi_epi16(swapped, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + i), swapped);
+    }
+    CopyToBigEndian32Scalar(aSrc + i, aDest + i, aBytes - i);
+}
+
+PCM_KERNELS_TARGET("ssse3") static void CopyToBigEndian24Ssse3(const TByte* aSrc, TByte* aDest, TUint aBytes)
+{
+    // each 16 byte load/store converts 5 subsamples; the 16th byte is rewritten by the next iteration
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+    TUint i = 0;
+    for (; i+16 <= aBytes; i+=15) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + i), _mm_shuffle_epi8(v, shuffle));
+    }
+    CopyToBigEndian24Scalar(aSrc + i, aDest + i, aBytes - i);
+}
+
+PCM_KERNELS_TARGET("avx2") static void ApplyGainAvx2(TInt32* aSubsamples, const TInt32* aGains, TUint aCount)
+{
+    const __m256i maskLo = _mm256_set1_epi32(0xffff);
+    TUint i = 0;
+    for (; i+8 <= aCount; i+=8) {
+        const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSubsamples + i));
+        const __m256i g = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aGains + i));
+        const __m256i hi = _mm256_mullo_epi32(_mm256_srai_epi32(s, 16), g);
+        const __m256i lo = _mm256_mullo_epi32(_mm256_and_si256(s, maskLo), g);
+        const __m256i res = _mm256_add_epi32(_mm256_slli_epi32(hi, 1), _mm256_srli_epi32(lo, PcmKernels::kGainShift));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aSubsamples + i), res);
+    }
+    ApplyGainScalar(aSubsamples + i, aGains + i, aCount - i);
+}
+
+PCM_KERNELS_TARGET("avx2") static void CopyToBigEndian16Avx2(const TByte* aSrc, TByte* aDest, TUint aBytes)
+{
+    const __m256i shuffle = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                             1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    TUint i = 0;
+    for (; i+32 <= aBytes; i+=32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest + i), _mm256_shuffle_epi8(v, shuffle));
+    }
+    CopyToBigEndian16Scalar(aSrc + i, aDest + i, aBytes - i);
+}
+
+PCM_KERNELS_TARGET("avx2") static void CopyToBigEndian32Avx2(const TByte* aSrc, TByte* aDest, TUint aBytes)
+{
+    const __m256i shuffle = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                             3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    TUint i = 0;
+    for (; i+32 <= aBytes; i+=32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest + i), _mm256_shuffle_epi8(v, shuffle));
+    }
+    CopyToBigEndian32Scalar(aSrc + i, aDest + i, aBytes - i);
+}
+
+PCM_KERNELS_TARGET("sse2") static inline __m128i Clip32Sse2(__m128i aV, __m128i aMin, __m128i aMax)
+{
+    const __m128i above = _mm_cmpgt_epi32(aV, aMax);
+    aV = _mm_or_si128(_mm_and_si128(above, aMax), _mm_andnot_si128(above, aV));
+    const __m128i below = _mm_cmplt_epi32(aV, aMin);
+    return _mm_or_si128(_mm_and_si128(below, aMin), _mm_andnot_si128(below, aV));
+}
+
+// vectorised for the common mono and stereo cases only
+PCM_KERNELS_TARGET("sse2") static void InterleaveSse2(const TInt32* const* aSrc, TUint aNumChannels, TUint aNumSamples,
+                                                      TInt32 aMin, TInt32 aMax, TUint aShift, TInt32* aDest)
+{
+    if (aNumChannels > 2) {
+        InterleaveScalar(aSrc, aNumChannels, aNumSamples, aMin, aMax, aShift, aDest);
+        return;
+    }
+    const __m128i min = _mm_set1_epi32(aMin);
+    const __m128i max = _mm_set1_epi32(aMax);
+    const __m128i shift = _mm_cvtsi32_si128((int)aShift);
+    TUint i = 0;
+    for (; i+4 <= aNumSamples; i+=4) {
+        const __m128i l = _mm_sll_epi32(Clip32Sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc[0] + i)), min, max), shift);
+        if (aNumChannels == 1) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + i), l);
+        }
+        else {
+            const __m128i r = _mm_sll_epi32(Clip32Sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc[1] + i)), min, max), shift);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + 2*i), _mm_unpacklo_epi32(l, r));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + 2*i + 4), _mm_unpackhi_epi32(l, r));
+        }
+    }
+    InterleaveTail(aSrc, aNumChannels, aNumSamples, i, aMin, aMax, aShift, aDest);
+}
+
+PCM_KERNELS_TARGET("ssse3") static void PackBigEndian16Ssse3(const TInt32* aSrc, TByte* aDest, TUint aNumSubsamples)
+{
+    const __m128i shuffle = _mm_setr_epi8(3, 2, 7, 6, 11, 10, 15, 14, -1, -1, -1, -1, -1, -1, -1, -1);
+    TUint i = 0;
+    for (; i+4 <= aNumSubsamples; i+=4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + i));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(aDest + 2*i), _mm_shuffle_epi8(v, shuffle));
+    }
+    PackBigEndian16Scalar(aSrc + i, aDest + 2*i, aNumSubsamples - i);
+}
+
+PCM_KERNELS_TARGET("ssse3") static void PackBigEndian24Ssse3(const TInt32* aSrc, TByte* aDest, TUint aNumSubsamples)
+{
+    // each 16 byte store writes 4 subsamples plus 4 bytes which are rewritten by the next iteration
+    const __m128i shuffle = _mm_setr_epi8(3, 2, 1, 7, 6, 5, 11, 10, 9, 15, 14, 13, -1, -1, -1, -1);
+    TUint i = 0;
+    for (; i+6 <= aNumSubsamples; i+=4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDest + 3*i), _mm_shuffle_epi8(v, shuffle));
+    }
+    PackBigEndian24Scalar(aSrc + i, aDest + 3*i, aNumSubsamples - i);
+}
+
+PCM_KERNELS_TARGET("avx2") static void InterleaveAvx2(const TInt32* const* aSrc, TUint aNumChannels, TUint aNumSamples,
+                                                      TInt32 aMin, TInt32 aMax, TUint aShift, TInt32* aDest)
+{
+    if (aNumChannels > 2) {
+        InterleaveScalar(aSrc, aNumChannels, aNumSamples, aMin, aMax, aShift, aDest);
+        return;
+    }
+    const __m256i min = _mm256_set1_epi32(aMin);
+    const __m256i max = _mm256_set1_epi32(aMax);
+    const __m128i shift = _mm_cvtsi32_si128((int)aShift);
+    TUint i = 0;
+    for (; i+8 <= aNumSamples; i+=8) {
+        __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc[0] + i));
+        l = _mm256_sll_epi32(_mm256_min_epi32(_mm256_max_epi32(l, min), max), shift);
+        if (aNumChannels == 1) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest + i), l);
+        }
+        else {
+            __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc[1] + i));
+            r = _mm256_sll_epi32(_mm256_min_epi32(_mm256_max_epi32(r, min), max), shift);
+            const __m256i lo = _mm256_unpacklo_epi32(l, r); // samples 0,1 | 4,5
+            const __m256i hi = _mm256_unpackhi_epi32(l, r); // samples 2,3 | 6,7
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest + 2*i), _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDest + 2*i + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+    }
+    InterleaveTail(aSrc, aNumChannels, aNumSamples, i, aMin, aMax, aShift, aDest);
+}
+
+static void CpuFeatures(TBool& aSse2, TBool& aSsse3, TBool& aAvx2)
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    aSse2 = ((info[3] & (1 << 26)) != 0);
+    aSsse3 = ((info[2] & (1 << 9)) != 0);
+    const TBool osxsave = ((info[2] & (1 << 27)) != 0);
+    aAvx2 = false;
+    if (maxLeaf >= 7 && osxsave && (_xgetbv(0) & 6) == 6) {
+        __cpuidex(info, 7, 0);
+        aAvx2 = ((info[1] & (1 << 5)) != 0);
+    }
+#else
+    __builtin_cpu_init();
+    aSse2 = (__builtin_cpu_supports("sse2") != 0);
+    aSsse3 = (__builtin_cpu_supports("ssse3") != 0);
+    aAvx2 = (__builtin_cpu_supports("avx2") != 0);
+#endif
+}
+
+static KernelTable SelectKernels()
+{
+    KernelTable kernels = kKernelsScalar;
+    TBool sse2, ssse3, avx2;
+    CpuFeatures(sse2, ssse3, avx2);
+    if (sse2) {
+        kernels.iName = "sse2";
+        kernels.iApplyGain = ApplyGainSse2;
+        kernels.iCopyToBigEndian16 = CopyToBigEndian16Sse2;
+        kernels.iCopyToBigEndian32 = CopyToBigEndian32Sse2;
+        kernels.iInterleave = InterleaveSse2;
+    }
+    if (ssse3) {
+        kernels.iName = "ssse3";
+        kernels.iCopyToBigEndian24 = CopyToBigEndian24Ssse3;
+        kernels.iPackBigEndian16 = PackBigEndian16Ssse3;
+        kernels.iPackBigEndian24 = PackBigEndian24Ssse3;
+    }
+    if (avx2) {
+        kernels.iName = "avx2";
+        kernels.iApplyGain = ApplyGainAvx2;
+        kernels.iCopyToBigEndian16 = CopyToBigEndian16Avx2;
+        kernels.iCopyToBigEndian32 = CopyToBigEndian32Avx2;
+        kernels.iInterleave = InterleaveAvx2;
+    }
+    return kernels;
+}
+
+#elif defined(PCM_KERNELS_NEON)
+
+static void ApplyGainNeon(TInt32* aSubsamples, const TInt32* aGains, TUint aCount)
+{
+    const uint32x4_t maskLo = vdupq_n_u32(0xffff);
+    TUint i = 0;
+    for (; i+4 <= aCount; i+=4) {
+        const int32x4_t s = vld1q_s32(aSubsamples + i);
+        const int32x4_t g = vld1q_s32(aGains + i);
+        const int32x4_t hi = vshlq_n_s32(vmulq_s32(vshrq_n_s32(s, 16), g), 1);
+        const uint32x4_t sLo = vandq_u32(vreinterpretq_u32_s32(s), maskLo);
+        const uint32x4_t lo = vshrq_n_u32(vmulq_u32(sLo, vreinterpretq_u32_s32(g)), PcmKernels::kGainShift);
+        vst1q_s32(aSubsamples + i, vaddq_s32(hi, vreinterpretq_s32_u32(lo)));
+    }
+    ApplyGainScalar(aSubsamples + i, aGains + i, aCount - i);
+}
+
+static void CopyToBigEndian16Neon(const TByte* aSrc, TByte* aDest, TUint aBytes)
+{
+    TUint i = 0;
+    for (; i+16 <= aBytes; i+=16) {
+        vst1q_u8(aDest + i, vrev16q_u8(vld1q_u8(aSrc + i)));
+    }
+    CopyToBigEndian16Scalar(aSrc + i, aDest + i, aBytes - i);
+}
+
+static void CopyToBigEndian24Neon(const TByte* aSrc, TByte* aDest, TUint aBytes)
+{
+    TUint i = 0;
+    for (; i+48 <= aBytes; i+=48) {
+        const uint8x16x3_t v = vld3q_u8(aSrc + i); // de-interleaves bytes 0,1,2 of each subsample
+        uint8x16x3_t swapped;
+        swapped.val[0] = v.val[2];
+        swapped.val[1] = v.val[1];
+        swapped.val[2] = v.val[0];
+        vst3q_u8(aDest + i, swapped);
+    }
+    CopyToBigEndian24Scalar(aSrc + i, aDest + i, aBytes - i);
+}
+
+static void CopyToBigEndian32Neon(const TByte* aSrc, TByte* aDest, TUint aBytes)
+{
+    TUint i = 0;
+    for (; i+16 <= aBytes; i+=16) {
+        vst1q_u8(aDest + i, vrev32q_u8(vld1q_u8(aSrc + i)));
+    }
+    CopyToBigEndian32Scalar(aSrc + i, aDest + i, aBytes - i);
+}
+
+static void PackBigEndian16Neon(const TInt32* aSrc, TByte* aDest, TUint aNumSubsamples)
+{
+    TUint i = 0;
+    for (; i+16 <= aNumSubsamples; i+=16) {
+        const uint8x16x4_t v = vld4q_u8(reinterpret_cast<const TByte*>(aSrc + i)); // byte n of each subsample in val[n]
+        uint8x16x2_t packed;
+        packed.val[0] = v.val[3];
+        packed.val[1] = v.val[2];
+        vst2q_u8(aDest + 2*i, packed);
+    }
+    PackBigEndian16Scalar(aSrc + i, aDest + 2*i, aNumSubsamples - i);
+}
+
+static void PackBigEndian24Neon(const TInt32* aSrc, TByte* aDest, TUint aNumSubsamples)
+{
+    TUint i = 0;
+    for (; i+16 <= aNumSubsamples; i+=16) {
+        const uint8x16x4_t v = vld4q_u8(reinterpret_cast<const TByte*>(aSrc + i));
+        uint8x16x3_t packed;
+        packed.val[0] = v.val[3];
+        packed.val[1] = v.val[2];
+        packed.val[2] = v.val[1];
+        vst3q_u8(aDest + 3*i, packed);
+    }
+    PackBigEndian24Scalar(aSrc + i, aDest + 3*i, aNumSubsamples - i);
+}
+
+// vectorised for the common mono and stereo cases only
+static void InterleaveNeon(const TInt32* const* aSrc, TUint aNumChannels, TUint aNumSamples,
+                           TInt32 aMin, TInt32 aMax, TUint aShift, TInt32* aDest)
+{
+    if (aNumChannels > 2) {
+        InterleaveScalar(aSrc, aNumChannels, aNumSamples, aMin, aMax, aShift, aDest);
+        return;
+    }
+    const int32x4_t min = vdupq_n_s32(aMin);
+    const int32x4_t max = vdupq_n_s32(aMax);
+    const int32x4_t shift = vdupq_n_s32((TInt32)aShift);
+    TUint i = 0;
+    for (; i+4 <= aNumSamples; i+=4) {
+        const int32x4_t l = vshlq_s32(vminq_s32(vmaxq_s32(vld1q_s32(aSrc[0] + i), min), max), shift);
+        if (aNumChannels == 1) {
+            vst1q_s32(aDest + i, l);
+        }
+        else {
+            int32x4x2_t lr;
+            lr.val[0] = l;
+            lr.val[1] = vshlq_s32(vminq_s32(vmaxq_s32(vld1q_s32(aSrc[1] + i), min), max), shift);
+            vst2q_s32(aDest + 2*i, lr);
+        }
+    }
+    InterleaveTail(aSrc, aNumChannels, aNumSamples, i, aMin, aMax, aShift, aDest);
+}
+
+static KernelTable SelectKernels()
+{
+    const KernelTable kernels = {
+        "neon",
+        ApplyGainNeon,
+        CopyToBigEndian16Neon,
+        CopyToBigEndian24Neon,
+        CopyToBigEndian32Neon,
+        PackBigEndian16Neon,
+        PackBigEndian24Neon,
+        InterleaveNeon
+    };
+    return kernels;
+}
+
+#else
+
+static KernelTable SelectKernels()
+{
+    return kKernelsScalar;
+}
+
+#endif
+
+static std::atomic<TBool> gForceScalar(false);
+
+static const KernelTable& Kernels()
+{
+    static const KernelTable kKernelsSelected = SelectKernels(); // thread-safe one-off initialisation
+    if (gForceScalar.load(std::memory_order_relaxed)) {
+        return kKernelsScalar;
+    }
+    return kKernelsSelected;
+}
+
+template <TUint kBytes> inline TInt32 ReadSubsample(const TByte* aPtr);
+
+template <> inline TInt32 ReadSubsample<1>(const TByte* aPtr)
+{
+    return (TInt32)((TUint32)aPtr[0] << 24);
+}
+
+template <> inline TInt32 ReadSubsample<2>(const TByte* aPtr)
+{
+    return (TInt32)(((TUint32)aPtr[0] << 24) | ((TUint32)aPtr[1] << 16));
+}
+
+template <> inline TInt32 ReadSubsample<3>(const TByte* aPtr)
+{
+    return (TInt32)(((TUint32)aPtr[0] << 24) | ((TUint32)aPtr[1] << 16) | ((TUint32)aPtr[2] << 8));
+}
+
+template <> inline TInt32 ReadSubsample<4>(const TByte* aPtr)
+{
+    return (TInt32)(((TUint32)aPtr[0] << 24) | ((TUint32)aPtr[1] << 16) | ((TUint32)aPtr[2] << 8) | aPtr[3]);
+}
+
+template <TUint kBytes> inline void WriteSubsample(TByte* aPtr, TInt32 aSubsample)
+{
+    const TUint32 val = (TUint32)aSubsample;
+    for (TUint i=0; i<kBytes; i++) {
+        aPtr[i] = (TByte)(val >> (24 - (8 * i)));
+    }
+}
+
+template <TUint kBytes, TUint kChannels>
+void RampBlock(GainFunc aApplyGain, const TByte* aSrc, TByte* aDest, const TUint16* aGains, TUint aNumSamples)
+{
+    static const TUint kChunkSamples = kChunkSubsamples / kChannels;
+    TInt32 subsamples[kChunkSamples * kChannels];
+    TInt32 gains[kChunkSamples * kChannels];
+    while (aNumSamples > 0) {
+        const TUint numSamples = std::min(aNumSamples, kChunkSamples);
+        const TUint numSubsamples = numSamples * kChannels;
+        TInt32* s = subsamples;
+        TInt32* g = gains;
+        for (TUint i=0; i<numSamples; i++) {
+            const TInt32 gain = aGains[i];
+            for (TUint j=0; j<kChannels; j++) {
+                *g++ = gain;
+                *s++ = ReadSubsample<kBytes>(aSrc);
+                aSrc += kBytes;
+            }
+        }
+        aApplyGain(subsamples, gains, numSubsamples);
+        for (TUint i=0; i<numSubsamples; i++) {
+            WriteSubsample<kBytes>(aDest, subsamples[i]);
+            aDest += kBytes;
+        }
+        aGains += numSamples;
+        aNumSamples -= numSamples;
+    }
+}
+
+template <TUint kBytes>
+void RampBlock(GainFunc aApplyGain, const TByte* aSrc, TByte* aDest, const TUint16* aGains, TUint aNumSamples, TUint aNumChannels)
+{
+    // any channel count; chunks needn't end on a sample boundary
+    TInt32 subsamples[kChunkSubsamples];
+    TInt32 gains[kChunkSubsamples];
+    TUint remaining = aNumSamples * aNumChannels;
+    TUint channel = 0;
+    while (remaining > 0) {
+        const TUint numSubsamples = std::min(remaining, kChunkSubsamples);
+        for (TUint i=0; i<numSubsamples; i++) {
+            gains[i] = *aGains;
+            subsamples[i] = ReadSubsample<kBytes>(aSrc);
+            aSrc += kBytes;
+            if (++channel == aNumChannels) {
+                channel = 0;
+                aGains++;
+            }
+        }
+        aApplyGain(subsamples, gains, numSubsamples);
+        for (TUint i=0; i<numSubsamples; i++) {
+            WriteSubsample<kBytes>(aDest, subsamples[i]);
+            aDest += kBytes;
+        }
+        remaining -= numSubsamples;
+    }
+}
+
+template <TUint kBytes>
+void GainBlock(GainFunc aApplyGain, const TByte* aSrc, TByte* aDest, TUint aGain, TUint aNumSubsamples)
+{
+    TInt32 subsamples[kChunkSubsamples];
+    TInt32 gains[kChunkSubsamples];
+    std::fill(gains, gains + std::min(aNumSubsamples, kChunkSubsamples), (TInt32)aGain);
+    while (aNumSubsamples > 0) {
+        const TUint numSubsamples = std::min(aNumSubsamples, kChunkSubsamples);
+        for (TUint i=0; i<numSubsamples; i++) {
+            subsamples[i] = ReadSubsample<kBytes>(aSrc);
+            aSrc += kBytes;
+        }
+        aApplyGain(subsamples, gains, numSubsamples);
+        for (TUint i=0; i<numSubsamples; i++) {
+            WriteSubsample<kBytes>(aDest, subsamples[i]);
+            aDest += kBytes;
+        }
+        aNumSubsamples -= numSubsamples;
+    }
+}
+
+template <TUint kBytes>
+void PackBigEndianBlock(const TInt32* aSrc, TByte* aDest, TUint aNumSubsamples)
+{
+    for (TUint i=0; i<aNumSubsamples; i++) {
+        WriteSubsample<kBytes>(aDest, *aSrc++);
+        aDest += kBytes;
+    }
+}
+
+typedef void (*RampBlockFunc)(GainFunc aApplyGain, const TByte* aSrc, TByte* aDest, const TUint16* aGains, TUint aNumSamples);
+typedef void (*RampBlockAnyFunc)(GainFunc aApplyGain, const TByte* aSrc, TByte* aDest, const TUint16* aGains, TUint aNumSamples, TUint aNumChannels);
+typedef void (*GainBlockFunc)(GainFunc aApplyGain, const TByte* aSrc, TByte* aDest, TUint aGain, TUint aNumSubsamples);
+
+#define RAMP_BLOCK_FUNCS(bytes) \
+    { RampBlock<bytes, 1>, RampBlock<bytes, 2>, RampBlock<bytes, 3>, RampBlock<bytes, 4>, \
+      RampBlock<bytes, 5>, RampBlock<bytes, 6>, RampBlock<bytes, 7>, RampBlock<bytes, 8> }
+
+static const RampBlockFunc kRampBlockFuncs[4][kMaxChannels] = {
+    RAMP_BLOCK_FUNCS(1),
+    RAMP_BLOCK_FUNCS(2),
+    RAMP_BLOCK_FUNCS(3),
+    RAMP_BLOCK_FUNCS(4)
+};
+
+#undef RAMP_BLOCK_FUNCS
+
+static const RampBlockAnyFunc kRampBlockAnyFuncs[4] = { RampBlock<1>, RampBlock<2>, RampBlock<3>, RampBlock<4> };
+
+static const GainBlockFunc kGainBlockFuncs[4] = { GainBlock<1>, GainBlock<2>, GainBlock<3>, GainBlock<4> };
+
+typedef void (*PackBigEndianFunc)(const TInt32* aSrc, TByte* aDest, TUint aNumSubsamples);
+
+static const PackBigEndianFunc kPackBigEndianFuncs[4] = {
+    PackBigEndianBlock<1>, PackBigEndian16Scalar, PackBigEndian24Scalar, PackBigEndianBlock<4>
+};
+
+static void PackBigEndian(const KernelTable& aKernels, const TInt32* aSrc, TByte* aDest, TUint aNumSubsamples, TUint aBitDepth)
+{
+    if (aBitDepth == 16) {
+        aKernels.iPackBigEndian16(aSrc, aDest, aNumSubsamples);
+    }
+    else if (aBitDepth == 24) {
+        aKernels.iPackBigEndian24(aSrc, aDest, aNumSubsamples);
+    }
+    else {
+        kPackBigEndianFuncs[(aBitDepth/8) - 1](aSrc, aDest, aNumSubsamples);
+    }
+}
+
+} // namespace Media
+} // namespace OpenHome
+
+
+// PcmKernels
+
+const TUint PcmKernels::kGainShift;
+const TUint PcmKernels::kGainUnity;
+
+void PcmKernels::CopyToBigEndian16(const TByte* aSrc, TByte* aDest, TUint aBytes)
+{ // static
+    Kernels().iCopyToBigEndian16(aSrc, aDest, aBytes);
+}
+
+void PcmKernels::CopyToBigEndian24(const TByte* aSrc, TByte* aDest, TUint aBytes)
+{ // static
+    Kernels().iCopyToBigEndian24(aSrc, aDest, aBytes);
+}
+
+void PcmKernels::CopyToBigEndian32(const TByte* aSrc, TByte* aDest, TUint aBytes)
+{ // static
+    Kernels().iCopyToBigEndian32(aSrc, aDest, aBytes);
+}
+
+void PcmKernels::ApplyRamp(const TByte* aSrc, TByte* aDest, const TUint16* aGains,
+                           TUint aNumSamples, TUint aBitDepth, TUint aNumChannels)
+{ // static
+    ASSERT(aBitDepth == 8 || aBitDepth == 16 || aBitDepth == 24 || aBitDepth == 32);
+    ASSERT(aNumChannels > 0);
+    const TUint index = (aBitDepth/8) - 1;
+    if (aNumChannels <= kMaxChannels) {
+        kRampBlockFuncs[index][aNumChannels - 1](Kernels().iApplyGain, aSrc, aDest, aGains, aNumSamples);
+    }
+    else {
+        kRampBlockAnyFuncs[index](Kernels().iApplyGain, aSrc, aDest, aGains, aNumSamples, aNumChannels);
+    }
+}
+
+void PcmKernels::ApplyGain(const TByte* aSrc, TByte* aDest, TUint aGain, TUint aNumSubsamples, TUint aBitDepth)
+{ // static
+    ASSERT(aBitDepth == 8 || aBitDepth == 16 || aBitDepth == 24 || aBitDepth == 32);
+    ASSERT(aGain <= kGainUnity);
+    kGainBlockFuncs[(aBitDepth/8) - 1](Kernels().iApplyGain, aSrc, aDest, aGain, aNumSubsamples);
+}
+
+void PcmKernels::ApplyGain(TInt32* aSubsamples, const TInt32* aGains, TUint aCount)
+{ // static
+    Kernels().iApplyGain(aSubsamples, aGains, aCount);
+}
+
+void PcmKernels::InterleaveToBigEndian(const TInt32* const aSrc[], TUint aNumChannels, TUint aNumSamples,
+                                       TUint aSrcBits, TByte* aDest, TUint aBitDepth)
+{ // static
+    ASSERT(aNumChannels > 0 && aNumChannels <= kMaxChannels);
+    ASSERT(aSrcBits >= 8 && aSrcBits <= 32);
+    ASSERT(aBitDepth == 8 || aBitDepth == 16 || aBitDepth == 24 || aBitDepth == 32);
+    const KernelTable& kernels = Kernels();
+    const TInt32 max = (TInt32)((1u << (aSrcBits - 1)) - 1);
+    const TInt32 min = -max - 1;
+    const TUint shift = 32 - aSrcBits;
+    const TUint destBytes = aNumChannels * (aBitDepth / 8);
+    const TUint chunkSamples = kChunkSubsamples / aNumChannels;
+    TInt32 subsamples[kChunkSubsamples];
+    const TInt32* src[kMaxChannels];
+    for (TUint i=0; i<aNumChannels; i++) {
+        src[i] = aSrc[i];
+    }
+    while (aNumSamples > 0) {
+        const TUint numSamples = std::min(aNumSamples, chunkSamples);
+        kernels.iInterleave(src, aNumChannels, numSamples, min, max, shift, subsamples);
+        Media::PackBigEndian(kernels, subsamples, aDest, numSamples * aNumChannels, aBitDepth);
+        for (TUint i=0; i<aNumChannels; i++) {
+            src[i] += numSamples;
+        }
+        aDest += numSamples * destBytes;
+        aNumSamples -= numSamples;
+    }
+}
+
+const TChar* PcmKernels::SimdName()
+{ // static
+    return Kernels().iName;
+}
+
+void PcmKernels::ForceScalar(TBool aForce)
+{ // static
+    gForceScalar.store(aForce);
+}
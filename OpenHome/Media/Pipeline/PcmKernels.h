@@ -0,0 +1,85 @@
+#pragma once
+
+#include <OpenHome/Types.h>
+
+namespace OpenHome {
+namespace Media {
+
+/**
+ * Block operations on packed PCM.
+ *
+ * Subsamples are unpacked to left-justified 32-bit values so that a single gain stage
+ * serves all bit depths without losing precision.  Gains are Q15 fractions; per-sample
+ * ramp gains are in the range [0..0x7fff], matching kRampArray, constant gains may be
+ * anything up to and including kGainUnity.
+ *
+ * SSE2/SSSE3/AVX2 (x86) or NEON (ARM) implementations are selected at runtime, the
+ * first time any kernel is used.
+ */
+class PcmKernels
+{
+public:
+    static const TUint kGainShift = 15;
+    static const TUint kGainUnity = 1 << kGainShift;
+    static const TUint kMaxChannels = 8;
+public:
+    /**
+     * Convert little endian subsamples to the pipeline's big endian representation.
+     *
+     * @param[in]  aSrc     Packed little endian subsamples.
+     * @param[out] aDest    Receives aBytes of big endian subsamples.  Must not overlap aSrc.
+     * @param[in]  aBytes   Must be a multiple of the subsample size.
+     */
+    static void CopyToBigEndian16(const TByte* aSrc, TByte* aDest, TUint aBytes);
+    static void CopyToBigEndian24(const TByte* aSrc, TByte* aDest, TUint aBytes);
+    static void CopyToBigEndian32(const TByte* aSrc, TByte* aDest, TUint aBytes);
+    /**
+     * Apply a per-sample gain to a block of packed big endian PCM.
+     *
+     * @param[in]  aSrc          Packed big endian subsamples.
+     * @param[out] aDest         Receives aNumSamples ramped samples.  May equal aSrc.
+     * @param[in]  aGains        One Q15 gain per sample (i.e. shared by all channels of a sample).
+     * @param[in]  aNumSamples   Number of samples (not subsamples) to process.
+     * @param[in]  aBitDepth     8, 16, 24 or 32.
+     * @param[in]  aNumChannels  Any non-zero count.  Up to kMaxChannels use kernels specialised for the count.
+     */
+    static void ApplyRamp(const TByte* aSrc, TByte* aDest, const TUint16* aGains,
+                          TUint aNumSamples, TUint aBitDepth, TUint aNumChannels);
+    /**
+     * Apply a constant Q15 gain (<= kGainUnity) to a block of packed big endian PCM.
+     *
+     * aDest may equal aSrc.
+     */
+    static void ApplyGain(const TByte* aSrc, TByte* aDest, TUint aGain, TUint aNumSubsamples, TUint aBitDepth);
+    /**
+     * Multiply each of aCount left-justified subsamples by the matching Q15 gain.
+     */
+    static void ApplyGain(TInt32* aSubsamples, const TInt32* aGains, TUint aCount);
+    /**
+     * Interleave planar decoder output as packed big endian PCM.
+     *
+     * Source subsamples are right-justified signed values with aSrcBits significant
+     * bits (including sign).  Values outside this range are clipped; bits beyond
+     * aBitDepth are truncated (no dither).
+     *
+     * @param[in]  aSrc          One pointer per channel, each to aNumSamples subsamples.
+     * @param[in]  aNumChannels  [1..kMaxChannels].
+     * @param[in]  aNumSamples   Number of samples (not subsamples) to process.
+     * @param[in]  aSrcBits      [8..32].  e.g. the stream's bit depth for FLAC, MAD_F_FRACBITS+1 for libmad.
+     * @param[out] aDest         Receives aNumSamples * aNumChannels * aBitDepth/8 bytes.
+     * @param[in]  aBitDepth     8, 16, 24 or 32.
+     */
+    static void InterleaveToBigEndian(const TInt32* const aSrc[], TUint aNumChannels, TUint aNumSamples,
+                                      TUint aSrcBits, TByte* aDest, TUint aBitDepth);
+    static inline TInt32 ApplyGainReference(TInt32 aSubsample, TUint aGain);
+    static const TChar* SimdName();
+    static void ForceScalar(TBool aForce); // benchmark/test use only
+};
+
+inline TInt32 PcmKernels::ApplyGainReference(TInt32 aSubsample, TUint aGain)
+{ // static
+    return (TInt32)(((TInt64)aSubsample * (TInt64)aGain) >> kGainShift);
+}
+
+} // namespace Media
+} // namespace OpenHome
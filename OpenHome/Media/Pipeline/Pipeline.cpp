@@ -12,6 +12,7 @@
 #include <OpenHome/Media/Pipeline/DecodedAudioValidator.h>
 #include <OpenHome/Media/Pipeline/DecodedAudioAggregator.h>
 #include <OpenHome/Media/Pipeline/StreamValidator.h>
+#include <OpenHome/Media/Pipeline/DsdToPcm.h>
 #include <OpenHome/Media/Pipeline/DecodedAudioReservoir.h>
 #include <OpenHome/Media/Pipeline/Ramper.h>
 #include <OpenHome/Media/Pipeline/RampValidator.h>
@@ -30,6 +31,7 @@
 #include <OpenHome/Media/Pipeline/Muter.h>
 #include <OpenHome/Media/Pipeline/VolumeRamper.h>
 #include <OpenHome/Media/Pipeline/PreDriver.h>
+#include <OpenHome/Media/Pipeline/PipelineMetrics.h>
 #include <OpenHome/Private/Printer.h>
 #include <OpenHome/Media/Pipeline/Msg.h>
 #include <OpenHome/Media/Debug.h>
@@ -49,6 +51,7 @@ PipelineInitParams* PipelineInitParams::New()
 PipelineInitParams::PipelineInitParams()
     : iEncodedReservoirBytes(kEncodedReservoirSizeBytes)
     , iDecodedReservoirJiffies(kDecodedReservoirSize)
+    , iDecodeAheadJiffies(kDecodeAheadSizeDefault)
     , iGorgeDurationJiffies(kGorgerSizeDefault)
     , iStarvationRamperMinJiffies(kStarvationRamperSizeDefault)
     , iMaxStreamsPerReservoir(kMaxReservoirStreamsDefault)
@@ -60,6 +63,7 @@ PipelineInitParams::PipelineInitParams()
     , iSupportElements(EPipelineSupportElementsAll)
     , iMuter(kMuterDefault)
     , iDsdSupported(kDsdSupportedDefault)
+    , iAudioDataReservedBytes(kAudioDataReserveAll)
 {
     SetThreadPriorityMax(kThreadPriorityMax);
 }
@@ -78,6 +82,11 @@ void PipelineInitParams::SetDecodedReservoirSize(TUint aJiffies)
     iDecodedReservoirJiffies = aJiffies;
 }
 
+void PipelineInitParams::SetDecodeAheadSize(TUint aJiffies)
+{
+    iDecodeAheadJiffies = aJiffies;
+}
+
 void PipelineInitParams::SetGorgerDuration(TUint aJiffies)
 {
     iGorgeDurationJiffies = aJiffies;
@@ -147,6 +156,11 @@ void PipelineInitParams::SetDsdSupported(TBool aDsd)
     iDsdSupported = aDsd;
 }
 
+void PipelineInitParams::SetAudioDataReservedBytes(TUint aBytes)
+{
+    iAudioDataReservedBytes = aBytes;
+}
+
 TUint PipelineInitParams::EncodedReservoirBytes() const
 {
     return iEncodedReservoirBytes;
@@ -157,6 +171,11 @@ TUint PipelineInitParams::DecodedReservoirJiffies() const
     return iDecodedReservoirJiffies;
 }
 
+TUint PipelineInitParams::DecodeAheadJiffies() const
+{
+    return iDecodeAheadJiffies;
+}
+
 TUint PipelineInitParams::GorgeDurationJiffies() const
 {
    return iGorgeDurationJiffies;
@@ -227,6 +246,11 @@ TBool OpenHome::Media::PipelineInitParams::DsdSupported() const
     return iDsdSupported;
 }
 
+TUint PipelineInitParams::AudioDataReservedBytes() const
+{
+    return iAudioDataReservedBytes;
+}
+
 // Pipeline
 
 #define ATTACH_ELEMENT(elem, ctor, prev_elem, supported, type)  \
@@ -261,7 +285,7 @@ Pipeline::Pipeline(PipelineInitParams* aInitParams, IInfoAggregator& aInfoAggreg
     const TUint maxEncodedReservoirMsgs = encodedAudioCount;
     encodedAudioCount += kRewinderMaxMsgs; // this may only be required on platforms that don't guarantee priority based thread scheduling
     const TUint msgEncodedAudioCount = encodedAudioCount + 100; // +100 allows for Split()ing by Container and CodecController
-    const TUint decodedReservoirSize = aInitParams->DecodedReservoirJiffies() + aInitParams->StarvationRamperMinJiffies();
+    const TUint decodedReservoirSize = aInitParams->DecodedReservoirJiffies() + aInitParams->DecodeAheadJiffies() + aInitParams->StarvationRamperMinJiffies();
     const TUint decodedAudioCount = ((decodedReservoirSize + iInitParams->SenderMinLatency()) / DecodedAudioAggregator::kMaxJiffies) + 200; // +200 allows for songcast sender, some smaller msgs and some buffering in non-reservoir elements
     const TUint msgAudioPcmCount = decodedAudioCount + 100; // +100 allows for Split()ing in various elements
     const TUint msgHaltCount = perStreamMsgCount * 2; // worst case is tiny Vorbis track with embedded metatext in a single-track playlist with repeat
@@ -282,9 +306,16 @@ Pipeline::Pipeline(PipelineInitParams* aInitParams, IInfoAggregator& aInfoAggreg
     if (aInitParams->DsdSupported()) {
         msgInit.SetMsgAudioDsdCount(msgAudioPcmCount);
     }
+    else {
+        msgInit.SetMsgAudioDsdCount(kMsgCountAudioDsdToPcm);
+    }
     msgInit.SetMsgSilenceCount(kMsgCountSilence);
     msgInit.SetMsgPlayableCount(kMsgCountPlayablePcm, kMsgCountPlayableDsd, kMsgCountPlayableSilence);
     msgInit.SetMsgQuitCount(kMsgCountQuit);
+    if (aInitParams->AudioDataReservedBytes() != PipelineInitParams::kAudioDataReserveAll) {
+        msgInit.SetAudioDataElastic(aInitParams->AudioDataReservedBytes(), kAudioDataSlabBytes);
+    }
+    iMetrics = new PipelineMetrics(aInfoAggregator);
     iMsgFactory = new MsgFactory(aInfoAggregator, msgInit);
 
     iEventThread = new PipelineElementObserverThread(aInitParams->ThreadPriorityEvent());
@@ -323,7 +354,8 @@ Pipeline::Pipeline(PipelineInitParams* aInitParams, IInfoAggregator& aInfoAggreg
     iDecodedAudioReservoir = new DecodedAudioReservoir(*iMsgFactory, *this,
                                                        aInitParams->DecodedReservoirJiffies(),
                                                        aInitParams->MaxStreamsPerReservoir(),
-                                                       aInitParams->GorgeDurationJiffies());
+                                                       aInitParams->GorgeDurationJiffies(),
+                                                       aInitParams->DecodeAheadJiffies());
     downstream = iDecodedAudioReservoir;
 
     ATTACH_ELEMENT(iLoggerDecodedAudioAggregator,
@@ -336,9 +368,11 @@ Pipeline::Pipeline(PipelineInitParams* aInitParams, IInfoAggregator& aInfoAggreg
                    downstream, elementsSupported, EPipelineSupportElementsLogger);
     ATTACH_ELEMENT(iStreamValidator, new StreamValidator(*iMsgFactory, *downstream),
                    downstream, elementsSupported, EPipelineSupportElementsMandatory);
+    ATTACH_ELEMENT(iDsdToPcm, new DsdToPcm(*iMsgFactory, *downstream, aInitParams->DsdSupported()),
+                   downstream, elementsSupported, EPipelineSupportElementsMandatory);
 
     // construct push logger slightly out of sequence
-    ATTACH_ELEMENT(iRampValidatorCodec, new RampValidator("Codec Controller", *iStreamValidator),
+    ATTACH_ELEMENT(iRampValidatorCodec, new RampValidator("Codec Controller", *iDsdToPcm),
                    downstream, elementsSupported, EPipelineSupportElementsRampValidator);
     ATTACH_ELEMENT(iLoggerCodecController, new Logger("Codec Controller", *downstream),
                    downstream, elementsSupported, EPipelineSupportElementsLogger);
@@ -545,6 +579,24 @@ Pipeline::Pipeline(PipelineInitParams* aInitParams, IInfoAggregator& aInfoAggreg
     //iLoggerMuter->SetFilter(Logger::EMsgAll);
     //iLoggerVolumeRamper->SetFilter(Logger::EMsgAll);
     //iLoggerPreDriver->SetFilter(Logger::EMsgAll);
+
+    // Metrics are registered here but not recorded until iMetrics->SetEnabled(true)
+    iEncodedAudioReservoir->SetMetrics(*iMetrics, "Encoded Audio Reservoir", "bytes");
+    iDecodedAudioReservoir->SetMetrics(*iMetrics, "Decoded Audio Reservoir", "ms");
+    iCodecController->SetMetrics(*iMetrics);
+    iStarvationRamper->SetMetrics(*iMetrics);
+    Logger* loggers[] = { iLoggerEncodedAudioReservoir, iLoggerContainer, iLoggerCodecController,
+                          iLoggerStreamValidator, iLoggerDecodedAudioAggregator, iLoggerDecodedAudioReservoir,
+                          iLoggerRamper, iLoggerSeeker, iLoggerVariableDelay1, iLoggerSkipper,
+                          iLoggerTrackInspector, iLoggerWaiter, iLoggerStopper, iLoggerSpotifyReporter,
+                          iLoggerReporter, iLoggerRouter, iLoggerAttenuator, iLoggerDrainer,
+                          iLoggerVariableDelay2, iLoggerStarvationRamper, iLoggerMuter,
+                          iLoggerVolumeRamper, iLoggerPreDriver };
+    for (auto logger : loggers) {
+        if (logger != nullptr) {
+            logger->SetMetrics(*iMetrics);
+        }
+    }
 }
 
 Pipeline::~Pipeline()
@@ -615,6 +667,7 @@ Pipeline::~Pipeline()
     delete iDecodedAudioAggregator;
     delete iLoggerStreamValidator;
     delete iStreamValidator;
+    delete iDsdToPcm;
     delete iRampValidatorCodec;
     delete iLoggerCodecController;
     delete iLoggerContainer;
@@ -624,6 +677,7 @@ Pipeline::~Pipeline()
     delete iEncodedAudioReservoir;
     delete iEventThread;
     delete iMsgFactory;
+    delete iMetrics;
     delete iInitParams;
 }
 
@@ -692,6 +746,11 @@ MsgFactory& Pipeline::Factory()
     return *iMsgFactory;
 }
 
+PipelineMetrics& Pipeline::Metrics()
+{
+    return *iMetrics;
+}
+
 void Pipeline::Play()
 {
     DoPlay(false);
@@ -846,6 +905,7 @@ Msg* Pipeline::Pull()
 void Pipeline::SetAnimator(IPipelineAnimator& aAnimator)
 {
     iStreamValidator->SetAnimator(aAnimator);
+    iDsdToPcm->SetAnimator(aAnimator);
     iVariableDelay1->SetAnimator(aAnimator);
     iVariableDelay2->SetAnimator(aAnimator);
     if (iMuterSamples != nullptr) {
@@ -867,6 +927,7 @@ void Pipeline::PipelineStopped()
     iState = EStopped;
     iLock.Signal();
     NotifyStatus();
+    iMsgFactory->TrimAllocators();
 }
 
 void Pipeline::PipelinePlaying()
@@ -41,6 +41,7 @@ public:
     // setters
     void SetEncodedReservoirSize(TUint aBytes);
     void SetDecodedReservoirSize(TUint aJiffies);
+    void SetDecodeAheadSize(TUint aJiffies); // extra audio the next stream can decode into while the current one plays out.  0 disables
     void SetGorgerDuration(TUint aJiffies); // amount of audio required before non-pullable sources will start playing
     void SetStarvationRamperMinSize(TUint aJiffies);
     void SetMaxStreamsPerReservoir(TUint aCount);
@@ -53,10 +54,12 @@ public:
     void SetMaxLatency(TUint aJiffies);
     void SetSupportElements(TUint aElements); // EPipelineSupportElements members OR'd together
     void SetMuter(MuterImpl aMuter);
-    void SetDsdSupported(TBool aDsd);
+    void SetDsdSupported(TBool aDsd); // if false, DSD streams are converted to pcm
+    void SetAudioDataReservedBytes(TUint aBytes); // audio memory allocated up front.  Reservoirs grow beyond this on demand; see Pipeline::TrimAllocators()
     // getters
     TUint EncodedReservoirBytes() const;
     TUint DecodedReservoirJiffies() const;
+    TUint DecodeAheadJiffies() const;
     TUint GorgeDurationJiffies() const;
     TUint StarvationRamperMinJiffies() const;
     TUint MaxStreamsPerReservoir() const;
@@ -71,11 +74,13 @@ public:
     TUint SupportElements() const;
     MuterImpl Muter() const;
     TBool DsdSupported() const;
+    TUint AudioDataReservedBytes() const;
 private:
     PipelineInitParams();
 private:
     TUint iEncodedReservoirBytes;
     TUint iDecodedReservoirJiffies;
+    TUint iDecodeAheadJiffies;
     TUint iGorgeDurationJiffies;
     TUint iStarvationRamperMinJiffies;
     TUint iMaxStreamsPerReservoir;
@@ -90,9 +95,11 @@ private:
     TUint iSupportElements;
     MuterImpl iMuter;
     TBool iDsdSupported;
+    TUint iAudioDataReservedBytes;
 private:
     static const TUint kEncodedReservoirSizeBytes       = 1536 * 1024;
     static const TUint kDecodedReservoirSize            = Jiffies::kPerMs * 2000;
+    static const TUint kDecodeAheadSizeDefault          = 0;
     static const TUint kGorgerSizeDefault               = Jiffies::kPerMs * 1000;
     static const TUint kStarvationRamperSizeDefault     = Jiffies::kPerMs * 20;
     static const TUint kMaxReservoirStreamsDefault      = 10;
@@ -104,6 +111,8 @@ private:
     static const TUint kMaxLatencyDefault               = Jiffies::kPerMs * 2000;
     static const MuterImpl kMuterDefault                = MuterImpl::eRampSamples;
     static const TBool kDsdSupportedDefault             = false;
+public:
+    static const TUint kAudioDataReserveAll             = UINT_MAX;
 };
 
 namespace Codec {
@@ -118,6 +127,7 @@ class EncodedAudioReservoir;
 class Logger;
 class DecodedAudioValidator;
 class StreamValidator;
+class DsdToPcm;
 class DecodedAudioAggregator;
 class DecodedAudioReservoir;
 class Ramper;
@@ -145,6 +155,7 @@ class ISpotifyTrackObserver;
 class IMimeTypeList;
 class VolumeRamper;
 class IVolumeRamper;
+class PipelineMetrics;
 
 class Pipeline : public IPipelineElementDownstream
                , public IPipeline
@@ -168,11 +179,13 @@ class Pipeline : public IPipelineElementDownstream
     static const TUint kMsgCountSilence         = 410; // 2secs @ 5ms per msg + 10 spare
     static const TUint kMsgCountPlayablePcm     = 10;
     static const TUint kMsgCountPlayableDsd     = 10;
+    static const TUint kMsgCountAudioDsdToPcm   = 10; // DSD is only held briefly by CodecController if DsdToPcm always converts it
     static const TUint kMsgCountPlayableSilence = 10;
     static const TUint kMsgCountFlush           = 16;
     static const TUint kMsgCountMode            = 20;
     static const TUint kMsgCountQuit            = 1;
     static const TUint kMsgCountDrain           = 5;
+    static const TUint kAudioDataSlabBytes      = 512 * 1024; // per size class, when PipelineInitParams::SetAudioDataReservedBytes() is used
 public:
     Pipeline(PipelineInitParams* aInitParams, IInfoAggregator& aInfoAggregator, TrackFactory& aTrackFactory, IPipelineObserver& aObserver,
              IStreamPlayObserver& aStreamPlayObserver, ISeekRestreamer& aSeekRestreamer, IUrlBlockWriter& aUrlBlockWriter);
@@ -182,6 +195,7 @@ public:
     void Start(IVolumeRamper& aVolumeRamper, IVolumeMuterStepped& aVolumeMuter);
     void Quit();
     MsgFactory& Factory();
+    PipelineMetrics& Metrics();
     void Play();
     void Pause();
     void Wait(TUint aFlushId);
@@ -246,6 +260,7 @@ private:
     PipelineInitParams* iInitParams;
     IPipelineObserver& iObserver;
     Mutex iLock;
+    PipelineMetrics* iMetrics;
     MsgFactory* iMsgFactory;
     PipelineElementObserverThread* iEventThread;
     AudioDumper* iAudioDumper;
@@ -256,6 +271,7 @@ private:
     Codec::CodecController* iCodecController;
     Logger* iLoggerCodecController;
     RampValidator* iRampValidatorCodec;
+    DsdToPcm* iDsdToPcm;
     StreamValidator* iStreamValidator;
     Logger* iLoggerStreamValidator;
     DecodedAudioAggregator* iDecodedAudioAggregator;
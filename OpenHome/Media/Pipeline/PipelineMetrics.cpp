@@ -0,0 +1,246 @@
+#include <OpenHome/Media/Pipeline/PipelineMetrics.h>
+#include <OpenHome/Types.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Json.h>
+#include <OpenHome/OsWrapper.h>
+#include <OpenHome/Net/Private/Globals.h>
+#include <OpenHome/Private/Ascii.h>
+#include <OpenHome/Private/Stream.h>
+
+using namespace OpenHome;
+using namespace OpenHome::Media;
+
+static void WriteUint(WriterJsonObject& aWriter, const TChar* aKey, TUint64 aValue)
+{
+    Bws<24> buf;
+    Ascii::AppendDec(buf, aValue);
+    aWriter.WriteRaw(aKey, buf);
+}
+
+// MetricsHistogram
+
+MetricsHistogram::MetricsHistogram(const TChar* aElement, const TChar* aMetric, const TChar* aUnits)
+    : iElement(aElement)
+    , iMetric(aMetric)
+    , iUnits(aUnits)
+{
+    Reset();
+}
+
+void MetricsHistogram::Add(TUint aValue)
+{
+    (void)iBuckets[BucketIndex(aValue)].fetch_add(1, std::memory_order_relaxed);
+    (void)iCount.fetch_add(1, std::memory_order_relaxed);
+    (void)iSum.fetch_add(aValue, std::memory_order_relaxed);
+    TUint max = iMax.load(std::memory_order_relaxed);
+    while (aValue > max && !iMax.compare_exchange_weak(max, aValue, std::memory_order_relaxed)) {
+    }
+}
+
+void MetricsHistogram::Reset()
+{
+    for (TUint i=0; i<kNumBuckets; i++) {
+        iBuckets[i].store(0, std::memory_order_relaxed);
+    }
+    iCount.store(0, std::memory_order_relaxed);
+    iSum.store(0, std::memory_order_relaxed);
+    iMax.store(0, std::memory_order_relaxed);
+}
+
+TUint MetricsHistogram::Count() const
+{
+    return iCount.load(std::memory_order_relaxed);
+}
+
+TUint MetricsHistogram::Max() const
+{
+    return iMax.load(std::memory_order_relaxed);
+}
+
+TUint64 MetricsHistogram::Sum() const
+{
+    return iSum.load(std::memory_order_relaxed);
+}
+
+TUint MetricsHistogram::Bucket(TUint aIndex) const
+{
+    ASSERT(aIndex < kNumBuckets);
+    return iBuckets[aIndex].load(std::memory_order_relaxed);
+}
+
+void MetricsHistogram::WriteJson(WriterJsonObject& aWriter) const
+{
+    aWriter.WriteString("element", iElement);
+    aWriter.WriteString("metric", iMetric);
+    aWriter.WriteString("units", iUnits);
+    WriteUint(aWriter, "count", Count());
+    WriteUint(aWriter, "sum", Sum());
+    WriteUint(aWriter, "max", Max());
+    // trailing empty buckets are omitted
+    TUint last = kNumBuckets;
+    while (last > 0 && Bucket(last - 1) == 0) {
+        last--;
+    }
+    auto writerBuckets = aWriter.CreateArray("buckets", WriterJsonArray::WriteOnEmpty::eEmptyArray);
+    for (TUint i=0; i<last; i++) {
+        writerBuckets.WriteInt((TInt)Bucket(i));
+    }
+    writerBuckets.WriteEnd();
+}
+
+TUint MetricsHistogram::BucketIndex(TUint aValue)
+{ // static
+    TUint index = 0;
+    while (aValue != 0 && index < kNumBuckets - 1) {
+        aValue >>= 1;
+        index++;
+    }
+    return index;
+}
+
+
+// MetricsCounter
+
+MetricsCounter::MetricsCounter(const TChar* aElement, const TChar* aMetric)
+    : iElement(aElement)
+    , iMetric(aMetric)
+    , iCount(0)
+{
+}
+
+void MetricsCounter::Inc()
+{
+    (void)iCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MetricsCounter::Reset()
+{
+    iCount.store(0, std::memory_order_relaxed);
+}
+
+TUint MetricsCounter::Count() const
+{
+    return iCount.load(std::memory_order_relaxed);
+}
+
+void MetricsCounter::WriteJson(WriterJsonObject& aWriter) const
+{
+    aWriter.WriteString("element", iElement);
+    aWriter.WriteString("metric", iMetric);
+    WriteUint(aWriter, "count", Count());
+}
+
+
+// PipelineMetrics
+
+const Brn PipelineMetrics::kQueryMetrics("metrics");
+
+PipelineMetrics::PipelineMetrics(IInfoAggregator& aInfoAggregator)
+    : iOsCtx(gEnv->OsCtx())
+    , iLock("PMET")
+    , iEnabled(false)
+{
+    std::vector<Brn> infoQueries;
+    infoQueries.push_back(kQueryMetrics);
+    aInfoAggregator.Register(*this, infoQueries);
+}
+
+PipelineMetrics::~PipelineMetrics()
+{
+    for (auto h : iHistograms) {
+        delete h;
+    }
+    for (auto c : iCounters) {
+        delete c;
+    }
+}
+
+MetricsHistogram& PipelineMetrics::RegisterHistogram(const TChar* aElement, const TChar* aMetric, const TChar* aUnits)
+{
+    auto h = new MetricsHistogram(aElement, aMetric, aUnits);
+    AutoMutex _(iLock);
+    iHistograms.push_back(h);
+    return *h;
+}
+
+MetricsCounter& PipelineMetrics::RegisterCounter(const TChar* aElement, const TChar* aMetric)
+{
+    auto c = new MetricsCounter(aElement, aMetric);
+    AutoMutex _(iLock);
+    iCounters.push_back(c);
+    return *c;
+}
+
+void PipelineMetrics::SetEnabled(TBool aEnabled)
+{
+    iEnabled.store(aEnabled, std::memory_order_relaxed);
+}
+
+TUint64 PipelineMetrics::NowUs() const
+{
+    return OsTimeInUs(iOsCtx);
+}
+
+void PipelineMetrics::Reset()
+{
+    AutoMutex _(iLock);
+    for (auto h : iHistograms) {
+        h->Reset();
+    }
+    for (auto c : iCounters) {
+        c->Reset();
+    }
+}
+
+void PipelineMetrics::WriteJson(IWriter& aWriter)
+{
+    AutoMutex _(iLock);
+    WriterJsonObject writer(aWriter);
+    writer.WriteBool("enabled", Enabled());
+    auto writerHistograms = writer.CreateArray("histograms", WriterJsonArray::WriteOnEmpty::eEmptyArray);
+    for (auto h : iHistograms) {
+        auto writerHistogram = writerHistograms.CreateObject();
+        h->WriteJson(writerHistogram);
+        writerHistogram.WriteEnd();
+    }
+    writerHistograms.WriteEnd();
+    auto writerCounters = writer.CreateArray("counters", WriterJsonArray::WriteOnEmpty::eEmptyArray);
+    for (auto c : iCounters) {
+        auto writerCounter = writerCounters.CreateObject();
+        c->WriteJson(writerCounter);
+        writerCounter.WriteEnd();
+    }
+    writerCounters.WriteEnd();
+    writer.WriteEnd();
+}
+
+void PipelineMetrics::QueryInfo(const Brx& aQuery, IWriter& aWriter)
+{
+    if (aQuery == kQueryMetrics) {
+        WriteJson(aWriter);
+        aWriter.Write(Brn("\n"));
+    }
+}
+
+
+// AutoMetricsTimer
+
+AutoMetricsTimer::AutoMetricsTimer(PipelineMetrics* aMetrics, MetricsHistogram* aHistogram)
+    : iMetrics(aMetrics)
+    , iHistogram(aHistogram)
+    , iStartUs(0)
+{
+    if (iHistogram != nullptr && iMetrics->Enabled()) {
+        iStartUs = iMetrics->NowUs();
+    }
+    else {
+        iHistogram = nullptr;
+    }
+}
+
+AutoMetricsTimer::~AutoMetricsTimer()
+{
+    if (iHistogram != nullptr) {
+        iHistogram->Add((TUint)(iMetrics->NowUs() - iStartUs));
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <OpenHome/Types.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Private/Standard.h>
+#include <OpenHome/Private/Thread.h>
+#include <OpenHome/Private/InfoProvider.h>
+
+#include <atomic>
+#include <vector>
+
+namespace OpenHome {
+    class WriterJsonObject;
+namespace Media {
+
+/*
+Latency/throughput instrumentation shared by all pipeline elements.
+
+Metrics are registered once, while the pipeline is being constructed, and are then
+updated lock-free from any pipeline thread.  Recording is disabled by default; elements
+should check PipelineMetrics::Enabled() before doing any work (including reading the
+clock) so that the cost of a disabled build is a single relaxed atomic load.
+
+Results are available via IInfoAggregator as JSON using query kQueryMetrics.
+*/
+
+class MetricsHistogram : private INonCopyable
+{
+public:
+    // Bucket 0 counts values of 0; bucket n (n>0) counts values in [2^(n-1), 2^n).
+    // The final bucket also counts all larger values.
+    static const TUint kNumBuckets = 24;
+public:
+    MetricsHistogram(const TChar* aElement, const TChar* aMetric, const TChar* aUnits);
+    void Add(TUint aValue);
+    void Reset();
+    TUint Count() const;
+    TUint Max() const;
+    TUint64 Sum() const;
+    TUint Bucket(TUint aIndex) const;
+    void WriteJson(WriterJsonObject& aWriter) const;
+    static TUint BucketIndex(TUint aValue);
+private:
+    const TChar* iElement;
+    const TChar* iMetric;
+    const TChar* iUnits;
+    std::atomic<TUint> iBuckets[kNumBuckets];
+    std::atomic<TUint> iCount;
+    std::atomic<TUint64> iSum;
+    std::atomic<TUint> iMax;
+};
+
+class MetricsCounter : private INonCopyable
+{
+public:
+    MetricsCounter(const TChar* aElement, const TChar* aMetric);
+    void Inc();
+    void Reset();
+    TUint Count() const;
+    void WriteJson(WriterJsonObject& aWriter) const;
+private:
+    const TChar* iElement;
+    const TChar* iMetric;
+    std::atomic<TUint> iCount;
+};
+
+class PipelineMetrics : public IInfoProvider, private INonCopyable
+{
+public:
+    static const Brn kQueryMetrics;
+public:
+    PipelineMetrics(IInfoAggregator& aInfoAggregator);
+    ~PipelineMetrics();
+    /**
+     * Register a histogram.  Expected to be called during pipeline construction only.
+     *
+     * aElement, aMetric and aUnits must remain valid for the lifetime of this object.
+     * The returned reference is owned by, and has the same lifetime as, this object.
+     */
+    MetricsHistogram& RegisterHistogram(const TChar* aElement, const TChar* aMetric, const TChar* aUnits);
+    MetricsCounter& RegisterCounter(const TChar* aElement, const TChar* aMetric);
+    void SetEnabled(TBool aEnabled);
+    inline TBool Enabled() const;
+    TUint64 NowUs() const;
+    void Reset();
+    void WriteJson(IWriter& aWriter);
+private: // from IInfoProvider
+    void QueryInfo(const Brx& aQuery, IWriter& aWriter) override;
+private:
+    OsContext* iOsCtx;
+    Mutex iLock;
+    std::atomic<TBool> iEnabled;
+    std::vector<MetricsHistogram*> iHistograms;
+    std::vector<MetricsCounter*> iCounters;
+};
+
+/*
+Times a block, adding the elapsed microseconds to a histogram.
+Does nothing if aHistogram is nullptr or metrics are disabled.
+*/
+
+class AutoMetricsTimer : private INonCopyable
+{
+public:
+    AutoMetricsTimer(PipelineMetrics* aMetrics, MetricsHistogram* aHistogram);
+    ~AutoMetricsTimer();
+private:
+    PipelineMetrics* iMetrics;
+    MetricsHistogram* iHistogram;
+    TUint64 iStartUs;
+};
+
+// PipelineMetrics
+
+inline TBool PipelineMetrics::Enabled() const
+{
+    return iEnabled.load(std::memory_order_relaxed);
+}
+
+} // namespace Media
+} // namespace OpenHome
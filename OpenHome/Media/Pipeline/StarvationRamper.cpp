@@ -6,6 +6,7 @@
 #include <OpenHome/Media/FlywheelRamper.h>
 #include <OpenHome/Media/Pipeline/ElementObserver.h>
 #include <OpenHome/Media/Debug.h>
+#include <OpenHome/Media/Pipeline/PipelineMetrics.h>
 //#include <OpenHome/Private/Timer.h>
 //#include <OpenHome/Net/Private/Globals.h>
 
@@ -393,6 +394,8 @@ StarvationRamper::StarvationRamper(MsgFactory& aMsgFactory, IPipelineElementUpst
     , iTrackStreamCount(0)
     , iHaltCount(0)
     , iLastEventBuffering(false)
+    , iMetrics(nullptr)
+    , iMetricsStarvation(nullptr)
 {
     ASSERT(iEventBuffering.is_lock_free());
     iEventId = iObserverThread.Register(MakeFunctor(*this, &StarvationRamper::EventCallback));
@@ -436,6 +439,13 @@ TUint StarvationRamper::ThreadPriorityStarvationRamper() const
     return iThreadPriorityStarvationRamper;
 }
 
+void StarvationRamper::SetMetrics(PipelineMetrics& aMetrics)
+{
+    ASSERT(iMetrics == nullptr);
+    iMetrics = &aMetrics;
+    iMetricsStarvation = &aMetrics.RegisterCounter("StarvationRamper", "starvation");
+}
+
 inline TBool StarvationRamper::IsFull() const
 {
     return (Jiffies() >= iMaxJiffies || DecodedStreamCount() == iMaxStreamCount);
@@ -461,6 +471,9 @@ void StarvationRamper::PullerThread()
 void StarvationRamper::StartFlywheelRamp()
 {
     LOG(kPipeline, "StarvationRamper::StartFlywheelRamp()\n");
+    if (iMetricsStarvation != nullptr && iMetrics->Enabled()) {
+        iMetricsStarvation->Inc();
+    }
 //    const TUint startTime = Time::Now(*gEnv);
     if (iRecentAudioJiffies > kTrainingJiffies) {
         TInt excess = iRecentAudioJiffies - kTrainingJiffies;
@@ -10,6 +10,9 @@
 namespace OpenHome {
 namespace Media {
 
+class PipelineMetrics;
+class MetricsCounter;
+
 class IStarvationRamperObserver
 {
 public:
@@ -101,6 +104,7 @@ public:
     TUint SizeInJiffies() const;
     TUint ThreadPriorityFlywheelRamper() const;
     TUint ThreadPriorityStarvationRamper() const;
+    void SetMetrics(PipelineMetrics& aMetrics);
 private:
     inline TBool IsFull() const;
     void PullerThread();
@@ -178,6 +182,8 @@ private:
     std::atomic<TUint> iHaltCount;
     std::atomic<bool> iEventBuffering;
     TBool iLastEventBuffering;
+    PipelineMetrics* iMetrics;
+    MetricsCounter* iMetricsStarvation;
 };
 
 } //namespace Media
@@ -1,5 +1,6 @@
 #include <OpenHome/Media/PipelineManager.h>
 #include <OpenHome/Media/Pipeline/Pipeline.h>
+#include <OpenHome/Media/Pipeline/PipelineMetrics.h>
 #include <OpenHome/Media/Protocol/Protocol.h>
 #include <OpenHome/Media/Filler.h>
 #include <OpenHome/Media/IdManager.h>
@@ -223,6 +224,18 @@ void PipelineManager::Stop()
                                         override the attempt to Stop it. */
 }
 
+void PipelineManager::TrimMemory()
+{
+    LOG(kPipeline, "PipelineManager::TrimMemory()\n");
+    iPipeline->Factory().TrimAllocators();
+}
+
+void PipelineManager::SetMetricsEnabled(TBool aEnabled)
+{
+    LOG(kPipeline, "PipelineManager::SetMetricsEnabled(%u)\n", aEnabled);
+    iPipeline->Metrics().SetEnabled(aEnabled);
+}
+
 void PipelineManager::StopPrefetch(const Brx& aMode, TUint aTrackId)
 {
     AutoMutex _(iPublicLock);
@@ -220,6 +220,21 @@ public:
      * to EPipelineStopped.
      */
     void Stop();
+    /**
+     * Return audio memory that has not been needed since the previous call to the heap.
+     *
+     * Only has an effect if PipelineInitParams::SetAudioDataReservedBytes() was used.
+     * Intended to be called periodically (e.g. once a minute) or on entering standby.
+     * Also run automatically each time the pipeline stops.
+     */
+    void TrimMemory();
+    /**
+     * Start or stop recording per-element latency, reservoir occupancy, codec cost and starvation metrics.
+     *
+     * Disabled by default.  Results are available as JSON via IInfoAggregator,
+     * query PipelineMetrics::kQueryMetrics.  Enabling does not reset metrics gathered previously.
+     */
+    void SetMetricsEnabled(TBool aEnabled);
     /**
      * Remove all current pipeline content, fetch but don't play a new track.
      *
@@ -0,0 +1,276 @@
+#include <OpenHome/Media/Protocol/FileMapped.h>
+#include <OpenHome/Types.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Private/Printer.h>
+#include <OpenHome/Private/Stream.h>
+#include <OpenHome/Media/Debug.h>
+
+#ifdef FILE_MAPPED_SUPPORTED
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+# ifdef __linux__
+#  include <sys/vfs.h>
+#  include <sys/sysmacros.h>
+#  include <stdio.h>
+# else
+#  include <sys/param.h>
+#  include <sys/mount.h>
+#  include <string.h>
+# endif
+#endif
+
+using namespace OpenHome;
+using namespace OpenHome::Media;
+
+// FileMapped
+
+FileMapped::FileMapped(TUint aWindowBytes, TBool aFixedDisksOnly)
+    : iMaxWindowBytes(aWindowBytes)
+    , iFixedDisksOnly(aFixedDisksOnly)
+    , iFd(-1)
+    , iPageBytes(4096)
+    , iBytes(0)
+    , iPos(0)
+    , iWindow(nullptr)
+    , iWindowStart(0)
+    , iWindowBytes(0)
+    , iAdvisedEnd(0)
+    , iInterrupted(false)
+{
+#ifdef FILE_MAPPED_SUPPORTED
+    const long pageBytes = sysconf(_SC_PAGESIZE);
+    if (pageBytes > 0) {
+        iPageBytes = (TUint)pageBytes;
+    }
+#endif
+    ASSERT(iMaxWindowBytes > 0 && iMaxWindowBytes % iPageBytes == 0);
+}
+
+FileMapped::~FileMapped()
+{
+    Close();
+}
+
+TBool FileMapped::Open(const TChar* aPath)
+{
+    Close();
+#ifdef FILE_MAPPED_SUPPORTED
+    iFd = ::open(aPath, O_RDONLY);
+    if (iFd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (::fstat(iFd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        Close();
+        return false;
+    }
+    if (iFixedDisksOnly && !IsOnFixedDisk(iFd)) {
+        LOG(kMedia, "FileMapped::Open %s is not on a fixed disk, won't map it\n", aPath);
+        Close();
+        return false;
+    }
+    iBytes = (TUint64)st.st_size;
+    if (!MapWindow(0)) {
+        Close();
+        return false;
+    }
+    return true;
+#else
+    (void)aPath;
+    return false;
+#endif
+}
+
+void FileMapped::Close()
+{
+    Unmap();
+#ifdef FILE_MAPPED_SUPPORTED
+    if (iFd >= 0) {
+        (void)::close(iFd);
+    }
+#endif
+    iFd = -1;
+    iBytes = iPos = 0;
+}
+
+TUint64 FileMapped::Bytes() const
+{
+    return iBytes;
+}
+
+void FileMapped::Seek(TUint64 aOffset)
+{
+    iPos = aOffset; // Read() reports an error for any position beyond the end of the file
+    if (iPos >= iWindowStart && iPos < iWindowStart + iWindowBytes) {
+        // previous hints no longer follow the playback position
+        iAdvisedEnd = iPos;
+        AdviseReadAhead();
+    }
+    // otherwise the window is moved by the next Read()
+}
+
+void FileMapped::Interrupt(TBool aInterrupt)
+{
+    iInterrupted = aInterrupt;
+}
+
+Brn FileMapped::Read(TUint aBytes)
+{
+    if (iInterrupted || iPos >= iBytes) {
+        THROW(ReaderError);
+    }
+    if (iPos < iWindowStart || iPos >= iWindowStart + iWindowBytes) {
+        if (!MapWindow(iPos)) {
+            THROW(ReaderError);
+        }
+    }
+    const TUint offset = (TUint)(iPos - iWindowStart);
+    TUint bytes = iWindowBytes - offset;
+    if (aBytes < bytes) {
+        bytes = aBytes;
+    }
+    Brn buf(iWindow + offset, bytes);
+    iPos += bytes;
+    AdviseReadAhead();
+    return buf;
+}
+
+void FileMapped::ReadFlush()
+{
+}
+
+void FileMapped::ReadInterrupt()
+{
+    iInterrupted = true;
+}
+
+TBool FileMapped::MapWindow(TUint64 aOffset)
+{
+    Unmap();
+#ifdef FILE_MAPPED_SUPPORTED
+    // mapping beyond the end of a file that has shrunk since it was opened would fault on access
+    struct stat st;
+    if (::fstat(iFd, &st) != 0) {
+        return false;
+    }
+    if ((TUint64)st.st_size < iBytes) {
+        LOG_ERROR(kMedia, "FileMapped::MapWindow file truncated from %llu to %llu bytes\n", iBytes, (TUint64)st.st_size);
+        iBytes = (TUint64)st.st_size;
+    }
+    if (aOffset >= iBytes) {
+        return false;
+    }
+    const TUint64 start = aOffset - (aOffset % iPageBytes);
+    TUint64 bytes = iBytes - start;
+    if (bytes > iMaxWindowBytes) {
+        bytes = iMaxWindowBytes;
+    }
+    void* window = ::mmap(nullptr, (size_t)bytes, PROT_READ, MAP_SHARED, iFd, (off_t)start);
+    if (window == MAP_FAILED) {
+        LOG_ERROR(kMedia, "FileMapped::MapWindow failed to map %llu bytes at offset %llu\n", bytes, start);
+        return false;
+    }
+    // pages behind the read position are reclaimed early thanks to MADV_SEQUENTIAL
+    (void)::madvise(window, (size_t)bytes, MADV_SEQUENTIAL);
+    iWindow = static_cast<TByte*>(window);
+    iWindowStart = start;
+    iWindowBytes = (TUint)bytes;
+    iAdvisedEnd = aOffset;
+    AdviseReadAhead();
+    return true;
+#else
+    (void)aOffset;
+    return false;
+#endif
+}
+
+void FileMapped::Unmap()
+{
+#ifdef FILE_MAPPED_SUPPORTED
+    if (iWindow != nullptr) {
+        (void)::munmap(iWindow, iWindowBytes);
+    }
+#endif
+    iWindow = nullptr;
+    iWindowStart = 0;
+    iWindowBytes = 0;
+    iAdvisedEnd = 0;
+}
+
+void FileMapped::AdviseReadAhead()
+{
+    /* Ask for the next kReadAheadBytes to be paged in, topping the hint up each time
+       half of it has been consumed so that the disk stays ahead of playback. */
+    if (iWindow == nullptr || iPos + kReadAheadBytes / 2 < iAdvisedEnd) {
+        return;
+    }
+    const TUint64 windowEnd = iWindowStart + iWindowBytes;
+    TUint64 start = (iAdvisedEnd > iPos? iAdvisedEnd : iPos);
+    start -= (start % iPageBytes);
+    TUint64 end = iPos + kReadAheadBytes;
+    if (end > windowEnd) {
+        end = windowEnd;
+    }
+    if (start >= end) {
+        return;
+    }
+#ifdef FILE_MAPPED_SUPPORTED
+    (void)::madvise(iWindow + (start - iWindowStart), (size_t)(end - start), MADV_WILLNEED);
+#endif
+    iAdvisedEnd = end;
+}
+
+TBool FileMapped::IsOnFixedDisk(TInt aFd)
+{ // static
+#if defined(FILE_MAPPED_SUPPORTED) && defined(__linux__)
+    struct statfs fs;
+    if (::fstatfs(aFd, &fs) != 0) {
+        return false;
+    }
+    // network, fuse and the filesystems normally found on removable media (vfat, exfat etc.) are excluded
+    switch ((TUint)fs.f_type) {
+    case 0xEF53:        // ext2/3/4
+    case 0x58465342:    // xfs
+    case 0x9123683E:    // btrfs
+    case 0xF2F52010:    // f2fs
+    case 0x01021994:    // tmpfs
+    case 0x858458F6:    // ramfs
+    case 0x794C7630:    // overlayfs
+        break;
+    default:
+        return false;
+    }
+    struct stat st;
+    if (::fstat(aFd, &st) != 0) {
+        return false;
+    }
+    if (major(st.st_dev) == 0) {
+        return true; // not backed by a block device
+    }
+    // partitions report whether they're removable via their parent device
+    static const TChar* kRemovablePaths[] = { "/sys/dev/block/%u:%u/removable", "/sys/dev/block/%u:%u/../removable" };
+    for (auto format : kRemovablePaths) {
+        TChar path[64];
+        (void)snprintf(path, sizeof(path), format, (TUint)major(st.st_dev), (TUint)minor(st.st_dev));
+        FILE* file = fopen(path, "r");
+        if (file != nullptr) {
+            const int removable = fgetc(file);
+            (void)fclose(file);
+            return (removable == '0');
+        }
+    }
+    return true; // no sysfs; trust the filesystem type
+#elif defined(FILE_MAPPED_SUPPORTED)
+    struct statfs fs;
+    if (::fstatfs(aFd, &fs) != 0 || (fs.f_flags & MNT_LOCAL) == 0) {
+        return false;
+    }
+    // external and removable volumes are mounted under /Volumes
+    return (strncmp(fs.f_mntonname, "/Volumes/", 9) != 0);
+#else
+    (void)aFd;
+    return false;
+#endif
+}
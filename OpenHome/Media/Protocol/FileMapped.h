@@ -0,0 +1,71 @@
+#pragma once
+
+#include <OpenHome/Types.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Private/Standard.h>
+#include <OpenHome/Private/Stream.h>
+
+#include <atomic>
+
+#if defined(__linux__) || (defined(__APPLE__) && defined(__MACH__))
+# define FILE_MAPPED_SUPPORTED
+#endif
+
+namespace OpenHome {
+namespace Media {
+
+/**
+ * Reads a local file through a memory mapping, avoiding a read syscall and buffer copy per chunk.
+ *
+ * Read() returns pointers directly into the mapping so remains valid until the next call only.
+ * The file is mapped a window at a time so large files don't exhaust a 32-bit address space;
+ * seeks within the window are pointer moves only.
+ *
+ * Touching a mapped page that can't be read (a media error, a network filesystem going away or
+ * the file being truncated) raises SIGBUS rather than a ReaderError.  If aFixedDisksOnly is set,
+ * Open() therefore refuses files that aren't on a local, non-removable filesystem.  The file size
+ * is re-checked each time the window moves so a file truncated at a window boundary is reported
+ * as a ReaderError; truncation inside the current window is not detected.
+ *
+ * Open() fails on platforms without mmap (FILE_MAPPED_SUPPORTED undefined), for files that are
+ * empty or not regular files and, as above, for files not on a fixed disk.  Callers should fall
+ * back to FileStream.
+ */
+class FileMapped : public IReader, private INonCopyable
+{
+    static const TUint kReadAheadBytes = 1024 * 1024;
+public:
+    static const TUint kDefaultWindowBytes = 8 * 1024 * 1024;
+public:
+    FileMapped(TUint aWindowBytes, TBool aFixedDisksOnly);
+    ~FileMapped();
+    TBool Open(const TChar* aPath);
+    void Close();
+    TUint64 Bytes() const;
+    void Seek(TUint64 aOffset);
+    void Interrupt(TBool aInterrupt);
+public: // from IReader
+    Brn Read(TUint aBytes) override;
+    void ReadFlush() override;
+    void ReadInterrupt() override;
+private:
+    TBool MapWindow(TUint64 aOffset);
+    void Unmap();
+    void AdviseReadAhead();
+    static TBool IsOnFixedDisk(TInt aFd);
+private:
+    const TUint iMaxWindowBytes;
+    const TBool iFixedDisksOnly;
+    TInt iFd;
+    TUint iPageBytes;
+    TUint64 iBytes;
+    TUint64 iPos;
+    TByte* iWindow;
+    TUint64 iWindowStart;
+    TUint iWindowBytes;
+    TUint64 iAdvisedEnd;
+    std::atomic<bool> iInterrupted;
+};
+
+} // namespace Media
+} // namespace OpenHome
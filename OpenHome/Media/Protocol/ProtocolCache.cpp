@@ -0,0 +1,358 @@
+#include <OpenHome/Media/Protocol/ProtocolFactory.h>
+#include <OpenHome/Media/Protocol/Protocol.h>
+#include <OpenHome/Media/Protocol/StreamCache.h>
+#include <OpenHome/Exception.h>
+#include <OpenHome/Private/Debug.h>
+#include <OpenHome/Private/Stream.h>
+#include <OpenHome/Types.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Private/Uri.h>
+#include <OpenHome/Media/Debug.h>
+#include <OpenHome/Media/Supply.h>
+
+#include <atomic>
+
+namespace OpenHome {
+namespace Media {
+
+/* Streams uris from a StreamCache, avoiding any network access for the parts of a stream
+   that have been cached.  Must be added to the ProtocolManager ahead of any protocol that
+   fills the cache so that it is consulted first.
+   Each missing range costs a separate request (and likely a new connection) via
+   IProtocolManager::Get() so only streams that are complete or missing at most a few
+   small ranges are claimed.  Anything else is left to a protocol that streams from the
+   network, filling the cache as it does so. */
+class ProtocolCache : public Protocol, private IReader, private IWriter
+{
+    static const TUint kReadBytes = 8 * 1024;
+    static const TUint kMaxFetchBytes = 256 * 1024; // total missing from any stream we'll claim
+    static const TUint kMaxFetches = 4;             // max missing ranges in any stream we'll claim
+public:
+    ProtocolCache(Environment& aEnv, StreamCache& aCache);
+    ~ProtocolCache();
+private: // from Protocol
+    void Initialise(MsgFactory& aMsgFactory, IPipelineElementDownstream& aDownstream) override;
+    void Interrupt(TBool aInterrupt) override;
+    ProtocolStreamResult Stream(const Brx& aUri) override;
+    ProtocolGetResult Get(IWriter& aWriter, const Brx& aUri, TUint64 aOffset, TUint aBytes) override;
+private: // from IStreamHandler
+    TUint TrySeek(TUint aStreamId, TUint64 aOffset) override;
+    TUint TryStop(TUint aStreamId) override;
+private: // from IReader
+    Brn Read(TUint aBytes) override;
+    void ReadFlush() override;
+    void ReadInterrupt() override;
+private: // from IWriter
+    void Write(TByte aValue) override;
+    void Write(const Brx& aBuffer) override;
+    void WriteFlush() override;
+private:
+    static TBool WorthStreaming(const StreamCacheEntry& aEntry);
+    void Fetch();
+    TBool IsCurrentStream(TUint aStreamId) const;
+private:
+    Mutex iLock;
+    StreamCache& iCache;
+    Supply* iSupply;
+    Uri iUri;
+    StreamCacheEntry* iEntry;
+    Bws<kReadBytes> iReadBuf;
+    Bwh iFetchBuf;
+    TUint64 iFetchOffset;
+    TUint64 iOffset;
+    TUint iStreamId;
+    TBool iStop;
+    TBool iSeek;
+    TUint64 iSeekPos;
+    TUint iNextFlushId;
+    std::atomic<bool> iInterrupted;
+};
+
+};  // namespace Media
+};  // namespace OpenHome
+
+using namespace OpenHome;
+using namespace OpenHome::Media;
+
+
+Protocol* ProtocolFactory::NewCache(Environment& aEnv, StreamCache& aCache)
+{ // static
+    return new ProtocolCache(aEnv, aCache);
+}
+
+
+// ProtocolCache
+
+ProtocolCache::ProtocolCache(Environment& aEnv, StreamCache& aCache)
+    : Protocol(aEnv)
+    , iLock("PRTC")
+    , iCache(aCache)
+    , iSupply(nullptr)
+    , iEntry(nullptr)
+    , iFetchBuf(kMaxFetchBytes)
+    , iFetchOffset(0)
+    , iOffset(0)
+    , iStreamId(IPipelineIdProvider::kStreamIdInvalid)
+    , iStop(false)
+    , iSeek(false)
+    , iSeekPos(0)
+    , iNextFlushId(MsgFlush::kIdInvalid)
+    , iInterrupted(false)
+{
+}
+
+ProtocolCache::~ProtocolCache()
+{
+    delete iSupply;
+}
+
+void ProtocolCache::Initialise(MsgFactory& aMsgFactory, IPipelineElementDownstream& aDownstream)
+{
+    iSupply = new Supply(aMsgFactory, aDownstream);
+}
+
+void ProtocolCache::Interrupt(TBool aInterrupt)
+{
+    AutoMutex _(iLock);
+    if (iActive && aInterrupt) {
+        iStop = true;
+        iInterrupted = true;
+    }
+}
+
+ProtocolStreamResult ProtocolCache::Stream(const Brx& aUri)
+{
+    StreamCacheEntry* entry = iCache.Open(aUri);
+    if (entry == nullptr) {
+        return EProtocolErrorNotSupported;
+    }
+    if (!WorthStreaming(*entry)) {
+        // let another protocol stream (and cache) this from the network
+        iCache.Close(*entry);
+        return EProtocolErrorNotSupported;
+    }
+    LOG(kMedia, "ProtocolCache::Stream(%.*s)\n", PBUF(aUri));
+
+    iUri.Replace(aUri);
+    iLock.Wait();
+    iEntry = entry;
+    iStop = iSeek = false;
+    iSeekPos = 0;
+    iNextFlushId = MsgFlush::kIdInvalid;
+    iInterrupted = false;
+    iLock.Signal();
+    iOffset = 0;
+    iFetchOffset = 0;
+    iFetchBuf.SetBytes(0);
+
+    const TUint64 streamBytes = iEntry->StreamBytes();
+    iStreamId = iIdProvider->NextStreamId();
+    iSupply->OutputStream(iUri.AbsoluteUri(), streamBytes, 0, true, false, Multiroom::Allowed, *this, iStreamId);
+    ContentProcessor* contentProcessor = iProtocolManager->GetAudioProcessor();
+    TUint64 remaining = streamBytes;
+    ProtocolStreamResult res = EProtocolStreamErrorRecoverable;
+    while (res == EProtocolStreamErrorRecoverable) {
+        res = contentProcessor->Stream(*this, remaining);
+        AutoMutex _(iLock);
+        if (iStop) {
+            res = EProtocolStreamStopped;
+            if (iNextFlushId != MsgFlush::kIdInvalid) {
+                iSupply->OutputFlush(iNextFlushId);
+            }
+        }
+        else if (iSeek) {
+            res = EProtocolStreamErrorRecoverable;
+            iOffset = iSeekPos;
+            remaining = streamBytes - iSeekPos;
+            iSeek = false;
+            iInterrupted = false;
+            iSupply->OutputFlush(iNextFlushId);
+            iNextFlushId = MsgFlush::kIdInvalid;
+        }
+        else if (res == EProtocolStreamErrorRecoverable) {
+            // couldn't read from the cache or fetch a missing range
+            LOG(kMedia, "ProtocolCache::Stream failed at offset %llu\n", iOffset);
+            res = EProtocolStreamErrorUnrecoverable;
+        }
+    }
+
+    iLock.Wait();
+    iStreamId = IPipelineIdProvider::kStreamIdInvalid;
+    iEntry = nullptr;
+    iLock.Signal();
+    iCache.Close(*entry);
+    contentProcessor->Reset();
+    return res;
+}
+
+ProtocolGetResult ProtocolCache::Get(IWriter& aWriter, const Brx& aUri, TUint64 aOffset, TUint aBytes)
+{
+    StreamCacheEntry* entry = iCache.Open(aUri);
+    if (entry == nullptr) {
+        return EProtocolGetErrorNotSupported;
+    }
+    if (entry->BytesAvailable(aOffset) < aBytes) {
+        iCache.Close(*entry);
+        return EProtocolGetErrorNotSupported;
+    }
+    LOG(kMedia, "ProtocolCache::Get(%.*s, %llu, %u)\n", PBUF(aUri), aOffset, aBytes);
+    ProtocolGetResult res = EProtocolGetSuccess;
+    try {
+        TUint64 offset = aOffset;
+        TUint remaining = aBytes;
+        while (remaining > 0) {
+            entry->Read(offset, iReadBuf, remaining);
+            aWriter.Write(iReadBuf);
+            offset += iReadBuf.Bytes();
+            remaining -= iReadBuf.Bytes();
+        }
+    }
+    catch (ReaderError&) {
+        res = EProtocolGetErrorUnrecoverable;
+    }
+    catch (WriterError&) {
+        res = EProtocolGetErrorUnrecoverable;
+    }
+    iCache.Close(*entry);
+    return res;
+}
+
+TUint ProtocolCache::TrySeek(TUint aStreamId, TUint64 aOffset)
+{
+    AutoMutex _(iLock);
+    if (!IsCurrentStream(aStreamId) || aOffset >= iEntry->StreamBytes()) {
+        return MsgFlush::kIdInvalid;
+    }
+    iSeek = true;
+    iSeekPos = aOffset;
+    if (iNextFlushId == MsgFlush::kIdInvalid) {
+        iNextFlushId = iFlushIdProvider->NextFlushId();
+    }
+    iInterrupted = true;
+    return iNextFlushId;
+}
+
+TUint ProtocolCache::TryStop(TUint aStreamId)
+{
+    AutoMutex _(iLock);
+    if (!IsCurrentStream(aStreamId)) {
+        return MsgFlush::kIdInvalid;
+    }
+    if (iNextFlushId == MsgFlush::kIdInvalid) {
+        iNextFlushId = iFlushIdProvider->NextFlushId();
+    }
+    iStop = true;
+    iInterrupted = true;
+    return iNextFlushId;
+}
+
+Brn ProtocolCache::Read(TUint aBytes)
+{
+    if (iInterrupted) {
+        THROW(ReaderError);
+    }
+    // data from the most recent network fetch is served from memory in case the cache had no space for it
+    if (iOffset < iFetchOffset || iOffset >= iFetchOffset + iFetchBuf.Bytes()) {
+        if (iEntry->BytesAvailable(iOffset) > 0) {
+            iEntry->Read(iOffset, iReadBuf, aBytes);
+            iOffset += iReadBuf.Bytes();
+            return Brn(iReadBuf);
+        }
+        Fetch();
+    }
+    const TUint offset = (TUint)(iOffset - iFetchOffset);
+    TUint bytes = iFetchBuf.Bytes() - offset;
+    if (aBytes < bytes) {
+        bytes = aBytes;
+    }
+    iOffset += bytes;
+    return Brn(iFetchBuf.Ptr() + offset, bytes);
+}
+
+void ProtocolCache::ReadFlush()
+{
+}
+
+void ProtocolCache::ReadInterrupt()
+{
+    iInterrupted = true;
+}
+
+void ProtocolCache::Write(TByte aValue)
+{
+    Write(Brn(&aValue, 1));
+}
+
+void ProtocolCache::Write(const Brx& aBuffer)
+{
+    // receives data for Fetch()
+    if (iInterrupted) {
+        THROW(WriterError);
+    }
+    TUint bytes = aBuffer.Bytes();
+    if (bytes > iFetchBuf.BytesRemaining()) {
+        bytes = iFetchBuf.BytesRemaining();
+    }
+    const Brn data(aBuffer.Ptr(), bytes);
+    iEntry->Write(iFetchOffset + iFetchBuf.Bytes(), data);
+    iFetchBuf.Append(data);
+}
+
+void ProtocolCache::WriteFlush()
+{
+}
+
+TBool ProtocolCache::WorthStreaming(const StreamCacheEntry& aEntry)
+{ // static
+    const TUint64 streamBytes = aEntry.StreamBytes();
+    if (!aEntry.RangeFetchable()) {
+        return aEntry.BytesAvailable(0) >= streamBytes;
+    }
+    TUint64 missing = 0;
+    TUint fetches = 0;
+    TUint64 offset = 0;
+    for (;;) {
+        offset += aEntry.BytesAvailable(offset);
+        const TUint64 bytes = aEntry.BytesMissing(offset);
+        if (bytes == 0) {
+            return true;
+        }
+        missing += bytes;
+        if (missing > kMaxFetchBytes || ++fetches > kMaxFetches) {
+            return false;
+        }
+        offset += bytes;
+    }
+}
+
+void ProtocolCache::Fetch()
+{
+    TUint64 bytes = iEntry->BytesMissing(iOffset);
+    if (bytes == 0 || !iEntry->RangeFetchable()) {
+        THROW(ReaderError);
+    }
+    if (bytes > kMaxFetchBytes) {
+        bytes = kMaxFetchBytes;
+    }
+    LOG(kMedia, "ProtocolCache::Fetch %llu bytes from %llu\n", bytes, iOffset);
+    iFetchOffset = iOffset;
+    iFetchBuf.SetBytes(0);
+    try {
+        (void)iProtocolManager->Get(*this, iUri.AbsoluteUri(), iOffset, (TUint)bytes);
+    }
+    catch (WriterError&) {
+        THROW(ReaderError);
+    }
+    // a failed request may still have returned some of the data
+    if (iFetchBuf.Bytes() == 0) {
+        THROW(ReaderError);
+    }
+}
+
+TBool ProtocolCache::IsCurrentStream(TUint aStreamId) const
+{
+    if (iEntry == nullptr || iStreamId != aStreamId || aStreamId == IPipelineIdProvider::kStreamIdInvalid) {
+        return false;
+    }
+    return true;
+}
@@ -21,6 +21,7 @@ namespace Media {
 
 class Protocol;
 class IServerObserver;
+class StreamCache;
 
 class ProtocolFactory
 {
@@ -28,6 +29,8 @@ public:
     static Protocol* NewHls(Environment& aEnv, const Brx& aUserAgent);
     static Protocol* NewHttp(Environment& aEnv, const Brx& aUserAgent); // UA is optional so can be empty
     static Protocol* NewHttp(Environment& aEnv, const Brx& aUserAgent, IServerObserver& aServerObserver); // UA is optional so can be empty
+    static Protocol* NewHttp(Environment& aEnv, const Brx& aUserAgent, StreamCache& aCache); // UA is optional so can be empty
+    static Protocol* NewCache(Environment& aEnv, StreamCache& aCache); // add ahead of any protocols that fill aCache
     static Protocol* NewHttps(Environment& aEnv);
     static Protocol* NewFile(Environment& aEnv);
     static Protocol* NewTone(Environment& aEnv);
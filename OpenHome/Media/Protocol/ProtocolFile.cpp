@@ -1,5 +1,6 @@
 #include <OpenHome/Media/Protocol/ProtocolFactory.h>
 #include <OpenHome/Media/Protocol/Protocol.h>
+#include <OpenHome/Media/Protocol/FileMapped.h>
 #include <OpenHome/Exception.h>
 #include <OpenHome/Private/Debug.h>
 #include <OpenHome/Private/File.h>
@@ -12,6 +13,7 @@
 #include <OpenHome/Media/Supply.h>
 
 #include <stdlib.h>
+#include <limits>
 
 namespace OpenHome {
 namespace Media {
@@ -34,6 +36,9 @@ private: // from IReader
     void ReadFlush() override;
     void ReadInterrupt() override;
 private:
+    TBool OpenFile(const Brx& aPath);
+    void CloseFile();
+    void InterruptFile(TBool aInterrupt);
     TBool IsCurrentStream(TUint aStreamId) const;
 private:
     static const TUint kReadBufBytes = 6 * 1024;
@@ -43,11 +48,15 @@ private:
     FileStream iFileStream;
     Srs<kReadBufBytes> iReaderBuf;
     ContentRecogBuf iContentRecogBuf;
+    FileMapped iFileMapped;
+    ContentRecogBuf iContentRecogBufMapped;
+    ContentRecogBuf* iReader;
     TUint iStreamId;
     TBool iStop;
     TBool iSeek;
     TBool iFileOpen;
-    TUint32 iSeekPos;
+    TBool iMapped;
+    TUint64 iSeekPos;
     TUint iNextFlushId;
 };
 
@@ -72,6 +81,11 @@ ProtocolFile::ProtocolFile(Environment& aEnv)
     , iSupply(nullptr)
     , iReaderBuf(iFileStream)
     , iContentRecogBuf(iReaderBuf)
+    , iFileMapped(FileMapped::kDefaultWindowBytes, true)
+    , iContentRecogBufMapped(iFileMapped)
+    , iReader(&iContentRecogBuf)
+    , iFileOpen(false)
+    , iMapped(false)
 {
 }
 
@@ -89,7 +103,7 @@ void ProtocolFile::Interrupt(TBool aInterrupt)
 {
     iLock.Wait();
     if (aInterrupt) {
-        iFileStream.ReadInterrupt();
+        iReader->ReadInterrupt();
     }
     iLock.Signal();
 }
@@ -107,27 +121,18 @@ ProtocolStreamResult ProtocolFile::Stream(const Brx& aUri)
         LOG(kMedia, "ProtocolFile::Stream Scheme not recognised\n");
         return EProtocolErrorNotSupported;
     }
-    iContentRecogBuf.ReadFlush();
-    
-    Brhz pathBuf(iUri.Path());
-    TChar* path = pathBuf.Transfer();
-    try {
-        IFile* file = IFile::Open(path, eFileReadOnly);
-        iFileStream.SetFile(file);
-    }
-    catch (FileOpenError&) {
-        free(path);
+
+    if (!OpenFile(iUri.Path())) {
         return EProtocolStreamErrorUnrecoverable;
     }
-    iFileOpen = true;
-    free(path);
-    iFileStream.Interrupt(false);
-    const TUint fileSize = iFileStream.Bytes();
+    iReader->ReadFlush();
+    InterruptFile(false);
+    const TUint64 fileSize = (iMapped? iFileMapped.Bytes() : iFileStream.Bytes());
 
     ContentProcessor* contentProcessor = nullptr;
     try {
-        iContentRecogBuf.Populate(fileSize);
-        contentProcessor = iProtocolManager->GetContentProcessor(iUri.AbsoluteUri(), Brx::Empty(), iContentRecogBuf.Buffer());
+        iReader->Populate(fileSize);
+        contentProcessor = iProtocolManager->GetContentProcessor(iUri.AbsoluteUri(), Brx::Empty(), iReader->Buffer());
     }
     catch (ReaderError&) {
         return EProtocolStreamErrorRecoverable;
@@ -140,13 +145,20 @@ ProtocolStreamResult ProtocolFile::Stream(const Brx& aUri)
     iStreamId = iIdProvider->NextStreamId();
     iSupply->OutputStream(iUri.AbsoluteUri(), fileSize, iSeekPos, true, false, Multiroom::Allowed, *this, iStreamId);
     contentProcessor = iProtocolManager->GetAudioProcessor();
-    TUint remaining = fileSize;
+    TUint64 remaining = fileSize;
     while (res == EProtocolStreamErrorRecoverable) {
         res = contentProcessor->Stream(*this, remaining);
         iLock.Wait();
         if (iSeek) {
-            iFileStream.Interrupt(false);
-            iFileStream.Seek(iSeekPos);
+            InterruptFile(false);
+            if (iMapped) {
+                iFileMapped.Seek(iSeekPos);
+            }
+            else {
+                // TrySeek() rejects offsets FileStream can't reach
+                ASSERT(iSeekPos <= std::numeric_limits<TUint32>::max());
+                iFileStream.Seek((TUint32)iSeekPos);
+            }
             remaining = fileSize - iSeekPos;
             iSeek = false;
             iSeekPos = 0;
@@ -156,16 +168,16 @@ ProtocolStreamResult ProtocolFile::Stream(const Brx& aUri)
             res = EProtocolStreamStopped;
             iSupply->OutputFlush(iNextFlushId);
         }
-        else {
-            // don't expect any exceptions (other than the above ones we generate) when reading a local file
-            ASSERT(res == EProtocolStreamSuccess);
+        else if (res != EProtocolStreamSuccess) {
+            // the file was truncated or became unreadable while we streamed it
+            LOG_ERROR(kMedia, "ProtocolFile::Stream read failed for %.*s\n", PBUF(iUri.AbsoluteUri()));
+            res = EProtocolStreamErrorUnrecoverable;
         }
         iLock.Signal();
     }
 
     iLock.Wait();
-    iFileStream.CloseFile();
-    iFileOpen = false;
+    CloseFile();
     iStreamId = IPipelineIdProvider::kStreamIdInvalid;
     iLock.Signal();
     if (contentProcessor != nullptr) {
@@ -182,17 +194,18 @@ ProtocolGetResult ProtocolFile::Get(IWriter& /*aWriter*/, const Brx& /*aUri*/, T
 TUint ProtocolFile::TrySeek(TUint aStreamId, TUint64 aOffset)
 {
     iLock.Wait();
-    const TBool streamIsValid = IsCurrentStream(aStreamId);
+    // FileStream offsets are 32-bit; larger files are only seekable when mapped
+    const TBool streamIsValid = IsCurrentStream(aStreamId) && (iMapped || aOffset <= std::numeric_limits<TUint32>::max());
     if (streamIsValid) {
         iSeek = true;
-        iSeekPos = (TUint32)aOffset;
+        iSeekPos = aOffset;
         iNextFlushId = iFlushIdProvider->NextFlushId();
     }
     iLock.Signal();
     if (!streamIsValid) {
         return MsgFlush::kIdInvalid;
     }
-    iFileStream.ReadInterrupt();
+    iReader->ReadInterrupt();
     return iNextFlushId;
 }
 
@@ -203,7 +216,7 @@ TUint ProtocolFile::TryStop(TUint aStreamId)
     if (stop) {
         iNextFlushId = iFlushIdProvider->NextFlushId();
         iStop = true;
-        iFileStream.ReadInterrupt();
+        iReader->ReadInterrupt();
     }
     iLock.Signal();
     if (!stop) {
@@ -214,17 +227,60 @@ TUint ProtocolFile::TryStop(TUint aStreamId)
 
 Brn ProtocolFile::Read(TUint aBytes)
 {
-    return iContentRecogBuf.Read(aBytes);
+    return iReader->Read(aBytes);
 }
 
 void ProtocolFile::ReadFlush()
 {
-    iContentRecogBuf.ReadFlush();
+    iReader->ReadFlush();
 }
 
 void ProtocolFile::ReadInterrupt()
 {
-    iContentRecogBuf.ReadInterrupt();
+    iReader->ReadInterrupt();
+}
+
+TBool ProtocolFile::OpenFile(const Brx& aPath)
+{
+    Brhz pathBuf(aPath);
+    TChar* path = pathBuf.Transfer();
+    AutoMutex _(iLock);
+    iMapped = iFileMapped.Open(path);
+    if (!iMapped) {
+        try {
+            IFile* file = IFile::Open(path, eFileReadOnly);
+            iFileStream.SetFile(file);
+        }
+        catch (FileOpenError&) {
+            free(path);
+            return false;
+        }
+    }
+    free(path);
+    iReader = (iMapped? &iContentRecogBufMapped : &iContentRecogBuf);
+    iFileOpen = true;
+    return true;
+}
+
+void ProtocolFile::CloseFile()
+{
+    if (iMapped) {
+        iFileMapped.Close();
+    }
+    else {
+        iFileStream.CloseFile();
+    }
+    iFileOpen = false;
+}
+
+void ProtocolFile::InterruptFile(TBool aInterrupt)
+{
+    if (iMapped) {
+        iFileMapped.Interrupt(aInterrupt);
+    }
+    else {
+        iFileStream.Interrupt(aInterrupt);
+    }
 }
 
 TBool ProtocolFile::IsCurrentStream(TUint aStreamId) const
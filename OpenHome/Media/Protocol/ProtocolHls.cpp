@@ -18,6 +18,7 @@
 #include <OpenHome/OsWrapper.h>
 
 #include <algorithm>
+#include <cstring>
 
 namespace OpenHome {
 namespace Media {
@@ -36,6 +37,8 @@ private: // from Protocol
     EStreamPlay OkToPlay(TUint aStreamId) override;
     TUint TrySeek(TUint aStreamId, TUint64 aOffset) override;
     TUint TryStop(TUint aStreamId) override;
+private:
+    static const TUint kConnectRetryIntervalMs = 1 * 1000;
 private:
     void Reinitialise();
     void StartStream(const Uri& aUri);
@@ -48,6 +51,7 @@ private:
     PlaylistProvider iPlaylistProvider;
     HlsReloadTimer iReloadTimer;
     HlsM3uReader iM3uReader;
+    UriLoader iSegmentLoader;
     SegmentProvider iSegmentProvider;
     SegmentStreamer iSegmentStreamer;
     TUint iStreamId;
@@ -903,41 +907,369 @@ void PlaylistProvider::InterruptPlaylistProvider(TBool aInterrupt)
 
 // SegmentProvider
 
-SegmentProvider::SegmentProvider(Environment& aEnv, const Brx& aUserAgent, ITimerFactory& aTimerFactory, ISegmentUriProvider& aProvider)
-    : iLoader(aEnv, aUserAgent, aTimerFactory, kConnectRetryIntervalMs)
+SegmentProvider::SegmentProvider(IUriLoader& aLoader, ISegmentUriProvider& aProvider)
+    : iLoader(aLoader)
     , iProvider(aProvider)
+    , iBuffer(kBufferBytes)
+    , iSegmentHead(0)
+    , iSegmentCount(0)
+    , iSegmentFetching(0)
+    , iReadIndex(0)
+    , iBytesBuffered(0)
+    , iBytesToRelease(0)
+    , iPrefetchedMs(0)
+    , iTargetDurationMs(0)
+    , iMaxSegmentBytes(0)
+    , iSegmentsTaken(0)
+    , iSegmentsStarted(0)
+    , iReading(false)
+    , iActive(false)
+    , iStopping(false)
+    , iEnded(false)
+    , iEndOfStream(false)
+    , iInterrupted(false)
+    , iLock("SEGP")
+    , iSemData("SEGD", 0)
+    , iSemSpace("SEGS", 0)
+    , iSemIdle("SEGI", 0)
 {
+    iThread = new ThreadFunctor("HlsPrefetch", MakeFunctor(*this, &SegmentProvider::PrefetchThread));
+    iThread->Start();
+}
+
+SegmentProvider::~SegmentProvider()
+{
+    StopPrefetching();
+    delete iThread;
 }
 
 void SegmentProvider::Reset()
 {
+    LOG(kMedia, "SegmentProvider::Reset\n");
+    StopPrefetching();
     iLoader.Reset();
+
+    AutoMutex _(iLock);
+    iSegmentHead = 0;
+    iSegmentCount = 0;
+    iReadIndex = 0;
+    iBytesBuffered = 0;
+    iBytesToRelease = 0;
+    iPrefetchedMs = 0;
+    iTargetDurationMs = 0;
+    iMaxSegmentBytes = 0;
+    iReading = false;
+    iEnded = false;
+    iEndOfStream = false;
+}
+
+TUint SegmentProvider::SegmentsDiscarded() const
+{
+    AutoMutex _(iLock);
+    return iSegmentsTaken - iSegmentsStarted;
 }
 
 IReader& SegmentProvider::NextSegment()
 {
-    try {
-        Uri uri;
-        iProvider.NextSegmentUri(uri);
-        return iLoader.Load(uri);
+    iLock.Wait();
+    ReleaseRead();
+    if (iReading) {
+        DiscardCurrentSegment();
     }
-    catch (const HlsSegmentUriError&) {
-        // From NextSegmentUri().
-        THROW(HlsSegmentError);
+    if (!iActive && !iEnded) {
+        iActive = true;
+        iSegmentsTaken = 0;
+        iSegmentsStarted = 0;
+        iThread->Signal();
+    }
+
+    for (;;) {
+        if (iInterrupted) {
+            iLock.Signal();
+            THROW(HlsSegmentError);
+        }
+        if (iSegmentCount > 0) {
+            Segment& segment = iSegments[iSegmentHead];
+            if (segment.iLoaded) {
+                iReading = true;
+                iSegmentsStarted++;
+                iPrefetchedMs -= segment.iDurationMs;
+                iSemSpace.Signal();
+                iLock.Signal();
+                return *this;
+            }
+            else if (segment.iFailed) {
+                iLock.Signal();
+                THROW(HlsSegmentError);
+            }
+        }
+        else if (iEnded) {
+            const TBool endOfStream = iEndOfStream;
+            iLock.Signal();
+            if (endOfStream) {
+                THROW(HlsEndOfStream);
+            }
+            THROW(HlsSegmentError);
+        }
+        (void)iSemData.Clear();
+        iLock.Signal();
+        iSemData.Wait();
+        iLock.Wait();
+    }
+}
+
+void SegmentProvider::InterruptSegmentProvider(TBool aInterrupt)
+{
+    LOG(kMedia, "SegmentProvider::InterruptSegmentProvider aInterrupt: %u\n", aInterrupt);
+    // Only interrupts the reader. Prefetching is stopped by Reset().
+    AutoMutex _(iLock);
+    iInterrupted = aInterrupt;
+    iSemData.Signal();
+}
+
+Brn SegmentProvider::Read(TUint aBytes)
+{
+    iLock.Wait();
+    ReleaseRead();
+    if (!iReading) {
+        iLock.Signal();
+        THROW(ReaderError);
+    }
+
+    for (;;) {
+        if (iInterrupted) {
+            iLock.Signal();
+            THROW(ReaderError);
+        }
+        const Segment& segment = iSegments[iSegmentHead];
+        if (segment.iBytes > 0) {
+            // Bytes remain in the buffer until the next call, so are only released then.
+            TUint bytes = std::min(aBytes, segment.iBytes);
+            bytes = std::min(bytes, kBufferBytes - iReadIndex);
+            iBytesToRelease = bytes;
+            Brn buf(iBuffer.Ptr() + iReadIndex, bytes);
+            iLock.Signal();
+            return buf;
+        }
+        else if (segment.iComplete) {
+            iLock.Signal();
+            return Brx::Empty();
+        }
+        else if (segment.iFailed) {
+            iLock.Signal();
+            THROW(ReaderError);
+        }
+        (void)iSemData.Clear();
+        iLock.Signal();
+        iSemData.Wait();
+        iLock.Wait();
+    }
+}
+
+void SegmentProvider::ReadFlush()
+{
+    // Segment is discarded by NextSegment(), as with the socket used prior to prefetching.
+    AutoMutex _(iLock);
+    ReleaseRead();
+}
+
+void SegmentProvider::ReadInterrupt()
+{
+    // Interrupts are passed on via InterruptSegmentProvider().
+}
+
+void SegmentProvider::StopPrefetching()
+{
+    {
+        AutoMutex _(iLock);
+        if (!iActive) {
+            return;
+        }
+        iStopping = true;
+        (void)iSemIdle.Clear();
+    }
+    LOG(kMedia, "SegmentProvider::StopPrefetching\n");
+    iLoader.Interrupt(true);
+    iProvider.InterruptSegmentUriProvider(true);
+    iSemSpace.Signal();
+    iSemIdle.Wait();
+    iProvider.InterruptSegmentUriProvider(false);
+    iLoader.Interrupt(false);
+
+    AutoMutex _(iLock);
+    iStopping = false;
+}
+
+void SegmentProvider::ReleaseRead()
+{
+    if (iBytesToRelease > 0) {
+        iSegments[iSegmentHead].iBytes -= iBytesToRelease;
+        iReadIndex = (iReadIndex + iBytesToRelease) % kBufferBytes;
+        iBytesBuffered -= iBytesToRelease;
+        iBytesToRelease = 0;
+        iSemSpace.Signal();
+    }
+}
+
+void SegmentProvider::DiscardCurrentSegment()
+{
+    // Segment may still be downloading. Any further content is dropped by Prefetch().
+    Segment& segment = iSegments[iSegmentHead];
+    iReadIndex = (iReadIndex + segment.iBytes) % kBufferBytes;
+    iBytesBuffered -= segment.iBytes;
+    segment.iBytes = 0;
+    segment.iDiscarded = true;
+    iSegmentHead = (iSegmentHead + 1) % kMaxSegments;
+    iSegmentCount--;
+    iReading = false;
+    iSemSpace.Signal();
+}
+
+void SegmentProvider::PrefetchThread()
+{
+    for (;;) {
+        iThread->Wait();
+        Prefetch();
+    }
+}
+
+void SegmentProvider::Prefetch()
+{
+    LOG(kMedia, ">SegmentProvider::Prefetch\n");
+    TBool endOfStream = false;
+    try {
+        while (WaitForSegmentSlot()) {
+            // May block waiting to reload playlist.
+            Uri uri;
+            const TUint durationMs = iProvider.NextSegmentUri(uri);
+            const TUint targetDurationMs = iProvider.TargetDurationMs();
+            {
+                AutoMutex _(iLock);
+                iTargetDurationMs = targetDurationMs;
+                iSegmentFetching = (iSegmentHead + iSegmentCount) % kMaxSegments;
+                Segment& segment = iSegments[iSegmentFetching];
+                segment.iDurationMs = durationMs;
+                segment.iBytes = 0;
+                segment.iLoaded = false;
+                segment.iComplete = false;
+                segment.iFailed = false;
+                segment.iDiscarded = false;
+                iSegmentCount++;
+                iSegmentsTaken++;
+                iPrefetchedMs += durationMs;
+            }
+
+            // iLoader reuses its connection for successive segments where the server allows.
+            auto& reader = iLoader.Load(uri);
+            {
+                AutoMutex _(iLock);
+                iSegments[iSegmentFetching].iLoaded = true;
+                iSemData.Signal();
+            }
+            TUint segmentBytes = 0;
+            while (WaitForBufferSpace()) {
+                TUint writeIndex;
+                TUint bytes;
+                {
+                    AutoMutex _(iLock);
+                    writeIndex = (iReadIndex + iBytesBuffered) % kBufferBytes;
+                    bytes = std::min(kBufferBytes - iBytesBuffered, kBufferBytes - writeIndex);
+                }
+                if (bytes > kMaxReadBytes) {
+                    bytes = kMaxReadBytes;
+                }
+                const Brn buf = reader.Read(bytes);
+                if (buf.Bytes() == 0) {
+                    break;
+                }
+                segmentBytes += buf.Bytes();
+                // Free space can't be claimed by anything else so is safe to write to without holding iLock.
+                (void)memcpy(const_cast<TByte*>(iBuffer.Ptr()) + writeIndex, buf.Ptr(), buf.Bytes());
+
+                AutoMutex _(iLock);
+                Segment& segment = iSegments[iSegmentFetching];
+                if (!segment.iDiscarded) {
+                    segment.iBytes += buf.Bytes();
+                    iBytesBuffered += buf.Bytes();
+                    iSemData.Signal();
+                }
+            }
+            reader.ReadFlush();
+
+            AutoMutex _(iLock);
+            iSegments[iSegmentFetching].iComplete = true;
+            iMaxSegmentBytes = std::max(iMaxSegmentBytes, segmentBytes);
+            iSemData.Signal();
+        }
     }
     catch (const HlsEndOfStream&) {
-        // From NextSegmentUri().
-        throw;
+        LOG(kMedia, "SegmentProvider::Prefetch caught HlsEndOfStream\n");
+        endOfStream = true;
+    }
+    catch (const HlsSegmentUriError&) {
+        LOG(kMedia, "SegmentProvider::Prefetch caught HlsSegmentUriError\n");
     }
     catch (const UriLoaderError&) {
-        // From Load().
-        THROW(HlsSegmentError);
+        LOG(kMedia, "SegmentProvider::Prefetch caught UriLoaderError\n");
+        AutoMutex _(iLock);
+        iSegments[iSegmentFetching].iFailed = true;
+    }
+    catch (const ReaderError&) {
+        LOG(kMedia, "SegmentProvider::Prefetch caught ReaderError\n");
+        AutoMutex _(iLock);
+        iSegments[iSegmentFetching].iFailed = true;
     }
+
+    AutoMutex _(iLock);
+    iEnded = true;
+    iEndOfStream = endOfStream;
+    iActive = false;
+    iSemData.Signal();
+    iSemIdle.Signal();
+    LOG(kMedia, "<SegmentProvider::Prefetch iStopping: %u\n", iStopping);
 }
 
-void SegmentProvider::InterruptSegmentProvider(TBool aInterrupt)
+TBool SegmentProvider::CanPrefetch() const
 {
-    iLoader.Interrupt(aInterrupt);
+    // Called with iLock held.
+    if (iSegmentCount == 0) {
+        return true;
+    }
+    if (iSegmentCount == kMaxSegments) {
+        return false;
+    }
+    if (iTargetDurationMs > 0 && iPrefetchedMs >= kPrefetchTargetDurations * iTargetDurationMs) {
+        return false;
+    }
+    return iBytesBuffered + iMaxSegmentBytes <= kBufferBytes;
+}
+
+TBool SegmentProvider::WaitForSegmentSlot()
+{
+    iLock.Wait();
+    while (!iStopping && !CanPrefetch()) {
+        (void)iSemSpace.Clear();
+        iLock.Signal();
+        iSemSpace.Wait();
+        iLock.Wait();
+    }
+    const TBool stopping = iStopping;
+    iLock.Signal();
+    return !stopping;
+}
+
+TBool SegmentProvider::WaitForBufferSpace()
+{
+    iLock.Wait();
+    while (!iStopping && iBytesBuffered == kBufferBytes) {
+        (void)iSemSpace.Clear();
+        iLock.Signal();
+        iSemSpace.Wait();
+        iLock.Wait();
+    }
+    const TBool stopping = iStopping;
+    iLock.Signal();
+    return !stopping;
 }
 
 
@@ -1410,6 +1742,11 @@ TUint HlsM3uReader::NextSegmentUri(Uri& aUri)
     }
 }
 
+TUint HlsM3uReader::TargetDurationMs() const
+{
+    return iParser.TargetDurationMs();
+}
+
 void HlsM3uReader::InterruptSegmentUriProvider(TBool aInterrupt)
 {
     LOG(kMedia, "HlsM3uReader::InterruptSegmentUriProvider aInterrupt: %u\n", aInterrupt);
@@ -1586,7 +1923,8 @@ ProtocolHls::ProtocolHls(Environment& aEnv, const Brx& aUserAgent)
     , iPlaylistProvider(aEnv, aUserAgent, iTimerFactory)
     , iReloadTimer(aEnv, iTimerFactory)
     , iM3uReader(iPlaylistProvider, iReloadTimer)
-    , iSegmentProvider(aEnv, aUserAgent, iTimerFactory, iM3uReader)
+    , iSegmentLoader(aEnv, aUserAgent, iTimerFactory, kConnectRetryIntervalMs)
+    , iSegmentProvider(iSegmentLoader, iM3uReader)
     , iSegmentStreamer(iSegmentProvider)
     , iSem("PRTH", 0)
     , iLock("PRHL")
@@ -1713,6 +2051,8 @@ ProtocolStreamResult ProtocolHls::Stream(const Brx& aUri)
 
         // This will only return EProtocolStreamErrorRecoverable for live streams (i.e., streams of length 0)!
         res = iContentProcessor->Stream(iSegmentStreamer, 0);
+        // Stop prefetching, which is otherwise still using iM3uReader from another thread.
+        iSegmentProvider.Reset();
 
         // Check for context of above method returning.
         // i.e., identify whether it was actually caused by:
@@ -1767,10 +2107,10 @@ ProtocolStreamResult ProtocolHls::Stream(const Brx& aUri)
             }
 
             // Clear all stream handlers.
-            iSegmentProvider.Reset();
+            // Segments that were prefetched but never played are fetched again.
             iSegmentStreamer.Reset();
             iPlaylistProvider.Reset();
-            const auto lastSegment = iM3uReader.LastSegment();
+            const auto lastSegment = iM3uReader.LastSegment() - iSegmentProvider.SegmentsDiscarded();
             iM3uReader.Reset();
 
             // There is no flush pending, and iStreamId has been cleared (so no
@@ -1822,6 +2162,7 @@ void ProtocolHls::Deactivated()
         iContentProcessor->Reset();
         iContentProcessor = nullptr;
     }
+    iSegmentProvider.Reset();
     iSegmentStreamer.Reset();
     iM3uReader.Reset();
 }
@@ -5,6 +5,7 @@
 #include <OpenHome/Private/Http.h>
 #include <OpenHome/Buffer.h>
 #include <OpenHome/Private/Uri.h>
+#include <OpenHome/Private/Thread.h>
 #include <OpenHome/Media/Supply.h>
 
 #include <algorithm>
@@ -55,6 +56,10 @@ public:
      * THROWS HlsSegmentUriError, HlsEndOfStream.
      */
     virtual TUint NextSegmentUri(Uri& aUri) = 0;
+    /*
+     * Target duration of the playlist that the last URI was returned from, or 0 if unknown.
+     */
+    virtual TUint TargetDurationMs() const = 0;
     virtual void InterruptSegmentUriProvider(TBool aInterrupt) = 0;
     virtual ~ISegmentUriProvider() {}
 };
@@ -282,14 +287,27 @@ private:
     TBool iEnabled;
 };
 
-class UriLoader
+class IUriLoader
+{
+public:
+    /*
+     * IReader remains valid until the next call to Load() or Reset().
+     */
+    virtual IReader& Load(const Uri& aUri) = 0; // THROWS UriLoaderError
+    virtual void Reset() = 0;
+    virtual void Interrupt(TBool aInterrupt) = 0;
+    virtual ~IUriLoader() {}
+};
+
+class UriLoader : public IUriLoader
 {
 public:
     UriLoader(Environment& aEnv, const Brx& aUserAgent, ITimerFactory& aTimerFactory, TUint aRetryInterval);
     ~UriLoader();
-    IReader& Load(const Uri& aUri); // THROWS UriLoaderError
-    void Reset();
-    void Interrupt(TBool aInterrupt);
+public: // from IUriLoader
+    IReader& Load(const Uri& aUri) override;
+    void Reset() override;
+    void Interrupt(TBool aInterrupt) override;
 private:
     HttpSocket iSocket;
     const TUint iRetryInterval;
@@ -318,19 +336,84 @@ private:
     Uri iUri;
 };
 
-class SegmentProvider : public ISegmentProvider
+/*
+ * Downloads segments ahead of playback on a background thread.
+ *
+ * URIs are pulled from aProvider (so any playlist reloads also happen on that thread) and segment content is buffered in a bounded ring buffer, with segments fetched one after another over a single keep-alive connection.
+ * Segments are prefetched until those not yet returned from NextSegment() cover kPrefetchTargetDurations of the playlist's target duration, or until another segment of the largest size seen so far would not fit in the buffer.
+ *
+ * Prefetching starts on the first call to NextSegment() after Reset(). Reset() must be called before the owner resets aProvider.
+ */
+class SegmentProvider : public ISegmentProvider, private IReader
 {
+public:
+    static const TUint kBufferBytes = 512 * 1024;
+    static const TUint kPrefetchTargetDurations = 3;
 private:
-    static const TUint kConnectRetryIntervalMs = 1 * 1000;
+    static const TUint kMaxSegments = 32;   // ring capacity, including segment currently being read
+    static const TUint kMaxReadBytes = 16 * 1024;
 public:
-    SegmentProvider(Environment& aEnv, const Brx& aUserAgent, ITimerFactory& aTimerFactory, ISegmentUriProvider& aProvider);
+    SegmentProvider(IUriLoader& aLoader, ISegmentUriProvider& aProvider);
+    ~SegmentProvider();
     void Reset();
+    /*
+     * Number of segments whose URIs were retrieved from aProvider but which were discarded by Reset() before being returned from NextSegment().
+     */
+    TUint SegmentsDiscarded() const;
 public: // from ISegmentProvider
     IReader& NextSegment() override;
     void InterruptSegmentProvider(TBool aInterrupt) override;
+private: // from IReader
+    Brn Read(TUint aBytes) override;
+    void ReadFlush() override;
+    void ReadInterrupt() override;
 private:
-    UriLoader iLoader;
+    class Segment
+    {
+    public:
+        TUint iDurationMs;
+        TUint iBytes;       // buffered and not yet read
+        TBool iLoaded;      // response received; content may follow
+        TBool iComplete;
+        TBool iFailed;
+        TBool iDiscarded;   // reader moved on before download completed
+    };
+private:
+    void StopPrefetching();
+    void ReleaseRead();
+    void DiscardCurrentSegment();
+    void PrefetchThread();
+    void Prefetch();
+    TBool CanPrefetch() const;
+    TBool WaitForSegmentSlot();     // WaitFor... methods return false if prefetching should stop
+    TBool WaitForBufferSpace();
+private:
+    IUriLoader& iLoader;
     ISegmentUriProvider& iProvider;
+    Bwh iBuffer;
+    Segment iSegments[kMaxSegments];
+    TUint iSegmentHead;
+    TUint iSegmentCount;
+    TUint iSegmentFetching;
+    TUint iReadIndex;
+    TUint iBytesBuffered;
+    TUint iBytesToRelease;
+    TUint iPrefetchedMs;
+    TUint iTargetDurationMs;
+    TUint iMaxSegmentBytes;
+    TUint iSegmentsTaken;
+    TUint iSegmentsStarted;
+    TBool iReading;
+    TBool iActive;
+    TBool iStopping;
+    TBool iEnded;
+    TBool iEndOfStream;
+    TBool iInterrupted;
+    mutable Mutex iLock;
+    Semaphore iSemData;
+    Semaphore iSemSpace;
+    Semaphore iSemIdle;
+    ThreadFunctor* iThread;
 };
 
 class SegmentDescriptor
@@ -458,6 +541,7 @@ public:
     TUint64 LastSegment() const;
 public: // from ISegmentUriProvider
     TUint NextSegmentUri(Uri& aUri) override;
+    TUint TargetDurationMs() const override;
     void InterruptSegmentUriProvider(TBool aInterrupt) override;
 private:
     void ReloadVariantPlaylist();
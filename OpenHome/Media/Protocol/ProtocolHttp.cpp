@@ -13,6 +13,7 @@
 #include <OpenHome/Private/Ascii.h>
 #include <OpenHome/Media/SupplyAggregator.h>
 #include <OpenHome/Media/Protocol/Icy.h>
+#include <OpenHome/Media/Protocol/StreamCache.h>
 
 #include <algorithm>
 
@@ -40,14 +41,15 @@ class ProtocolHttp : public Protocol , private IReader , private IIcyObserver
 {
     static const Brn kSchemeHttp;
     static const Brn kSchemeHttps;
-    static const TUint kReadBufferBytes = 6 * 1024;
+    static const TUint kReadBufferBytes = 32 * 1024;
+    static const TUint kMaxReadAheadBytes = 1024 * 1024; // forward seeks within this distance read ahead on the current connection
     static const TUint kWriteBufferBytes = 1024;
     static const TUint kConnectTimeoutMs = 3000;
     static const TUint kMaxUserAgentBytes = 64;
     static const TUint kMaxContentRecognitionBytes = 100;
 public:
     ProtocolHttp(Environment& aEnv, const Brx& aUserAgent);
-    ProtocolHttp(Environment& aEnv, const Brx& aUserAgent, Optional<IServerObserver> aServerObserver);
+    ProtocolHttp(Environment& aEnv, const Brx& aUserAgent, Optional<IServerObserver> aServerObserver, Optional<StreamCache> aCache);
     ~ProtocolHttp();
 private: // from Protocol
     void Initialise(MsgFactory& aMsgFactory, IPipelineElementDownstream& aDownstream) override;
@@ -69,14 +71,20 @@ private:
     TBool Connect(const Uri& aUri);
     TInt PortFromUri(const Uri& aUri) const;
     void Close();
+    TBool CanReuseConnection(const Uri& aUri) const;
+    TBool ConnectionIdle() const;
     void Reinitialise(const Brx& aUri);
     ProtocolStreamResult DoStream();
     ProtocolGetResult DoGet(IWriter& aWriter, TUint64 aOffset, TUint aBytes);
     ProtocolStreamResult DoSeek(TUint64 aOffset);
+    TBool TryReadAhead(TUint64 aOffset);
     ProtocolStreamResult DoLiveStream();
     void StartStream();
     TUint WriteRequest(TUint64 aOffset);
+    TUint SendRequest(TUint64 aOffset);
     ProtocolStreamResult ProcessContent();
+    void OpenCacheEntry();
+    void CloseCacheEntry();
     TBool ContinueStreaming(ProtocolStreamResult aResult);
     TBool IsCurrentStream(TUint aStreamId) const;
 private:
@@ -95,11 +103,18 @@ private:
     HttpHeaderContentLength iHeaderContentLength;
     HttpHeaderLocation iHeaderLocation;
     HttpHeaderTransferEncoding iHeaderTransferEncoding;
+    HttpHeaderConnection iHeaderConnection;
     HeaderIcyMetadata iHeaderIcyMetadata;
     HeaderServer iHeaderServer;
     Bws<kMaxUserAgentBytes> iUserAgent;
     IcyObserverDidlLite* iIcyObserverDidlLite;
     Uri iUri;
+    Bws<Uri::kMaxUriBytes> iConnectedHost;
+    TInt iConnectedPort;
+    TBool iConnectedSecure;
+    TBool iConnected;
+    TBool iKeepAlive;
+    TUint64 iBodyRemaining; // only valid if iKeepAlive
     TUint64 iTotalStreamBytes;
     TUint64 iTotalBytes;
     TUint iStreamId;
@@ -115,6 +130,10 @@ private:
     TUint iNextFlushId;
     Semaphore iSem;
     Optional<IServerObserver> iServerObserver;
+    Optional<StreamCache> iCache;
+    StreamCacheEntry* iCacheEntry;
+    Bws<Uri::kMaxUriBytes> iCacheUri; // uri before any redirection
+    TBool iRedirected;
 };
 
 };  // namespace Media
@@ -131,7 +150,12 @@ Protocol* ProtocolFactory::NewHttp(Environment& aEnv, const Brx& aUserAgent)
 
 Protocol* ProtocolFactory::NewHttp(Environment& aEnv, const Brx& aUserAgent, IServerObserver& aServerObserver)
 { // static
-    return new ProtocolHttp(aEnv, aUserAgent, aServerObserver);
+    return new ProtocolHttp(aEnv, aUserAgent, aServerObserver, nullptr);
+}
+
+Protocol* ProtocolFactory::NewHttp(Environment& aEnv, const Brx& aUserAgent, StreamCache& aCache)
+{ // static
+    return new ProtocolHttp(aEnv, aUserAgent, nullptr, aCache);
 }
 
 // HeaderServer
@@ -201,12 +225,12 @@ const Brn ProtocolHttp::kSchemeHttp("http");
 const Brn ProtocolHttp::kSchemeHttps("https");
 
 ProtocolHttp::ProtocolHttp(Environment& aEnv, const Brx& aUserAgent)
-    : ProtocolHttp(aEnv, aUserAgent, nullptr)
+    : ProtocolHttp(aEnv, aUserAgent, nullptr, nullptr)
 {
 
 }
 
-ProtocolHttp::ProtocolHttp(Environment& aEnv, const Brx& aUserAgent, Optional<IServerObserver> aServerObserver)
+ProtocolHttp::ProtocolHttp(Environment& aEnv, const Brx& aUserAgent, Optional<IServerObserver> aServerObserver, Optional<StreamCache> aCache)
     : Protocol(aEnv)
     , iLock("PHTP")
     , iSocket(aEnv, kReadBufferBytes)
@@ -219,12 +243,20 @@ ProtocolHttp::ProtocolHttp(Environment& aEnv, const Brx& aUserAgent, Optional<IS
     , iDechunker(iReaderUntil)
     , iContentRecogBuf(iDechunker)
     , iUserAgent(aUserAgent)
+    , iConnectedPort(0)
+    , iConnectedSecure(false)
+    , iConnected(false)
+    , iKeepAlive(false)
+    , iBodyRemaining(0)
     , iTotalStreamBytes(0)
     , iTotalBytes(0)
     , iStreamId(IPipelineIdProvider::kStreamIdInvalid)
     , iSeekable(false)
     , iSem("PRTH", 0)
     , iServerObserver(aServerObserver)
+    , iCache(aCache)
+    , iCacheEntry(nullptr)
+    , iRedirected(false)
 {
     iIcyObserverDidlLite = new IcyObserverDidlLite(*this);
     iReaderIcy = new ReaderIcy(iContentRecogBuf, *iIcyObserverDidlLite, iOffset);
@@ -233,6 +265,7 @@ ProtocolHttp::ProtocolHttp(Environment& aEnv, const Brx& aUserAgent, Optional<IS
     iReaderResponse.AddHeader(iHeaderContentLength);
     iReaderResponse.AddHeader(iHeaderLocation);
     iReaderResponse.AddHeader(iHeaderTransferEncoding);
+    iReaderResponse.AddHeader(iHeaderConnection);
     iReaderResponse.AddHeader(iHeaderIcyMetadata);
     iReaderResponse.AddHeader(iHeaderServer);
     if (iServerObserver.Ok()) {
@@ -276,6 +309,7 @@ ProtocolStreamResult ProtocolHttp::Stream(const Brx& aUri)
         return EProtocolErrorNotSupported;
     }
     LOG(kMedia, "ProtocolHttp::Stream(%.*s)\n", PBUF(aUri));
+    iCacheUri.Replace(aUri);
 
     ProtocolStreamResult res = DoStream();
     if (res == EProtocolStreamErrorUnrecoverable) {
@@ -298,7 +332,7 @@ ProtocolStreamResult ProtocolHttp::Stream(const Brx& aUri)
             res = EProtocolStreamStopped;
             break;
         }
-        Close();
+        // WriteRequest() closes the connection unless it can be reused
         if (iLive) {
             res = DoLiveStream();
         }
@@ -306,10 +340,10 @@ ProtocolStreamResult ProtocolHttp::Stream(const Brx& aUri)
             iLock.Wait();
             iSupply->OutputFlush(iNextFlushId);
             iNextFlushId = MsgFlush::kIdInvalid;
-            iOffset = iSeekPos;
+            const TUint64 seekPos = iSeekPos;
             iSeek = false;
             iLock.Signal();
-            res = DoSeek(iOffset);
+            res = DoSeek(seekPos);
         }
         else {
             // FIXME - if stream is non-seekable, set ErrorUnrecoverable as soon as Connect succeeds
@@ -329,7 +363,9 @@ ProtocolStreamResult ProtocolHttp::Stream(const Brx& aUri)
         }
     }
 
-    Close();
+    if (!ConnectionIdle()) {
+        Close();
+    }
     iSupply->Flush();
     TUint nextFlushId = MsgFlush::kIdInvalid;
     {
@@ -373,6 +409,7 @@ ProtocolGetResult ProtocolHttp::Get(IWriter& aWriter, const Brx& aUri, TUint64 a
 
 void ProtocolHttp::Deactivated()
 {
+    CloseCacheEntry();
     if (iContentProcessor != nullptr) {
         iContentProcessor->Reset();
         iContentProcessor = nullptr;
@@ -444,7 +481,23 @@ TUint ProtocolHttp::TryStop(TUint aStreamId)
 
 Brn ProtocolHttp::Read(TUint aBytes)
 {
-    Brn buf = iReaderIcy->Read(aBytes);
+    TUint bytes = aBytes;
+    if (iKeepAlive) {
+        // server won't close the connection at the end of the body so we can't read past it
+        if (iBodyRemaining == 0) {
+            THROW(ReaderError);
+        }
+        if (bytes > iBodyRemaining) {
+            bytes = (TUint)iBodyRemaining;
+        }
+    }
+    Brn buf = iReaderIcy->Read(bytes);
+    if (iKeepAlive) {
+        iBodyRemaining -= buf.Bytes();
+    }
+    if (iCacheEntry != nullptr) {
+        iCacheEntry->Write(iOffset - buf.Bytes(), buf);
+    }
     iReadSuccess = true;
     return buf;
 }
@@ -494,6 +547,10 @@ TBool ProtocolHttp::Connect(const Uri& aUri)
         return false;
     }
 
+    iConnectedHost.Replace(aUri.Host());
+    iConnectedPort = PortFromUri(aUri);
+    iConnectedSecure = isSecure;
+    iConnected = true;
     LOG(kMedia, "<ProtocolHttp::Connect\n");
     return true;
 }
@@ -513,13 +570,30 @@ TInt ProtocolHttp::PortFromUri(const Uri& aUri) const
 void ProtocolHttp::Close()
 {
     iSocket.Close();
+    iConnected = false;
+    iKeepAlive = false;
+    iBodyRemaining = 0;
+}
+
+TBool ProtocolHttp::CanReuseConnection(const Uri& aUri) const
+{
+    return ConnectionIdle() &&
+           iConnectedSecure == (aUri.Scheme() == kSchemeHttps) &&
+           iConnectedPort == PortFromUri(aUri) &&
+           Ascii::CaseInsensitiveEquals(iConnectedHost, aUri.Host());
+}
+
+TBool ProtocolHttp::ConnectionIdle() const
+{
+    // The server has agreed to keep the connection open and all of the previous response has been read
+    return iConnected && iKeepAlive && iBodyRemaining == 0;
 }
 
 void ProtocolHttp::Reinitialise(const Brx& aUri)
 {
     iTotalStreamBytes = iTotalBytes = iSeekPos = iOffset = 0;
     iStreamId = IPipelineIdProvider::kStreamIdInvalid;
-    iSeekable = iSeek = iLive = iStarted = iStopped = iReadSuccess = false;
+    iSeekable = iSeek = iLive = iStarted = iStopped = iReadSuccess = iRedirected = false;
     iContentProcessor = nullptr;
     iNextFlushId = MsgFlush::kIdInvalid;
     (void)iSem.Clear();
@@ -544,6 +618,7 @@ ProtocolStreamResult ProtocolHttp::DoStream()
             }
             LOG(kMedia, "ProtocolHttp::DoStream redirect. code: %u, iHeaderLocation.Location(): %.*s\n", code, PBUF(iHeaderLocation.Location()));
             iUri.Replace(iHeaderLocation.Location());
+            iRedirected = true;
             continue;
         }
         break;
@@ -654,6 +729,12 @@ ProtocolGetResult ProtocolHttp::DoGet(IWriter& aWriter, TUint64 aOffset, TUint a
 ProtocolStreamResult ProtocolHttp::DoSeek(TUint64 aOffset)
 {
     Interrupt(false);
+    if (TryReadAhead(aOffset)) {
+        iTotalBytes = iTotalStreamBytes - iOffset;
+        return ProcessContent();
+    }
+
+    iOffset = aOffset;
     const TUint code = WriteRequest(aOffset);
     if (code == 0) {
         return EProtocolStreamErrorRecoverable;
@@ -666,6 +747,40 @@ ProtocolStreamResult ProtocolHttp::DoSeek(TUint64 aOffset)
     return ProcessContent();
 }
 
+TBool ProtocolHttp::TryReadAhead(TUint64 aOffset)
+{
+    /* A seek a short distance forward is cheaper to serve by discarding data from the open-ended
+       response we're already reading than by aborting it and paying for a new connection.
+       Only attempted where stream offsets map directly onto bytes read from the socket.
+       TLS connections are excluded as an interrupted read may have left them unusable. */
+    if (!iConnected || iConnectedSecure || !iSeekable ||
+        iHeaderTransferEncoding.IsChunked() || iHeaderIcyMetadata.Received()) {
+        return false;
+    }
+    if (aOffset < iOffset || aOffset - iOffset > kMaxReadAheadBytes) {
+        return false;
+    }
+    if (iKeepAlive && aOffset - iOffset >= iBodyRemaining) {
+        return false;
+    }
+
+    LOG(kMedia, "ProtocolHttp::TryReadAhead from %llu to %llu\n", iOffset, aOffset);
+    try {
+        while (iOffset < aOffset) {
+            TUint bytes = kReadBufferBytes;
+            if (aOffset - iOffset < bytes) {
+                bytes = (TUint)(aOffset - iOffset);
+            }
+            (void)Read(bytes);
+        }
+    }
+    catch (ReaderError&) {
+        LOG(kMedia, "ProtocolHttp::TryReadAhead reader error at %llu\n", iOffset);
+        return false;
+    }
+    return true;
+}
+
 ProtocolStreamResult ProtocolHttp::DoLiveStream()
 {
     const TUint code = WriteRequest(0);
@@ -690,12 +805,42 @@ TUint ProtocolHttp::WriteRequest(TUint64 aOffset)
 {
     iContentRecogBuf.ReadFlush();
     //iSocket.LogVerbose(true);
-    Close();
-    if (!Connect(iUri)) {
-        LOG(kMedia, "ProtocolHttp::WriteRequest Connection failure\n");
+    TBool reused = CanReuseConnection(iUri);
+    if (!reused) {
+        Close();
+        if (!Connect(iUri)) {
+            LOG(kMedia, "ProtocolHttp::WriteRequest Connection failure\n");
+            return 0;
+        }
+    }
+
+    TUint code = SendRequest(aOffset);
+    if (code == 0 && reused) {
+        // server may have closed the idle connection; retry on a new one
+        LOG(kMedia, "ProtocolHttp::WriteRequest failed to reuse connection\n");
+        iContentRecogBuf.ReadFlush();
+        Close();
+        if (!Connect(iUri)) {
+            LOG(kMedia, "ProtocolHttp::WriteRequest Connection failure\n");
+            return 0;
+        }
+        code = SendRequest(aOffset);
+    }
+    if (code == 0) {
         return 0;
     }
 
+    /* Only keep the connection open once the response has been read if its end is delimited
+       by Content-Length. Anything else relies on the server closing the connection. */
+    const TUint64 contentLength = iHeaderContentLength.ContentLength();
+    iKeepAlive = !iHeaderConnection.Close() && contentLength > 0 &&
+                 !iHeaderTransferEncoding.IsChunked() && !iHeaderIcyMetadata.Received();
+    iBodyRemaining = (iKeepAlive? contentLength : 0);
+    return code;
+}
+
+TUint ProtocolHttp::SendRequest(TUint64 aOffset)
+{
     /* GETting ASX for BBC Scotland responds with invalid chunking if we request ICY metadata.
        Suppress this header if we're requesting a resource with an extension that matches
        a known ContentProcessor */
@@ -717,14 +862,14 @@ TUint ProtocolHttp::WriteRequest(TUint64 aOffset)
         nonAudioUri = true;
     }
     try {
-        LOG(kMedia, "ProtocolHttp::WriteRequest send request\n");
+        LOG(kMedia, "ProtocolHttp::SendRequest send request\n");
         iWriterRequest.WriteMethod(Http::kMethodGet, iUri.PathAndQuery(), Http::eHttp11);
         const TInt port = PortFromUri(iUri);
         Http::WriteHeaderHostAndPort(iWriterRequest, iUri.Host(), port);
         if (iUserAgent.Bytes() > 0) {
             iWriterRequest.WriteHeader(Http::kHeaderUserAgent, iUserAgent);
         }
-        Http::WriteHeaderConnectionClose(iWriterRequest);
+        iWriterRequest.WriteHeader(Http::kHeaderConnection, Brn("keep-alive"));
         if (!nonAudioUri) {
             // Suppress ICY metadata and Range header for resources such as playlist files.
             HeaderIcyMetadata::Write(iWriterRequest);
@@ -733,26 +878,26 @@ TUint ProtocolHttp::WriteRequest(TUint64 aOffset)
         iWriterRequest.WriteFlush();
     }
     catch(WriterError&) {
-        LOG(kMedia, "ProtocolHttp::WriteRequest writer error\n");
+        LOG(kMedia, "ProtocolHttp::SendRequest writer error\n");
         return 0;
     }
 
     try {
-        LOG(kMedia, "ProtocolHttp::WriteRequest read response\n");
+        LOG(kMedia, "ProtocolHttp::SendRequest read response\n");
         //iSocket.LogVerbose(true);
         iReaderResponse.Read();
         //iSocket.LogVerbose(false);
     }
     catch(HttpError&) {
-        LOG(kMedia, "ProtocolHttp::WriteRequest http error\n");
+        LOG(kMedia, "ProtocolHttp::SendRequest http error\n");
         return 0;
     }
     catch(ReaderError&) {
-        LOG(kMedia, "ProtocolHttp::WriteRequest reader error\n");
+        LOG(kMedia, "ProtocolHttp::SendRequest reader error\n");
         return 0;
     }
     const TUint code = iReaderResponse.Status().Code();
-    LOG(kMedia, "ProtocolHttp::WriteRequest response code %d\n", code);
+    LOG(kMedia, "ProtocolHttp::SendRequest response code %d\n", code);
     return code;
 }
 
@@ -784,6 +929,7 @@ ProtocolStreamResult ProtocolHttp::ProcessContent()
         }
     }
     iContentProcessor = iProtocolManager->GetAudioProcessor();
+    OpenCacheEntry();
     ProtocolStreamResult res = iContentProcessor->Stream(*this, iTotalBytes);
     if (!iReadSuccess) {
         return EProtocolStreamErrorUnrecoverable;
@@ -800,6 +946,27 @@ ProtocolStreamResult ProtocolHttp::ProcessContent()
     return res;
 }
 
+void ProtocolHttp::OpenCacheEntry()
+{
+    /* Only cache streams where offsets map directly onto the bytes we read.
+       ProtocolHttp::Get() can't follow redirects or use TLS so any missing ranges of other
+       streams can't be fetched later; these are only played from the cache once complete. */
+    if (!iCache.Ok() || iCacheEntry != nullptr || !iSeekable || iLive || iTotalStreamBytes == 0 ||
+        iHeaderTransferEncoding.IsChunked() || iHeaderIcyMetadata.Received()) {
+        return;
+    }
+    const TBool rangeFetchable = (iUri.Scheme() == kSchemeHttp && !iRedirected);
+    iCacheEntry = iCache.Unwrap().Create(iCacheUri, iTotalStreamBytes, rangeFetchable);
+}
+
+void ProtocolHttp::CloseCacheEntry()
+{
+    if (iCacheEntry != nullptr) {
+        iCache.Unwrap().Close(*iCacheEntry);
+        iCacheEntry = nullptr;
+    }
+}
+
 TBool ProtocolHttp::ContinueStreaming(ProtocolStreamResult aResult)
 {
     if (aResult == EProtocolStreamErrorRecoverable) {
@@ -0,0 +1,359 @@
+#include <OpenHome/Media/Protocol/StreamCache.h>
+#include <OpenHome/Types.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Exception.h>
+#include <OpenHome/Private/File.h>
+#include <OpenHome/Private/Stream.h>
+#include <OpenHome/Private/Debug.h>
+#include <OpenHome/Media/Debug.h>
+
+#include <stdio.h>
+
+using namespace OpenHome;
+using namespace OpenHome::Media;
+
+// StreamCacheEntry
+
+StreamCacheEntry::StreamCacheEntry(StreamCache& aCache, TUint aSlot, const Brx& aUri)
+    : iCache(aCache)
+    , iSlot(aSlot)
+    , iUri(aUri)
+    , iFile(nullptr)
+    , iStreamBytes(0)
+    , iFileBytes(0)
+    , iRangeFetchable(false)
+    , iRefCount(0)
+    , iLastUsed(0)
+{
+}
+
+StreamCacheEntry::~StreamCacheEntry()
+{
+    DeleteFile();
+}
+
+TUint64 StreamCacheEntry::StreamBytes() const
+{
+    return iStreamBytes;
+}
+
+TBool StreamCacheEntry::RangeFetchable() const
+{
+    AutoMutex _(iCache.iLock);
+    return iRangeFetchable;
+}
+
+TUint64 StreamCacheEntry::BytesAvailable(TUint64 aOffset) const
+{
+    AutoMutex _(iCache.iLock);
+    return DoBytesAvailable(aOffset);
+}
+
+TUint64 StreamCacheEntry::BytesMissing(TUint64 aOffset) const
+{
+    AutoMutex _(iCache.iLock);
+    if (aOffset >= iStreamBytes) {
+        return 0;
+    }
+    for (auto it=iRanges.begin(); it!=iRanges.end(); ++it) {
+        if (it->second > aOffset) {
+            return (it->first <= aOffset? 0 : it->first - aOffset);
+        }
+    }
+    return iStreamBytes - aOffset;
+}
+
+void StreamCacheEntry::Read(TUint64 aOffset, Bwx& aBuf, TUint aBytes)
+{
+    AutoMutex _(iCache.iLock);
+    const TUint64 available = DoBytesAvailable(aOffset);
+    if (iFile == nullptr || available == 0) {
+        THROW(ReaderError);
+    }
+    TUint bytes = aBytes;
+    if (bytes > aBuf.MaxBytes()) {
+        bytes = aBuf.MaxBytes();
+    }
+    if (bytes > available) {
+        bytes = (TUint)available;
+    }
+    aBuf.SetBytes(0);
+    try {
+        iFile->Seek((TInt32)aOffset, eSeekFromStart);
+        iFile->Read(aBuf, bytes);
+    }
+    catch (FileSeekError&) {
+        THROW(ReaderError);
+    }
+    catch (FileReadError&) {
+        THROW(ReaderError);
+    }
+    if (aBuf.Bytes() != bytes) {
+        THROW(ReaderError);
+    }
+}
+
+void StreamCacheEntry::Write(TUint64 aOffset, const Brx& aData)
+{
+    AutoMutex _(iCache.iLock);
+    if (iFile == nullptr || aOffset >= iStreamBytes || aData.Bytes() == 0) {
+        return;
+    }
+    TUint bytes = aData.Bytes();
+    if (aOffset + bytes > iStreamBytes) {
+        bytes = (TUint)(iStreamBytes - aOffset);
+    }
+    if (DoBytesAvailable(aOffset) >= bytes) {
+        return;
+    }
+    const TUint64 end = aOffset + bytes;
+    if (end > iFileBytes) {
+        // data written beyond the current end of the file may leave a hole so account for all of it
+        if (!iCache.TryReserve(*this, end - iFileBytes)) {
+            return;
+        }
+        iFileBytes = end;
+    }
+    try {
+        iFile->Seek((TInt32)aOffset, eSeekFromStart);
+        iFile->Write(aData.Split(0, bytes));
+    }
+    catch (FileSeekError&) {
+        LOG_ERROR(kMedia, "StreamCacheEntry::Write seek to %llu failed\n", aOffset);
+        return;
+    }
+    catch (FileWriteError&) {
+        LOG_ERROR(kMedia, "StreamCacheEntry::Write failed at %llu\n", aOffset);
+        return;
+    }
+    AddRange(aOffset, end);
+}
+
+TBool StreamCacheEntry::Reset(TUint64 aStreamBytes, TBool aRangeFetchable)
+{
+    DeleteFile();
+    Bws<StreamCache::kMaxPathBytes> path;
+    iCache.FilePath(iSlot, path);
+    try {
+        // create (or truncate) the file before opening it for both reading and writing
+        IFile* file = IFile::Open(path.PtrZ(), eFileWriteOnly);
+        delete file;
+        iFile = IFile::Open(path.PtrZ(), eFileReadWrite);
+    }
+    catch (FileOpenError&) {
+        LOG_ERROR(kMedia, "StreamCacheEntry::Reset unable to open %s\n", path.PtrZ());
+        return false;
+    }
+    iStreamBytes = aStreamBytes;
+    iRangeFetchable = aRangeFetchable;
+    return true;
+}
+
+void StreamCacheEntry::DeleteFile()
+{
+    if (iFile != nullptr) {
+        delete iFile;
+        iFile = nullptr;
+        Bws<StreamCache::kMaxPathBytes> path;
+        iCache.FilePath(iSlot, path);
+        (void)::remove(path.PtrZ());
+    }
+    iCache.iBytes -= iFileBytes;
+    iFileBytes = 0;
+    iRanges.clear();
+}
+
+TUint64 StreamCacheEntry::DoBytesAvailable(TUint64 aOffset) const
+{
+    for (auto it=iRanges.begin(); it!=iRanges.end(); ++it) {
+        if (it->first > aOffset) {
+            break;
+        }
+        if (it->second > aOffset) {
+            return it->second - aOffset;
+        }
+    }
+    return 0;
+}
+
+void StreamCacheEntry::AddRange(TUint64 aStart, TUint64 aEnd)
+{
+    // merge with any ranges that overlap or touch [aStart, aEnd)
+    auto it = iRanges.begin();
+    while (it != iRanges.end() && it->second < aStart) {
+        ++it;
+    }
+    TUint64 start = aStart;
+    TUint64 end = aEnd;
+    while (it != iRanges.end() && it->first <= end) {
+        if (it->first < start) {
+            start = it->first;
+        }
+        if (it->second > end) {
+            end = it->second;
+        }
+        it = iRanges.erase(it);
+    }
+    (void)iRanges.insert(it, std::make_pair(start, end));
+}
+
+
+// StreamCache
+
+StreamCache::StreamCache(const Brx& aDirectory, TUint64 aMaxBytes, TUint aMaxEntries)
+    : iLock("SCCH")
+    , iDirectory(aDirectory)
+    , iMaxBytes(aMaxBytes)
+    , iMaxEntries(aMaxEntries)
+    , iSlotsUsed(aMaxEntries, false)
+    , iBytes(0)
+    , iUseCount(0)
+{
+    ASSERT(aMaxEntries > 0);
+}
+
+StreamCache::~StreamCache()
+{
+    for (auto entry : iEntries) {
+        ASSERT(entry->iRefCount == 0);
+        delete entry;
+    }
+}
+
+StreamCacheEntry* StreamCache::Open(const Brx& aUri)
+{
+    AutoMutex _(iLock);
+    StreamCacheEntry* entry = Find(aUri);
+    if (entry == nullptr || entry->iRanges.size() == 0) {
+        return nullptr;
+    }
+    entry->iRefCount++;
+    Touch(*entry);
+    return entry;
+}
+
+StreamCacheEntry* StreamCache::Create(const Brx& aUri, TUint64 aStreamBytes, TBool aRangeFetchable)
+{
+    AutoMutex _(iLock);
+    if (aStreamBytes == 0 || aStreamBytes > kMaxEntryBytes || aStreamBytes > iMaxBytes) {
+        return nullptr;
+    }
+    StreamCacheEntry* entry = Find(aUri);
+    if (entry != nullptr && (entry->iStreamBytes != aStreamBytes || entry->iFile == nullptr)) {
+        // stream has changed since it was cached
+        if (entry->iRefCount > 0) {
+            return nullptr;
+        }
+        LOG(kMedia, "StreamCache::Create discarding stale entry for %.*s\n", PBUF(aUri));
+        if (!entry->Reset(aStreamBytes, aRangeFetchable)) {
+            return nullptr;
+        }
+    }
+    else if (entry == nullptr) {
+        entry = CreateLocked(aUri);
+        if (entry == nullptr) {
+            return nullptr;
+        }
+        if (!entry->Reset(aStreamBytes, aRangeFetchable)) {
+            iSlotsUsed[entry->iSlot] = false;
+            iEntries.pop_back();
+            delete entry;
+            return nullptr;
+        }
+    }
+    else {
+        entry->iRangeFetchable = aRangeFetchable;
+    }
+    entry->iRefCount++;
+    Touch(*entry);
+    return entry;
+}
+
+void StreamCache::Close(StreamCacheEntry& aEntry)
+{
+    AutoMutex _(iLock);
+    ASSERT(aEntry.iRefCount > 0);
+    aEntry.iRefCount--;
+}
+
+TUint64 StreamCache::Bytes() const
+{
+    AutoMutex _(iLock);
+    return iBytes;
+}
+
+TUint StreamCache::EntryCount() const
+{
+    AutoMutex _(iLock);
+    return (TUint)iEntries.size();
+}
+
+StreamCacheEntry* StreamCache::Find(const Brx& aUri) const
+{
+    for (auto entry : iEntries) {
+        if (entry->iUri == aUri) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+StreamCacheEntry* StreamCache::CreateLocked(const Brx& aUri)
+{
+    if (iEntries.size() >= iMaxEntries && !TryEvict(nullptr)) {
+        return nullptr;
+    }
+    TUint slot = 0;
+    while (iSlotsUsed[slot]) {
+        slot++;
+    }
+    iSlotsUsed[slot] = true;
+    StreamCacheEntry* entry = new StreamCacheEntry(*this, slot, aUri);
+    iEntries.push_back(entry);
+    return entry;
+}
+
+TBool StreamCache::TryReserve(StreamCacheEntry& aEntry, TUint64 aBytes)
+{
+    while (iBytes + aBytes > iMaxBytes) {
+        if (!TryEvict(&aEntry)) {
+            return false;
+        }
+    }
+    iBytes += aBytes;
+    return true;
+}
+
+TBool StreamCache::TryEvict(const StreamCacheEntry* aExclude)
+{
+    auto lru = iEntries.end();
+    for (auto it=iEntries.begin(); it!=iEntries.end(); ++it) {
+        if ((*it)->iRefCount == 0 && *it != aExclude &&
+            (lru == iEntries.end() || (*it)->iLastUsed < (*lru)->iLastUsed)) {
+            lru = it;
+        }
+    }
+    if (lru == iEntries.end()) {
+        return false;
+    }
+    StreamCacheEntry* entry = *lru;
+    LOG(kMedia, "StreamCache evicting %.*s\n", PBUF(entry->iUri));
+    iEntries.erase(lru);
+    iSlotsUsed[entry->iSlot] = false;
+    delete entry;
+    return true;
+}
+
+void StreamCache::Touch(StreamCacheEntry& aEntry)
+{
+    aEntry.iLastUsed = ++iUseCount;
+}
+
+void StreamCache::FilePath(TUint aSlot, Bwx& aPath) const
+{
+    aPath.Replace(iDirectory);
+    if (aPath.Bytes() > 0 && aPath[aPath.Bytes()-1] != '/' && aPath[aPath.Bytes()-1] != '\\') {
+        aPath.Append('/');
+    }
+    aPath.AppendPrintf("StreamCache%u.dat", aSlot);
+}
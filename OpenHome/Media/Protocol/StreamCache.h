@@ -0,0 +1,93 @@
+#pragma once
+
+#include <OpenHome/Types.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Private/Standard.h>
+#include <OpenHome/Private/Thread.h>
+
+#include <utility>
+#include <vector>
+
+namespace OpenHome {
+    class IFile;
+namespace Media {
+
+class StreamCache;
+
+/**
+ * Encoded data from a single stream held by a StreamCache.
+ *
+ * Records which byte ranges of the stream are available so that partial downloads can
+ * be reused.  Obtained from StreamCache::Open() or Create() and must be returned via
+ * StreamCache::Close().  Entries are never evicted while open.
+ */
+class StreamCacheEntry : private INonCopyable
+{
+    friend class StreamCache;
+public:
+    TUint64 StreamBytes() const;
+    TBool RangeFetchable() const; // missing ranges can be requested from the entry's uri
+    TUint64 BytesAvailable(TUint64 aOffset) const; // contiguous cached bytes starting at aOffset
+    TUint64 BytesMissing(TUint64 aOffset) const; // bytes from aOffset until the next cached range or end of stream
+    void Read(TUint64 aOffset, Bwx& aBuf, TUint aBytes); // throws ReaderError
+    void Write(TUint64 aOffset, const Brx& aData); // silently discards data if the cache is full
+private:
+    StreamCacheEntry(StreamCache& aCache, TUint aSlot, const Brx& aUri);
+    ~StreamCacheEntry();
+    TBool Reset(TUint64 aStreamBytes, TBool aRangeFetchable);
+    void DeleteFile();
+    TUint64 DoBytesAvailable(TUint64 aOffset) const;
+    void AddRange(TUint64 aStart, TUint64 aEnd);
+private:
+    StreamCache& iCache;
+    const TUint iSlot;
+    Bwh iUri;
+    IFile* iFile;
+    TUint64 iStreamBytes;
+    TUint64 iFileBytes;
+    TBool iRangeFetchable;
+    std::vector<std::pair<TUint64, TUint64>> iRanges; // sorted, disjoint, [start, end)
+    TUint iRefCount;
+    TUint64 iLastUsed;
+};
+
+/**
+ * Bounded, least recently used, disk cache of encoded streams keyed by uri.
+ *
+ * Filled by protocols as they stream and consulted before any network connection
+ * is opened.  The index is held in memory only; files left by a previous run are
+ * overwritten as their slots are reused.
+ */
+class StreamCache : private INonCopyable
+{
+    friend class StreamCacheEntry;
+    static const TUint64 kMaxEntryBytes = 0x7fffffff; // IFile offsets are 32-bit
+    static const TUint kMaxPathBytes = 512;
+public:
+    StreamCache(const Brx& aDirectory, TUint64 aMaxBytes, TUint aMaxEntries);
+    ~StreamCache();
+    StreamCacheEntry* Open(const Brx& aUri); // returns nullptr if nothing is cached for aUri
+    StreamCacheEntry* Create(const Brx& aUri, TUint64 aStreamBytes, TBool aRangeFetchable); // returns nullptr if aUri can't be cached
+    void Close(StreamCacheEntry& aEntry);
+    TUint64 Bytes() const;
+    TUint EntryCount() const;
+private:
+    StreamCacheEntry* Find(const Brx& aUri) const;
+    StreamCacheEntry* CreateLocked(const Brx& aUri);
+    TBool TryReserve(StreamCacheEntry& aEntry, TUint64 aBytes);
+    TBool TryEvict(const StreamCacheEntry* aExclude);
+    void Touch(StreamCacheEntry& aEntry);
+    void FilePath(TUint aSlot, Bwx& aPath) const;
+private:
+    mutable Mutex iLock;
+    Bws<kMaxPathBytes> iDirectory;
+    const TUint64 iMaxBytes;
+    const TUint iMaxEntries;
+    std::vector<StreamCacheEntry*> iEntries;
+    std::vector<TBool> iSlotsUsed;
+    TUint64 iBytes;
+    TUint64 iUseCount;
+};
+
+} // namespace Media
+} // namespace OpenHome
@@ -0,0 +1,107 @@
+#include <OpenHome/Types.h>
+#include <OpenHome/OsWrapper.h>
+#include <OpenHome/Private/Env.h>
+#include <OpenHome/Private/Printer.h>
+#include <OpenHome/Private/TestFramework.h>
+#include <OpenHome/Media/Pipeline/DsdToPcm.h>
+
+#include <vector>
+
+using namespace OpenHome;
+using namespace OpenHome::TestFramework;
+using namespace OpenHome::Media;
+
+/*
+Reports the real-time factor (seconds of audio converted per second of cpu) of DSD to PCM
+conversion for stereo DSD64/128/256, decimating to 176.4kHz and 88.2kHz.
+Both channels are processed on the calling thread, so results are for a single core.
+*/
+
+namespace OpenHome {
+namespace Media {
+
+class BenchmarkDsdToPcm
+{
+    static const TUint kNumChannels = 2;
+    static const TUint kBlockBytes = 4096; // per channel; similar to a single MsgAudioDsd
+    static const TUint kSampleRateDsd64 = 2822400;
+    static const TUint kDurationSecs = 10;
+public:
+    BenchmarkDsdToPcm(Environment& aEnv);
+    ~BenchmarkDsdToPcm();
+    void Run();
+private:
+    void Convert(TUint aDsdMultiple, TUint aHalfBandStages);
+private:
+    Environment& iEnv;
+    DsdFilterBank iFilters;
+    DsdDecimator* iDecimators[kNumChannels];
+    std::vector<TByte> iDsd;
+    std::vector<float> iPcm;
+};
+
+} // namespace Media
+} // namespace OpenHome
+
+
+BenchmarkDsdToPcm::BenchmarkDsdToPcm(Environment& aEnv)
+    : iEnv(aEnv)
+    , iDsd(kBlockBytes)
+{
+    for (TUint i=0; i<kNumChannels; i++) {
+        iDecimators[i] = new DsdDecimator(iFilters);
+    }
+    TUint32 lcg = 1;
+    for (TUint i=0; i<kBlockBytes; i++) {
+        lcg = lcg * 1664525 + 1013904223;
+        iDsd[i] = (TByte)(lcg >> 24);
+    }
+}
+
+BenchmarkDsdToPcm::~BenchmarkDsdToPcm()
+{
+    for (TUint i=0; i<kNumChannels; i++) {
+        delete iDecimators[i];
+    }
+}
+
+void BenchmarkDsdToPcm::Run()
+{
+    Log::Print("BenchmarkDsdToPcm: %u channels, %u seconds of audio\n", kNumChannels, kDurationSecs);
+    for (TUint multiple=1; multiple<=4; multiple*=2) {
+        Convert(multiple, multiple);     // 176.4kHz
+        Convert(multiple, multiple + 1); // 88.2kHz
+    }
+}
+
+void BenchmarkDsdToPcm::Convert(TUint aDsdMultiple, TUint aHalfBandStages)
+{
+    const TUint sampleRate = kSampleRateDsd64 * aDsdMultiple;
+    for (TUint i=0; i<kNumChannels; i++) {
+        iDecimators[i]->Configure(aHalfBandStages);
+    }
+    const TUint64 bytes = ((TUint64)sampleRate / 8) * kDurationSecs;
+    const TUint iterations = (TUint)(bytes / kBlockBytes);
+    const TUint64 start = OsTimeInUs(iEnv.OsCtx());
+    for (TUint i=0; i<iterations; i++) {
+        for (TUint j=0; j<kNumChannels; j++) {
+            (void)iDecimators[j]->Process(&iDsd[0], kBlockBytes, iPcm);
+        }
+    }
+    TUint64 elapsedUs = OsTimeInUs(iEnv.OsCtx()) - start;
+    if (elapsedUs == 0) {
+        elapsedUs = 1;
+    }
+    const TUint64 audioUs = ((TUint64)iterations * kBlockBytes * 8 * 1000000) / sampleRate;
+    const TUint rtFactor = (TUint)((audioUs * 10) / elapsedUs);
+    Log::Print("    DSD%u -> %u: %u.%ux real-time\n", 64 * aDsdMultiple, sampleRate / iDecimators[0]->Decimation(),
+               rtFactor / 10, rtFactor % 10);
+}
+
+
+void TestBenchmarkDsdToPcm(Environment& aEnv)
+{
+    auto benchmark = new BenchmarkDsdToPcm(aEnv);
+    benchmark->Run();
+    delete benchmark;
+}
@@ -0,0 +1,161 @@
+#include <OpenHome/Types.h>
+#include <OpenHome/OsWrapper.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Private/Env.h>
+#include <OpenHome/Private/Printer.h>
+#include <OpenHome/Private/TestFramework.h>
+#include <OpenHome/Media/Pipeline/PcmKernels.h>
+
+#include <string.h>
+
+using namespace OpenHome;
+using namespace OpenHome::TestFramework;
+using namespace OpenHome::Media;
+
+/*
+Reports throughput (MB/s of source PCM) for each PcmKernels operation, once using the
+implementation selected for this CPU then again with SIMD disabled.
+Output is one line per kernel so that runs can be diffed or grepped.
+*/
+
+namespace OpenHome {
+namespace Media {
+
+class BenchmarkPcmKernels
+{
+    static const TUint kBufBytes = 1024 * 1024 * 3; // multiple of all subsample sizes
+    static const TUint kIterations = 64;
+    static const TUint kNumChannels = 2;
+public:
+    BenchmarkPcmKernels(Environment& aEnv);
+    void Run();
+private:
+    void RunAll();
+    void Report(const TChar* aKernel, TUint aBitDepth, TUint64 aStartUs);
+    void CopyToBigEndian(TUint aBitDepth);
+    void ApplyGain(TUint aBitDepth);
+    void ApplyRamp(TUint aBitDepth);
+private:
+    Environment& iEnv;
+    Bwh iSrc;
+    Bwh iDest;
+    TUint16 iGains[kBufBytes / (kNumChannels * 2)]; // enough for the 16-bit ramp
+};
+
+} // namespace Media
+} // namespace OpenHome
+
+
+BenchmarkPcmKernels::BenchmarkPcmKernels(Environment& aEnv)
+    : iEnv(aEnv)
+    , iSrc(kBufBytes)
+    , iDest(kBufBytes)
+{
+    TUint32 lcg = 1;
+    for (TUint i=0; i<kBufBytes; i++) {
+        lcg = lcg * 1664525 + 1013904223;
+        iSrc.Append((TByte)(lcg >> 24));
+    }
+    iDest.SetBytes(kBufBytes);
+    const TUint numGains = sizeof(iGains) / sizeof(iGains[0]);
+    for (TUint i=0; i<numGains; i++) {
+        iGains[i] = (TUint16)(0x7fff - (((TUint64)i * 0x7fff) / numGains));
+    }
+}
+
+void BenchmarkPcmKernels::Run()
+{
+    PcmKernels::ForceScalar(false);
+    Log::Print("BenchmarkPcmKernels: %s\n", PcmKernels::SimdName());
+    RunAll();
+    PcmKernels::ForceScalar(true);
+    Log::Print("BenchmarkPcmKernels: %s\n", PcmKernels::SimdName());
+    RunAll();
+    PcmKernels::ForceScalar(false);
+}
+
+void BenchmarkPcmKernels::RunAll()
+{
+    TUint64 start = OsTimeInUs(iEnv.OsCtx());
+    for (TUint i=0; i<kIterations; i++) {
+        (void)memcpy(const_cast<TByte*>(iDest.Ptr()), iSrc.Ptr(), kBufBytes);
+    }
+    Report("memcpy", 0, start);
+    for (TUint bitDepth=16; bitDepth<=32; bitDepth+=8) {
+        CopyToBigEndian(bitDepth);
+    }
+    for (TUint bitDepth=16; bitDepth<=32; bitDepth+=8) {
+        ApplyGain(bitDepth);
+    }
+    for (TUint bitDepth=16; bitDepth<=32; bitDepth+=8) {
+        ApplyRamp(bitDepth);
+    }
+}
+
+void BenchmarkPcmKernels::Report(const TChar* aKernel, TUint aBitDepth, TUint64 aStartUs)
+{
+    TUint64 elapsedUs = OsTimeInUs(iEnv.OsCtx()) - aStartUs;
+    if (elapsedUs == 0) {
+        elapsedUs = 1;
+    }
+    const TUint mbPerSec = (TUint)(((TUint64)kBufBytes * kIterations) / elapsedUs); // bytes per us == MB/s
+    if (aBitDepth == 0) {
+        Log::Print("    %s: %u MB/s\n", aKernel, mbPerSec);
+    }
+    else {
+        Log::Print("    %s%u: %u MB/s\n", aKernel, aBitDepth, mbPerSec);
+    }
+}
+
+void BenchmarkPcmKernels::CopyToBigEndian(TUint aBitDepth)
+{
+    TByte* dest = const_cast<TByte*>(iDest.Ptr());
+    const TUint64 start = OsTimeInUs(iEnv.OsCtx());
+    for (TUint i=0; i<kIterations; i++) {
+        switch (aBitDepth)
+        {
+        case 16:
+            PcmKernels::CopyToBigEndian16(iSrc.Ptr(), dest, kBufBytes);
+            break;
+        case 24:
+            PcmKernels::CopyToBigEndian24(iSrc.Ptr(), dest, kBufBytes);
+            break;
+        case 32:
+            PcmKernels::CopyToBigEndian32(iSrc.Ptr(), dest, kBufBytes);
+            break;
+        default:
+            ASSERTS();
+        }
+    }
+    Report("CopyToBigEndian", aBitDepth, start);
+}
+
+void BenchmarkPcmKernels::ApplyGain(TUint aBitDepth)
+{
+    const TUint numSubsamples = kBufBytes / (aBitDepth/8);
+    TByte* dest = const_cast<TByte*>(iDest.Ptr());
+    const TUint64 start = OsTimeInUs(iEnv.OsCtx());
+    for (TUint i=0; i<kIterations; i++) {
+        PcmKernels::ApplyGain(iSrc.Ptr(), dest, PcmKernels::kGainUnity / 3, numSubsamples, aBitDepth);
+    }
+    Report("ApplyGain", aBitDepth, start);
+}
+
+void BenchmarkPcmKernels::ApplyRamp(TUint aBitDepth)
+{
+    const TUint numSamples = kBufBytes / ((aBitDepth/8) * kNumChannels);
+    TByte* dest = const_cast<TByte*>(iDest.Ptr());
+    const TUint64 start = OsTimeInUs(iEnv.OsCtx());
+    for (TUint i=0; i<kIterations; i++) {
+        PcmKernels::ApplyRamp(iSrc.Ptr(), dest, iGains, numSamples, aBitDepth, kNumChannels);
+    }
+    Report("ApplyRamp", aBitDepth, start);
+}
+
+
+void TestBenchmarkPcmKernels(Environment& aEnv)
+{
+    auto benchmark = new BenchmarkPcmKernels(aEnv);
+    benchmark->Run();
+    delete benchmark;
+}
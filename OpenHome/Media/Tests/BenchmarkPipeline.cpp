@@ -0,0 +1,895 @@
+#include <OpenHome/Types.h>
+#include <OpenHome/OsWrapper.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Json.h>
+#include <OpenHome/Private/Ascii.h>
+#include <OpenHome/Private/Env.h>
+#include <OpenHome/Private/File.h>
+#include <OpenHome/Private/InfoProvider.h>
+#include <OpenHome/Private/OptionParser.h>
+#include <OpenHome/Private/Printer.h>
+#include <OpenHome/Private/Stream.h>
+#include <OpenHome/Private/TestFramework.h>
+#include <OpenHome/Private/Thread.h>
+#include <OpenHome/Media/PipelineManager.h>
+#include <OpenHome/Media/PipelineObserver.h>
+#include <OpenHome/Media/MimeTypeList.h>
+#include <OpenHome/Media/UriProviderSingleTrack.h>
+#include <OpenHome/Media/Pipeline/Msg.h>
+#include <OpenHome/Media/Pipeline/Pipeline.h>
+#include <OpenHome/Media/Pipeline/PipelineMetrics.h>
+#include <OpenHome/Media/Pipeline/PcmKernels.h>
+#include <OpenHome/Media/Pipeline/VolumeRamper.h>
+#include <OpenHome/Media/Pipeline/MuterVolume.h>
+#include <OpenHome/Media/Codec/CodecFactory.h>
+#include <OpenHome/Media/Codec/ContainerFactory.h>
+#include <OpenHome/Media/Protocol/ProtocolFactory.h>
+
+#include <FLAC/stream_encoder.h>
+
+#include <algorithm>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#ifndef _WIN32
+# include <sys/resource.h>
+#endif
+
+using namespace OpenHome;
+using namespace OpenHome::TestFramework;
+using namespace OpenHome::Media;
+
+/*
+Headless end-to-end benchmark.  Drives a complete PipelineManager (protocols, containers,
+codecs and every pipeline element) from a free-running animator which consumes audio as
+fast as the pipeline can supply it.
+
+A synthetic corpus of tone:// streams covers PCM at 44.1k-192k, 16/24-bit, stereo and 5.1.
+DSD (DSF at DSD64 and DSD128) and hi-res FLAC (24-bit at 96k and 192k) can't be synthesised
+on the fly so are written to --tmp-dir before the run and deleted after it.  --dsd-to-pcm
+benchmarks DSD conversion rather than native DSD playback.
+Other encoded formats are benchmarked by pointing --corpus at a directory (file://...) or
+server (http://...) holding the TestCodec files.  Any other single stream can be added via --uri.
+
+For each stream, reports wall time, process cpu time, cpu cost per second of audio, peak
+RSS and the PipelineMetrics collected while it played.  Allocator high-water marks are
+reported once for the whole run.  All output is a single JSON document on stdout.
+*/
+
+namespace OpenHome {
+namespace Media {
+
+class BenchmarkInfoAggregator : public IInfoAggregator
+{
+public:
+    PipelineMetrics* Metrics() const;
+    void WriteAllocators(WriterJsonObject& aWriter) const;
+private: // from IInfoAggregator
+    void Register(IInfoProvider& aProvider, std::vector<Brn>& aSupportedQueries) override;
+private:
+    std::vector<IInfoProvider*> iProviders;
+};
+
+class NullVolume : public IVolumeRamper, public IVolumeMuterStepped
+{
+private: // from IVolumeRamper
+    void ApplyVolumeMultiplier(TUint aValue) override;
+private: // from IVolumeMuterStepped
+    Status BeginMute() override;
+    Status StepMute(TUint aJiffies) override;
+    void SetMuted() override;
+    Status BeginUnmute() override;
+    Status StepUnmute(TUint aJiffies) override;
+    void SetUnmuted() override;
+};
+
+class NullAudioProcessor : public IPcmProcessor, public IDsdProcessor
+{
+private: // from IPcmProcessor
+    void ProcessFragment8(const Brx& aData, TUint aNumChannels) override;
+    void ProcessFragment16(const Brx& aData, TUint aNumChannels) override;
+    void ProcessFragment24(const Brx& aData, TUint aNumChannels) override;
+    void ProcessFragment32(const Brx& aData, TUint aNumChannels) override;
+private: // from IDsdProcessor
+    void ProcessFragment(const Brx& aData, TUint aNumChannels, TUint aSampleBlockBits) override;
+private: // from IPcmProcessor, IDsdProcessor
+    void BeginBlock() override;
+    void EndBlock() override;
+    void Flush() override;
+};
+
+/*
+Pulls (and reads) audio without any timing.  A stream is complete when it is followed by
+a halt or, if it failed to produce any audio, when the pipeline reports it has stopped.
+*/
+
+class NullAnimator : public PipelineElement, public IPipelineAnimator, public IPipelineObserver, private INonCopyable
+{
+    static const TUint kSupportedMsgTypes;
+public:
+    NullAnimator(IPipeline& aPipeline);
+    ~NullAnimator();
+    void BeginStream();
+    TBool WaitStreamComplete(TUint aTimeoutMs);
+    TUint64 Jiffies() const;
+    void WriteStreamInfo(WriterJsonObject& aWriter) const;
+private:
+    void AnimatorThread();
+    void StreamComplete();
+private: // from IMsgProcessor
+    Msg* ProcessMsg(MsgMode* aMsg) override;
+    Msg* ProcessMsg(MsgDrain* aMsg) override;
+    Msg* ProcessMsg(MsgHalt* aMsg) override;
+    Msg* ProcessMsg(MsgDecodedStream* aMsg) override;
+    Msg* ProcessMsg(MsgPlayable* aMsg) override;
+    Msg* ProcessMsg(MsgQuit* aMsg) override;
+private: // from IPipelineAnimator
+    TUint PipelineAnimatorBufferJiffies() const override;
+    TUint PipelineAnimatorDelayJiffies(AudioFormat aFormat, TUint aSampleRate, TUint aBitDepth, TUint aNumChannels) const override;
+    TUint PipelineAnimatorDsdBlockSizeBytes() const override;
+private: // from IPipelineObserver
+    void NotifyPipelineState(EPipelineState aState) override;
+    void NotifyMode(const Brx& aMode, const ModeInfo& aInfo, const ModeTransportControls& aTransportControls) override;
+    void NotifyTrack(Track& aTrack, const Brx& aMode, TBool aStartOfStream) override;
+    void NotifyMetaText(const Brx& aText) override;
+    void NotifyTime(TUint aSeconds, TUint aTrackDurationSeconds) override;
+    void NotifyStreamInfo(const DecodedStreamInfo& aStreamInfo) override;
+private:
+    IPipeline& iPipeline;
+    mutable Mutex iLock;
+    Semaphore iSemComplete;
+    ThreadFunctor* iThread;
+    NullAudioProcessor iProcessor;
+    TBool iStreamActive;
+    TBool iPipelineActive;
+    TUint64 iJiffies;
+    BwsCodecName iCodecName;
+    AudioFormat iFormat;
+    TUint iSampleRate;
+    TUint iBitDepth;
+    TUint iNumChannels;
+    TBool iQuit;
+};
+
+class BenchmarkPipeline : private INonCopyable
+{
+    static const TUint kStreamTimeoutMs = 5 * 60 * 1000;
+    static const TUint kMaxUriBytes = 1024;
+public:
+    BenchmarkPipeline(Environment& aEnv, TBool aDsdSupported);
+    ~BenchmarkPipeline();
+    void Run(const std::vector<Brn>& aUris, IWriter& aWriter);
+private:
+    void RunStream(const Brx& aUri, WriterJsonArray& aWriterResults);
+    static void GetUsage(TUint64& aCpuUs, TUint64& aPeakRssKb);
+private:
+    Environment& iEnv;
+    BenchmarkInfoAggregator iInfoAggregator;
+    MimeTypeList iMimeTypes;
+    NullVolume iVolume;
+    TrackFactory* iTrackFactory;
+    PipelineManager* iPipeline;
+    UriProviderSingleTrack* iUriProvider;
+    NullAnimator* iAnimator;
+};
+
+/*
+Writes files for formats the tone protocol can't generate.  Audio is a 1kHz sine; FLAC
+also has low level noise added so that it compresses like real content.
+*/
+
+class GeneratedCorpus : private INonCopyable
+{
+    static const TUint kPitchHz = 1000;
+    static const TUint kDsfBlockBytes = 4096; // per channel, as required by CodecDsdDsf
+    static const TUint kDsfHeaderBytes = 28 + 52 + 12;
+    static const TUint kFlacBlockSamples = 4096;
+public:
+    GeneratedCorpus(const Brx& aDir, TUint aDurationSecs);
+    ~GeneratedCorpus();
+    void AppendUris(std::vector<Bwh*>& aUris) const;
+private:
+    const TChar* AddPath(const TChar* aName);
+    void WriteDsf(const TChar* aName, TUint aSampleRate);
+    void WriteFlac(const TChar* aName, TUint aSampleRate, TUint aBitDepth, TUint aNumChannels);
+    static void AppendLe(Bwx& aBuf, TUint64 aValue, TUint aBytes);
+private:
+    const Brh iDir;
+    const TUint iDurationSecs;
+    std::vector<Bwh*> iPaths;
+};
+
+} // namespace Media
+} // namespace OpenHome
+
+
+static void WriteUint(WriterJsonObject& aWriter, const TChar* aKey, TUint64 aValue)
+{
+    Bws<24> buf;
+    Ascii::AppendDec(buf, aValue);
+    aWriter.WriteRaw(aKey, buf);
+}
+
+
+// BenchmarkInfoAggregator
+
+PipelineMetrics* BenchmarkInfoAggregator::Metrics() const
+{
+    for (auto provider : iProviders) {
+        auto metrics = dynamic_cast<PipelineMetrics*>(provider);
+        if (metrics != nullptr) {
+            return metrics;
+        }
+    }
+    return nullptr;
+}
+
+void BenchmarkInfoAggregator::WriteAllocators(WriterJsonObject& aWriter) const
+{
+    auto writerAllocators = aWriter.CreateArray("allocators", WriterJsonArray::WriteOnEmpty::eEmptyArray);
+    for (auto provider : iProviders) {
+        auto allocator = dynamic_cast<AllocatorBase*>(provider);
+        if (allocator == nullptr) {
+            continue;
+        }
+        auto writerAllocator = writerAllocators.CreateObject();
+        writerAllocator.WriteString("name", allocator->Name());
+        WriteUint(writerAllocator, "cellBytes", allocator->CellBytes());
+        WriteUint(writerAllocator, "cellsTotal", allocator->CellsTotal());
+        WriteUint(writerAllocator, "cellsUsedMax", allocator->CellsUsedMax());
+        WriteUint(writerAllocator, "cellsAllocatedMax", allocator->CellsAllocatedMax());
+        WriteUint(writerAllocator, "bytesAllocatedMax", (TUint64)allocator->CellsAllocatedMax() * allocator->CellBytes());
+        writerAllocator.WriteEnd();
+    }
+    writerAllocators.WriteEnd();
+}
+
+void BenchmarkInfoAggregator::Register(IInfoProvider& aProvider, std::vector<Brn>& /*aSupportedQueries*/)
+{
+    iProviders.push_back(&aProvider);
+}
+
+
+// NullVolume
+
+void NullVolume::ApplyVolumeMultiplier(TUint /*aValue*/)
+{
+}
+
+IVolumeMuterStepped::Status NullVolume::BeginMute()
+{
+    return Status::eComplete;
+}
+
+IVolumeMuterStepped::Status NullVolume::StepMute(TUint /*aJiffies*/)
+{
+    return Status::eComplete;
+}
+
+void NullVolume::SetMuted()
+{
+}
+
+IVolumeMuterStepped::Status NullVolume::BeginUnmute()
+{
+    return Status::eComplete;
+}
+
+IVolumeMuterStepped::Status NullVolume::StepUnmute(TUint /*aJiffies*/)
+{
+    return Status::eComplete;
+}
+
+void NullVolume::SetUnmuted()
+{
+}
+
+
+// NullAudioProcessor
+
+void NullAudioProcessor::ProcessFragment8(const Brx& /*aData*/, TUint /*aNumChannels*/)
+{
+}
+
+void NullAudioProcessor::ProcessFragment16(const Brx& /*aData*/, TUint /*aNumChannels*/)
+{
+}
+
+void NullAudioProcessor::ProcessFragment24(const Brx& /*aData*/, TUint /*aNumChannels*/)
+{
+}
+
+void NullAudioProcessor::ProcessFragment32(const Brx& /*aData*/, TUint /*aNumChannels*/)
+{
+}
+
+void NullAudioProcessor::ProcessFragment(const Brx& /*aData*/, TUint /*aNumChannels*/, TUint /*aSampleBlockBits*/)
+{
+}
+
+void NullAudioProcessor::BeginBlock()
+{
+}
+
+void NullAudioProcessor::EndBlock()
+{
+}
+
+void NullAudioProcessor::Flush()
+{
+}
+
+
+// NullAnimator
+
+const TUint NullAnimator::kSupportedMsgTypes =   eMode
+                                               | eDrain
+                                               | eHalt
+                                               | eDecodedStream
+                                               | ePlayable
+                                               | eQuit;
+
+NullAnimator::NullAnimator(IPipeline& aPipeline)
+    : PipelineElement(kSupportedMsgTypes)
+    , iPipeline(aPipeline)
+    , iLock("BNAN")
+    , iSemComplete("BNAN", 0)
+    , iStreamActive(false)
+    , iPipelineActive(false)
+    , iJiffies(0)
+    , iFormat(AudioFormat::Undefined)
+    , iSampleRate(0)
+    , iBitDepth(0)
+    , iNumChannels(0)
+    , iQuit(false)
+{
+    iPipeline.SetAnimator(*this);
+    iThread = new ThreadFunctor("PipelineAnimator", MakeFunctor(*this, &NullAnimator::AnimatorThread), kPrioritySystemHighest);
+    iThread->Start();
+}
+
+NullAnimator::~NullAnimator()
+{
+    delete iThread;
+}
+
+void NullAnimator::BeginStream()
+{
+    AutoMutex _(iLock);
+    iSemComplete.Clear();
+    iStreamActive = true;
+    iPipelineActive = false;
+    iJiffies = 0;
+    iCodecName.Replace(Brx::Empty());
+    iFormat = AudioFormat::Undefined;
+    iSampleRate = iBitDepth = iNumChannels = 0;
+}
+
+TBool NullAnimator::WaitStreamComplete(TUint aTimeoutMs)
+{
+    try {
+        iSemComplete.Wait(aTimeoutMs);
+    }
+    catch (Timeout&) {
+        AutoMutex _(iLock);
+        iStreamActive = false;
+        return false;
+    }
+    return true;
+}
+
+TUint64 NullAnimator::Jiffies() const
+{
+    AutoMutex _(iLock);
+    return iJiffies;
+}
+
+void NullAnimator::WriteStreamInfo(WriterJsonObject& aWriter) const
+{
+    AutoMutex _(iLock);
+    aWriter.WriteString("codec", iCodecName);
+    aWriter.WriteString("format", iFormat == AudioFormat::Dsd? "dsd" : "pcm");
+    WriteUint(aWriter, "sampleRate", iSampleRate);
+    WriteUint(aWriter, "bitDepth", iBitDepth);
+    WriteUint(aWriter, "channels", iNumChannels);
+    WriteUint(aWriter, "audioMs", iJiffies / Jiffies::kPerMs);
+}
+
+void NullAnimator::AnimatorThread()
+{
+    try {
+        while (!iQuit) {
+            Msg* msg = iPipeline.Pull();
+            msg = msg->Process(*this);
+            ASSERT(msg == nullptr);
+        }
+    }
+    catch (ThreadKill&) {}
+
+    // pull until the pipeline is emptied
+    while (!iQuit) {
+        Msg* msg = iPipeline.Pull();
+        msg = msg->Process(*this);
+        ASSERT(msg == nullptr);
+    }
+}
+
+void NullAnimator::StreamComplete()
+{
+    // iLock must be held
+    if (iStreamActive) {
+        iStreamActive = false;
+        iSemComplete.Signal();
+    }
+}
+
+Msg* NullAnimator::ProcessMsg(MsgMode* aMsg)
+{
+    aMsg->RemoveRef();
+    return nullptr;
+}
+
+Msg* NullAnimator::ProcessMsg(MsgDrain* aMsg)
+{
+    aMsg->ReportDrained();
+    aMsg->RemoveRef();
+    return nullptr;
+}
+
+Msg* NullAnimator::ProcessMsg(MsgHalt* aMsg)
+{
+    aMsg->ReportHalted();
+    aMsg->RemoveRef();
+    AutoMutex _(iLock);
+    if (iJiffies > 0) {
+        StreamComplete();
+    }
+    return nullptr;
+}
+
+Msg* NullAnimator::ProcessMsg(MsgDecodedStream* aMsg)
+{
+    const DecodedStreamInfo& stream = aMsg->StreamInfo();
+    {
+        AutoMutex _(iLock);
+        iCodecName.Replace(stream.CodecName());
+        iFormat = stream.Format();
+        iSampleRate = stream.SampleRate();
+        iBitDepth = stream.BitDepth();
+        iNumChannels = stream.NumChannels();
+    }
+    aMsg->RemoveRef();
+    return nullptr;
+}
+
+Msg* NullAnimator::ProcessMsg(MsgPlayable* aMsg)
+{
+    const TUint jiffies = aMsg->Jiffies();
+    if (iFormat == AudioFormat::Dsd) {
+        aMsg->Read(static_cast<IDsdProcessor&>(iProcessor));
+    }
+    else {
+        aMsg->Read(static_cast<IPcmProcessor&>(iProcessor));
+    }
+    aMsg->RemoveRef();
+    AutoMutex _(iLock);
+    iJiffies += jiffies;
+    return nullptr;
+}
+
+Msg* NullAnimator::ProcessMsg(MsgQuit* aMsg)
+{
+    iQuit = true;
+    aMsg->RemoveRef();
+    return nullptr;
+}
+
+TUint NullAnimator::PipelineAnimatorBufferJiffies() const
+{
+    return 0;
+}
+
+TUint NullAnimator::PipelineAnimatorDelayJiffies(AudioFormat /*aFormat*/, TUint /*aSampleRate*/,
+                                                 TUint /*aBitDepth*/, TUint /*aNumChannels*/) const
+{
+    return 0;
+}
+
+TUint NullAnimator::PipelineAnimatorDsdBlockSizeBytes() const
+{
+    return 1;
+}
+
+void NullAnimator::NotifyPipelineState(EPipelineState aState)
+{
+    AutoMutex _(iLock);
+    if (aState != EPipelineStopped) {
+        // ignore any (possibly late) report that the previous stream stopped
+        iPipelineActive = true;
+    }
+    else if (iPipelineActive && iJiffies == 0) {
+        StreamComplete();
+    }
+}
+
+void NullAnimator::NotifyMode(const Brx& /*aMode*/, const ModeInfo& /*aInfo*/, const ModeTransportControls& /*aTransportControls*/)
+{
+}
+
+void NullAnimator::NotifyTrack(Track& /*aTrack*/, const Brx& /*aMode*/, TBool /*aStartOfStream*/)
+{
+}
+
+void NullAnimator::NotifyMetaText(const Brx& /*aText*/)
+{
+}
+
+void NullAnimator::NotifyTime(TUint /*aSeconds*/, TUint /*aTrackDurationSeconds*/)
+{
+}
+
+void NullAnimator::NotifyStreamInfo(const DecodedStreamInfo& /*aStreamInfo*/)
+{
+}
+
+
+// BenchmarkPipeline
+
+BenchmarkPipeline::BenchmarkPipeline(Environment& aEnv, TBool aDsdSupported)
+    : iEnv(aEnv)
+{
+    iTrackFactory = new TrackFactory(iInfoAggregator, 4);
+    auto initParams = PipelineInitParams::New();
+    initParams->SetDsdSupported(aDsdSupported);
+    iPipeline = new PipelineManager(initParams, iInfoAggregator, *iTrackFactory);
+
+    iPipeline->Add(Codec::ContainerFactory::NewId3v2());
+    iPipeline->Add(Codec::ContainerFactory::NewMpeg4(iMimeTypes));
+    iPipeline->Add(Codec::ContainerFactory::NewMpegTs(iMimeTypes));
+    iPipeline->Add(Codec::CodecFactory::NewFlac(iMimeTypes));
+    iPipeline->Add(Codec::CodecFactory::NewWav(iMimeTypes));
+    iPipeline->Add(Codec::CodecFactory::NewAiff(iMimeTypes));
+    iPipeline->Add(Codec::CodecFactory::NewAifc(iMimeTypes));
+    iPipeline->Add(Codec::CodecFactory::NewAac(iMimeTypes));
+    iPipeline->Add(Codec::CodecFactory::NewAdts(iMimeTypes));
+    iPipeline->Add(Codec::CodecFactory::NewAlacApple(iMimeTypes));
+    iPipeline->Add(Codec::CodecFactory::NewDsdDsf(iMimeTypes));
+    iPipeline->Add(Codec::CodecFactory::NewDsdDff(iMimeTypes));
+    iPipeline->Add(Codec::CodecFactory::NewVorbis(iMimeTypes));
+    iPipeline->Add(Codec::CodecFactory::NewMp3(iMimeTypes));
+    iPipeline->Add(ProtocolFactory::NewTone(aEnv));
+    iPipeline->Add(ProtocolFactory::NewFile(aEnv));
+    iPipeline->Add(ProtocolFactory::NewHttp(aEnv, Brx::Empty()));
+    iUriProvider = new UriProviderSingleTrack("Benchmark", false, *iTrackFactory);
+    iPipeline->Add(iUriProvider);
+
+    iAnimator = new NullAnimator(*iPipeline);
+    iPipeline->AddObserver(*iAnimator);
+    iPipeline->Start(iVolume, iVolume);
+    iPipeline->SetMetricsEnabled(true);
+}
+
+BenchmarkPipeline::~BenchmarkPipeline()
+{
+    iPipeline->RemoveObserver(*iAnimator);
+    iPipeline->Quit();
+    delete iAnimator;
+    delete iPipeline;
+    delete iTrackFactory;
+}
+
+void BenchmarkPipeline::Run(const std::vector<Brn>& aUris, IWriter& aWriter)
+{
+    WriterJsonObject writer(aWriter);
+    writer.WriteString("simd", PcmKernels::SimdName());
+    auto writerResults = writer.CreateArray("results", WriterJsonArray::WriteOnEmpty::eEmptyArray);
+    for (auto& uri : aUris) {
+        RunStream(uri, writerResults);
+    }
+    writerResults.WriteEnd();
+    iInfoAggregator.WriteAllocators(writer);
+    TUint64 cpuUs, peakRssKb;
+    GetUsage(cpuUs, peakRssKb);
+    WriteUint(writer, "cpuUs", cpuUs);
+    WriteUint(writer, "peakRssKb", peakRssKb);
+    writer.WriteEnd();
+}
+
+void BenchmarkPipeline::RunStream(const Brx& aUri, WriterJsonArray& aWriterResults)
+{
+    PipelineMetrics* metrics = iInfoAggregator.Metrics();
+    ASSERT(metrics != nullptr);
+    metrics->Reset();
+    iAnimator->BeginStream();
+
+    TUint64 cpuStartUs, peakRssKb;
+    GetUsage(cpuStartUs, peakRssKb);
+    const TUint64 startUs = OsTimeInUs(iEnv.OsCtx());
+    Track* track = iUriProvider->SetTrack(aUri, Brx::Empty());
+    iPipeline->Begin(iUriProvider->Mode(), track->Id());
+    track->RemoveRef();
+    iPipeline->Play();
+    const TBool complete = iAnimator->WaitStreamComplete(kStreamTimeoutMs);
+    const TUint64 wallUs = OsTimeInUs(iEnv.OsCtx()) - startUs;
+    TUint64 cpuEndUs;
+    GetUsage(cpuEndUs, peakRssKb);
+    const TUint64 cpuUs = cpuEndUs - cpuStartUs;
+    if (!complete) {
+        iPipeline->Stop();
+    }
+
+    const TUint64 audioMs = iAnimator->Jiffies() / Jiffies::kPerMs;
+    auto writerResult = aWriterResults.CreateObject();
+    writerResult.WriteString("uri", aUri);
+    writerResult.WriteString("status", !complete? "timeout" : (audioMs == 0? "noaudio" : "ok"));
+    iAnimator->WriteStreamInfo(writerResult);
+    WriteUint(writerResult, "wallUs", wallUs);
+    WriteUint(writerResult, "cpuUs", cpuUs);
+    // cpu time (us) required to play one second of audio; 1000000 would be exactly realtime on one core
+    WriteUint(writerResult, "cpuUsPerAudioSecond", audioMs == 0? 0 : (cpuUs * 1000) / audioMs);
+    WriteUint(writerResult, "peakRssKb", peakRssKb);
+    WriterBwh metricsJson(4 * 1024);
+    metrics->WriteJson(metricsJson);
+    writerResult.WriteRaw("metrics", metricsJson.Buffer());
+    writerResult.WriteEnd();
+}
+
+void BenchmarkPipeline::GetUsage(TUint64& aCpuUs, TUint64& aPeakRssKb)
+{ // static
+#ifdef _WIN32
+    aCpuUs = 0;
+    aPeakRssKb = 0;
+#else
+    struct rusage usage;
+    (void)getrusage(RUSAGE_SELF, &usage);
+    aCpuUs  = ((TUint64)usage.ru_utime.tv_sec * 1000000) + usage.ru_utime.tv_usec;
+    aCpuUs += ((TUint64)usage.ru_stime.tv_sec * 1000000) + usage.ru_stime.tv_usec;
+    aPeakRssKb = usage.ru_maxrss;
+# ifdef __APPLE__
+    aPeakRssKb /= 1024; // reported in bytes rather than kB
+# endif
+#endif
+}
+
+
+// GeneratedCorpus
+
+GeneratedCorpus::GeneratedCorpus(const Brx& aDir, TUint aDurationSecs)
+    : iDir(aDir)
+    , iDurationSecs(aDurationSecs)
+{
+    WriteDsf("benchmark-stereo-dsd64.dsf", 2822400);
+    WriteDsf("benchmark-stereo-dsd128.dsf", 5644800);
+    WriteFlac("benchmark-stereo-96k-24bit.flac", 96000, 24, 2);
+    WriteFlac("benchmark-stereo-192k-24bit.flac", 192000, 24, 2);
+    WriteFlac("benchmark-6ch-96k-24bit.flac", 96000, 24, 6);
+}
+
+GeneratedCorpus::~GeneratedCorpus()
+{
+    for (auto path : iPaths) {
+        (void)::remove(path->PtrZ());
+        delete path;
+    }
+}
+
+void GeneratedCorpus::AppendUris(std::vector<Bwh*>& aUris) const
+{
+    // files that couldn't be written are still benchmarked; they'll be reported as failing
+    for (auto path : iPaths) {
+        auto uri = new Bwh(path->Bytes() + 7);
+        uri->Append("file://");
+        uri->Append(*path);
+        aUris.push_back(uri);
+    }
+}
+
+const TChar* GeneratedCorpus::AddPath(const TChar* aName)
+{
+    const Brn name(aName);
+    auto path = new Bwh(iDir.Bytes() + 1 + name.Bytes() + 1);
+    path->Append(iDir);
+    if (iDir.Bytes() > 0 && iDir[iDir.Bytes() - 1] != '/') {
+        path->Append('/');
+    }
+    path->Append(name);
+    iPaths.push_back(path);
+    return path->PtrZ();
+}
+
+void GeneratedCorpus::WriteDsf(const TChar* aName, TUint aSampleRate)
+{
+    static const TUint kNumChannels = 2;
+    const TUint64 blocks = (((TUint64)aSampleRate / 8) * iDurationSecs + kDsfBlockBytes - 1) / kDsfBlockBytes;
+    const TUint64 dataBytes = blocks * kDsfBlockBytes * kNumChannels;
+    const TChar* path = AddPath(aName);
+    IFile* file = nullptr;
+    try {
+        file = IFile::Open(path, eFileWriteOnly);
+        Bwh buf(kDsfBlockBytes * kNumChannels);
+        buf.Append("DSD ");
+        AppendLe(buf, 28, 8);
+        AppendLe(buf, kDsfHeaderBytes + dataBytes, 8);
+        AppendLe(buf, 0, 8);    // no metadata
+        buf.Append("fmt ");
+        AppendLe(buf, 52, 8);
+        AppendLe(buf, 1, 4);    // version
+        AppendLe(buf, 0, 4);    // format id (DSD raw)
+        AppendLe(buf, 2, 4);    // channel type (stereo)
+        AppendLe(buf, kNumChannels, 4);
+        AppendLe(buf, aSampleRate, 4);
+        AppendLe(buf, 1, 4);    // bits per sample
+        AppendLe(buf, blocks * kDsfBlockBytes * 8, 8);
+        AppendLe(buf, kDsfBlockBytes, 4);
+        AppendLe(buf, 0, 4);    // reserved
+        buf.Append("data");
+        AppendLe(buf, 12 + dataBytes, 8);
+        ASSERT(buf.Bytes() == kDsfHeaderBytes);
+        file->Write(buf);
+
+        // second order sigma-delta modulator, same signal on both channels, first sample in the lsb
+        const double step = 2 * 3.14159265358979323846 * kPitchHz / aSampleRate;
+        double integrator1 = 0;
+        double integrator2 = 0;
+        double feedback = 0;
+        TUint64 sample = 0;
+        TByte* ptr = const_cast<TByte*>(buf.Ptr());
+        buf.SetBytes(buf.MaxBytes());
+        for (TUint64 i=0; i<blocks; i++) {
+            for (TUint j=0; j<kDsfBlockBytes; j++) {
+                TByte byte = 0;
+                for (TUint bit=0; bit<8; bit++) {
+                    const double input = 0.5 * sin(step * sample++);
+                    integrator1 += input - feedback;
+                    integrator2 += integrator1 - feedback;
+                    feedback = (integrator2 >= 0? 1 : -1);
+                    byte |= (feedback > 0? 1 : 0) << bit;
+                }
+                ptr[j] = byte;                  // left
+                ptr[j + kDsfBlockBytes] = byte; // right
+            }
+            file->Write(buf);
+        }
+    }
+    catch (FileOpenError&) {}
+    catch (FileWriteError&) {}
+    delete file;
+}
+
+void GeneratedCorpus::WriteFlac(const TChar* aName, TUint aSampleRate, TUint aBitDepth, TUint aNumChannels)
+{
+    const TUint64 samples = (TUint64)aSampleRate * iDurationSecs;
+    const TChar* path = AddPath(aName);
+    FLAC__StreamEncoder* encoder = FLAC__stream_encoder_new();
+    if (encoder == nullptr) {
+        return;
+    }
+    (void)FLAC__stream_encoder_set_channels(encoder, aNumChannels);
+    (void)FLAC__stream_encoder_set_bits_per_sample(encoder, aBitDepth);
+    (void)FLAC__stream_encoder_set_sample_rate(encoder, aSampleRate);
+    (void)FLAC__stream_encoder_set_compression_level(encoder, 5);
+    (void)FLAC__stream_encoder_set_total_samples_estimate(encoder, samples);
+    if (FLAC__stream_encoder_init_file(encoder, path, nullptr, nullptr) == FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
+        // sine at half full scale plus a few lsbs of noise so that the residual isn't trivially compressible
+        const double step = 2 * 3.14159265358979323846 * kPitchHz / aSampleRate;
+        const double amplitude = (double)(1 << (aBitDepth - 2));
+        std::vector<FLAC__int32> block(kFlacBlockSamples * aNumChannels);
+        TUint32 lcg = 1;
+        TUint64 sample = 0;
+        TBool ok = true;
+        while (ok && sample < samples) {
+            const TUint count = (TUint)std::min((TUint64)kFlacBlockSamples, samples - sample);
+            for (TUint i=0; i<count; i++) {
+                const FLAC__int32 tone = (FLAC__int32)(amplitude * sin(step * sample++));
+                for (TUint j=0; j<aNumChannels; j++) {
+                    lcg = lcg * 1664525 + 1013904223;
+                    block[i * aNumChannels + j] = tone + (FLAC__int32)(lcg >> 24) - 128;
+                }
+            }
+            ok = (FLAC__stream_encoder_process_interleaved(encoder, &block[0], count) != 0);
+        }
+        (void)FLAC__stream_encoder_finish(encoder);
+    }
+    FLAC__stream_encoder_delete(encoder);
+}
+
+void GeneratedCorpus::AppendLe(Bwx& aBuf, TUint64 aValue, TUint aBytes)
+{ // static
+    for (TUint i=0; i<aBytes; i++) {
+        aBuf.Append((TByte)(aValue >> (8 * i)));
+    }
+}
+
+
+static const TChar* kCodecCorpus[] = {
+    "10s-stereo-44k.wav",
+    "10s-stereo-44k-24bit.wav",
+    "10s-stereo-44k-aiff.aiff",
+    "10s-stereo-44k-aifc.aifc",
+    "10s-stereo-44k-l5-16bit.flac",
+    "10s-stereo-44k-l5-24bit.flac",
+    "10s-stereo-44k-l5-16bit-ogg.flac",
+    "10s-stereo-44k-alac.m4a",
+    "10s-stereo-44k-24bit-alac.m4a",
+    "10s-stereo-44k-aac.m4a",
+    "10s-stereo-44k-128k.mp3",
+    "10s-stereo-44k-q5.ogg"
+};
+
+void TestBenchmarkPipeline(Environment& aEnv, const std::vector<Brn>& aArgs)
+{
+    OptionParser parser;
+    OptionString optionCorpus("-c", "--corpus", Brn(""), "uri prefix of TestCodec files (e.g. file:///path/to/files/ or http://server:port/path/)");
+    parser.AddOption(&optionCorpus);
+    OptionString optionUri("-u", "--uri", Brn(""), "additional stream to benchmark");
+    parser.AddOption(&optionUri);
+    OptionUint optionDuration("-d", "--duration", 10, "duration (seconds) of each synthetic stream");
+    parser.AddOption(&optionDuration);
+    OptionBool optionNoTones("", "--no-tones", "skip the synthetic tone corpus");
+    parser.AddOption(&optionNoTones);
+    OptionBool optionNoFiles("", "--no-files", "skip the generated DSD and hi-res FLAC corpus");
+    parser.AddOption(&optionNoFiles);
+    OptionString optionTmpDir("-t", "--tmp-dir", Brn("/tmp"), "directory to write the generated DSD and hi-res FLAC corpus to");
+    parser.AddOption(&optionTmpDir);
+    OptionBool optionDsdToPcm("", "--dsd-to-pcm", "convert DSD to PCM rather than playing it natively");
+    parser.AddOption(&optionDsdToPcm);
+    if (!parser.Parse(aArgs) || parser.HelpDisplayed()) {
+        return;
+    }
+
+    std::vector<Bwh*> uriBufs;
+    if (!optionNoTones.Value()) {
+        static const TUint kSampleRates[] = { 44100, 48000, 88200, 96000, 176400, 192000 };
+        static const TUint kBitDepths[] = { 16, 24 };
+        static const TUint kChannels[] = { 2, 6 };
+        for (auto sampleRate : kSampleRates) {
+            for (auto bitDepth : kBitDepths) {
+                for (auto channels : kChannels) {
+                    auto uri = new Bwh(128);
+                    uri->Append("tone://sine.wav?bitdepth=");
+                    Ascii::AppendDec(*uri, bitDepth);
+                    uri->Append("&samplerate=");
+                    Ascii::AppendDec(*uri, sampleRate);
+                    uri->Append("&pitch=1000&channels=");
+                    Ascii::AppendDec(*uri, channels);
+                    uri->Append("&duration=");
+                    Ascii::AppendDec(*uri, optionDuration.Value());
+                    uriBufs.push_back(uri);
+                }
+            }
+        }
+    }
+    GeneratedCorpus* generated = nullptr;
+    if (!optionNoFiles.Value()) {
+        generated = new GeneratedCorpus(optionTmpDir.Value(), optionDuration.Value());
+        generated->AppendUris(uriBufs);
+    }
+    if (optionCorpus.Value().Bytes() > 0) {
+        for (auto file : kCodecCorpus) {
+            const Brn name(file);
+            auto uri = new Bwh(optionCorpus.Value().Bytes() + name.Bytes());
+            uri->Append(optionCorpus.Value());
+            uri->Append(name);
+            uriBufs.push_back(uri);
+        }
+    }
+    if (optionUri.Value().Bytes() > 0) {
+        uriBufs.push_back(new Bwh(optionUri.Value()));
+    }
+    std::vector<Brn> uris;
+    for (auto uri : uriBufs) {
+        uris.push_back(Brn(*uri));
+    }
+
+    auto benchmark = new BenchmarkPipeline(aEnv, !optionDsdToPcm.Value());
+    WriterBwh writer(64 * 1024);
+    benchmark->Run(uris, writer);
+    delete benchmark;
+    Log::Print(writer.Buffer());
+    Log::Print("\n");
+
+    delete generated;
+    for (auto uri : uriBufs) {
+        delete uri;
+    }
+}
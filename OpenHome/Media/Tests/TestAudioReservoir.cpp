@@ -274,6 +274,47 @@ private:
     TUint iStarvationNotifications;
 };
 
+class SuiteDecodeAhead : public SuiteUnitTest, private IStreamHandler, private IFlushIdProvider
+{
+    static const TUint kMaxJiffies = Jiffies::kPerMs * 100;
+    static const TUint kDecodeAheadJiffies = Jiffies::kPerMs * 50;
+    static const TUint kSampleRate = 44100;
+    static const TUint kNumChannels = 2;
+    static const SpeakerProfile kProfile;
+public:
+    SuiteDecodeAhead();
+private: // from SuiteUnitTest
+    void Setup() override;
+    void TearDown() override;
+private: // from IStreamHandler
+    EStreamPlay OkToPlay(TUint aStreamId) override;
+    TUint TrySeek(TUint aStreamId, TUint64 aOffset) override;
+    TUint TryDiscard(TUint aJiffies) override;
+    TUint TryStop(TUint aStreamId) override;
+    void NotifyStarving(const Brx& aMode, TUint aStreamId, TBool aStarving) override;
+private: // from IFlushIdProvider
+    TUint NextFlushId() override;
+private:
+    void CreateReservoir(TUint aDecodeAheadJiffies);
+    void Queue(Msg* aMsg);
+    void Pull(TUint aCount);
+    Msg* CreateTrack();
+    Msg* CreateDecodedStream(TUint aStreamId);
+    Msg* CreateAudio();
+    TUint FillFirstStream();
+    void TestFirstStreamDoesNotDecodeAhead();
+    void TestDisabled();
+    void TestNextStreamDecodesAhead();
+    void TestAllowanceEndsWhenNextStreamPlays();
+    void TestRepeatedStreamDoesNotDecodeAhead();
+private:
+    AllocatorInfoLogger iInfoAggregator;
+    TrackFactory* iTrackFactory;
+    MsgFactory* iMsgFactory;
+    DecodedAudioReservoir* iReservoir;
+    TUint64 iTrackOffset;
+};
+
 } // namespace Media
 } // namespace OpenHome
 
@@ -301,7 +342,7 @@ SuiteAudioReservoir::SuiteAudioReservoir()
     init.SetMsgEncodedStreamCount(2);
     iMsgFactory = new MsgFactory(iInfoAggregator, init);
     iTrackFactory = new TrackFactory(iInfoAggregator, 1);
-    iReservoir = new DecodedAudioReservoir(*iMsgFactory, *this, kReservoirSize, kMaxStreams, 0);
+    iReservoir = new DecodedAudioReservoir(*iMsgFactory, *this, kReservoirSize, kMaxStreams, 0, 0);
     iNextFlushId = MsgFlush::kIdInvalid;
     iThread = new ThreadFunctor("TEST", MakeFunctor(*this, &SuiteAudioReservoir::MsgEnqueueThread));
     iThread->Start();
@@ -929,7 +970,7 @@ void SuiteGorger::Setup()
     init.SetMsgFlushCount(2);
     init.SetMsgModeCount(3);
     iMsgFactory = new MsgFactory(iInfoAggregator, init);
-    iDecodedReservoir = new DecodedAudioReservoir(*iMsgFactory, *this, kGorgeSize * 3, 10, kGorgeSize);
+    iDecodedReservoir = new DecodedAudioReservoir(*iMsgFactory, *this, kGorgeSize * 3, 10, kGorgeSize, 0);
     iNextFlushId = MsgFlush::kIdInvalid;
     iLastPulledMsg = ENone;
     iTrackOffset = 0;
@@ -1323,6 +1364,197 @@ void SuiteGorger::TestStarvationEnablesGorging()
 }
 
 
+// SuiteDecodeAhead
+
+const SpeakerProfile SuiteDecodeAhead::kProfile(2);
+
+SuiteDecodeAhead::SuiteDecodeAhead()
+    : SuiteUnitTest("DecodeAhead")
+    , iReservoir(nullptr)
+{
+    AddTest(MakeFunctor(*this, &SuiteDecodeAhead::TestFirstStreamDoesNotDecodeAhead), "TestFirstStreamDoesNotDecodeAhead");
+    AddTest(MakeFunctor(*this, &SuiteDecodeAhead::TestDisabled), "TestDisabled");
+    AddTest(MakeFunctor(*this, &SuiteDecodeAhead::TestNextStreamDecodesAhead), "TestNextStreamDecodesAhead");
+    AddTest(MakeFunctor(*this, &SuiteDecodeAhead::TestAllowanceEndsWhenNextStreamPlays), "TestAllowanceEndsWhenNextStreamPlays");
+    AddTest(MakeFunctor(*this, &SuiteDecodeAhead::TestRepeatedStreamDoesNotDecodeAhead), "TestRepeatedStreamDoesNotDecodeAhead");
+}
+
+void SuiteDecodeAhead::Setup()
+{
+    iTrackFactory = new TrackFactory(iInfoAggregator, 5);
+    MsgFactoryInitParams init;
+    init.SetMsgAudioPcmCount(52, 50);
+    init.SetMsgDecodedStreamCount(6);
+    init.SetMsgTrackCount(3);
+    iMsgFactory = new MsgFactory(iInfoAggregator, init);
+    CreateReservoir(kDecodeAheadJiffies);
+    iTrackOffset = 0;
+}
+
+void SuiteDecodeAhead::TearDown()
+{
+    delete iReservoir;
+    iReservoir = nullptr;
+    delete iMsgFactory;
+    delete iTrackFactory;
+}
+
+EStreamPlay SuiteDecodeAhead::OkToPlay(TUint /*aStreamId*/)
+{
+    ASSERTS();
+    return ePlayNo;
+}
+
+TUint SuiteDecodeAhead::TrySeek(TUint /*aStreamId*/, TUint64 /*aOffset*/)
+{
+    ASSERTS();
+    return MsgFlush::kIdInvalid;
+}
+
+TUint SuiteDecodeAhead::TryDiscard(TUint /*aJiffies*/)
+{
+    ASSERTS();
+    return MsgFlush::kIdInvalid;
+}
+
+TUint SuiteDecodeAhead::TryStop(TUint /*aStreamId*/)
+{
+    ASSERTS();
+    return MsgFlush::kIdInvalid;
+}
+
+void SuiteDecodeAhead::NotifyStarving(const Brx& /*aMode*/, TUint /*aStreamId*/, TBool /*aStarving*/)
+{
+}
+
+TUint SuiteDecodeAhead::NextFlushId()
+{
+    ASSERTS();
+    return MsgFlush::kIdInvalid;
+}
+
+void SuiteDecodeAhead::CreateReservoir(TUint aDecodeAheadJiffies)
+{
+    delete iReservoir;
+    iReservoir = new DecodedAudioReservoir(*iMsgFactory, *this, kMaxJiffies, 10, 0, aDecodeAheadJiffies);
+}
+
+void SuiteDecodeAhead::Queue(Msg* aMsg)
+{
+    iReservoir->Push(aMsg);
+}
+
+void SuiteDecodeAhead::Pull(TUint aCount)
+{
+    while (aCount-- > 0) {
+        iReservoir->Pull()->RemoveRef();
+    }
+}
+
+Msg* SuiteDecodeAhead::CreateTrack()
+{
+    Track* track = iTrackFactory->CreateTrack(Brx::Empty(), Brx::Empty());
+    Msg* msg = iMsgFactory->CreateMsgTrack(*track);
+    track->RemoveRef();
+    return msg;
+}
+
+Msg* SuiteDecodeAhead::CreateDecodedStream(TUint aStreamId)
+{
+    iTrackOffset = 0;
+    return iMsgFactory->CreateMsgDecodedStream(aStreamId, 100, 24, kSampleRate, kNumChannels, Brn("notARealCodec"), 1LL<<38, 0, true, true, false, false, AudioFormat::Pcm, Multiroom::Allowed, kProfile, this);
+}
+
+Msg* SuiteDecodeAhead::CreateAudio()
+{
+    static const TUint kDataBytes = 3 * 1024;
+    TByte encodedAudioData[kDataBytes];
+    (void)memset(encodedAudioData, 0x7f, kDataBytes);
+    Brn encodedAudioBuf(encodedAudioData, kDataBytes);
+    MsgAudioPcm* audio = iMsgFactory->CreateMsgAudioPcm(encodedAudioBuf, kNumChannels, kSampleRate, 24, AudioDataEndian::Little, iTrackOffset);
+    iTrackOffset += audio->Jiffies();
+    return audio;
+}
+
+TUint SuiteDecodeAhead::FillFirstStream()
+{
+    // Fill the reservoir with the first stream then pull a single msg so the next track can be pushed.
+    // Returns the number of msgs still to be pulled before the first stream has played out.
+    Queue(CreateTrack());
+    Queue(CreateDecodedStream(1));
+    TUint count = 2;
+    while (!iReservoir->IsFull()) {
+        Queue(CreateAudio());
+        count++;
+    }
+    Pull(3);
+    return count - 3;
+}
+
+void SuiteDecodeAhead::TestFirstStreamDoesNotDecodeAhead()
+{
+    Queue(CreateTrack());
+    Queue(CreateDecodedStream(1));
+    TEST(!iReservoir->iDecodingAhead.load());
+    while (!iReservoir->IsFull()) {
+        Queue(CreateAudio());
+    }
+    TEST(iReservoir->SizeInJiffies() < kMaxJiffies + kDecodeAheadJiffies);
+}
+
+void SuiteDecodeAhead::TestDisabled()
+{
+    CreateReservoir(0);
+    (void)FillFirstStream();
+    Queue(CreateTrack());
+    Queue(CreateDecodedStream(2));
+    TEST(!iReservoir->iDecodingAhead.load());
+    while (!iReservoir->IsFull()) {
+        Queue(CreateAudio());
+    }
+    TEST(iReservoir->SizeInJiffies() < kMaxJiffies + kDecodeAheadJiffies);
+}
+
+void SuiteDecodeAhead::TestNextStreamDecodesAhead()
+{
+    (void)FillFirstStream();
+    Queue(CreateTrack());
+    Queue(CreateDecodedStream(2));
+    TEST(iReservoir->iDecodingAhead.load());
+    TEST(!iReservoir->IsFull());
+    while (!iReservoir->IsFull()) {
+        Queue(CreateAudio());
+    }
+    TEST(iReservoir->SizeInJiffies() > kMaxJiffies + kDecodeAheadJiffies);
+}
+
+void SuiteDecodeAhead::TestAllowanceEndsWhenNextStreamPlays()
+{
+    TUint remaining = FillFirstStream();
+    Queue(CreateTrack());
+    Queue(CreateDecodedStream(2));
+    while (!iReservoir->IsFull()) {
+        Queue(CreateAudio());
+    }
+    Pull(remaining + 1); // remainder of first stream plus second stream's MsgTrack
+    TEST(iReservoir->iDecodingAhead.load());
+    Pull(1);             // MsgDecodedStream for second stream
+    TEST(!iReservoir->iDecodingAhead.load());
+    while (!iReservoir->IsFull()) {
+        Queue(CreateAudio());
+    }
+    TEST(iReservoir->SizeInJiffies() < kMaxJiffies + kDecodeAheadJiffies);
+}
+
+void SuiteDecodeAhead::TestRepeatedStreamDoesNotDecodeAhead()
+{
+    // a codec outputs a new MsgDecodedStream for the current stream after a seek
+    (void)FillFirstStream();
+    Queue(CreateDecodedStream(1));
+    TEST(!iReservoir->iDecodingAhead.load());
+}
+
+
 
 void TestAudioReservoir()
 {
@@ -1330,5 +1562,6 @@ void TestAudioReservoir()
     runner.Add(new SuiteAudioReservoir());
     runner.Add(new SuiteEncodedReservoir());
     runner.Add(new SuiteGorger());
+    runner.Add(new SuiteDecodeAhead());
     runner.Run();
 }
@@ -9,8 +9,12 @@
 #include <OpenHome/Private/Arch.h>
 #include <OpenHome/Media/Utils/ProcessorAudioUtils.h>
 #include <OpenHome/Media/MimeTypeList.h>
+#include <OpenHome/ThreadPool.h>
 
+#include <FLAC/stream_encoder.h>
+#include <algorithm>
 #include <list>
+#include <vector>
 #include <limits.h>
 
 using namespace OpenHome;
@@ -45,6 +49,22 @@ protected:
     TUint64 iTrackOffset;
 };
 
+class TestCodecControllerSignatureCodec : public Codec::CodecBase
+{
+public:
+    TestCodecControllerSignatureCodec(const TChar* aId, Signature aSignature);
+    TUint RecogniseCount() const;
+public: // from CodecBase
+    Signature CheckSignature(const Brx& aHead) const override;
+    TBool Recognise(const EncodedStreamInfo& aStreamInfo) override;
+    void StreamInitialise() override;
+    void Process() override;
+    TBool TrySeek(TUint aStreamId, TUint64 aSample) override;
+private:
+    const Signature iSignature;
+    TUint iRecogniseCount;
+};
+
 class SuiteCodecControllerBase : public SuiteUnitTest
                                , private IPipelineElementUpstream
                                , private IPipelineElementDownstream
@@ -179,8 +199,12 @@ private:
     void TestTrackEncodedStreamMetatext();
     void TestSeek();
     void TestSeekNewStream();
+    void TestSignatureMatch();
+    void TestSignatureNoMatch();
 private:
     Semaphore* iSemSeek;
+    TestCodecControllerSignatureCodec* iCodecNoMatch;
+    TestCodecControllerSignatureCodec* iCodecUnknown;
     TUint iHandle;
     TUint iExpectedFlushId;
     TUint iFlushId;
@@ -287,6 +311,34 @@ private:
     TestCodecControllerDummyCodecBuffered* iCodec;
 };
 
+class SuiteCodecControllerFlacParallel : public SuiteCodecControllerBase, private IMimeTypeList
+{
+private:
+    static const TUint kMaxFramesInFlight = 4;
+    static const TUint kBlockSize = 4096;
+    static const TUint kNumFrames = 21;
+    static const TUint kSamples = (kNumFrames - 1) * kBlockSize + 1000; // final frame is shorter than the rest
+public:
+    SuiteCodecControllerFlacParallel();
+private: // from SuiteCodecControllerBase
+    void Setup() override;
+    void TearDown() override;
+private: // from IMimeTypeList
+    void Add(const TChar* aMimeType) override;
+private:
+    static FLAC__StreamEncoderWriteStatus EncoderWrite(const FLAC__StreamEncoder* aEncoder, const FLAC__byte aBuffer[],
+                                                       size_t aBytes, unsigned aSamples, unsigned aCurrentFrame, void* aClientData);
+    void Encode();
+    void QueueAudio(const TByte* aPtr, TUint aBytes);
+    TUint64 PullAudio();
+    void TestRestreamMidFrame();
+    void TestTrailingTag();
+private:
+    ThreadPool* iThreadPool;
+    std::vector<TByte> iEncoded;
+    std::vector<TUint> iFrameStarts;
+};
+
 } // namespace Media
 } // namespace OpenHome
 
@@ -613,6 +665,8 @@ SuiteCodecControllerStream::SuiteCodecControllerStream()
     AddTest(MakeFunctor(*this, &SuiteCodecControllerStream::TestTruncatedStream), "TestTruncatedStream");
     AddTest(MakeFunctor(*this, &SuiteCodecControllerStream::TestSeek), "TestSeek");
     AddTest(MakeFunctor(*this, &SuiteCodecControllerStream::TestSeekNewStream), "TestSeekNewStream");
+    AddTest(MakeFunctor(*this, &SuiteCodecControllerStream::TestSignatureMatch), "TestSignatureMatch");
+    AddTest(MakeFunctor(*this, &SuiteCodecControllerStream::TestSignatureNoMatch), "TestSignatureNoMatch");
 }
 
 void SuiteCodecControllerStream::Setup()
@@ -622,11 +676,16 @@ void SuiteCodecControllerStream::Setup()
     iHandle = ISeeker::kHandleError;
     iExpectedFlushId = iFlushId = MsgFlush::kIdInvalid;
     iController->AddCodec(CodecFactory::NewWav(*this));
+    iCodecNoMatch = new TestCodecControllerSignatureCodec("SIGN", Codec::CodecBase::Signature::eNoMatch);
+    iController->AddCodec(iCodecNoMatch);  // Takes ownership.
+    iCodecUnknown = new TestCodecControllerSignatureCodec("SIGU", Codec::CodecBase::Signature::eUnknown);
+    iController->AddCodec(iCodecUnknown);  // Takes ownership.
     iController->Start();
 }
 
 void SuiteCodecControllerStream::TearDown()
 {
+    iCodecNoMatch = iCodecUnknown = nullptr;
     delete iSemSeek;
     SuiteCodecControllerBase::TearDown();
 }
@@ -1082,6 +1141,39 @@ void SuiteCodecControllerStream::TestSeekNewStream()
     TEST(iLastReceivedMsg == EMsgEncodedStream);
 }
 
+void SuiteCodecControllerStream::TestSignatureMatch()
+{
+    // WAV claims the stream from its header so no other codec should be asked to recognise it.
+    static const TUint kAudioBytes = 1024;
+    iTotalBytes = kWavHeaderBytes + kAudioBytes;
+    Queue(CreateTrack());
+    PullNext(EMsgTrack);
+    Queue(CreateEncodedStream());
+    PullNext(EMsgEncodedStream);
+    Queue(CreateAudio(true, iTotalBytes));
+    PullNext(EMsgDecodedStream);
+    PullNext(EMsgAudioPcm);
+    TEST(iCodecNoMatch->RecogniseCount() == 0);
+    TEST(iCodecUnknown->RecogniseCount() == 0);
+}
+
+void SuiteCodecControllerStream::TestSignatureNoMatch()
+{
+    // Nothing claims the stream.  Codecs that rule it out are skipped; the rest are tried as before.
+    static const TUint kAudioBytes = 6144;
+    iTotalBytes = kWavHeaderBytes + kAudioBytes;
+    Queue(CreateTrack());
+    PullNext(EMsgTrack);
+    Queue(CreateEncodedStream());
+    PullNext(EMsgEncodedStream);
+    Queue(CreateAudio(false, kMaxMsgBytes));
+
+    iSemStop->Wait();
+    TEST(iStopCount == 1);
+    TEST(iCodecNoMatch->RecogniseCount() == 0);
+    TEST(iCodecUnknown->RecogniseCount() == 1);
+}
+
 
 // SuiteCodecControllerPcmSize
 
@@ -1245,6 +1337,48 @@ void TestCodecControllerDummyCodecStreamInitialise::StreamInitialise()
 }
 
 
+// TestCodecControllerSignatureCodec
+
+TestCodecControllerSignatureCodec::TestCodecControllerSignatureCodec(const TChar* aId, Signature aSignature)
+    : CodecBase(aId, CodecBase::RecognitionComplexity::kCostLow)
+    , iSignature(aSignature)
+    , iRecogniseCount(0)
+{
+}
+
+TUint TestCodecControllerSignatureCodec::RecogniseCount() const
+{
+    return iRecogniseCount;
+}
+
+Codec::CodecBase::Signature TestCodecControllerSignatureCodec::CheckSignature(const Brx& /*aHead*/) const
+{
+    return iSignature;
+}
+
+TBool TestCodecControllerSignatureCodec::Recognise(const EncodedStreamInfo& /*aStreamInfo*/)
+{
+    iRecogniseCount++;
+    return false;
+}
+
+void TestCodecControllerSignatureCodec::StreamInitialise()
+{
+    ASSERTS();
+}
+
+void TestCodecControllerSignatureCodec::Process()
+{
+    ASSERTS();
+}
+
+TBool TestCodecControllerSignatureCodec::TrySeek(TUint /*aStreamId*/, TUint64 /*aSample*/)
+{
+    ASSERTS();
+    return false;
+}
+
+
 // SuiteCodecControllerStopDuringStreamInit
 
 SuiteCodecControllerStopDuringStreamInit::SuiteCodecControllerStopDuringStreamInit()
@@ -1520,6 +1654,131 @@ void SuiteCodecControllerUnexpectedFlush::TestUnexpectedFlush()
 
 
 
+// SuiteCodecControllerFlacParallel
+
+SuiteCodecControllerFlacParallel::SuiteCodecControllerFlacParallel()
+    : SuiteCodecControllerBase("SuiteCodecControllerFlacParallel")
+{
+    AddTest(MakeFunctor(*this, &SuiteCodecControllerFlacParallel::TestRestreamMidFrame), "TestRestreamMidFrame");
+    AddTest(MakeFunctor(*this, &SuiteCodecControllerFlacParallel::TestTrailingTag), "TestTrailingTag");
+}
+
+void SuiteCodecControllerFlacParallel::Setup()
+{
+    SuiteCodecControllerBase::Setup();
+    iThreadPool = new ThreadPool(kMaxFramesInFlight, 1, 1);
+    iController->AddCodec(CodecFactory::NewFlac(*this, *iThreadPool, kMaxFramesInFlight));
+    iController->Start();
+    Encode();
+}
+
+void SuiteCodecControllerFlacParallel::TearDown()
+{
+    SuiteCodecControllerBase::TearDown();
+    delete iThreadPool;
+}
+
+void SuiteCodecControllerFlacParallel::Add(const TChar* /*aMimeType*/)
+{
+}
+
+FLAC__StreamEncoderWriteStatus SuiteCodecControllerFlacParallel::EncoderWrite(const FLAC__StreamEncoder* /*aEncoder*/, const FLAC__byte aBuffer[],
+                                                                              size_t aBytes, unsigned aSamples, unsigned /*aCurrentFrame*/, void* aClientData)
+{ // static
+    auto suite = reinterpret_cast<SuiteCodecControllerFlacParallel*>(aClientData);
+    if (aSamples > 0) {
+        // libFLAC writes each frame in a single call
+        suite->iFrameStarts.push_back((TUint)suite->iEncoded.size());
+    }
+    suite->iEncoded.insert(suite->iEncoded.end(), aBuffer, aBuffer + aBytes);
+    return FLAC__STREAM_ENCODER_WRITE_STATUS_OK;
+}
+
+void SuiteCodecControllerFlacParallel::Encode()
+{
+    // every subsample is 0x7f7f, as SuiteCodecControllerBase::ProcessMsg(MsgAudioPcm*) expects
+    iEncoded.clear();
+    iFrameStarts.clear();
+    FLAC__StreamEncoder* encoder = FLAC__stream_encoder_new();
+    ASSERT(encoder != nullptr);
+    (void)FLAC__stream_encoder_set_channels(encoder, kNumChannels);
+    (void)FLAC__stream_encoder_set_bits_per_sample(encoder, 16);
+    (void)FLAC__stream_encoder_set_sample_rate(encoder, kSampleRate);
+    (void)FLAC__stream_encoder_set_blocksize(encoder, kBlockSize);
+    // there's no seek callback so STREAMINFO's total samples comes from this estimate
+    (void)FLAC__stream_encoder_set_total_samples_estimate(encoder, kSamples);
+    ASSERT(FLAC__stream_encoder_init_stream(encoder, EncoderWrite, nullptr, nullptr, nullptr, this) == FLAC__STREAM_ENCODER_INIT_STATUS_OK);
+    std::vector<FLAC__int32> samples(kSamples * kNumChannels, 0x7f7f);
+    ASSERT(FLAC__stream_encoder_process_interleaved(encoder, &samples[0], kSamples));
+    ASSERT(FLAC__stream_encoder_finish(encoder));
+    FLAC__stream_encoder_delete(encoder);
+    ASSERT(iFrameStarts.size() == kNumFrames);
+}
+
+void SuiteCodecControllerFlacParallel::QueueAudio(const TByte* aPtr, TUint aBytes)
+{
+    for (TUint offset=0; offset<aBytes; offset+=kMaxMsgBytes) {
+        const TUint bytes = std::min((TUint)kMaxMsgBytes, aBytes - offset);
+        Queue(iMsgFactory->CreateMsgAudioEncoded(Brn(aPtr + offset, bytes)));
+    }
+}
+
+TUint64 SuiteCodecControllerFlacParallel::PullAudio()
+{
+    // returns jiffies of audio pulled before the next msg of any other type
+    const TUint64 start = iJiffies;
+    do {
+        PullNext();
+    } while (iLastReceivedMsg == EMsgAudioPcm);
+    return iJiffies - start;
+}
+
+void SuiteCodecControllerFlacParallel::TestRestreamMidFrame()
+{
+    static const TUint kTruncatedFrame = 10;
+    const TUint64 jiffiesPerSample = Jiffies::PerSample(kSampleRate);
+
+    Queue(CreateTrack());
+    PullNext(EMsgTrack);
+    Queue(CreateEncodedStream());
+    PullNext(EMsgEncodedStream);
+    // stream is restarted part way through a frame (all but its CRC-16 have been read)
+    QueueAudio(&iEncoded[0], iFrameStarts[kTruncatedFrame + 1] - 2);
+    Queue(CreateEncodedStream());
+    PullNext(EMsgDecodedStream);
+    // frames still being decoded when the restream was noticed are output ahead of the new stream
+    TEST(PullAudio() == (TUint64)kTruncatedFrame * kBlockSize * jiffiesPerSample);
+    TEST(iLastReceivedMsg == EMsgEncodedStream);
+
+    QueueAudio(&iEncoded[0], (TUint)iEncoded.size());
+    Queue(iMsgFactory->CreateMsgHalt());
+    PullNext(EMsgDecodedStream);
+    TEST(PullAudio() == (TUint64)kSamples * jiffiesPerSample);
+    TEST(iLastReceivedMsg == EMsgHalt);
+}
+
+void SuiteCodecControllerFlacParallel::TestTrailingTag()
+{
+    // ID3v1 tag; not covered by the final frame's CRC-16
+    std::vector<TByte> tag(128, ' ');
+    tag[0] = 'T';
+    tag[1] = 'A';
+    tag[2] = 'G';
+    iEncoded.insert(iEncoded.end(), tag.begin(), tag.end());
+
+    Queue(CreateTrack());
+    PullNext(EMsgTrack);
+    Queue(CreateEncodedStream());
+    PullNext(EMsgEncodedStream);
+    QueueAudio(&iEncoded[0], (TUint)iEncoded.size());
+    Queue(iMsgFactory->CreateMsgHalt());
+    PullNext(EMsgDecodedStream);
+    TEST(PullAudio() == (TUint64)kSamples * Jiffies::PerSample(kSampleRate));
+    TEST(iLastReceivedMsg == EMsgHalt);
+}
+
+
+
 void TestCodecController()
 {
     Runner runner("CodecController tests\n");
@@ -1528,6 +1787,7 @@ void TestCodecController()
     runner.Add(new SuiteCodecControllerStopDuringStreamInit());
     runner.Add(new SuiteCodecControllerSeekInvalid());
     runner.Add(new SuiteCodecControllerUnexpectedFlush());
+    runner.Add(new SuiteCodecControllerFlacParallel());
     runner.Run();
 }
 
@@ -0,0 +1,658 @@
+#include <OpenHome/Private/TestFramework.h>
+#include <OpenHome/Private/SuiteUnitTest.h>
+#include <OpenHome/Media/Pipeline/DsdToPcm.h>
+#include <OpenHome/Media/Pipeline/Msg.h>
+#include <OpenHome/Media/Utils/AllocatorInfoLogger.h>
+#include <OpenHome/Media/Utils/ProcessorAudioUtils.h>
+#include <OpenHome/Functor.h>
+
+#include <vector>
+#include <string.h>
+#include <math.h>
+
+using namespace OpenHome;
+using namespace OpenHome::TestFramework;
+using namespace OpenHome::Media;
+
+namespace OpenHome {
+namespace Media {
+
+class SuiteDsdToPcm : public SuiteUnitTest
+                    , private IPipelineElementDownstream
+                    , private IMsgProcessor
+                    , private IPipelineAnimator
+                    , private IStreamHandler
+{
+    static const TUint kSampleRateDsd64 = 2822400;
+    static const TUint kSampleRateDsd128 = 5644800;
+    static const TUint kSampleRatePcm = 44100;
+    static const TUint kChannels = 2;
+    static const TUint kSampleBlockBits = 32;
+    static const TUint kDsdBytes = 4096;
+    static const TUint kSettleSamples = 64; // allow for filter delay
+    static const TUint kToneBytes = 16 * kDsdBytes;
+    static const TUint kToneSettleSamples = 256;
+    static const TByte kDsdSilence = 0x69;
+    static const TInt32 kFullScale = 0x7fffff;
+    static const TInt32 kFullScaleTolerance = 0x100; // filter taps are single precision
+    static const SpeakerProfile kProfile;
+public:
+    SuiteDsdToPcm();
+private: // from SuiteUnitTest
+    void Setup() override;
+    void TearDown() override;
+private:
+    enum EMsgType
+    {
+        EMsgNone
+       ,EMsgEncodedStream
+       ,EMsgDecodedStream
+       ,EMsgAudioPcm
+       ,EMsgAudioDsd
+       ,EMsgOther
+    };
+private:
+    void Create(TBool aDsdSupported);
+    void PushEncodedStream(Multiroom aMultiroom);
+    void PushDecodedStream(AudioFormat aFormat, TUint aSampleRate, TUint64 aSampleStart);
+    void PushDsd(TUint aSampleBlockBits);
+    void PushDsdSigmaDelta(double aLevel, double aFrequency, TUint aBytes);
+    TInt32 SettledSubsample(TUint aChannel) const;
+    double ToneLevelDb(TUint aChannel, double aFrequency, double aLevel) const;
+    void CheckPassband(const double* aFrequencies, TUint aCount);
+    void CheckStopband(const double* aFrequencies, TUint aCount);
+    void PcmPassesThrough();
+    void DsdPassesThroughWhenSupported();
+    void DsdConvertedWhenAnimatorRejectsDsd();
+    void DecodedStreamConverted();
+    void LowerRateSelected();
+    void SilenceConverted();
+    void ChannelsDeinterleaved();
+    void BitInterleavedBlocks();
+    void DcLevelPreserved();
+    void PassbandFlat176k();
+    void PassbandFlat88k();
+    void StopbandRejected176k();
+    void StopbandRejected88k();
+private: // from IPipelineElementDownstream
+    void Push(Msg* aMsg) override;
+private: // from IMsgProcessor
+    Msg* ProcessMsg(MsgMode* aMsg) override;
+    Msg* ProcessMsg(MsgTrack* aMsg) override;
+    Msg* ProcessMsg(MsgDrain* aMsg) override;
+    Msg* ProcessMsg(MsgDelay* aMsg) override;
+    Msg* ProcessMsg(MsgEncodedStream* aMsg) override;
+    Msg* ProcessMsg(MsgAudioEncoded* aMsg) override;
+    Msg* ProcessMsg(MsgMetaText* aMsg) override;
+    Msg* ProcessMsg(MsgStreamInterrupted* aMsg) override;
+    Msg* ProcessMsg(MsgHalt* aMsg) override;
+    Msg* ProcessMsg(MsgFlush* aMsg) override;
+    Msg* ProcessMsg(MsgWait* aMsg) override;
+    Msg* ProcessMsg(MsgDecodedStream* aMsg) override;
+    Msg* ProcessMsg(MsgBitRate* aMsg) override;
+    Msg* ProcessMsg(MsgAudioPcm* aMsg) override;
+    Msg* ProcessMsg(MsgAudioDsd* aMsg) override;
+    Msg* ProcessMsg(MsgSilence* aMsg) override;
+    Msg* ProcessMsg(MsgPlayable* aMsg) override;
+    Msg* ProcessMsg(MsgQuit* aMsg) override;
+private: // from IPipelineAnimator
+    TUint PipelineAnimatorBufferJiffies() const override;
+    TUint PipelineAnimatorDelayJiffies(AudioFormat aFormat, TUint aSampleRate, TUint aBitDepth, TUint aNumChannels) const override;
+    TUint PipelineAnimatorDsdBlockSizeBytes() const override;
+private: // from IStreamHandler
+    EStreamPlay OkToPlay(TUint aStreamId) override;
+    TUint TrySeek(TUint aStreamId, TUint64 aOffset) override;
+    TUint TryDiscard(TUint aJiffies) override;
+    TUint TryStop(TUint aStreamId) override;
+    void NotifyStarving(const Brx& aMode, TUint aStreamId, TBool aStarving) override;
+private:
+    MsgFactory* iMsgFactory;
+    AllocatorInfoLogger iInfoAggregator;
+    DsdToPcm* iDsdToPcm;
+    EMsgType iLastMsg;
+    TBool iAnimatorSupportsDsd;
+    TUint iAnimatorMaxSampleRate;
+    TByte iDsd[kDsdBytes];
+    TUint64 iTrackOffsetTx;
+    TUint64 iJiffiesTx;
+    TUint64 iTrackOffsetRx;
+    TUint64 iJiffiesRx;
+    Multiroom iMultiroom;
+    TUint iSampleRate;
+    TUint iBitDepth;
+    TUint64 iSampleStart;
+    AudioFormat iFormat;
+    IStreamHandler* iStreamHandler;
+    std::vector<TInt32> iSubsamples[kChannels];
+};
+
+} // namespace Media
+} // namespace OpenHome
+
+
+const SpeakerProfile SuiteDsdToPcm::kProfile(2);
+
+SuiteDsdToPcm::SuiteDsdToPcm()
+    : SuiteUnitTest("DsdToPcm")
+{
+    AddTest(MakeFunctor(*this, &SuiteDsdToPcm::PcmPassesThrough), "PcmPassesThrough");
+    AddTest(MakeFunctor(*this, &SuiteDsdToPcm::DsdPassesThroughWhenSupported), "DsdPassesThroughWhenSupported");
+    AddTest(MakeFunctor(*this, &SuiteDsdToPcm::DsdConvertedWhenAnimatorRejectsDsd), "DsdConvertedWhenAnimatorRejectsDsd");
+    AddTest(MakeFunctor(*this, &SuiteDsdToPcm::DecodedStreamConverted), "DecodedStreamConverted");
+    AddTest(MakeFunctor(*this, &SuiteDsdToPcm::LowerRateSelected), "LowerRateSelected");
+    AddTest(MakeFunctor(*this, &SuiteDsdToPcm::SilenceConverted), "SilenceConverted");
+    AddTest(MakeFunctor(*this, &SuiteDsdToPcm::ChannelsDeinterleaved), "ChannelsDeinterleaved");
+    AddTest(MakeFunctor(*this, &SuiteDsdToPcm::BitInterleavedBlocks), "BitInterleavedBlocks");
+    AddTest(MakeFunctor(*this, &SuiteDsdToPcm::DcLevelPreserved), "DcLevelPreserved");
+    AddTest(MakeFunctor(*this, &SuiteDsdToPcm::PassbandFlat176k), "PassbandFlat176k");
+    AddTest(MakeFunctor(*this, &SuiteDsdToPcm::PassbandFlat88k), "PassbandFlat88k");
+    AddTest(MakeFunctor(*this, &SuiteDsdToPcm::StopbandRejected176k), "StopbandRejected176k");
+    AddTest(MakeFunctor(*this, &SuiteDsdToPcm::StopbandRejected88k), "StopbandRejected88k");
+}
+
+void SuiteDsdToPcm::Setup()
+{
+    MsgFactoryInitParams init;
+    init.SetMsgEncodedStreamCount(2);
+    init.SetMsgDecodedStreamCount(2);
+    init.SetMsgAudioPcmCount(4, 4);
+    init.SetMsgAudioDsdCount(2);
+    init.SetMsgPlayableCount(2, 2, 2);
+    iMsgFactory = new MsgFactory(iInfoAggregator, init);
+    iDsdToPcm = nullptr;
+    Create(false);
+    iLastMsg = EMsgNone;
+    iAnimatorSupportsDsd = false;
+    iAnimatorMaxSampleRate = 192000;
+    (void)memset(iDsd, kDsdSilence, sizeof(iDsd));
+    iTrackOffsetTx = iJiffiesTx = 0;
+    iTrackOffsetRx = iJiffiesRx = 0;
+    iMultiroom = Multiroom::Forbidden;
+    iSampleRate = iBitDepth = 0;
+    iSampleStart = 0;
+    iFormat = AudioFormat::Undefined;
+    iStreamHandler = nullptr;
+    for (TUint i=0; i<kChannels; i++) {
+        iSubsamples[i].clear();
+    }
+}
+
+void SuiteDsdToPcm::TearDown()
+{
+    delete iDsdToPcm;
+    delete iMsgFactory;
+}
+
+void SuiteDsdToPcm::Create(TBool aDsdSupported)
+{
+    delete iDsdToPcm;
+    iDsdToPcm = new DsdToPcm(*iMsgFactory, *this, aDsdSupported);
+    iDsdToPcm->SetAnimator(*this);
+}
+
+void SuiteDsdToPcm::PushEncodedStream(Multiroom aMultiroom)
+{
+    Msg* msg = iMsgFactory->CreateMsgEncodedStream(Brn("http://host/dsd"), Brx::Empty(), 0, 0, 1, true, false, aMultiroom, nullptr);
+    static_cast<IPipelineElementDownstream*>(iDsdToPcm)->Push(msg);
+}
+
+void SuiteDsdToPcm::PushDecodedStream(AudioFormat aFormat, TUint aSampleRate, TUint64 aSampleStart)
+{
+    const TUint bitDepth = (aFormat == AudioFormat::Dsd? 1 : 24);
+    Msg* msg = iMsgFactory->CreateMsgDecodedStream(1, aSampleRate * kChannels, bitDepth, aSampleRate, kChannels,
+                                                   Brn("Dummy"), 0, aSampleStart, true, true, false, false,
+                                                   aFormat, Multiroom::Forbidden, kProfile, this);
+    static_cast<IPipelineElementDownstream*>(iDsdToPcm)->Push(msg);
+}
+
+void SuiteDsdToPcm::PushDsd(TUint aSampleBlockBits)
+{
+    MsgAudioDsd* msg = iMsgFactory->CreateMsgAudioDsd(Brn(iDsd, kDsdBytes), kChannels, kSampleRateDsd64,
+                                                      aSampleBlockBits, iTrackOffsetTx);
+    iTrackOffsetTx += msg->Jiffies();
+    iJiffiesTx += msg->Jiffies();
+    static_cast<IPipelineElementDownstream*>(iDsdToPcm)->Push(msg);
+}
+
+void SuiteDsdToPcm::PushDsdSigmaDelta(double aLevel, double aFrequency, TUint aBytes)
+{
+    // second order sigma-delta modulator, same signal (aLevel * cos(2*pi*aFrequency*t)) on both channels
+    const double step = 2 * 3.14159265358979323846 * aFrequency / kSampleRateDsd64;
+    double integrator1 = 0;
+    double integrator2 = 0;
+    double feedback = 0;
+    TUint64 sample = 0;
+    TUint offset = 0;
+    while (offset < aBytes) {
+        for (TUint i=0; i<kDsdBytes; i+=4) {
+            for (TUint j=0; j<2; j++) {
+                TByte byte = 0;
+                for (TUint bit=0; bit<8; bit++) {
+                    const double input = aLevel * cos(step * sample++);
+                    integrator1 += input - feedback;
+                    integrator2 += integrator1 - feedback;
+                    feedback = (integrator2 >= 0? 1 : -1);
+                    byte = (TByte)((byte << 1) | (feedback > 0? 1 : 0));
+                }
+                iDsd[i + j] = byte;     // left
+                iDsd[i + j + 2] = byte; // right
+            }
+        }
+        PushDsd(kSampleBlockBits);
+        offset += kDsdBytes;
+    }
+}
+
+TInt32 SuiteDsdToPcm::SettledSubsample(TUint aChannel) const
+{
+    const std::vector<TInt32>& subsamples = iSubsamples[aChannel];
+    ASSERT(subsamples.size() > kSettleSamples);
+    return subsamples[subsamples.size() - 1];
+}
+
+double SuiteDsdToPcm::ToneLevelDb(TUint aChannel, double aFrequency, double aLevel) const
+{
+    // level, relative to aLevel, of output at aFrequency (or wherever it aliases to)
+    const double sampleRate = iSampleRate;
+    double frequency = fmod(aFrequency, sampleRate);
+    if (frequency > sampleRate / 2) {
+        frequency = sampleRate - frequency;
+    }
+    const double step = 2 * 3.14159265358979323846 * frequency / sampleRate;
+    const std::vector<TInt32>& subsamples = iSubsamples[aChannel];
+    ASSERT(subsamples.size() > kToneSettleSamples);
+    double re = 0;
+    double im = 0;
+    for (size_t i=kToneSettleSamples; i<subsamples.size(); i++) {
+        re += subsamples[i] * cos(step * i);
+        im += subsamples[i] * sin(step * i);
+    }
+    const double count = (double)(subsamples.size() - kToneSettleSamples);
+    const double amplitude = 2 * sqrt(re * re + im * im) / count / (kFullScale + 1);
+    return 20 * log10(amplitude / aLevel);
+}
+
+void SuiteDsdToPcm::CheckPassband(const double* aFrequencies, TUint aCount)
+{
+    for (TUint i=0; i<aCount; i++) {
+        PushDecodedStream(AudioFormat::Dsd, kSampleRateDsd64, 0);
+        PushDsdSigmaDelta(0.5, aFrequencies[i], kToneBytes);
+        for (TUint j=0; j<kChannels; j++) {
+            const double gain = ToneLevelDb(j, aFrequencies[i], 0.5);
+            TEST(gain > -0.2 && gain < 0.2);
+        }
+    }
+}
+
+void SuiteDsdToPcm::CheckStopband(const double* aFrequencies, TUint aCount)
+{
+    for (TUint i=0; i<aCount; i++) {
+        PushDecodedStream(AudioFormat::Dsd, kSampleRateDsd64, 0);
+        PushDsdSigmaDelta(0.5, aFrequencies[i], kToneBytes);
+        for (TUint j=0; j<kChannels; j++) {
+            TEST(ToneLevelDb(j, aFrequencies[i], 0.5) < -70);
+        }
+    }
+}
+
+void SuiteDsdToPcm::PcmPassesThrough()
+{
+    PushDecodedStream(AudioFormat::Pcm, kSampleRatePcm, 0);
+    TEST(iLastMsg == EMsgDecodedStream);
+    TEST(iFormat == AudioFormat::Pcm);
+    TEST(iSampleRate == kSampleRatePcm);
+
+    TByte pcm[kChannels * 3 * 10] = { 0 };
+    Msg* msg = iMsgFactory->CreateMsgAudioPcm(Brn(pcm, sizeof(pcm)), kChannels, kSampleRatePcm, 24, AudioDataEndian::Big, 0);
+    static_cast<IPipelineElementDownstream*>(iDsdToPcm)->Push(msg);
+    TEST(iLastMsg == EMsgAudioPcm);
+    TEST(iSubsamples[0].size() == 10);
+}
+
+void SuiteDsdToPcm::DsdPassesThroughWhenSupported()
+{
+    Create(true);
+    iAnimatorSupportsDsd = true;
+    PushDecodedStream(AudioFormat::Dsd, kSampleRateDsd64, 0);
+    TEST(iLastMsg == EMsgDecodedStream);
+    TEST(iFormat == AudioFormat::Dsd);
+    TEST(iSampleRate == kSampleRateDsd64);
+    PushDsd(kSampleBlockBits);
+    TEST(iLastMsg == EMsgAudioDsd);
+}
+
+void SuiteDsdToPcm::DsdConvertedWhenAnimatorRejectsDsd()
+{
+    Create(true);
+    iAnimatorSupportsDsd = false;
+    PushDecodedStream(AudioFormat::Dsd, kSampleRateDsd64, 0);
+    TEST(iLastMsg == EMsgDecodedStream);
+    TEST(iFormat == AudioFormat::Pcm);
+    PushDsd(kSampleBlockBits);
+    TEST(iLastMsg == EMsgAudioPcm);
+}
+
+void SuiteDsdToPcm::DecodedStreamConverted()
+{
+    PushEncodedStream(Multiroom::Allowed);
+    TEST(iLastMsg == EMsgEncodedStream);
+    PushDecodedStream(AudioFormat::Dsd, kSampleRateDsd64, 16 * 1000);
+    TEST(iLastMsg == EMsgDecodedStream);
+    TEST(iFormat == AudioFormat::Pcm);
+    TEST(iSampleRate == 176400);
+    TEST(iBitDepth == 24);
+    TEST(iSampleStart == 1000);
+    TEST(iMultiroom == Multiroom::Allowed);
+    TEST(iStreamHandler == this);
+
+    PushEncodedStream(Multiroom::Forbidden);
+    PushDecodedStream(AudioFormat::Dsd, kSampleRateDsd128, 0);
+    TEST(iSampleRate == 176400);
+    TEST(iMultiroom == Multiroom::Forbidden);
+}
+
+void SuiteDsdToPcm::LowerRateSelected()
+{
+    iAnimatorMaxSampleRate = 96000;
+    PushDecodedStream(AudioFormat::Dsd, kSampleRateDsd64, 32 * 1000);
+    TEST(iSampleRate == 88200);
+    TEST(iSampleStart == 1000);
+    PushDsd(kSampleBlockBits);
+    TEST(iSubsamples[0].size() == (kDsdBytes / kChannels) / 4);
+
+    // if no rate is supported, convert anyway and leave StreamValidator to reject the stream
+    iAnimatorMaxSampleRate = 48000;
+    PushDecodedStream(AudioFormat::Dsd, kSampleRateDsd64, 0);
+    TEST(iFormat == AudioFormat::Pcm);
+    TEST(iSampleRate == 176400);
+}
+
+void SuiteDsdToPcm::SilenceConverted()
+{
+    PushDecodedStream(AudioFormat::Dsd, kSampleRateDsd64, 0);
+    for (TUint i=0; i<4; i++) {
+        PushDsd(kSampleBlockBits);
+    }
+    TEST(iLastMsg == EMsgAudioPcm);
+    TEST(iJiffiesRx == iJiffiesTx);
+    TEST(iTrackOffsetRx == iTrackOffsetTx);
+    TEST(iSubsamples[0].size() == 4 * (kDsdBytes / kChannels) / 2);
+    TEST(iSubsamples[1].size() == iSubsamples[0].size());
+    for (TUint i=0; i<kChannels; i++) {
+        for (auto subsample : iSubsamples[i]) {
+            TEST(subsample >= -16 && subsample <= 16);
+        }
+    }
+}
+
+void SuiteDsdToPcm::ChannelsDeinterleaved()
+{
+    PushDecodedStream(AudioFormat::Dsd, kSampleRateDsd64, 0);
+    // 16 subsamples of left then 16 of right
+    for (TUint i=0; i<kDsdBytes; i+=4) {
+        iDsd[i] = iDsd[i+1] = 0xff;
+        iDsd[i+2] = iDsd[i+3] = 0x00;
+    }
+    PushDsd(kSampleBlockBits);
+    TEST(SettledSubsample(0) > kFullScale - kFullScaleTolerance);
+    TEST(SettledSubsample(1) < -kFullScale + kFullScaleTolerance);
+}
+
+void SuiteDsdToPcm::BitInterleavedBlocks()
+{
+    PushDecodedStream(AudioFormat::Dsd, kSampleRateDsd64, 0);
+    // left and right subsamples alternate, left first
+    (void)memset(iDsd, 0xaa, sizeof(iDsd));
+    PushDsd(2);
+    TEST(iSubsamples[0].size() == (kDsdBytes / kChannels) / 2);
+    TEST(SettledSubsample(0) > kFullScale - kFullScaleTolerance);
+    TEST(SettledSubsample(1) < -kFullScale + kFullScaleTolerance);
+}
+
+void SuiteDsdToPcm::DcLevelPreserved()
+{
+    PushDecodedStream(AudioFormat::Dsd, kSampleRateDsd64, 0);
+    PushDsdSigmaDelta(0.25, 0, 2 * kDsdBytes);
+    const TInt32 expected = 0x800000 / 4;
+    const TInt32 tolerance = expected / 1000;
+    for (TUint i=0; i<kChannels; i++) {
+        const std::vector<TInt32>& subsamples = iSubsamples[i];
+        for (size_t j=kSettleSamples; j<subsamples.size(); j++) {
+            TEST(subsamples[j] > expected - tolerance && subsamples[j] < expected + tolerance);
+        }
+    }
+}
+
+void SuiteDsdToPcm::PassbandFlat176k()
+{
+    static const double kFrequencies[] = { 1000, 10000, 20000, 40000 };
+    CheckPassband(kFrequencies, sizeof(kFrequencies) / sizeof(kFrequencies[0]));
+    TEST(iSampleRate == 176400);
+}
+
+void SuiteDsdToPcm::PassbandFlat88k()
+{
+    static const double kFrequencies[] = { 1000, 10000, 20000 };
+    iAnimatorMaxSampleRate = 96000;
+    CheckPassband(kFrequencies, sizeof(kFrequencies) / sizeof(kFrequencies[0]));
+    TEST(iSampleRate == 88200);
+}
+
+void SuiteDsdToPcm::StopbandRejected176k()
+{
+    // each would alias into the audio band
+    static const double kFrequencies[] = { 130000, 156400, 171400, 195400 };
+    CheckStopband(kFrequencies, sizeof(kFrequencies) / sizeof(kFrequencies[0]));
+    TEST(iSampleRate == 176400);
+}
+
+void SuiteDsdToPcm::StopbandRejected88k()
+{
+    static const double kFrequencies[] = { 65000, 70000, 83200, 100000 };
+    iAnimatorMaxSampleRate = 96000;
+    CheckStopband(kFrequencies, sizeof(kFrequencies) / sizeof(kFrequencies[0]));
+    TEST(iSampleRate == 88200);
+}
+
+void SuiteDsdToPcm::Push(Msg* aMsg)
+{
+    aMsg = aMsg->Process(*this);
+    if (aMsg != nullptr) {
+        aMsg->RemoveRef();
+    }
+}
+
+Msg* SuiteDsdToPcm::ProcessMsg(MsgMode* aMsg)
+{
+    iLastMsg = EMsgOther;
+    return aMsg;
+}
+
+Msg* SuiteDsdToPcm::ProcessMsg(MsgTrack* aMsg)
+{
+    iLastMsg = EMsgOther;
+    return aMsg;
+}
+
+Msg* SuiteDsdToPcm::ProcessMsg(MsgDrain* aMsg)
+{
+    iLastMsg = EMsgOther;
+    return aMsg;
+}
+
+Msg* SuiteDsdToPcm::ProcessMsg(MsgDelay* aMsg)
+{
+    iLastMsg = EMsgOther;
+    return aMsg;
+}
+
+Msg* SuiteDsdToPcm::ProcessMsg(MsgEncodedStream* aMsg)
+{
+    iLastMsg = EMsgEncodedStream;
+    return aMsg;
+}
+
+Msg* SuiteDsdToPcm::ProcessMsg(MsgAudioEncoded* aMsg)
+{
+    ASSERTS();
+    return aMsg;
+}
+
+Msg* SuiteDsdToPcm::ProcessMsg(MsgMetaText* aMsg)
+{
+    iLastMsg = EMsgOther;
+    return aMsg;
+}
+
+Msg* SuiteDsdToPcm::ProcessMsg(MsgStreamInterrupted* aMsg)
+{
+    iLastMsg = EMsgOther;
+    return aMsg;
+}
+
+Msg* SuiteDsdToPcm::ProcessMsg(MsgHalt* aMsg)
+{
+    iLastMsg = EMsgOther;
+    return aMsg;
+}
+
+Msg* SuiteDsdToPcm::ProcessMsg(MsgFlush* aMsg)
+{
+    iLastMsg = EMsgOther;
+    return aMsg;
+}
+
+Msg* SuiteDsdToPcm::ProcessMsg(MsgWait* aMsg)
+{
+    iLastMsg = EMsgOther;
+    return aMsg;
+}
+
+Msg* SuiteDsdToPcm::ProcessMsg(MsgDecodedStream* aMsg)
+{
+    iLastMsg = EMsgDecodedStream;
+    const DecodedStreamInfo& info = aMsg->StreamInfo();
+    iFormat = info.Format();
+    iSampleRate = info.SampleRate();
+    iBitDepth = info.BitDepth();
+    iSampleStart = info.SampleStart();
+    iMultiroom = info.Multiroom();
+    iStreamHandler = info.StreamHandler();
+    for (TUint i=0; i<kChannels; i++) {
+        iSubsamples[i].clear();
+    }
+    return aMsg;
+}
+
+Msg* SuiteDsdToPcm::ProcessMsg(MsgBitRate* aMsg)
+{
+    iLastMsg = EMsgOther;
+    return aMsg;
+}
+
+Msg* SuiteDsdToPcm::ProcessMsg(MsgAudioPcm* aMsg)
+{
+    iLastMsg = EMsgAudioPcm;
+    if (iJiffiesRx == 0) {
+        iTrackOffsetRx = aMsg->TrackOffset();
+    }
+    TEST(aMsg->TrackOffset() == iTrackOffsetRx);
+    iTrackOffsetRx += aMsg->Jiffies();
+    iJiffiesRx += aMsg->Jiffies();
+
+    MsgPlayable* playable = aMsg->CreatePlayable();
+    ProcessorPcmBufTest pcmProcessor;
+    playable->Read(pcmProcessor);
+    playable->RemoveRef();
+    Brn buf(pcmProcessor.Buf());
+    const TByte* ptr = buf.Ptr();
+    for (TUint i=0; i<buf.Bytes(); i+=3) {
+        TInt32 subsample = (ptr[i] << 24) | (ptr[i+1] << 16) | (ptr[i+2] << 8);
+        iSubsamples[(i/3) % kChannels].push_back(subsample >> 8);
+    }
+    return nullptr;
+}
+
+Msg* SuiteDsdToPcm::ProcessMsg(MsgAudioDsd* aMsg)
+{
+    iLastMsg = EMsgAudioDsd;
+    return aMsg;
+}
+
+Msg* SuiteDsdToPcm::ProcessMsg(MsgSilence* aMsg)
+{
+    iLastMsg = EMsgOther;
+    return aMsg;
+}
+
+Msg* SuiteDsdToPcm::ProcessMsg(MsgPlayable* aMsg)
+{
+    ASSERTS();
+    return aMsg;
+}
+
+Msg* SuiteDsdToPcm::ProcessMsg(MsgQuit* aMsg)
+{
+    iLastMsg = EMsgOther;
+    return aMsg;
+}
+
+TUint SuiteDsdToPcm::PipelineAnimatorBufferJiffies() const
+{
+    return 0;
+}
+
+TUint SuiteDsdToPcm::PipelineAnimatorDelayJiffies(AudioFormat aFormat, TUint aSampleRate, TUint /*aBitDepth*/, TUint /*aNumChannels*/) const
+{
+    if (aFormat == AudioFormat::Dsd) {
+        if (!iAnimatorSupportsDsd) {
+            THROW(FormatUnsupported);
+        }
+    }
+    else if (aSampleRate > iAnimatorMaxSampleRate) {
+        THROW(SampleRateUnsupported);
+    }
+    return 0;
+}
+
+TUint SuiteDsdToPcm::PipelineAnimatorDsdBlockSizeBytes() const
+{
+    return 4;
+}
+
+EStreamPlay SuiteDsdToPcm::OkToPlay(TUint /*aStreamId*/)
+{
+    ASSERTS();
+    return ePlayNo;
+}
+
+TUint SuiteDsdToPcm::TrySeek(TUint /*aStreamId*/, TUint64 /*aOffset*/)
+{
+    ASSERTS();
+    return MsgFlush::kIdInvalid;
+}
+
+TUint SuiteDsdToPcm::TryDiscard(TUint /*aJiffies*/)
+{
+    ASSERTS();
+    return MsgFlush::kIdInvalid;
+}
+
+TUint SuiteDsdToPcm::TryStop(TUint /*aStreamId*/)
+{
+    ASSERTS();
+    return MsgFlush::kIdInvalid;
+}
+
+void SuiteDsdToPcm::NotifyStarving(const Brx& /*aMode*/, TUint /*aStreamId*/, TBool /*aStarving*/)
+{
+}
+
+
+
+void TestDsdToPcm()
+{
+    Runner runner("DsdToPcm tests\n");
+    runner.Add(new SuiteDsdToPcm());
+    runner.Run();
+}
@@ -0,0 +1,242 @@
+#include <OpenHome/Private/SuiteUnitTest.h>
+#include <OpenHome/Media/Protocol/FileMapped.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Private/File.h>
+#include <OpenHome/Private/Stream.h>
+
+#include <stdio.h>
+#ifdef FILE_MAPPED_SUPPORTED
+# include <unistd.h>
+#endif
+
+using namespace OpenHome;
+using namespace OpenHome::TestFramework;
+using namespace OpenHome::Media;
+
+namespace OpenHome {
+namespace Media {
+
+class SuiteFileMapped : public SuiteUnitTest
+{
+    static const TUint kWindowBytes = 64 * 1024; // a multiple of all common page sizes
+    static const TUint kFileBytes = 3 * kWindowBytes + 1000;
+    static const TChar* kPath;
+    static const TChar* kPathEmpty;
+public:
+    SuiteFileMapped();
+private: // from SuiteUnitTest
+    void Setup() override;
+    void TearDown() override;
+private:
+    static void WriteFile(const TChar* aPath, TUint aBytes);
+    static TByte ExpectedByte(TUint64 aOffset);
+    TBool ReadMatches(TUint64 aOffset, TUint aBytes);
+    void TestOpenFails();
+    void TestReadAll();
+    void TestReadStopsAtWindowEnd();
+    void TestSeekWithinWindow();
+    void TestSeekOtherWindow();
+    void TestSeekBeyondEnd();
+    void TestInterrupt();
+    void TestTruncated();
+private:
+    FileMapped* iFile;
+};
+
+} // namespace Media
+} // namespace OpenHome
+
+
+// SuiteFileMapped
+
+const TChar* SuiteFileMapped::kPath = "TestFileMapped.bin";
+const TChar* SuiteFileMapped::kPathEmpty = "TestFileMappedEmpty.bin";
+
+SuiteFileMapped::SuiteFileMapped()
+    : SuiteUnitTest("FileMapped")
+{
+    AddTest(MakeFunctor(*this, &SuiteFileMapped::TestOpenFails), "TestOpenFails");
+#ifdef FILE_MAPPED_SUPPORTED
+    AddTest(MakeFunctor(*this, &SuiteFileMapped::TestReadAll), "TestReadAll");
+    AddTest(MakeFunctor(*this, &SuiteFileMapped::TestReadStopsAtWindowEnd), "TestReadStopsAtWindowEnd");
+    AddTest(MakeFunctor(*this, &SuiteFileMapped::TestSeekWithinWindow), "TestSeekWithinWindow");
+    AddTest(MakeFunctor(*this, &SuiteFileMapped::TestSeekOtherWindow), "TestSeekOtherWindow");
+    AddTest(MakeFunctor(*this, &SuiteFileMapped::TestSeekBeyondEnd), "TestSeekBeyondEnd");
+    AddTest(MakeFunctor(*this, &SuiteFileMapped::TestInterrupt), "TestInterrupt");
+    AddTest(MakeFunctor(*this, &SuiteFileMapped::TestTruncated), "TestTruncated");
+#endif
+}
+
+void SuiteFileMapped::Setup()
+{
+    WriteFile(kPath, kFileBytes);
+    WriteFile(kPathEmpty, 0);
+    // the build directory may not be on a fixed disk; ProtocolFile's check is exercised by its own use
+    iFile = new FileMapped(kWindowBytes, false);
+}
+
+void SuiteFileMapped::TearDown()
+{
+    delete iFile;
+    (void)::remove(kPath);
+    (void)::remove(kPathEmpty);
+}
+
+void SuiteFileMapped::WriteFile(const TChar* aPath, TUint aBytes)
+{ // static
+    IFile* file = IFile::Open(aPath, eFileWriteOnly);
+    Bwh buf(kWindowBytes);
+    for (TUint offset=0; offset<aBytes; offset+=buf.Bytes()) {
+        buf.SetBytes(0);
+        for (TUint i=offset; i<aBytes && buf.Bytes()<buf.MaxBytes(); i++) {
+            buf.Append(ExpectedByte(i));
+        }
+        file->Write(buf);
+    }
+    delete file;
+}
+
+TByte SuiteFileMapped::ExpectedByte(TUint64 aOffset)
+{ // static
+    // doesn't repeat at window or page boundaries
+    return (TByte)((aOffset % 251) ^ (aOffset >> 12));
+}
+
+TBool SuiteFileMapped::ReadMatches(TUint64 aOffset, TUint aBytes)
+{
+    try {
+        const Brn buf = iFile->Read(aBytes);
+        if (buf.Bytes() != aBytes) {
+            return false;
+        }
+        for (TUint i=0; i<aBytes; i++) {
+            if (buf[i] != ExpectedByte(aOffset + i)) {
+                return false;
+            }
+        }
+    }
+    catch (ReaderError&) {
+        return false;
+    }
+    return true;
+}
+
+void SuiteFileMapped::TestOpenFails()
+{
+    // ProtocolFile falls back to FileStream for each of these
+    TEST(!iFile->Open("TestFileMappedMissing.bin"));
+    TEST(!iFile->Open(kPathEmpty));
+    TEST(!iFile->Open("."));
+    TEST_THROWS(iFile->Read(1), ReaderError);
+#ifndef FILE_MAPPED_SUPPORTED
+    TEST(!iFile->Open(kPath));
+#endif
+}
+
+void SuiteFileMapped::TestReadAll()
+{
+    static const TUint kReadBytes = 5000;
+    TEST(iFile->Open(kPath));
+    TEST(iFile->Bytes() == kFileBytes);
+    TUint64 offset = 0;
+    TBool ok = true;
+    while (offset < kFileBytes) {
+        const Brn buf = iFile->Read(kReadBytes);
+        const TUint64 end = offset + buf.Bytes();
+        // reads are clipped at the end of the current window rather than spanning two
+        ok = ok && buf.Bytes() > 0 && buf.Bytes() <= kReadBytes;
+        ok = ok && (offset / kWindowBytes == (end - 1) / kWindowBytes);
+        ok = ok && (buf.Bytes() == kReadBytes || end % kWindowBytes == 0 || end == kFileBytes);
+        for (TUint i=0; ok && i<buf.Bytes(); i++) {
+            ok = (buf[i] == ExpectedByte(offset + i));
+        }
+        if (!ok) {
+            break;
+        }
+        offset = end;
+    }
+    TEST(ok);
+    TEST(offset == kFileBytes);
+    TEST_THROWS(iFile->Read(kReadBytes), ReaderError);
+}
+
+void SuiteFileMapped::TestReadStopsAtWindowEnd()
+{
+    TEST(iFile->Open(kPath));
+    iFile->Seek(kWindowBytes - 10);
+    TEST(ReadMatches(kWindowBytes - 10, 10));
+    TEST(ReadMatches(kWindowBytes, 100));
+    iFile->Seek(kFileBytes - 10);
+    TEST(ReadMatches(kFileBytes - 10, 10));
+    TEST_THROWS(iFile->Read(100), ReaderError);
+}
+
+void SuiteFileMapped::TestSeekWithinWindow()
+{
+    TEST(iFile->Open(kPath));
+    TEST(ReadMatches(0, 1000));
+    iFile->Seek(500);
+    TEST(ReadMatches(500, 10));
+    iFile->Seek(20000);
+    TEST(ReadMatches(20000, 10));
+    iFile->Seek(0);
+    TEST(ReadMatches(0, 1000));
+}
+
+void SuiteFileMapped::TestSeekOtherWindow()
+{
+    TEST(iFile->Open(kPath));
+    TEST(ReadMatches(0, 100));
+    iFile->Seek(2 * kWindowBytes + 5); // window starts are page aligned, offsets within it needn't be
+    TEST(ReadMatches(2 * kWindowBytes + 5, 100));
+    iFile->Seek(3);
+    TEST(ReadMatches(3, 100));
+    iFile->Seek(3 * kWindowBytes + 1);
+    TEST(ReadMatches(3 * kWindowBytes + 1, 999));
+    TEST_THROWS(iFile->Read(1), ReaderError);
+}
+
+void SuiteFileMapped::TestSeekBeyondEnd()
+{
+    TEST(iFile->Open(kPath));
+    iFile->Seek(kFileBytes);
+    TEST_THROWS(iFile->Read(1), ReaderError);
+    iFile->Seek((TUint64)1 << 32);
+    TEST_THROWS(iFile->Read(1), ReaderError);
+    iFile->Seek(kWindowBytes);
+    TEST(ReadMatches(kWindowBytes, 100));
+}
+
+void SuiteFileMapped::TestInterrupt()
+{
+    TEST(iFile->Open(kPath));
+    iFile->ReadInterrupt();
+    TEST_THROWS(iFile->Read(100), ReaderError);
+    iFile->Interrupt(false);
+    TEST(ReadMatches(0, 100));
+}
+
+void SuiteFileMapped::TestTruncated()
+{
+#ifdef FILE_MAPPED_SUPPORTED
+    static const TUint kTruncatedBytes = kWindowBytes + 100;
+    TEST(iFile->Open(kPath));
+    TEST(ReadMatches(0, 100));
+    TEST(::truncate(kPath, kTruncatedBytes) == 0);
+    // noticed when the window moves, so reported as an error rather than faulting
+    iFile->Seek(2 * kWindowBytes);
+    TEST_THROWS(iFile->Read(100), ReaderError);
+    iFile->Seek(kWindowBytes + 50);
+    TEST(ReadMatches(kWindowBytes + 50, 50));
+    TEST_THROWS(iFile->Read(100), ReaderError);
+#endif
+}
+
+
+
+void TestFileMapped()
+{
+    Runner runner("FileMapped tests\n");
+    runner.Add(new SuiteFileMapped());
+    runner.Run();
+}
@@ -0,0 +1,291 @@
+#include <OpenHome/Private/SuiteUnitTest.h>
+#include <OpenHome/Media/Codec/FlacFrameSplitter.h>
+
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+using namespace OpenHome;
+using namespace OpenHome::TestFramework;
+using namespace OpenHome::Media;
+using namespace OpenHome::Media::Codec;
+
+namespace OpenHome {
+namespace Media {
+
+class SuiteFlacFrameSplitter : public SuiteUnitTest
+{
+    static const TUint kBlockSize = 4096;
+    static const TUint kChannels = 2;
+    static const TUint kBitDepth = 16;
+    static const TUint kMaxFrameBytes = 2048;
+    static const TUint kNumFrames = 20;
+    static const TUint64 kStreamOffset = 8192;
+public:
+    SuiteFlacFrameSplitter();
+private: // from SuiteUnitTest
+    void Setup() override;
+    void TearDown() override;
+private:
+    void AppendFrame(TUint aFrameNumber, TUint aPayloadBytes);
+    void Split(TUint aStart, TUint aChunkBytes);
+    void TestHeader();
+    void TestHeaderRejectsMismatch();
+    void TestSplitWholeStream();
+    void TestSplitSmallChunks();
+    void TestFalseSync();
+    void TestStartMidFrame();
+    void TestCorruptFrameSkipped();
+    void TestTrailingTag();
+    void TestTrailingTagTotalUnknown();
+    void TestHeaderPastEnd();
+private:
+    FlacFrameSplitter* iSplitter;
+    std::vector<TByte> iStream;
+    std::vector<TUint> iFrameStarts;
+    std::vector<FlacFrameSplitter::Frame> iFrames;
+    TUint64 iTotalSamples;
+    TUint32 iLcg;
+};
+
+} // namespace Media
+} // namespace OpenHome
+
+
+// SuiteFlacFrameSplitter
+
+SuiteFlacFrameSplitter::SuiteFlacFrameSplitter()
+    : SuiteUnitTest("FlacFrameSplitter")
+{
+    AddTest(MakeFunctor(*this, &SuiteFlacFrameSplitter::TestHeader), "TestHeader");
+    AddTest(MakeFunctor(*this, &SuiteFlacFrameSplitter::TestHeaderRejectsMismatch), "TestHeaderRejectsMismatch");
+    AddTest(MakeFunctor(*this, &SuiteFlacFrameSplitter::TestSplitWholeStream), "TestSplitWholeStream");
+    AddTest(MakeFunctor(*this, &SuiteFlacFrameSplitter::TestSplitSmallChunks), "TestSplitSmallChunks");
+    AddTest(MakeFunctor(*this, &SuiteFlacFrameSplitter::TestFalseSync), "TestFalseSync");
+    AddTest(MakeFunctor(*this, &SuiteFlacFrameSplitter::TestStartMidFrame), "TestStartMidFrame");
+    AddTest(MakeFunctor(*this, &SuiteFlacFrameSplitter::TestCorruptFrameSkipped), "TestCorruptFrameSkipped");
+    AddTest(MakeFunctor(*this, &SuiteFlacFrameSplitter::TestTrailingTag), "TestTrailingTag");
+    AddTest(MakeFunctor(*this, &SuiteFlacFrameSplitter::TestTrailingTagTotalUnknown), "TestTrailingTagTotalUnknown");
+    AddTest(MakeFunctor(*this, &SuiteFlacFrameSplitter::TestHeaderPastEnd), "TestHeaderPastEnd");
+}
+
+void SuiteFlacFrameSplitter::Setup()
+{
+    iSplitter = new FlacFrameSplitter(3 * kMaxFrameBytes);
+    iStream.clear();
+    iFrameStarts.clear();
+    iFrames.clear();
+    iTotalSamples = 0;
+    iLcg = 1;
+    for (TUint i=0; i<kNumFrames; i++) {
+        AppendFrame(i, 200 + (i * 97) % 1500);
+    }
+}
+
+void SuiteFlacFrameSplitter::TearDown()
+{
+    delete iSplitter;
+}
+
+void SuiteFlacFrameSplitter::AppendFrame(TUint aFrameNumber, TUint aPayloadBytes)
+{
+    const TUint start = (TUint)iStream.size();
+    iFrameStarts.push_back(start);
+    iStream.push_back(0xff);
+    iStream.push_back(0xf8);  // fixed block size
+    iStream.push_back(0xc9);  // 4096 samples, 44.1kHz
+    iStream.push_back(0x18);  // independent stereo, 16-bit
+    // frame number, UTF-8 coded
+    if (aFrameNumber < 0x80) {
+        iStream.push_back((TByte)aFrameNumber);
+    }
+    else {
+        iStream.push_back((TByte)(0xc0 | (aFrameNumber >> 6)));
+        iStream.push_back((TByte)(0x80 | (aFrameNumber & 0x3f)));
+    }
+    iStream.push_back(FlacFrameSplitter::Crc8(&iStream[start], (TUint)iStream.size() - start));
+    for (TUint i=0; i<aPayloadBytes; i++) {
+        iLcg = iLcg * 1664525 + 1013904223;
+        iStream.push_back((TByte)(iLcg >> 24));
+    }
+    const TUint16 crc = FlacFrameSplitter::Crc16(&iStream[start], (TUint)iStream.size() - start);
+    iStream.push_back((TByte)(crc >> 8));
+    iStream.push_back((TByte)crc);
+}
+
+void SuiteFlacFrameSplitter::Split(TUint aStart, TUint aChunkBytes)
+{
+    iSplitter->Reset(kBlockSize, kChannels, kBitDepth, kMaxFrameBytes, iTotalSamples, kStreamOffset + aStart);
+    TUint pos = aStart;
+    FlacFrameSplitter::Frame frame;
+    for (;;) {
+        while (iSplitter->TryGetFrame(frame)) {
+            // check contents now; frame.iPtr is only valid until the next Append()
+            TEST(frame.iOffset >= kStreamOffset);
+            const TUint streamPos = (TUint)(frame.iOffset - kStreamOffset);
+            TEST(streamPos + frame.iBytes <= iStream.size());
+            TEST(memcmp(frame.iPtr, &iStream[streamPos], frame.iBytes) == 0);
+            iFrames.push_back(frame);
+        }
+        if (pos == iStream.size()) {
+            break;
+        }
+        const TUint bytes = std::min(std::min(aChunkBytes, (TUint)iStream.size() - pos), iSplitter->Space());
+        TEST(bytes > 0);
+        iSplitter->Append(Brn(&iStream[pos], bytes));
+        pos += bytes;
+        if (pos == iStream.size()) {
+            iSplitter->SetEndOfStream();
+        }
+    }
+}
+
+void SuiteFlacFrameSplitter::TestHeader()
+{
+    TUint headerBytes = 0;
+    TUint64 sample = 0;
+    TUint blockSize = 0;
+    TEST(FlacFrameSplitter::TryParseHeader(&iStream[iFrameStarts[3]], 16, kBlockSize, kChannels, kBitDepth, headerBytes, sample, blockSize));
+    TEST(headerBytes == 6);
+    TEST(sample == 3 * kBlockSize);
+    TEST(blockSize == kBlockSize);
+}
+
+void SuiteFlacFrameSplitter::TestHeaderRejectsMismatch()
+{
+    TUint headerBytes = 0;
+    TUint64 sample = 0;
+    TUint blockSize = 0;
+    const TByte* header = &iStream[iFrameStarts[3]];
+    TEST(!FlacFrameSplitter::TryParseHeader(header, 16, kBlockSize, 6, kBitDepth, headerBytes, sample, blockSize));
+    TEST(!FlacFrameSplitter::TryParseHeader(header, 16, kBlockSize, kChannels, 24, headerBytes, sample, blockSize));
+    TEST(!FlacFrameSplitter::TryParseHeader(header, 16, 1024, kChannels, kBitDepth, headerBytes, sample, blockSize));
+    TEST(!FlacFrameSplitter::TryParseHeader(header, 5, kBlockSize, kChannels, kBitDepth, headerBytes, sample, blockSize));
+    std::vector<TByte> corrupt(header, header + 16);
+    corrupt[2] ^= 0x10; // different block size code so CRC-8 fails
+    TEST(!FlacFrameSplitter::TryParseHeader(&corrupt[0], 16, kBlockSize, kChannels, kBitDepth, headerBytes, sample, blockSize));
+}
+
+void SuiteFlacFrameSplitter::TestSplitWholeStream()
+{
+    Split(0, (TUint)iStream.size());
+    TEST(iFrames.size() == kNumFrames);
+    for (TUint i=0; i<iFrames.size(); i++) {
+        TEST(iFrames[i].iOffset == kStreamOffset + iFrameStarts[i]);
+        TEST(iFrames[i].iSample == (TUint64)i * kBlockSize);
+        TEST(iFrames[i].iBlockSize == kBlockSize);
+    }
+}
+
+void SuiteFlacFrameSplitter::TestSplitSmallChunks()
+{
+    Split(0, 37);
+    TEST(iFrames.size() == kNumFrames);
+    TEST(iFrames.back().iOffset == kStreamOffset + iFrameStarts.back());
+    TEST(iFrames.back().iBytes == iStream.size() - iFrameStarts.back());
+}
+
+void SuiteFlacFrameSplitter::TestFalseSync()
+{
+    // a valid looking header inside the payload of another frame shouldn't split it
+    std::vector<TByte> header(&iStream[iFrameStarts[7]], &iStream[iFrameStarts[7]] + 6);
+    const TUint pos = iFrameStarts[5] + 100;
+    for (TUint i=0; i<header.size(); i++) {
+        iStream[pos + i] = header[i];
+    }
+    const TUint end = iFrameStarts[6];
+    const TUint16 crc = FlacFrameSplitter::Crc16(&iStream[iFrameStarts[5]], end - 2 - iFrameStarts[5]);
+    iStream[end - 2] = (TByte)(crc >> 8);
+    iStream[end - 1] = (TByte)crc;
+    Split(0, 512);
+    TEST(iFrames.size() == kNumFrames);
+    TEST(iFrames[5].iOffset == kStreamOffset + iFrameStarts[5]);
+    TEST(iFrames[5].iBytes == iFrameStarts[6] - iFrameStarts[5]);
+}
+
+void SuiteFlacFrameSplitter::TestStartMidFrame()
+{
+    Split(iFrameStarts[4] + 3, 700);
+    TEST(iFrames.size() == kNumFrames - 5);
+    TEST(iFrames[0].iOffset == kStreamOffset + iFrameStarts[5]);
+    TEST(iFrames[0].iSample == 5 * kBlockSize);
+}
+
+void SuiteFlacFrameSplitter::TestCorruptFrameSkipped()
+{
+    iStream[iFrameStarts[9] + 50] ^= 0x01;
+    Split(0, 1000);
+    TEST(iFrames.size() == kNumFrames - 1);
+    for (TUint i=0; i<iFrames.size(); i++) {
+        TEST(iFrames[i].iOffset != kStreamOffset + iFrameStarts[9]);
+    }
+    TEST(iFrames[9].iSample == 10 * kBlockSize);
+}
+
+void SuiteFlacFrameSplitter::TestTrailingTag()
+{
+    // ID3v1 tag following the final frame; the frame's end can only be found from STREAMINFO's total samples
+    const TUint tagStart = (TUint)iStream.size();
+    iStream.push_back('T');
+    iStream.push_back('A');
+    iStream.push_back('G');
+    iStream.resize(tagStart + 128, ' ');
+    iTotalSamples = kNumFrames * kBlockSize;
+    Split(0, 300);
+    TEST(iFrames.size() == kNumFrames);
+    TEST(iFrames.back().iOffset == kStreamOffset + iFrameStarts.back());
+    TEST(iFrames.back().iSample == (kNumFrames - 1) * kBlockSize);
+    // passed on with the tag; the decoder stops at the frame's end
+    TEST(iFrames.back().iBytes == iStream.size() - iFrameStarts.back());
+    TEST(iSplitter->Finished());
+    FlacFrameSplitter::Frame frame;
+    TEST(!iSplitter->TryGetFrame(frame));
+}
+
+void SuiteFlacFrameSplitter::TestTrailingTagTotalUnknown()
+{
+    // without a total the final frame must end with its CRC-16 so is lost
+    const TUint tagStart = (TUint)iStream.size();
+    iStream.resize(tagStart + 128, ' ');
+    Split(0, 300);
+    TEST(iFrames.size() == kNumFrames - 1);
+    TEST(!iSplitter->Finished());
+
+    // ...but is found if the stream ends where it does
+    iStream.resize(tagStart);
+    iFrames.clear();
+    iTotalSamples = kNumFrames * kBlockSize;
+    Split(0, 300);
+    TEST(iFrames.size() == kNumFrames);
+    TEST(iFrames.back().iBytes == iStream.size() - iFrameStarts.back());
+    TEST(iSplitter->Finished());
+}
+
+void SuiteFlacFrameSplitter::TestHeaderPastEnd()
+{
+    // a seek landing part way through a frame mustn't sync on a header numbering a sample beyond the end of the stream
+    const TUint streamBytes = (TUint)iStream.size();
+    AppendFrame(kNumFrames + 10, 0);
+    std::vector<TByte> header(iStream.begin() + streamBytes, iStream.begin() + streamBytes + 6);
+    iStream.resize(streamBytes);
+    iFrameStarts.pop_back();
+    const TUint falseStart = iFrameStarts[11] + 20;
+    for (TUint i=0; i<header.size(); i++) {
+        iStream[falseStart + i] = header[i];
+    }
+    iTotalSamples = kNumFrames * kBlockSize;
+    Split(iFrameStarts[11] + 1, 500);
+    TEST(iFrames.size() == kNumFrames - 12);
+    TEST(iFrames[0].iOffset == kStreamOffset + iFrameStarts[12]);
+    TEST(iFrames[0].iSample == 12 * kBlockSize);
+}
+
+
+
+
+void TestFlacFrameSplitter()
+{
+    Runner runner("FlacFrameSplitter tests\n");
+    runner.Add(new SuiteFlacFrameSplitter());
+    runner.Run();
+}
@@ -0,0 +1,186 @@
+#include <OpenHome/Private/SuiteUnitTest.h>
+#include <OpenHome/Media/Codec/FlacSeekIndex.h>
+
+using namespace OpenHome;
+using namespace OpenHome::TestFramework;
+using namespace OpenHome::Media;
+using namespace OpenHome::Media::Codec;
+
+namespace OpenHome {
+namespace Media {
+
+class SuiteFlacSeekIndex : public SuiteUnitTest
+{
+    static const TUint kSpacing = FlacSeekIndex::kMinSpacingSamples;
+    static const TUint kPreroll = 2 * 44100;
+public:
+    SuiteFlacSeekIndex();
+private: // from SuiteUnitTest
+    void Setup() override;
+    void TearDown() override;
+private:
+    void TestInitialPoint();
+    void TestAddOutOfOrder();
+    void TestRejectsClosePoints();
+    void TestRejectsInconsistentOffsets();
+    void TestSeekWithinPreroll();
+    void TestSeekInterpolated();
+    void TestSeekInterpolatedToEnd();
+    void TestSeekEndUnknown();
+    void TestReset();
+    void TestFull();
+private:
+    FlacSeekIndex* iIndex;
+};
+
+} // namespace Media
+} // namespace OpenHome
+
+
+// SuiteFlacSeekIndex
+
+SuiteFlacSeekIndex::SuiteFlacSeekIndex()
+    : SuiteUnitTest("FlacSeekIndex")
+{
+    AddTest(MakeFunctor(*this, &SuiteFlacSeekIndex::TestInitialPoint), "TestInitialPoint");
+    AddTest(MakeFunctor(*this, &SuiteFlacSeekIndex::TestAddOutOfOrder), "TestAddOutOfOrder");
+    AddTest(MakeFunctor(*this, &SuiteFlacSeekIndex::TestRejectsClosePoints), "TestRejectsClosePoints");
+    AddTest(MakeFunctor(*this, &SuiteFlacSeekIndex::TestRejectsInconsistentOffsets), "TestRejectsInconsistentOffsets");
+    AddTest(MakeFunctor(*this, &SuiteFlacSeekIndex::TestSeekWithinPreroll), "TestSeekWithinPreroll");
+    AddTest(MakeFunctor(*this, &SuiteFlacSeekIndex::TestSeekInterpolated), "TestSeekInterpolated");
+    AddTest(MakeFunctor(*this, &SuiteFlacSeekIndex::TestSeekInterpolatedToEnd), "TestSeekInterpolatedToEnd");
+    AddTest(MakeFunctor(*this, &SuiteFlacSeekIndex::TestSeekEndUnknown), "TestSeekEndUnknown");
+    AddTest(MakeFunctor(*this, &SuiteFlacSeekIndex::TestReset), "TestReset");
+    AddTest(MakeFunctor(*this, &SuiteFlacSeekIndex::TestFull), "TestFull");
+}
+
+void SuiteFlacSeekIndex::Setup()
+{
+    iIndex = new FlacSeekIndex();
+}
+
+void SuiteFlacSeekIndex::TearDown()
+{
+    delete iIndex;
+}
+
+void SuiteFlacSeekIndex::TestInitialPoint()
+{
+    TEST(iIndex->Count() == 1);
+    TUint64 offset = 1;
+    TEST(iIndex->SeekOffset(0, 0, 0, kPreroll, offset));
+    TEST(offset == 0);
+    TEST(!iIndex->Add(0, 0));
+}
+
+void SuiteFlacSeekIndex::TestAddOutOfOrder()
+{
+    TEST(iIndex->Add(kSpacing * 4, 40000));
+    TEST(iIndex->Add(kSpacing * 2, 20000));
+    TEST(iIndex->Add(kSpacing * 6, 60000));
+    TEST(iIndex->Count() == 4);
+    TUint64 offset = 0;
+    TEST(iIndex->SeekOffset(kSpacing * 2 + 10, 0, 0, kPreroll, offset));
+    TEST(offset == 20000);
+    TEST(iIndex->SeekOffset(kSpacing * 4, 0, 0, kPreroll, offset));
+    TEST(offset == 40000);
+    TEST(iIndex->SeekOffset(kSpacing * 4 - 1, 0, 0, kPreroll, offset));
+    TEST(offset == 20000);
+}
+
+void SuiteFlacSeekIndex::TestRejectsClosePoints()
+{
+    TEST(!iIndex->Add(kSpacing - 1, 100));
+    TEST(iIndex->Add(kSpacing * 2, 20000));
+    TEST(!iIndex->Add(kSpacing * 2 + 1, 20001));
+    TEST(!iIndex->Add(kSpacing * 2 - 1, 19999));
+    TEST(iIndex->Add(kSpacing, 10000));
+    TEST(iIndex->Count() == 3);
+}
+
+void SuiteFlacSeekIndex::TestRejectsInconsistentOffsets()
+{
+    TEST(iIndex->Add(kSpacing * 2, 20000));
+    TEST(!iIndex->Add(kSpacing * 4, 20000)); // later sample must have a later offset
+    TEST(!iIndex->Add(kSpacing, 30000));     // earlier sample must have an earlier offset
+    TEST(iIndex->Count() == 2);
+}
+
+void SuiteFlacSeekIndex::TestSeekWithinPreroll()
+{
+    TEST(iIndex->Add(kSpacing * 10, 100000));
+    TUint64 offset = 0;
+    TEST(iIndex->SeekOffset(kPreroll, kSpacing * 20, 200000, kPreroll, offset));
+    TEST(offset == 0);
+    TEST(iIndex->SeekOffset(kSpacing * 10 + kPreroll, kSpacing * 20, 200000, kPreroll, offset));
+    TEST(offset == 100000);
+}
+
+void SuiteFlacSeekIndex::TestSeekInterpolated()
+{
+    TEST(iIndex->Add(kSpacing * 10, 100000));
+    TEST(iIndex->Add(kSpacing * 20, 300000));
+    TUint64 offset = 0;
+    // halfway between the points, less preroll
+    const TUint64 sample = kSpacing * 15 + kPreroll;
+    TEST(!iIndex->SeekOffset(sample, 0, 0, kPreroll, offset));
+    TEST(offset == 200000);
+    TEST(!iIndex->SeekOffset(sample + 1, 0, 0, kPreroll, offset));
+    TEST(offset >= 200000 && offset < 200010);
+}
+
+void SuiteFlacSeekIndex::TestSeekInterpolatedToEnd()
+{
+    TUint64 offset = 0;
+    const TUint64 kEndSample = 44100ULL * 60 * 60 * 10;
+    const TUint64 kEndOffset = 10ULL * 1024 * 1024 * 1024;
+    TEST(!iIndex->SeekOffset(kEndSample / 2 + kPreroll, kEndSample, kEndOffset, kPreroll, offset));
+    TEST(offset == kEndOffset / 2);
+    // beyond the end of the stream, so no upper bound
+    TEST(!iIndex->SeekOffset(kEndSample + kPreroll + 1, kEndSample, kEndOffset, kPreroll, offset));
+    TEST(offset == 0);
+}
+
+void SuiteFlacSeekIndex::TestSeekEndUnknown()
+{
+    TEST(iIndex->Add(kSpacing * 10, 100000));
+    TUint64 offset = 0;
+    // nothing known beyond the last point so the offset can't be trusted to be close
+    TEST(!iIndex->SeekOffset(kSpacing * 100, 0, 0, kPreroll, offset));
+    TEST(offset == 100000);
+    TEST(iIndex->SeekOffset(kSpacing * 10 + kPreroll, 0, 0, kPreroll, offset));
+    TEST(offset == 100000);
+    // ...unless the caller is prepared to decode forwards from it
+    TEST(iIndex->SeekOffset(kSpacing * 100, 0, 0, kSpacing * 100, offset));
+    TEST(offset == 100000);
+}
+
+void SuiteFlacSeekIndex::TestReset()
+{
+    TEST(iIndex->Add(kSpacing * 10, 100000));
+    iIndex->Reset();
+    TEST(iIndex->Count() == 1);
+    TUint64 offset = 0;
+    TEST(!iIndex->SeekOffset(kSpacing * 10, 0, 0, kPreroll, offset));
+    TEST(offset == 0);
+}
+
+void SuiteFlacSeekIndex::TestFull()
+{
+    TUint i = 1;
+    while (iIndex->Count() < FlacSeekIndex::kMaxPoints) {
+        TEST(iIndex->Add((TUint64)kSpacing * i, 1000 * i));
+        i++;
+    }
+    TEST(!iIndex->Add((TUint64)kSpacing * i, 1000 * i));
+    TEST(iIndex->Count() == FlacSeekIndex::kMaxPoints);
+}
+
+
+
+void TestFlacSeekIndex()
+{
+    Runner runner("FlacSeekIndex tests\n");
+    runner.Add(new SuiteFlacSeekIndex());
+    runner.Run();
+}
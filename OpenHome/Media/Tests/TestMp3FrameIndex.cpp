@@ -0,0 +1,259 @@
+#include <OpenHome/Private/SuiteUnitTest.h>
+#include <OpenHome/Media/Codec/Mp3FrameIndex.h>
+
+using namespace OpenHome;
+using namespace OpenHome::TestFramework;
+using namespace OpenHome::Media;
+using namespace OpenHome::Media::Codec;
+
+namespace OpenHome {
+namespace Media {
+
+class SuiteMp3FrameIndex : public SuiteUnitTest
+{
+    static const TUint kFirstFrameOffset = 417;
+    static const TUint kFrameSamples = 1152;
+public:
+    SuiteMp3FrameIndex();
+private: // from SuiteUnitTest
+    void Setup() override;
+    void TearDown() override;
+private:
+    TUint FrameBytes(TUint aFrame) const;
+    void AddFrames(TUint aCount);
+    void TestEmpty();
+    void TestSparseEntries();
+    void TestFind();
+    void TestFindBeyondEnd();
+    void TestRejectsGap();
+    void TestRejectsDuplicate();
+    void TestReset();
+private:
+    Mp3FrameIndex* iIndex;
+    TUint iFrames;
+    TUint64 iOffset;
+};
+
+class SuiteMp3FrameIndexCache : public SuiteUnitTest
+{
+public:
+    SuiteMp3FrameIndexCache();
+private: // from SuiteUnitTest
+    void Setup() override;
+    void TearDown() override;
+private:
+    void TestReuse();
+    void TestStreamChanged();
+    void TestLeastRecentlyUsedEvicted();
+private:
+    Mp3FrameIndexCache* iCache;
+};
+
+} // namespace Media
+} // namespace OpenHome
+
+
+// SuiteMp3FrameIndex
+
+SuiteMp3FrameIndex::SuiteMp3FrameIndex()
+    : SuiteUnitTest("Mp3FrameIndex")
+{
+    AddTest(MakeFunctor(*this, &SuiteMp3FrameIndex::TestEmpty), "TestEmpty");
+    AddTest(MakeFunctor(*this, &SuiteMp3FrameIndex::TestSparseEntries), "TestSparseEntries");
+    AddTest(MakeFunctor(*this, &SuiteMp3FrameIndex::TestFind), "TestFind");
+    AddTest(MakeFunctor(*this, &SuiteMp3FrameIndex::TestFindBeyondEnd), "TestFindBeyondEnd");
+    AddTest(MakeFunctor(*this, &SuiteMp3FrameIndex::TestRejectsGap), "TestRejectsGap");
+    AddTest(MakeFunctor(*this, &SuiteMp3FrameIndex::TestRejectsDuplicate), "TestRejectsDuplicate");
+    AddTest(MakeFunctor(*this, &SuiteMp3FrameIndex::TestReset), "TestReset");
+}
+
+void SuiteMp3FrameIndex::Setup()
+{
+    iIndex = new Mp3FrameIndex();
+    iIndex->Reset(Brn("http://host/track.mp3"), 1000000, kFirstFrameOffset);
+    iFrames = 0;
+    iOffset = kFirstFrameOffset;
+}
+
+void SuiteMp3FrameIndex::TearDown()
+{
+    delete iIndex;
+}
+
+TUint SuiteMp3FrameIndex::FrameBytes(TUint aFrame) const
+{
+    return 200 + (aFrame * 37) % 800; // vbr
+}
+
+void SuiteMp3FrameIndex::AddFrames(TUint aCount)
+{
+    for (TUint i=0; i<aCount; i++) {
+        const TUint bytes = FrameBytes(iFrames);
+        TEST(iIndex->Add((TUint64)iFrames * kFrameSamples, iOffset, bytes, kFrameSamples));
+        iOffset += bytes;
+        iFrames++;
+    }
+}
+
+void SuiteMp3FrameIndex::TestEmpty()
+{
+    TUint64 sample = 0;
+    TUint64 offset = 0;
+    TEST(iIndex->Count() == 0);
+    TEST(iIndex->EndSample() == 0);
+    TEST(iIndex->EndOffset() == kFirstFrameOffset);
+    TEST(!iIndex->TryFind(0, sample, offset));
+}
+
+void SuiteMp3FrameIndex::TestSparseEntries()
+{
+    AddFrames(1);
+    TEST(iIndex->Count() == 1);
+    AddFrames(Mp3FrameIndex::kFrameInterval - 1);
+    TEST(iIndex->Count() == 1);
+    AddFrames(1);
+    TEST(iIndex->Count() == 2);
+    TEST(iIndex->EndSample() == (TUint64)iFrames * kFrameSamples);
+    TEST(iIndex->EndOffset() == iOffset);
+}
+
+void SuiteMp3FrameIndex::TestFind()
+{
+    AddFrames(Mp3FrameIndex::kFrameInterval * 3 + 5);
+    TUint64 sample = 0;
+    TUint64 offset = 0;
+    TEST(iIndex->TryFind(0, sample, offset));
+    TEST(sample == 0);
+    TEST(offset == kFirstFrameOffset);
+
+    TUint64 expectedOffset = kFirstFrameOffset;
+    for (TUint i=0; i<Mp3FrameIndex::kFrameInterval*2; i++) {
+        expectedOffset += FrameBytes(i);
+    }
+    const TUint64 entrySample = (TUint64)Mp3FrameIndex::kFrameInterval * 2 * kFrameSamples;
+    TEST(iIndex->TryFind(entrySample, sample, offset));
+    TEST(sample == entrySample);
+    TEST(offset == expectedOffset);
+    TEST(iIndex->TryFind(entrySample + 1, sample, offset));
+    TEST(sample == entrySample);
+    TEST(iIndex->TryFind(entrySample - 1, sample, offset));
+    TEST(sample == entrySample - (Mp3FrameIndex::kFrameInterval * kFrameSamples));
+
+    // samples after the last entry but before the end of the index
+    TEST(iIndex->TryFind(iIndex->EndSample() - 1, sample, offset));
+    TEST(sample == (TUint64)Mp3FrameIndex::kFrameInterval * 3 * kFrameSamples);
+}
+
+void SuiteMp3FrameIndex::TestFindBeyondEnd()
+{
+    AddFrames(10);
+    TUint64 sample = 0;
+    TUint64 offset = 0;
+    TEST(!iIndex->TryFind(iIndex->EndSample(), sample, offset));
+    TEST(!iIndex->TryFind(iIndex->EndSample() + kFrameSamples * 100, sample, offset));
+}
+
+void SuiteMp3FrameIndex::TestRejectsGap()
+{
+    AddFrames(3);
+    const TUint64 endSample = iIndex->EndSample();
+    const TUint64 endOffset = iIndex->EndOffset();
+    TEST(!iIndex->Add(endSample + kFrameSamples, endOffset, 400, kFrameSamples));
+    TEST(!iIndex->Add(endSample, endOffset + 1, 400, kFrameSamples));
+    TEST(!iIndex->Add(endSample, endOffset, 0, kFrameSamples));
+    TEST(iIndex->EndSample() == endSample);
+    TEST(iIndex->EndOffset() == endOffset);
+    TEST(iIndex->Add(endSample, endOffset, 400, kFrameSamples));
+}
+
+void SuiteMp3FrameIndex::TestRejectsDuplicate()
+{
+    AddFrames(Mp3FrameIndex::kFrameInterval + 1);
+    const TUint count = iIndex->Count();
+    const TUint64 endSample = iIndex->EndSample();
+    TEST(!iIndex->Add(0, kFirstFrameOffset, FrameBytes(0), kFrameSamples));
+    TEST(iIndex->Count() == count);
+    TEST(iIndex->EndSample() == endSample);
+}
+
+void SuiteMp3FrameIndex::TestReset()
+{
+    AddFrames(Mp3FrameIndex::kFrameInterval * 2);
+    TEST(iIndex->Matches(Brn("http://host/track.mp3"), 1000000, kFirstFrameOffset));
+    iIndex->Reset(Brn("http://host/other.mp3"), 2000, 0);
+    TEST(!iIndex->Matches(Brn("http://host/track.mp3"), 1000000, kFirstFrameOffset));
+    TEST(iIndex->Matches(Brn("http://host/other.mp3"), 2000, 0));
+    TEST(iIndex->Count() == 0);
+    TEST(iIndex->EndSample() == 0);
+    TEST(iIndex->EndOffset() == 0);
+}
+
+
+// SuiteMp3FrameIndexCache
+
+SuiteMp3FrameIndexCache::SuiteMp3FrameIndexCache()
+    : SuiteUnitTest("Mp3FrameIndexCache")
+{
+    AddTest(MakeFunctor(*this, &SuiteMp3FrameIndexCache::TestReuse), "TestReuse");
+    AddTest(MakeFunctor(*this, &SuiteMp3FrameIndexCache::TestStreamChanged), "TestStreamChanged");
+    AddTest(MakeFunctor(*this, &SuiteMp3FrameIndexCache::TestLeastRecentlyUsedEvicted), "TestLeastRecentlyUsedEvicted");
+}
+
+void SuiteMp3FrameIndexCache::Setup()
+{
+    iCache = new Mp3FrameIndexCache();
+}
+
+void SuiteMp3FrameIndexCache::TearDown()
+{
+    delete iCache;
+}
+
+void SuiteMp3FrameIndexCache::TestReuse()
+{
+    const Brn kUri("http://host/a.mp3");
+    auto& index = iCache->Index(kUri, 5000, 10);
+    TEST(index.Add(0, 10, 400, 1152));
+    auto& index2 = iCache->Index(kUri, 5000, 10);
+    TEST(&index == &index2);
+    TEST(index2.EndSample() == 1152);
+}
+
+void SuiteMp3FrameIndexCache::TestStreamChanged()
+{
+    const Brn kUri("http://host/a.mp3");
+    auto& index = iCache->Index(kUri, 5000, 10);
+    TEST(index.Add(0, 10, 400, 1152));
+    auto& index2 = iCache->Index(kUri, 6000, 10);
+    TEST(index2.EndSample() == 0);
+    auto& index3 = iCache->Index(kUri, 6000, 20);
+    TEST(index3.EndSample() == 0);
+    TEST(index3.EndOffset() == 20);
+}
+
+void SuiteMp3FrameIndexCache::TestLeastRecentlyUsedEvicted()
+{
+    Bws<32> uri;
+    for (TUint i=0; i<Mp3FrameIndexCache::kMaxIndexes; i++) {
+        uri.Replace("http://host/");
+        uri.Append((TByte)('a' + i));
+        auto& index = iCache->Index(uri, 5000, 0);
+        TEST(index.Add(0, 0, 400, 1152));
+    }
+    // touch 'a' so that 'b' becomes least recently used
+    TEST(iCache->Index(Brn("http://host/a"), 5000, 0).EndSample() == 1152);
+    (void)iCache->Index(Brn("http://host/new"), 5000, 0);
+    TEST(iCache->Index(Brn("http://host/a"), 5000, 0).EndSample() == 1152);
+    TEST(iCache->Index(Brn("http://host/c"), 5000, 0).EndSample() == 1152);
+    TEST(iCache->Index(Brn("http://host/b"), 5000, 0).EndSample() == 0);
+}
+
+
+
+void TestMp3FrameIndex()
+{
+    Runner runner("Mp3FrameIndex tests\n");
+    runner.Add(new SuiteMp3FrameIndex());
+    runner.Add(new SuiteMp3FrameIndexCache());
+    runner.Run();
+}
@@ -0,0 +1,380 @@
+#include <OpenHome/Private/SuiteUnitTest.h>
+#include <OpenHome/Media/Codec/Mpeg4.h>
+#include <OpenHome/Private/Stream.h>
+
+#include <limits.h>
+#include <vector>
+
+using namespace OpenHome;
+using namespace OpenHome::TestFramework;
+using namespace OpenHome::Media;
+using namespace OpenHome::Media::Codec;
+
+namespace OpenHome {
+namespace Media {
+
+class SuiteSampleSizeTable : public SuiteUnitTest
+{
+    static const TUint kSampleCount = 1000;
+public:
+    SuiteSampleSizeTable();
+private: // from SuiteUnitTest
+    void Setup() override;
+    void TearDown() override;
+private:
+    void Populate();
+    void TestConstant();
+    void TestSequential();
+    void TestRandomAccess();
+    void TestTooManyEntries();
+    void TestBytes();
+    void TestSerialiseVariable();
+    void TestSerialiseConstant();
+    void TestReadTruncated();
+private:
+    SampleSizeTable* iTable;
+    std::vector<TUint> iSizes;
+};
+
+class SuiteSeekTable : public SuiteUnitTest
+{
+    static const TUint kChunkCount = 8;
+public:
+    SuiteSeekTable();
+private: // from SuiteUnitTest
+    void Setup() override;
+    void TearDown() override;
+private:
+    void Populate(SeekTable& aTable, TBool aMultipleDurations);
+    void TestSamplesPerChunk();
+    void TestStartSample();
+    void TestOffset();
+    void TestOffsetMultipleDurations();
+    void TestOffsetOutOfRange();
+    void TestEmpty();
+    void TestSerialise();
+private:
+    SeekTable* iTable;
+};
+
+} // namespace Media
+} // namespace OpenHome
+
+
+// SuiteSampleSizeTable
+
+SuiteSampleSizeTable::SuiteSampleSizeTable()
+    : SuiteUnitTest("SampleSizeTable")
+{
+    AddTest(MakeFunctor(*this, &SuiteSampleSizeTable::TestConstant), "TestConstant");
+    AddTest(MakeFunctor(*this, &SuiteSampleSizeTable::TestSequential), "TestSequential");
+    AddTest(MakeFunctor(*this, &SuiteSampleSizeTable::TestRandomAccess), "TestRandomAccess");
+    AddTest(MakeFunctor(*this, &SuiteSampleSizeTable::TestTooManyEntries), "TestTooManyEntries");
+    AddTest(MakeFunctor(*this, &SuiteSampleSizeTable::TestBytes), "TestBytes");
+    AddTest(MakeFunctor(*this, &SuiteSampleSizeTable::TestSerialiseVariable), "TestSerialiseVariable");
+    AddTest(MakeFunctor(*this, &SuiteSampleSizeTable::TestSerialiseConstant), "TestSerialiseConstant");
+    AddTest(MakeFunctor(*this, &SuiteSampleSizeTable::TestReadTruncated), "TestReadTruncated");
+}
+
+void SuiteSampleSizeTable::Setup()
+{
+    iTable = new SampleSizeTable();
+    iSizes.clear();
+    for (TUint i=0; i<kSampleCount; i++) {
+        iSizes.push_back(300 + (i * 7919) % 500); // typical AAC frame sizes
+    }
+    // a few outliers that need long varints, in both directions
+    iSizes[10] = 0;
+    iSizes[64] = UINT_MAX;
+    iSizes[65] = 1;
+    iSizes[500] = 100000;
+}
+
+void SuiteSampleSizeTable::TearDown()
+{
+    delete iTable;
+}
+
+void SuiteSampleSizeTable::Populate()
+{
+    iTable->Init(kSampleCount);
+    for (auto size : iSizes) {
+        iTable->AddSampleSize(size);
+    }
+}
+
+void SuiteSampleSizeTable::TestConstant()
+{
+    iTable->InitConstant(kSampleCount, 417);
+    TEST(iTable->Count() == kSampleCount);
+    TEST(iTable->SampleSize(0) == 417);
+    TEST(iTable->SampleSize(kSampleCount - 1) == 417);
+    TEST_THROWS(iTable->SampleSize(kSampleCount), MediaMpeg4FileInvalid);
+    TEST_THROWS(iTable->AddSampleSize(417), MediaMpeg4FileInvalid);
+    iTable->Clear();
+    TEST(iTable->Count() == 0);
+    TEST_THROWS(iTable->SampleSize(0), MediaMpeg4FileInvalid);
+}
+
+void SuiteSampleSizeTable::TestSequential()
+{
+    Populate();
+    TEST(iTable->Count() == kSampleCount);
+    for (TUint i=0; i<kSampleCount; i++) {
+        TEST(iTable->SampleSize(i) == iSizes[i]);
+    }
+    TEST_THROWS(iTable->SampleSize(kSampleCount), MediaMpeg4FileInvalid);
+}
+
+void SuiteSampleSizeTable::TestRandomAccess()
+{
+    Populate();
+    for (TUint i=kSampleCount; i>0; i--) {
+        TEST(iTable->SampleSize(i - 1) == iSizes[i - 1]);
+    }
+    for (TUint i=0; i<kSampleCount; i+=97) {
+        TEST(iTable->SampleSize(i) == iSizes[i]);
+        TEST(iTable->SampleSize(kSampleCount - 1 - i) == iSizes[kSampleCount - 1 - i]);
+    }
+    TEST(iTable->SampleSize(64) == UINT_MAX);
+    TEST(iTable->SampleSize(63) == iSizes[63]);
+    TEST(iTable->SampleSize(65) == 1);
+}
+
+void SuiteSampleSizeTable::TestTooManyEntries()
+{
+    iTable->Init(2);
+    iTable->AddSampleSize(1);
+    iTable->AddSampleSize(2);
+    TEST_THROWS(iTable->AddSampleSize(3), MediaMpeg4FileInvalid);
+}
+
+void SuiteSampleSizeTable::TestBytes()
+{
+    Populate();
+    TUint expected = 0;
+    for (TUint i=100; i<164; i++) {
+        expected += iSizes[i];
+    }
+    TEST(iTable->Bytes(100, 64) == expected);
+    TEST(iTable->Bytes(100, 0) == 0);
+    TEST(iTable->Bytes(kSampleCount, 0) == 0);
+    TEST_THROWS(iTable->Bytes(kSampleCount - 1, 2), MediaMpeg4FileInvalid);
+    TEST_THROWS(iTable->Bytes(60, 10), MediaMpeg4FileInvalid); // includes UINT_MAX so would wrap
+
+    iTable->Clear();
+    iTable->InitConstant(kSampleCount, 417);
+    TEST(iTable->Bytes(0, 10) == 4170);
+    iTable->Clear();
+    iTable->InitConstant(kSampleCount, UINT_MAX);
+    TEST_THROWS(iTable->Bytes(0, 2), MediaMpeg4FileInvalid);
+}
+
+void SuiteSampleSizeTable::TestSerialiseVariable()
+{
+    Populate();
+    WriterBwh writer(1024);
+    iTable->WriteInit();
+    do {
+        iTable->Write(writer, 13); // deliberately awkward block size
+    } while (!iTable->WriteComplete());
+    TEST(writer.Buffer().Bytes() < kSampleCount * sizeof(TUint32) * 3 / 4);
+
+    ReaderBuffer reader(writer.Buffer());
+    SampleSizeTable table;
+    table.Read(reader);
+    TEST(table.Count() == kSampleCount);
+    for (TUint i=0; i<kSampleCount; i++) {
+        TEST(table.SampleSize(i) == iSizes[i]);
+    }
+}
+
+void SuiteSampleSizeTable::TestSerialiseConstant()
+{
+    iTable->InitConstant(kSampleCount, 417);
+    WriterBwh writer(64);
+    iTable->WriteInit();
+    iTable->Write(writer, 11); // not enough for header
+    TEST(!iTable->WriteComplete());
+    TEST(writer.Buffer().Bytes() == 0);
+    iTable->Write(writer, 12);
+    TEST(iTable->WriteComplete());
+    TEST(writer.Buffer().Bytes() == 12);
+
+    ReaderBuffer reader(writer.Buffer());
+    SampleSizeTable table;
+    table.Read(reader);
+    TEST(table.Count() == kSampleCount);
+    TEST(table.SampleSize(kSampleCount - 1) == 417);
+}
+
+void SuiteSampleSizeTable::TestReadTruncated()
+{
+    Populate();
+    WriterBwh writer(1024);
+    iTable->WriteInit();
+    iTable->Write(writer, UINT_MAX);
+    TEST(iTable->WriteComplete());
+
+    Brn truncated(writer.Buffer().Ptr(), writer.Buffer().Bytes() - 1);
+    ReaderBuffer reader(truncated);
+    SampleSizeTable table;
+    TEST_THROWS(table.Read(reader), ReaderError);
+}
+
+
+// SuiteSeekTable
+
+SuiteSeekTable::SuiteSeekTable()
+    : SuiteUnitTest("SeekTable")
+{
+    AddTest(MakeFunctor(*this, &SuiteSeekTable::TestSamplesPerChunk), "TestSamplesPerChunk");
+    AddTest(MakeFunctor(*this, &SuiteSeekTable::TestStartSample), "TestStartSample");
+    AddTest(MakeFunctor(*this, &SuiteSeekTable::TestOffset), "TestOffset");
+    AddTest(MakeFunctor(*this, &SuiteSeekTable::TestOffsetMultipleDurations), "TestOffsetMultipleDurations");
+    AddTest(MakeFunctor(*this, &SuiteSeekTable::TestOffsetOutOfRange), "TestOffsetOutOfRange");
+    AddTest(MakeFunctor(*this, &SuiteSeekTable::TestEmpty), "TestEmpty");
+    AddTest(MakeFunctor(*this, &SuiteSeekTable::TestSerialise), "TestSerialise");
+}
+
+void SuiteSeekTable::Setup()
+{
+    iTable = new SeekTable();
+}
+
+void SuiteSeekTable::TearDown()
+{
+    delete iTable;
+}
+
+void SuiteSeekTable::Populate(SeekTable& aTable, TBool aMultipleDurations)
+{
+    // chunks 1-3 hold 10 samples, 4-5 hold 5, 6-8 hold 8 => 64 samples
+    aTable.InitialiseSamplesPerChunk(4);
+    aTable.SetSamplesPerChunk(1, 10, 1);
+    aTable.SetSamplesPerChunk(4, 5, 1);
+    aTable.SetSamplesPerChunk(6, 4, 1); // run with no chunks; superseded by the next entry
+    aTable.SetSamplesPerChunk(6, 8, 1);
+    if (aMultipleDurations) {
+        aTable.InitialiseAudioSamplesPerSample(2);
+        aTable.SetAudioSamplesPerSample(10, 1024);
+        aTable.SetAudioSamplesPerSample(54, 2048);
+    }
+    else {
+        aTable.InitialiseAudioSamplesPerSample(1);
+        aTable.SetAudioSamplesPerSample(64, 1024);
+    }
+    aTable.InitialiseOffsets(kChunkCount);
+    for (TUint i=0; i<kChunkCount; i++) {
+        aTable.SetOffset(1000 * (i + 1));
+    }
+}
+
+void SuiteSeekTable::TestSamplesPerChunk()
+{
+    Populate(*iTable, false);
+    TEST(iTable->ChunkCount() == kChunkCount);
+    TEST(iTable->SamplesPerChunk(0) == 10);
+    TEST(iTable->SamplesPerChunk(2) == 10);
+    TEST(iTable->SamplesPerChunk(3) == 5);
+    TEST(iTable->SamplesPerChunk(4) == 5);
+    TEST(iTable->SamplesPerChunk(5) == 8);
+    TEST(iTable->SamplesPerChunk(7) == 8);
+}
+
+void SuiteSeekTable::TestStartSample()
+{
+    Populate(*iTable, false);
+    TEST(iTable->StartSample(0) == 0);
+    TEST(iTable->StartSample(1) == 10);
+    TEST(iTable->StartSample(3) == 30);
+    TEST(iTable->StartSample(4) == 35);
+    TEST(iTable->StartSample(5) == 40);
+    TEST(iTable->StartSample(7) == 56);
+}
+
+void SuiteSeekTable::TestOffset()
+{
+    Populate(*iTable, false);
+    TUint64 audioSample = 0;
+    TUint64 codecSample = 0;
+    TEST(iTable->Offset(audioSample, codecSample) == 1000);
+    TEST(audioSample == 0);
+    TEST(codecSample == 0);
+
+    audioSample = 37 * 1024 + 3; // codec sample 37 => chunk 5, which starts at codec sample 35
+    TEST(iTable->Offset(audioSample, codecSample) == 5000);
+    TEST(audioSample == 35 * 1024);
+    TEST(codecSample == 35);
+
+    audioSample = 63 * 1024;
+    TEST(iTable->Offset(audioSample, codecSample) == 8000);
+    TEST(audioSample == 56 * 1024);
+    TEST(codecSample == 56);
+}
+
+void SuiteSeekTable::TestOffsetMultipleDurations()
+{
+    Populate(*iTable, true);
+    TUint64 audioSample = 10 * 1024 + 26 * 2048 + 5; // codec sample 36 => chunk 5, which starts at codec sample 35
+    TUint64 codecSample = 0;
+    TEST(iTable->Offset(audioSample, codecSample) == 5000);
+    TEST(codecSample == 35);
+    TEST(audioSample == 10 * 1024 + 25 * 2048);
+
+    audioSample = 5 * 1024;
+    TEST(iTable->Offset(audioSample, codecSample) == 1000);
+    TEST(codecSample == 0);
+    TEST(audioSample == 0);
+}
+
+void SuiteSeekTable::TestOffsetOutOfRange()
+{
+    Populate(*iTable, false);
+    TUint64 audioSample = 64 * 1024 + 1;
+    TUint64 codecSample = 0;
+    TEST_THROWS(iTable->Offset(audioSample, codecSample), MediaMpeg4OutOfRange);
+}
+
+void SuiteSeekTable::TestEmpty()
+{
+    TEST(!iTable->Initialised());
+    TUint64 audioSample = 0;
+    TUint64 codecSample = 0;
+    TEST_THROWS(iTable->Offset(audioSample, codecSample), CodecStreamCorrupt);
+    Populate(*iTable, false);
+    TEST(iTable->Initialised());
+    iTable->Deinitialise();
+    TEST(!iTable->Initialised());
+}
+
+void SuiteSeekTable::TestSerialise()
+{
+    Populate(*iTable, true);
+    WriterBwh writer(1024);
+    iTable->WriteInit();
+    do {
+        iTable->Write(writer, 16);
+    } while (!iTable->WriteComplete());
+
+    ReaderBuffer reader(writer.Buffer());
+    SeekTable table;
+    SeekTableInitialiser initialiser(table, reader);
+    initialiser.Init();
+    TEST(table.ChunkCount() == kChunkCount);
+    TEST(table.StartSample(5) == 40);
+    TUint64 audioSample = 10 * 1024 + 26 * 2048 + 5;
+    TUint64 codecSample = 0;
+    TEST(table.Offset(audioSample, codecSample) == 5000);
+    TEST(codecSample == 35);
+}
+
+
+
+void TestMpeg4Tables()
+{
+    Runner runner("Mpeg4 table tests\n");
+    runner.Add(new SuiteSampleSizeTable());
+    runner.Add(new SuiteSeekTable());
+    runner.Run();
+}
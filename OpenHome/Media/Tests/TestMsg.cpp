@@ -1,11 +1,16 @@
 #include <OpenHome/Private/TestFramework.h>
 #include <OpenHome/Media/Pipeline/Msg.h>
 #include <OpenHome/Media/Pipeline/RampArray.h>
+#include <OpenHome/Media/Pipeline/PcmKernels.h>
 #include <OpenHome/Media/Utils/AllocatorInfoLogger.h>
 #include <OpenHome/Media/Utils/ProcessorAudioUtils.h>
+#include <OpenHome/Private/Thread.h>
+#include <OpenHome/OsWrapper.h>
+#include <OpenHome/Net/Private/Globals.h>
 
 #include <string.h>
 #include <vector>
+#include <algorithm>
 
 using namespace OpenHome;
 using namespace OpenHome::TestFramework;
@@ -14,6 +19,16 @@ using namespace OpenHome::Media;
 namespace OpenHome {
 namespace Media {
 
+class ProviderListAggregator : public IInfoAggregator
+{
+public:
+    const std::vector<IInfoProvider*>& Providers() const;
+private: // from IInfoAggregator
+    void Register(IInfoProvider& aProvider, std::vector<Brn>& aSupportedQueries) override;
+private:
+    std::vector<IInfoProvider*> iProviders;
+};
+
 class SuiteAllocator : public Suite
 {
 public:
@@ -30,11 +45,43 @@ public:
     TestCell(AllocatorBase& aAllocator);
     void Fill(TChar aVal);
     void CheckIsFilled(TChar aVal) const;
+    TBool IsFilled(TChar aVal) const;
 private:
     static const TUint kNumBytes = 10;
     TChar iBytes[kNumBytes];
 };
 
+class SuiteAllocatorElastic : public Suite
+{
+    static const TUint kCellsReserved = 4;
+    static const TUint kCellsMax = 14;
+    static const TUint kSlabCells = 4;
+public:
+    SuiteAllocatorElastic();
+    void Test() override;
+private:
+    AllocatorInfoLogger iInfoAggregator;
+};
+
+class SuiteAllocatorContention : public Suite
+{
+    static const TUint kMaxThreads = 8;
+    static const TUint kCellsPerThread = 4;
+    static const TUint kIterations = 100000;
+public:
+    SuiteAllocatorContention();
+    void Test() override;
+private:
+    void Run(TUint aNumThreads);
+    void AllocateFreeThread();
+private:
+    AllocatorInfoLogger iInfoAggregator;
+    Allocator<TestCell>* iAllocator;
+    Semaphore iSemStart;
+    std::atomic<TUint> iNextThreadId;
+    std::atomic<TUint> iErrors;
+};
+
 class SuiteMsgAudioEncoded : public Suite
 {
     static const TUint kMsgCount = 8;
@@ -47,6 +94,19 @@ private:
     AllocatorInfoLogger iInfoAggregator;
 };
 
+class SuiteAudioDataSizeClasses : public Suite
+{
+    static const TUint kMsgCount = 8;
+    static const TUint kSlabBytes = 16 * 1024;
+public:
+    SuiteAudioDataSizeClasses();
+    ~SuiteAudioDataSizeClasses();
+    void Test() override;
+private:
+    MsgFactory* iMsgFactory;
+    AllocatorInfoLogger iInfoAggregator;
+};
+
 class BufferObserver : public IPipelineBufferObserver
 {
 public:
@@ -106,11 +166,26 @@ public:
     SuiteRamp();
     ~SuiteRamp();
     void Test() override;
+private:
+    void TestBlockRampMatchesReference();
+    static void ApplyRampReference(const Ramp& aRamp, const Brx& aData, TUint aBitDepth, TUint aNumChannels, Bwx& aOutput);
 private:
     MsgFactory* iMsgFactory;
     AllocatorInfoLogger iInfoAggregator;
 };
 
+class SuitePcmInterleave : public Suite
+{
+    static const TUint kMaxSamples = 137; // not a multiple of any vector width
+public:
+    SuitePcmInterleave();
+    void Test() override;
+private:
+    void Interleave(TUint aNumChannels, TUint aSrcBits, TUint aBitDepth);
+private:
+    TInt32 iSrc[PcmKernels::kMaxChannels][kMaxSamples];
+};
+
 class SuiteAudioStream : public Suite
 {
     static const TUint kMsgEncodedStreamCount = 1;
@@ -434,6 +509,29 @@ void TestCell::CheckIsFilled(TChar aVal) const
     }
 }
 
+TBool TestCell::IsFilled(TChar aVal) const
+{
+    for (TUint i=0; i<kNumBytes; i++) {
+        if (iBytes[i] != aVal) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// ProviderListAggregator
+
+const std::vector<IInfoProvider*>& ProviderListAggregator::Providers() const
+{
+    return iProviders;
+}
+
+void ProviderListAggregator::Register(IInfoProvider& aProvider, std::vector<Brn>& /*aSupportedQueries*/)
+{
+    iProviders.push_back(&aProvider);
+}
+
 
 // SuiteAllocator
 
@@ -498,6 +596,154 @@ void SuiteAllocator::Test()
         allocator->Free(cells[i]);
     }
     delete allocator;
+
+    // aggregators can read stats without going through QueryInfo
+    ProviderListAggregator aggregator;
+    allocator = new Allocator<TestCell>("TestCell", kNumTestCells, aggregator);
+    TEST(aggregator.Providers().size() == 1);
+    TEST(dynamic_cast<AllocatorBase*>(aggregator.Providers()[0]) == allocator);
+    delete allocator;
+}
+
+
+// SuiteAllocatorElastic
+
+SuiteAllocatorElastic::SuiteAllocatorElastic()
+    : Suite("Elastic allocator tests")
+{
+}
+
+void SuiteAllocatorElastic::Test()
+{
+    Allocator<TestCell>* allocator = new Allocator<TestCell>("TestCell", kCellsReserved, kCellsMax, kSlabCells, iInfoAggregator);
+    TEST(allocator->CellsTotal() == kCellsMax);
+    TEST(allocator->CellsAllocated() == kCellsReserved);
+
+    // allocating beyond the reservation grows by a slab at a time
+    TestCell* cells[kCellsMax];
+    for (TUint i=0; i<kCellsReserved+1; i++) {
+        cells[i] = allocator->Allocate();
+        cells[i]->Fill((TByte)i);
+    }
+    TEST(allocator->CellsAllocated() == kCellsReserved + kSlabCells);
+    for (TUint i=kCellsReserved+1; i<kCellsMax; i++) {
+        cells[i] = allocator->Allocate();
+        cells[i]->Fill((TByte)i);
+    }
+    // final slab is truncated to respect the maximum
+    TEST(allocator->CellsAllocated() == kCellsMax);
+    TEST(allocator->CellsAllocatedMax() == kCellsMax);
+    TEST_THROWS(allocator->Allocate(), AssertionFailed);
+    for (TUint i=0; i<kCellsMax; i++) {
+        cells[i]->CheckIsFilled((TByte)i);
+    }
+    iInfoAggregator.PrintStats();
+
+    // slabs are only trimmed once they've been unneeded for a full Trim() interval
+    for (TUint i=kCellsReserved; i<kCellsMax; i++) {
+        cells[i]->RemoveRef();
+    }
+    allocator->Trim();
+    TEST(allocator->CellsAllocated() == kCellsMax);
+    allocator->Trim();
+    TEST(allocator->CellsAllocated() == kCellsReserved);
+    TEST(allocator->CellsUsed() == kCellsReserved);
+
+    // a slab containing any cell in use is retained
+    for (TUint i=kCellsReserved; i<kCellsReserved+kSlabCells+1; i++) {
+        cells[i] = allocator->Allocate();
+    }
+    TEST(allocator->CellsAllocated() == kCellsReserved + 2*kSlabCells);
+    for (TUint i=0; i<kCellsReserved+kSlabCells; i++) {
+        cells[i]->RemoveRef();
+    }
+    allocator->Trim();
+    allocator->Trim();
+    TEST(allocator->CellsAllocated() == kCellsReserved + 2*kSlabCells);
+    cells[kCellsReserved+kSlabCells]->RemoveRef();
+    allocator->Trim();
+    TEST(allocator->CellsAllocated() == kCellsReserved);
+    TEST(allocator->CellsUsed() == 0);
+    TEST(allocator->CellsAllocatedMax() == kCellsMax);
+
+    // cells remain usable after being trimmed
+    for (TUint i=0; i<kCellsMax; i++) {
+        cells[i] = allocator->Allocate();
+    }
+    for (TUint i=0; i<kCellsMax; i++) {
+        cells[i]->RemoveRef();
+    }
+    delete allocator;
+}
+
+
+// SuiteAllocatorContention
+
+SuiteAllocatorContention::SuiteAllocatorContention()
+    : Suite("Allocator contention")
+    , iAllocator(nullptr)
+    , iSemStart("SACS", 0)
+    , iNextThreadId(0)
+    , iErrors(0)
+{
+}
+
+void SuiteAllocatorContention::Test()
+{
+    iAllocator = new Allocator<TestCell>("TestCell", kMaxThreads * kCellsPerThread, iInfoAggregator);
+    for (TUint numThreads=1; numThreads<=kMaxThreads; numThreads*=2) {
+        Run(numThreads);
+    }
+    TEST(iAllocator->CellsUsed() == 0);
+    TEST(iAllocator->CellsUsedMax() <= kMaxThreads * kCellsPerThread);
+    delete iAllocator;
+    iAllocator = nullptr;
+}
+
+void SuiteAllocatorContention::Run(TUint aNumThreads)
+{
+    iNextThreadId = 0;
+    iErrors = 0;
+    std::vector<ThreadFunctor*> threads;
+    for (TUint i=0; i<aNumThreads; i++) {
+        ThreadFunctor* th = new ThreadFunctor("AllocContention", MakeFunctor(*this, &SuiteAllocatorContention::AllocateFreeThread));
+        threads.push_back(th);
+        th->Start();
+    }
+    const TUint start = Os::TimeInMs(gEnv->OsCtx());
+    for (TUint i=0; i<aNumThreads; i++) {
+        iSemStart.Signal();
+    }
+    for (auto th : threads) {
+        th->Join();
+        delete th;
+    }
+    const TUint elapsedMs = std::max(Os::TimeInMs(gEnv->OsCtx()) - start, 1u);
+    const TUint64 numOps = (TUint64)aNumThreads * kIterations * kCellsPerThread;
+    Print("  %u thread(s): %llu allocate/free pairs in %ums (%llu per ms)\n",
+          aNumThreads, numOps, elapsedMs, numOps / elapsedMs);
+    TEST(iErrors == 0);
+    TEST(iAllocator->CellsUsed() == 0);
+}
+
+void SuiteAllocatorContention::AllocateFreeThread()
+{
+    // cells are filled with a per-thread value then checked before being freed, catching any cell handed to two threads at once
+    const TChar id = (TChar)(++iNextThreadId);
+    TestCell* cells[kCellsPerThread];
+    iSemStart.Wait();
+    for (TUint i=0; i<kIterations; i++) {
+        for (TUint j=0; j<kCellsPerThread; j++) {
+            cells[j] = iAllocator->Allocate();
+            cells[j]->Fill(id);
+        }
+        for (TUint j=0; j<kCellsPerThread; j++) {
+            if (!cells[j]->IsFilled(id)) {
+                iErrors++;
+            }
+            cells[j]->RemoveRef();
+        }
+    }
 }
 
 
@@ -753,6 +999,80 @@ void SuiteMsgAudioEncoded::Test()
 }
 
 
+// SuiteAudioDataSizeClasses
+
+SuiteAudioDataSizeClasses::SuiteAudioDataSizeClasses()
+    : Suite("AudioData size classes")
+{
+    MsgFactoryInitParams init;
+    init.SetMsgAudioEncodedCount(kMsgCount, kMsgCount);
+    init.SetMsgAudioPcmCount(kMsgCount, kMsgCount);
+    init.SetAudioDataElastic(0, kSlabBytes);
+    iMsgFactory = new MsgFactory(iInfoAggregator, init);
+}
+
+SuiteAudioDataSizeClasses::~SuiteAudioDataSizeClasses()
+{
+    delete iMsgFactory;
+}
+
+void SuiteAudioDataSizeClasses::Test()
+{
+    TByte data[EncodedAudio::kMaxBytes];
+    for (TUint i=0; i<sizeof(data); i++) {
+        data[i] = (TByte)i;
+    }
+    TByte output[EncodedAudio::kMaxBytes];
+
+    // small msg grows through each class as data is appended, retaining its content
+    MsgAudioEncoded* msg = iMsgFactory->CreateMsgAudioEncoded(Brn(data, 100));
+    TUint bytes = 100;
+    const TUint kAppendBytes[] = { 900, 1000, 2000, 4000, 208 };
+    for (TUint i=0; i<sizeof(kAppendBytes)/sizeof(kAppendBytes[0]); i++) {
+        TEST(msg->Append(Brn(&data[bytes], kAppendBytes[i])) == kAppendBytes[i]);
+        bytes += kAppendBytes[i];
+        TEST(msg->Bytes() == bytes);
+    }
+    TEST(bytes == EncodedAudio::kMaxBytes);
+    msg->CopyTo(output);
+    TEST(memcmp(output, data, bytes) == 0);
+    // ...and refuses data once the largest class is full
+    TEST(msg->Append(Brn(data, 1)) == 0);
+    msg->RemoveRef();
+
+    // Append() with a limit only grows as far as the limit
+    msg = iMsgFactory->CreateMsgAudioEncoded(Brn(data, 1000));
+    TEST(msg->Append(Brn(&data[1000], 2000), 1500) == 500);
+    TEST(msg->Bytes() == 1500);
+    msg->CopyTo(output);
+    TEST(memcmp(output, data, 1500) == 0);
+    // clones taken before a msg grows are unaffected
+    MsgAudioEncoded* clone = msg->Clone();
+    TEST(msg->Append(Brn(&data[1500], 3000)) == 3000);
+    TEST(clone->Bytes() == 1500);
+    clone->CopyTo(output);
+    TEST(memcmp(output, data, 1500) == 0);
+    clone->RemoveRef();
+    msg->CopyTo(output);
+    TEST(memcmp(output, data, 4500) == 0);
+    msg->RemoveRef();
+
+    // aggregating decoded audio moves up a class when necessary
+    const TUint kPcmBytes = 900; // ~5ms of 44.1kHz, 16-bit stereo
+    MsgAudioPcm* pcm1 = iMsgFactory->CreateMsgAudioPcm(Brn(data, kPcmBytes), 2, 44100, 16, AudioDataEndian::Big, 0);
+    MsgAudioPcm* pcm2 = iMsgFactory->CreateMsgAudioPcm(Brn(&data[kPcmBytes], kPcmBytes), 2, 44100, 16, AudioDataEndian::Big, pcm1->Jiffies());
+    pcm1->Aggregate(pcm2);
+    MsgPlayable* playable = pcm1->CreatePlayable();
+    TEST(playable->Bytes() == 2 * kPcmBytes);
+    ProcessorPcmBufTest pcmProcessor;
+    playable->Read(pcmProcessor);
+    playable->RemoveRef();
+    TEST(memcmp(pcmProcessor.Ptr(), data, 2 * kPcmBytes) == 0);
+
+    iInfoAggregator.PrintStats();
+}
+
+
 // SuiteMsgAudio
 
 SuiteMsgAudio::SuiteMsgAudio()
@@ -976,6 +1296,72 @@ void SuiteMsgAudio::Test()
         TEST(subsample == expected);
     }
 
+    // Attenuation at 24/32-bit; shared audio must not be modified by reading
+    for (TUint bitDepth=24; bitDepth<=32; bitDepth+=8) {
+        const TUint bytes = bitDepth / 8;
+        TByte sample[8];
+        for (TUint i=0; i<sizeof(sample); i++) {
+            sample[i] = (TByte)(0x71 + i);
+        }
+        Brn sampleBuf(sample, 2 * bytes);
+        auto pcm = iMsgFactory->CreateMsgAudioPcm(sampleBuf, 2, 44100, bitDepth, AudioDataEndian::Big, Jiffies::kPerSecond);
+        auto pcmClone = static_cast<MsgAudioPcm*>(pcm->Clone());
+        pcm->SetAttenuation(MsgAudioPcm::kUnityAttenuation / 4);
+        playable = pcm->CreatePlayable();
+        playable->Read(pcmProcessor);
+        playable->RemoveRef();
+        ptr = pcmProcessor.Ptr();
+        for (TUint i=0; i<2; i++) {
+            TInt32 subsampleIn = 0;
+            TInt32 subsampleOut = 0;
+            for (TUint j=0; j<bytes; j++) {
+                subsampleIn |= (TInt32)((TUint32)sample[i*bytes + j] << (24 - 8*j));
+                subsampleOut |= (TInt32)((TUint32)ptr[i*bytes + j] << (24 - 8*j));
+            }
+            TEST(subsampleOut == (subsampleIn / 4));
+        }
+        playable = pcmClone->CreatePlayable();
+        playable->Read(pcmProcessor);
+        playable->RemoveRef();
+        TEST(pcmProcessor.Buf() == sampleBuf);
+    }
+
+    // Little endian conversions match for SIMD and scalar implementations
+    {
+        const TUint kBytes = 4 * 3 * 37; // not a multiple of any vector width
+        Bws<kBytes> src;
+        TUint32 lcg = 1;
+        for (TUint i=0; i<kBytes; i++) {
+            lcg = lcg * 1664525 + 1013904223;
+            src.Append((TByte)(lcg >> 24));
+        }
+        for (TUint bytes=2; bytes<=4; bytes++) {
+            Bws<kBytes> simd;
+            Bws<kBytes> scalar;
+            const TUint numBytes = kBytes - (kBytes % bytes);
+            for (TUint pass=0; pass<2; pass++) {
+                PcmKernels::ForceScalar(pass == 1);
+                TByte* dest = const_cast<TByte*>(pass == 0? simd.Ptr() : scalar.Ptr());
+                Brn in(src.Ptr(), numBytes);
+                auto pcm = iMsgFactory->CreateMsgAudioPcm(in, 1, 44100, bytes*8, AudioDataEndian::Little, 0);
+                playable = pcm->CreatePlayable();
+                playable->Read(pcmProcessor);
+                playable->RemoveRef();
+                (void)memcpy(dest, pcmProcessor.Ptr(), numBytes);
+            }
+            PcmKernels::ForceScalar(false);
+            simd.SetBytes(numBytes);
+            scalar.SetBytes(numBytes);
+            TEST(simd == scalar);
+            TBool swapped = true;
+            for (TUint i=0; i<numBytes; i++) {
+                const TUint subsampleStart = i - (i % bytes);
+                swapped = swapped && (scalar[i] == src[subsampleStart + bytes - 1 - (i % bytes)]);
+            }
+            TEST(swapped);
+        }
+    }
+
     // IPipelineBufferObserver
     BufferObserver bufferObserver;
     const auto msgSize = 2 * Jiffies::kPerMs;
@@ -1733,6 +2119,117 @@ void SuiteRamp::Test()
     for (TUint i=0; i<bytes; i++) {
         TEST(*ptr++ == 0);
     }
+
+    TestBlockRampMatchesReference();
+}
+
+void SuiteRamp::TestBlockRampMatchesReference()
+{
+    static const TUint kBitDepths[] = { 8, 16, 24, 32 };
+    static const TUint kNumSamples = 301; // deliberately not a multiple of any internal block size
+    static const TUint kMaxChannels = 10; // beyond PcmKernels::kMaxChannels, as allowed by StarvationRamper
+    const TUint maxBytes = kNumSamples * kMaxChannels * 4;
+    Bwh audioData(maxBytes, maxBytes);
+    TUint32 seed = 0x12345678;
+    TByte* p = const_cast<TByte*>(audioData.Ptr());
+    for (TUint i=0; i<maxBytes; i++) {
+        seed = seed * 1664525 + 1013904223;
+        p[i] = (TByte)(seed >> 24);
+    }
+    Bwh expected(maxBytes);
+    Bwh actual(maxBytes, maxBytes);
+
+    const TUint kNumRamps = 3;
+    Ramp ramps[kNumRamps];
+    Ramp split;
+    TUint splitPos;
+    (void)ramps[0].Set(Ramp::kMax, kNumSamples, kNumSamples, Ramp::EDown, split, splitPos);
+    (void)ramps[1].Set(Ramp::kMin, kNumSamples, kNumSamples, Ramp::EUp, split, splitPos);
+    (void)ramps[2].Set(Ramp::kMax / 2, kNumSamples, 2 * kNumSamples, Ramp::EDown, split, splitPos);
+
+    // RampApplicator block output must be bit-exact with a full precision, sample at a time reference
+    for (TUint r=0; r<kNumRamps; r++) {
+        for (TUint b=0; b<sizeof(kBitDepths)/sizeof(kBitDepths[0]); b++) {
+            const TUint bitDepth = kBitDepths[b];
+            for (TUint numChannels=1; numChannels<=kMaxChannels; numChannels++) {
+                const TUint bytesPerSample = (bitDepth/8) * numChannels;
+                Brn data(audioData.Ptr(), kNumSamples * bytesPerSample);
+                ApplyRampReference(ramps[r], data, bitDepth, numChannels, expected);
+
+                RampApplicator applicator(ramps[r]);
+                TEST(applicator.Start(data, bitDepth, numChannels) == kNumSamples);
+                TEST(applicator.GetNextSamples(const_cast<TByte*>(actual.Ptr()), kNumSamples) == kNumSamples);
+                TEST(memcmp(actual.Ptr(), expected.Ptr(), expected.Bytes()) == 0);
+
+                // repeat, pulling output in small, odd sized blocks then single samples
+                (void)applicator.Start(data, bitDepth, numChannels);
+                TByte* dest = const_cast<TByte*>(actual.Ptr());
+                TUint remaining = kNumSamples;
+                while (remaining > 10) {
+                    const TUint samples = applicator.GetNextSamples(dest, 7);
+                    dest += samples * bytesPerSample;
+                    remaining -= samples;
+                }
+                while (remaining > 0) {
+                    applicator.GetNextSample(dest);
+                    dest += bytesPerSample;
+                    remaining--;
+                }
+                TEST(applicator.GetNextSamples(dest, 1) == 0);
+                TEST(memcmp(actual.Ptr(), expected.Ptr(), expected.Bytes()) == 0);
+            }
+        }
+    }
+
+    // ramped 24-bit audio read from a MsgPlayable retains its full resolution
+    const TUint kNumChannels = 2;
+    const TUint kMsgSamples = 1200;
+    Brn pcm(audioData.Ptr(), kMsgSamples * 3 * kNumChannels);
+    MsgAudioPcm* audioPcm = iMsgFactory->CreateMsgAudioPcm(pcm, kNumChannels, 44100, 24, AudioDataEndian::Big, 0);
+    TUint remainingDuration = audioPcm->Jiffies();
+    MsgAudio* remaining = nullptr;
+    TEST(Ramp::kMin == audioPcm->SetRamp(Ramp::kMax, remainingDuration, Ramp::EDown, remaining));
+    TEST(remaining == nullptr);
+    MsgPlayable* playable = audioPcm->CreatePlayable();
+    const Ramp ramp = playable->Ramp();
+    ProcessorPcmBufTest pcmProcessor;
+    playable->Read(pcmProcessor);
+    playable->RemoveRef();
+    ApplyRampReference(ramp, pcm, 24, kNumChannels, expected);
+    TEST(pcmProcessor.Buf() == expected);
+    TBool lowBytesSet = false;
+    for (TUint i=2; i<expected.Bytes(); i+=3) {
+        if (expected[i] != 0) {
+            lowBytesSet = true;
+            break;
+        }
+    }
+    TEST(lowBytesSet);
+}
+
+void SuiteRamp::ApplyRampReference(const Ramp& aRamp, const Brx& aData, TUint aBitDepth, TUint aNumChannels, Bwx& aOutput)
+{ // static
+    const TUint bytesPerSubsample = aBitDepth / 8;
+    const TUint numSamples = aData.Bytes() / (bytesPerSubsample * aNumChannels);
+    const TInt totalRamp = (TInt)aRamp.Start() - (TInt)aRamp.End();
+    const TByte* src = aData.Ptr();
+    TByte* dest = const_cast<TByte*>(aOutput.Ptr());
+    for (TUint i=0; i<numSamples; i++) {
+        const TUint ramp = (numSamples == 1? aRamp.Start() : (TUint)((TInt)aRamp.Start() - (((TInt)i * totalRamp) / (TInt)(numSamples-1))));
+        const TUint rampIndex = std::min(kRampArrayCount-1, (Ramp::kMax - Ramp::kMin - ramp + (1<<4)) >> 5);
+        const TInt64 gain = kRampArray[rampIndex];
+        for (TUint j=0; j<aNumChannels; j++) {
+            TUint32 subsample = 0;
+            for (TUint k=0; k<bytesPerSubsample; k++) {
+                subsample |= (TUint32)(*src++) << (24 - (8 * k));
+            }
+            const TUint32 ramped = (TUint32)(TInt32)(((TInt64)(TInt32)subsample * gain) >> 15);
+            for (TUint k=0; k<bytesPerSubsample; k++) {
+                *dest++ = (TByte)(ramped >> (24 - (8 * k)));
+            }
+        }
+    }
+    aOutput.SetBytes(numSamples * bytesPerSubsample * aNumChannels);
 }
 
 
@@ -1753,6 +2250,77 @@ SuiteMsgAudioDsd::~SuiteMsgAudioDsd()
     delete iMsgFactory;
 }
 
+
+// SuitePcmInterleave
+
+SuitePcmInterleave::SuitePcmInterleave()
+    : Suite("Planar to interleaved big endian pcm")
+{
+}
+
+void SuitePcmInterleave::Test()
+{
+    // fill each channel with values that mostly fit aSrcBits but occasionally need clipping
+    TUint32 lcg = 1;
+    for (TUint i=0; i<PcmKernels::kMaxChannels; i++) {
+        for (TUint j=0; j<kMaxSamples; j++) {
+            lcg = lcg * 1664525 + 1013904223;
+            iSrc[i][j] = (TInt32)lcg;
+        }
+    }
+    const TUint kSrcBits[] = { 16, 24, 29, 32 };
+    const TUint kChannels[] = { 1, 2, 3, 6 };
+    for (TUint srcBits : kSrcBits) {
+        for (TUint channels : kChannels) {
+            for (TUint bitDepth=8; bitDepth<=32; bitDepth+=8) {
+                Interleave(channels, srcBits, bitDepth);
+            }
+        }
+    }
+}
+
+void SuitePcmInterleave::Interleave(TUint aNumChannels, TUint aSrcBits, TUint aBitDepth)
+{
+    TInt32 src[PcmKernels::kMaxChannels][kMaxSamples];
+    const TInt32* srcPtrs[PcmKernels::kMaxChannels];
+    for (TUint i=0; i<aNumChannels; i++) {
+        for (TUint j=0; j<kMaxSamples; j++) {
+            // every 8th subsample is out of range
+            src[i][j] = (j % 8 == 0? iSrc[i][j] : iSrc[i][j] >> (32 - aSrcBits));
+        }
+        srcPtrs[i] = src[i];
+    }
+    const TUint kMaxBytes = PcmKernels::kMaxChannels * kMaxSamples * 4;
+    Bws<kMaxBytes> simd;
+    Bws<kMaxBytes> scalar;
+    const TUint bytes = aNumChannels * kMaxSamples * (aBitDepth / 8);
+    for (TUint pass=0; pass<2; pass++) {
+        PcmKernels::ForceScalar(pass == 1);
+        TByte* dest = const_cast<TByte*>(pass == 0? simd.Ptr() : scalar.Ptr());
+        PcmKernels::InterleaveToBigEndian(srcPtrs, aNumChannels, kMaxSamples, aSrcBits, dest, aBitDepth);
+    }
+    PcmKernels::ForceScalar(false);
+    simd.SetBytes(bytes);
+    scalar.SetBytes(bytes);
+    TEST(simd == scalar);
+
+    const TInt32 max = (TInt32)((1u << (aSrcBits - 1)) - 1);
+    const TInt32 min = -max - 1;
+    const TByte* p = scalar.Ptr();
+    TBool match = true;
+    for (TUint j=0; j<kMaxSamples; j++) {
+        for (TUint i=0; i<aNumChannels; i++) {
+            const TInt32 clipped = std::min(std::max(src[i][j], min), max);
+            const TUint32 expected = (TUint32)clipped << (32 - aSrcBits);
+            for (TUint k=0; k<aBitDepth/8; k++) {
+                match = match && (*p++ == (TByte)(expected >> (24 - 8*k)));
+            }
+        }
+    }
+    TEST(match);
+}
+
+
 void SuiteMsgAudioDsd::Test()
 {
     static const TUint dataSize = 1200;
@@ -3534,10 +4102,14 @@ void TestMsg()
 {
     Runner runner("Basic Msg tests\n");
     runner.Add(new SuiteAllocator());
+    runner.Add(new SuiteAllocatorElastic());
+    runner.Add(new SuiteAllocatorContention());
     runner.Add(new SuiteMsgAudioEncoded());
+    runner.Add(new SuiteAudioDataSizeClasses());
     runner.Add(new SuiteRamp());
     runner.Add(new SuiteMsgAudio());
     runner.Add(new SuiteMsgPlayable());
+    runner.Add(new SuitePcmInterleave());
     runner.Add(new SuiteMsgAudioDsd());
     runner.Add(new SuiteAudioStream());
     runner.Add(new SuiteMetaText());
@@ -0,0 +1,284 @@
+#include <OpenHome/Private/SuiteUnitTest.h>
+#include <OpenHome/Media/Pipeline/PipelineMetrics.h>
+#include <OpenHome/Media/Pipeline/Logger.h>
+#include <OpenHome/Media/Pipeline/Msg.h>
+#include <OpenHome/Media/Utils/AllocatorInfoLogger.h>
+#include <OpenHome/Private/InfoProvider.h>
+#include <OpenHome/Private/Stream.h>
+#include <OpenHome/Json.h>
+
+#include <limits.h>
+#include <vector>
+
+using namespace OpenHome;
+using namespace OpenHome::TestFramework;
+using namespace OpenHome::Media;
+
+namespace OpenHome {
+namespace Media {
+
+class MetricsInfoAggregator : public IInfoAggregator
+{
+public:
+    MetricsInfoAggregator();
+    IInfoProvider* Provider() const;
+    const std::vector<Brn>& Queries() const;
+private: // from IInfoAggregator
+    void Register(IInfoProvider& aProvider, std::vector<Brn>& aSupportedQueries) override;
+private:
+    IInfoProvider* iProvider;
+    std::vector<Brn> iQueries;
+};
+
+class SuitePipelineMetrics : public SuiteUnitTest, private IPipelineElementUpstream
+{
+public:
+    SuitePipelineMetrics();
+private: // from SuiteUnitTest
+    void Setup() override;
+    void TearDown() override;
+private: // from IPipelineElementUpstream
+    Msg* Pull() override;
+private:
+    void TestDisabledByDefault();
+    void TestBucketIndex();
+    void TestHistogramStats();
+    void TestCounter();
+    void TestReset();
+    void TestLoggerRecordsOnlyWhenEnabled();
+    void TestQueryInfoRegistered();
+    void TestJson();
+private:
+    AllocatorInfoLogger iInfoAggregatorMsgs;
+    MetricsInfoAggregator* iInfoAggregator;
+    MsgFactory* iMsgFactory;
+    PipelineMetrics* iMetrics;
+};
+
+} // namespace Media
+} // namespace OpenHome
+
+
+// MetricsInfoAggregator
+
+MetricsInfoAggregator::MetricsInfoAggregator()
+    : iProvider(nullptr)
+{
+}
+
+IInfoProvider* MetricsInfoAggregator::Provider() const
+{
+    return iProvider;
+}
+
+const std::vector<Brn>& MetricsInfoAggregator::Queries() const
+{
+    return iQueries;
+}
+
+void MetricsInfoAggregator::Register(IInfoProvider& aProvider, std::vector<Brn>& aSupportedQueries)
+{
+    iProvider = &aProvider;
+    iQueries = aSupportedQueries;
+}
+
+
+// SuitePipelineMetrics
+
+SuitePipelineMetrics::SuitePipelineMetrics()
+    : SuiteUnitTest("PipelineMetrics")
+{
+    AddTest(MakeFunctor(*this, &SuitePipelineMetrics::TestDisabledByDefault), "TestDisabledByDefault");
+    AddTest(MakeFunctor(*this, &SuitePipelineMetrics::TestBucketIndex), "TestBucketIndex");
+    AddTest(MakeFunctor(*this, &SuitePipelineMetrics::TestHistogramStats), "TestHistogramStats");
+    AddTest(MakeFunctor(*this, &SuitePipelineMetrics::TestCounter), "TestCounter");
+    AddTest(MakeFunctor(*this, &SuitePipelineMetrics::TestReset), "TestReset");
+    AddTest(MakeFunctor(*this, &SuitePipelineMetrics::TestLoggerRecordsOnlyWhenEnabled), "TestLoggerRecordsOnlyWhenEnabled");
+    AddTest(MakeFunctor(*this, &SuitePipelineMetrics::TestQueryInfoRegistered), "TestQueryInfoRegistered");
+    AddTest(MakeFunctor(*this, &SuitePipelineMetrics::TestJson), "TestJson");
+}
+
+void SuitePipelineMetrics::Setup()
+{
+    MsgFactoryInitParams init;
+    init.SetMsgFlushCount(2);
+    iMsgFactory = new MsgFactory(iInfoAggregatorMsgs, init);
+    iInfoAggregator = new MetricsInfoAggregator();
+    iMetrics = new PipelineMetrics(*iInfoAggregator);
+}
+
+void SuitePipelineMetrics::TearDown()
+{
+    delete iMetrics;
+    delete iInfoAggregator;
+    delete iMsgFactory;
+}
+
+Msg* SuitePipelineMetrics::Pull()
+{
+    return iMsgFactory->CreateMsgFlush(1);
+}
+
+void SuitePipelineMetrics::TestDisabledByDefault()
+{
+    TEST(!iMetrics->Enabled());
+    iMetrics->SetEnabled(true);
+    TEST(iMetrics->Enabled());
+    iMetrics->SetEnabled(false);
+    TEST(!iMetrics->Enabled());
+}
+
+void SuitePipelineMetrics::TestBucketIndex()
+{
+    TEST(MetricsHistogram::BucketIndex(0) == 0);
+    TEST(MetricsHistogram::BucketIndex(1) == 1);
+    TEST(MetricsHistogram::BucketIndex(2) == 2);
+    TEST(MetricsHistogram::BucketIndex(3) == 2);
+    TEST(MetricsHistogram::BucketIndex(4) == 3);
+    TEST(MetricsHistogram::BucketIndex(1023) == 10);
+    TEST(MetricsHistogram::BucketIndex(1024) == 11);
+    TEST(MetricsHistogram::BucketIndex(UINT_MAX) == MetricsHistogram::kNumBuckets - 1);
+}
+
+void SuitePipelineMetrics::TestHistogramStats()
+{
+    auto& h = iMetrics->RegisterHistogram("Element", "pull", "us");
+    TEST(h.Count() == 0);
+    TEST(h.Max() == 0);
+    h.Add(3);
+    h.Add(100);
+    h.Add(0);
+    TEST(h.Count() == 3);
+    TEST(h.Sum() == 103);
+    TEST(h.Max() == 100);
+    TEST(h.Bucket(0) == 1);
+    TEST(h.Bucket(2) == 1);
+    TEST(h.Bucket(7) == 1);
+    TEST_THROWS(h.Bucket(MetricsHistogram::kNumBuckets), AssertionFailed);
+}
+
+void SuitePipelineMetrics::TestCounter()
+{
+    auto& c = iMetrics->RegisterCounter("Element", "starvation");
+    TEST(c.Count() == 0);
+    c.Inc();
+    c.Inc();
+    TEST(c.Count() == 2);
+}
+
+void SuitePipelineMetrics::TestReset()
+{
+    auto& h = iMetrics->RegisterHistogram("Element", "pull", "us");
+    auto& c = iMetrics->RegisterCounter("Element", "starvation");
+    h.Add(5);
+    c.Inc();
+    iMetrics->Reset();
+    TEST(h.Count() == 0);
+    TEST(h.Sum() == 0);
+    TEST(h.Max() == 0);
+    TEST(h.Bucket(3) == 0);
+    TEST(c.Count() == 0);
+}
+
+void SuitePipelineMetrics::TestLoggerRecordsOnlyWhenEnabled()
+{
+    Logger logger(*this, "Logger");
+    logger.SetMetrics(*iMetrics);
+    TEST_THROWS(logger.SetMetrics(*iMetrics), AssertionFailed);
+
+    logger.Pull()->RemoveRef();
+    WriterBwh writer(1024);
+    iMetrics->WriteJson(writer);
+    JsonParser parser;
+    parser.Parse(writer.Buffer());
+    auto histograms = JsonParserArray::Create(parser.String("histograms"));
+    JsonParser histogram;
+    histogram.Parse(histograms.NextObject());
+    TEST(histogram.String("element") == Brn("Logger"));
+    TEST(histogram.String("metric") == Brn("pull"));
+    TEST(histogram.Num("count") == 0);
+
+    iMetrics->SetEnabled(true);
+    logger.Pull()->RemoveRef();
+    logger.Pull()->RemoveRef();
+    writer.Reset();
+    iMetrics->WriteJson(writer);
+    parser.Parse(writer.Buffer());
+    histograms = JsonParserArray::Create(parser.String("histograms"));
+    histogram.Parse(histograms.NextObject());
+    TEST(histogram.Num("count") == 2);
+}
+
+void SuitePipelineMetrics::TestQueryInfoRegistered()
+{
+    TEST(iInfoAggregator->Provider() == iMetrics);
+    TEST(iInfoAggregator->Queries().size() == 1);
+    TEST(iInfoAggregator->Queries()[0] == PipelineMetrics::kQueryMetrics);
+
+    WriterBwh writer(1024);
+    iInfoAggregator->Provider()->QueryInfo(Brn("unsupported"), writer);
+    TEST(writer.Buffer().Bytes() == 0);
+    iInfoAggregator->Provider()->QueryInfo(PipelineMetrics::kQueryMetrics, writer);
+    TEST(writer.Buffer().Bytes() > 0);
+    JsonParser parser;
+    parser.Parse(writer.Buffer());
+    TEST(!parser.Bool("enabled"));
+}
+
+void SuitePipelineMetrics::TestJson()
+{
+    auto& h = iMetrics->RegisterHistogram("Decoded Audio Reservoir", "occupancy", "ms");
+    (void)iMetrics->RegisterHistogram("Empty", "pull", "us");
+    auto& c = iMetrics->RegisterCounter("StarvationRamper", "starvation");
+    h.Add(0);
+    h.Add(1);
+    h.Add(6);
+    h.Add(7);
+    c.Inc();
+    iMetrics->SetEnabled(true);
+
+    WriterBwh writer(1024);
+    iMetrics->WriteJson(writer);
+    JsonParser parser;
+    parser.Parse(writer.Buffer());
+    TEST(parser.Bool("enabled"));
+
+    auto histograms = JsonParserArray::Create(parser.String("histograms"));
+    JsonParser histogram;
+    histogram.Parse(histograms.NextObject());
+    TEST(histogram.String("element") == Brn("Decoded Audio Reservoir"));
+    TEST(histogram.String("metric") == Brn("occupancy"));
+    TEST(histogram.String("units") == Brn("ms"));
+    TEST(histogram.Num("count") == 4);
+    TEST(histogram.Num("sum") == 14);
+    TEST(histogram.Num("max") == 7);
+    auto buckets = JsonParserArray::Create(histogram.String("buckets"));
+    TEST(buckets.NextInt() == 1); // 0
+    TEST(buckets.NextInt() == 1); // 1
+    TEST(buckets.NextInt() == 0); // [2..3]
+    TEST(buckets.NextInt() == 2); // [4..7]
+    TEST_THROWS(buckets.NextInt(), JsonArrayEnumerationComplete);
+
+    histogram.Parse(histograms.NextObject());
+    TEST(histogram.String("element") == Brn("Empty"));
+    TEST(histogram.Num("count") == 0);
+    buckets = JsonParserArray::Create(histogram.String("buckets"));
+    TEST(buckets.Type() == JsonParserArray::ValType::Null);
+    TEST_THROWS(histograms.NextObject(), JsonArrayEnumerationComplete);
+
+    auto counters = JsonParserArray::Create(parser.String("counters"));
+    JsonParser counter;
+    counter.Parse(counters.NextObject());
+    TEST(counter.String("element") == Brn("StarvationRamper"));
+    TEST(counter.String("metric") == Brn("starvation"));
+    TEST(counter.Num("count") == 1);
+}
+
+
+
+void TestPipelineMetrics()
+{
+    Runner runner("PipelineMetrics tests\n");
+    runner.Add(new SuitePipelineMetrics());
+    runner.Run();
+}
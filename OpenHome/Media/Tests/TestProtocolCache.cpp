@@ -0,0 +1,427 @@
+#include <OpenHome/Private/SuiteUnitTest.h>
+#include <OpenHome/Media/Protocol/Protocol.h>
+#include <OpenHome/Media/Protocol/ProtocolFactory.h>
+#include <OpenHome/Media/Protocol/StreamCache.h>
+#include <OpenHome/Media/Pipeline/Msg.h>
+#include <OpenHome/Media/Utils/AllocatorInfoLogger.h>
+#include <OpenHome/Net/Private/Globals.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Private/Stream.h>
+
+using namespace OpenHome;
+using namespace OpenHome::TestFramework;
+using namespace OpenHome::Media;
+
+namespace OpenHome {
+namespace Media {
+
+// Stands in for ProtocolHttp, serving ranges of a stream without any network access
+class DummyNetworkProtocol : public Protocol
+{
+public:
+    DummyNetworkProtocol(Environment& aEnv);
+    TUint StreamCount() const;
+    TUint GetCount() const;
+    TUint64 GetBytes() const;
+public:
+    static TByte DataAt(TUint64 aOffset);
+private: // from Protocol
+    void Initialise(MsgFactory& aMsgFactory, IPipelineElementDownstream& aDownstream) override;
+    void Interrupt(TBool aInterrupt) override;
+    ProtocolStreamResult Stream(const Brx& aUri) override;
+    ProtocolGetResult Get(IWriter& aWriter, const Brx& aUri, TUint64 aOffset, TUint aBytes) override;
+private: // from IStreamHandler
+    TUint TryStop(TUint aStreamId) override;
+private:
+    TUint iStreamCount;
+    TUint iGetCount;
+    TUint64 iGetBytes;
+};
+
+class SuiteProtocolCache : public SuiteUnitTest, private PipelineElement, private IPipelineElementDownstream,
+                           private IPipelineIdProvider, private IFlushIdProvider
+{
+    static const TUint kMaxCacheBytes = 1024 * 1024;
+    static const TUint kMaxCacheEntries = 2;
+    static const TUint kStreamBytes = 100 * 1024;
+    static const TUint kLargeStreamBytes = 512 * 1024;
+    static const TUint kSupportedMsgTypes;
+    static const Brn kUri;
+public:
+    SuiteProtocolCache();
+private: // from SuiteUnitTest
+    void Setup() override;
+    void TearDown() override;
+private: // from IPipelineElementDownstream
+    void Push(Msg* aMsg) override;
+private: // from IPipelineIdProvider
+    TUint NextStreamId() override;
+    EStreamPlay OkToPlay(TUint aStreamId) override;
+private: // from IFlushIdProvider
+    TUint NextFlushId() override;
+private: // from IMsgProcessor
+    Msg* ProcessMsg(MsgEncodedStream* aMsg) override;
+    Msg* ProcessMsg(MsgAudioEncoded* aMsg) override;
+    Msg* ProcessMsg(MsgFlush* aMsg) override;
+private:
+    void Fill(TUint64 aStreamBytes, TUint64 aStart, TUint64 aEnd);
+    ProtocolStreamResult DoStream();
+    void TestFullyCached();
+    void TestGapFilled();
+    void TestLargeGapNotClaimed();
+    void TestManyGapsNotClaimed();
+    void TestSeek();
+    void TestStop();
+    void TestGetCached();
+private:
+    AllocatorInfoLogger iInfoAggregator;
+    MsgFactory* iMsgFactory;
+    TrackFactory* iTrackFactory;
+    ProtocolManager* iProtocolManager;
+    DummyNetworkProtocol* iNetwork;
+    StreamCache* iCache;
+    IStreamHandler* iStreamHandler;
+    TUint iStreamId;
+    TUint iNextStreamId;
+    TUint iNextFlushId;
+    TUint64 iOffset;        // stream offset of the next byte we expect to be pushed
+    TUint64 iBytesReceived;
+    TBool iDataValid;
+    TUint iFlushCount;
+    TUint iLastFlushId;
+    TUint64 iInterruptAfterBytes;
+    TBool iSeek;            // interrupt by seeking to iSeekOffset rather than stopping
+    TUint64 iSeekOffset;
+    TUint iExpectedFlushId;
+    Bws<EncodedAudio::kMaxBytes> iBuf;
+};
+
+} // namespace Media
+} // namespace OpenHome
+
+
+// DummyNetworkProtocol
+
+DummyNetworkProtocol::DummyNetworkProtocol(Environment& aEnv)
+    : Protocol(aEnv)
+    , iStreamCount(0)
+    , iGetCount(0)
+    , iGetBytes(0)
+{
+}
+
+TUint DummyNetworkProtocol::StreamCount() const
+{
+    return iStreamCount;
+}
+
+TUint DummyNetworkProtocol::GetCount() const
+{
+    return iGetCount;
+}
+
+TUint64 DummyNetworkProtocol::GetBytes() const
+{
+    return iGetBytes;
+}
+
+TByte DummyNetworkProtocol::DataAt(TUint64 aOffset)
+{ // static
+    return (TByte)(aOffset ^ (aOffset >> 8));
+}
+
+void DummyNetworkProtocol::Initialise(MsgFactory& /*aMsgFactory*/, IPipelineElementDownstream& /*aDownstream*/)
+{
+}
+
+void DummyNetworkProtocol::Interrupt(TBool /*aInterrupt*/)
+{
+}
+
+ProtocolStreamResult DummyNetworkProtocol::Stream(const Brx& /*aUri*/)
+{
+    iStreamCount++;
+    return EProtocolErrorNotSupported;
+}
+
+ProtocolGetResult DummyNetworkProtocol::Get(IWriter& aWriter, const Brx& /*aUri*/, TUint64 aOffset, TUint aBytes)
+{
+    iGetCount++;
+    iGetBytes += aBytes;
+    Bws<1024> buf;
+    TUint64 offset = aOffset;
+    TUint remaining = aBytes;
+    while (remaining > 0) {
+        buf.SetBytes(0);
+        while (buf.Bytes() < buf.MaxBytes() && remaining > 0) {
+            buf.Append(DataAt(offset++));
+            remaining--;
+        }
+        aWriter.Write(buf);
+    }
+    aWriter.WriteFlush();
+    return EProtocolGetSuccess;
+}
+
+TUint DummyNetworkProtocol::TryStop(TUint /*aStreamId*/)
+{
+    return MsgFlush::kIdInvalid;
+}
+
+
+// SuiteProtocolCache
+
+const TUint SuiteProtocolCache::kSupportedMsgTypes =   eMode
+                                                     | eTrack
+                                                     | eEncodedStream
+                                                     | eAudioEncoded
+                                                     | eMetatext
+                                                     | eFlush;
+const Brn SuiteProtocolCache::kUri("http://host/1.flac");
+
+SuiteProtocolCache::SuiteProtocolCache()
+    : SuiteUnitTest("ProtocolCache")
+    , PipelineElement(kSupportedMsgTypes)
+{
+    AddTest(MakeFunctor(*this, &SuiteProtocolCache::TestFullyCached), "TestFullyCached");
+    AddTest(MakeFunctor(*this, &SuiteProtocolCache::TestGapFilled), "TestGapFilled");
+    AddTest(MakeFunctor(*this, &SuiteProtocolCache::TestLargeGapNotClaimed), "TestLargeGapNotClaimed");
+    AddTest(MakeFunctor(*this, &SuiteProtocolCache::TestManyGapsNotClaimed), "TestManyGapsNotClaimed");
+    AddTest(MakeFunctor(*this, &SuiteProtocolCache::TestSeek), "TestSeek");
+    AddTest(MakeFunctor(*this, &SuiteProtocolCache::TestStop), "TestStop");
+    AddTest(MakeFunctor(*this, &SuiteProtocolCache::TestGetCached), "TestGetCached");
+}
+
+void SuiteProtocolCache::Setup()
+{
+    MsgFactoryInitParams init;
+    init.SetMsgAudioEncodedCount(100, 100);
+    init.SetMsgTrackCount(2);
+    init.SetMsgEncodedStreamCount(2);
+    init.SetMsgMetaTextCount(2);
+    init.SetMsgFlushCount(4);
+    iMsgFactory = new MsgFactory(iInfoAggregator, init);
+    iTrackFactory = new TrackFactory(iInfoAggregator, 1);
+    iCache = new StreamCache(Brn("."), kMaxCacheBytes, kMaxCacheEntries);
+    iProtocolManager = new ProtocolManager(*this, *iMsgFactory, *this, *this);
+    iProtocolManager->Add(ProtocolFactory::NewCache(*gEnv, *iCache));
+    iNetwork = new DummyNetworkProtocol(*gEnv);
+    iProtocolManager->Add(iNetwork);
+    iStreamHandler = nullptr;
+    iStreamId = IPipelineIdProvider::kStreamIdInvalid;
+    iNextStreamId = 1;
+    iNextFlushId = MsgFlush::kIdInvalid + 1;
+    iOffset = 0;
+    iBytesReceived = 0;
+    iDataValid = true;
+    iFlushCount = 0;
+    iLastFlushId = MsgFlush::kIdInvalid;
+    iInterruptAfterBytes = 0;
+    iSeek = false;
+    iSeekOffset = 0;
+    iExpectedFlushId = MsgFlush::kIdInvalid;
+}
+
+void SuiteProtocolCache::TearDown()
+{
+    delete iProtocolManager;
+    delete iCache;
+    delete iTrackFactory;
+    delete iMsgFactory;
+}
+
+void SuiteProtocolCache::Push(Msg* aMsg)
+{
+    Msg* msg = aMsg->Process(*this);
+    if (msg != nullptr) {
+        msg->RemoveRef();
+    }
+}
+
+TUint SuiteProtocolCache::NextStreamId()
+{
+    return iNextStreamId++;
+}
+
+EStreamPlay SuiteProtocolCache::OkToPlay(TUint /*aStreamId*/)
+{
+    return ePlayYes;
+}
+
+TUint SuiteProtocolCache::NextFlushId()
+{
+    return iNextFlushId++;
+}
+
+Msg* SuiteProtocolCache::ProcessMsg(MsgEncodedStream* aMsg)
+{
+    iStreamHandler = aMsg->StreamHandler();
+    iStreamId = aMsg->StreamId();
+    TEST(aMsg->Seekable());
+    return aMsg;
+}
+
+Msg* SuiteProtocolCache::ProcessMsg(MsgAudioEncoded* aMsg)
+{
+    const TUint bytes = aMsg->Bytes();
+    ASSERT(bytes <= iBuf.MaxBytes());
+    aMsg->CopyTo(const_cast<TByte*>(iBuf.Ptr()));
+    iBuf.SetBytes(bytes);
+    for (TUint i=0; i<bytes; i++) {
+        if (iBuf[i] != DummyNetworkProtocol::DataAt(iOffset + i)) {
+            iDataValid = false;
+            break;
+        }
+    }
+    iOffset += bytes;
+    iBytesReceived += bytes;
+    if (iInterruptAfterBytes > 0 && iBytesReceived >= iInterruptAfterBytes) {
+        iInterruptAfterBytes = 0;
+        if (iSeek) {
+            iExpectedFlushId = iStreamHandler->TrySeek(iStreamId, iSeekOffset);
+        }
+        else {
+            iExpectedFlushId = iStreamHandler->TryStop(iStreamId);
+        }
+        TEST(iExpectedFlushId != MsgFlush::kIdInvalid);
+    }
+    return aMsg;
+}
+
+Msg* SuiteProtocolCache::ProcessMsg(MsgFlush* aMsg)
+{
+    iFlushCount++;
+    iLastFlushId = aMsg->Id();
+    if (iSeek && iLastFlushId == iExpectedFlushId) {
+        iOffset = iSeekOffset;
+        iBytesReceived = 0;
+    }
+    return aMsg;
+}
+
+void SuiteProtocolCache::Fill(TUint64 aStreamBytes, TUint64 aStart, TUint64 aEnd)
+{
+    StreamCacheEntry* entry = iCache->Create(kUri, aStreamBytes, true);
+    ASSERT(entry != nullptr);
+    Bws<1024> buf;
+    TUint64 offset = aStart;
+    while (offset < aEnd) {
+        buf.SetBytes(0);
+        while (buf.Bytes() < buf.MaxBytes() && offset + buf.Bytes() < aEnd) {
+            buf.Append(DummyNetworkProtocol::DataAt(offset + buf.Bytes()));
+        }
+        entry->Write(offset, buf);
+        offset += buf.Bytes();
+    }
+    iCache->Close(*entry);
+}
+
+ProtocolStreamResult SuiteProtocolCache::DoStream()
+{
+    Track* track = iTrackFactory->CreateTrack(kUri, Brx::Empty());
+    const ProtocolStreamResult res = iProtocolManager->DoStream(*track);
+    track->RemoveRef();
+    return res;
+}
+
+void SuiteProtocolCache::TestFullyCached()
+{
+    Fill(kStreamBytes, 0, kStreamBytes);
+    TEST(DoStream() == EProtocolStreamSuccess);
+    TEST(iBytesReceived == kStreamBytes);
+    TEST(iDataValid);
+    TEST(iNetwork->StreamCount() == 0);
+    TEST(iNetwork->GetCount() == 0);
+}
+
+void SuiteProtocolCache::TestGapFilled()
+{
+    static const TUint kGapStart = 40 * 1024;
+    static const TUint kGapEnd = 50 * 1024;
+    Fill(kStreamBytes, 0, kGapStart);
+    Fill(kStreamBytes, kGapEnd, kStreamBytes);
+    TEST(DoStream() == EProtocolStreamSuccess);
+    TEST(iBytesReceived == kStreamBytes);
+    TEST(iDataValid);
+    TEST(iNetwork->StreamCount() == 0);
+    // the whole gap is fetched in a single request and added to the cache
+    TEST(iNetwork->GetCount() == 1);
+    TEST(iNetwork->GetBytes() == kGapEnd - kGapStart);
+    StreamCacheEntry* entry = iCache->Open(kUri);
+    TEST(entry != nullptr);
+    TEST(entry->BytesAvailable(0) == kStreamBytes);
+    iCache->Close(*entry);
+}
+
+void SuiteProtocolCache::TestLargeGapNotClaimed()
+{
+    Fill(kLargeStreamBytes, 0, 16 * 1024);
+    TEST(DoStream() == EProtocolErrorNotSupported);
+    TEST(iBytesReceived == 0);
+    TEST(iNetwork->StreamCount() == 1);
+    TEST(iNetwork->GetCount() == 0);
+}
+
+void SuiteProtocolCache::TestManyGapsNotClaimed()
+{
+    // small gaps, but each would need its own request
+    static const TUint kGapBytes = 1024;
+    static const TUint kInterval = 10 * 1024;
+    for (TUint offset=0; offset<kStreamBytes; offset+=kInterval) {
+        Fill(kStreamBytes, offset, offset + kInterval - kGapBytes);
+    }
+    TEST(DoStream() == EProtocolErrorNotSupported);
+    TEST(iBytesReceived == 0);
+    TEST(iNetwork->StreamCount() == 1);
+    TEST(iNetwork->GetCount() == 0);
+}
+
+void SuiteProtocolCache::TestSeek()
+{
+    Fill(kStreamBytes, 0, kStreamBytes);
+    iInterruptAfterBytes = 20 * 1024;
+    iSeek = true;
+    iSeekOffset = 70001;
+    TEST(DoStream() == EProtocolStreamSuccess);
+    TEST(iFlushCount == 1);
+    TEST(iLastFlushId == iExpectedFlushId);
+    TEST(iBytesReceived == kStreamBytes - iSeekOffset);
+    TEST(iDataValid);
+    TEST(iNetwork->GetCount() == 0);
+}
+
+void SuiteProtocolCache::TestStop()
+{
+    Fill(kStreamBytes, 0, kStreamBytes);
+    iInterruptAfterBytes = 20 * 1024;
+    TEST(DoStream() == EProtocolStreamStopped);
+    TEST(iFlushCount == 1);
+    TEST(iLastFlushId == iExpectedFlushId);
+    TEST(iBytesReceived < kStreamBytes);
+    TEST(iDataValid);
+    TEST(iNetwork->GetCount() == 0);
+}
+
+void SuiteProtocolCache::TestGetCached()
+{
+    Fill(kStreamBytes, 0, kStreamBytes / 2);
+    Bws<1024> buf;
+    WriterBuffer writer(buf);
+    TEST(iProtocolManager->TryGet(writer, kUri, 1000, buf.MaxBytes()));
+    TEST(buf.Bytes() == buf.MaxBytes());
+    TEST(buf[0] == DummyNetworkProtocol::DataAt(1000));
+    TEST(iNetwork->GetCount() == 0);
+    // ranges that aren't cached are passed on to the next protocol
+    buf.SetBytes(0);
+    TEST(iProtocolManager->TryGet(writer, kUri, kStreamBytes - buf.MaxBytes(), buf.MaxBytes()));
+    TEST(iNetwork->GetCount() == 1);
+}
+
+
+
+void TestProtocolCache()
+{
+    Runner runner("ProtocolCache tests\n");
+    runner.Add(new SuiteProtocolCache());
+    runner.Run();
+}
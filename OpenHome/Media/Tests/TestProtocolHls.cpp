@@ -196,6 +196,105 @@ private:
     SegmentStreamer* iStreamer;
 };
 
+class MockSegmentUriProvider : public ISegmentUriProvider
+{
+public:
+    static const TUint kSegmentsUnlimited = std::numeric_limits<TUint>::max();
+public:
+    MockSegmentUriProvider();
+    void SetDurations(TUint aSegmentDurationMs, TUint aTargetDurationMs);
+    void SetSegmentCount(TUint aSegments);
+    TUint Interrupts() const;
+public: // from ISegmentUriProvider
+    TUint NextSegmentUri(Uri& aUri) override;
+    TUint TargetDurationMs() const override;
+    void InterruptSegmentUriProvider(TBool aInterrupt) override;
+private:
+    mutable Mutex iLock;
+    TUint iSegmentDurationMs;
+    TUint iTargetDurationMs;
+    TUint iSegments;
+    TUint iNextSegment;
+    TUint iInterrupts;
+    TBool iInterrupted;
+};
+
+/*
+ * Serves segments of identical size whose content is derived from the index in the segment URI.
+ *
+ * A single segment can be made to stall part way through its content until Release() or Interrupt(true) is called.
+ */
+class MockUriLoader : public IUriLoader, private IReader
+{
+public:
+    static const TUint kStallNone = std::numeric_limits<TUint>::max();
+public:
+    MockUriLoader();
+    static TByte ContentByte(TUint aSegment, TUint aOffset);
+    void SetSegmentBytes(TUint aBytes);
+    void StallSegment(TUint aSegment, TUint aOffset);
+    void WaitForStall();
+    void Release();
+    void WaitForLoads(TUint aLoads);
+    TUint Loads() const;
+    TUint BytesRead() const;
+    TUint Resets() const;
+    TUint Interrupts() const;
+public: // from IUriLoader
+    IReader& Load(const Uri& aUri) override;
+    void Reset() override;
+    void Interrupt(TBool aInterrupt) override;
+private: // from IReader
+    Brn Read(TUint aBytes) override;
+    void ReadFlush() override;
+    void ReadInterrupt() override;
+private:
+    mutable Mutex iLock;
+    Semaphore iSemLoaded;
+    Semaphore iSemStalled;
+    Semaphore iSemRelease;
+    Bwh iBuf;
+    TUint iSegmentBytes;
+    TUint iSegment;
+    TUint iOffset;
+    TUint iStallSegment;
+    TUint iStallOffset;
+    TBool iReleased;
+    TBool iInterrupted;
+    TUint iLoads;
+    TUint iBytesRead;
+    TUint iResets;
+    TUint iInterrupts;
+};
+
+class SuiteHlsSegmentProvider : public OpenHome::TestFramework::SuiteUnitTest
+{
+public:
+    SuiteHlsSegmentProvider();
+public: // from SuiteUnitTest
+    void Setup() override;
+    void TearDown() override;
+private:
+    void TestPrefetch();
+    void TestPrefetchDepthFromTargetDuration();
+    void TestPrefetchBoundedByBuffer();
+    void TestDiscardCurrentSegment();
+    void TestDiscardSegmentDownloading();
+    void TestResetDuringDownload();
+    void TestDestroyDuringDownload();
+    void TestBufferFull();
+private:
+    TUint ReadContent(IReader& aReader, TUint aSegment, TUint aOffset, TUint aMaxBytes);
+    void CheckSegment(TUint aSegment, TUint aBytes);
+    void ReleaseLoaderDelayed();
+private:
+    static const TUint kSettleMs = 50;
+private:
+    MockSegmentUriProvider* iUriProvider;
+    MockUriLoader* iLoader;
+    SegmentProvider* iProvider;
+};
+
 } // namespace Test
 } // namespace Media
 } // namespace OpenHome
@@ -1702,6 +1801,420 @@ void SuiteHlsSegmentStreamer::TestEndOfStreamReadMoreThan()
 
 
 
+
+// MockSegmentUriProvider
+
+MockSegmentUriProvider::MockSegmentUriProvider()
+    : iLock("MSUP")
+    , iSegmentDurationMs(1000)
+    , iTargetDurationMs(1000)
+    , iSegments(kSegmentsUnlimited)
+    , iNextSegment(0)
+    , iInterrupts(0)
+    , iInterrupted(false)
+{
+}
+
+void MockSegmentUriProvider::SetDurations(TUint aSegmentDurationMs, TUint aTargetDurationMs)
+{
+    AutoMutex _(iLock);
+    iSegmentDurationMs = aSegmentDurationMs;
+    iTargetDurationMs = aTargetDurationMs;
+}
+
+void MockSegmentUriProvider::SetSegmentCount(TUint aSegments)
+{
+    AutoMutex _(iLock);
+    iSegments = aSegments;
+}
+
+TUint MockSegmentUriProvider::Interrupts() const
+{
+    AutoMutex _(iLock);
+    return iInterrupts;
+}
+
+TUint MockSegmentUriProvider::NextSegmentUri(Uri& aUri)
+{
+    AutoMutex _(iLock);
+    if (iInterrupted) {
+        THROW(HlsSegmentUriError);
+    }
+    if (iNextSegment >= iSegments) {
+        THROW(HlsEndOfStream);
+    }
+    Bws<64> uri("http://host/");
+    Ascii::AppendDec(uri, iNextSegment++);
+    aUri.Replace(uri);
+    return iSegmentDurationMs;
+}
+
+TUint MockSegmentUriProvider::TargetDurationMs() const
+{
+    AutoMutex _(iLock);
+    return iTargetDurationMs;
+}
+
+void MockSegmentUriProvider::InterruptSegmentUriProvider(TBool aInterrupt)
+{
+    AutoMutex _(iLock);
+    iInterrupted = aInterrupt;
+    if (aInterrupt) {
+        iInterrupts++;
+    }
+}
+
+
+// MockUriLoader
+
+MockUriLoader::MockUriLoader()
+    : iLock("MULD")
+    , iSemLoaded("MULL", 0)
+    , iSemStalled("MULS", 0)
+    , iSemRelease("MULR", 0)
+    , iBuf(32 * 1024)
+    , iSegmentBytes(1000)
+    , iSegment(0)
+    , iOffset(0)
+    , iStallSegment(kStallNone)
+    , iStallOffset(0)
+    , iReleased(false)
+    , iInterrupted(false)
+    , iLoads(0)
+    , iBytesRead(0)
+    , iResets(0)
+    , iInterrupts(0)
+{
+}
+
+TByte MockUriLoader::ContentByte(TUint aSegment, TUint aOffset)
+{ // static
+    // Prime modulus so that content doesn't repeat in step with any power-of-two buffer size.
+    return static_cast<TByte>((aSegment * 37 + aOffset) % 251);
+}
+
+void MockUriLoader::SetSegmentBytes(TUint aBytes)
+{
+    AutoMutex _(iLock);
+    iSegmentBytes = aBytes;
+}
+
+void MockUriLoader::StallSegment(TUint aSegment, TUint aOffset)
+{
+    AutoMutex _(iLock);
+    iStallSegment = aSegment;
+    iStallOffset = aOffset;
+    iReleased = false;
+}
+
+void MockUriLoader::WaitForStall()
+{
+    iSemStalled.Wait();
+}
+
+void MockUriLoader::Release()
+{
+    AutoMutex _(iLock);
+    iReleased = true;
+    iSemRelease.Signal();
+}
+
+void MockUriLoader::WaitForLoads(TUint aLoads)
+{
+    for (TUint i=0; i<aLoads; i++) {
+        iSemLoaded.Wait();
+    }
+}
+
+TUint MockUriLoader::Loads() const
+{
+    AutoMutex _(iLock);
+    return iLoads;
+}
+
+TUint MockUriLoader::BytesRead() const
+{
+    AutoMutex _(iLock);
+    return iBytesRead;
+}
+
+TUint MockUriLoader::Resets() const
+{
+    AutoMutex _(iLock);
+    return iResets;
+}
+
+TUint MockUriLoader::Interrupts() const
+{
+    AutoMutex _(iLock);
+    return iInterrupts;
+}
+
+IReader& MockUriLoader::Load(const Uri& aUri)
+{
+    AutoMutex _(iLock);
+    if (iInterrupted) {
+        THROW(UriLoaderError);
+    }
+    // Path is of form "/<segment index>".
+    const Brx& path = aUri.Path();
+    iSegment = Ascii::Uint(path.Split(1));
+    iOffset = 0;
+    iLoads++;
+    iSemLoaded.Signal();
+    return *this;
+}
+
+void MockUriLoader::Reset()
+{
+    AutoMutex _(iLock);
+    iResets++;
+}
+
+void MockUriLoader::Interrupt(TBool aInterrupt)
+{
+    AutoMutex _(iLock);
+    iInterrupted = aInterrupt;
+    if (aInterrupt) {
+        iInterrupts++;
+        iSemRelease.Signal();
+    }
+}
+
+Brn MockUriLoader::Read(TUint aBytes)
+{
+    AutoMutex _(iLock);
+    if (iSegment == iStallSegment && iOffset == iStallOffset) {
+        iSemStalled.Signal();
+        while (!iReleased && !iInterrupted) {
+            (void)iSemRelease.Clear();
+            iLock.Signal();
+            iSemRelease.Wait();
+            iLock.Wait();
+        }
+        iStallSegment = kStallNone;
+    }
+    if (iInterrupted) {
+        THROW(ReaderError);
+    }
+
+    TUint end = iSegmentBytes;
+    if (iSegment == iStallSegment && iOffset < iStallOffset) {
+        end = iStallOffset;
+    }
+    const TUint bytes = std::min(std::min(aBytes, end - iOffset), iBuf.MaxBytes());
+    iBuf.SetBytes(0);
+    for (TUint i=0; i<bytes; i++) {
+        iBuf.Append(ContentByte(iSegment, iOffset + i));
+    }
+    iOffset += bytes;
+    iBytesRead += bytes;
+    return Brn(iBuf);
+}
+
+void MockUriLoader::ReadFlush()
+{
+}
+
+void MockUriLoader::ReadInterrupt()
+{
+}
+
+
+// SuiteHlsSegmentProvider
+
+SuiteHlsSegmentProvider::SuiteHlsSegmentProvider()
+    : SuiteUnitTest("SuiteHlsSegmentProvider")
+{
+    AddTest(MakeFunctor(*this, &SuiteHlsSegmentProvider::TestPrefetch), "TestPrefetch");
+    AddTest(MakeFunctor(*this, &SuiteHlsSegmentProvider::TestPrefetchDepthFromTargetDuration), "TestPrefetchDepthFromTargetDuration");
+    AddTest(MakeFunctor(*this, &SuiteHlsSegmentProvider::TestPrefetchBoundedByBuffer), "TestPrefetchBoundedByBuffer");
+    AddTest(MakeFunctor(*this, &SuiteHlsSegmentProvider::TestDiscardCurrentSegment), "TestDiscardCurrentSegment");
+    AddTest(MakeFunctor(*this, &SuiteHlsSegmentProvider::TestDiscardSegmentDownloading), "TestDiscardSegmentDownloading");
+    AddTest(MakeFunctor(*this, &SuiteHlsSegmentProvider::TestResetDuringDownload), "TestResetDuringDownload");
+    AddTest(MakeFunctor(*this, &SuiteHlsSegmentProvider::TestDestroyDuringDownload), "TestDestroyDuringDownload");
+    AddTest(MakeFunctor(*this, &SuiteHlsSegmentProvider::TestBufferFull), "TestBufferFull");
+}
+
+void SuiteHlsSegmentProvider::Setup()
+{
+    iUriProvider = new MockSegmentUriProvider();
+    iLoader = new MockUriLoader();
+    iProvider = new SegmentProvider(*iLoader, *iUriProvider);
+}
+
+void SuiteHlsSegmentProvider::TearDown()
+{
+    delete iProvider;
+    delete iLoader;
+    delete iUriProvider;
+}
+
+TUint SuiteHlsSegmentProvider::ReadContent(IReader& aReader, TUint aSegment, TUint aOffset, TUint aMaxBytes)
+{
+    TUint bytes = 0;
+    TBool match = true;
+    while (bytes < aMaxBytes) {
+        const Brn buf = aReader.Read(aMaxBytes - bytes);
+        if (buf.Bytes() == 0) {
+            break;
+        }
+        for (TUint i=0; i<buf.Bytes(); i++) {
+            if (buf[i] != MockUriLoader::ContentByte(aSegment, aOffset + bytes + i)) {
+                match = false;
+            }
+        }
+        bytes += buf.Bytes();
+    }
+    TEST(match);
+    return bytes;
+}
+
+void SuiteHlsSegmentProvider::CheckSegment(TUint aSegment, TUint aBytes)
+{
+    IReader& reader = iProvider->NextSegment();
+    TEST(ReadContent(reader, aSegment, 0, aBytes) == aBytes);
+    TEST(reader.Read(aBytes).Bytes() == 0);
+}
+
+void SuiteHlsSegmentProvider::ReleaseLoaderDelayed()
+{
+    Thread::Sleep(kSettleMs);
+    iLoader->Release();
+}
+
+void SuiteHlsSegmentProvider::TestPrefetch()
+{
+    iUriProvider->SetSegmentCount(3);
+
+    // All segments are fetched ahead of the first being read.
+    IReader& reader = iProvider->NextSegment();
+    iLoader->WaitForLoads(3);
+    TEST(ReadContent(reader, 0, 0, 1000) == 1000);
+    TEST(reader.Read(1000).Bytes() == 0);
+
+    CheckSegment(1, 1000);
+    CheckSegment(2, 1000);
+    TEST_THROWS(iProvider->NextSegment(), HlsEndOfStream);
+    TEST(iLoader->Loads() == 3);
+}
+
+void SuiteHlsSegmentProvider::TestPrefetchDepthFromTargetDuration()
+{
+    // Current segment plus kPrefetchTargetDurations of prefetched segments.
+    const TUint kDepth = 1 + SegmentProvider::kPrefetchTargetDurations;
+    iUriProvider->SetDurations(1000, 1000);
+    (void)iProvider->NextSegment();
+    iLoader->WaitForLoads(kDepth);
+    Thread::Sleep(kSettleMs);
+    TEST(iLoader->Loads() == kDepth);
+
+    // Moving on to the next segment allows one more to be fetched.
+    CheckSegment(1, 1000);
+    iLoader->WaitForLoads(1);
+    Thread::Sleep(kSettleMs);
+    TEST(iLoader->Loads() == kDepth + 1);
+}
+
+void SuiteHlsSegmentProvider::TestPrefetchBoundedByBuffer()
+{
+    // Target duration would allow more segments than fit in the buffer.
+    const TUint kSegmentBytes = 200 * 1024;
+    iLoader->SetSegmentBytes(kSegmentBytes);
+    IReader& reader = iProvider->NextSegment();
+    iLoader->WaitForLoads(2);
+    Thread::Sleep(kSettleMs);
+    TEST(iLoader->Loads() == 2);
+
+    // Space released by reading allows another segment to be fetched.
+    TEST(ReadContent(reader, 0, 0, kSegmentBytes) == kSegmentBytes);
+    TEST(reader.Read(kSegmentBytes).Bytes() == 0);
+    iLoader->WaitForLoads(1);
+    Thread::Sleep(kSettleMs);
+    TEST(iLoader->Loads() == 3);
+
+    CheckSegment(1, kSegmentBytes);
+    CheckSegment(2, kSegmentBytes);
+}
+
+void SuiteHlsSegmentProvider::TestDiscardCurrentSegment()
+{
+    iUriProvider->SetSegmentCount(3);
+
+    // Partially read segment is skipped, leaving the next segment intact.
+    IReader& reader = iProvider->NextSegment();
+    TEST(ReadContent(reader, 0, 0, 100) == 100);
+    CheckSegment(1, 1000);
+
+    // Segment that hasn't been read from at all.
+    (void)iProvider->NextSegment();
+    TEST_THROWS(iProvider->NextSegment(), HlsEndOfStream);
+}
+
+void SuiteHlsSegmentProvider::TestDiscardSegmentDownloading()
+{
+    iUriProvider->SetSegmentCount(3);
+    iLoader->StallSegment(1, 500);
+    CheckSegment(0, 1000);
+    IReader& reader = iProvider->NextSegment();
+    iLoader->WaitForStall();
+    TEST(ReadContent(reader, 1, 0, 200) == 200);
+
+    // Remainder of segment 1 is downloaded after it is discarded so must be dropped.
+    ThreadFunctor releaser("HlsRelease", MakeFunctor(*this, &SuiteHlsSegmentProvider::ReleaseLoaderDelayed));
+    releaser.Start();
+    CheckSegment(2, 1000);
+    TEST_THROWS(iProvider->NextSegment(), HlsEndOfStream);
+}
+
+void SuiteHlsSegmentProvider::TestResetDuringDownload()
+{
+    iUriProvider->SetSegmentCount(4);
+    iLoader->StallSegment(1, 500);
+    (void)iProvider->NextSegment();
+    iLoader->WaitForStall();
+
+    // Reset() interrupts the stalled download and doesn't return until prefetching has stopped.
+    iProvider->Reset();
+    TEST(iLoader->Interrupts() == 1);
+    TEST(iLoader->Resets() == 1);
+    TEST(iUriProvider->Interrupts() == 1);
+    TEST(iProvider->SegmentsDiscarded() == 1);
+
+    // Prefetching restarts from the next URI the provider returns.
+    CheckSegment(2, 1000);
+    CheckSegment(3, 1000);
+    TEST_THROWS(iProvider->NextSegment(), HlsEndOfStream);
+}
+
+void SuiteHlsSegmentProvider::TestDestroyDuringDownload()
+{
+    iLoader->StallSegment(1, 500);
+    (void)iProvider->NextSegment();
+    iLoader->WaitForStall();
+    delete iProvider;
+    iProvider = nullptr;
+    TEST(iLoader->Interrupts() == 1);
+}
+
+void SuiteHlsSegmentProvider::TestBufferFull()
+{
+    // Single segment larger than the buffer is streamed through it.
+    const TUint kSegmentBytes = SegmentProvider::kBufferBytes + SegmentProvider::kBufferBytes / 2;
+    iUriProvider->SetSegmentCount(2);
+    iLoader->SetSegmentBytes(kSegmentBytes);
+    IReader& reader = iProvider->NextSegment();
+    Thread::Sleep(kSettleMs);
+    TEST(iLoader->BytesRead() == SegmentProvider::kBufferBytes);
+
+    // Reads wrap around the end of the buffer.
+    TEST(ReadContent(reader, 0, 0, kSegmentBytes) == kSegmentBytes);
+    TEST(reader.Read(kSegmentBytes).Bytes() == 0);
+    CheckSegment(1, kSegmentBytes);
+    TEST_THROWS(iProvider->NextSegment(), HlsEndOfStream);
+}
+
+
 void TestProtocolHls(Environment& /*aEnv*/)
 {
     Runner runner("HLS tests\n");
@@ -1709,5 +2222,6 @@ void TestProtocolHls(Environment& /*aEnv*/)
     runner.Add(new SuiteHlsPlaylistParser());
     runner.Add(new SuiteHlsM3uReader());
     runner.Add(new SuiteHlsSegmentStreamer());
+    runner.Add(new SuiteHlsSegmentProvider());
     runner.Run();
 }
@@ -226,6 +226,18 @@ private: // from TestHttpSessionSeek
     void Respond();
 };
 
+// TestHttpSessionSeekValid
+
+class TestHttpSessionSeekValid : public TestHttpSessionSeek
+{
+public:
+    TestHttpSessionSeekValid(Semaphore& aSemServerWait, Semaphore& aSemExternalOp);
+private:
+    void WriteResponsePartialContent(TUint aLength);
+private: // from TestHttpSessionSeek
+    void Respond();
+};
+
 
 class SessionFactory
 {
@@ -269,6 +281,7 @@ public:
     TUint TrackCount() const;
     TUint StreamCount() const;
     TUint DataTotal() const;
+    TUint DataSinceFlush() const;
     IStreamHandler& StreamHandler() const;
     void WaitUntilEncodedStream();
 private: // from IPipelineElementDownstream
@@ -299,6 +312,7 @@ private:
     TUint iTrackCount;
     TUint iStreamCount;
     TUint iDataTotal;
+    TUint iDataSinceFlush;
     IStreamHandler* iStreamHandler;
     Semaphore iSemEncodedStream;
 };
@@ -450,6 +464,17 @@ private:
     void SeekThread();
 };
 
+class SuiteHttpSeekReadAhead : public SuiteHttpSeekBase
+{
+    static const TUint kSeekBytes = 1000;
+public:
+    SuiteHttpSeekReadAhead();
+private: // from SuiteHttpSeekBase
+    void Test();
+private:
+    void SeekThread();
+};
+
 } // namespace Media
 } // namespace OpenHome
 
@@ -939,6 +964,29 @@ void TestHttpSessionSeekInvalid::Respond()
 }
 
 
+// TestHttpSessionSeekValid
+
+TestHttpSessionSeekValid::TestHttpSessionSeekValid(Semaphore& aSemServerWait, Semaphore& aSemExternalOp)
+    : TestHttpSessionSeek(aSemServerWait, aSemExternalOp)
+{
+}
+
+void TestHttpSessionSeekValid::WriteResponsePartialContent(TUint aLength)
+{
+    iWriterResponse->WriteStatus(HttpStatus::kPartialContent, Http::eHttp11);
+    TestHttpServer::WriteHeaderPartialContent(*iWriterResponse, 0, aLength-1, aLength);
+    Http::WriteHeaderContentLength(*iWriterResponse, aLength);
+    iWriterResponse->WriteFlush();
+}
+
+void TestHttpSessionSeekValid::Respond()
+{
+    // Only a single request is served. Any attempt to seek by reconnecting will fail.
+    WriteResponsePartialContent(kStreamLen);
+    Stream(0, kStreamLen, kStreamLen/2);
+}
+
+
 // SessionFactory
 
 TestHttpSession* SessionFactory::Create(ESession aSession)
@@ -971,9 +1019,7 @@ TestHttpSessionSeek* SessionSeekFactory::Create(ESessionSeek aSession, Semaphore
     switch (aSession)
     {
     case eSeekSuccess:
-        //return new TestHttpSessionSeekValid(aSemServerWait, aSemExternalOp);
-        ASSERTS();
-        return nullptr;
+        return new TestHttpSessionSeekValid(aSemServerWait, aSemExternalOp);
     case eSeekInvalid:
         return new TestHttpSessionSeekInvalid(aSemServerWait, aSemExternalOp);
     default:
@@ -992,6 +1038,7 @@ TestHttpSupplier::TestHttpSupplier(TUint aDataSize)
     , iTrackCount(0)
     , iStreamCount(0)
     , iDataTotal(0)
+    , iDataSinceFlush(0)
     , iStreamHandler(nullptr)
     , iSemEncodedStream("THSS", 0)
 {
@@ -1026,6 +1073,11 @@ TUint TestHttpSupplier::DataTotal() const
     return iDataTotal;
 }
 
+TUint TestHttpSupplier::DataSinceFlush() const
+{
+    return iDataSinceFlush;
+}
+
 IStreamHandler& TestHttpSupplier::StreamHandler() const
 {
     return *iStreamHandler;
@@ -1077,6 +1129,7 @@ Msg* TestHttpSupplier::ProcessMsg(MsgEncodedStream* aMsg)
 Msg* TestHttpSupplier::ProcessMsg(MsgAudioEncoded* aMsg)
 {
     iDataTotal += aMsg->Bytes();
+    iDataSinceFlush += aMsg->Bytes();
     if (iLive && iDataTotal >= iDataSize) {
         // We are only simulating a live stream, so want to tell
         // client to stop when data has run out.
@@ -1102,6 +1155,7 @@ Msg* TestHttpSupplier::ProcessMsg(MsgHalt* aMsg)
 
 Msg* TestHttpSupplier::ProcessMsg(MsgFlush* aMsg)
 {
+    iDataSinceFlush = 0;
     return aMsg;
 }
 
@@ -1554,6 +1608,45 @@ void SuiteHttpSeekInvalid::SeekThread()
 }
 
 
+// SuiteHttpSeekReadAhead
+
+SuiteHttpSeekReadAhead::SuiteHttpSeekReadAhead()
+    : SuiteHttpSeekBase("HTTP read ahead seek test", SessionSeekFactory::eSeekSuccess)
+{
+}
+
+void SuiteHttpSeekReadAhead::Test()
+{
+    // Set up seek thread where TrySeek will be invoked during Stream().
+    ThreadFunctor thread("HTTP seek test", MakeFunctor(*this, &SuiteHttpSeekReadAhead::SeekThread));
+    thread.Start();
+
+    Track* track = iTrackFactory->CreateTrack(iServer->ServingUri().AbsoluteUri(), Brx::Empty());
+    ProtocolStreamResult res = iProtocolManager->DoStream(*track);
+    track->RemoveRef();
+    TEST(res == EProtocolStreamSuccess);
+
+    // Seek is served from the original connection so no new stream is started.
+    TEST(iSupply->TrackCount() == 1);
+    TEST(iSupply->StreamCount() == 1);
+
+    // All data following the seek point is received.
+    const TUint seekPos = iHttpSession->DataSize()/2 + kSeekBytes;
+    TEST(iSupply->DataSinceFlush() == iHttpSession->DataSize() - seekPos);
+}
+
+void SuiteHttpSeekReadAhead::SeekThread()
+{
+    iSemServerWait->Wait();
+    iSupply->WaitUntilEncodedStream();
+    IStreamHandler& streamHandler = iSupply->StreamHandler();
+    const TUint seekPos = iHttpSession->DataSize()/2 + kSeekBytes;
+    const TUint seekRes = streamHandler.TrySeek(iSupply->StreamId(), seekPos);
+    TEST(seekRes != MsgFlush::kIdInvalid);
+    iSemExternalOp->Signal();
+}
+
+
 
 void TestProtocolHttp()
 {
@@ -1565,5 +1658,6 @@ void TestProtocolHttp()
     runner.Add(new SuiteHttpLiveReconnect());
     runner.Add(new SuiteHttpChunked());
     runner.Add(new SuiteHttpSeekInvalid());
+    runner.Add(new SuiteHttpSeekReadAhead());
     runner.Run();
 }
@@ -14,6 +14,10 @@ SIMPLE_TEST_DECLARATION(TestAudioReservoir);
 SIMPLE_TEST_DECLARATION(TestCodecController);
 SIMPLE_TEST_DECLARATION(TestConfigManager);
 SIMPLE_TEST_DECLARATION(TestContainer);
+SIMPLE_TEST_DECLARATION(TestMpeg4Tables);
+SIMPLE_TEST_DECLARATION(TestMp3FrameIndex);
+SIMPLE_TEST_DECLARATION(TestFlacSeekIndex);
+SIMPLE_TEST_DECLARATION(TestFlacFrameSplitter);
 SIMPLE_TEST_DECLARATION(TestContentProcessor);
 SIMPLE_TEST_DECLARATION(TestDecodedAudioAggregator);
 SIMPLE_TEST_DECLARATION(TestIdProvider);
@@ -21,6 +25,9 @@ SIMPLE_TEST_DECLARATION(TestFiller);
 SIMPLE_TEST_DECLARATION(TestToneGenerator);
 SIMPLE_TEST_DECLARATION(TestMuteManager);
 SIMPLE_TEST_DECLARATION(TestMsg);
+SIMPLE_TEST_DECLARATION(TestOhmCodec);
+SIMPLE_TEST_DECLARATION(TestOhmParity);
+SIMPLE_TEST_DECLARATION(TestOhmMsg);
 SIMPLE_TEST_DECLARATION(TestPipeline);
 SIMPLE_TEST_DECLARATION(TestPipelineConfig);
 SIMPLE_TEST_DECLARATION(TestPreDriver);
@@ -28,11 +35,16 @@ SIMPLE_TEST_DECLARATION(TestProtocolHttp);
 SIMPLE_TEST_DECLARATION(TestRamper);
 SIMPLE_TEST_DECLARATION(TestReporter);
 SIMPLE_TEST_DECLARATION(TestRewinder);
+SIMPLE_TEST_DECLARATION(TestStreamCache);
+SIMPLE_TEST_DECLARATION(TestProtocolCache);
+SIMPLE_TEST_DECLARATION(TestFileMapped);
 SIMPLE_TEST_DECLARATION(TestStreamValidator);
+SIMPLE_TEST_DECLARATION(TestDsdToPcm);
 SIMPLE_TEST_DECLARATION(TestSeeker);
 SIMPLE_TEST_DECLARATION(TestSkipper);
 SIMPLE_TEST_DECLARATION(TestSilencer);
 SIMPLE_TEST_DECLARATION(TestStarvationRamper);
+SIMPLE_TEST_DECLARATION(TestPipelineMetrics);
 SIMPLE_TEST_DECLARATION(TestMuter);
 SIMPLE_TEST_DECLARATION(TestMuterVolume);
 SIMPLE_TEST_DECLARATION(TestVolumeRamper);
@@ -81,6 +93,10 @@ void OpenHome::TestFramework::Runner::Main(TInt /*aArgc*/, TChar* /*aArgv*/[], N
     shellTests.push_back(ShellTest("TestCodecController", ShellTestCodecController));
     shellTests.push_back(ShellTest("TestConfigManager", ShellTestConfigManager));
     shellTests.push_back(ShellTest("TestContainer", ShellTestContainer));
+    shellTests.push_back(ShellTest("TestMpeg4Tables", ShellTestMpeg4Tables));
+    shellTests.push_back(ShellTest("TestMp3FrameIndex", ShellTestMp3FrameIndex));
+    shellTests.push_back(ShellTest("TestFlacSeekIndex", ShellTestFlacSeekIndex));
+    shellTests.push_back(ShellTest("TestFlacFrameSplitter", ShellTestFlacFrameSplitter));
     shellTests.push_back(ShellTest("TestContentProcessor", ShellTestContentProcessor));
     shellTests.push_back(ShellTest("TestDecodedAudioAggregator", ShellTestDecodedAudioAggregator));
     shellTests.push_back(ShellTest("TestIdProvider", ShellTestIdProvider));
@@ -88,6 +104,9 @@ void OpenHome::TestFramework::Runner::Main(TInt /*aArgc*/, TChar* /*aArgv*/[], N
     shellTests.push_back(ShellTest("TestToneGenerator", ShellTestToneGenerator));
     shellTests.push_back(ShellTest("TestMuteManager", ShellTestMuteManager));
     shellTests.push_back(ShellTest("TestMsg", ShellTestMsg));
+    shellTests.push_back(ShellTest("TestOhmCodec", ShellTestOhmCodec));
+    shellTests.push_back(ShellTest("TestOhmParity", ShellTestOhmParity));
+    shellTests.push_back(ShellTest("TestOhmMsg", ShellTestOhmMsg));
     shellTests.push_back(ShellTest("TestPipeline", ShellTestPipeline));
     shellTests.push_back(ShellTest("TestPipelineConfig", ShellTestPipelineConfig));
     shellTests.push_back(ShellTest("TestPowerManager", ShellTestPowerManager));
@@ -97,11 +116,16 @@ void OpenHome::TestFramework::Runner::Main(TInt /*aArgc*/, TChar* /*aArgv*/[], N
     shellTests.push_back(ShellTest("TestProtocolHttp", ShellTestProtocolHttp));
     shellTests.push_back(ShellTest("TestRamper", ShellTestRamper));
     shellTests.push_back(ShellTest("TestReporter", ShellTestReporter));
+    shellTests.push_back(ShellTest("TestStreamCache", ShellTestStreamCache));
+    shellTests.push_back(ShellTest("TestProtocolCache", ShellTestProtocolCache));
+    shellTests.push_back(ShellTest("TestFileMapped", ShellTestFileMapped));
     shellTests.push_back(ShellTest("TestStreamValidator", ShellTestStreamValidator));
+    shellTests.push_back(ShellTest("TestDsdToPcm", ShellTestDsdToPcm));
     shellTests.push_back(ShellTest("TestSeeker", ShellTestSeeker));
     shellTests.push_back(ShellTest("TestSkipper", ShellTestSkipper));
     shellTests.push_back(ShellTest("TestSilencer", ShellTestSilencer));
     shellTests.push_back(ShellTest("TestStarvationRamper", ShellTestStarvationRamper));
+    shellTests.push_back(ShellTest("TestPipelineMetrics", ShellTestPipelineMetrics));
     shellTests.push_back(ShellTest("TestMuter", ShellTestMuter));
     shellTests.push_back(ShellTest("TestMuterVolume", ShellTestMuterVolume));
     shellTests.push_back(ShellTest("TestVolumeRamper", ShellTestVolumeRamper));
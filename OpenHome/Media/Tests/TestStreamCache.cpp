@@ -0,0 +1,259 @@
+#include <OpenHome/Private/SuiteUnitTest.h>
+#include <OpenHome/Media/Protocol/StreamCache.h>
+#include <OpenHome/Buffer.h>
+#include <OpenHome/Private/Stream.h>
+
+using namespace OpenHome;
+using namespace OpenHome::TestFramework;
+using namespace OpenHome::Media;
+
+namespace OpenHome {
+namespace Media {
+
+class SuiteStreamCache : public SuiteUnitTest
+{
+    static const TUint kMaxBytes = 1000;
+    static const TUint kMaxEntries = 3;
+    static const Brn kUri1;
+    static const Brn kUri2;
+    static const Brn kUri3;
+    static const Brn kUri4;
+public:
+    SuiteStreamCache();
+private: // from SuiteUnitTest
+    void Setup() override;
+    void TearDown() override;
+private:
+    void Write(StreamCacheEntry& aEntry, TUint64 aOffset, TUint aBytes);
+    TBool ReadMatches(StreamCacheEntry& aEntry, TUint64 aOffset, TUint aBytes);
+    StreamCacheEntry* Fill(const Brx& aUri, TUint aBytes);
+    void TestNothingCached();
+    void TestWriteRead();
+    void TestRangesMerge();
+    void TestReopen();
+    void TestStreamChanged();
+    void TestEvictLeastRecentlyUsed();
+    void TestOpenEntryNotEvicted();
+    void TestMaxEntries();
+    void TestStreamTooLarge();
+private:
+    StreamCache* iCache;
+    Bws<kMaxBytes> iBuf;
+};
+
+} // namespace Media
+} // namespace OpenHome
+
+
+// SuiteStreamCache
+
+const Brn SuiteStreamCache::kUri1("http://host/1.flac");
+const Brn SuiteStreamCache::kUri2("http://host/2.flac");
+const Brn SuiteStreamCache::kUri3("http://host/3.flac");
+const Brn SuiteStreamCache::kUri4("http://host/4.flac");
+
+SuiteStreamCache::SuiteStreamCache()
+    : SuiteUnitTest("StreamCache")
+{
+    AddTest(MakeFunctor(*this, &SuiteStreamCache::TestNothingCached), "TestNothingCached");
+    AddTest(MakeFunctor(*this, &SuiteStreamCache::TestWriteRead), "TestWriteRead");
+    AddTest(MakeFunctor(*this, &SuiteStreamCache::TestRangesMerge), "TestRangesMerge");
+    AddTest(MakeFunctor(*this, &SuiteStreamCache::TestReopen), "TestReopen");
+    AddTest(MakeFunctor(*this, &SuiteStreamCache::TestStreamChanged), "TestStreamChanged");
+    AddTest(MakeFunctor(*this, &SuiteStreamCache::TestEvictLeastRecentlyUsed), "TestEvictLeastRecentlyUsed");
+    AddTest(MakeFunctor(*this, &SuiteStreamCache::TestOpenEntryNotEvicted), "TestOpenEntryNotEvicted");
+    AddTest(MakeFunctor(*this, &SuiteStreamCache::TestMaxEntries), "TestMaxEntries");
+    AddTest(MakeFunctor(*this, &SuiteStreamCache::TestStreamTooLarge), "TestStreamTooLarge");
+}
+
+void SuiteStreamCache::Setup()
+{
+    iCache = new StreamCache(Brn("."), kMaxBytes, kMaxEntries);
+}
+
+void SuiteStreamCache::TearDown()
+{
+    delete iCache;
+}
+
+void SuiteStreamCache::Write(StreamCacheEntry& aEntry, TUint64 aOffset, TUint aBytes)
+{
+    iBuf.SetBytes(0);
+    for (TUint i=0; i<aBytes; i++) {
+        iBuf.Append((TByte)(aOffset + i));
+    }
+    aEntry.Write(aOffset, iBuf);
+}
+
+TBool SuiteStreamCache::ReadMatches(StreamCacheEntry& aEntry, TUint64 aOffset, TUint aBytes)
+{
+    try {
+        aEntry.Read(aOffset, iBuf, aBytes);
+    }
+    catch (ReaderError&) {
+        return false;
+    }
+    if (iBuf.Bytes() != aBytes) {
+        return false;
+    }
+    for (TUint i=0; i<aBytes; i++) {
+        if (iBuf[i] != (TByte)(aOffset + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+StreamCacheEntry* SuiteStreamCache::Fill(const Brx& aUri, TUint aBytes)
+{
+    StreamCacheEntry* entry = iCache->Create(aUri, aBytes, true);
+    TEST(entry != nullptr);
+    Write(*entry, 0, aBytes);
+    return entry;
+}
+
+void SuiteStreamCache::TestNothingCached()
+{
+    TEST(iCache->Open(kUri1) == nullptr);
+    StreamCacheEntry* entry = iCache->Create(kUri1, 500, true);
+    TEST(entry != nullptr);
+    iCache->Close(*entry);
+    // entries without any data aren't reported
+    TEST(iCache->Open(kUri1) == nullptr);
+}
+
+void SuiteStreamCache::TestWriteRead()
+{
+    StreamCacheEntry* entry = iCache->Create(kUri1, 500, true);
+    TEST(entry->StreamBytes() == 500);
+    TEST(entry->RangeFetchable());
+    Write(*entry, 0, 100);
+    TEST(entry->BytesAvailable(0) == 100);
+    TEST(entry->BytesAvailable(40) == 60);
+    TEST(entry->BytesAvailable(100) == 0);
+    TEST(entry->BytesMissing(0) == 0);
+    TEST(entry->BytesMissing(100) == 400);
+    TEST(ReadMatches(*entry, 0, 100));
+    TEST(ReadMatches(*entry, 40, 20));
+    TEST_THROWS(entry->Read(100, iBuf, 10), ReaderError);
+    TEST(iCache->Bytes() == 100);
+
+    // data beyond the end of the stream is discarded
+    Write(*entry, 450, 100);
+    TEST(entry->BytesAvailable(450) == 50);
+    TEST(iCache->Bytes() == 500);
+    iCache->Close(*entry);
+}
+
+void SuiteStreamCache::TestRangesMerge()
+{
+    StreamCacheEntry* entry = iCache->Create(kUri1, 500, true);
+    Write(*entry, 200, 100);
+    TEST(entry->BytesAvailable(0) == 0);
+    TEST(entry->BytesMissing(0) == 200);
+    TEST(entry->BytesMissing(300) == 200);
+    Write(*entry, 100, 150);
+    TEST(entry->BytesAvailable(100) == 200);
+    TEST(entry->BytesMissing(0) == 100);
+    Write(*entry, 400, 50);
+    TEST(entry->BytesMissing(300) == 100);
+    Write(*entry, 0, 100);
+    TEST(entry->BytesAvailable(0) == 300);
+    TEST(ReadMatches(*entry, 0, 300));
+    TEST(ReadMatches(*entry, 400, 50));
+    iCache->Close(*entry);
+}
+
+void SuiteStreamCache::TestReopen()
+{
+    StreamCacheEntry* entry = Fill(kUri1, 300);
+    iCache->Close(*entry);
+    entry = iCache->Open(kUri1);
+    TEST(entry != nullptr);
+    TEST(entry->BytesAvailable(0) == 300);
+    TEST(ReadMatches(*entry, 0, 300));
+    iCache->Close(*entry);
+
+    // recreating an entry for an unchanged stream preserves its data
+    entry = iCache->Create(kUri1, 300, false);
+    TEST(entry->BytesAvailable(0) == 300);
+    TEST(!entry->RangeFetchable());
+    iCache->Close(*entry);
+}
+
+void SuiteStreamCache::TestStreamChanged()
+{
+    StreamCacheEntry* entry = Fill(kUri1, 300);
+    iCache->Close(*entry);
+    entry = iCache->Create(kUri1, 400, true);
+    TEST(entry != nullptr);
+    TEST(entry->StreamBytes() == 400);
+    TEST(entry->BytesAvailable(0) == 0);
+    TEST(iCache->Bytes() == 0);
+    iCache->Close(*entry);
+}
+
+void SuiteStreamCache::TestEvictLeastRecentlyUsed()
+{
+    iCache->Close(*Fill(kUri1, 400));
+    iCache->Close(*Fill(kUri2, 400));
+    StreamCacheEntry* entry = iCache->Open(kUri1);
+    iCache->Close(*entry);
+
+    iCache->Close(*Fill(kUri3, 400));
+    TEST(iCache->Bytes() == 800);
+    TEST(iCache->Open(kUri2) == nullptr);
+    entry = iCache->Open(kUri1);
+    TEST(entry != nullptr);
+    TEST(ReadMatches(*entry, 0, 400));
+    iCache->Close(*entry);
+    entry = iCache->Open(kUri3);
+    TEST(entry != nullptr);
+    iCache->Close(*entry);
+}
+
+void SuiteStreamCache::TestOpenEntryNotEvicted()
+{
+    StreamCacheEntry* entry1 = Fill(kUri1, 600);
+    StreamCacheEntry* entry2 = Fill(kUri2, 600);
+    TEST(entry2->BytesAvailable(0) == 0);
+    TEST(entry1->BytesAvailable(0) == 600);
+    iCache->Close(*entry1);
+
+    Write(*entry2, 0, 600);
+    TEST(entry2->BytesAvailable(0) == 600);
+    TEST(iCache->Open(kUri1) == nullptr);
+    iCache->Close(*entry2);
+}
+
+void SuiteStreamCache::TestMaxEntries()
+{
+    iCache->Close(*Fill(kUri1, 100));
+    iCache->Close(*Fill(kUri2, 100));
+    iCache->Close(*Fill(kUri3, 100));
+    TEST(iCache->EntryCount() == kMaxEntries);
+    iCache->Close(*Fill(kUri4, 100));
+    TEST(iCache->EntryCount() == kMaxEntries);
+    TEST(iCache->Bytes() == 300);
+    TEST(iCache->Open(kUri1) == nullptr);
+    StreamCacheEntry* entry = iCache->Open(kUri4);
+    TEST(entry != nullptr);
+    TEST(ReadMatches(*entry, 0, 100));
+    iCache->Close(*entry);
+}
+
+void SuiteStreamCache::TestStreamTooLarge()
+{
+    TEST(iCache->Create(kUri1, kMaxBytes + 1, true) == nullptr);
+    TEST(iCache->Create(kUri1, 0, true) == nullptr);
+    TEST(iCache->EntryCount() == 0);
+}
+
+
+
+void TestStreamCache()
+{
+    Runner runner("StreamCache tests\n");
+    runner.Add(new SuiteStreamCache());
+    runner.Run();
+}
@@ -43,6 +43,7 @@ ConfigAppMediaPlayer::ConfigAppMediaPlayer(IInfoAggregator& aInfoAggregator,
     AddConfigChoiceConditional(Brn("Device.AutoPlay"));
     AddConfigChoiceConditional(Brn("Sender.Enabled"));
     AddConfigChoiceConditional(Brn("Sender.Mode"));
+    AddConfigChoiceConditional(Brn("Sender.UnicastChaining"));
     AddConfigChoiceConditional(Brn("Source.NetAux.Auto"));
     AddConfigChoiceConditional(Qobuz::kConfigKeySoundQuality);
     AddConfigChoiceConditional(Brn("qobuz.com.Enabled"));